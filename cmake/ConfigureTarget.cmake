@@ -10,12 +10,16 @@ function(configure_target target wordsize)
       set_target_properties(${target} PROPERTIES COMPILE_FLAGS "-m64")
       set_target_properties(${target} PROPERTIES LINK_FLAGS "-m64")
     endif()
-    target_link_libraries(${target} dl)
+    target_link_libraries(${target} dl pthread rt)
 
     if(WITH_GUI)
       target_link_libraries(${target} x11)
     endif()
 
+    if(WITH_JACK)
+      target_link_libraries(${target} jack)
+    endif()
+
   elseif(APPLE)
     if(${wordsize} EQUAL 32)
       set_target_properties(${target} PROPERTIES OSX_ARCHITECTURES "i386")
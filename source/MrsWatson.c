@@ -27,17 +27,30 @@
 #include "MrsWatson.h"
 #include "MrsWatsonOptions.h"
 
+#include "app/BatchRenderer.h"
 #include "app/BuildInfo.h"
+#include "app/ControlChannel.h"
+#if WITH_JACK
+#include "app/JackClient.h"
+#endif
+#include "app/RenderServer.h"
+#include "app/SegmentRenderer.h"
 #include "audio/AudioSettings.h"
 #include "base/PlatformInfo.h"
+#include "base/Thread.h"
 #include "io/SampleSource.h"
 #include "io/SampleSourcePcm.h"
+#include "io/SampleSourceSegmented.h"
 #include "logging/EventLogger.h"
 #include "logging/LogPrinter.h"
 #include "midi/MidiSequence.h"
 #include "midi/MidiSource.h"
 #include "plugin/PluginChain.h"
+#include "plugin/PluginChainFanOut.h"
+#include "plugin/PluginChainRenderer.h"
+#include "plugin/PluginGroup.h"
 #include "time/AudioClock.h"
+#include "time/RealtimeScheduler.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -132,12 +145,30 @@ static void printVersion(void) {
   freeCharString(versionString);
 }
 
+static CharString getChannelLayout(const ProgramOptions programOptions) {
+  return programOptions->options[OPTION_CHANNEL_GROUPS]->enabled
+             ? programOptionsGetString(programOptions, OPTION_CHANNEL_GROUPS)
+             : NULL;
+}
+
 static ReturnCode buildPluginChain(PluginChain pluginChain,
                                    const CharString argument,
+                                   const CharString channelLayout,
                                    const CharString pluginSearchRoot) {
-  // Construct plugin chain
-  if (!pluginChainAddFromArgumentString(pluginChain, argument,
-                                        pluginSearchRoot)) {
+  Plugin channelGroup;
+
+  if (channelLayout != NULL) {
+    // The whole chain is wrapped in a group which runs one copy of it for
+    // each group of channels
+    channelGroup = newPluginGroupWithChannelLayout(argument, channelLayout,
+                                                   pluginSearchRoot);
+
+    if (!pluginChainAppend(pluginChain, channelGroup, NULL)) {
+      freePlugin(channelGroup);
+      return RETURN_CODE_INVALID_PLUGIN_CHAIN;
+    }
+  } else if (!pluginChainAddFromArgumentString(pluginChain, argument,
+                                               pluginSearchRoot)) {
     return RETURN_CODE_INVALID_PLUGIN_CHAIN;
   }
 
@@ -177,12 +208,12 @@ static ReturnCode setupMidiSource(MidiSource midiSource,
       return RETURN_CODE_IO_ERROR;
     }
 
-    // Read in all events from the MIDI source
-    // TODO: This will not work if we want to support streaming MIDI events (ie,
-    // from a pipe)
+    // Sources which can be streamed are read a block at a time while
+    // processing, otherwise all events are read in here
     *outSequence = newMidiSequence();
 
-    if (!midiSource->readMidiEvents(midiSource, *outSequence)) {
+    if (midiSource->readMidiEventsUntil == NULL &&
+        !midiSource->readMidiEvents(midiSource, *outSequence)) {
       logWarn("Failed reading MIDI events from source '%s'",
               midiSource->sourceName->data);
       return RETURN_CODE_IO_ERROR;
@@ -206,6 +237,139 @@ static ReturnCode setupOutputSource(SampleSource outputSource) {
   return RETURN_CODE_SUCCESS;
 }
 
+#define VARIANT_CHAIN_SEPARATOR '='
+#define VARIANT_PARAMETER_SEPARATOR '@'
+
+typedef struct {
+  PluginChainFanOut fanOut;
+  ProgramOptions programOptions;
+  ReturnCode result;
+} _SetupVariantPassData;
+
+static ReturnCode setupVariant(PluginChainFanOut fanOut,
+                               const char *variantArgument,
+                               const ProgramOptions programOptions) {
+  // Variants are given as OUTPUT[=PLUGINS][@INDEX,VALUE...]
+  CharString variantString = newCharStringWithCString(variantArgument);
+  CharString chainString = NULL;
+  CharString outputName = NULL;
+  LinkedList parameters = newLinkedList();
+  boolByte usesMainChain = true;
+  PluginChain variantChain = newPluginChain();
+  SampleSource variantOutput = NULL;
+  ReturnCode result = RETURN_CODE_SUCCESS;
+  char *separator;
+
+  separator = strchr(variantString->data, VARIANT_PARAMETER_SEPARATOR);
+
+  while (separator != NULL) {
+    *separator = '\0';
+    linkedListAppend(parameters, separator + 1);
+    separator = strchr(separator + 1, VARIANT_PARAMETER_SEPARATOR);
+  }
+
+  separator = strchr(variantString->data, VARIANT_CHAIN_SEPARATOR);
+
+  if (separator != NULL) {
+    *separator = '\0';
+    chainString = newCharStringWithCString(separator + 1);
+    usesMainChain = false;
+  } else {
+    chainString = newCharString();
+    charStringCopy(chainString,
+                   programOptionsGetString(programOptions, OPTION_PLUGIN));
+  }
+
+  outputName = newCharStringWithCString(variantString->data);
+
+  if (charStringIsEmpty(outputName) ||
+      charStringIsEqualToCString(outputName, "-", false)) {
+    logError("Variant '%s' must have an output file", variantArgument);
+    result = RETURN_CODE_INVALID_ARGUMENT;
+  } else if ((result = buildPluginChain(
+                  variantChain, chainString,
+                  getChannelLayout(programOptions),
+                  programOptionsGetString(programOptions,
+                                          OPTION_PLUGIN_ROOT))) !=
+             RETURN_CODE_SUCCESS) {
+    logError("Could not build plugin chain for variant '%s'", variantArgument);
+  } else if ((result = pluginChainInitialize(variantChain)) !=
+             RETURN_CODE_SUCCESS) {
+    logError("Could not initialize plugin chain for variant '%s'",
+             variantArgument);
+  } else if (usesMainChain &&
+             programOptions->options[OPTION_PARAMETER]->enabled &&
+             !pluginChainSetParameters(
+                 variantChain,
+                 programOptionsGetList(programOptions, OPTION_PARAMETER))) {
+    // Parameters given with --parameter only apply to the main chain's
+    // plugins, so they are skipped for variants with their own chain
+    logError("Could not set parameters for variant '%s'", variantArgument);
+    result = RETURN_CODE_INVALID_ARGUMENT;
+  } else if (!pluginChainSetParameters(variantChain, parameters)) {
+    logError("Could not set parameters for variant '%s'", variantArgument);
+    result = RETURN_CODE_INVALID_ARGUMENT;
+  } else {
+    variantOutput = sampleSourceFactory(outputName);
+
+    if ((result = setupOutputSource(variantOutput)) != RETURN_CODE_SUCCESS) {
+      logError("Could not open output for variant '%s'", variantArgument);
+    } else {
+      logInfo("Rendering variant '%s' with plugins '%s'", outputName->data,
+              chainString->data);
+      pluginChainFanOutAddVariant(fanOut, variantChain, variantOutput);
+    }
+  }
+
+  if (result != RETURN_CODE_SUCCESS) {
+    pluginChainShutdown(variantChain);
+    freePluginChain(variantChain);
+    freeSampleSource(variantOutput);
+  }
+
+  freeLinkedList(parameters);
+  freeCharString(chainString);
+  freeCharString(outputName);
+  freeCharString(variantString);
+  return result;
+}
+
+static void _setupVariant(void *item, void *userData) {
+  char *variantArgument = (char *)item;
+  _SetupVariantPassData *passData = (_SetupVariantPassData *)userData;
+
+  if (passData->result == RETURN_CODE_SUCCESS) {
+    passData->result = setupVariant(passData->fanOut, variantArgument,
+                                    passData->programOptions);
+  }
+}
+
+static ReturnCode setupVariants(const ProgramOptions programOptions,
+                                PluginChainFanOut *outFanOut) {
+  _SetupVariantPassData passData;
+
+  if (!programOptions->options[OPTION_VARIANT]->enabled) {
+    return RETURN_CODE_SUCCESS;
+  }
+
+  passData.fanOut = newPluginChainFanOut();
+  passData.programOptions = programOptions;
+  passData.result = RETURN_CODE_SUCCESS;
+  linkedListForeach(programOptionsGetList(programOptions, OPTION_VARIANT),
+                    _setupVariant, &passData);
+
+  if (passData.result != RETURN_CODE_SUCCESS) {
+    freePluginChainFanOut(passData.fanOut);
+    return passData.result;
+  }
+
+  pluginChainFanOutStart(
+      passData.fanOut,
+      (unsigned int)programOptionsGetNumber(programOptions, OPTION_THREADS));
+  *outFanOut = passData.fanOut;
+  return RETURN_CODE_SUCCESS;
+}
+
 static void _processMidiMetaEvent(void *item, void *userData) {
   MidiEvent midiEvent = (MidiEvent)item;
   boolByte *finishedReading = (boolByte *)userData;
@@ -236,32 +400,236 @@ static void _processMidiMetaEvent(void *item, void *userData) {
   }
 }
 
+static ReturnCode renderBatch(const ProgramOptions programOptions,
+                              const CharString pluginSearchRoot) {
+  BatchRenderer batchRenderer = newBatchRenderer();
+  unsigned int numWorkers = platformInfoGetNumProcessors();
+  LinkedList defaultParameters =
+      programOptions->options[OPTION_PARAMETER]->enabled
+          ? programOptionsGetList(programOptions, OPTION_PARAMETER)
+          : NULL;
+  ReturnCode result;
+
+  if (programOptions->options[OPTION_THREADS]->enabled) {
+    numWorkers =
+        (unsigned int)programOptionsGetNumber(programOptions, OPTION_THREADS);
+  }
+
+  if (!batchRendererReadManifest(
+          batchRenderer,
+          programOptionsGetString(programOptions, OPTION_BATCH))) {
+    freeBatchRenderer(batchRenderer);
+    return RETURN_CODE_INVALID_ARGUMENT;
+  }
+
+  if (programOptions->options[OPTION_PROCESSES]->enabled) {
+    result = batchRendererRunForked(
+        batchRenderer, programOptionsGetString(programOptions, OPTION_PLUGIN),
+        defaultParameters, pluginSearchRoot,
+        (unsigned int)programOptionsGetNumber(programOptions,
+                                              OPTION_PROCESSES));
+  } else {
+    result = batchRendererRun(
+        batchRenderer, programOptionsGetString(programOptions, OPTION_PLUGIN),
+        defaultParameters, pluginSearchRoot, numWorkers);
+  }
+
+  freeBatchRenderer(batchRenderer);
+  return result;
+}
+
+static ReturnCode renderServe(const ProgramOptions programOptions,
+                              const CharString pluginSearchRoot) {
+  RenderServer renderServer = newRenderServer(
+      programOptionsGetString(programOptions, OPTION_SERVE),
+      programOptionsGetString(programOptions, OPTION_PLUGIN),
+      programOptions->options[OPTION_PARAMETER]->enabled
+          ? programOptionsGetList(programOptions, OPTION_PARAMETER)
+          : NULL,
+      pluginSearchRoot);
+  ReturnCode result = RETURN_CODE_IO_ERROR;
+
+  if (renderServerOpen(renderServer)) {
+    result = renderServerRun(renderServer);
+  }
+
+  freeRenderServer(renderServer);
+  return result;
+}
+
+static ReturnCode renderJack(const ProgramOptions programOptions,
+                             SampleSource inputSource,
+                             SampleSource outputSource,
+                             PluginChain pluginChain,
+                             const CharString pluginSearchRoot,
+                             unsigned long maxTimeInMs) {
+#if WITH_JACK
+  JackClient jackClient =
+      newJackClient(programOptionsGetString(programOptions, OPTION_JACK));
+  ControlChannel controlChannel = NULL;
+  SampleRate jackSampleRate;
+  ReturnCode result;
+
+  if (!jackClientOpen(jackClient)) {
+    freeJackClient(jackClient);
+    return RETURN_CODE_IO_ERROR;
+  }
+
+  // Files are only used if they were given explicitly, otherwise the ports
+  // are processed
+  if (!programOptions->options[OPTION_INPUT_SOURCE]->enabled) {
+    inputSource = NULL;
+  } else {
+    jackSampleRate = getSampleRate();
+
+    if ((result = setupInputSource(inputSource)) != RETURN_CODE_SUCCESS) {
+      freeJackClient(jackClient);
+      return result;
+    }
+
+    if (getSampleRate() != jackSampleRate) {
+      logError("Input source has a sample rate of %.0fHz, but the JACK server "
+               "runs at %.0fHz",
+               getSampleRate(), jackSampleRate);
+      freeJackClient(jackClient);
+      return RETURN_CODE_INVALID_ARGUMENT;
+    }
+  }
+
+  if (programOptions->options[OPTION_PIPELINE]->enabled) {
+    logWarn("Pipeline stages wait on each other for every block, which may "
+            "cause xruns with JACK");
+  }
+
+  if ((result = buildPluginChain(
+           pluginChain, programOptionsGetString(programOptions, OPTION_PLUGIN),
+           getChannelLayout(programOptions), pluginSearchRoot)) !=
+          RETURN_CODE_SUCCESS ||
+      (result = pluginChainInitialize(pluginChain)) != RETURN_CODE_SUCCESS) {
+    freeJackClient(jackClient);
+    return result;
+  }
+
+  if (programOptions->options[OPTION_PARAMETER]->enabled &&
+      !pluginChainSetParameters(
+          pluginChain,
+          programOptionsGetList(programOptions, OPTION_PARAMETER))) {
+    pluginChainShutdown(pluginChain);
+    freeJackClient(jackClient);
+    return RETURN_CODE_INVALID_ARGUMENT;
+  }
+
+  if (!programOptions->options[OPTION_OUTPUT_SOURCE]->enabled) {
+    outputSource = NULL;
+  } else if ((result = setupOutputSource(outputSource)) !=
+             RETURN_CODE_SUCCESS) {
+    pluginChainShutdown(pluginChain);
+    freeJackClient(jackClient);
+    return result;
+  }
+
+  if (programOptions->options[OPTION_CONTROL]->enabled) {
+    controlChannel = newControlChannel(
+        programOptionsGetString(programOptions, OPTION_CONTROL));
+
+    if (!controlChannelOpen(controlChannel)) {
+      freeControlChannel(controlChannel);
+      pluginChainShutdown(pluginChain);
+      freeJackClient(jackClient);
+      return RETURN_CODE_IO_ERROR;
+    }
+  }
+
+  pluginChainPrepareForProcessing(pluginChain);
+  result = jackClientRun(jackClient, pluginChain, inputSource, outputSource,
+                         controlChannel, maxTimeInMs);
+  pluginChainShutdown(pluginChain);
+  freeJackClient(jackClient);
+  freeControlChannel(controlChannel);
+
+  if (inputSource != NULL) {
+    inputSource->closeSampleSource(inputSource);
+  }
+
+  if (outputSource != NULL) {
+    outputSource->closeSampleSource(outputSource);
+  }
+
+  return result;
+#else
+  (void)inputSource;
+  (void)outputSource;
+  (void)pluginChain;
+  (void)pluginSearchRoot;
+  (void)maxTimeInMs;
+  logUnsupportedFeature("Running as a JACK client");
+  return RETURN_CODE_UNSUPPORTED_FEATURE;
+#endif
+}
+
+static ReturnCode renderSegments(const ProgramOptions programOptions,
+                                 SampleSource inputSource,
+                                 SampleSource outputSource,
+                                 const CharString pluginSearchRoot) {
+  SegmentRenderer segmentRenderer;
+  ReturnCode result;
+
+  if (outputSource == NULL) {
+    logError("Segment-parallel rendering requires an output source");
+    return RETURN_CODE_INVALID_ARGUMENT;
+  } else if (programOptions->options[OPTION_MIDI_SOURCE]->enabled ||
+             programOptions->options[OPTION_REALTIME]->enabled) {
+    logError("Segment-parallel rendering can't be used with MIDI or in "
+             "realtime mode");
+    return RETURN_CODE_INVALID_ARGUMENT;
+  }
+
+  segmentRenderer = newSegmentRenderer(
+      programOptionsGetString(programOptions, OPTION_PLUGIN),
+      programOptions->options[OPTION_PARAMETER]->enabled
+          ? programOptionsGetList(programOptions, OPTION_PARAMETER)
+          : NULL,
+      pluginSearchRoot);
+  result = segmentRendererRun(
+      segmentRenderer, inputSource, outputSource,
+      (unsigned int)programOptionsGetNumber(programOptions,
+                                            OPTION_SEGMENT_PARALLEL),
+      programOptions->options[OPTION_OVERLAP]->enabled
+          ? (unsigned long)programOptionsGetNumber(programOptions,
+                                                   OPTION_OVERLAP)
+          : 0);
+  freeSegmentRenderer(segmentRenderer);
+  return result;
+}
+
 /**
  *  Reads from inputSource.
  *
  * @param inputSource The SampleSource to read from.
  * @param buffer The SampleBuffer to which the samples will be written.
+ * @param framesRead Set to the number of frames which were read, which is less
+ * than the blocksize for the last block of the input.
  * @return True if there is more input to read.
  */
-boolByte readInput(SampleSource inputSource, SampleBuffer buffer) {
-  unsigned long framesRead;
+boolByte readInput(SampleSource inputSource, SampleBuffer buffer,
+                   unsigned long *framesRead) {
   unsigned long bufferSize = buffer->blocksize;
 
   inputSource->readSampleBlock(inputSource, buffer);
   // buffer->blocksize tells how many frames have been read from inputSource
-  framesRead = buffer->blocksize;
+  *framesRead = buffer->blocksize;
 
-  if (framesRead == bufferSize) {
+  if (*framesRead == bufferSize) {
     // We have filled up the buffer, so return true to ask for more input
     return true;
-  } else if (framesRead < bufferSize) {
+  } else if (*framesRead < bufferSize) {
     // Partial read, meaning that we have reached the end of file
-    unsigned long numberOfFrames = (bufferSize - framesRead);
+    unsigned long numberOfFrames = (bufferSize - *framesRead);
     SampleBuffer silenceBuffer =
         newSampleBuffer(buffer->numChannels, numberOfFrames);
 
-    buffer->blocksize = framesRead + numberOfFrames;
-    sampleBufferCopyAndMapChannelsWithOffset(buffer, framesRead, silenceBuffer,
+    buffer->blocksize = *framesRead + numberOfFrames;
+    sampleBufferCopyAndMapChannelsWithOffset(buffer, *framesRead, silenceBuffer,
                                              0, numberOfFrames);
     freeSampleBuffer(silenceBuffer);
 
@@ -276,58 +644,6 @@ boolByte readInput(SampleSource inputSource, SampleBuffer buffer) {
   }
 }
 
-/**
- *  Writes to outputSource.
- *
- * @param outputSource The SampleSource to write to.
- * @param silenceSource The source from where to write skipHeadFrames frames.
- * @param buffer The SampleBuffer with the samples to be written.
- * @param skipHeadFrames Number of frames to ignore before writing to
- * outputSource.
- */
-void writeOutput(SampleSource outputSource, SampleSource silenceSource,
-                 SampleBuffer buffer, unsigned long skipHeadFrames) {
-  unsigned long framesSkipped =
-      silenceSource->numSamplesProcessed / buffer->numChannels;
-  unsigned long framesProcessed =
-      framesSkipped + outputSource->numSamplesProcessed / buffer->numChannels;
-  unsigned long nextBlockStart = framesProcessed + buffer->blocksize;
-
-  if (framesProcessed != getAudioClock()->currentFrame) {
-    logWarn("framesProcessed (%lu) != getAudioClock()->currentFrame (%lu)",
-            framesProcessed, getAudioClock()->currentFrame);
-  }
-
-  // Cut the delay at the start
-  if (nextBlockStart <= skipHeadFrames) {
-    // Cutting away the whole block. nothing is written to the outputSource
-    silenceSource->writeSampleBlock(silenceSource, buffer);
-  } else if (framesProcessed < skipHeadFrames &&
-             skipHeadFrames < nextBlockStart) {
-    SampleBuffer sourceBuffer =
-        newSampleBuffer(buffer->numChannels, buffer->blocksize);
-    unsigned long skippedFrames = skipHeadFrames - framesProcessed;
-    unsigned long soundFrames = nextBlockStart - skipHeadFrames;
-
-    // Cutting away start part of the block.
-    sourceBuffer->blocksize = skippedFrames;
-    sampleBufferCopyAndMapChannelsWithOffset(sourceBuffer, 0, buffer, 0,
-                                             sourceBuffer->blocksize);
-    silenceSource->writeSampleBlock(silenceSource, sourceBuffer);
-
-    // Writing remaining end part of the block.
-    sourceBuffer->blocksize = soundFrames;
-    sampleBufferCopyAndMapChannelsWithOffset(
-        sourceBuffer, 0, buffer, skippedFrames, sourceBuffer->blocksize);
-    outputSource->writeSampleBlock(outputSource, sourceBuffer);
-
-    freeSampleBuffer(sourceBuffer);
-  } else {
-    // Normal case: Nothing more to cut. The whole block shall be written.
-    outputSource->writeSampleBlock(outputSource, buffer);
-  }
-}
-
 int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
   ReturnCode result;
   // Input/Output sources, plugin chain, and other required objects
@@ -337,21 +653,30 @@ int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
   PluginChain pluginChain;
   CharString pluginSearchRoot = newCharString();
   boolByte shouldDisplayPluginInfo = false;
+  boolByte lockMemory = false;
   MidiSequence midiSequence = NULL;
   MidiSource midiSource = NULL;
+  boolByte midiSourceHasEvents = false;
+  LinkedListBuffer midiEventBuffer = NULL;
+  LinkedList midiEventsForBlock = NULL;
+  PluginChainFanOut fanOut = NULL;
+  ControlChannel controlChannel = NULL;
   unsigned long maxTimeInMs = 0;
   unsigned long maxTimeInFrames = 0;
+  unsigned long syncIntervalInMs = 0;
+  unsigned long syncIntervalInFrames = 0;
+  unsigned long framesSinceSync = 0;
   unsigned long processingDelayInFrames;
+  unsigned long inputFramesRead;
   ProgramOptions programOptions;
   ProgramOption option;
   Plugin headPlugin;
   SampleBuffer inputSampleBuffer = NULL;
-  SampleBuffer outputSampleBuffer = NULL;
+  PluginChainRenderer renderer = NULL;
   TaskTimer initTimer, totalTimer, inputTimer, outputTimer = NULL;
   LinkedList taskTimerList = NULL;
   CharString totalTimeString = NULL;
   boolByte finishedReading = false;
-  SampleSource silentSampleOutput;
   unsigned int i;
 
   initTimer = newTaskTimerWithCString(PROGRAM_NAME, "Initialization");
@@ -639,8 +964,30 @@ int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
             programOptionsGetString(programOptions, OPTION_PLUGIN_ROOT));
         break;
 
+      case OPTION_PIN_THREADS:
+        // This thread is the first of each set of threads which it starts
+        setThreadPinning(true);
+        threadPin(NULL, THREAD_PLACEMENT_COMPACT, 0);
+        break;
+
+      case OPTION_PIPELINE:
+        if (programOptions->options[OPTION_REALTIME]->enabled) {
+          logWarn("Pipelined processing can't be used in realtime mode");
+        } else {
+          pluginChainSetPipelineStages(
+              pluginChain, (unsigned int)programOptionsGetNumber(
+                               programOptions, OPTION_PIPELINE));
+        }
+
+        break;
+
       case OPTION_REALTIME:
         pluginChainSetRealtime(pluginChain, true);
+        lockMemory = true;
+        break;
+
+      case OPTION_REALTIME_PRIORITY:
+        setCurrentThreadRealtimePriority();
         break;
 
       case OPTION_SAMPLE_RATE:
@@ -662,6 +1009,26 @@ int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
 
         break;
 
+      case OPTION_SEGMENT_LENGTH:
+        // The output source option is always parsed before this one, so the
+        // output source can be replaced with a segmented one here
+        if (programOptions->options[OPTION_OUTPUT_SOURCE]->enabled) {
+          freeSampleSource(outputSource);
+          outputSource = newSampleSourceSegmented(
+              programOptionsGetString(programOptions, OPTION_OUTPUT_SOURCE),
+              (unsigned long)programOptionsGetNumber(programOptions,
+                                                     OPTION_SEGMENT_LENGTH));
+        } else {
+          logWarn("Segment length given without an output source, ignoring");
+        }
+
+        break;
+
+      case OPTION_SYNC_INTERVAL:
+        syncIntervalInMs = (const unsigned long)programOptionsGetNumber(
+            programOptions, OPTION_SYNC_INTERVAL);
+        break;
+
       case OPTION_TEMPO:
         if (!setTempo(programOptionsGetNumber(programOptions, OPTION_TEMPO))) {
           freeSampleSource(inputSource);
@@ -745,6 +1112,36 @@ int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
 
   printWelcomeMessage(argc, argv);
 
+  // Batch and server jobs each have their own input and output, and JACK
+  // clients are driven by the server, so they are handled separately from the
+  // normal processing below
+  if (programOptions->options[OPTION_BATCH]->enabled ||
+      programOptions->options[OPTION_SERVE]->enabled ||
+      programOptions->options[OPTION_JACK]->enabled) {
+    if (programOptions->options[OPTION_BATCH]->enabled) {
+      result = renderBatch(programOptions, pluginSearchRoot);
+    } else if (programOptions->options[OPTION_SERVE]->enabled) {
+      result = renderServe(programOptions, pluginSearchRoot);
+    } else {
+      result = renderJack(programOptions, inputSource, outputSource,
+                          pluginChain, pluginSearchRoot, maxTimeInMs);
+    }
+
+    freeSampleSource(inputSource);
+    freeSampleSource(outputSource);
+    freePluginChain(pluginChain);
+    freeProgramOptions(programOptions);
+    freeTaskTimer(initTimer);
+    freeTaskTimer(totalTimer);
+    freeCharString(pluginSearchRoot);
+    freeMidiSource(midiSource);
+    freeAudioSettings();
+    setThreadPinning(false);
+    freeEventLogger();
+    freeAudioClock(getAudioClock());
+    return result;
+  }
+
   if ((result = setupInputSource(inputSource)) != RETURN_CODE_SUCCESS) {
     logError("Input source could not be opened, exiting");
     freeSampleSource(inputSource);
@@ -761,9 +1158,29 @@ int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
     return result;
   }
 
+  // Each segment has its own plugin chain, which is loaded by the renderer
+  if (programOptions->options[OPTION_SEGMENT_PARALLEL]->enabled) {
+    result = renderSegments(programOptions, inputSource, outputSource,
+                            pluginSearchRoot);
+    freeSampleSource(inputSource);
+    freeSampleSource(outputSource);
+    freePluginChain(pluginChain);
+    freeProgramOptions(programOptions);
+    freeTaskTimer(initTimer);
+    freeTaskTimer(totalTimer);
+    freeCharString(pluginSearchRoot);
+    freeMidiSource(midiSource);
+    freeAudioSettings();
+    setThreadPinning(false);
+    freeEventLogger();
+    freeAudioClock(getAudioClock());
+    return result;
+  }
+
   if ((result = buildPluginChain(
            pluginChain, programOptionsGetString(programOptions, OPTION_PLUGIN),
-           pluginSearchRoot)) != RETURN_CODE_SUCCESS) {
+           getChannelLayout(programOptions), pluginSearchRoot)) !=
+      RETURN_CODE_SUCCESS) {
     logError("Plugin chain could not be constructed, exiting");
     freeSampleSource(inputSource);
     freeSampleSource(outputSource);
@@ -783,7 +1200,14 @@ int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
   freeCharString(pluginSearchRoot);
 
   if (midiSource != NULL) {
-    result = setupMidiSource(midiSource, &midiSequence);
+    if (inputSource != NULL &&
+        charStringIsEqualToCString(inputSource->sourceName, "-", false) &&
+        charStringIsEqualToCString(midiSource->sourceName, "-", false)) {
+      logError("Input source and MIDI source can't both be read from stdin");
+      result = RETURN_CODE_INVALID_ARGUMENT;
+    } else {
+      result = setupMidiSource(midiSource, &midiSequence);
+    }
 
     if (result != RETURN_CODE_SUCCESS) {
       logError("MIDI source could not be opened, exiting");
@@ -1009,9 +1433,49 @@ int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
     }
   }
 
+  // Build and start any chain variants, which are rendered from the same input
+  if ((result = setupVariants(programOptions, &fanOut)) !=
+      RETURN_CODE_SUCCESS) {
+    logError("Variants could not be set up, exiting");
+    freeSampleSource(inputSource);
+    freeSampleSource(outputSource);
+    freePluginChain(pluginChain);
+    freeProgramOptions(programOptions);
+    freeTaskTimer(initTimer);
+    freeTaskTimer(totalTimer);
+    freeMidiSource(midiSource);
+    freeMidiSequence(midiSequence);
+    freeAudioSettings();
+    freeEventLogger();
+    freeAudioClock(getAudioClock());
+    return result;
+  }
+
+  if (programOptions->options[OPTION_CONTROL]->enabled) {
+    controlChannel = newControlChannel(
+        programOptionsGetString(programOptions, OPTION_CONTROL));
+
+    if (!controlChannelOpen(controlChannel)) {
+      logError("Control channel could not be opened, exiting");
+      freeControlChannel(controlChannel);
+      freePluginChainFanOut(fanOut);
+      freeSampleSource(inputSource);
+      freeSampleSource(outputSource);
+      freePluginChain(pluginChain);
+      freeProgramOptions(programOptions);
+      freeTaskTimer(initTimer);
+      freeTaskTimer(totalTimer);
+      freeMidiSource(midiSource);
+      freeMidiSequence(midiSequence);
+      freeAudioSettings();
+      freeEventLogger();
+      freeAudioClock(getAudioClock());
+      return RETURN_CODE_IO_ERROR;
+    }
+  }
+
   inputSampleBuffer = newSampleBuffer(getNumChannels(), getBlocksize());
   inputTimer = newTaskTimerWithCString(PROGRAM_NAME, "Input Source");
-  outputSampleBuffer = newSampleBuffer(getNumChannels(), getBlocksize());
   outputTimer = newTaskTimerWithCString(PROGRAM_NAME, "Output Source");
 
   // Initialization is finished, we should be able to free this memory now
@@ -1022,7 +1486,14 @@ int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
     maxTimeInFrames = (unsigned long)(maxTimeInMs * getSampleRate()) / 1000l;
   }
 
+  if (syncIntervalInMs > 0) {
+    syncIntervalInFrames =
+        (unsigned long)(syncIntervalInMs * getSampleRate()) / 1000l;
+  }
+
   processingDelayInFrames = pluginChainGetProcessingDelay(pluginChain);
+  renderer = newPluginChainRenderer(pluginChain, outputSource);
+  renderer->outputTimer = outputTimer;
   pluginChainPrepareForProcessing(pluginChain);
 
   // Update sample rate on the event logger
@@ -1037,26 +1508,53 @@ int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
            getTimeSignatureNoteValue());
   taskTimerStop(initTimer);
 
-  silentSampleOutput = sampleSourceFactory(NULL);
+  // The events for each block are gathered in the same buffer, which only
+  // grows when a block has more events than any before it
+  if (midiSequence != NULL) {
+    midiEventBuffer =
+        newLinkedListBuffer(MIDI_SEQUENCE_DEFAULT_EVENTS_PER_BLOCK);
+  }
+
+  // All buffers which are used while processing have been allocated by now
+  if (lockMemory) {
+    realtimeSchedulerLockMemory();
+  }
 
   // Main processing loop
   while (!finishedReading) {
     taskTimerStart(inputTimer);
-    finishedReading = (boolByte)!readInput(inputSource, inputSampleBuffer);
+    finishedReading =
+        (boolByte)!readInput(inputSource, inputSampleBuffer, &inputFramesRead);
 
-    // TODO: For streaming MIDI, we would need to read in events from source
-    // here
     if (midiSequence != NULL) {
-      LinkedList midiEventsForBlock = newLinkedList();
+      if (midiSource->readMidiEventsUntil != NULL) {
+        midiSequenceDiscardPlayedEvents(midiSequence);
+        midiSourceHasEvents = midiSource->readMidiEventsUntil(
+            midiSource, midiSequence,
+            audioClock->currentFrame + getBlocksize());
+      }
+
       // MIDI source overrides the value set to finishedReading by the input
       // source
       finishedReading = (boolByte)!fillMidiEventsFromRange(
           midiSequence, audioClock->currentFrame, getBlocksize(),
-          midiEventsForBlock);
+          midiEventBuffer);
+
+      if (midiSourceHasEvents) {
+        finishedReading = false;
+      }
+      midiEventsForBlock = linkedListBufferGetList(midiEventBuffer);
       linkedListForeach(midiEventsForBlock, _processMidiMetaEvent,
                         &finishedReading);
+    }
+
+    // The control channel merges its MIDI events with those from the file, so
+    // that each plugin receives the events for the block in a single call
+    if (controlChannel != NULL) {
+      controlChannelProcess(controlChannel, pluginChain, audioClock,
+                            midiEventsForBlock);
+    } else if (midiEventsForBlock != NULL) {
       pluginChainProcessMidi(pluginChain, midiEventsForBlock);
-      freeLinkedList(midiEventsForBlock);
     }
 
     taskTimerStop(inputTimer);
@@ -1066,26 +1564,60 @@ int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
       finishedReading = true;
     }
 
-    pluginChainProcessAudio(pluginChain, inputSampleBuffer, outputSampleBuffer);
+    // The input buffer has been padded to a full block if it was not filled,
+    // and the padding is not written to the output. A render which is driven
+    // by MIDI runs for whole blocks, as the input may end before the events.
+    if (midiSequence != NULL) {
+      inputFramesRead = inputSampleBuffer->blocksize;
+    }
+
+    // Variants are processed on worker threads while the main chain runs here
+    if (fanOut != NULL) {
+      pluginChainFanOutProcess(fanOut, inputSampleBuffer, inputFramesRead,
+                               midiEventsForBlock);
+    }
+
+    pluginChainRendererProcess(renderer, inputSampleBuffer, inputFramesRead);
+
+    // Periodically rewrite the output header so the file is always valid
+    if (syncIntervalInFrames > 0) {
+      framesSinceSync += inputSampleBuffer->blocksize;
+
+      if (framesSinceSync >= syncIntervalInFrames) {
+        taskTimerStart(outputTimer);
+        sampleSourceSync(outputSource);
+        taskTimerStop(outputTimer);
+        framesSinceSync = 0;
+      }
+    }
+
+    if (fanOut != NULL) {
+      pluginChainFanOutWait(fanOut);
+    }
+
+    advanceAudioClock(audioClock, inputSampleBuffer->blocksize);
+  }
+
+  // Run silence through the chain to get out the audio which is still delayed
+  // in it and the chain's tail, so that the output is as long as the input
+  // plus the tail. Variants are flushed in lock-step with the main chain,
+  // each until its own output is complete.
+  while (!pluginChainRendererIsFinished(renderer) ||
+         (fanOut != NULL && !pluginChainFanOutIsFinished(fanOut))) {
+    if (fanOut != NULL) {
+      pluginChainFanOutFlush(fanOut);
+    }
 
-    taskTimerStart(outputTimer);
+    pluginChainRendererFlush(renderer);
 
-    if (finishedReading) {
-      outputSampleBuffer->blocksize =
-          inputSampleBuffer
-              ->blocksize; // The input buffer size has been adjusted.
-      logDebug("Using buffer size of %d for final block",
-               outputSampleBuffer->blocksize);
+    if (fanOut != NULL) {
+      pluginChainFanOutWait(fanOut);
     }
 
-    writeOutput(outputSource, silentSampleOutput, outputSampleBuffer,
-                processingDelayInFrames);
-    taskTimerStop(outputTimer);
-    advanceAudioClock(audioClock, outputSampleBuffer->blocksize);
+    advanceAudioClock(audioClock, getBlocksize());
   }
 
   // Close file handles for input/output sources
-  silentSampleOutput->closeSampleSource(silentSampleOutput);
   inputSource->closeSampleSource(inputSource);
   outputSource->closeSampleSource(outputSource);
 
@@ -1142,15 +1674,18 @@ int mrsWatsonMain(ErrorReporter errorReporter, int argc, char **argv) {
   logInfo("Shutting down");
   freeSampleSource(inputSource);
   freeSampleSource(outputSource);
-  freeSampleSource(silentSampleOutput);
   freeSampleBuffer(inputSampleBuffer);
-  freeSampleBuffer(outputSampleBuffer);
+  freePluginChainRenderer(renderer);
+  freeControlChannel(controlChannel);
   pluginChainShutdown(pluginChain);
   freePluginChain(pluginChain);
+  freePluginChainFanOut(fanOut);
   freeMidiSource(midiSource);
   freeMidiSequence(midiSequence);
+  freeLinkedListBuffer(midiEventBuffer);
 
   freeAudioSettings();
+  setThreadPinning(false);
   logInfo("Goodbye!");
   freeEventLogger();
   freeAudioClock(getAudioClock());
@@ -34,6 +34,27 @@
 ProgramOptions newMrsWatsonOptions(void) {
   ProgramOptions options = newProgramOptions(NUM_OPTIONS);
 
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_BATCH, "batch",
+          "Render many files with the same program instance, as listed in a manifest \
+file. Manifests with a .json extension should contain an array of objects with \
+\"input\", \"output\", and optional \"plugins\" and \"parameters\" members. All \
+other manifests are read as CSV files, where each line has the form \
+INPUT,OUTPUT[,PLUGINS[,PARAMETERS]]. Jobs without plugins use the --plugin chain \
+and --parameter values. Parameters are given as INDEX,VALUE pairs separated by \
+semicolons, which must be quoted in CSV files. Jobs are rendered in parallel with \
+the number of worker threads given by --threads (by default, one per processor), \
+or in separate processes with --processes. \
+Each worker keeps its plugins loaded and resets them between jobs, and files are \
+streamed so that memory use does not depend on their length. Examples:\n\n\
+\tin1.wav,out1.wav\n\
+\tin2.wav,out2.wav,mrs_gain;mrs_limiter,\"0,0.5\"\n\n\
+\t[{\"input\": \"in1.wav\", \"output\": \"out1.wav\", \"parameters\": [\"0,0.5\"]}]",
+          NO_SHORT_FORM, kProgramOptionTypeString,
+          kProgramOptionArgumentTypeRequired));
+
   programOptionsAdd(
       options,
       newProgramOptionWithName(
@@ -55,6 +76,20 @@ multiple of the blocksize, then empty frames will be added to the last block.",
   programOptionsSetNumber(options, OPTION_BLOCKSIZE,
                           (const float)getBlocksize());
 
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_CHANNEL_GROUPS, "channel-groups",
+          "Split the input into groups of channels and process each group with its own \
+copy of the plugin chain, instead of mapping all channels onto the plugins' inputs. \
+The groups are processed in parallel and put back in their original order in the \
+output. The argument may be 'mono', 'stereo', or a comma-separated list of group \
+widths which add up to the number of input channels, for example:\n\n\
+\t--channel-groups 2,2,1,1\n\n\
+Parameters set with --parameter are applied to the first plugin of each group.",
+          NO_SHORT_FORM, kProgramOptionTypeString,
+          kProgramOptionArgumentTypeRequired));
+
   programOptionsAdd(
       options,
       newProgramOptionWithName(
@@ -98,6 +133,19 @@ like so:\n\n\
           NO_SHORT_FORM, kProgramOptionTypeEmpty,
           kProgramOptionArgumentTypeRequired));
 
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_CONTROL, "control",
+          "Accept parameter changes and MIDI events while processing. If <argument> \
+is a named pipe, commands are read from it, and otherwise a Unix domain socket \
+is created there. Commands are sent one per line, either 'param <plugin> \
+<parameter> <value>' or 'midi <plugin> <status> <data1> [data2]', where <plugin> \
+is the index of the plugin in the chain. Commands are applied at the start of \
+the next block. This option is not supported on Windows.",
+          NO_SHORT_FORM, kProgramOptionTypeString,
+          kProgramOptionArgumentTypeRequired));
+
   programOptionsAdd(options,
                     newProgramOptionWithName(
                         OPTION_DISPLAY_INFO, "display-info",
@@ -160,6 +208,23 @@ the extension. Run with --list-file-types to see a list of supported types. Use
           HAS_SHORT_FORM, kProgramOptionTypeString,
           kProgramOptionArgumentTypeRequired));
 
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_JACK, "jack",
+          "Run as a JACK client named [argument], processing the client's input \
+ports and MIDI port live and sending the result to its output ports. The sample \
+rate and blocksize are taken from the JACK server, and the ports are connected \
+to the system's physical ports. If --input is given, the file is played instead \
+of the input ports, and if --output is given, the output is also recorded to it. \
+Processing stops when the input file ends, after --max-time, or on Ctrl-C. \
+Plugin groups and --pipeline synchronize threads for each block and should not \
+be used with small JACK buffer sizes. Only available in builds with JACK \
+support.",
+          NO_SHORT_FORM, kProgramOptionTypeString,
+          kProgramOptionArgumentTypeOptional));
+  programOptionsSetCString(options, OPTION_JACK, "mrswatson");
+
   programOptionsAdd(options, newProgramOptionWithName(
                                  OPTION_LIST_PLUGINS, "list-plugins",
                                  "List available plugins. Useful for "
@@ -194,12 +259,18 @@ input source length. Mostly useful when using internal plugins as sources.",
           NO_SHORT_FORM, kProgramOptionTypeNumber,
           kProgramOptionArgumentTypeRequired));
 
-  programOptionsAdd(options, newProgramOptionWithName(
-                                 OPTION_MIDI_SOURCE, "midi-file",
-                                 "MIDI file to read events from. Required if "
-                                 "processing an instrument plugin.",
-                                 HAS_SHORT_FORM, kProgramOptionTypeString,
-                                 kProgramOptionArgumentTypeRequired));
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_MIDI_SOURCE, "midi-file",
+          "MIDI file to read events from. Required if processing an instrument \
+plugin. Use '-' to read from stdin, or give the path of a named pipe or Unix \
+socket to receive events while processing. Streams may either contain a type 0 \
+MIDI file, in which case processing waits for events which have not yet \
+arrived, or raw MIDI bytes, which are played in the next block after they \
+arrive. Raw streams should usually be used with --realtime.",
+          HAS_SHORT_FORM, kProgramOptionTypeString,
+          kProgramOptionArgumentTypeRequired));
 
   programOptionsAdd(
       options,
@@ -212,6 +283,17 @@ Use '-' to write to stdout..",
           kProgramOptionArgumentTypeOptional));
           programOptionsSetCString(options, OPTION_OUTPUT_SOURCE, "output.wav");
 
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_OVERLAP, "overlap",
+          "Length in ms of the crossfade between segments rendered with \
+--segment-parallel. Each segment renders this far past its end, and the overlap \
+is faded into the start of the next segment. If zero, the segments are simply \
+cut at their boundaries. Default value: 0.",
+          NO_SHORT_FORM, kProgramOptionTypeNumber,
+          kProgramOptionArgumentTypeRequired));
+
   programOptionsAdd(
       options,
       newProgramOptionWithName(
@@ -224,6 +306,34 @@ index/value, for example:\n\n\
           NO_SHORT_FORM, kProgramOptionTypeList,
           kProgramOptionArgumentTypeRequired));
 
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_PIN_THREADS, "pin-threads",
+          "Pin the processing thread and all worker threads to processors, based on \
+the layout of cores, caches and NUMA nodes of the system. Threads which pass audio \
+to each other every block, such as --pipeline stages and plugin group branches, \
+are kept on cores which share a cache, while threads which render independent \
+streams, such as --batch jobs and --segment-parallel segments, are spread over \
+as many caches and NUMA nodes as possible. This reduces jitter on busy or \
+multi-socket hosts, but should only be used when MrsWatson has the machine to \
+itself.",
+          NO_SHORT_FORM, kProgramOptionTypeEmpty,
+          kProgramOptionArgumentTypeNone));
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_PIPELINE, "pipeline",
+          "Process the plugin chain in a pipeline of <argument> stages, each of which \
+runs on its own thread. Consecutive plugins are grouped into stages of roughly \
+equal cost, and the number of stages is limited to the number of plugins. This \
+can make offline rendering of chains with several expensive plugins much faster, \
+at the cost of one block of added latency per stage, which is removed from the \
+output. Cannot be combined with --realtime.",
+          NO_SHORT_FORM, kProgramOptionTypeNumber,
+          kProgramOptionArgumentTypeRequired));
+
   programOptionsAdd(
       options,
       newProgramOptionWithName(
@@ -238,11 +348,20 @@ for the OS. File extensions are added automatically to plugin names. Each plugin
 may be followed by a comma with a program to be loaded, which should be of the \
 corresponding file format for the respective plugin. For shell plugins (like \
 Waves), use --display-info to get a list of sub-plugin ID's and then use a colon \
-to indicate which plugin to load. Examples:\n\n\
+to indicate which plugin to load. Plugins starting with '@' are hosted in a \
+separate worker process, so that a crash in the plugin does not stop the rest \
+of the program (not supported on Windows). Plugin chains in square brackets \
+which are separated by '|' are processed in parallel on separate threads, and \
+their outputs are summed. Such groups may appear anywhere in the chain and may \
+be nested, and branches are delayed as needed so that their processing delays \
+line up. Examples:\n\n\
 \t--plugin LFX-1310\n\
 \t--plugin 'AutoTune,KayneWest.fxp;Compressor,SoftKnee.fxp;Limiter'\n\
 \t--plugin 'WavesShell-VST' --display-info (list shell sub-plugins)\n\
-\t--plugin 'WavesShell-VST:IDFX' (load a shell plugins)",
+\t--plugin 'WavesShell-VST:IDFX' (load a shell plugins)\n\
+\t--plugin '@UnstableSynth,Bass.fxp;Limiter' (isolate the first plugin)\n\
+\t--plugin 'EQ;[Compressor,Heavy.fxp|mrs_passthru];Limiter' (parallel \
+compression)",
           HAS_SHORT_FORM, kProgramOptionTypeString,
           kProgramOptionArgumentTypeRequired));
 
@@ -255,6 +374,19 @@ to indicate which plugin to load. Examples:\n\n\
           NO_SHORT_FORM, kProgramOptionTypeString,
           kProgramOptionArgumentTypeRequired));
 
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_PROCESSES, "processes",
+          "Render --batch jobs in up to <argument> worker processes instead of \
+threads. The plugins for each job are loaded once by the main process, and each \
+job is then rendered by a forked copy of it which shares the loaded plugins. \
+This allows plugins which are not safe to load more than once per process to \
+render in parallel, and a plugin crash only fails the job it was rendering. \
+This option is not supported on Windows.",
+          NO_SHORT_FORM, kProgramOptionTypeNumber,
+          kProgramOptionArgumentTypeRequired));
+
   programOptionsAdd(
       options, newProgramOptionWithName(OPTION_QUIET, "quiet",
                                         "Only log critical errors.",
@@ -265,9 +397,25 @@ to indicate which plugin to load. Examples:\n\n\
       options,
       newProgramOptionWithName(
           OPTION_REALTIME, "realtime",
-          "Simulate running in realtime by sleeping for any remaining time needed to process \
-the given block. Some plugins which are unable to do offline rendering may require this \
-option in order to function properly.",
+          "Simulate running in realtime by processing each block at the time an audio \
+device would need it, based on the sample rate and blocksize. Memory is locked \
+into RAM before processing starts. Blocks which miss their deadline are logged, \
+and the number of misses, the worst lateness and a histogram of the time left \
+before each deadline are printed at exit. This can be used to check whether a \
+chain is safe for live use, together with --realtime-priority. Some plugins \
+which are unable to do offline rendering may also require this option in order \
+to function properly.",
+          NO_SHORT_FORM, kProgramOptionTypeEmpty,
+          kProgramOptionArgumentTypeNone));
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_REALTIME_PRIORITY, "realtime-priority",
+          "Run the processing thread with realtime scheduling (SCHED_FIFO), so that \
+it is not interrupted by other programs. On Linux, this requires the CAP_SYS_NICE \
+capability or a realtime priority limit in /etc/security/limits.conf, and a \
+warning is logged if it is not allowed.",
           NO_SHORT_FORM, kProgramOptionTypeEmpty,
           kProgramOptionArgumentTypeNone));
 
@@ -284,6 +432,55 @@ using unusual sample rates will probably result in weird behavior from plugins."
   programOptionsSetNumber(options, OPTION_SAMPLE_RATE,
                           (const float)getSampleRate());
 
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_SEGMENT_LENGTH, "segment-length",
+          "Split the output into several files, each of which is <argument> ms long. \
+Each segment is closed as soon as the next one is started, so they can be consumed \
+while processing continues. The output source name may contain a printf-style integer \
+such as 'out_%05d.wav', otherwise the segment number is inserted before the file \
+extension.",
+          NO_SHORT_FORM, kProgramOptionTypeNumber,
+          kProgramOptionArgumentTypeRequired));
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_SEGMENT_PARALLEL, "segment-parallel",
+          "Split the input into <argument> segments of the same length and render \
+them at the same time, each in its own thread with its own copy of the plugin \
+chain. Each segment starts rendering early by the --overlap time plus the longest \
+tail time of the chain, so that the plugins have settled when the segment starts. \
+This is only suitable for plugins without long-term state, and the input must be \
+a file rather than stdin.",
+          NO_SHORT_FORM, kProgramOptionTypeNumber,
+          kProgramOptionArgumentTypeRequired));
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_SERVE, "serve",
+          "Run as a render server which listens for jobs on the Unix domain socket \
+at <argument>. Plugin chains are kept loaded between jobs and reset before each \
+one, so that only the first job using a chain pays the cost of loading it. Each \
+request is a single line in the same format as a CSV --batch manifest, and the \
+server replies with 'OK <frames>' or 'ERROR <message>'. Jobs without plugins use \
+the --plugin chain and --parameter values. Send 'shutdown' to stop the server. \
+This option is not supported on Windows.",
+          NO_SHORT_FORM, kProgramOptionTypeString,
+          kProgramOptionArgumentTypeRequired));
+
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_SYNC_INTERVAL, "sync-interval",
+          "Rewrite the output file header and flush the output to disk every <argument> ms \
+of audio. This allows other programs to read the output file while it is still being \
+written.",
+          NO_SHORT_FORM, kProgramOptionTypeNumber,
+          kProgramOptionArgumentTypeRequired));
+
   programOptionsAdd(
       options, newProgramOptionWithName(OPTION_TEMPO, "tempo",
                                         "Tempo to use when processing.",
@@ -291,6 +488,16 @@ using unusual sample rates will probably result in weird behavior from plugins."
                                         kProgramOptionArgumentTypeRequired));
   programOptionsSetNumber(options, OPTION_TEMPO, (float)getTempo());
 
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_THREADS, "threads",
+          "Number of worker threads used to render --variant chains or --batch jobs. \
+By default, one thread is used for each variant, and one thread per processor is \
+used for batch jobs.",
+          NO_SHORT_FORM, kProgramOptionTypeNumber,
+          kProgramOptionArgumentTypeRequired));
+
   programOptionsAdd(
       options, newProgramOptionWithName(OPTION_TIME_SIGNATURE, "time-signature",
                                         "Set the global time signature. Should "
@@ -302,6 +509,22 @@ using unusual sample rates will probably result in weird behavior from plugins."
   // hardcoded string is also relatively safe.
   programOptionsSetCString(options, OPTION_TIME_SIGNATURE, "4/4");
 
+  programOptionsAdd(
+      options,
+      newProgramOptionWithName(
+          OPTION_VARIANT, "variant",
+          "Also render the input through another plugin chain, writing the result to a \
+separate output file. May be specified multiple times. The input is only read once, \
+and all variants are processed in parallel alongside the main --plugin chain. \
+Variants are given as OUTPUT[=PLUGINS][@INDEX,VALUE...], where PLUGINS has the same \
+format as --plugin and defaults to the main chain, and each INDEX,VALUE pair sets a \
+parameter on the first plugin. Any --parameter options are also applied to variants \
+which use the main chain. Examples:\n\n\
+\t--plugin mrs_gain --variant 'quiet.wav@0,0.2' --variant 'loud.wav@0,0.9'\n\
+\t--variant 'limited.wav=mrs_gain;mrs_limiter'",
+          NO_SHORT_FORM, kProgramOptionTypeList,
+          kProgramOptionArgumentTypeRequired));
+
   programOptionsAdd(
       options,
       newProgramOptionWithName(
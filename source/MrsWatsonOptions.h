@@ -31,18 +31,22 @@
 
 // Runtime options
 typedef enum {
+  OPTION_BATCH,
   OPTION_BIT_DEPTH,
   OPTION_BLOCKSIZE,
+  OPTION_CHANNEL_GROUPS,
   OPTION_CHANNELS,
   OPTION_COLOR_LOGGING,
   OPTION_COLOR_TEST,
   OPTION_CONFIG_FILE,
+  OPTION_CONTROL,
   OPTION_DISPLAY_INFO,
   OPTION_EDITOR,
   OPTION_ENDIAN,
   OPTION_ERROR_REPORT,
   OPTION_HELP,
   OPTION_INPUT_SOURCE,
+  OPTION_JACK,
   OPTION_LIST_FILE_TYPES,
   OPTION_LIST_PLUGINS,
   OPTION_LOG_FILE,
@@ -50,14 +54,25 @@ typedef enum {
   OPTION_MAX_TIME,
   OPTION_MIDI_SOURCE,
   OPTION_OUTPUT_SOURCE,
+  OPTION_OVERLAP,
   OPTION_PARAMETER,
+  OPTION_PIN_THREADS,
+  OPTION_PIPELINE,
   OPTION_PLUGIN,
   OPTION_PLUGIN_ROOT,
+  OPTION_PROCESSES,
   OPTION_QUIET,
   OPTION_REALTIME,
+  OPTION_REALTIME_PRIORITY,
   OPTION_SAMPLE_RATE,
+  OPTION_SEGMENT_LENGTH,
+  OPTION_SEGMENT_PARALLEL,
+  OPTION_SERVE,
+  OPTION_SYNC_INTERVAL,
   OPTION_TEMPO,
+  OPTION_THREADS,
   OPTION_TIME_SIGNATURE,
+  OPTION_VARIANT,
   OPTION_VERBOSE,
   OPTION_VERSION,
   OPTION_ZEBRA_SIZE,
@@ -0,0 +1,871 @@
+//
+// BatchRenderer.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "BatchRenderer.h"
+
+#include "base/File.h"
+#include "base/TaskScheduler.h"
+#include "logging/EventLogger.h"
+#include "time/TaskTimer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if UNIX
+#include <errno.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+BatchRenderer newBatchRenderer(void) {
+  BatchRenderer renderer = (BatchRenderer)malloc(sizeof(BatchRendererMembers));
+
+  renderer->jobs = NULL;
+  renderer->numJobs = 0;
+  renderer->numJobsFailed = 0;
+
+  renderer->_pluginLoadMutex = newMutex();
+
+  return renderer;
+}
+
+boolByte batchRendererAddJob(BatchRenderer self, const char *inputName,
+                             const char *outputName, const char *plugins,
+                             const char *parameters) {
+  RenderJob *jobs;
+
+  if (inputName == NULL || *inputName == '\0') {
+    logError("Batch job %d has no input file", self->numJobs + 1);
+    return false;
+  } else if (outputName == NULL || *outputName == '\0') {
+    logError("Batch job %d has no output file", self->numJobs + 1);
+    return false;
+  }
+
+  jobs = (RenderJob *)realloc(self->jobs,
+                              sizeof(RenderJob) * (self->numJobs + 1));
+
+  if (jobs == NULL) {
+    return false;
+  }
+
+  self->jobs = jobs;
+  self->jobs[self->numJobs] =
+      newRenderJob(inputName, outputName, plugins, parameters);
+  self->numJobs++;
+  return true;
+}
+
+static boolByte _addJobFromRecord(BatchRenderer self, LinkedList fields,
+                                  unsigned int lineNumber,
+                                  boolByte isFirstRecord) {
+  int numFields = linkedListLength(fields);
+  CharString *items;
+  boolByte result = true;
+
+  if (numFields == 0) {
+    return true;
+  }
+
+  items = (CharString *)linkedListToArray(fields);
+
+  if (numFields == 1 && charStringIsEmpty(items[0])) {
+    // Blank line
+  } else if (isFirstRecord &&
+             charStringIsEqualToCString(items[0], "input", true)) {
+    // Header row
+  } else if (numFields < 2 || numFields > 4) {
+    logError("Manifest line %d has %d fields, expected between 2 and 4",
+             lineNumber, numFields);
+    result = false;
+  } else {
+    result = batchRendererAddJob(self, items[0]->data, items[1]->data,
+                                 numFields > 2 ? items[2]->data : NULL,
+                                 numFields > 3 ? items[3]->data : NULL);
+  }
+
+  free(items);
+  return result;
+}
+
+boolByte batchRendererParseCsv(BatchRenderer self, const char *contents) {
+  const char *c = contents;
+  char *field = (char *)malloc(strlen(contents) + 1);
+  size_t fieldLength = 0;
+  LinkedList fields = newLinkedList();
+  unsigned int lineNumber = 1;
+  unsigned int recordLineNumber = 1;
+  boolByte isFirstRecord = true;
+  boolByte atRecordStart = true;
+  boolByte quoted = false;
+  boolByte result = true;
+
+  while (result) {
+    if (quoted) {
+      if (*c == '\0') {
+        logError("Unterminated quote in manifest line %d", recordLineNumber);
+        result = false;
+      } else if (*c == '"' && c[1] == '"') {
+        field[fieldLength++] = '"';
+        c += 2;
+      } else if (*c == '"') {
+        quoted = false;
+        c++;
+      } else {
+        if (*c == '\n') {
+          lineNumber++;
+        }
+
+        field[fieldLength++] = *c++;
+      }
+    } else if (atRecordStart && *c == '#') {
+      while (*c != '\n' && *c != '\0') {
+        c++;
+      }
+    } else if (*c == '"') {
+      quoted = true;
+      atRecordStart = false;
+      c++;
+    } else if (*c == ',' || *c == '\n' || *c == '\0') {
+      field[fieldLength] = '\0';
+      linkedListAppend(fields, newCharStringWithCString(field));
+      fieldLength = 0;
+
+      if (*c == ',') {
+        atRecordStart = false;
+        c++;
+        continue;
+      }
+
+      result = _addJobFromRecord(self, fields, recordLineNumber, isFirstRecord);
+
+      if (linkedListLength(fields) > 1 ||
+          !charStringIsEmpty((CharString)fields->item)) {
+        isFirstRecord = false;
+      }
+
+      freeLinkedListAndItems(fields, (LinkedListFreeItemFunc)freeCharString);
+      fields = newLinkedList();
+
+      if (*c == '\0') {
+        break;
+      }
+
+      c++;
+      recordLineNumber = ++lineNumber;
+      atRecordStart = true;
+    } else if (*c == '\r') {
+      c++;
+    } else {
+      field[fieldLength++] = *c++;
+      atRecordStart = false;
+    }
+  }
+
+  freeLinkedListAndItems(fields, (LinkedListFreeItemFunc)freeCharString);
+  free(field);
+  return result;
+}
+
+// A minimal JSON reader, which only supports what is needed for manifests
+typedef struct {
+  const char *c;
+} _JsonReader;
+
+static void _jsonSkipWhitespace(_JsonReader *reader) {
+  while (*reader->c == ' ' || *reader->c == '\t' || *reader->c == '\n' ||
+         *reader->c == '\r') {
+    reader->c++;
+  }
+}
+
+static boolByte _jsonExpect(_JsonReader *reader, char expected) {
+  _jsonSkipWhitespace(reader);
+
+  if (*reader->c != expected) {
+    logError("Malformed JSON manifest, expected '%c' at '%.20s'", expected,
+             reader->c);
+    return false;
+  }
+
+  reader->c++;
+  return true;
+}
+
+static CharString _jsonReadString(_JsonReader *reader) {
+  const char *end;
+  char *buffer;
+  size_t length = 0;
+  unsigned int codePoint;
+  CharString result;
+
+  if (!_jsonExpect(reader, '"')) {
+    return NULL;
+  }
+
+  // Find the end of the string first, escapes only ever shrink the result
+  for (end = reader->c; *end != '"'; end++) {
+    if (*end == '\0' || (*end == '\\' && *++end == '\0')) {
+      logError("Unterminated string in JSON manifest");
+      return NULL;
+    }
+  }
+
+  buffer = (char *)malloc((size_t)(end - reader->c) + 1);
+
+  while (reader->c < end) {
+    if (*reader->c != '\\') {
+      buffer[length++] = *reader->c++;
+      continue;
+    }
+
+    reader->c++;
+
+    switch (*reader->c++) {
+    case 'b':
+      buffer[length++] = '\b';
+      break;
+
+    case 'f':
+      buffer[length++] = '\f';
+      break;
+
+    case 'n':
+      buffer[length++] = '\n';
+      break;
+
+    case 'r':
+      buffer[length++] = '\r';
+      break;
+
+    case 't':
+      buffer[length++] = '\t';
+      break;
+
+    case 'u':
+      if (end - reader->c < 4 || sscanf(reader->c, "%4x", &codePoint) != 1) {
+        logError("Invalid unicode escape in JSON manifest");
+        free(buffer);
+        return NULL;
+      }
+
+      reader->c += 4;
+
+      // Encode as UTF-8, surrogate pairs are not combined
+      if (codePoint < 0x80) {
+        buffer[length++] = (char)codePoint;
+      } else if (codePoint < 0x800) {
+        buffer[length++] = (char)(0xc0 | (codePoint >> 6));
+        buffer[length++] = (char)(0x80 | (codePoint & 0x3f));
+      } else {
+        buffer[length++] = (char)(0xe0 | (codePoint >> 12));
+        buffer[length++] = (char)(0x80 | ((codePoint >> 6) & 0x3f));
+        buffer[length++] = (char)(0x80 | (codePoint & 0x3f));
+      }
+
+      break;
+
+    default:
+      // Covers '"', '\\' and '/'
+      buffer[length++] = reader->c[-1];
+      break;
+    }
+  }
+
+  buffer[length] = '\0';
+  reader->c = end + 1;
+  result = newCharStringWithCString(buffer);
+  free(buffer);
+  return result;
+}
+
+static boolByte _jsonSkipValue(_JsonReader *reader) {
+  CharString string;
+  char closing;
+
+  _jsonSkipWhitespace(reader);
+
+  if (*reader->c == '"') {
+    string = _jsonReadString(reader);
+    freeCharString(string);
+    return (boolByte)(string != NULL);
+  } else if (*reader->c == '[' || *reader->c == '{') {
+    closing = (char)(*reader->c == '[' ? ']' : '}');
+    reader->c++;
+    _jsonSkipWhitespace(reader);
+
+    if (*reader->c == closing) {
+      reader->c++;
+      return true;
+    }
+
+    while (true) {
+      if (closing == '}' && (!_jsonSkipValue(reader) ||
+                             !_jsonExpect(reader, ':'))) {
+        return false;
+      }
+
+      if (!_jsonSkipValue(reader)) {
+        return false;
+      }
+
+      _jsonSkipWhitespace(reader);
+
+      if (*reader->c == ',') {
+        reader->c++;
+      } else {
+        return _jsonExpect(reader, closing);
+      }
+    }
+  } else {
+    // Numbers, true, false and null
+    const char *start = reader->c;
+
+    while ((*reader->c >= 'a' && *reader->c <= 'z') ||
+           (*reader->c >= '0' && *reader->c <= '9') || *reader->c == '-' ||
+           *reader->c == '+' || *reader->c == '.' || *reader->c == 'E') {
+      reader->c++;
+    }
+
+    if (reader->c == start) {
+      logError("Malformed JSON manifest, unexpected value at '%.20s'", start);
+      return false;
+    }
+
+    return true;
+  }
+}
+
+static boolByte _jsonReadParameters(_JsonReader *reader, CharString out) {
+  CharString parameter;
+  char separator[2] = {RENDER_JOB_PARAMETER_SEPARATOR, '\0'};
+
+  _jsonSkipWhitespace(reader);
+
+  if (*reader->c == '"') {
+    parameter = _jsonReadString(reader);
+
+    if (parameter == NULL) {
+      return false;
+    }
+
+    charStringClear(out);
+    charStringAppend(out, parameter);
+    freeCharString(parameter);
+    return true;
+  }
+
+  if (!_jsonExpect(reader, '[')) {
+    return false;
+  }
+
+  _jsonSkipWhitespace(reader);
+
+  if (*reader->c == ']') {
+    reader->c++;
+    return true;
+  }
+
+  while (true) {
+    parameter = _jsonReadString(reader);
+
+    if (parameter == NULL) {
+      return false;
+    }
+
+    if (!charStringIsEmpty(out)) {
+      charStringAppendCString(out, separator);
+    }
+
+    charStringAppend(out, parameter);
+    freeCharString(parameter);
+    _jsonSkipWhitespace(reader);
+
+    if (*reader->c == ',') {
+      reader->c++;
+    } else {
+      return _jsonExpect(reader, ']');
+    }
+  }
+}
+
+static boolByte _jsonReadJob(BatchRenderer self, _JsonReader *reader) {
+  CharString key = NULL;
+  CharString inputName = newCharString();
+  CharString outputName = newCharString();
+  CharString plugins = newCharString();
+  CharString parameters = newCharString();
+  CharString value;
+  boolByte result = _jsonExpect(reader, '{');
+
+  _jsonSkipWhitespace(reader);
+
+  if (result && *reader->c == '}') {
+    reader->c++;
+  } else {
+    while (result) {
+      key = _jsonReadString(reader);
+      result = (boolByte)(key != NULL && _jsonExpect(reader, ':'));
+
+      if (!result) {
+        break;
+      }
+
+      if (charStringIsEqualToCString(key, "parameters", false)) {
+        result = _jsonReadParameters(reader, parameters);
+      } else if (charStringIsEqualToCString(key, "input", false) ||
+                 charStringIsEqualToCString(key, "output", false) ||
+                 charStringIsEqualToCString(key, "plugins", false)) {
+        value = _jsonReadString(reader);
+        result = (boolByte)(value != NULL);
+
+        if (!result) {
+          // Already logged
+        } else if (key->data[0] == 'i') {
+          freeCharString(inputName);
+          inputName = value;
+        } else if (key->data[0] == 'o') {
+          freeCharString(outputName);
+          outputName = value;
+        } else {
+          freeCharString(plugins);
+          plugins = value;
+        }
+      } else {
+        logDebug("Ignoring unknown manifest key '%s'", key->data);
+        result = _jsonSkipValue(reader);
+      }
+
+      freeCharString(key);
+      key = NULL;
+      _jsonSkipWhitespace(reader);
+
+      if (!result) {
+        break;
+      } else if (*reader->c == ',') {
+        reader->c++;
+      } else {
+        result = _jsonExpect(reader, '}');
+        break;
+      }
+    }
+  }
+
+  if (result) {
+    result = batchRendererAddJob(self, inputName->data, outputName->data,
+                                 plugins->data, parameters->data);
+  }
+
+  freeCharString(key);
+  freeCharString(inputName);
+  freeCharString(outputName);
+  freeCharString(plugins);
+  freeCharString(parameters);
+  return result;
+}
+
+boolByte batchRendererParseJson(BatchRenderer self, const char *contents) {
+  _JsonReader reader;
+
+  reader.c = contents;
+
+  if (!_jsonExpect(&reader, '[')) {
+    return false;
+  }
+
+  _jsonSkipWhitespace(&reader);
+
+  if (*reader.c != ']') {
+    while (true) {
+      if (!_jsonReadJob(self, &reader)) {
+        return false;
+      }
+
+      _jsonSkipWhitespace(&reader);
+
+      if (*reader.c == ',') {
+        reader.c++;
+      } else {
+        break;
+      }
+    }
+  }
+
+  if (!_jsonExpect(&reader, ']')) {
+    return false;
+  }
+
+  _jsonSkipWhitespace(&reader);
+
+  if (*reader.c != '\0') {
+    logError("Unexpected data after end of JSON manifest");
+    return false;
+  }
+
+  return true;
+}
+
+boolByte batchRendererReadManifest(BatchRenderer self,
+                                   const CharString manifestPath) {
+  File manifestFile = newFileWithPath(manifestPath);
+  CharString extension = fileGetExtension(manifestFile);
+  CharString contents = fileReadContents(manifestFile);
+  boolByte result = false;
+
+  if (contents == NULL) {
+    logError("Could not read batch manifest '%s'", manifestPath->data);
+  } else if (extension != NULL &&
+             charStringIsEqualToCString(extension, "json", true)) {
+    result = batchRendererParseJson(self, contents->data);
+  } else {
+    result = batchRendererParseCsv(self, contents->data);
+  }
+
+  if (result && self->numJobs == 0) {
+    logError("Batch manifest '%s' does not contain any jobs",
+             manifestPath->data);
+    result = false;
+  }
+
+  freeCharString(contents);
+  freeCharString(extension);
+  freeFile(manifestFile);
+  return result;
+}
+
+typedef struct {
+  RenderJob job;
+  TaskScheduler scheduler;
+  // One worker for each thread of the scheduler, indexed by
+  // taskSchedulerGetThreadIndex()
+  RenderWorker *renderWorkers;
+  boolByte succeeded;
+} _BatchRendererTaskData;
+
+static void _renderJobTask(void *userData) {
+  _BatchRendererTaskData *taskData = (_BatchRendererTaskData *)userData;
+  RenderWorker renderWorker =
+      taskData->renderWorkers[taskSchedulerGetThreadIndex(taskData->scheduler)];
+
+  taskData->succeeded = renderWorkerRender(renderWorker, taskData->job);
+
+  if (!taskData->succeeded) {
+    logError("Failed rendering '%s'", taskData->job->inputName->data);
+  }
+}
+
+ReturnCode batchRendererRun(BatchRenderer self, const CharString defaultPlugins,
+                            const LinkedList defaultParameters,
+                            const CharString pluginSearchRoot,
+                            unsigned int numWorkers) {
+  _BatchRendererTaskData *taskData;
+  RenderWorker *renderWorkers;
+  TaskScheduler scheduler;
+  TaskGroup group;
+  unsigned int i;
+
+  if (self->numJobs == 0) {
+    logWarn("No batch jobs to render");
+    return RETURN_CODE_NOT_RUN;
+  }
+
+  self->numJobsFailed = 0;
+
+  if (numWorkers == 0) {
+    numWorkers = 1;
+  } else if (numWorkers > self->numJobs) {
+    numWorkers = self->numJobs;
+  }
+
+  // Each worker only keeps one chain loaded, since most manifests will use
+  // the same chain for all jobs
+  renderWorkers = (RenderWorker *)malloc(sizeof(RenderWorker) * numWorkers);
+
+  for (i = 0; i < numWorkers; i++) {
+    renderWorkers[i] =
+        newRenderWorker(defaultPlugins, defaultParameters, pluginSearchRoot, 1,
+                        self->_pluginLoadMutex);
+  }
+
+  logInfo("Rendering %d jobs with %d worker threads", self->numJobs,
+          numWorkers);
+
+  // The calling thread renders jobs along with the other workers while it
+  // waits for the group, so it uses the first render worker
+  scheduler = newTaskScheduler(numWorkers - 1, THREAD_PLACEMENT_SPREAD);
+  group = newTaskGroup(scheduler);
+  taskData = (_BatchRendererTaskData *)malloc(sizeof(_BatchRendererTaskData) *
+                                              self->numJobs);
+
+  for (i = 0; i < self->numJobs; i++) {
+    taskData[i].job = self->jobs[i];
+    taskData[i].scheduler = scheduler;
+    taskData[i].renderWorkers = renderWorkers;
+    taskData[i].succeeded = false;
+    taskGroupRun(group, _renderJobTask, &taskData[i]);
+  }
+
+  freeTaskGroup(group);
+  freeTaskScheduler(scheduler);
+
+  for (i = 0; i < self->numJobs; i++) {
+    if (!taskData[i].succeeded) {
+      self->numJobsFailed++;
+    }
+  }
+
+  for (i = 0; i < numWorkers; i++) {
+    freeRenderWorker(renderWorkers[i]);
+  }
+
+  free(taskData);
+  free(renderWorkers);
+
+  logInfo("Rendered %d of %d jobs", self->numJobs - self->numJobsFailed,
+          self->numJobs);
+  return self->numJobsFailed == 0 ? RETURN_CODE_SUCCESS : RETURN_CODE_IO_ERROR;
+}
+
+#if UNIX
+// Sent from a forked worker to the parent over a pipe when its job finishes
+typedef struct {
+  unsigned long numFramesWritten;
+  double cpuTime;
+} _BatchRendererForkedResult;
+
+typedef struct {
+  pid_t pid;
+  int resultPipe;
+  unsigned int jobIndex;
+  TaskTimer timer;
+} _BatchRendererProcess;
+
+static void _runForkedJob(RenderWorker renderWorker, RenderJob job,
+                          int resultPipe) {
+  _BatchRendererForkedResult result;
+  struct rusage usage;
+  boolByte success = renderWorkerRender(renderWorker, job);
+
+  result.numFramesWritten = job->numFramesWritten;
+  result.cpuTime = 0.0;
+
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+    result.cpuTime = (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000.0 +
+                     (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000.0;
+  }
+
+  if (write(resultPipe, &result, sizeof(result)) != sizeof(result)) {
+    success = false;
+  }
+
+  // The plugins and files belong to the parent, so the worker exits without
+  // closing them or running any atexit handlers
+  _exit(success ? 0 : 1);
+}
+
+static boolByte _forkJob(BatchRenderer self, RenderWorker renderWorker,
+                         unsigned int jobIndex,
+                         _BatchRendererProcess *process) {
+  int resultPipe[2];
+
+  if (pipe(resultPipe) != 0) {
+    logError("Could not create pipe for job %d, %s", jobIndex + 1,
+             stringForLastError(errno));
+    return false;
+  }
+
+  // Anything still buffered would otherwise be written by both processes
+  fflush(NULL);
+  process->pid = fork();
+
+  if (process->pid == 0) {
+    close(resultPipe[0]);
+    _runForkedJob(renderWorker, self->jobs[jobIndex], resultPipe[1]);
+  } else if (process->pid < 0) {
+    logError("Could not fork worker for job %d, %s", jobIndex + 1,
+             stringForLastError(errno));
+    close(resultPipe[0]);
+    close(resultPipe[1]);
+    return false;
+  }
+
+  close(resultPipe[1]);
+  process->resultPipe = resultPipe[0];
+  process->jobIndex = jobIndex;
+  process->timer = newTaskTimerWithCString("Batch", "Job");
+  taskTimerStart(process->timer);
+  return true;
+}
+
+static void _reapForkedJob(BatchRenderer self,
+                           _BatchRendererProcess *processes,
+                           unsigned int *numProcesses) {
+  _BatchRendererForkedResult result;
+  _BatchRendererProcess *process = NULL;
+  RenderJob job;
+  boolByte success = false;
+  double renderTime;
+  pid_t pid;
+  int status;
+  unsigned int i;
+
+  while (process == NULL) {
+    pid = waitpid(-1, &status, 0);
+
+    if (pid < 0 && errno == EINTR) {
+      continue;
+    } else if (pid < 0) {
+      logInternalError("Lost track of %d batch workers", *numProcesses);
+
+      for (i = 0; i < *numProcesses; i++) {
+        close(processes[i].resultPipe);
+        freeTaskTimer(processes[i].timer);
+        self->numJobsFailed++;
+      }
+
+      *numProcesses = 0;
+      return;
+    }
+
+    for (i = 0; i < *numProcesses; i++) {
+      if (processes[i].pid == pid) {
+        process = &processes[i];
+        break;
+      }
+    }
+  }
+
+  job = self->jobs[process->jobIndex];
+  renderTime = taskTimerStop(process->timer);
+
+  if (read(process->resultPipe, &result, sizeof(result)) == sizeof(result)) {
+    job->numFramesWritten = result.numFramesWritten;
+    success = (boolByte)(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  }
+
+  if (success) {
+    logInfo("Job %d finished in %.0fms (%.0fms CPU), wrote %ld frames to '%s'",
+            process->jobIndex + 1, renderTime, result.cpuTime,
+            job->numFramesWritten, job->outputName->data);
+  } else if (WIFSIGNALED(status)) {
+    logError("Worker for job %d ('%s') was killed by signal %d",
+             process->jobIndex + 1, job->inputName->data, WTERMSIG(status));
+  } else {
+    logError("Job %d ('%s') failed", process->jobIndex + 1,
+             job->inputName->data);
+  }
+
+  if (!success) {
+    self->numJobsFailed++;
+  }
+
+  close(process->resultPipe);
+  freeTaskTimer(process->timer);
+  *process = processes[--(*numProcesses)];
+}
+#endif
+
+ReturnCode batchRendererRunForked(BatchRenderer self,
+                                  const CharString defaultPlugins,
+                                  const LinkedList defaultParameters,
+                                  const CharString pluginSearchRoot,
+                                  unsigned int maxProcesses) {
+#if UNIX
+  RenderWorker renderWorker;
+  _BatchRendererProcess *processes;
+  unsigned int numProcesses = 0;
+  unsigned int i;
+
+  if (self->numJobs == 0) {
+    logWarn("No batch jobs to render");
+    return RETURN_CODE_NOT_RUN;
+  }
+
+  self->numJobsFailed = 0;
+
+  if (maxProcesses == 0) {
+    maxProcesses = 1;
+  }
+
+  renderWorker = newRenderWorker(defaultPlugins, defaultParameters,
+                                 pluginSearchRoot,
+                                 BATCH_RENDERER_MAX_FORKED_CHAINS, NULL);
+  processes = (_BatchRendererProcess *)malloc(sizeof(_BatchRendererProcess) *
+                                              maxProcesses);
+  logInfo("Rendering %d jobs with up to %d worker processes", self->numJobs,
+          maxProcesses);
+
+  for (i = 0; i < self->numJobs; i++) {
+    if (numProcesses == maxProcesses) {
+      _reapForkedJob(self, processes, &numProcesses);
+    }
+
+    // The chain is loaded here rather than in the worker, so that it is only
+    // loaded once and every later worker inherits it already initialized
+    if (!renderWorkerPrepare(renderWorker, self->jobs[i]) ||
+        !_forkJob(self, renderWorker, i, &processes[numProcesses])) {
+      logError("Job %d ('%s') failed", i + 1, self->jobs[i]->inputName->data);
+      self->numJobsFailed++;
+      continue;
+    }
+
+    numProcesses++;
+  }
+
+  while (numProcesses > 0) {
+    _reapForkedJob(self, processes, &numProcesses);
+  }
+
+  logInfo("Rendered %d of %d jobs, %ld plugin chains loaded",
+          self->numJobs - self->numJobsFailed, self->numJobs,
+          renderWorker->numChainsLoaded);
+  free(processes);
+  freeRenderWorker(renderWorker);
+  return self->numJobsFailed == 0 ? RETURN_CODE_SUCCESS : RETURN_CODE_IO_ERROR;
+#else
+  logUnsupportedFeature("Forked batch rendering on this platform");
+  return RETURN_CODE_UNSUPPORTED_FEATURE;
+#endif
+}
+
+void freeBatchRenderer(BatchRenderer self) {
+  unsigned int i;
+
+  if (self == NULL) {
+    return;
+  }
+
+  for (i = 0; i < self->numJobs; i++) {
+    freeRenderJob(self->jobs[i]);
+  }
+
+  free(self->jobs);
+  freeMutex(self->_pluginLoadMutex);
+  free(self);
+}
@@ -0,0 +1,161 @@
+//
+// BatchRenderer.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_BatchRenderer_h
+#define MrsWatson_BatchRenderer_h
+
+#include "app/RenderWorker.h"
+#include "app/ReturnCodes.h"
+#include "base/CharString.h"
+#include "base/LinkedList.h"
+#include "base/Thread.h"
+
+#define BATCH_RENDERER_MAX_FORKED_CHAINS 8
+
+/**
+ * Renders a list of jobs read from a manifest file on a pool of worker threads.
+ *
+ * Each thread renders with its own RenderWorker, which keeps the plugin chain
+ * loaded between jobs, so the cost of finding and opening plugins is paid once
+ * per thread instead of once per file. Since each worker also has its own
+ * audio settings and audio clock, jobs with different sample rates or channel
+ * counts may run at the same time.
+ *
+ * Inputs and outputs are streamed one block at a time, so the memory used by
+ * each worker does not depend on the length of the files.
+ */
+typedef struct {
+  RenderJob *jobs;
+  unsigned int numJobs;
+  unsigned int numJobsFailed;
+
+  // Private fields
+  Mutex _pluginLoadMutex;
+} BatchRendererMembers;
+typedef BatchRendererMembers *BatchRenderer;
+
+/**
+ * Create a new batch renderer with no jobs.
+ * @return Initialized object
+ */
+BatchRenderer newBatchRenderer(void);
+
+/**
+ * Add a job to the renderer.
+ * @param self
+ * @param inputName Input file
+ * @param outputName Output file
+ * @param plugins Plugin chain, or NULL or empty to use the default chain
+ * @param parameters Parameters for the first plugin, or NULL or empty for none
+ * @return True if the job was added
+ */
+boolByte batchRendererAddJob(BatchRenderer self, const char *inputName,
+                             const char *outputName, const char *plugins,
+                             const char *parameters);
+
+/**
+ * Add jobs from a CSV document. Each record contains the input file, output
+ * file, and optionally the plugin chain and parameters of one job. Fields may
+ * be quoted as described in RFC 4180, which is required for the parameters
+ * field since it contains commas. A header row starting with "input", empty
+ * lines, and lines starting with '#' are skipped.
+ * @param self
+ * @param contents CSV text
+ * @return True if all records could be parsed
+ */
+boolByte batchRendererParseCsv(BatchRenderer self, const char *contents);
+
+/**
+ * Add jobs from a JSON document, which must contain an array of objects with
+ * "input" and "output" string members, and optional "plugins" and "parameters"
+ * members. The parameters may be given either as an array of "INDEX,VALUE"
+ * strings or as a single string in the same format as the CSV field.
+ * @param self
+ * @param contents JSON text
+ * @return True if the document could be parsed
+ */
+boolByte batchRendererParseJson(BatchRenderer self, const char *contents);
+
+/**
+ * Read jobs from a manifest file. Files with a ".json" extension are parsed as
+ * JSON, and all other files as CSV.
+ * @param self
+ * @param manifestPath Path to manifest
+ * @return True if the manifest could be read and contained at least one job
+ */
+boolByte batchRendererReadManifest(BatchRenderer self,
+                                   const CharString manifestPath);
+
+/**
+ * Render all jobs and wait for them to finish. The audio settings of the
+ * calling thread are used as the starting point for each job, as described in
+ * newRenderWorker().
+ * @param self
+ * @param defaultPlugins Plugin chain used for jobs which don't specify one
+ * @param defaultParameters List of parameter strings (as given by --parameter)
+ * which are applied to jobs using the default chain, or NULL for none
+ * @param pluginSearchRoot User-supplied plugin search root, may be empty
+ * @param numWorkers Number of worker threads. This is limited to the number of
+ * jobs, and if 0 then one thread is used.
+ * @return RETURN_CODE_SUCCESS if all jobs were rendered, or other code if any
+ * job failed
+ */
+ReturnCode batchRendererRun(BatchRenderer self, const CharString defaultPlugins,
+                            const LinkedList defaultParameters,
+                            const CharString pluginSearchRoot,
+                            unsigned int numWorkers);
+
+/**
+ * Render all jobs in child processes and wait for them to finish. For each
+ * job, the parent process loads the job's plugin chain (or reuses it, if an
+ * earlier job used the same chain) and then forks a worker which renders the
+ * job with a copy-on-write copy of the already initialized plugins. This gives
+ * process-level parallelism for plugins which cannot safely be instantiated
+ * more than once per process, and a plugin which crashes only fails the job it
+ * was rendering. Not supported on Windows.
+ * @param self
+ * @param defaultPlugins Plugin chain used for jobs which don't specify one
+ * @param defaultParameters List of parameter strings (as given by --parameter)
+ * which are applied to jobs using the default chain, or NULL for none
+ * @param pluginSearchRoot User-supplied plugin search root, may be empty
+ * @param maxProcesses Maximum number of workers running at once, if 0 then
+ * jobs are rendered one at a time
+ * @return RETURN_CODE_SUCCESS if all jobs were rendered, or other code if any
+ * job failed
+ */
+ReturnCode batchRendererRunForked(BatchRenderer self,
+                                  const CharString defaultPlugins,
+                                  const LinkedList defaultParameters,
+                                  const CharString pluginSearchRoot,
+                                  unsigned int maxProcesses);
+
+/**
+ * Free the renderer and its jobs.
+ * @param self
+ */
+void freeBatchRenderer(BatchRenderer self);
+
+#endif
@@ -0,0 +1,537 @@
+//
+// ControlChannel.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "ControlChannel.h"
+
+#include "base/File.h"
+#include "logging/EventLogger.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if UNIX
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+ControlChannel newControlChannel(const CharString path) {
+  ControlChannel channel = (ControlChannel)malloc(sizeof(ControlChannelMembers));
+  unsigned int i;
+
+  channel->path = newCharStringWithCString(path->data);
+  channel->numMessages = 0;
+  channel->numMessagesRejected = 0;
+  channel->numMessagesDropped = 0;
+
+  channel->_messages = (ControlMessageMembers *)malloc(
+      sizeof(ControlMessageMembers) * CONTROL_CHANNEL_QUEUE_CAPACITY);
+  channel->_midiMessages = (ControlMessage *)malloc(
+      sizeof(ControlMessage) * CONTROL_CHANNEL_QUEUE_CAPACITY);
+  channel->_midiEventNodes = (LinkedListMembers *)malloc(
+      sizeof(LinkedListMembers) * CONTROL_CHANNEL_QUEUE_CAPACITY);
+  channel->_freeMessages = newSpscQueue(CONTROL_CHANNEL_QUEUE_CAPACITY);
+  channel->_pendingMessages = newSpscQueue(CONTROL_CHANNEL_QUEUE_CAPACITY);
+
+  for (i = 0; i < CONTROL_CHANNEL_QUEUE_CAPACITY; i++) {
+    spscQueuePush(channel->_freeMessages, &channel->_messages[i]);
+  }
+
+  channel->_socket = -1;
+  channel->_numClients = 0;
+  channel->_wakeUpPipe[0] = -1;
+  channel->_wakeUpPipe[1] = -1;
+  channel->_thread = NULL;
+  channel->_stopRequested = false;
+
+  return channel;
+}
+
+static boolByte _parseParameterCommand(ControlMessage message,
+                                       const char *arguments) {
+  char extra;
+
+  message->type = CONTROL_MESSAGE_PARAMETER;
+  return (boolByte)(sscanf(arguments, "%u %u %f %c", &message->pluginIndex,
+                           &message->parameterIndex, &message->value,
+                           &extra) == 3);
+}
+
+static boolByte _parseMidiCommand(ControlMessage message,
+                                  const char *arguments) {
+  int status = 0;
+  int data1 = 0;
+  int data2 = 0;
+  char extra;
+  int numArguments = sscanf(arguments, "%u %i %i %i %c", &message->pluginIndex,
+                            &status, &data1, &data2, &extra);
+
+  // System messages would need their data to be copied to memory which is
+  // owned by the event, so only channel messages are supported
+  if (numArguments < 3 || numArguments > 4 || status < 0x80 ||
+      status >= 0xf0 || data1 < 0 || data1 >= 0x80 || data2 < 0 ||
+      data2 >= 0x80) {
+    return false;
+  }
+
+  message->type = CONTROL_MESSAGE_MIDI;
+  message->midiEvent.eventType = MIDI_TYPE_REGULAR;
+  message->midiEvent.deltaFrames = 0;
+  message->midiEvent.timestamp = 0;
+  message->midiEvent.status = (byte)status;
+  message->midiEvent.data1 = (byte)data1;
+  message->midiEvent.data2 = (byte)data2;
+  message->midiEvent.extraData = NULL;
+  return true;
+}
+
+boolByte controlChannelHandleCommand(ControlChannel self, const char *command) {
+  ControlMessageMembers parsedMessage;
+  ControlMessage message;
+  char name[16];
+  int nameLength = 0;
+  boolByte parsed = false;
+
+  if (sscanf(command, "%15s%n", name, &nameLength) != 1) {
+    // Ignore empty lines
+    return false;
+  }
+
+  if (!strcmp(name, CONTROL_CHANNEL_PARAMETER_COMMAND)) {
+    parsed = _parseParameterCommand(&parsedMessage, command + nameLength);
+  } else if (!strcmp(name, CONTROL_CHANNEL_MIDI_COMMAND)) {
+    parsed = _parseMidiCommand(&parsedMessage, command + nameLength);
+  }
+
+  if (!parsed) {
+    logWarn("Invalid control command '%s'", command);
+    return false;
+  }
+
+  // Messages are only ever returned to the pool by the processing thread, so
+  // one is only taken once the command is known to be valid
+  message = (ControlMessage)spscQueuePop(self->_freeMessages);
+
+  if (message == NULL) {
+    logWarn("Control channel is full, dropping '%s'", command);
+    self->numMessagesDropped++;
+    return false;
+  }
+
+  memcpy(message, &parsedMessage, sizeof(ControlMessageMembers));
+  logDebug("Received control command '%s'", command);
+  spscQueuePush(self->_pendingMessages, message);
+  return true;
+}
+
+/**
+ * Send the MIDI message at the given index, along with all later ones for the
+ * same plugin, to the plugin at once. The events of the block are appended to
+ * those of the control channel, whose events are all at the first frame.
+ */
+static void _sendMidiEvents(ControlChannel self, PluginChain pluginChain,
+                            unsigned int firstMessage,
+                            unsigned int numMidiMessages,
+                            LinkedList blockEvents) {
+  const unsigned int pluginIndex =
+      self->_midiMessages[firstMessage]->pluginIndex;
+  ControlMessage message;
+  LinkedList node;
+  int numEvents = 0;
+  unsigned int i;
+
+  for (i = firstMessage; i < numMidiMessages; i++) {
+    message = self->_midiMessages[i];
+
+    if (message == NULL || message->pluginIndex != pluginIndex) {
+      continue;
+    }
+
+    node = &self->_midiEventNodes[numEvents];
+    node->item = &message->midiEvent;
+    node->nextItem = NULL;
+
+    if (numEvents > 0) {
+      self->_midiEventNodes[numEvents - 1].nextItem = node;
+    }
+
+    self->_midiMessages[i] = NULL;
+    numEvents++;
+  }
+
+  self->_midiEventNodes[0]._numItems = numEvents;
+
+  if (blockEvents != NULL && blockEvents->item != NULL) {
+    self->_midiEventNodes[numEvents - 1].nextItem = blockEvents;
+    self->_midiEventNodes[0]._numItems += linkedListLength(blockEvents);
+  }
+
+  pluginChainProcessPluginMidi(pluginChain, pluginIndex,
+                               &self->_midiEventNodes[0]);
+
+  // The events are part of their messages, which can only be reused once the
+  // plugin is done with them
+  for (i = 0; i < (unsigned int)numEvents; i++) {
+    spscQueuePush(self->_freeMessages,
+                  (char *)self->_midiEventNodes[i].item -
+                      offsetof(ControlMessageMembers, midiEvent));
+  }
+}
+
+void controlChannelProcess(ControlChannel self, PluginChain pluginChain,
+                           AudioClock audioClock, LinkedList midiEvents) {
+  ControlMessage message;
+  unsigned int numMidiMessages = 0;
+  boolByte blockEventsSent = false;
+  unsigned int i;
+
+  // Messages which are pushed while the queue is being emptied are left for
+  // the next block, so that a busy client can't hold up processing forever
+  for (i = 0; i < CONTROL_CHANNEL_QUEUE_CAPACITY; i++) {
+    message = (ControlMessage)spscQueuePop(self->_pendingMessages);
+
+    if (message == NULL) {
+      break;
+    }
+
+    if (message->pluginIndex >= pluginChain->numPlugins) {
+      self->numMessagesRejected++;
+      spscQueuePush(self->_freeMessages, message);
+    } else if (message->type == CONTROL_MESSAGE_PARAMETER) {
+      if (pluginChainSetPluginParameter(pluginChain, message->pluginIndex,
+                                        message->parameterIndex,
+                                        message->value)) {
+        self->numMessages++;
+      } else {
+        self->numMessagesRejected++;
+      }
+
+      spscQueuePush(self->_freeMessages, message);
+    } else {
+      message->midiEvent.deltaFrames = 0;
+      message->midiEvent.timestamp = audioClock->currentFrame;
+      self->_midiMessages[numMidiMessages++] = message;
+      self->numMessages++;
+    }
+  }
+
+  // Each call sends the events of one plugin and clears their messages, so
+  // the next remaining message belongs to a plugin which has not had any yet
+  for (i = 0; i < numMidiMessages; i++) {
+    message = self->_midiMessages[i];
+
+    if (message != NULL) {
+      if (message->pluginIndex == 0) {
+        blockEventsSent = true;
+      }
+
+      _sendMidiEvents(self, pluginChain, i, numMidiMessages,
+                      message->pluginIndex == 0 ? midiEvents : NULL);
+    }
+  }
+
+  if (!blockEventsSent && midiEvents != NULL) {
+    pluginChainProcessMidi(pluginChain, midiEvents);
+  }
+}
+
+#if UNIX
+/**
+ * Handle all complete commands which a client has sent.
+ */
+static void _handleClientCommands(ControlChannel self,
+                                      ControlChannelClient client) {
+  char *line = client->buffer;
+  char *bufferEnd = client->buffer + client->bufferLength;
+  char *end;
+
+  while ((end = memchr(line, '\n', (size_t)(bufferEnd - line))) != NULL) {
+    *end = '\0';
+
+    if (end > line && end[-1] == '\r') {
+      end[-1] = '\0';
+    }
+
+    controlChannelHandleCommand(self, line);
+    line = end + 1;
+  }
+
+  client->bufferLength = (size_t)(bufferEnd - line);
+  memmove(client->buffer, line, client->bufferLength);
+
+  if (client->bufferLength >= CONTROL_CHANNEL_MAX_COMMAND_LENGTH - 1) {
+    logWarn("Control command is longer than %d bytes, discarding it",
+            CONTROL_CHANNEL_MAX_COMMAND_LENGTH);
+    client->bufferLength = 0;
+  }
+}
+
+static boolByte _readFromClient(ControlChannel self,
+                                ControlChannelClient client) {
+  ssize_t bytesRead =
+      read(client->descriptor, client->buffer + client->bufferLength,
+           CONTROL_CHANNEL_MAX_COMMAND_LENGTH - 1 - client->bufferLength);
+
+  if (bytesRead < 0 && (errno == EINTR || errno == EAGAIN)) {
+    return true;
+  } else if (bytesRead <= 0) {
+    return false;
+  }
+
+  client->bufferLength += (size_t)bytesRead;
+  _handleClientCommands(self, client);
+  return true;
+}
+
+static void _addClient(ControlChannel self, int descriptor) {
+  ControlChannelClient client = &self->_clients[self->_numClients++];
+  client->descriptor = descriptor;
+  client->bufferLength = 0;
+}
+
+static void _closeClient(ControlChannel self, unsigned int index) {
+  close(self->_clients[index].descriptor);
+  self->_clients[index] = self->_clients[--self->_numClients];
+}
+
+static void _acceptClient(ControlChannel self) {
+  int clientSocket = accept(self->_socket, NULL, NULL);
+
+  if (clientSocket < 0) {
+    logWarn("Could not accept control connection, %s",
+            stringForLastError(errno));
+  } else if (self->_numClients == CONTROL_CHANNEL_MAX_CLIENTS) {
+    logWarn("Too many control connections, rejecting client");
+    close(clientSocket);
+  } else {
+    logDebug("Accepted control connection");
+    _addClient(self, clientSocket);
+  }
+}
+
+static void _runControlChannel(void *userData) {
+  ControlChannel self = (ControlChannel)userData;
+  struct pollfd pollDescriptors[CONTROL_CHANNEL_MAX_CLIENTS + 2];
+  unsigned int numPollDescriptors;
+  unsigned int i;
+
+  while (!atomicLoad(&self->_stopRequested)) {
+    pollDescriptors[0].fd = self->_wakeUpPipe[0];
+    pollDescriptors[0].events = POLLIN;
+    pollDescriptors[1].fd = self->_socket;
+    pollDescriptors[1].events = POLLIN;
+
+    for (i = 0; i < self->_numClients; i++) {
+      pollDescriptors[i + 2].fd = self->_clients[i].descriptor;
+      pollDescriptors[i + 2].events = POLLIN;
+    }
+
+    numPollDescriptors = self->_numClients + 2;
+
+    // A negative descriptor is ignored by poll(), which is the case for the
+    // socket when reading from a named pipe
+    if (poll(pollDescriptors, numPollDescriptors, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      logError("Could not wait for control commands, %s",
+               stringForLastError(errno));
+      break;
+    }
+
+    if (pollDescriptors[0].revents != 0) {
+      break;
+    }
+
+    // Clients are checked in reverse order so that closing one (which moves
+    // the last client into its place) does not skip any descriptors
+    for (i = numPollDescriptors - 1; i > 1; i--) {
+      if (pollDescriptors[i].revents != 0 &&
+          !_readFromClient(self, &self->_clients[i - 2])) {
+        _closeClient(self, i - 2);
+      }
+    }
+
+    if (self->_socket >= 0 && (pollDescriptors[1].revents & POLLIN)) {
+      _acceptClient(self);
+    }
+  }
+}
+
+static boolByte _openSocket(ControlChannel self) {
+  struct sockaddr_un address;
+  int clientSocket;
+
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+
+  if (strlen(self->path->data) >= sizeof(address.sun_path)) {
+    logError("Socket path '%s' is too long", self->path->data);
+    return false;
+  }
+
+  strncpy(address.sun_path, self->path->data, sizeof(address.sun_path) - 1);
+
+  // A socket which no one listens on was left behind by an earlier run
+  clientSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+
+  if (clientSocket >= 0) {
+    if (connect(clientSocket, (struct sockaddr *)&address, sizeof(address)) ==
+        0) {
+      logError("Another process is already listening on '%s'",
+               self->path->data);
+      close(clientSocket);
+      return false;
+    }
+
+    close(clientSocket);
+  }
+
+  unlink(self->path->data);
+  self->_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+
+  if (self->_socket < 0) {
+    logError("Could not create socket, %s", stringForLastError(errno));
+    return false;
+  }
+
+  if (bind(self->_socket, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+      listen(self->_socket, SOMAXCONN) != 0) {
+    logError("Could not listen on '%s', %s", self->path->data,
+             stringForLastError(errno));
+    close(self->_socket);
+    self->_socket = -1;
+    return false;
+  }
+
+  logInfo("Listening for control commands on '%s'", self->path->data);
+  return true;
+}
+
+static boolByte _openNamedPipe(ControlChannel self) {
+  // The pipe is also opened for writing, so that reading from it does not hit
+  // the end of the file each time that a writer closes it
+  int descriptor = open(self->path->data, O_RDWR | O_NONBLOCK);
+
+  if (descriptor < 0) {
+    logError("Could not open named pipe '%s', %s", self->path->data,
+             stringForLastError(errno));
+    return false;
+  }
+
+  _addClient(self, descriptor);
+  logInfo("Reading control commands from '%s'", self->path->data);
+  return true;
+}
+#endif
+
+boolByte controlChannelOpen(ControlChannel self) {
+#if UNIX
+  struct stat pathStatus;
+  boolByte opened;
+
+  if (stat(self->path->data, &pathStatus) == 0 && S_ISFIFO(pathStatus.st_mode)) {
+    opened = _openNamedPipe(self);
+  } else {
+    opened = _openSocket(self);
+  }
+
+  if (!opened) {
+    return false;
+  }
+
+  if (pipe(self->_wakeUpPipe) != 0) {
+    logError("Could not create pipe, %s", stringForLastError(errno));
+    return false;
+  }
+
+  self->_thread = newThread(_runControlChannel, self);
+
+  if (self->_thread == NULL) {
+    logError("Could not start control channel thread");
+    return false;
+  }
+
+  return true;
+#else
+  logUnsupportedFeature("Control channel on this platform");
+  return false;
+#endif
+}
+
+void freeControlChannel(ControlChannel self) {
+  if (self == NULL) {
+    return;
+  }
+
+#if UNIX
+  if (self->_thread != NULL) {
+    atomicStore(&self->_stopRequested, true);
+
+    if (write(self->_wakeUpPipe[1], "", 1) != 1) {
+      logWarn("Could not stop control channel thread");
+    }
+
+    freeThread(self->_thread);
+  }
+
+  while (self->_numClients > 0) {
+    _closeClient(self, 0);
+  }
+
+  if (self->_socket >= 0) {
+    close(self->_socket);
+    unlink(self->path->data);
+  }
+
+  if (self->_wakeUpPipe[0] >= 0) {
+    close(self->_wakeUpPipe[0]);
+    close(self->_wakeUpPipe[1]);
+  }
+#endif
+
+  if (self->numMessages > 0 || self->numMessagesRejected > 0 ||
+      self->numMessagesDropped > 0) {
+    logInfo("Control channel applied %lu messages, %lu rejected, %lu dropped",
+            self->numMessages, self->numMessagesRejected,
+            self->numMessagesDropped);
+  }
+
+  freeSpscQueue(self->_freeMessages);
+  freeSpscQueue(self->_pendingMessages);
+  free(self->_messages);
+  free(self->_midiMessages);
+  free(self->_midiEventNodes);
+  freeCharString(self->path);
+  free(self);
+}
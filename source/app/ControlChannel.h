@@ -0,0 +1,177 @@
+//
+// ControlChannel.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_ControlChannel_h
+#define MrsWatson_ControlChannel_h
+
+#include "base/CharString.h"
+#include "base/LinkedList.h"
+#include "base/Queue.h"
+#include "base/Thread.h"
+#include "midi/MidiEvent.h"
+#include "plugin/PluginChain.h"
+#include "time/AudioClock.h"
+
+// Number of messages which may be waiting to be applied at any time. Further
+// messages are dropped until the processing thread catches up.
+#define CONTROL_CHANNEL_QUEUE_CAPACITY 1024
+#define CONTROL_CHANNEL_MAX_CLIENTS 16
+#define CONTROL_CHANNEL_MAX_COMMAND_LENGTH 256
+#define CONTROL_CHANNEL_PARAMETER_COMMAND "param"
+#define CONTROL_CHANNEL_MIDI_COMMAND "midi"
+
+typedef enum {
+  CONTROL_MESSAGE_PARAMETER,
+  CONTROL_MESSAGE_MIDI,
+} ControlMessageType;
+
+typedef struct {
+  ControlMessageType type;
+  // Index of the plugin in the chain which the message is sent to
+  unsigned int pluginIndex;
+  unsigned int parameterIndex;
+  float value;
+  MidiEventMembers midiEvent;
+} ControlMessageMembers;
+typedef ControlMessageMembers *ControlMessage;
+
+typedef struct {
+  int descriptor;
+  // Data received from the client which does not yet form a complete command
+  char buffer[CONTROL_CHANNEL_MAX_COMMAND_LENGTH];
+  size_t bufferLength;
+} ControlChannelClientMembers;
+typedef ControlChannelClientMembers *ControlChannelClient;
+
+/**
+ * Receives parameter changes and MIDI events while a chain is processing, so
+ * that long-running or live renders can be automated without restarting them.
+ *
+ * The channel listens on either a named pipe, if one exists at its path, or
+ * otherwise a Unix domain socket which it creates there. Commands are sent one
+ * per line, and are either:
+ *
+ *   param <plugin> <parameter> <value>
+ *   midi <plugin> <status> <data1> [data2]
+ *
+ * where <plugin> is the index of the plugin in the chain, and the MIDI bytes
+ * may be given in decimal or in hexadecimal with a "0x" prefix. For example,
+ * "midi 0 0x90 60 100" plays middle C on the first plugin. Only channel
+ * messages are supported. Nothing is sent back to clients, and invalid
+ * commands are logged and ignored.
+ *
+ * Commands are read by a separate thread, which passes them to the processing
+ * thread through a lock-free queue of preallocated messages. The processing
+ * thread applies all waiting messages at the start of each block with
+ * controlChannelProcess(), which neither allocates nor takes a lock, and MIDI
+ * events are timestamped to the first frame of that block. If the chain is
+ * pipelined, then the chain copies the messages into its next block instead,
+ * so that each one is applied by the thread which processes its plugin.
+ */
+typedef struct {
+  CharString path;
+  // Number of messages which were applied to the chain
+  unsigned long numMessages;
+  // Number of messages which were sent to a plugin that does not exist, or
+  // which the plugin did not accept
+  unsigned long numMessagesRejected;
+  // Number of messages which were dropped because the queue was full
+  unsigned long numMessagesDropped;
+
+  // Private fields
+  ControlMessageMembers *_messages;
+  // MIDI messages which are being sent during controlChannelProcess(), and the
+  // list nodes which hold the events of one plugin
+  ControlMessage *_midiMessages;
+  LinkedListMembers *_midiEventNodes;
+  // Messages which are waiting to be filled by the reader thread, and messages
+  // which are waiting to be applied by the processing thread
+  SpscQueue _freeMessages;
+  SpscQueue _pendingMessages;
+  int _socket;
+  ControlChannelClientMembers _clients[CONTROL_CHANNEL_MAX_CLIENTS];
+  unsigned int _numClients;
+  // Written to in order to wake up the reader thread when stopping
+  int _wakeUpPipe[2];
+  Thread _thread;
+  volatile unsigned long _stopRequested;
+} ControlChannelMembers;
+typedef ControlChannelMembers *ControlChannel;
+
+/**
+ * Create a new control channel. Nothing is received until the channel is
+ * opened with controlChannelOpen().
+ * @param path Path of a named pipe to read from, or where a socket should be
+ * created
+ * @return Initialized object
+ */
+ControlChannel newControlChannel(const CharString path);
+
+/**
+ * Open the named pipe or socket and start reading commands on a separate
+ * thread. If a socket file which no one listens on already exists at the
+ * path, then it is replaced.
+ * @param self
+ * @return True if the channel is open
+ */
+boolByte controlChannelOpen(ControlChannel self);
+
+/**
+ * Parse a single command and queue it to be applied by the processing thread.
+ * This is called by the reader thread for each line which it receives, and
+ * must not be called by any other thread while the channel is open.
+ * @param self
+ * @param command Command, without the trailing newline
+ * @return True if the command was queued
+ */
+boolByte controlChannelHandleCommand(ControlChannel self, const char *command);
+
+/**
+ * Apply all messages which have been queued so far to a plugin chain, and send
+ * the MIDI events of the block to the head plugin. This should be called by
+ * the processing thread at the start of each block, instead of calling
+ * pluginChainProcessMidi(). Some plugins only keep the MIDI events of the
+ * last call, so each plugin receives all of its events for the block at once,
+ * and the events for the head plugin are merged with those of the block.
+ * @param self
+ * @param pluginChain Plugin chain which is being processed
+ * @param audioClock Clock of the processing thread, which gives the timestamp
+ * of MIDI events
+ * @param midiEvents MIDI events of the block for the head plugin, or NULL if
+ * there are none
+ */
+void controlChannelProcess(ControlChannel self, PluginChain pluginChain,
+                           AudioClock audioClock, LinkedList midiEvents);
+
+/**
+ * Stop reading commands, close the channel and free it. If the channel created
+ * a socket, then the socket file is removed. Messages which have been queued
+ * but not yet applied are discarded.
+ * @param self
+ */
+void freeControlChannel(ControlChannel self);
+
+#endif
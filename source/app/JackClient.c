@@ -0,0 +1,652 @@
+//
+// JackClient.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "JackClient.h"
+
+#include "audio/AudioSettings.h"
+#include "logging/EventLogger.h"
+#include "time/TaskTimer.h"
+
+#include <jack/midiport.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Time which the disk thread sleeps for when there is nothing to read or write
+#define JACK_CLIENT_DISK_SLEEP_TIME_IN_MS 2.0
+// Time between checks of whether processing should be stopped
+#define JACK_CLIENT_POLL_TIME_IN_MS 50.0
+
+static volatile sig_atomic_t _jackClientSignalReceived = 0;
+
+static void _jackClientSignalHandler(int signalNumber) {
+  (void)signalNumber;
+  _jackClientSignalReceived = 1;
+}
+
+JackClient newJackClient(const CharString clientName) {
+  JackClient client = (JackClient)malloc(sizeof(JackClientMembers));
+
+  client->clientName = newCharStringWithCString(
+      charStringIsEmpty(clientName) ? JACK_CLIENT_DEFAULT_NAME
+                                    : clientName->data);
+  client->numXruns = 0;
+  client->numUnderruns = 0;
+  client->numOverruns = 0;
+
+  client->_client = NULL;
+  client->_inputPorts = NULL;
+  client->_outputPorts = NULL;
+  client->_midiInputPort = NULL;
+  client->_numChannels = 0;
+  client->_pluginChain = NULL;
+  client->_controlChannel = NULL;
+  client->_audioClock = NULL;
+  client->_inputBuffer = NULL;
+  client->_outputBuffer = NULL;
+  client->_midiEvents = NULL;
+  client->_midiEventNodes = NULL;
+
+  client->_inputSource = NULL;
+  client->_outputSource = NULL;
+  client->_diskBuffers = NULL;
+  client->_numDiskBuffers = 0;
+  client->_inputFree = NULL;
+  client->_inputFilled = NULL;
+  client->_outputFree = NULL;
+  client->_outputFilled = NULL;
+  client->_diskThread = NULL;
+
+  client->_running = false;
+  client->_inputFinished = false;
+  client->_processingFinished = false;
+  client->_diskThreadStopped = false;
+  client->_bufferSizeChanged = false;
+  client->_serverShutdown = false;
+
+  return client;
+}
+
+boolByte jackClientOpen(JackClient self) {
+  jack_status_t status;
+
+  self->_client = jack_client_open(self->clientName->data, JackNoStartServer,
+                                   &status);
+
+  if (self->_client == NULL) {
+    logError("Could not connect to the JACK server (status 0x%x)",
+             (unsigned int)status);
+    return false;
+  }
+
+  if (status & JackNameNotUnique) {
+    logInfo("JACK client name '%s' was taken, using '%s' instead",
+            self->clientName->data, jack_get_client_name(self->_client));
+  }
+
+  if (!setSampleRate((SampleRate)jack_get_sample_rate(self->_client)) ||
+      !setBlocksize((SampleCount)jack_get_buffer_size(self->_client))) {
+    logError("JACK server settings are not supported");
+    return false;
+  }
+
+  logInfo("Connected to JACK server at %.0fHz with %lu frame blocks",
+          getSampleRate(), (unsigned long)getBlocksize());
+  return true;
+}
+
+static void _jackClientClearPorts(JackClient self, jack_nframes_t numFrames) {
+  ChannelCount i;
+
+  for (i = 0; i < self->_numChannels; i++) {
+    memset(jack_port_get_buffer(self->_outputPorts[i], numFrames), 0,
+           sizeof(jack_default_audio_sample_t) * numFrames);
+  }
+}
+
+/**
+ * Copy the input of the block from the input ports, or from the input file.
+ * @return False if the input file has ended, in which case the block must not
+ * be processed
+ */
+static boolByte _jackClientReadInput(JackClient self,
+                                     jack_nframes_t numFrames) {
+  SampleBuffer diskBuffer;
+  boolByte inputFinished;
+  ChannelCount i;
+
+  if (self->_inputSource == NULL) {
+    for (i = 0; i < self->_numChannels; i++) {
+      memcpy(self->_inputBuffer->samples[i],
+             jack_port_get_buffer(self->_inputPorts[i], numFrames),
+             sizeof(Sample) * numFrames);
+    }
+
+    return true;
+  }
+
+  // The flag must be read before popping, since the disk thread sets it after
+  // pushing the last block
+  inputFinished = (boolByte)atomicLoad(&self->_inputFinished);
+  diskBuffer = (SampleBuffer)spscQueuePop(self->_inputFilled);
+
+  if (diskBuffer == NULL && inputFinished) {
+    atomicStore(&self->_processingFinished, true);
+    return false;
+  } else if (diskBuffer == NULL) {
+    sampleBufferClear(self->_inputBuffer);
+    self->numUnderruns++;
+    return true;
+  }
+
+  for (i = 0; i < self->_numChannels; i++) {
+    memcpy(self->_inputBuffer->samples[i], diskBuffer->samples[i],
+           sizeof(Sample) * numFrames);
+  }
+
+  spscQueuePush(self->_inputFree, diskBuffer);
+  return true;
+}
+
+static LinkedList _jackClientReadMidi(JackClient self,
+                                      jack_nframes_t numFrames) {
+  void *portBuffer = jack_port_get_buffer(self->_midiInputPort, numFrames);
+  jack_nframes_t numJackEvents = jack_midi_get_event_count(portBuffer);
+  jack_midi_event_t jackEvent;
+  MidiEvent midiEvent;
+  int numEvents = 0;
+  jack_nframes_t i;
+
+  for (i = 0; i < numJackEvents && numEvents < JACK_CLIENT_MAX_MIDI_EVENTS;
+       i++) {
+    if (jack_midi_event_get(&jackEvent, portBuffer, i) != 0 ||
+        jackEvent.size == 0) {
+      continue;
+    }
+
+    // System messages would need their data to be copied to memory which is
+    // owned by the event, so only channel messages are passed on
+    if (jackEvent.buffer[0] < 0x80 || jackEvent.buffer[0] >= 0xf0) {
+      continue;
+    }
+
+    midiEvent = &self->_midiEvents[numEvents];
+    midiEvent->eventType = MIDI_TYPE_REGULAR;
+    midiEvent->deltaFrames = jackEvent.time;
+    midiEvent->timestamp = self->_audioClock->currentFrame + jackEvent.time;
+    midiEvent->status = jackEvent.buffer[0];
+    midiEvent->data1 = jackEvent.size > 1 ? jackEvent.buffer[1] : 0;
+    midiEvent->data2 = jackEvent.size > 2 ? jackEvent.buffer[2] : 0;
+    midiEvent->extraData = NULL;
+
+    self->_midiEventNodes[numEvents].item = midiEvent;
+    self->_midiEventNodes[numEvents].nextItem = NULL;
+
+    if (numEvents > 0) {
+      self->_midiEventNodes[numEvents - 1].nextItem =
+          &self->_midiEventNodes[numEvents];
+    }
+
+    numEvents++;
+  }
+
+  if (numEvents == 0) {
+    return NULL;
+  }
+
+  self->_midiEventNodes[0]._numItems = numEvents;
+  return &self->_midiEventNodes[0];
+}
+
+static void _jackClientWriteOutput(JackClient self, jack_nframes_t numFrames) {
+  SampleBuffer diskBuffer;
+  ChannelCount i;
+
+  for (i = 0; i < self->_numChannels; i++) {
+    memcpy(jack_port_get_buffer(self->_outputPorts[i], numFrames),
+           self->_outputBuffer->samples[i], sizeof(Sample) * numFrames);
+  }
+
+  if (self->_outputSource == NULL) {
+    return;
+  }
+
+  diskBuffer = (SampleBuffer)spscQueuePop(self->_outputFree);
+
+  if (diskBuffer == NULL) {
+    self->numOverruns++;
+    return;
+  }
+
+  for (i = 0; i < self->_numChannels; i++) {
+    memcpy(diskBuffer->samples[i], self->_outputBuffer->samples[i],
+           sizeof(Sample) * numFrames);
+  }
+
+  spscQueuePush(self->_outputFilled, diskBuffer);
+}
+
+static int _jackClientProcess(jack_nframes_t numFrames, void *arg) {
+  JackClient self = (JackClient)arg;
+  LinkedList midiEvents;
+
+  if (!atomicLoad(&self->_running) ||
+      atomicLoad(&self->_processingFinished) ||
+      numFrames != self->_inputBuffer->blocksize) {
+    _jackClientClearPorts(self, numFrames);
+    return 0;
+  }
+
+  if (!_jackClientReadInput(self, numFrames)) {
+    _jackClientClearPorts(self, numFrames);
+    return 0;
+  }
+
+  midiEvents = _jackClientReadMidi(self, numFrames);
+
+  // The control channel merges its MIDI events with those from JACK, so that
+  // each plugin receives the events for the block in a single call
+  if (self->_controlChannel != NULL) {
+    controlChannelProcess(self->_controlChannel, self->_pluginChain,
+                          self->_audioClock, midiEvents);
+  } else if (midiEvents != NULL) {
+    pluginChainProcessMidi(self->_pluginChain, midiEvents);
+  }
+
+  pluginChainProcessAudio(self->_pluginChain, self->_inputBuffer,
+                          self->_outputBuffer);
+  _jackClientWriteOutput(self, numFrames);
+  advanceAudioClock(self->_audioClock, numFrames);
+  return 0;
+}
+
+static int _jackClientXrun(void *arg) {
+  JackClient self = (JackClient)arg;
+  self->numXruns++;
+  return 0;
+}
+
+static int _jackClientBufferSizeChanged(jack_nframes_t numFrames, void *arg) {
+  JackClient self = (JackClient)arg;
+
+  // The plugins were prepared for a fixed blocksize, so processing stops
+  // rather than reallocating everything from the server's thread
+  if (numFrames != self->_inputBuffer->blocksize) {
+    atomicStore(&self->_bufferSizeChanged, true);
+  }
+
+  return 0;
+}
+
+static void _jackClientShutdown(void *arg) {
+  JackClient self = (JackClient)arg;
+  atomicStore(&self->_serverShutdown, true);
+}
+
+static boolByte _jackClientFillInput(JackClient self) {
+  SampleCount blocksize = getBlocksize();
+  SampleBuffer diskBuffer;
+  SampleCount framesRead;
+  ChannelCount i;
+
+  if (self->_inputSource == NULL || atomicLoad(&self->_inputFinished)) {
+    return false;
+  }
+
+  diskBuffer = (SampleBuffer)spscQueuePop(self->_inputFree);
+
+  if (diskBuffer == NULL) {
+    return false;
+  }
+
+  diskBuffer->blocksize = blocksize;
+  self->_inputSource->readSampleBlock(self->_inputSource, diskBuffer);
+  framesRead = diskBuffer->blocksize;
+  diskBuffer->blocksize = blocksize;
+
+  if (framesRead < blocksize) {
+    for (i = 0; i < diskBuffer->numChannels; i++) {
+      memset(diskBuffer->samples[i] + framesRead, 0,
+             sizeof(Sample) * (blocksize - framesRead));
+    }
+  }
+
+  if (framesRead > 0) {
+    spscQueuePush(self->_inputFilled, diskBuffer);
+  } else {
+    spscQueuePush(self->_inputFree, diskBuffer);
+  }
+
+  if (framesRead < blocksize) {
+    atomicStore(&self->_inputFinished, true);
+  }
+
+  return true;
+}
+
+static boolByte _jackClientFlushOutput(JackClient self) {
+  SampleBuffer diskBuffer;
+
+  if (self->_outputSource == NULL) {
+    return false;
+  }
+
+  diskBuffer = (SampleBuffer)spscQueuePop(self->_outputFilled);
+
+  if (diskBuffer == NULL) {
+    return false;
+  }
+
+  self->_outputSource->writeSampleBlock(self->_outputSource, diskBuffer);
+  spscQueuePush(self->_outputFree, diskBuffer);
+  return true;
+}
+
+static void _jackClientRunDisk(void *userData) {
+  JackClient self = (JackClient)userData;
+  boolByte didWork;
+
+  while (!atomicLoad(&self->_diskThreadStopped)) {
+    didWork = _jackClientFillInput(self);
+    didWork |= _jackClientFlushOutput(self);
+
+    // The queues are only ever polled, since waiting on them would make the
+    // process callback take a lock to wake this thread up
+    if (!didWork) {
+      taskTimerSleep(JACK_CLIENT_DISK_SLEEP_TIME_IN_MS);
+    }
+  }
+
+  // Processing has stopped by now, so whatever is left can be written
+  while (_jackClientFlushOutput(self)) {
+  }
+}
+
+static void _jackClientConnectPorts(JackClient self) {
+  const char **physicalPorts;
+  ChannelCount i;
+
+  physicalPorts = jack_get_ports(self->_client, NULL, JACK_DEFAULT_AUDIO_TYPE,
+                                 JackPortIsPhysical | JackPortIsOutput);
+
+  if (physicalPorts != NULL) {
+    for (i = 0; i < self->_numChannels && physicalPorts[i] != NULL; i++) {
+      if (jack_connect(self->_client, physicalPorts[i],
+                       jack_port_name(self->_inputPorts[i])) != 0) {
+        logWarn("Could not connect '%s' to input %d", physicalPorts[i], i + 1);
+      }
+    }
+
+    jack_free(physicalPorts);
+  }
+
+  physicalPorts = jack_get_ports(self->_client, NULL, JACK_DEFAULT_AUDIO_TYPE,
+                                 JackPortIsPhysical | JackPortIsInput);
+
+  if (physicalPorts != NULL) {
+    for (i = 0; i < self->_numChannels && physicalPorts[i] != NULL; i++) {
+      if (jack_connect(self->_client, jack_port_name(self->_outputPorts[i]),
+                       physicalPorts[i]) != 0) {
+        logWarn("Could not connect output %d to '%s'", i + 1,
+                physicalPorts[i]);
+      }
+    }
+
+    jack_free(physicalPorts);
+  }
+}
+
+static boolByte _jackClientRegisterPorts(JackClient self) {
+  char portName[32];
+  ChannelCount i;
+
+  self->_inputPorts =
+      (jack_port_t **)calloc(self->_numChannels, sizeof(jack_port_t *));
+  self->_outputPorts =
+      (jack_port_t **)calloc(self->_numChannels, sizeof(jack_port_t *));
+
+  for (i = 0; i < self->_numChannels; i++) {
+    snprintf(portName, sizeof(portName), "in_%d", i + 1);
+    self->_inputPorts[i] = jack_port_register(
+        self->_client, portName, JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput, 0);
+    snprintf(portName, sizeof(portName), "out_%d", i + 1);
+    self->_outputPorts[i] = jack_port_register(
+        self->_client, portName, JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0);
+
+    if (self->_inputPorts[i] == NULL || self->_outputPorts[i] == NULL) {
+      logError("Could not register JACK ports for channel %d", i + 1);
+      return false;
+    }
+  }
+
+  self->_midiInputPort = jack_port_register(
+      self->_client, "midi_in", JACK_DEFAULT_MIDI_TYPE, JackPortIsInput, 0);
+
+  if (self->_midiInputPort == NULL) {
+    logError("Could not register JACK MIDI port");
+    return false;
+  }
+
+  return true;
+}
+
+static void _jackClientAllocateDiskBuffers(JackClient self) {
+  SampleCount blocksize = getBlocksize();
+  unsigned int numBlocks = (unsigned int)(
+      JACK_CLIENT_DISK_BUFFER_TIME_IN_MS * getSampleRate() / 1000.0 /
+      blocksize);
+  unsigned int i;
+
+  if (numBlocks < 4) {
+    numBlocks = 4;
+  }
+
+  self->_numDiskBuffers = 0;
+  self->_diskBuffers = (SampleBuffer *)malloc(sizeof(SampleBuffer) * numBlocks *
+                                              2);
+  self->_inputFree = newSpscQueue(numBlocks);
+  self->_inputFilled = newSpscQueue(numBlocks);
+  self->_outputFree = newSpscQueue(numBlocks);
+  self->_outputFilled = newSpscQueue(numBlocks);
+
+  for (i = 0; i < numBlocks; i++) {
+    if (self->_inputSource != NULL) {
+      self->_diskBuffers[self->_numDiskBuffers] =
+          newSampleBuffer(self->_numChannels, blocksize);
+      spscQueuePush(self->_inputFree,
+                    self->_diskBuffers[self->_numDiskBuffers++]);
+    }
+
+    if (self->_outputSource != NULL) {
+      self->_diskBuffers[self->_numDiskBuffers] =
+          newSampleBuffer(self->_numChannels, blocksize);
+      spscQueuePush(self->_outputFree,
+                    self->_diskBuffers[self->_numDiskBuffers++]);
+    }
+  }
+}
+
+static void _jackClientLogStatistics(JackClient self) {
+  logInfo("Processed %lu frames, %lu xruns", self->_audioClock->currentFrame,
+          self->numXruns);
+
+  if (self->numUnderruns > 0) {
+    logWarn("Input file could not be read in time for %lu blocks",
+            self->numUnderruns);
+  }
+
+  if (self->numOverruns > 0) {
+    logWarn("%lu blocks could not be written to the output file",
+            self->numOverruns);
+  }
+}
+
+ReturnCode jackClientRun(JackClient self, PluginChain pluginChain,
+                         SampleSource inputSource, SampleSource outputSource,
+                         ControlChannel controlChannel,
+                         unsigned long maxTimeInMs) {
+  ReturnCode result = RETURN_CODE_SUCCESS;
+  struct sigaction action;
+  struct sigaction oldInterruptAction;
+  struct sigaction oldTerminateAction;
+  double elapsedTimeInMs = 0.0;
+
+  if (self->_client == NULL) {
+    logInternalError("JACK client was not opened");
+    return RETURN_CODE_INTERNAL_ERROR;
+  }
+
+  self->_pluginChain = pluginChain;
+  self->_controlChannel = controlChannel;
+  self->_audioClock = getAudioClock();
+  self->_numChannels = getNumChannels();
+  self->_inputSource = inputSource;
+  self->_outputSource = outputSource;
+
+  // Everything which the process callback touches is allocated up front
+  self->_inputBuffer = newSampleBuffer(self->_numChannels, getBlocksize());
+  self->_outputBuffer = newSampleBuffer(self->_numChannels, getBlocksize());
+  self->_midiEvents = (MidiEventMembers *)malloc(sizeof(MidiEventMembers) *
+                                                 JACK_CLIENT_MAX_MIDI_EVENTS);
+  self->_midiEventNodes = (LinkedListMembers *)malloc(
+      sizeof(LinkedListMembers) * JACK_CLIENT_MAX_MIDI_EVENTS);
+  _jackClientAllocateDiskBuffers(self);
+
+  if (!_jackClientRegisterPorts(self)) {
+    return RETURN_CODE_IO_ERROR;
+  }
+
+  jack_set_process_callback(self->_client, _jackClientProcess, self);
+  jack_set_xrun_callback(self->_client, _jackClientXrun, self);
+  jack_set_buffer_size_callback(self->_client, _jackClientBufferSizeChanged,
+                                self);
+  jack_on_shutdown(self->_client, _jackClientShutdown, self);
+
+  // Read ahead before starting, so that the first blocks don't underrun
+  while (_jackClientFillInput(self)) {
+  }
+
+  self->_diskThread = newThread(_jackClientRunDisk, self);
+
+  if (self->_diskThread == NULL) {
+    logError("Could not start disk thread");
+    return RETURN_CODE_INTERNAL_ERROR;
+  }
+
+  memset(&action, 0, sizeof(action));
+  sigemptyset(&action.sa_mask);
+  action.sa_handler = _jackClientSignalHandler;
+  sigaction(SIGINT, &action, &oldInterruptAction);
+  sigaction(SIGTERM, &action, &oldTerminateAction);
+  _jackClientSignalReceived = 0;
+
+  atomicStore(&self->_running, true);
+
+  if (jack_activate(self->_client) != 0) {
+    logError("Could not activate JACK client");
+    result = RETURN_CODE_IO_ERROR;
+  } else {
+    _jackClientConnectPorts(self);
+    logInfo("Processing as JACK client '%s', press Ctrl-C to stop",
+            jack_get_client_name(self->_client));
+
+    while (!_jackClientSignalReceived &&
+           !atomicLoad(&self->_processingFinished)) {
+      if (atomicLoad(&self->_serverShutdown)) {
+        logError("JACK server shut down");
+        result = RETURN_CODE_IO_ERROR;
+        break;
+      }
+
+      if (atomicLoad(&self->_bufferSizeChanged)) {
+        logError("JACK buffer size changed, which is not supported");
+        result = RETURN_CODE_UNSUPPORTED_FEATURE;
+        break;
+      }
+
+      if (maxTimeInMs > 0 && elapsedTimeInMs >= maxTimeInMs) {
+        break;
+      }
+
+      taskTimerSleep(JACK_CLIENT_POLL_TIME_IN_MS);
+      elapsedTimeInMs += JACK_CLIENT_POLL_TIME_IN_MS;
+    }
+
+    if (_jackClientSignalReceived) {
+      logInfo("Received signal, stopping");
+    }
+
+    atomicStore(&self->_running, false);
+
+    if (!atomicLoad(&self->_serverShutdown)) {
+      jack_deactivate(self->_client);
+    }
+  }
+
+  atomicStore(&self->_diskThreadStopped, true);
+  freeThread(self->_diskThread);
+  self->_diskThread = NULL;
+
+  sigaction(SIGINT, &oldInterruptAction, NULL);
+  sigaction(SIGTERM, &oldTerminateAction, NULL);
+  _jackClientLogStatistics(self);
+  return result;
+}
+
+void freeJackClient(JackClient self) {
+  unsigned int i;
+
+  if (self == NULL) {
+    return;
+  }
+
+  if (self->_client != NULL) {
+    jack_client_close(self->_client);
+  }
+
+  for (i = 0; i < self->_numDiskBuffers; i++) {
+    freeSampleBuffer(self->_diskBuffers[i]);
+  }
+
+  free(self->_diskBuffers);
+
+  if (self->_inputFree != NULL) {
+    freeSpscQueue(self->_inputFree);
+    freeSpscQueue(self->_inputFilled);
+    freeSpscQueue(self->_outputFree);
+    freeSpscQueue(self->_outputFilled);
+  }
+
+  free(self->_inputPorts);
+  free(self->_outputPorts);
+  free(self->_midiEvents);
+  free(self->_midiEventNodes);
+  freeSampleBuffer(self->_inputBuffer);
+  freeSampleBuffer(self->_outputBuffer);
+  freeCharString(self->clientName);
+  free(self);
+}
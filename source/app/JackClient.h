@@ -0,0 +1,160 @@
+//
+// JackClient.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_JackClient_h
+#define MrsWatson_JackClient_h
+
+#include "app/ControlChannel.h"
+#include "app/ReturnCodes.h"
+#include "audio/SampleBuffer.h"
+#include "base/CharString.h"
+#include "base/LinkedList.h"
+#include "base/Queue.h"
+#include "base/Thread.h"
+#include "io/SampleSource.h"
+#include "midi/MidiEvent.h"
+#include "plugin/PluginChain.h"
+#include "time/AudioClock.h"
+
+#include <jack/jack.h>
+
+#define JACK_CLIENT_DEFAULT_NAME "mrswatson"
+// Amount of audio which the disk thread reads ahead of, or lets pile up behind
+// the process callback when streaming to or from files
+#define JACK_CLIENT_DISK_BUFFER_TIME_IN_MS 500
+// Number of MIDI events which are passed to the chain in a single block. Any
+// further events in the block are dropped.
+#define JACK_CLIENT_MAX_MIDI_EVENTS 256
+
+/**
+ * Runs a plugin chain as a JACK client, so that it can be used as a live insert
+ * processor. The JACK process callback takes the place of the main processing
+ * loop: it reads the input ports, passes the block and any MIDI events from the
+ * MIDI input port through the chain, and writes the result to the output
+ * ports. The sample rate and blocksize are taken from the JACK server.
+ *
+ * Input and output files are streamed by a separate disk thread, which is
+ * connected to the process callback by lock-free queues of preallocated
+ * blocks. The callback itself never allocates memory, takes a lock or touches
+ * the disk, so that it is safe to run in the realtime thread of the server.
+ * This does not hold for plugins which do so themselves, or for options which
+ * synchronize threads for every block such as --pipeline and plugin groups.
+ */
+typedef struct {
+  CharString clientName;
+  // Number of times that the JACK server reported an xrun
+  unsigned long numXruns;
+  // Number of blocks for which the disk thread had not read the input file in
+  // time, which were processed as silence instead
+  unsigned long numUnderruns;
+  // Number of blocks which could not be written to the output file because the
+  // disk thread fell behind
+  unsigned long numOverruns;
+
+  // Private fields
+  jack_client_t *_client;
+  jack_port_t **_inputPorts;
+  jack_port_t **_outputPorts;
+  jack_port_t *_midiInputPort;
+  ChannelCount _numChannels;
+  PluginChain _pluginChain;
+  ControlChannel _controlChannel;
+  AudioClock _audioClock;
+  SampleBuffer _inputBuffer;
+  SampleBuffer _outputBuffer;
+  // Events and list nodes for the MIDI events of one block, which are linked
+  // together by the process callback rather than being allocated
+  MidiEventMembers *_midiEvents;
+  LinkedListMembers *_midiEventNodes;
+
+  // Streaming of files. Each block from the pool is either in the free queue,
+  // where it waits to be filled by its producer, or in the filled queue.
+  SampleSource _inputSource;
+  SampleSource _outputSource;
+  SampleBuffer *_diskBuffers;
+  unsigned int _numDiskBuffers;
+  SpscQueue _inputFree;
+  SpscQueue _inputFilled;
+  SpscQueue _outputFree;
+  SpscQueue _outputFilled;
+  Thread _diskThread;
+
+  // Flags which are shared between the threads
+  volatile unsigned long _running;
+  volatile unsigned long _inputFinished;
+  volatile unsigned long _processingFinished;
+  volatile unsigned long _diskThreadStopped;
+  volatile unsigned long _bufferSizeChanged;
+  volatile unsigned long _serverShutdown;
+} JackClientMembers;
+typedef JackClientMembers *JackClient;
+
+/**
+ * Create a new JACK client. The client is not connected to a server until
+ * jackClientOpen() is called.
+ * @param clientName Name of the client as shown by the JACK server. If NULL
+ * or empty, JACK_CLIENT_DEFAULT_NAME is used.
+ * @return Initialized object
+ */
+JackClient newJackClient(const CharString clientName);
+
+/**
+ * Connect to the JACK server, and change the sample rate and blocksize of the
+ * audio settings to those of the server. This must be done before the plugin
+ * chain is initialized.
+ * @param self
+ * @return True if the client is connected
+ */
+boolByte jackClientOpen(JackClient self);
+
+/**
+ * Register the ports of the client, connect them to the physical ports of the
+ * system, and process audio until the input file ends, the time limit is
+ * reached, or the program receives SIGINT or SIGTERM. The plugin chain must
+ * have been initialized and prepared for processing.
+ * @param self
+ * @param pluginChain Plugin chain to process
+ * @param inputSource Opened file which is played instead of the input ports,
+ * or NULL to process the input ports
+ * @param outputSource Opened file which the output is recorded to in addition
+ * to being sent to the output ports, or NULL
+ * @param controlChannel Opened control channel whose messages are applied at
+ * the start of each block, or NULL
+ * @param maxTimeInMs Time after which to stop, or 0 to run until stopped
+ * @return RETURN_CODE_SUCCESS if processing ran until it was stopped
+ */
+ReturnCode jackClientRun(JackClient self, PluginChain pluginChain,
+                         SampleSource inputSource, SampleSource outputSource,
+                         ControlChannel controlChannel,
+                         unsigned long maxTimeInMs);
+
+/**
+ * Disconnect from the JACK server and free the client
+ * @param self
+ */
+void freeJackClient(JackClient self);
+
+#endif
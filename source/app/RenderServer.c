@@ -0,0 +1,393 @@
+//
+// RenderServer.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "RenderServer.h"
+
+#include "app/BatchRenderer.h"
+#include "base/File.h"
+#include "logging/EventLogger.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if UNIX
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static volatile sig_atomic_t _renderServerSignalReceived = 0;
+
+static void _renderServerSignalHandler(int signalNumber) {
+  (void)signalNumber;
+  _renderServerSignalReceived = 1;
+}
+#endif
+
+RenderServer newRenderServer(const CharString socketPath,
+                             const CharString defaultPlugins,
+                             const LinkedList defaultParameters,
+                             const CharString pluginSearchRoot) {
+  RenderServer server = (RenderServer)malloc(sizeof(RenderServerMembers));
+
+  server->socketPath = newCharStringWithCString(socketPath->data);
+  server->numRequests = 0;
+  server->numRequestsFailed = 0;
+
+  server->_worker =
+      newRenderWorker(defaultPlugins, defaultParameters, pluginSearchRoot,
+                      RENDER_SERVER_MAX_CACHED_CHAINS, NULL);
+  server->_socket = -1;
+  server->_numClients = 0;
+  server->_stopRequested = false;
+
+  return server;
+}
+
+#if UNIX
+static boolByte _fillSocketAddress(const CharString socketPath,
+                                   struct sockaddr_un *address) {
+  memset(address, 0, sizeof(struct sockaddr_un));
+  address->sun_family = AF_UNIX;
+
+  if (strlen(socketPath->data) >= sizeof(address->sun_path)) {
+    logError("Socket path '%s' is too long", socketPath->data);
+    return false;
+  }
+
+  strncpy(address->sun_path, socketPath->data, sizeof(address->sun_path) - 1);
+  return true;
+}
+
+static boolByte _isServerListening(const struct sockaddr_un *address) {
+  int clientSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+  boolByte result;
+
+  if (clientSocket < 0) {
+    return false;
+  }
+
+  result = (boolByte)(connect(clientSocket, (const struct sockaddr *)address,
+                              sizeof(struct sockaddr_un)) == 0);
+  close(clientSocket);
+  return result;
+}
+
+static boolByte _sendResponse(int clientSocket, const char *response) {
+  size_t length = strlen(response);
+  ssize_t written;
+
+  while (length > 0) {
+    written = write(clientSocket, response, length);
+
+    if (written < 0 && errno == EINTR) {
+      continue;
+    } else if (written <= 0) {
+      logWarn("Could not send response to client, %s",
+              stringForLastError(errno));
+      return false;
+    }
+
+    response += written;
+    length -= (size_t)written;
+  }
+
+  return true;
+}
+
+static void _handleRequest(RenderServer self, int clientSocket,
+                           const char *request) {
+  BatchRenderer parser = newBatchRenderer();
+  char response[64];
+
+  self->numRequests++;
+
+  // Requests use the same syntax as a batch manifest line, so the manifest
+  // parser is reused here rather than duplicating its quoting rules
+  if (!batchRendererParseCsv(parser, request) || parser->numJobs != 1) {
+    self->numRequestsFailed++;
+    _sendResponse(clientSocket, "ERROR Invalid request\n");
+  } else if (!renderWorkerRender(self->_worker, parser->jobs[0])) {
+    self->numRequestsFailed++;
+    _sendResponse(clientSocket, "ERROR Render failed\n");
+  } else {
+    snprintf(response, 64, "OK %ld\n", parser->jobs[0]->numFramesWritten);
+    _sendResponse(clientSocket, response);
+  }
+
+  freeBatchRenderer(parser);
+}
+
+/**
+ * Handle all complete lines in the client's buffer. Any partial line is moved
+ * to the start of the buffer to wait for more data.
+ * @return False if the client should be disconnected
+ */
+static boolByte _handleClientRequests(RenderServer self,
+                                      RenderServerClient client) {
+  char *line = client->buffer->data;
+  char *bufferEnd = client->buffer->data + client->bufferLength;
+  char *end;
+
+  while (!self->_stopRequested &&
+         (end = memchr(line, '\n', (size_t)(bufferEnd - line))) != NULL) {
+    *end = '\0';
+
+    if (end > line && end[-1] == '\r') {
+      end[-1] = '\0';
+    }
+
+    if (*line == '\0') {
+      // Ignore empty lines
+    } else if (!strcmp(line, RENDER_SERVER_SHUTDOWN_COMMAND)) {
+      logInfo("Received shutdown request");
+      _sendResponse(client->socket, "OK\n");
+      self->_stopRequested = true;
+    } else {
+      _handleRequest(self, client->socket, line);
+    }
+
+    line = end + 1;
+  }
+
+  client->bufferLength = (size_t)(bufferEnd - line);
+  memmove(client->buffer->data, line, client->bufferLength);
+
+  if (client->bufferLength >= RENDER_SERVER_MAX_REQUEST_LENGTH) {
+    logWarn("Request is longer than %d bytes, closing connection",
+            RENDER_SERVER_MAX_REQUEST_LENGTH);
+    _sendResponse(client->socket, "ERROR Request too long\n");
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * Read whatever the client has sent and handle any complete requests.
+ * @return False if the client disconnected or should be disconnected
+ */
+static boolByte _readFromClient(RenderServer self, RenderServerClient client) {
+  ssize_t bytesRead =
+      read(client->socket, client->buffer->data + client->bufferLength,
+           RENDER_SERVER_MAX_REQUEST_LENGTH - client->bufferLength);
+
+  if (bytesRead < 0 && errno == EINTR) {
+    return true;
+  } else if (bytesRead <= 0) {
+    return false;
+  }
+
+  client->bufferLength += (size_t)bytesRead;
+  return _handleClientRequests(self, client);
+}
+
+static void _acceptClient(RenderServer self) {
+  int clientSocket = accept(self->_socket, NULL, NULL);
+  RenderServerClient client;
+
+  if (clientSocket < 0) {
+    logWarn("Could not accept connection, %s", stringForLastError(errno));
+    return;
+  } else if (self->_numClients == RENDER_SERVER_MAX_CLIENTS) {
+    logWarn("Too many connections, rejecting client");
+    _sendResponse(clientSocket, "ERROR Too many connections\n");
+    close(clientSocket);
+    return;
+  }
+
+  logDebug("Accepted connection");
+  client = &self->_clients[self->_numClients++];
+  client->socket = clientSocket;
+  client->buffer =
+      newCharStringWithCapacity(RENDER_SERVER_MAX_REQUEST_LENGTH + 1);
+  client->bufferLength = 0;
+}
+
+static void _closeClient(RenderServer self, unsigned int index) {
+  close(self->_clients[index].socket);
+  freeCharString(self->_clients[index].buffer);
+  self->_clients[index] = self->_clients[--self->_numClients];
+}
+#endif
+
+boolByte renderServerOpen(RenderServer self) {
+#if UNIX
+  struct sockaddr_un address;
+  File socketFile;
+  boolByte socketFileExists;
+
+  if (!_fillSocketAddress(self->socketPath, &address)) {
+    return false;
+  }
+
+  socketFile = newFileWithPath(self->socketPath);
+  socketFileExists = fileExists(socketFile);
+  freeFile(socketFile);
+
+  if (socketFileExists) {
+    if (_isServerListening(&address)) {
+      logError("Another server is already listening on '%s'",
+               self->socketPath->data);
+      return false;
+    }
+
+    logDebug("Removing stale socket '%s'", self->socketPath->data);
+    unlink(self->socketPath->data);
+  }
+
+  self->_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+
+  if (self->_socket < 0) {
+    logError("Could not create socket, %s", stringForLastError(errno));
+    return false;
+  }
+
+  if (bind(self->_socket, (struct sockaddr *)&address,
+           sizeof(struct sockaddr_un)) != 0 ||
+      listen(self->_socket, SOMAXCONN) != 0) {
+    logError("Could not listen on '%s', %s", self->socketPath->data,
+             stringForLastError(errno));
+    close(self->_socket);
+    self->_socket = -1;
+    return false;
+  }
+
+  logInfo("Listening on '%s'", self->socketPath->data);
+  return true;
+#else
+  logUnsupportedFeature("Render server on this platform");
+  return false;
+#endif
+}
+
+ReturnCode renderServerRun(RenderServer self) {
+#if UNIX
+  struct sigaction action;
+  struct sigaction oldInterruptAction;
+  struct sigaction oldTerminateAction;
+  struct sigaction oldPipeAction;
+  struct pollfd pollDescriptors[RENDER_SERVER_MAX_CLIENTS + 1];
+  unsigned int numPollDescriptors;
+  ReturnCode result = RETURN_CODE_SUCCESS;
+  unsigned int i;
+
+  if (self->_socket < 0) {
+    logInternalError("Render server was not opened");
+    return RETURN_CODE_INTERNAL_ERROR;
+  }
+
+  // The handlers are installed without SA_RESTART, so that a blocking poll()
+  // is interrupted and the server can shut down cleanly.
+  // Clients which disconnect early should not kill the server with SIGPIPE.
+  memset(&action, 0, sizeof(action));
+  sigemptyset(&action.sa_mask);
+  action.sa_handler = _renderServerSignalHandler;
+  sigaction(SIGINT, &action, &oldInterruptAction);
+  sigaction(SIGTERM, &action, &oldTerminateAction);
+  action.sa_handler = SIG_IGN;
+  sigaction(SIGPIPE, &action, &oldPipeAction);
+  _renderServerSignalReceived = 0;
+
+  while (!self->_stopRequested && !_renderServerSignalReceived) {
+    pollDescriptors[0].fd = self->_socket;
+    pollDescriptors[0].events = POLLIN;
+
+    for (i = 0; i < self->_numClients; i++) {
+      pollDescriptors[i + 1].fd = self->_clients[i].socket;
+      pollDescriptors[i + 1].events = POLLIN;
+    }
+
+    numPollDescriptors = self->_numClients + 1;
+
+    if (poll(pollDescriptors, numPollDescriptors, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      logError("Could not wait for connections, %s",
+               stringForLastError(errno));
+      result = RETURN_CODE_IO_ERROR;
+      break;
+    }
+
+    // Clients are checked in reverse order so that closing one (which moves
+    // the last client into its place) does not skip any descriptors
+    for (i = numPollDescriptors - 1; i > 0 && !self->_stopRequested; i--) {
+      if (pollDescriptors[i].revents != 0 &&
+          !_readFromClient(self, &self->_clients[i - 1])) {
+        _closeClient(self, i - 1);
+      }
+    }
+
+    if ((pollDescriptors[0].revents & POLLIN) && !self->_stopRequested) {
+      _acceptClient(self);
+    }
+  }
+
+  while (self->_numClients > 0) {
+    _closeClient(self, 0);
+  }
+
+  if (_renderServerSignalReceived) {
+    logInfo("Received signal, shutting down");
+  }
+
+  logInfo("Served %ld requests, %ld failed, %ld plugin chains loaded",
+          self->numRequests, self->numRequestsFailed,
+          self->_worker->numChainsLoaded);
+  sigaction(SIGINT, &oldInterruptAction, NULL);
+  sigaction(SIGTERM, &oldTerminateAction, NULL);
+  sigaction(SIGPIPE, &oldPipeAction, NULL);
+  close(self->_socket);
+  self->_socket = -1;
+  unlink(self->socketPath->data);
+  return result;
+#else
+  logUnsupportedFeature("Render server on this platform");
+  return RETURN_CODE_UNSUPPORTED_FEATURE;
+#endif
+}
+
+void freeRenderServer(RenderServer self) {
+  if (self == NULL) {
+    return;
+  }
+
+#if UNIX
+  if (self->_socket >= 0) {
+    close(self->_socket);
+    unlink(self->socketPath->data);
+  }
+#endif
+
+  freeRenderWorker(self->_worker);
+  freeCharString(self->socketPath);
+  free(self);
+}
@@ -0,0 +1,122 @@
+//
+// RenderServer.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_RenderServer_h
+#define MrsWatson_RenderServer_h
+
+#include "app/RenderWorker.h"
+#include "app/ReturnCodes.h"
+#include "base/CharString.h"
+#include "base/LinkedList.h"
+
+#define RENDER_SERVER_MAX_CACHED_CHAINS 8
+#define RENDER_SERVER_MAX_CLIENTS 16
+#define RENDER_SERVER_MAX_REQUEST_LENGTH 4096
+#define RENDER_SERVER_SHUTDOWN_COMMAND "shutdown"
+
+typedef struct {
+  int socket;
+  // Data received from the client which does not yet form a complete request
+  CharString buffer;
+  size_t bufferLength;
+} RenderServerClientMembers;
+typedef RenderServerClientMembers *RenderServerClient;
+
+/**
+ * Long-running render daemon which accepts jobs over a Unix domain socket.
+ *
+ * Loading plugins (and particularly large sampler instruments) can take much
+ * longer than rendering a short file, so the server keeps the most recently
+ * used plugin chains loaded between requests and only resets their state
+ * before each job. Chains are identified by their plugin string (including any
+ * presets), their parameters and the audio format of the input.
+ *
+ * Clients send one request per line, in the same format as a line of a CSV
+ * batch manifest:
+ *
+ *   INPUT,OUTPUT[,PLUGINS[,PARAMETERS]]
+ *
+ * For each request the server replies with a single line, either
+ * "OK <frames written>" or "ERROR <message>". Several requests may be sent on
+ * the same connection, and several clients may be connected at once, however
+ * jobs are rendered one at a time in the order that they are received.
+ * Sending "shutdown" stops the server.
+ */
+typedef struct {
+  CharString socketPath;
+  unsigned long numRequests;
+  unsigned long numRequestsFailed;
+
+  // Private fields
+  RenderWorker _worker;
+  int _socket;
+  RenderServerClientMembers _clients[RENDER_SERVER_MAX_CLIENTS];
+  unsigned int _numClients;
+  volatile boolByte _stopRequested;
+} RenderServerMembers;
+typedef RenderServerMembers *RenderServer;
+
+/**
+ * Create a new render server. The audio settings of the calling thread are
+ * used as the starting point for each job, as described in newRenderWorker().
+ * @param socketPath Path of the socket to listen on
+ * @param defaultPlugins Plugin chain used for requests which don't specify one
+ * @param defaultParameters List of parameter strings (as given by --parameter)
+ * which are applied to requests using the default chain, or NULL for none
+ * @param pluginSearchRoot User-supplied plugin search root, may be empty
+ * @return Initialized object
+ */
+RenderServer newRenderServer(const CharString socketPath,
+                             const CharString defaultPlugins,
+                             const LinkedList defaultParameters,
+                             const CharString pluginSearchRoot);
+
+/**
+ * Create the socket and start listening for connections. If a socket file
+ * already exists at the given path but no server is listening on it, then it
+ * is assumed to have been left behind by a previous server and is replaced.
+ * @param self
+ * @return True if the server is listening
+ */
+boolByte renderServerOpen(RenderServer self);
+
+/**
+ * Accept and serve connections until a shutdown request is received, or the
+ * process receives SIGINT or SIGTERM. The socket file is removed afterwards.
+ * renderServerOpen() must have been called first.
+ * @param self
+ * @return RETURN_CODE_SUCCESS if the server was stopped normally, or other code
+ * if the socket failed
+ */
+ReturnCode renderServerRun(RenderServer self);
+
+/**
+ * Free the server, closing its socket and any loaded plugins.
+ * @param self
+ */
+void freeRenderServer(RenderServer self);
+
+#endif
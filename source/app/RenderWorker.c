@@ -0,0 +1,358 @@
+//
+// RenderWorker.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "RenderWorker.h"
+
+#include "io/SampleSource.h"
+#include "io/SampleSourcePcm.h"
+#include "logging/EventLogger.h"
+#include "plugin/PluginChainRenderer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+RenderJob newRenderJob(const char *inputName, const char *outputName,
+                       const char *plugins, const char *parameters) {
+  RenderJob job = (RenderJob)malloc(sizeof(RenderJobMembers));
+  job->inputName = newCharStringWithCString(inputName);
+  job->outputName = newCharStringWithCString(outputName);
+  job->plugins = newCharStringWithCString(plugins);
+  job->parameters = newCharStringWithCString(parameters);
+  job->numFramesWritten = 0;
+  return job;
+}
+
+void freeRenderJob(RenderJob self) {
+  if (self != NULL) {
+    freeCharString(self->inputName);
+    freeCharString(self->outputName);
+    freeCharString(self->plugins);
+    freeCharString(self->parameters);
+    free(self);
+  }
+}
+
+RenderWorker newRenderWorker(const CharString defaultPlugins,
+                             const LinkedList defaultParameters,
+                             const CharString pluginSearchRoot,
+                             unsigned int maxChains, Mutex pluginLoadMutex) {
+  RenderWorker worker = (RenderWorker)malloc(sizeof(RenderWorkerMembers));
+
+  worker->maxChains = maxChains > 0 ? maxChains : 1;
+  worker->numJobsRendered = 0;
+  worker->numChainsLoaded = 0;
+
+  worker->_initialSettings = newAudioSettingsCopy();
+  worker->_context = newProcessingContext();
+  worker->_chains = (RenderWorkerChain *)malloc(sizeof(RenderWorkerChain) *
+                                                worker->maxChains);
+  worker->_numChains = 0;
+  worker->_numChainUses = 0;
+  worker->_defaultPlugins = newCharStringWithCString(
+      defaultPlugins != NULL ? defaultPlugins->data : NULL);
+  worker->_defaultParameters = defaultParameters;
+  worker->_pluginSearchRoot = newCharStringWithCString(
+      pluginSearchRoot != NULL ? pluginSearchRoot->data : NULL);
+  worker->_pluginLoadMutex = pluginLoadMutex;
+
+  return worker;
+}
+
+static boolByte _setJobParameters(PluginChain pluginChain,
+                                  const CharString parameters) {
+  LinkedList parameterStrings;
+  LinkedList parameterList;
+  LinkedListIterator iterator;
+  boolByte result;
+
+  if (charStringIsEmpty(parameters)) {
+    return true;
+  }
+
+  // pluginChainSetParameters() expects plain C strings
+  parameterStrings =
+      charStringSplit(parameters, RENDER_JOB_PARAMETER_SEPARATOR);
+  parameterList = newLinkedList();
+
+  for (iterator = parameterStrings; iterator != NULL;
+       iterator = iterator->nextItem) {
+    if (iterator->item != NULL) {
+      linkedListAppend(parameterList, ((CharString)iterator->item)->data);
+    }
+  }
+
+  result = pluginChainSetParameters(pluginChain, parameterList);
+  freeLinkedList(parameterList);
+  freeLinkedListAndItems(parameterStrings,
+                         (LinkedListFreeItemFunc)freeCharString);
+  return result;
+}
+
+static void _freeWorkerChain(RenderWorkerChain chain) {
+  pluginChainShutdown(chain->pluginChain);
+  freePluginChain(chain->pluginChain);
+  freeCharString(chain->key);
+  free(chain);
+}
+
+static PluginChain _loadChain(RenderWorker self, const CharString plugins,
+                              boolByte usesDefaultChain,
+                              const CharString parameters) {
+  PluginChain pluginChain = newPluginChain();
+  boolByte result = true;
+
+  // Helper threads which are started for the chain inherit the chain from the
+  // current context
+  self->_context->pluginChain = pluginChain;
+
+  if (self->_pluginLoadMutex != NULL) {
+    mutexLock(self->_pluginLoadMutex);
+  }
+
+  if (!pluginChainAddFromArgumentString(pluginChain, plugins,
+                                        self->_pluginSearchRoot) ||
+      pluginChain->numPlugins == 0) {
+    logError("Plugin chain '%s' could not be constructed", plugins->data);
+    result = false;
+  } else if (pluginChainInitialize(pluginChain) != RETURN_CODE_SUCCESS) {
+    logError("Could not initialize plugin chain '%s'", plugins->data);
+    result = false;
+  }
+
+  if (self->_pluginLoadMutex != NULL) {
+    mutexUnlock(self->_pluginLoadMutex);
+  }
+
+  if (result && usesDefaultChain && self->_defaultParameters != NULL &&
+      !pluginChainSetParameters(pluginChain, self->_defaultParameters)) {
+    result = false;
+  } else if (result && !_setJobParameters(pluginChain, parameters)) {
+    result = false;
+  }
+
+  if (!result) {
+    pluginChainShutdown(pluginChain);
+    freePluginChain(pluginChain);
+    return NULL;
+  }
+
+  pluginChainPrepareForProcessing(pluginChain);
+  self->numChainsLoaded++;
+  return pluginChain;
+}
+
+static PluginChain _prepareChain(RenderWorker self, const RenderJob job) {
+  boolByte usesDefaultChain = charStringIsEmpty(job->plugins);
+  const CharString plugins =
+      usesDefaultChain ? self->_defaultPlugins : job->plugins;
+  CharString key = newCharStringWithCapacity(
+      strlen(plugins->data) + strlen(job->parameters->data) + 64);
+  RenderWorkerChain chain = NULL;
+  unsigned int leastRecentlyUsed = 0;
+  unsigned int i;
+
+  // Plugins are initialized with the current sample rate and blocksize, so
+  // a chain can only be reused for jobs with the same audio format
+  snprintf(key->data, key->capacity, "%s|%s|%g|%d|%ld", plugins->data,
+           job->parameters->data, getSampleRate(), getNumChannels(),
+           getBlocksize());
+
+  for (i = 0; i < self->_numChains; i++) {
+    if (charStringIsEqualTo(self->_chains[i]->key, key, false)) {
+      chain = self->_chains[i];
+      break;
+    } else if (self->_chains[i]->lastUsed <
+               self->_chains[leastRecentlyUsed]->lastUsed) {
+      leastRecentlyUsed = i;
+    }
+  }
+
+  if (chain != NULL) {
+    logDebug("Reusing plugin chain '%s'", plugins->data);
+    self->_context->pluginChain = chain->pluginChain;
+    pluginChainReset(chain->pluginChain);
+    freeCharString(key);
+  } else {
+    if (self->_numChains == self->maxChains) {
+      _freeWorkerChain(self->_chains[leastRecentlyUsed]);
+      self->_chains[leastRecentlyUsed] = self->_chains[--self->_numChains];
+    }
+
+    chain = (RenderWorkerChain)malloc(sizeof(RenderWorkerChainMembers));
+    chain->key = key;
+    chain->pluginChain =
+        _loadChain(self, plugins, usesDefaultChain, job->parameters);
+
+    if (chain->pluginChain == NULL) {
+      freeCharString(key);
+      free(chain);
+      return NULL;
+    }
+
+    self->_chains[self->_numChains++] = chain;
+  }
+
+  chain->lastUsed = ++self->_numChainUses;
+  return chain->pluginChain;
+}
+
+/**
+ * Open the input of a job, which also sets the sample rate and channel count
+ * of the calling thread to those of the input.
+ */
+static SampleSource _openJobInput(const RenderJob job) {
+  SampleSource inputSource = sampleSourceFactory(job->inputName);
+
+  if (inputSource == NULL) {
+    logError("Input source '%s' has an unsupported type", job->inputName->data);
+    return NULL;
+  }
+
+  if (inputSource->sampleSourceType == SAMPLE_SOURCE_TYPE_PCM) {
+    sampleSourcePcmSetSampleRate(inputSource, getSampleRate());
+    sampleSourcePcmSetNumChannels(inputSource, getNumChannels());
+  }
+
+  if (!inputSource->openSampleSource(inputSource, SAMPLE_SOURCE_OPEN_READ)) {
+    logError("Input source '%s' could not be opened", job->inputName->data);
+    freeSampleSource(inputSource);
+    return NULL;
+  }
+
+  return inputSource;
+}
+
+static boolByte _renderJob(RenderWorker self, RenderJob job) {
+  SampleSource inputSource = _openJobInput(job);
+  SampleSource outputSource = NULL;
+  PluginChain pluginChain;
+  PluginChainRenderer renderer;
+
+  if (inputSource == NULL) {
+    return false;
+  }
+
+  // The output is opened after the input, so that it has the input's format
+  outputSource = sampleSourceFactory(job->outputName);
+
+  if (outputSource == NULL ||
+      !outputSource->openSampleSource(outputSource, SAMPLE_SOURCE_OPEN_WRITE)) {
+    logError("Output source '%s' could not be opened", job->outputName->data);
+    inputSource->closeSampleSource(inputSource);
+    freeSampleSource(inputSource);
+    freeSampleSource(outputSource);
+    return false;
+  }
+
+  if ((pluginChain = _prepareChain(self, job)) == NULL) {
+    inputSource->closeSampleSource(inputSource);
+    outputSource->closeSampleSource(outputSource);
+    freeSampleSource(inputSource);
+    freeSampleSource(outputSource);
+    return false;
+  }
+
+  logInfo("Rendering '%s' to '%s'", job->inputName->data,
+          job->outputName->data);
+  self->_context->audioClock->currentFrame = 0;
+  self->_context->audioClock->isPlaying = false;
+  self->_context->audioClock->transportChanged = false;
+  renderer = newPluginChainRenderer(pluginChain, outputSource);
+  pluginChainRendererRender(renderer, inputSource);
+  freePluginChainRenderer(renderer);
+
+  audioClockStop(self->_context->audioClock);
+  inputSource->closeSampleSource(inputSource);
+  outputSource->closeSampleSource(outputSource);
+  job->numFramesWritten = outputSource->numSamplesProcessed / getNumChannels();
+  logDebug("Wrote %ld frames to '%s'", job->numFramesWritten,
+           job->outputName->data);
+
+  freeSampleSource(inputSource);
+  freeSampleSource(outputSource);
+  return true;
+}
+
+static void _beginJob(RenderWorker self) {
+  // Each job starts with the worker's initial settings, since the previous
+  // input may have changed the sample rate or channel count
+  memcpy(self->_context->settings, self->_initialSettings,
+         sizeof(AudioSettingsMembers));
+  processingContextMakeCurrent(self->_context);
+}
+
+static void _endJob(RenderWorker self) {
+  // The chain may be freed before the next job if it is evicted from the cache
+  self->_context->pluginChain = NULL;
+  processingContextMakeCurrent(NULL);
+}
+
+boolByte renderWorkerPrepare(RenderWorker self, const RenderJob job) {
+  SampleSource inputSource;
+  boolByte result = false;
+
+  _beginJob(self);
+  inputSource = _openJobInput(job);
+
+  if (inputSource != NULL) {
+    result = (boolByte)(_prepareChain(self, job) != NULL);
+    inputSource->closeSampleSource(inputSource);
+    freeSampleSource(inputSource);
+  }
+
+  _endJob(self);
+  return result;
+}
+
+boolByte renderWorkerRender(RenderWorker self, RenderJob job) {
+  boolByte result;
+
+  _beginJob(self);
+  result = _renderJob(self, job);
+  self->numJobsRendered++;
+  _endJob(self);
+  return result;
+}
+
+void freeRenderWorker(RenderWorker self) {
+  unsigned int i;
+
+  if (self == NULL) {
+    return;
+  }
+
+  for (i = 0; i < self->_numChains; i++) {
+    _freeWorkerChain(self->_chains[i]);
+  }
+
+  free(self->_chains);
+  freeAudioSettingsCopy(self->_initialSettings);
+  freeProcessingContext(self->_context);
+  freeCharString(self->_defaultPlugins);
+  freeCharString(self->_pluginSearchRoot);
+  free(self);
+}
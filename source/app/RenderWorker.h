@@ -0,0 +1,156 @@
+//
+// RenderWorker.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_RenderWorker_h
+#define MrsWatson_RenderWorker_h
+
+#include "audio/AudioSettings.h"
+#include "base/CharString.h"
+#include "base/LinkedList.h"
+#include "base/Thread.h"
+#include "plugin/PluginChain.h"
+#include "plugin/ProcessingContext.h"
+
+#define RENDER_JOB_PARAMETER_SEPARATOR ';'
+
+/**
+ * A single input file which should be rendered to an output file.
+ */
+typedef struct {
+  CharString inputName;
+  CharString outputName;
+  // Plugin chain, in the same format as --plugin (including any presets). If
+  // empty, then the worker's default chain is used.
+  CharString plugins;
+  // Parameters for the first plugin, as INDEX,VALUE pairs separated by
+  // RENDER_JOB_PARAMETER_SEPARATOR. May be empty.
+  CharString parameters;
+  // Number of frames written to the output, set once the job is rendered
+  unsigned long numFramesWritten;
+} RenderJobMembers;
+typedef RenderJobMembers *RenderJob;
+
+/**
+ * Create a new render job.
+ * @param inputName Input file
+ * @param outputName Output file
+ * @param plugins Plugin chain, or NULL or empty to use the default chain
+ * @param parameters Parameters for the first plugin, or NULL or empty for none
+ * @return Initialized object
+ */
+RenderJob newRenderJob(const char *inputName, const char *outputName,
+                       const char *plugins, const char *parameters);
+
+/**
+ * Free a render job
+ * @param self
+ */
+void freeRenderJob(RenderJob self);
+
+typedef struct {
+  CharString key;
+  PluginChain pluginChain;
+  unsigned long lastUsed;
+} RenderWorkerChainMembers;
+typedef RenderWorkerChainMembers *RenderWorkerChain;
+
+/**
+ * Renders jobs one after another while keeping recently used plugin chains
+ * loaded. When a job uses a chain which is already loaded with the same
+ * parameters and audio format, the plugins are only reset (ie, suspended and
+ * resumed) rather than reloaded, so the cost of finding and opening plugins is
+ * only paid the first time that a chain is used.
+ *
+ * Each worker has its own processing context, which is made current for the
+ * calling thread while a job is rendered. A worker may only be used by
+ * one thread at a time, but several workers may render on different threads.
+ */
+typedef struct {
+  unsigned int maxChains;
+  unsigned long numJobsRendered;
+  unsigned long numChainsLoaded;
+
+  // Private fields
+  AudioSettings _initialSettings;
+  ProcessingContext _context;
+  RenderWorkerChain *_chains;
+  unsigned int _numChains;
+  unsigned long _numChainUses;
+  CharString _defaultPlugins;
+  LinkedList _defaultParameters;
+  CharString _pluginSearchRoot;
+  Mutex _pluginLoadMutex;
+} RenderWorkerMembers;
+typedef RenderWorkerMembers *RenderWorker;
+
+/**
+ * Create a new render worker. The audio settings of the calling thread are
+ * copied and used as the starting point for each job, and the input file of a
+ * job may then override the sample rate and channel count as usual.
+ * @param defaultPlugins Plugin chain used for jobs which don't specify one
+ * @param defaultParameters List of parameter strings (as given by --parameter)
+ * which are applied to jobs using the default chain, or NULL for none. This
+ * list must remain valid for the lifetime of the worker.
+ * @param pluginSearchRoot User-supplied plugin search root, may be empty
+ * @param maxChains Maximum number of chains to keep loaded. When a new chain is
+ * needed and the limit has been reached, the least recently used chain is
+ * closed.
+ * @param pluginLoadMutex If several workers are used at the same time, they
+ * should share a mutex which is held while loading plugins, since many plugins
+ * are not safe to instantiate from several threads at once. May be NULL.
+ * @return Initialized object
+ */
+RenderWorker newRenderWorker(const CharString defaultPlugins,
+                             const LinkedList defaultParameters,
+                             const CharString pluginSearchRoot,
+                             unsigned int maxChains, Mutex pluginLoadMutex);
+
+/**
+ * Load the plugin chain needed by a job without rendering it. The input file
+ * is opened to find the job's audio format, but no output is written. This
+ * can be used to make sure that a chain is already loaded before the worker
+ * is copied to another process, as done by batchRendererRunForked().
+ * @param self
+ * @param job Job to prepare
+ * @return True if the job's input could be opened and its chain loaded
+ */
+boolByte renderWorkerPrepare(RenderWorker self, const RenderJob job);
+
+/**
+ * Render a single job.
+ * @param self
+ * @param job Job to render, on success its numFramesWritten field is updated
+ * @return True if the job was rendered
+ */
+boolByte renderWorkerRender(RenderWorker self, RenderJob job);
+
+/**
+ * Close all plugin chains and free the worker.
+ * @param self
+ */
+void freeRenderWorker(RenderWorker self);
+
+#endif
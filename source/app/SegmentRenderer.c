@@ -0,0 +1,490 @@
+//
+// SegmentRenderer.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "SegmentRenderer.h"
+
+#include "base/TaskScheduler.h"
+#include "io/SampleSourcePcm.h"
+#include "logging/EventLogger.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+SegmentRenderer newSegmentRenderer(const CharString plugins,
+                                   const LinkedList parameters,
+                                   const CharString pluginSearchRoot) {
+  SegmentRenderer renderer =
+      (SegmentRenderer)malloc(sizeof(SegmentRendererMembers));
+
+  renderer->segments = NULL;
+  renderer->numSegments = 0;
+  renderer->numFrames = 0;
+  renderer->overlapFrames = 0;
+  renderer->tailFrames = 0;
+
+  renderer->_inputName = newCharString();
+  renderer->_plugins =
+      newCharStringWithCString(plugins != NULL ? plugins->data : NULL);
+  renderer->_parameters = parameters;
+  renderer->_pluginSearchRoot = newCharStringWithCString(
+      pluginSearchRoot != NULL ? pluginSearchRoot->data : NULL);
+
+  return renderer;
+}
+
+static void _freeRenderSegment(RenderSegment self) {
+  if (self->_pluginChain != NULL) {
+    pluginChainShutdown(self->_pluginChain);
+    freePluginChain(self->_pluginChain);
+  }
+
+  if (self->_output != NULL) {
+    fclose(self->_output);
+  }
+
+  freeProcessingContext(self->_context);
+  free(self);
+}
+
+static void _freeSegments(SegmentRenderer self) {
+  unsigned int i;
+
+  for (i = 0; i < self->numSegments; i++) {
+    _freeRenderSegment(self->segments[i]);
+  }
+
+  free(self->segments);
+  self->segments = NULL;
+  self->numSegments = 0;
+}
+
+unsigned int segmentRendererSplit(SegmentRenderer self, unsigned long numFrames,
+                                  unsigned int numSegments,
+                                  unsigned long overlapFrames,
+                                  unsigned long tailFrames) {
+  unsigned long minSegmentLength = (unsigned long)getBlocksize();
+  unsigned long segmentLength;
+  unsigned long preRoll = overlapFrames + tailFrames;
+  unsigned long nextStart;
+  RenderSegment segment;
+  unsigned int i;
+
+  _freeSegments(self);
+
+  if (overlapFrames > minSegmentLength) {
+    minSegmentLength = overlapFrames;
+  }
+
+  if (numSegments == 0) {
+    numSegments = 1;
+  }
+
+  if (numFrames / numSegments < minSegmentLength) {
+    numSegments = (unsigned int)(numFrames / minSegmentLength);
+
+    if (numSegments == 0) {
+      numSegments = 1;
+    }
+  }
+
+  self->numFrames = numFrames;
+  self->overlapFrames = overlapFrames;
+  self->tailFrames = tailFrames;
+  self->numSegments = numSegments;
+  self->segments = (RenderSegment *)malloc(sizeof(RenderSegment) * numSegments);
+  segmentLength = numFrames / numSegments;
+
+  for (i = 0; i < numSegments; i++) {
+    segment = (RenderSegment)malloc(sizeof(RenderSegmentMembers));
+    segment->index = i;
+    segment->startFrame = i * segmentLength;
+    segment->preRollFrame =
+        segment->startFrame > preRoll ? segment->startFrame - preRoll : 0;
+    nextStart = i + 1 < numSegments ? (i + 1) * segmentLength : numFrames;
+    segment->endFrame = nextStart + (i + 1 < numSegments ? overlapFrames : 0);
+
+    if (segment->endFrame > numFrames) {
+      segment->endFrame = numFrames;
+    }
+
+    segment->succeeded = false;
+    segment->_renderer = self;
+    segment->_pluginChain = NULL;
+    segment->_context = newProcessingContext();
+    segment->_output = NULL;
+    self->segments[i] = segment;
+  }
+
+  return numSegments;
+}
+
+/**
+ * Count the frames in an input by reading it to the end, since sample sources
+ * do not know their length in advance.
+ */
+static unsigned long _countInputFrames(SampleSource inputSource) {
+  SampleBuffer buffer = newSampleBuffer(getNumChannels(), getBlocksize());
+  boolByte finishedReading = false;
+
+  while (!finishedReading) {
+    buffer->blocksize = getBlocksize();
+    inputSource->readSampleBlock(inputSource, buffer);
+    finishedReading = (boolByte)(buffer->blocksize < getBlocksize());
+  }
+
+  freeSampleBuffer(buffer);
+  return inputSource->numSamplesProcessed / getNumChannels();
+}
+
+static PluginChain _loadChain(SegmentRenderer self) {
+  PluginChain pluginChain = newPluginChain();
+  boolByte result = true;
+
+  if (!pluginChainAddFromArgumentString(pluginChain, self->_plugins,
+                                        self->_pluginSearchRoot) ||
+      pluginChain->numPlugins == 0) {
+    logError("Plugin chain '%s' could not be constructed",
+             self->_plugins->data);
+    result = false;
+  } else if (pluginChainInitialize(pluginChain) != RETURN_CODE_SUCCESS) {
+    logError("Could not initialize plugin chain '%s'", self->_plugins->data);
+    result = false;
+  } else if (self->_parameters != NULL &&
+             !pluginChainSetParameters(pluginChain, self->_parameters)) {
+    result = false;
+  }
+
+  if (!result) {
+    pluginChainShutdown(pluginChain);
+    freePluginChain(pluginChain);
+    return NULL;
+  }
+
+  pluginChainPrepareForProcessing(pluginChain);
+  return pluginChain;
+}
+
+static SampleSource _openSegmentInput(SegmentRenderer self) {
+  SampleSource inputSource = sampleSourceFactory(self->_inputName);
+
+  if (inputSource == NULL) {
+    return NULL;
+  }
+
+  if (inputSource->sampleSourceType == SAMPLE_SOURCE_TYPE_PCM) {
+    sampleSourcePcmSetSampleRate(inputSource, getSampleRate());
+    sampleSourcePcmSetNumChannels(inputSource, getNumChannels());
+  }
+
+  if (!inputSource->openSampleSource(inputSource, SAMPLE_SOURCE_OPEN_READ)) {
+    logError("Input source '%s' could not be opened", self->_inputName->data);
+    freeSampleSource(inputSource);
+    return NULL;
+  }
+
+  return inputSource;
+}
+
+static boolByte _writeSegmentFrames(RenderSegment self, SampleBuffer buffer,
+                                    unsigned long offset,
+                                    unsigned long numFrames) {
+  Sample *frame = (Sample *)malloc(sizeof(Sample) * buffer->numChannels);
+  unsigned long i;
+  ChannelCount channel;
+  boolByte result = true;
+
+  for (i = offset; result && i < offset + numFrames; i++) {
+    for (channel = 0; channel < buffer->numChannels; channel++) {
+      frame[channel] = buffer->samples[channel][i];
+    }
+
+    if (fwrite(frame, sizeof(Sample), buffer->numChannels, self->_output) !=
+        buffer->numChannels) {
+      logError("Could not write rendered frames of segment %d", self->index);
+      result = false;
+    }
+  }
+
+  free(frame);
+  return result;
+}
+
+static boolByte _renderSegment(RenderSegment self) {
+  SegmentRenderer renderer = (SegmentRenderer)self->_renderer;
+  SampleSource inputSource = _openSegmentInput(renderer);
+  SampleBuffer inputBuffer;
+  SampleBuffer outputBuffer;
+  unsigned long framesToSkip;
+  unsigned long framesToWrite = self->endFrame - self->startFrame;
+  unsigned long numFrames;
+  boolByte finishedReading = false;
+  boolByte result = true;
+
+  if (inputSource == NULL) {
+    return false;
+  }
+
+  if (!sampleSourceSeek(inputSource, self->preRollFrame)) {
+    logError("Could not seek to frame %ld of '%s'", self->preRollFrame,
+             renderer->_inputName->data);
+    inputSource->closeSampleSource(inputSource);
+    freeSampleSource(inputSource);
+    return false;
+  }
+
+  logDebug("Rendering segment %d from frame %ld to %ld", self->index,
+           self->startFrame, self->endFrame);
+  self->_context->audioClock->currentFrame = self->preRollFrame;
+  framesToSkip = self->startFrame - self->preRollFrame +
+                 pluginChainGetProcessingDelay(self->_pluginChain);
+  inputBuffer = newSampleBuffer(getNumChannels(), getBlocksize());
+  outputBuffer = newSampleBuffer(getNumChannels(), getBlocksize());
+
+  while (result && framesToWrite > 0) {
+    inputBuffer->blocksize = getBlocksize();
+    sampleBufferClear(inputBuffer);
+
+    // Once the input has ended, the chain is fed silence until the processing
+    // delay has been flushed
+    if (!finishedReading) {
+      inputSource->readSampleBlock(inputSource, inputBuffer);
+      finishedReading = (boolByte)(inputBuffer->blocksize < getBlocksize());
+    }
+
+    inputBuffer->blocksize = getBlocksize();
+    outputBuffer->blocksize = getBlocksize();
+    pluginChainProcessAudio(self->_pluginChain, inputBuffer, outputBuffer);
+    advanceAudioClock(self->_context->audioClock, outputBuffer->blocksize);
+
+    if (framesToSkip >= outputBuffer->blocksize) {
+      framesToSkip -= outputBuffer->blocksize;
+    } else {
+      numFrames = outputBuffer->blocksize - framesToSkip;
+      numFrames = numFrames < framesToWrite ? numFrames : framesToWrite;
+      result = _writeSegmentFrames(self, outputBuffer, framesToSkip, numFrames);
+      framesToWrite -= numFrames;
+      framesToSkip = 0;
+    }
+  }
+
+  audioClockStop(self->_context->audioClock);
+  inputSource->closeSampleSource(inputSource);
+  freeSampleSource(inputSource);
+  freeSampleBuffer(inputBuffer);
+  freeSampleBuffer(outputBuffer);
+  return result;
+}
+
+static void _renderSegmentTask(void *userData) {
+  RenderSegment self = (RenderSegment)userData;
+
+  self->_context->pluginChain = self->_pluginChain;
+  processingContextMakeCurrent(self->_context);
+  self->succeeded = _renderSegment(self);
+  processingContextMakeCurrent(NULL);
+}
+
+static boolByte _readSegmentFrames(RenderSegment self, SampleBuffer buffer,
+                                   unsigned long numFrames) {
+  Sample *frame = (Sample *)malloc(sizeof(Sample) * buffer->numChannels);
+  unsigned long i;
+  ChannelCount channel;
+  boolByte result = true;
+
+  for (i = 0; result && i < numFrames; i++) {
+    if (fread(frame, sizeof(Sample), buffer->numChannels, self->_output) !=
+        buffer->numChannels) {
+      logError("Could not read rendered frames of segment %d", self->index);
+      result = false;
+    }
+
+    for (channel = 0; result && channel < buffer->numChannels; channel++) {
+      buffer->samples[channel][i] = frame[channel];
+    }
+  }
+
+  buffer->blocksize = numFrames;
+  free(frame);
+  return result;
+}
+
+/**
+ * Write the frames of a segment up to the start of the next one. The start of
+ * the segment is crossfaded with the rendered overlap of the previous segment,
+ * which is read from where the previous call to this function left off.
+ */
+static boolByte _writeSegment(RenderSegment self, RenderSegment previous,
+                              RenderSegment next, SampleSource outputSource) {
+  SampleBuffer buffer = newSampleBuffer(getNumChannels(), getBlocksize());
+  SampleBuffer previousBuffer = NULL;
+  unsigned long fadeLength = 0;
+  // The overlap at the end of this segment is written by the next one
+  unsigned long numFrames =
+      (next != NULL ? next->startFrame : self->endFrame) - self->startFrame;
+  unsigned long frame = 0;
+  unsigned long blockFrames;
+  unsigned long i;
+  ChannelCount channel;
+  Sample gain;
+  boolByte result = true;
+
+  if (previous != NULL) {
+    fadeLength = previous->endFrame - self->startFrame;
+    previousBuffer = newSampleBuffer(getNumChannels(), getBlocksize());
+  }
+
+  rewind(self->_output);
+
+  while (result && frame < numFrames) {
+    blockFrames = numFrames - frame < (unsigned long)getBlocksize()
+                      ? numFrames - frame
+                      : (unsigned long)getBlocksize();
+    result = _readSegmentFrames(self, buffer, blockFrames);
+
+    if (result && frame < fadeLength) {
+      blockFrames = fadeLength - frame < blockFrames ? fadeLength - frame
+                                                     : blockFrames;
+      result = _readSegmentFrames(previous, previousBuffer, blockFrames);
+
+      for (i = 0; result && i < blockFrames; i++) {
+        gain = (Sample)(frame + i + 0.5) / (Sample)fadeLength;
+
+        for (channel = 0; channel < buffer->numChannels; channel++) {
+          buffer->samples[channel][i] =
+              buffer->samples[channel][i] * gain +
+              previousBuffer->samples[channel][i] * (1.0f - gain);
+        }
+      }
+    }
+
+    if (result) {
+      outputSource->writeSampleBlock(outputSource, buffer);
+      frame += buffer->blocksize;
+    }
+  }
+
+  freeSampleBuffer(buffer);
+  freeSampleBuffer(previousBuffer);
+  return result;
+}
+
+ReturnCode segmentRendererRun(SegmentRenderer self, SampleSource inputSource,
+                              SampleSource outputSource,
+                              unsigned int numSegments,
+                              unsigned long overlapInMs) {
+  TaskScheduler scheduler;
+  TaskGroup group;
+  PluginChain pluginChain;
+  unsigned long numFrames;
+  unsigned long tailFrames;
+  unsigned long overlapFrames =
+      (unsigned long)(overlapInMs * getSampleRate() / 1000.0);
+  unsigned int i;
+  ReturnCode result = RETURN_CODE_SUCCESS;
+
+  if (inputSource->openedAs != SAMPLE_SOURCE_OPEN_READ) {
+    logInternalError("Input source must be opened before rendering segments");
+    return RETURN_CODE_INTERNAL_ERROR;
+  } else if (inputSource->sampleSourceType == SAMPLE_SOURCE_TYPE_PCM &&
+             charStringIsEqualToCString(inputSource->sourceName, "-", false)) {
+    logError("Segments can't be rendered from standard input");
+    return RETURN_CODE_INVALID_ARGUMENT;
+  }
+
+  charStringCopy(self->_inputName, inputSource->sourceName);
+  numFrames = _countInputFrames(inputSource);
+  inputSource->closeSampleSource(inputSource);
+
+  // The first chain is also used to find the tail time, since it depends on
+  // which plugins are loaded
+  if ((pluginChain = _loadChain(self)) == NULL) {
+    return RETURN_CODE_INVALID_PLUGIN_CHAIN;
+  }
+
+  tailFrames = pluginChainGetTailFrames(pluginChain);
+  numSegments = segmentRendererSplit(self, numFrames, numSegments,
+                                     overlapFrames, tailFrames);
+  logInfo("Rendering %ld frames in %d segments with %ld frames of overlap",
+          self->numFrames, numSegments, overlapFrames);
+  self->segments[0]->_pluginChain = pluginChain;
+
+  for (i = 0; i < numSegments; i++) {
+    if (i > 0 && (self->segments[i]->_pluginChain = _loadChain(self)) == NULL) {
+      return RETURN_CODE_INVALID_PLUGIN_CHAIN;
+    }
+
+    if ((self->segments[i]->_output = tmpfile()) == NULL) {
+      logError("Could not create temporary file for segment %d", i);
+      return RETURN_CODE_IO_ERROR;
+    }
+  }
+
+  // The calling thread renders one of the segments while it waits
+  scheduler = newTaskScheduler(numSegments - 1, THREAD_PLACEMENT_SPREAD);
+  group = newTaskGroup(scheduler);
+
+  for (i = 0; i < numSegments; i++) {
+    taskGroupRun(group, _renderSegmentTask, self->segments[i]);
+  }
+
+  freeTaskGroup(group);
+  freeTaskScheduler(scheduler);
+
+  for (i = 0; i < numSegments; i++) {
+    if (!self->segments[i]->succeeded) {
+      logError("Segment %d could not be rendered", i);
+      return RETURN_CODE_IO_ERROR;
+    }
+  }
+
+  if (!outputSource->openSampleSource(outputSource, SAMPLE_SOURCE_OPEN_WRITE)) {
+    logError("Output source '%s' could not be opened",
+             outputSource->sourceName->data);
+    return RETURN_CODE_IO_ERROR;
+  }
+
+  for (i = 0; i < numSegments; i++) {
+    if (!_writeSegment(self->segments[i], i > 0 ? self->segments[i - 1] : NULL,
+                       i + 1 < numSegments ? self->segments[i + 1] : NULL,
+                       outputSource)) {
+      result = RETURN_CODE_IO_ERROR;
+      break;
+    }
+  }
+
+  outputSource->closeSampleSource(outputSource);
+  return result;
+}
+
+void freeSegmentRenderer(SegmentRenderer self) {
+  if (self != NULL) {
+    _freeSegments(self);
+    freeCharString(self->_inputName);
+    freeCharString(self->_plugins);
+    freeCharString(self->_pluginSearchRoot);
+    free(self);
+  }
+}
@@ -0,0 +1,146 @@
+//
+// SegmentRenderer.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_SegmentRenderer_h
+#define MrsWatson_SegmentRenderer_h
+
+#include "app/ReturnCodes.h"
+#include "audio/AudioSettings.h"
+#include "base/CharString.h"
+#include "base/LinkedList.h"
+#include "base/Thread.h"
+#include "io/SampleSource.h"
+#include "plugin/PluginChain.h"
+#include "plugin/ProcessingContext.h"
+
+#include <stdio.h>
+
+/**
+ * A region of the input which is rendered by its own plugin chain.
+ */
+typedef struct {
+  unsigned int index;
+  // First frame of the input which is rendered before startFrame, so that the
+  // plugins have settled by the time that the segment starts
+  unsigned long preRollFrame;
+  unsigned long startFrame;
+  // End of the output of this segment. This is past the start of the next
+  // segment by the overlap, so that the two can be crossfaded.
+  unsigned long endFrame;
+  boolByte succeeded;
+
+  // Private fields
+  void *_renderer;
+  PluginChain _pluginChain;
+  ProcessingContext _context;
+  // Rendered frames, stored as interleaved samples in a temporary file
+  FILE *_output;
+} RenderSegmentMembers;
+typedef RenderSegmentMembers *RenderSegment;
+
+/**
+ * Renders a long input in several time segments at once, each as a task of a
+ * TaskScheduler and with its own copy of the plugin chain, and then joins the
+ * segments into a single output.
+ *
+ * Each segment starts rendering before its start frame by the overlap plus the
+ * maximum tail time of the chain, and the output before the start frame is
+ * discarded. Each segment also renders past its end by the overlap, and that
+ * region is crossfaded with the start of the next segment. If the overlap is
+ * zero, then the segments are simply cut at their boundaries.
+ *
+ * This only gives the same output as rendering the input in one pass if the
+ * plugins have no state which lasts longer than the pre-roll, so it should not
+ * be used with plugins such as long reverbs or time-based effects which depend
+ * on the absolute position.
+ */
+typedef struct {
+  RenderSegment *segments;
+  unsigned int numSegments;
+  // Number of frames in the input
+  unsigned long numFrames;
+  unsigned long overlapFrames;
+  unsigned long tailFrames;
+
+  // Private fields
+  CharString _inputName;
+  CharString _plugins;
+  LinkedList _parameters;
+  CharString _pluginSearchRoot;
+} SegmentRendererMembers;
+typedef SegmentRendererMembers *SegmentRenderer;
+
+/**
+ * Create a new segment renderer.
+ * @param plugins Plugin chain, in the same format as --plugin
+ * @param parameters Parameters for the first plugin of each chain, may be NULL
+ * @param pluginSearchRoot User-provided plugin search root, may be NULL
+ * @return Renderer without any segments
+ */
+SegmentRenderer newSegmentRenderer(const CharString plugins,
+                                   const LinkedList parameters,
+                                   const CharString pluginSearchRoot);
+
+/**
+ * Split an input into segments of the same length. The number of segments is
+ * reduced if needed so that each one is at least as long as the overlap and
+ * the blocksize.
+ * @param self
+ * @param numFrames Number of frames in the input
+ * @param numSegments Number of segments
+ * @param overlapFrames Number of frames which are crossfaded between segments
+ * @param tailFrames Additional frames which are rendered before each segment
+ * @return Number of segments which were created
+ */
+unsigned int segmentRendererSplit(SegmentRenderer self, unsigned long numFrames,
+                                  unsigned int numSegments,
+                                  unsigned long overlapFrames,
+                                  unsigned long tailFrames);
+
+/**
+ * Render an input in several segments at once, and write the joined segments
+ * to an output.
+ * @param self
+ * @param inputSource Input source, which must already be open for reading.
+ * This is only used to find the length of the input and is closed afterwards,
+ * since each segment opens the input again by name.
+ * @param outputSource Output source, which must not be opened yet
+ * @param numSegments Number of segments, and thus threads
+ * @param overlapInMs Length of the crossfade between segments
+ * @return RETURN_CODE_SUCCESS on success, other code on failure
+ */
+ReturnCode segmentRendererRun(SegmentRenderer self, SampleSource inputSource,
+                              SampleSource outputSource,
+                              unsigned int numSegments,
+                              unsigned long overlapInMs);
+
+/**
+ * Free a segment renderer and all of its segments.
+ * @param self
+ */
+void freeSegmentRenderer(SegmentRenderer self);
+
+#endif
@@ -26,6 +26,7 @@
 
 #include "AudioSettings.h"
 
+#include "base/Thread.h"
 #include "logging/EventLogger.h"
 
 #include <math.h>
@@ -34,6 +35,7 @@
 #include <string.h>
 
 AudioSettings audioSettingsInstance = NULL;
+static THREAD_LOCAL AudioSettings threadAudioSettings = NULL;
 
 void initAudioSettings(void) {
   if (audioSettingsInstance != NULL) {
@@ -52,13 +54,25 @@ void initAudioSettings(void) {
 }
 
 static AudioSettings _getAudioSettings(void) {
-  if (audioSettingsInstance == NULL) {
+  if (threadAudioSettings != NULL) {
+    return threadAudioSettings;
+  } else if (audioSettingsInstance == NULL) {
     initAudioSettings();
   }
 
   return audioSettingsInstance;
 }
 
+AudioSettings newAudioSettingsCopy(void) {
+  AudioSettings settings = malloc(sizeof(AudioSettingsMembers));
+  memcpy(settings, _getAudioSettings(), sizeof(AudioSettingsMembers));
+  return settings;
+}
+
+void setThreadAudioSettings(AudioSettings settings) {
+  threadAudioSettings = settings;
+}
+
 SampleRate getSampleRate(void) { return _getAudioSettings()->sampleRate; }
 
 ChannelCount getNumChannels(void) { return _getAudioSettings()->numChannels; }
@@ -221,3 +235,5 @@ void freeAudioSettings(void) {
   free(audioSettingsInstance);
   audioSettingsInstance = NULL;
 }
+
+void freeAudioSettingsCopy(AudioSettings self) { free(self); }
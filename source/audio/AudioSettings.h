@@ -66,6 +66,24 @@ extern AudioSettings audioSettingsInstance;
  */
 void initAudioSettings(void);
 
+/**
+ * Create a copy of the audio settings which are currently in effect for the
+ * calling thread. The copy can then be given to setThreadAudioSettings() so
+ * that another thread can change its settings without affecting the rest of
+ * the program.
+ * @return New audio settings, which must be freed with freeAudioSettingsCopy()
+ */
+AudioSettings newAudioSettingsCopy(void);
+
+/**
+ * Use a separate audio settings instance for the calling thread. After this
+ * function is called, all of the getters and setters in this file will use the
+ * given instance instead of the global one, but only on the calling thread.
+ * @param settings Audio settings for this thread, or NULL to go back to using
+ * the global instance. The caller retains ownership of this object.
+ */
+void setThreadAudioSettings(AudioSettings settings);
+
 /**
  * Get the current sample rate.
  * @return Sample rate in Hertz
@@ -200,4 +218,11 @@ boolByte setBitDepth(const BitDepth bitDepth);
  */
 void freeAudioSettings(void);
 
+/**
+ * Free a copy of the audio settings made with newAudioSettingsCopy(). The copy
+ * must not be used as the calling thread's settings afterwards.
+ * @param self
+ */
+void freeAudioSettingsCopy(AudioSettings self);
+
 #endif
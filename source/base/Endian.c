@@ -67,6 +67,15 @@ unsigned int convertByteArrayToUnsignedInt(const byte *value) {
   }
 }
 
+unsigned short convertBigEndianByteArrayToUnsignedShort(const byte *value) {
+  return (unsigned short)(((value[0] << 8) & 0x0000ff00) | value[1]);
+}
+
+unsigned int convertBigEndianByteArrayToUnsignedInt(const byte *value) {
+  return (((unsigned int)value[0] << 24) | ((value[1] << 16) & 0x00ff0000) |
+          ((value[2] << 8) & 0x0000ff00) | value[3]);
+}
+
 float convertBigEndianFloatToPlatform(const float value) {
   float result = 0.0f;
   byte *floatToConvert = (byte *)&value;
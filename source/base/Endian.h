@@ -94,4 +94,20 @@ unsigned short convertByteArrayToUnsignedShort(const byte *value);
  */
 unsigned int convertByteArrayToUnsignedInt(const byte *value);
 
+/**
+ * Convert raw big endian bytes to an unsigned short value, as found in IFF
+ * derived formats such as AIFF and MIDI.
+ * @param value A buffer which holds at least two bytes
+ * @return Unsigned short integer
+ */
+unsigned short convertBigEndianByteArrayToUnsignedShort(const byte *value);
+
+/**
+ * Convert raw big endian bytes to an unsigned int value, as found in IFF
+ * derived formats such as AIFF and MIDI.
+ * @param value A buffer which holds at least four bytes
+ * @return Unsigned integer
+ */
+unsigned int convertBigEndianByteArrayToUnsignedInt(const byte *value);
+
 #endif
@@ -149,3 +149,64 @@ void freeLinkedListAndItems(LinkedList self, LinkedListFreeItemFunc freeItem) {
     }
   }
 }
+
+LinkedListBuffer newLinkedListBuffer(unsigned int capacity) {
+  LinkedListBuffer buffer = malloc(sizeof(LinkedListBufferMembers));
+
+  buffer->_capacity = capacity > 0 ? capacity : 1;
+  buffer->_nodes = malloc(sizeof(LinkedListMembers) * buffer->_capacity);
+  buffer->_numItems = 0;
+  linkedListBufferClear(buffer);
+
+  return buffer;
+}
+
+void linkedListBufferClear(LinkedListBuffer self) {
+  self->_numItems = 0;
+  self->_nodes[0].item = NULL;
+  self->_nodes[0].nextItem = NULL;
+  self->_nodes[0]._numItems = 0;
+}
+
+void linkedListBufferAppend(LinkedListBuffer self, void *item) {
+  LinkedListIterator node;
+  unsigned int i;
+
+  if (item == NULL) {
+    return;
+  }
+
+  if (self->_numItems == self->_capacity) {
+    self->_capacity *= 2;
+    self->_nodes =
+        realloc(self->_nodes, sizeof(LinkedListMembers) * self->_capacity);
+
+    // The nodes may have moved, so they must be linked together again
+    for (i = 1; i < self->_numItems; i++) {
+      self->_nodes[i - 1].nextItem = &self->_nodes[i];
+    }
+  }
+
+  node = &self->_nodes[self->_numItems];
+  node->item = item;
+  node->nextItem = NULL;
+  node->_numItems = 0;
+
+  if (self->_numItems > 0) {
+    self->_nodes[self->_numItems - 1].nextItem = node;
+  }
+
+  self->_numItems++;
+  self->_nodes[0]._numItems = (int)self->_numItems;
+}
+
+LinkedList linkedListBufferGetList(LinkedListBuffer self) {
+  return self->_nodes;
+}
+
+void freeLinkedListBuffer(LinkedListBuffer self) {
+  if (self != NULL) {
+    free(self->_nodes);
+    free(self);
+  }
+}
@@ -43,6 +43,21 @@ typedef struct {
 typedef LinkedListMembers *LinkedList;
 typedef LinkedListMembers *LinkedListIterator;
 
+/**
+ * A growable array of list nodes which can be refilled without allocating
+ * memory, for lists which are built once per block of audio. Nodes are
+ * appended in constant time, and the array is only reallocated when it runs
+ * out of space. The list which the buffer holds is valid until the buffer is
+ * cleared or appended to, and must not be passed to linkedListAppend() or
+ * freeLinkedList().
+ */
+typedef struct {
+  LinkedListMembers *_nodes;
+  unsigned int _capacity;
+  unsigned int _numItems;
+} LinkedListBufferMembers;
+typedef LinkedListBufferMembers *LinkedListBuffer;
+
 typedef void (*LinkedListForeachFunc)(void *item, void *userData);
 typedef void (*LinkedListFreeItemFunc)(void *item);
 
@@ -102,6 +117,42 @@ void freeLinkedList(LinkedList self);
  */
 void freeLinkedListAndItems(LinkedList self, LinkedListFreeItemFunc freeItem);
 
+/**
+ * Create a new list buffer
+ * @param capacity Number of items which can be appended before the buffer
+ * must grow
+ * @return Buffer holding an empty list
+ */
+LinkedListBuffer newLinkedListBuffer(unsigned int capacity);
+
+/**
+ * Remove all items from a buffer, keeping its memory for reuse
+ * @param self
+ */
+void linkedListBufferClear(LinkedListBuffer self);
+
+/**
+ * Add an item to the end of the list held by a buffer. If the buffer is full,
+ * then its capacity is doubled.
+ * @param self
+ * @param item Item to append
+ */
+void linkedListBufferAppend(LinkedListBuffer self, void *item);
+
+/**
+ * Get the list which a buffer holds
+ * @param self
+ * @return List of the items appended since the buffer was last cleared. The
+ * list belongs to the buffer and must not be freed.
+ */
+LinkedList linkedListBufferGetList(LinkedListBuffer self);
+
+/**
+ * Free a list buffer. The items themselves are not freed.
+ * @param self
+ */
+void freeLinkedListBuffer(LinkedListBuffer self);
+
 #ifdef __cplusplus
 }
 #endif
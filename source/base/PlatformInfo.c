@@ -29,6 +29,7 @@
 #include "logging/EventLogger.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #if LINUX
@@ -42,6 +43,10 @@
 #include <ntverp.h>
 #endif
 
+#if UNIX
+#include <unistd.h>
+#endif
+
 static PlatformType _getPlatformType() {
 #if MACOSX
   return PLATFORM_MACOSX;
@@ -225,6 +230,358 @@ boolByte platformInfoIsHost64Bit(void) {
   return result;
 }
 
+unsigned int platformInfoGetNumProcessors(void) {
+#if WINDOWS
+  SYSTEM_INFO systemInfo;
+  GetSystemInfo(&systemInfo);
+  return systemInfo.dwNumberOfProcessors > 0
+             ? (unsigned int)systemInfo.dwNumberOfProcessors
+             : 1;
+#elif UNIX
+  long numProcessors = sysconf(_SC_NPROCESSORS_ONLN);
+  return numProcessors > 0 ? (unsigned int)numProcessors : 1;
+#else
+  logUnsupportedFeature("Get number of processors");
+  return 1;
+#endif
+}
+
+static boolByte _readSysFile(const char *sysPath, const char *name,
+                             char *buffer, size_t bufferSize) {
+  char path[256];
+  FILE *file;
+  boolByte result;
+
+  snprintf(path, sizeof(path), "%s/%s", sysPath, name);
+
+  if ((file = fopen(path, "r")) == NULL) {
+    return false;
+  }
+
+  result = (boolByte)(fgets(buffer, (int)bufferSize, file) != NULL);
+  fclose(file);
+  return result;
+}
+
+// Parses lists such as "0-3,8,10-11", and marks each processor in the list
+// which is lower than maxProcessors. Returns the highest processor in the list,
+// and lowers first to the lowest one.
+static unsigned int _parseCpuList(const char *list, boolByte *processors,
+                                  unsigned int maxProcessors,
+                                  unsigned int *first) {
+  unsigned long start;
+  unsigned long end;
+  unsigned long i;
+  unsigned int last = 0;
+  char *next;
+
+  while (*list != '\0') {
+    start = strtoul(list, &next, 10);
+
+    if (next == list) {
+      break;
+    }
+
+    end = start;
+
+    if (*next == '-') {
+      list = next + 1;
+      end = strtoul(list, &next, 10);
+    }
+
+    for (i = start; i <= end && processors != NULL && i < maxProcessors; i++) {
+      processors[i] = true;
+    }
+
+    if (first != NULL && start < *first) {
+      *first = (unsigned int)start;
+    }
+
+    last = end > last ? (unsigned int)end : last;
+    list = *next == ',' ? next + 1 : next;
+  }
+
+  return last;
+}
+
+static unsigned int _readSysNumber(const char *sysPath, const char *name,
+                                   unsigned int defaultValue) {
+  char buffer[32];
+  return _readSysFile(sysPath, name, buffer, sizeof(buffer))
+             ? (unsigned int)strtoul(buffer, NULL, 10)
+             : defaultValue;
+}
+
+// Returns the first processor of a list in a sysfs file, or defaultValue if
+// the file doesn't exist
+static unsigned int _readSysFirstCpu(const char *sysPath, const char *name,
+                                     unsigned int defaultValue) {
+  char buffer[1024];
+  unsigned int first = (unsigned int)-1;
+
+  if (_readSysFile(sysPath, name, buffer, sizeof(buffer))) {
+    _parseCpuList(buffer, NULL, 0, &first);
+  }
+
+  return first != (unsigned int)-1 ? first : defaultValue;
+}
+
+static int _compareCompact(const void *a, const void *b) {
+  const ProcessorInfo *p1 = (const ProcessorInfo *)a;
+  const ProcessorInfo *p2 = (const ProcessorInfo *)b;
+
+  if (p1->numaNode != p2->numaNode) {
+    return p1->numaNode < p2->numaNode ? -1 : 1;
+  } else if (p1->cacheGroup != p2->cacheGroup) {
+    return p1->cacheGroup < p2->cacheGroup ? -1 : 1;
+  } else if (p1->isSmtSibling != p2->isSmtSibling) {
+    return p1->isSmtSibling ? 1 : -1;
+  }
+
+  return p1->processor < p2->processor ? -1 : 1;
+}
+
+static int _compareSpread(const void *a, const void *b) {
+  const ProcessorInfo *p1 = (const ProcessorInfo *)a;
+  const ProcessorInfo *p2 = (const ProcessorInfo *)b;
+
+  if (p1->isSmtSibling != p2->isSmtSibling) {
+    return p1->isSmtSibling ? 1 : -1;
+  } else if (p1->_rankInCache != p2->_rankInCache) {
+    return p1->_rankInCache < p2->_rankInCache ? -1 : 1;
+  }
+
+  return _compareCompact(a, b);
+}
+
+static unsigned int *_newPlacementOrder(CpuTopology self,
+                                        int (*compare)(const void *,
+                                                       const void *)) {
+  ProcessorInfo *sorted =
+      (ProcessorInfo *)malloc(sizeof(ProcessorInfo) * self->numProcessors);
+  unsigned int *order =
+      (unsigned int *)malloc(sizeof(unsigned int) * self->numProcessors);
+  unsigned int i;
+
+  memcpy(sorted, self->processors,
+         sizeof(ProcessorInfo) * self->numProcessors);
+  qsort(sorted, self->numProcessors, sizeof(ProcessorInfo), compare);
+
+  for (i = 0; i < self->numProcessors; i++) {
+    order[i] = sorted[i].processor;
+  }
+
+  free(sorted);
+  return order;
+}
+
+static void _readProcessorInfo(const char *sysPath, ProcessorInfo *info) {
+  char name[128];
+  unsigned int level;
+  unsigned int maxLevel = 0;
+  unsigned int i;
+
+  snprintf(name, sizeof(name), "cpu/cpu%d/topology/physical_package_id",
+           info->processor);
+  info->package = _readSysNumber(sysPath, name, 0);
+  snprintf(name, sizeof(name), "cpu/cpu%d/topology/thread_siblings_list",
+           info->processor);
+  info->isSmtSibling = (boolByte)(
+      _readSysFirstCpu(sysPath, name, info->processor) != info->processor);
+
+  // Without any cache information, each processor gets its own cache
+  info->cacheGroup = info->processor;
+
+  for (i = 0;; i++) {
+    snprintf(name, sizeof(name), "cpu/cpu%d/cache/index%d/level",
+             info->processor, i);
+
+    if ((level = _readSysNumber(sysPath, name, 0)) == 0) {
+      break;
+    } else if (level >= maxLevel) {
+      maxLevel = level;
+      snprintf(name, sizeof(name), "cpu/cpu%d/cache/index%d/shared_cpu_list",
+               info->processor, i);
+      info->cacheGroup = _readSysFirstCpu(sysPath, name, info->processor);
+    }
+  }
+}
+
+static CpuTopology _newCpuTopologyWithNumProcessors(unsigned int count) {
+  CpuTopology topology = (CpuTopology)malloc(sizeof(CpuTopologyMembers));
+
+  topology->numProcessors = count;
+  topology->processors =
+      (ProcessorInfo *)malloc(sizeof(ProcessorInfo) * count);
+  topology->numCores = 0;
+  topology->numNumaNodes = 1;
+  topology->_compactOrder = NULL;
+  topology->_spreadOrder = NULL;
+
+  return topology;
+}
+
+static void _finishCpuTopology(CpuTopology self) {
+  unsigned int i;
+  unsigned int j;
+
+  for (i = 0; i < self->numProcessors; i++) {
+    ProcessorInfo *info = &self->processors[i];
+    info->_rankInCache = 0;
+
+    for (j = 0; j < i; j++) {
+      if (self->processors[j].cacheGroup == info->cacheGroup &&
+          self->processors[j].isSmtSibling == info->isSmtSibling) {
+        info->_rankInCache++;
+      }
+    }
+
+    if (!info->isSmtSibling) {
+      self->numCores++;
+    }
+  }
+
+  self->_compactOrder = _newPlacementOrder(self, _compareCompact);
+  self->_spreadOrder = _newPlacementOrder(self, _compareSpread);
+}
+
+static CpuTopology _newFlatCpuTopology(void) {
+  CpuTopology topology =
+      _newCpuTopologyWithNumProcessors(platformInfoGetNumProcessors());
+  unsigned int i;
+
+  for (i = 0; i < topology->numProcessors; i++) {
+    topology->processors[i].processor = i;
+    topology->processors[i].package = 0;
+    topology->processors[i].numaNode = 0;
+    topology->processors[i].cacheGroup = i;
+    topology->processors[i].isSmtSibling = false;
+  }
+
+  _finishCpuTopology(topology);
+  return topology;
+}
+
+CpuTopology newCpuTopologyWithSysPath(const char *sysPath) {
+  CpuTopology topology;
+  char buffer[1024];
+  char name[64];
+  boolByte *online;
+  boolByte *onlineNodes;
+  unsigned int *nodes;
+  unsigned int maxProcessors;
+  unsigned int maxNodes;
+  unsigned int numProcessors = 0;
+  unsigned int i;
+  unsigned int j;
+
+  if (!_readSysFile(sysPath, "cpu/online", buffer, sizeof(buffer))) {
+    logDebug("Could not read processor topology from '%s'", sysPath);
+    return _newFlatCpuTopology();
+  }
+
+  maxProcessors = _parseCpuList(buffer, NULL, 0, NULL) + 1;
+  online = (boolByte *)calloc(maxProcessors, sizeof(boolByte));
+  nodes = (unsigned int *)calloc(maxProcessors, sizeof(unsigned int));
+  _parseCpuList(buffer, online, maxProcessors, NULL);
+
+  for (i = 0; i < maxProcessors; i++) {
+    numProcessors += online[i] ? 1 : 0;
+  }
+
+  if (numProcessors == 0) {
+    free(online);
+    free(nodes);
+    return _newFlatCpuTopology();
+  }
+
+  topology = _newCpuTopologyWithNumProcessors(numProcessors);
+
+  // Without NUMA support, all processors are on node 0
+  if (_readSysFile(sysPath, "node/online", buffer, sizeof(buffer))) {
+    maxNodes = _parseCpuList(buffer, NULL, 0, NULL) + 1;
+    onlineNodes = (boolByte *)calloc(maxNodes, sizeof(boolByte));
+    _parseCpuList(buffer, onlineNodes, maxNodes, NULL);
+    topology->numNumaNodes = 0;
+
+    for (i = 0; i < maxNodes; i++) {
+      boolByte *nodeProcessors;
+
+      if (!onlineNodes[i]) {
+        continue;
+      }
+
+      topology->numNumaNodes++;
+      snprintf(name, sizeof(name), "node/node%d/cpulist", i);
+
+      if (!_readSysFile(sysPath, name, buffer, sizeof(buffer))) {
+        continue;
+      }
+
+      nodeProcessors = (boolByte *)calloc(maxProcessors, sizeof(boolByte));
+      _parseCpuList(buffer, nodeProcessors, maxProcessors, NULL);
+
+      for (j = 0; j < maxProcessors; j++) {
+        if (nodeProcessors[j]) {
+          nodes[j] = i;
+        }
+      }
+
+      free(nodeProcessors);
+    }
+
+    free(onlineNodes);
+  }
+
+  for (i = 0, j = 0; i < maxProcessors; i++) {
+    if (online[i]) {
+      topology->processors[j].processor = i;
+      topology->processors[j].numaNode = nodes[i];
+      _readProcessorInfo(sysPath, &topology->processors[j]);
+      j++;
+    }
+  }
+
+  free(online);
+  free(nodes);
+  _finishCpuTopology(topology);
+  return topology;
+}
+
+CpuTopology newCpuTopology(void) {
+#if LINUX
+  return newCpuTopologyWithSysPath(CPU_TOPOLOGY_SYS_PATH);
+#else
+  return _newFlatCpuTopology();
+#endif
+}
+
+unsigned int cpuTopologyGetProcessor(CpuTopology self,
+                                     ThreadPlacement placement,
+                                     unsigned int index) {
+  index %= self->numProcessors;
+
+  switch (placement) {
+  case THREAD_PLACEMENT_COMPACT:
+    return self->_compactOrder[index];
+
+  case THREAD_PLACEMENT_SPREAD:
+    return self->_spreadOrder[index];
+
+  default:
+    return self->processors[index].processor;
+  }
+}
+
+void freeCpuTopology(CpuTopology self) {
+  if (self != NULL) {
+    free(self->processors);
+    free(self->_compactOrder);
+    free(self->_spreadOrder);
+    free(self);
+  }
+}
+
 boolByte platformInfoIsLittleEndian(void) {
   int num = 1;
   return (boolByte)(*(char *)&num == 1);
@@ -46,6 +46,59 @@ typedef struct {
 } PlatformInfoMembers;
 typedef PlatformInfoMembers *PlatformInfo;
 
+// Where the sysfs CPU and NUMA node directories are found on Linux
+#define CPU_TOPOLOGY_SYS_PATH "/sys/devices/system"
+
+/**
+ * How a set of threads is spread over the processors of the system.
+ */
+typedef enum {
+  // Leave the placement to the operating system
+  THREAD_PLACEMENT_NONE,
+  // Keep threads close together, filling the physical cores which share a
+  // last level cache before using their SMT siblings or other caches. This is
+  // meant for threads which pass buffers to each other every block, such as
+  // pipeline stages or the branches of a plugin group.
+  THREAD_PLACEMENT_COMPACT,
+  // Spread threads over as many caches and NUMA nodes as possible, and use
+  // SMT siblings last. This is meant for threads which render independent
+  // streams, such as batch jobs or segments.
+  THREAD_PLACEMENT_SPREAD,
+} ThreadPlacement;
+
+typedef struct {
+  unsigned int processor;
+  unsigned int package;
+  unsigned int numaNode;
+  // Number of the first processor which shares the last level cache with this
+  // one, which identifies the cache
+  unsigned int cacheGroup;
+  // True if this is not the first hardware thread of its physical core
+  boolByte isSmtSibling;
+
+  // Private fields
+  // Number of processors before this one with the same cache and SMT status
+  unsigned int _rankInCache;
+} ProcessorInfo;
+
+/**
+ * Layout of the processors of the system. On Linux this is read from sysfs,
+ * and on other platforms each processor is treated as its own core with its
+ * own cache, on a single NUMA node.
+ */
+typedef struct {
+  // Online processors, in increasing order of their numbers
+  ProcessorInfo *processors;
+  unsigned int numProcessors;
+  unsigned int numCores;
+  unsigned int numNumaNodes;
+
+  // Private fields
+  unsigned int *_compactOrder;
+  unsigned int *_spreadOrder;
+} CpuTopologyMembers;
+typedef CpuTopologyMembers *CpuTopology;
+
 PlatformInfo newPlatformInfo(void);
 
 /**
@@ -63,6 +116,39 @@ boolByte platformInfoIsHost64Bit(void);
  */
 boolByte platformInfoIsRuntime64Bit(void);
 
+/**
+ * @brief Number of processors which are currently online, or 1 if unknown
+ */
+unsigned int platformInfoGetNumProcessors(void);
+
+/**
+ * @brief Discover the topology of the processors which are currently online
+ * @return Topology, which must be freed with freeCpuTopology()
+ */
+CpuTopology newCpuTopology(void);
+
+/**
+ * @brief Read the processor topology from a sysfs-style directory tree
+ * @param sysPath Directory containing the cpu and node directories, usually
+ * CPU_TOPOLOGY_SYS_PATH
+ * @return Topology, or a flat topology if the tree can't be read
+ */
+CpuTopology newCpuTopologyWithSysPath(const char *sysPath);
+
+/**
+ * @brief Choose the processor for one of a set of threads
+ * @param self
+ * @param placement How the set of threads should be placed
+ * @param index Index of the thread in the set. If there are more threads than
+ * processors, then the placement wraps around.
+ * @return Processor number, as used by threadSetAffinity()
+ */
+unsigned int cpuTopologyGetProcessor(CpuTopology self,
+                                     ThreadPlacement placement,
+                                     unsigned int index);
+
+void freeCpuTopology(CpuTopology self);
+
 void freePlatformInfo(PlatformInfo self);
 
 #endif
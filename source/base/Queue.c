@@ -0,0 +1,350 @@
+//
+// Queue.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "Queue.h"
+
+#include <stdlib.h>
+
+// In the SPSC queue, each thread reads its own index (_tail for the producer,
+// _head for the consumer) with a plain load, since no other thread writes it.
+// The other thread's index is read with atomicLoad(), and an index is only
+// advanced with atomicStore() after its item was written or read, so that the
+// other thread never sees an index before the item. Both atomic functions are
+// sequentially consistent, which is only strictly needed for the handshake
+// with sleeping threads (see _wakeWaiting), but queues are used once per block
+// at most, so the cost doesn't matter.
+
+SpscQueue newSpscQueue(unsigned long capacity) {
+  SpscQueue queue = (SpscQueue)malloc(sizeof(SpscQueueMembers));
+
+  queue->capacity = 1;
+
+  while (queue->capacity < capacity) {
+    queue->capacity <<= 1;
+  }
+
+  queue->items = (void **)malloc(sizeof(void *) * queue->capacity);
+  queue->_mask = queue->capacity - 1;
+  queue->_head = 0;
+  queue->_tail = 0;
+  queue->_numWaiting = 0;
+  queue->_mutex = newMutex();
+  queue->_condition = newCondition();
+
+  return queue;
+}
+
+/**
+ * Wake the other thread if it is sleeping. The sleeping thread increments
+ * _numWaiting before checking the queue for the last time, and this is called
+ * after changing the queue, so at least one of them sees the other's change.
+ */
+static void _wakeWaiting(SpscQueue self) {
+  if (atomicLoad(&self->_numWaiting) > 0) {
+    mutexLock(self->_mutex);
+    conditionSignalAll(self->_condition);
+    mutexUnlock(self->_mutex);
+  }
+}
+
+static boolByte _tryPush(SpscQueue self, void *item) {
+  unsigned long tail = self->_tail;
+
+  if (tail - atomicLoad(&self->_head) >= self->capacity) {
+    return false;
+  }
+
+  self->items[tail & self->_mask] = item;
+  atomicStore(&self->_tail, tail + 1);
+  return true;
+}
+
+static void *_tryPop(SpscQueue self) {
+  unsigned long head = self->_head;
+  void *item;
+
+  if (head == atomicLoad(&self->_tail)) {
+    return NULL;
+  }
+
+  item = self->items[head & self->_mask];
+  atomicStore(&self->_head, head + 1);
+  return item;
+}
+
+boolByte spscQueuePush(SpscQueue self, void *item) {
+  if (!_tryPush(self, item)) {
+    return false;
+  }
+
+  _wakeWaiting(self);
+  return true;
+}
+
+void spscQueuePushWait(SpscQueue self, void *item) {
+  int i;
+
+  for (i = 0; i < QUEUE_SPIN_COUNT; i++) {
+    if (spscQueuePush(self, item)) {
+      return;
+    }
+  }
+
+  mutexLock(self->_mutex);
+  atomicAdd(&self->_numWaiting, 1);
+
+  while (!_tryPush(self, item)) {
+    conditionWait(self->_condition, self->_mutex);
+  }
+
+  atomicSubtract(&self->_numWaiting, 1);
+  mutexUnlock(self->_mutex);
+  _wakeWaiting(self);
+}
+
+void *spscQueuePop(SpscQueue self) {
+  void *item = _tryPop(self);
+
+  if (item != NULL) {
+    _wakeWaiting(self);
+  }
+
+  return item;
+}
+
+void *spscQueuePopWait(SpscQueue self) {
+  void *item;
+  int i;
+
+  for (i = 0; i < QUEUE_SPIN_COUNT; i++) {
+    if ((item = spscQueuePop(self)) != NULL) {
+      return item;
+    }
+  }
+
+  mutexLock(self->_mutex);
+  atomicAdd(&self->_numWaiting, 1);
+
+  while ((item = _tryPop(self)) == NULL) {
+    conditionWait(self->_condition, self->_mutex);
+  }
+
+  atomicSubtract(&self->_numWaiting, 1);
+  mutexUnlock(self->_mutex);
+  _wakeWaiting(self);
+  return item;
+}
+
+unsigned long spscQueueGetSize(SpscQueue self) {
+  unsigned long head = atomicLoad(&self->_head);
+  return atomicLoad(&self->_tail) - head;
+}
+
+void freeSpscQueue(SpscQueue self) {
+  if (self != NULL) {
+    freeMutex(self->_mutex);
+    freeCondition(self->_condition);
+    free(self->items);
+    free(self);
+  }
+}
+
+MpmcQueue newMpmcQueue(unsigned long capacity) {
+  MpmcQueue queue = (MpmcQueue)malloc(sizeof(MpmcQueueMembers));
+  unsigned long i;
+
+  // A pushed cell has the sequence number of the next position, so with only
+  // one cell it would look free to the next producer. Thus the queue always
+  // has at least two cells.
+  queue->capacity = 2;
+
+  while (queue->capacity < capacity) {
+    queue->capacity <<= 1;
+  }
+
+  queue->_cells =
+      (MpmcQueueCell *)malloc(sizeof(MpmcQueueCell) * queue->capacity);
+
+  for (i = 0; i < queue->capacity; i++) {
+    queue->_cells[i].sequence = i;
+    queue->_cells[i].item = NULL;
+  }
+
+  queue->_mask = queue->capacity - 1;
+  queue->_head = 0;
+  queue->_tail = 0;
+  queue->_numWaiting = 0;
+  queue->_mutex = newMutex();
+  queue->_condition = newCondition();
+
+  return queue;
+}
+
+static void _wakeWaitingMpmc(MpmcQueue self) {
+  if (atomicLoad(&self->_numWaiting) > 0) {
+    mutexLock(self->_mutex);
+    conditionSignalAll(self->_condition);
+    mutexUnlock(self->_mutex);
+  }
+}
+
+static boolByte _tryPushMpmc(MpmcQueue self, void *item) {
+  unsigned long position = atomicLoad(&self->_tail);
+  MpmcQueueCell *cell;
+  long difference;
+
+  while (true) {
+    cell = &self->_cells[position & self->_mask];
+    difference = (long)(atomicLoad(&cell->sequence) - position);
+
+    if (difference == 0) {
+      // The cell is free, so try to claim it before another producer does
+      if (atomicCompareAndSwap(&self->_tail, position, position + 1)) {
+        break;
+      }
+
+      position = atomicLoad(&self->_tail);
+    } else if (difference < 0) {
+      // The cell still holds the item from the previous lap
+      return false;
+    } else {
+      // Another producer has claimed this position already
+      position = atomicLoad(&self->_tail);
+    }
+  }
+
+  cell->item = item;
+  atomicStore(&cell->sequence, position + 1);
+  return true;
+}
+
+static void *_tryPopMpmc(MpmcQueue self) {
+  unsigned long position = atomicLoad(&self->_head);
+  MpmcQueueCell *cell;
+  long difference;
+  void *item;
+
+  while (true) {
+    cell = &self->_cells[position & self->_mask];
+    difference = (long)(atomicLoad(&cell->sequence) - (position + 1));
+
+    if (difference == 0) {
+      if (atomicCompareAndSwap(&self->_head, position, position + 1)) {
+        break;
+      }
+
+      position = atomicLoad(&self->_head);
+    } else if (difference < 0) {
+      // The cell has not been pushed to yet
+      return NULL;
+    } else {
+      position = atomicLoad(&self->_head);
+    }
+  }
+
+  item = cell->item;
+  // The cell can be pushed to again once the producers come around next time
+  atomicStore(&cell->sequence, position + self->capacity);
+  return item;
+}
+
+boolByte mpmcQueuePush(MpmcQueue self, void *item) {
+  if (!_tryPushMpmc(self, item)) {
+    return false;
+  }
+
+  _wakeWaitingMpmc(self);
+  return true;
+}
+
+void mpmcQueuePushWait(MpmcQueue self, void *item) {
+  int i;
+
+  for (i = 0; i < QUEUE_SPIN_COUNT; i++) {
+    if (mpmcQueuePush(self, item)) {
+      return;
+    }
+  }
+
+  mutexLock(self->_mutex);
+  atomicAdd(&self->_numWaiting, 1);
+
+  while (!_tryPushMpmc(self, item)) {
+    conditionWait(self->_condition, self->_mutex);
+  }
+
+  atomicSubtract(&self->_numWaiting, 1);
+  mutexUnlock(self->_mutex);
+  _wakeWaitingMpmc(self);
+}
+
+void *mpmcQueuePop(MpmcQueue self) {
+  void *item = _tryPopMpmc(self);
+
+  if (item != NULL) {
+    _wakeWaitingMpmc(self);
+  }
+
+  return item;
+}
+
+void *mpmcQueuePopWait(MpmcQueue self) {
+  void *item;
+  int i;
+
+  for (i = 0; i < QUEUE_SPIN_COUNT; i++) {
+    if ((item = mpmcQueuePop(self)) != NULL) {
+      return item;
+    }
+  }
+
+  mutexLock(self->_mutex);
+  atomicAdd(&self->_numWaiting, 1);
+
+  while ((item = _tryPopMpmc(self)) == NULL) {
+    conditionWait(self->_condition, self->_mutex);
+  }
+
+  atomicSubtract(&self->_numWaiting, 1);
+  mutexUnlock(self->_mutex);
+  _wakeWaitingMpmc(self);
+  return item;
+}
+
+unsigned long mpmcQueueGetSize(MpmcQueue self) {
+  unsigned long head = atomicLoad(&self->_head);
+  unsigned long tail = atomicLoad(&self->_tail);
+  return tail > head ? tail - head : 0;
+}
+
+void freeMpmcQueue(MpmcQueue self) {
+  if (self != NULL) {
+    freeMutex(self->_mutex);
+    freeCondition(self->_condition);
+    free(self->_cells);
+    free(self);
+  }
+}
@@ -0,0 +1,200 @@
+//
+// Queue.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_Queue_h
+#define MrsWatson_Queue_h
+
+#include "base/Thread.h"
+#include "base/Types.h"
+
+// Number of times that a blocking push or pop retries before the calling
+// thread is put to sleep
+#define QUEUE_SPIN_COUNT 1000
+// Size of a cache line, used to keep the producer and consumer indexes apart
+#define QUEUE_CACHE_LINE_SIZE 64
+
+/**
+ * Bounded, lock-free queue of pointers for exactly one producer thread and one
+ * consumer thread. Pushing and popping never take a lock, unless the other
+ * thread is sleeping in spscQueuePushWait() or spscQueuePopWait(), in which
+ * case it is woken up. NULL cannot be stored in the queue.
+ */
+typedef struct {
+  void **items;
+  unsigned long capacity;
+
+  // Private fields
+  unsigned long _mask;
+  // Index of the next item to pop, only written by the consumer
+  volatile unsigned long _head;
+  char _padding[QUEUE_CACHE_LINE_SIZE];
+  // Index of the next item to push, only written by the producer
+  volatile unsigned long _tail;
+  volatile unsigned long _numWaiting;
+  Mutex _mutex;
+  Condition _condition;
+} SpscQueueMembers;
+typedef SpscQueueMembers *SpscQueue;
+
+/**
+ * Create a new queue.
+ * @param capacity Minimum number of items which the queue can hold. This is
+ * rounded up to the next power of two.
+ * @return Empty queue
+ */
+SpscQueue newSpscQueue(unsigned long capacity);
+
+/**
+ * Add an item to the back of the queue. Must only be called by the producer.
+ * @param self
+ * @param item Item to add, which may not be NULL
+ * @return True if the item was added, false if the queue is full
+ */
+boolByte spscQueuePush(SpscQueue self, void *item);
+
+/**
+ * Add an item to the back of the queue, waiting for space if the queue is full.
+ * Must only be called by the producer.
+ * @param self
+ * @param item Item to add, which may not be NULL
+ */
+void spscQueuePushWait(SpscQueue self, void *item);
+
+/**
+ * Remove the item at the front of the queue. Must only be called by the
+ * consumer.
+ * @param self
+ * @return Item, or NULL if the queue is empty
+ */
+void *spscQueuePop(SpscQueue self);
+
+/**
+ * Remove the item at the front of the queue, waiting for one to be pushed if
+ * the queue is empty. Must only be called by the consumer.
+ * @param self
+ * @return Item
+ */
+void *spscQueuePopWait(SpscQueue self);
+
+/**
+ * Get the number of items in the queue. If called while the other thread is
+ * pushing or popping, then the result may already be out of date.
+ * @param self
+ * @return Number of items
+ */
+unsigned long spscQueueGetSize(SpscQueue self);
+
+/**
+ * Free a queue. Any items left in the queue are not freed.
+ * @param self
+ */
+void freeSpscQueue(SpscQueue self);
+
+typedef struct {
+  // Position in the queue at which this cell can next be pushed to (if equal
+  // to the position) or popped from (if one past the position)
+  volatile unsigned long sequence;
+  void *item;
+} MpmcQueueCell;
+
+/**
+ * Bounded, lock-free queue of pointers for any number of producer and consumer
+ * threads. Each cell of the queue has a sequence number which tells producers
+ * and consumers whether it is ready for them, so that they only need to agree
+ * on the queue indexes. As with SpscQueue, the blocking functions only take a
+ * lock to put the calling thread to sleep, and NULL cannot be stored in the
+ * queue.
+ */
+typedef struct {
+  unsigned long capacity;
+
+  // Private fields
+  MpmcQueueCell *_cells;
+  unsigned long _mask;
+  // Index of the next item to pop, claimed by consumers
+  volatile unsigned long _head;
+  char _padding[QUEUE_CACHE_LINE_SIZE];
+  // Index of the next item to push, claimed by producers
+  volatile unsigned long _tail;
+  volatile unsigned long _numWaiting;
+  Mutex _mutex;
+  Condition _condition;
+} MpmcQueueMembers;
+typedef MpmcQueueMembers *MpmcQueue;
+
+/**
+ * Create a new queue.
+ * @param capacity Minimum number of items which the queue can hold. This is
+ * rounded up to the next power of two, and is at least two.
+ * @return Empty queue
+ */
+MpmcQueue newMpmcQueue(unsigned long capacity);
+
+/**
+ * Add an item to the back of the queue. May be called from any thread.
+ * @param self
+ * @param item Item to add, which may not be NULL
+ * @return True if the item was added, false if the queue is full
+ */
+boolByte mpmcQueuePush(MpmcQueue self, void *item);
+
+/**
+ * Add an item to the back of the queue, waiting for space if the queue is full.
+ * @param self
+ * @param item Item to add, which may not be NULL
+ */
+void mpmcQueuePushWait(MpmcQueue self, void *item);
+
+/**
+ * Remove the item at the front of the queue. May be called from any thread.
+ * @param self
+ * @return Item, or NULL if the queue is empty
+ */
+void *mpmcQueuePop(MpmcQueue self);
+
+/**
+ * Remove the item at the front of the queue, waiting for one to be pushed if
+ * the queue is empty.
+ * @param self
+ * @return Item
+ */
+void *mpmcQueuePopWait(MpmcQueue self);
+
+/**
+ * Get the number of items in the queue. Since other threads may be pushing or
+ * popping at the same time, this is only an estimate.
+ * @param self
+ * @return Number of items
+ */
+unsigned long mpmcQueueGetSize(MpmcQueue self);
+
+/**
+ * Free a queue. Any items left in the queue are not freed.
+ * @param self
+ */
+void freeMpmcQueue(MpmcQueue self);
+
+#endif
@@ -0,0 +1,357 @@
+//
+// TaskScheduler.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "TaskScheduler.h"
+
+#include "logging/EventLogger.h"
+
+#include <stdlib.h>
+
+// Worker which the calling thread runs as, or NULL for other threads
+static THREAD_LOCAL TaskWorker _currentWorker = NULL;
+
+static TaskDeque _newTaskDeque(void) {
+  TaskDeque deque = (TaskDeque)malloc(sizeof(TaskDequeMembers));
+
+  deque->_mutex = newMutex();
+  deque->_capacity = TASK_SCHEDULER_DEQUE_CAPACITY;
+  deque->_tasks = (Task *)malloc(sizeof(Task) * deque->_capacity);
+  deque->_top = 0;
+  deque->_bottom = 0;
+
+  return deque;
+}
+
+static void _taskDequePush(TaskDeque self, Task task) {
+  unsigned long capacity;
+  Task *tasks;
+  unsigned long i;
+
+  mutexLock(self->_mutex);
+
+  if (self->_bottom - self->_top == self->_capacity) {
+    // Unwrap the tasks into a buffer twice the size, so that the indexes can
+    // keep counting up from where they are
+    capacity = self->_capacity * 2;
+    tasks = (Task *)malloc(sizeof(Task) * capacity);
+
+    for (i = self->_top; i < self->_bottom; i++) {
+      tasks[i % capacity] = self->_tasks[i % self->_capacity];
+    }
+
+    free(self->_tasks);
+    self->_tasks = tasks;
+    self->_capacity = capacity;
+  }
+
+  self->_tasks[self->_bottom % self->_capacity] = task;
+  self->_bottom++;
+  mutexUnlock(self->_mutex);
+}
+
+static Task _taskDequePop(TaskDeque self) {
+  Task task = NULL;
+
+  mutexLock(self->_mutex);
+
+  if (self->_bottom > self->_top) {
+    self->_bottom--;
+    task = self->_tasks[self->_bottom % self->_capacity];
+  }
+
+  mutexUnlock(self->_mutex);
+  return task;
+}
+
+static Task _taskDequeSteal(TaskDeque self) {
+  Task task = NULL;
+
+  mutexLock(self->_mutex);
+
+  if (self->_bottom > self->_top) {
+    task = self->_tasks[self->_top % self->_capacity];
+    self->_top++;
+  }
+
+  mutexUnlock(self->_mutex);
+  return task;
+}
+
+static void _freeTaskDeque(TaskDeque self) {
+  freeMutex(self->_mutex);
+  free(self->_tasks);
+  free(self);
+}
+
+static void _wakeUpSleeping(TaskScheduler self) {
+  if (atomicLoad(&self->_numSleeping) > 0) {
+    mutexLock(self->_mutex);
+    conditionSignalAll(self->_wakeUp);
+    mutexUnlock(self->_mutex);
+  }
+}
+
+static unsigned long _nextRandom(TaskWorker self) {
+  // xorshift, which is plenty for spreading out the choice of victims
+  self->_randomState ^= self->_randomState << 13;
+  self->_randomState ^= self->_randomState >> 7;
+  self->_randomState ^= self->_randomState << 17;
+  return self->_randomState;
+}
+
+static Task _findTask(TaskScheduler self, TaskWorker worker) {
+  Task task = NULL;
+  TaskWorker victim;
+  unsigned int firstVictim;
+  unsigned int i;
+
+  if (worker != NULL) {
+    task = _taskDequePop(worker->_deque);
+  }
+
+  if (task == NULL) {
+    task = (Task)mpmcQueuePop(self->_queue);
+  }
+
+  if (task == NULL && self->numWorkers > 0) {
+    // Threads outside of the pool have no random state of their own, but they
+    // only steal while waiting for a group, so always starting with the first
+    // worker does no harm
+    firstVictim = worker != NULL
+                      ? (unsigned int)(_nextRandom(worker) % self->numWorkers)
+                      : 0;
+
+    for (i = 0; i < self->numWorkers && task == NULL; i++) {
+      victim = self->workers[(firstVictim + i) % self->numWorkers];
+
+      if (victim != worker) {
+        task = _taskDequeSteal(victim->_deque);
+      }
+    }
+  }
+
+  if (task != NULL) {
+    atomicSubtract(&self->_numQueued, 1);
+  }
+
+  return task;
+}
+
+static void _runTask(TaskScheduler self, Task task) {
+  TaskGroup group = (TaskGroup)task->_group;
+
+  task->function(task->userData);
+  free(task);
+
+  // The group may be freed as soon as its last task is done, so it must not
+  // be touched after the count reaches zero
+  if (atomicSubtract(&group->_numPending, 1) == 0) {
+    mutexLock(self->_mutex);
+    conditionSignalAll(self->_wakeUp);
+    mutexUnlock(self->_mutex);
+  }
+}
+
+static void _runWorker(void *userData) {
+  TaskWorker worker = (TaskWorker)userData;
+  TaskScheduler scheduler = (TaskScheduler)worker->_scheduler;
+  Task task;
+
+  _currentWorker = worker;
+
+  while (!atomicLoad(&scheduler->_shutdown)) {
+    task = _findTask(scheduler, worker);
+
+    if (task != NULL) {
+      _runTask(scheduler, task);
+      continue;
+    }
+
+    // Tasks are counted after they are pushed, and sleepers are counted
+    // before the count of tasks is checked, so a task which is started while
+    // the worker goes to sleep will always wake it up again
+    mutexLock(scheduler->_mutex);
+    atomicAdd(&scheduler->_numSleeping, 1);
+
+    while (!atomicLoad(&scheduler->_shutdown) &&
+           atomicLoad(&scheduler->_numQueued) == 0) {
+      conditionWait(scheduler->_wakeUp, scheduler->_mutex);
+    }
+
+    atomicSubtract(&scheduler->_numSleeping, 1);
+    mutexUnlock(scheduler->_mutex);
+  }
+
+  _currentWorker = NULL;
+}
+
+TaskScheduler newTaskScheduler(unsigned int numWorkers,
+                               ThreadPlacement placement) {
+  TaskScheduler scheduler = (TaskScheduler)malloc(sizeof(TaskSchedulerMembers));
+  TaskWorker worker;
+  unsigned int i;
+
+  scheduler->numWorkers = numWorkers;
+  scheduler->workers =
+      numWorkers > 0 ? (TaskWorker *)malloc(sizeof(TaskWorker) * numWorkers)
+                     : NULL;
+  scheduler->_queue = newMpmcQueue(TASK_SCHEDULER_QUEUE_CAPACITY);
+  scheduler->_numQueued = 0;
+  scheduler->_numSleeping = 0;
+  scheduler->_shutdown = false;
+  scheduler->_mutex = newMutex();
+  scheduler->_wakeUp = newCondition();
+
+  // All workers must exist before any of them starts looking for tasks to
+  // steal. A worker whose thread can't be started just has an empty deque.
+  for (i = 0; i < numWorkers; i++) {
+    worker = (TaskWorker)malloc(sizeof(TaskWorkerMembers));
+    worker->index = i;
+    worker->thread = NULL;
+    worker->_scheduler = scheduler;
+    worker->_deque = _newTaskDeque();
+    worker->_randomState = 2463534242ul + i;
+    scheduler->workers[i] = worker;
+  }
+
+  for (i = 0; i < numWorkers; i++) {
+    worker = scheduler->workers[i];
+    worker->thread = newThread(_runWorker, worker);
+
+    if (worker->thread == NULL) {
+      logError("Could not start task worker %d", i);
+    } else {
+      threadPin(worker->thread, placement, i + 1);
+    }
+  }
+
+  return scheduler;
+}
+
+unsigned int taskSchedulerGetThreadIndex(TaskScheduler self) {
+  if (_currentWorker != NULL && _currentWorker->_scheduler == self) {
+    return _currentWorker->index + 1;
+  }
+
+  return 0;
+}
+
+TaskGroup newTaskGroup(TaskScheduler scheduler) {
+  TaskGroup group = (TaskGroup)malloc(sizeof(TaskGroupMembers));
+
+  group->scheduler = scheduler;
+  group->_numPending = 0;
+
+  return group;
+}
+
+void taskGroupRun(TaskGroup self, TaskFunc function, void *userData) {
+  TaskScheduler scheduler = self->scheduler;
+  Task task = (Task)malloc(sizeof(TaskMembers));
+
+  task->function = function;
+  task->userData = userData;
+  task->_group = self;
+  atomicAdd(&self->_numPending, 1);
+
+  if (_currentWorker != NULL && _currentWorker->_scheduler == scheduler) {
+    _taskDequePush(_currentWorker->_deque, task);
+  } else if (!mpmcQueuePush(scheduler->_queue, task)) {
+    // Running the task right away holds up the caller, but it is the only way
+    // to make progress without allocating an unbounded queue
+    _runTask(scheduler, task);
+    return;
+  }
+
+  atomicAdd(&scheduler->_numQueued, 1);
+  _wakeUpSleeping(scheduler);
+}
+
+void taskGroupWait(TaskGroup self) {
+  TaskScheduler scheduler = self->scheduler;
+  TaskWorker worker = _currentWorker;
+  Task task;
+
+  if (worker != NULL && worker->_scheduler != scheduler) {
+    worker = NULL;
+  }
+
+  while (atomicLoad(&self->_numPending) > 0) {
+    task = _findTask(scheduler, worker);
+
+    if (task != NULL) {
+      _runTask(scheduler, task);
+      continue;
+    }
+
+    // The remaining tasks of the group are running on other threads. Sleep
+    // until one of them is done, or until another task can be helped with.
+    mutexLock(scheduler->_mutex);
+    atomicAdd(&scheduler->_numSleeping, 1);
+
+    while (atomicLoad(&self->_numPending) > 0 &&
+           atomicLoad(&scheduler->_numQueued) == 0) {
+      conditionWait(scheduler->_wakeUp, scheduler->_mutex);
+    }
+
+    atomicSubtract(&scheduler->_numSleeping, 1);
+    mutexUnlock(scheduler->_mutex);
+  }
+}
+
+void freeTaskGroup(TaskGroup self) {
+  if (self == NULL) {
+    return;
+  }
+
+  taskGroupWait(self);
+  free(self);
+}
+
+void freeTaskScheduler(TaskScheduler self) {
+  unsigned int i;
+
+  if (self == NULL) {
+    return;
+  }
+
+  mutexLock(self->_mutex);
+  atomicStore(&self->_shutdown, true);
+  conditionSignalAll(self->_wakeUp);
+  mutexUnlock(self->_mutex);
+
+  for (i = 0; i < self->numWorkers; i++) {
+    freeThread(self->workers[i]->thread);
+    _freeTaskDeque(self->workers[i]->_deque);
+    free(self->workers[i]);
+  }
+
+  free(self->workers);
+  freeMpmcQueue(self->_queue);
+  freeMutex(self->_mutex);
+  freeCondition(self->_wakeUp);
+  free(self);
+}
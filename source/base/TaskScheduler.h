@@ -0,0 +1,193 @@
+//
+// TaskScheduler.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_TaskScheduler_h
+#define MrsWatson_TaskScheduler_h
+
+#include "base/Queue.h"
+#include "base/Thread.h"
+#include "base/Types.h"
+
+// Number of tasks which may wait to be picked up by a worker when they are
+// started from a thread outside of the scheduler. Further tasks are executed
+// directly by the thread which starts them.
+#define TASK_SCHEDULER_QUEUE_CAPACITY 1024
+// Initial number of tasks which fit in a worker's deque before it is grown
+#define TASK_SCHEDULER_DEQUE_CAPACITY 64
+
+/**
+ * Function which is executed as a task.
+ * @param userData User data passed to taskGroupRun()
+ */
+typedef void (*TaskFunc)(void *userData);
+
+typedef struct {
+  TaskFunc function;
+  void *userData;
+
+  // Private fields
+  void *_group;
+} TaskMembers;
+typedef TaskMembers *Task;
+
+/**
+ * Double-ended queue of tasks which belongs to one worker. The worker pushes
+ * and pops tasks at the bottom, so that it runs the most recent (and most
+ * likely cached) task first, while other workers steal the oldest tasks from
+ * the top.
+ */
+typedef struct {
+  // Private fields, protected by _mutex
+  Mutex _mutex;
+  Task *_tasks;
+  unsigned long _capacity;
+  unsigned long _top;
+  unsigned long _bottom;
+} TaskDequeMembers;
+typedef TaskDequeMembers *TaskDeque;
+
+typedef struct {
+  unsigned int index;
+  Thread thread;
+
+  // Private fields
+  void *_scheduler;
+  TaskDeque _deque;
+  // State of the random number generator used to choose whom to steal from
+  unsigned long _randomState;
+} TaskWorkerMembers;
+typedef TaskWorkerMembers *TaskWorker;
+
+/**
+ * Pool of worker threads which execute tasks, and which balance the load among
+ * themselves by work stealing. Each worker has its own deque of tasks, and
+ * tasks which are started by a worker are put in its own deque. When a worker
+ * runs out of tasks, it takes them from the shared queue of tasks which were
+ * started outside of the pool, and otherwise steals from the other workers.
+ * Idle workers sleep until new tasks are started.
+ *
+ * Tasks are started and waited for in task groups. A thread which waits for a
+ * group helps executing tasks until all tasks of the group are done, so that
+ * tasks may themselves start and wait for other tasks without deadlocking,
+ * and a scheduler without any workers still executes everything.
+ *
+ * The scheduler is meant for independent jobs such as segments and batch
+ * files. The per-block workers of plugin groups, fan-out variants and the
+ * chain pipeline still run on their own threads, since they must pick up each
+ * block with a fixed latency, and a thread which helps with other tasks while
+ * it waits could hold up the audio block by block.
+ */
+typedef struct {
+  TaskWorker *workers;
+  unsigned int numWorkers;
+
+  // Private fields
+  MpmcQueue _queue;
+  // Number of tasks in the queue and the deques, which have not been taken by
+  // any thread yet
+  volatile unsigned long _numQueued;
+  volatile unsigned long _numSleeping;
+  volatile unsigned long _shutdown;
+  // Threads which find nothing to do sleep on this condition until a task is
+  // started, a task group is done, or the scheduler is shut down
+  Mutex _mutex;
+  Condition _wakeUp;
+} TaskSchedulerMembers;
+typedef TaskSchedulerMembers *TaskScheduler;
+
+/**
+ * A set of tasks which can be waited for together.
+ */
+typedef struct {
+  TaskScheduler scheduler;
+
+  // Private fields
+  volatile unsigned long _numPending;
+} TaskGroupMembers;
+typedef TaskGroupMembers *TaskGroup;
+
+/**
+ * Create a scheduler and start its worker threads.
+ * @param numWorkers Number of worker threads. Since threads which wait for a
+ * task group also execute tasks, this is usually one less than the number of
+ * tasks which should run at the same time. May be 0, in which case all tasks
+ * are executed by the waiting thread.
+ * @param placement How the workers are pinned to processors if pinning is
+ * enabled, as described in threadPin(). The calling thread counts as index 0
+ * of the placement, and the workers start at index 1.
+ * @return Running scheduler
+ */
+TaskScheduler newTaskScheduler(unsigned int numWorkers,
+                               ThreadPlacement placement);
+
+/**
+ * Get the index of the calling thread among the threads which execute the
+ * tasks of a scheduler, so that tasks can keep per-thread state without
+ * locking. The index matches the placement index given in newTaskScheduler().
+ * @param self
+ * @return Index of the worker plus one if called from one of the scheduler's
+ * workers, otherwise 0
+ */
+unsigned int taskSchedulerGetThreadIndex(TaskScheduler self);
+
+/**
+ * Create a new, empty task group.
+ * @param scheduler Scheduler which executes the tasks of the group
+ * @return Task group, which must be freed with freeTaskGroup()
+ */
+TaskGroup newTaskGroup(TaskScheduler scheduler);
+
+/**
+ * Start a task in a group. The task may run on any worker, or on a thread
+ * which waits for any group of the same scheduler.
+ * @param self
+ * @param function Function to execute
+ * @param userData Argument to pass to the function
+ */
+void taskGroupRun(TaskGroup self, TaskFunc function, void *userData);
+
+/**
+ * Wait for all tasks of a group which have been started so far, including
+ * tasks which are started by these tasks. The calling thread executes tasks
+ * of the scheduler while it waits. The group may be reused afterwards.
+ * @param self
+ */
+void taskGroupWait(TaskGroup self);
+
+/**
+ * Wait for the tasks of a group to finish and free it.
+ * @param self
+ */
+void freeTaskGroup(TaskGroup self);
+
+/**
+ * Stop the workers of a scheduler and free it. All task groups of the
+ * scheduler must have been freed first.
+ * @param self
+ */
+void freeTaskScheduler(TaskScheduler self);
+
+#endif
@@ -0,0 +1,321 @@
+//
+// Thread.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+// Needed for pthread_setaffinity_np()
+#if LINUX && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include "Thread.h"
+
+#include "logging/EventLogger.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Realtime priority of the processing thread, out of 99 on Linux. This is
+// below the priorities which JACK and the kernel's own threads usually use.
+#define THREAD_REALTIME_PRIORITY 70
+
+static CpuTopology _pinningTopology = NULL;
+
+#if WINDOWS
+#include <process.h>
+
+static unsigned int __stdcall _threadEntry(void *threadPtr) {
+  Thread thread = (Thread)threadPtr;
+  thread->function(thread->userData);
+  return 0;
+}
+#elif UNIX
+static void *_threadEntry(void *threadPtr) {
+  Thread thread = (Thread)threadPtr;
+  thread->function(thread->userData);
+  return NULL;
+}
+#endif
+
+Thread newThread(ThreadFunc function, void *userData) {
+  Thread thread = (Thread)malloc(sizeof(ThreadMembers));
+
+  thread->function = function;
+  thread->userData = userData;
+  thread->_joined = false;
+
+#if WINDOWS
+  thread->_handle =
+      (HANDLE)_beginthreadex(NULL, 0, _threadEntry, thread, 0, NULL);
+
+  if (thread->_handle == 0) {
+    logError("Could not create thread");
+    free(thread);
+    return NULL;
+  }
+#elif UNIX
+  if (pthread_create(&thread->_thread, NULL, _threadEntry, thread) != 0) {
+    logError("Could not create thread");
+    free(thread);
+    return NULL;
+  }
+#endif
+
+  return thread;
+}
+
+void threadJoin(Thread self) {
+  if (self == NULL || self->_joined) {
+    return;
+  }
+
+#if WINDOWS
+  WaitForSingleObject(self->_handle, INFINITE);
+  CloseHandle(self->_handle);
+#elif UNIX
+  pthread_join(self->_thread, NULL);
+#endif
+  self->_joined = true;
+}
+
+void freeThread(Thread self) {
+  if (self != NULL) {
+    threadJoin(self);
+    free(self);
+  }
+}
+
+boolByte threadSetAffinity(Thread self, unsigned int processor) {
+#if WINDOWS
+  HANDLE handle = self != NULL ? self->_handle : GetCurrentThread();
+
+  if (processor >= sizeof(DWORD_PTR) * 8 ||
+      SetThreadAffinityMask(handle, (DWORD_PTR)1 << processor) == 0) {
+    logWarn("Could not run thread on processor %d", processor);
+    return false;
+  }
+
+  return true;
+#elif LINUX
+  pthread_t thread = self != NULL ? self->_thread : pthread_self();
+  cpu_set_t processors;
+
+  if (processor >= CPU_SETSIZE) {
+    logWarn("Could not run thread on processor %d", processor);
+    return false;
+  }
+
+  CPU_ZERO(&processors);
+  CPU_SET(processor, &processors);
+
+  if (pthread_setaffinity_np(thread, sizeof(cpu_set_t), &processors) != 0) {
+    logWarn("Could not run thread on processor %d", processor);
+    return false;
+  }
+
+  return true;
+#else
+  // Mac OS X only supports affinity hints between threads, not processors
+  logUnsupportedFeature("Thread affinity");
+  return false;
+#endif
+}
+
+void setThreadPinning(boolByte enabled) {
+  if (enabled && _pinningTopology == NULL) {
+    _pinningTopology = newCpuTopology();
+    logDebug("Pinning threads to %d processors on %d cores and %d NUMA nodes",
+             _pinningTopology->numProcessors, _pinningTopology->numCores,
+             _pinningTopology->numNumaNodes);
+  } else if (!enabled) {
+    freeCpuTopology(_pinningTopology);
+    _pinningTopology = NULL;
+  }
+}
+
+boolByte threadPin(Thread self, ThreadPlacement placement, unsigned int index) {
+  if (_pinningTopology == NULL || placement == THREAD_PLACEMENT_NONE) {
+    return false;
+  }
+
+  return threadSetAffinity(
+      self, cpuTopologyGetProcessor(_pinningTopology, placement, index));
+}
+
+boolByte setCurrentThreadRealtimePriority(void) {
+#if WINDOWS
+  if (!SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL)) {
+    logWarn("Could not raise the priority of the processing thread");
+    return false;
+  }
+
+  return true;
+#elif UNIX
+  struct sched_param parameters;
+  int minPriority = sched_get_priority_min(SCHED_FIFO);
+  int maxPriority = sched_get_priority_max(SCHED_FIFO);
+  int error;
+
+  parameters.sched_priority = THREAD_REALTIME_PRIORITY;
+
+  if (parameters.sched_priority > maxPriority) {
+    parameters.sched_priority = maxPriority;
+  } else if (parameters.sched_priority < minPriority) {
+    parameters.sched_priority = minPriority;
+  }
+
+  if ((error = pthread_setschedparam(pthread_self(), SCHED_FIFO,
+                                     &parameters)) != 0) {
+    logWarn("Could not use realtime scheduling for the processing thread: %s",
+            strerror(error));
+    return false;
+  }
+
+  return true;
+#else
+  logUnsupportedFeature("Realtime thread priority");
+  return false;
+#endif
+}
+
+#if WINDOWS
+unsigned long atomicLoad(volatile unsigned long *value) {
+  return (unsigned long)InterlockedCompareExchange((volatile LONG *)value, 0,
+                                                   0);
+}
+
+void atomicStore(volatile unsigned long *value, unsigned long newValue) {
+  InterlockedExchange((volatile LONG *)value, (LONG)newValue);
+}
+
+unsigned long atomicAdd(volatile unsigned long *value, unsigned long amount) {
+  return (unsigned long)InterlockedExchangeAdd((volatile LONG *)value,
+                                               (LONG)amount) +
+         amount;
+}
+
+boolByte atomicCompareAndSwap(volatile unsigned long *value,
+                              unsigned long expected, unsigned long newValue) {
+  return (boolByte)(InterlockedCompareExchange((volatile LONG *)value,
+                                               (LONG)newValue,
+                                               (LONG)expected) ==
+                    (LONG)expected);
+}
+#else
+unsigned long atomicLoad(volatile unsigned long *value) {
+  return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+}
+
+void atomicStore(volatile unsigned long *value, unsigned long newValue) {
+  __atomic_store_n(value, newValue, __ATOMIC_SEQ_CST);
+}
+
+unsigned long atomicAdd(volatile unsigned long *value, unsigned long amount) {
+  return __atomic_add_fetch(value, amount, __ATOMIC_SEQ_CST);
+}
+
+boolByte atomicCompareAndSwap(volatile unsigned long *value,
+                              unsigned long expected, unsigned long newValue) {
+  return (boolByte)__atomic_compare_exchange_n(
+      value, &expected, newValue, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+#endif
+
+unsigned long atomicSubtract(volatile unsigned long *value,
+                             unsigned long amount) {
+  return atomicAdd(value, (unsigned long)0 - amount);
+}
+
+Mutex newMutex(void) {
+  Mutex mutex = (Mutex)malloc(sizeof(MutexMembers));
+#if WINDOWS
+  InitializeCriticalSection(&mutex->_criticalSection);
+#elif UNIX
+  pthread_mutex_init(&mutex->_mutex, NULL);
+#endif
+  return mutex;
+}
+
+void mutexLock(Mutex self) {
+#if WINDOWS
+  EnterCriticalSection(&self->_criticalSection);
+#elif UNIX
+  pthread_mutex_lock(&self->_mutex);
+#endif
+}
+
+void mutexUnlock(Mutex self) {
+#if WINDOWS
+  LeaveCriticalSection(&self->_criticalSection);
+#elif UNIX
+  pthread_mutex_unlock(&self->_mutex);
+#endif
+}
+
+void freeMutex(Mutex self) {
+  if (self != NULL) {
+#if WINDOWS
+    DeleteCriticalSection(&self->_criticalSection);
+#elif UNIX
+    pthread_mutex_destroy(&self->_mutex);
+#endif
+    free(self);
+  }
+}
+
+Condition newCondition(void) {
+  Condition condition = (Condition)malloc(sizeof(ConditionMembers));
+#if WINDOWS
+  InitializeConditionVariable(&condition->_condition);
+#elif UNIX
+  pthread_cond_init(&condition->_condition, NULL);
+#endif
+  return condition;
+}
+
+void conditionWait(Condition self, Mutex mutex) {
+#if WINDOWS
+  SleepConditionVariableCS(&self->_condition, &mutex->_criticalSection,
+                           INFINITE);
+#elif UNIX
+  pthread_cond_wait(&self->_condition, &mutex->_mutex);
+#endif
+}
+
+void conditionSignalAll(Condition self) {
+#if WINDOWS
+  WakeAllConditionVariable(&self->_condition);
+#elif UNIX
+  pthread_cond_broadcast(&self->_condition);
+#endif
+}
+
+void freeCondition(Condition self) {
+  if (self != NULL) {
+#if UNIX
+    pthread_cond_destroy(&self->_condition);
+#endif
+    free(self);
+  }
+}
@@ -0,0 +1,241 @@
+//
+// Thread.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_Thread_h
+#define MrsWatson_Thread_h
+
+#include "base/PlatformInfo.h"
+#include "base/Types.h"
+
+#if UNIX
+#include <pthread.h>
+#endif
+
+/**
+ * Storage class for variables which have a separate instance in each thread.
+ */
+#if WINDOWS
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+/**
+ * Function which is executed on a separate thread.
+ * @param userData User data passed to newThread()
+ */
+typedef void (*ThreadFunc)(void *userData);
+
+typedef struct {
+  ThreadFunc function;
+  void *userData;
+  boolByte _joined;
+
+#if WINDOWS
+  HANDLE _handle;
+#elif UNIX
+  pthread_t _thread;
+#endif
+} ThreadMembers;
+typedef ThreadMembers *Thread;
+
+typedef struct {
+#if WINDOWS
+  CRITICAL_SECTION _criticalSection;
+#elif UNIX
+  pthread_mutex_t _mutex;
+#endif
+} MutexMembers;
+typedef MutexMembers *Mutex;
+
+typedef struct {
+#if WINDOWS
+  CONDITION_VARIABLE _condition;
+#elif UNIX
+  pthread_cond_t _condition;
+#endif
+} ConditionMembers;
+typedef ConditionMembers *Condition;
+
+/**
+ * Create and start a new thread.
+ * @param function Function to execute on the new thread
+ * @param userData Argument to pass to the function
+ * @return Running thread, or NULL if the thread could not be started
+ */
+Thread newThread(ThreadFunc function, void *userData);
+
+/**
+ * Wait for a thread to finish executing. Calling this function more than once
+ * on the same thread has no effect.
+ * @param self
+ */
+void threadJoin(Thread self);
+
+/**
+ * Free a thread and its associated resources. If the thread has not yet been
+ * joined, then this function will block until the thread finishes.
+ * @param self
+ */
+void freeThread(Thread self);
+
+/**
+ * Run a thread only on a single processor. This can reduce cache misses for
+ * threads which always work on the same data, but prevents the operating
+ * system from balancing the load, so it should only be used when there are at
+ * most as many busy threads as processors.
+ * @param self Thread to pin, or NULL for the calling thread
+ * @param processor Zero-based processor index
+ * @return True if the affinity was set, false if it could not be set or if
+ * this is not supported on this platform
+ */
+boolByte threadSetAffinity(Thread self, unsigned int processor);
+
+/**
+ * Enable or disable threadPin() for the whole program. This reads the CPU
+ * topology when enabled, and must be called before any threads are pinned.
+ * @param enabled True to pin threads, false to leave their placement to the
+ * operating system and release the topology
+ */
+void setThreadPinning(boolByte enabled);
+
+/**
+ * Pin one of a set of threads to a processor, if pinning has been enabled
+ * with setThreadPinning(). Since memory on Linux is allocated on the NUMA node
+ * of the thread which first touches it, buffers which are allocated and
+ * cleared by a pinned thread will stay local to it.
+ * @param self Thread to pin, or NULL for the calling thread
+ * @param placement How the set of threads should be placed
+ * @param index Index of the thread in the set, where the thread which starts
+ * the others is usually 0
+ * @return True if the thread was pinned
+ */
+boolByte threadPin(Thread self, ThreadPlacement placement, unsigned int index);
+
+/**
+ * Run the calling thread with realtime scheduling (SCHED_FIFO on Unix), so
+ * that it is not preempted by normal threads. On Linux this needs the
+ * CAP_SYS_NICE capability or a high enough RLIMIT_RTPRIO.
+ * @return True if the scheduling policy was changed
+ */
+boolByte setCurrentThreadRealtimePriority(void);
+
+/**
+ * Atomically read a value which may be written by other threads. All of the
+ * atomic functions are sequentially consistent.
+ * @param value Value to read
+ * @return Current value
+ */
+unsigned long atomicLoad(volatile unsigned long *value);
+
+/**
+ * Atomically write a value which may be read by other threads.
+ * @param value Value to write
+ * @param newValue New value
+ */
+void atomicStore(volatile unsigned long *value, unsigned long newValue);
+
+/**
+ * Atomically add to a value.
+ * @param value Value to change
+ * @param amount Amount to add
+ * @return The value after the addition
+ */
+unsigned long atomicAdd(volatile unsigned long *value, unsigned long amount);
+
+/**
+ * Atomically subtract from a value.
+ * @param value Value to change
+ * @param amount Amount to subtract
+ * @return The value after the subtraction
+ */
+unsigned long atomicSubtract(volatile unsigned long *value,
+                             unsigned long amount);
+
+/**
+ * Atomically replace a value, but only if it has not been changed by another
+ * thread in the meantime.
+ * @param value Value to change
+ * @param expected Value which was last read
+ * @param newValue New value
+ * @return True if the value was equal to expected and has been replaced
+ */
+boolByte atomicCompareAndSwap(volatile unsigned long *value,
+                              unsigned long expected, unsigned long newValue);
+
+/**
+ * Create a new (non-recursive) mutex.
+ * @return Initialized mutex
+ */
+Mutex newMutex(void);
+
+/**
+ * Lock a mutex, blocking if it is already locked by another thread.
+ * @param self
+ */
+void mutexLock(Mutex self);
+
+/**
+ * Unlock a mutex previously locked by the calling thread.
+ * @param self
+ */
+void mutexUnlock(Mutex self);
+
+/**
+ * Free a mutex. The mutex must not be locked.
+ * @param self
+ */
+void freeMutex(Mutex self);
+
+/**
+ * Create a new condition variable.
+ * @return Initialized condition variable
+ */
+Condition newCondition(void);
+
+/**
+ * Atomically unlock a mutex and wait for the condition to be signaled. The
+ * mutex is locked again before this function returns. Spurious wakeups are
+ * possible, so callers should always wait in a loop which checks the actual
+ * condition.
+ * @param self
+ * @param mutex Mutex which must be locked by the calling thread
+ */
+void conditionWait(Condition self, Mutex mutex);
+
+/**
+ * Wake up all threads waiting on this condition.
+ * @param self
+ */
+void conditionSignalAll(Condition self);
+
+/**
+ * Free a condition variable. No threads may be waiting on it.
+ * @param self
+ */
+void freeCondition(Condition self);
+
+#endif
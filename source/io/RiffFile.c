@@ -39,8 +39,8 @@ RiffChunk newRiffChunk(void) {
   return chunk;
 }
 
-boolByte riffChunkReadNext(RiffChunk self, FILE *fileHandle,
-                           boolByte readData) {
+static boolByte _riffChunkReadNext(RiffChunk self, FILE *fileHandle,
+                                   boolByte readData, boolByte bigEndian) {
   size_t itemsRead = 0;
   byte *chunkSize;
 
@@ -60,7 +60,8 @@ boolByte riffChunkReadNext(RiffChunk self, FILE *fileHandle,
       return false;
     }
 
-    self->size = convertByteArrayToUnsignedInt(chunkSize);
+    self->size = bigEndian ? convertBigEndianByteArrayToUnsignedInt(chunkSize)
+                           : convertByteArrayToUnsignedInt(chunkSize);
     free(chunkSize);
 
     if (self->size > 0 && readData) {
@@ -76,6 +77,16 @@ boolByte riffChunkReadNext(RiffChunk self, FILE *fileHandle,
   return (boolByte)!feof(fileHandle);
 }
 
+boolByte riffChunkReadNext(RiffChunk self, FILE *fileHandle,
+                           boolByte readData) {
+  return _riffChunkReadNext(self, fileHandle, readData, false);
+}
+
+boolByte riffChunkReadNextBigEndian(RiffChunk self, FILE *fileHandle,
+                                    boolByte readData) {
+  return _riffChunkReadNext(self, fileHandle, readData, true);
+}
+
 boolByte riffChunkIsIdEqualTo(const RiffChunk self, const char *id) {
   return (boolByte)(strncmp(self->id, id, 4) == 0);
 }
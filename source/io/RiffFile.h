@@ -57,6 +57,19 @@ RiffChunk newRiffChunk(void);
  */
 boolByte riffChunkReadNext(RiffChunk self, FILE *fileHandle, boolByte readData);
 
+/**
+ * Read the next chunk of an IFF file (ie, AIFF) into this object. IFF files
+ * have exactly the same chunk layout as RIFF files, except that the chunk size
+ * is stored as a big endian integer.
+ * @param self
+ * @param fileHandle IFF file, which should be opened for reading
+ * @param readData If true, save the contents of the chunk in the RiffChunk's
+ * data field. See riffChunkReadNext() for details.
+ * @return True if the chunk was successfully read
+ */
+boolByte riffChunkReadNextBigEndian(RiffChunk self, FILE *fileHandle,
+                                    boolByte readData);
+
 /**
  * Test to see if this chunk's ID is equal to the given four character sequence
  * @param self
@@ -26,6 +26,7 @@
 
 #include "SampleSource.h"
 
+#include "audio/AudioSettings.h"
 #include "base/File.h"
 #include "logging/EventLogger.h"
 
@@ -33,6 +34,12 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if WINDOWS
+#include <io.h>
+#elif UNIX
+#include <unistd.h>
+#endif
+
 void sampleSourcePrintSupportedTypes(void) {
   logInfo("Supported audio file types:");
 // We can theoretically support more formats, pretty much anything audiofile
@@ -40,9 +47,7 @@ void sampleSourcePrintSupportedTypes(void) {
 // would work here. However, most of those file types are rather uncommon, and
 // require
 // special setup when writing, so we only choose the most common ones.
-#if USE_AUDIOFILE
-  logInfo("- AIFF (via libaudiofile)");
-#endif
+  logInfo("- AIFF/AIFC (internal)");
 #if USE_FLAC
   logInfo("- FLAC (via libaudiofile)");
 #endif
@@ -85,15 +90,12 @@ static SampleSourceType _sampleSourceGuess(const CharString sampleSourceName) {
                charStringIsEqualToCString(sourceFileExtension, "dat", true)) {
         result = SAMPLE_SOURCE_TYPE_PCM;
       }
-
-#if USE_AUDIOFILE
       else if (charStringIsEqualToCString(sourceFileExtension, "aif", true) ||
-               charStringIsEqualToCString(sourceFileExtension, "aiff", true)) {
+               charStringIsEqualToCString(sourceFileExtension, "aiff", true) ||
+               charStringIsEqualToCString(sourceFileExtension, "aifc", true)) {
         result = SAMPLE_SOURCE_TYPE_AIFF;
       }
 
-#endif
-
 #if USE_FLAC
       else if (charStringIsEqualToCString(sourceFileExtension, "flac", true)) {
         result = SAMPLE_SOURCE_TYPE_FLAC;
@@ -116,6 +118,7 @@ static SampleSourceType _sampleSourceGuess(const CharString sampleSourceName) {
   return result;
 }
 
+extern SampleSource _newSampleSourceAiff(const CharString sampleSourceName);
 extern SampleSource
 _newSampleSourceAudiofile(const CharString sampleSourceName,
                           const SampleSourceType sampleSourceType);
@@ -133,11 +136,10 @@ SampleSource sampleSourceFactory(const CharString sampleSourceName) {
   case SAMPLE_SOURCE_TYPE_PCM:
     return _newSampleSourcePcm(sampleSourceName);
 
-#if USE_AUDIOFILE
-
+  // AIFF is always read natively, even when audiofile is available, since
+  // this avoids the extra buffering and conversion done by audiofile.
   case SAMPLE_SOURCE_TYPE_AIFF:
-    return _newSampleSourceAudiofile(sampleSourceName, sampleSourceType);
-#endif
+    return _newSampleSourceAiff(sampleSourceName);
 
 #if USE_FLAC
 
@@ -160,6 +162,70 @@ SampleSource sampleSourceFactory(const CharString sampleSourceName) {
   }
 }
 
+boolByte sampleSourceSync(SampleSource self) {
+  if (self == NULL || self->syncSampleSource == NULL) {
+    return false;
+  }
+
+  if (self->openedAs != SAMPLE_SOURCE_OPEN_WRITE) {
+    logWarn("Sample source '%s' cannot be synced, it is not open for writing",
+            self->sourceName->data);
+    return false;
+  }
+
+  return self->syncSampleSource(self);
+}
+
+boolByte sampleSourceSeek(SampleSource self, SampleCount frame) {
+  SampleCount currentFrame;
+  SampleBuffer buffer;
+  boolByte result = true;
+
+  if (self == NULL || self->openedAs != SAMPLE_SOURCE_OPEN_READ) {
+    return false;
+  }
+
+  if (self->seekSampleSource != NULL && self->seekSampleSource(self, frame)) {
+    self->numSamplesProcessed = frame * getNumChannels();
+    return true;
+  }
+
+  currentFrame = self->numSamplesProcessed / getNumChannels();
+
+  if (frame < currentFrame) {
+    logError("Sample source '%s' cannot seek backwards",
+             self->sourceName->data);
+    return false;
+  }
+
+  buffer = newSampleBuffer(getNumChannels(), getBlocksize());
+
+  while (result && currentFrame < frame) {
+    buffer->blocksize = frame - currentFrame < getBlocksize()
+                            ? frame - currentFrame
+                            : getBlocksize();
+    result = self->readSampleBlock(self, buffer);
+    currentFrame = self->numSamplesProcessed / getNumChannels();
+  }
+
+  freeSampleBuffer(buffer);
+  return (boolByte)(currentFrame == frame);
+}
+
+boolByte sampleSourceFlushFileHandle(FILE *fileHandle) {
+  if (fileHandle == NULL || fflush(fileHandle) != 0) {
+    return false;
+  }
+
+#if WINDOWS
+  return (boolByte)(_commit(_fileno(fileHandle)) == 0);
+#elif UNIX
+  return (boolByte)(fsync(fileno(fileHandle)) == 0);
+#else
+  return true;
+#endif
+}
+
 void freeSampleSource(SampleSource self) {
   if (self != NULL) {
     self->freeSampleSourceData(self->extraData);
@@ -31,6 +31,8 @@
 #include "base/CharString.h"
 #include "base/Types.h"
 
+#include <stdio.h>
+
 typedef enum {
   SAMPLE_SOURCE_TYPE_INVALID,
   SAMPLE_SOURCE_TYPE_SILENCE,
@@ -53,6 +55,8 @@ typedef enum {
 typedef boolByte (*OpenSampleSourceFunc)(void *, const SampleSourceOpenAs);
 typedef boolByte (*ReadSampleBlockFunc)(void *, SampleBuffer);
 typedef boolByte (*WriteSampleBlockFunc)(void *, const SampleBuffer);
+typedef boolByte (*SyncSampleSourceFunc)(void *);
+typedef boolByte (*SeekSampleSourceFunc)(void *, SampleCount);
 typedef void (*CloseSampleSourceFunc)(void *);
 typedef void (*FreeSampleSourceDataFunc)(void *);
 
@@ -65,6 +69,10 @@ typedef struct {
   OpenSampleSourceFunc openSampleSource;
   ReadSampleBlockFunc readSampleBlock;
   WriteSampleBlockFunc writeSampleBlock;
+  // May be NULL for sources which cannot be synced, see sampleSourceSync()
+  SyncSampleSourceFunc syncSampleSource;
+  // May be NULL for sources which cannot seek, see sampleSourceSeek()
+  SeekSampleSourceFunc seekSampleSource;
   CloseSampleSourceFunc closeSampleSource;
   FreeSampleSourceDataFunc freeSampleSourceData;
 
@@ -80,6 +88,38 @@ typedef SampleSourceMembers *SampleSource;
  */
 SampleSource sampleSourceFactory(const CharString sampleSourceName);
 
+/**
+ * Make all data written so far readable by other programs while the source is
+ * still open. For file formats which have a header, the sizes stored in the
+ * header are rewritten to match the data written so far. The file is then
+ * flushed to disk.
+ * @param self
+ * @return True if the source was synced, false if the source does not support
+ * syncing or an error occurred
+ */
+boolByte sampleSourceSync(SampleSource self);
+
+/**
+ * Move the read position of a source which is open for reading to the given
+ * frame, so that the next block read starts there. Sources which cannot seek
+ * directly are read up to that frame instead, in which case the frame may not
+ * be before the current read position.
+ * @param self
+ * @param frame Frame to seek to, counted from the start of the source
+ * @return True if the read position was moved, false if the source is not
+ * open for reading or the frame could not be reached
+ */
+boolByte sampleSourceSeek(SampleSource self, SampleCount frame);
+
+/**
+ * Flush a file handle used by a sample source and ask the operating system to
+ * commit its contents to disk. This is a helper function for the sync
+ * implementations of file-based sample sources.
+ * @param fileHandle File handle open for writing
+ * @return True if the data was written to disk
+ */
+boolByte sampleSourceFlushFileHandle(FILE *fileHandle);
+
 /**
  * Print a list of all supported sample source pipes to the log
  */
@@ -0,0 +1,898 @@
+//
+// SampleSourceAiff.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "SampleSourceAiff.h"
+
+#include "base/Endian.h"
+#include "io/RiffFile.h"
+#include "io/SampleSource.h"
+#include "logging/EventLogger.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// AIFC files must begin with a format version chunk containing this timestamp
+#define AIFC_VERSION_1 0xA2805140
+#define AIFF_COMM_CHUNK_SIZE 18
+#define AIFF_EXTENDED_SIZE 10
+// Name written in the COMM chunk of floating point AIFC files, stored as a
+// Pascal-style string (count byte, then characters padded to an even length)
+static const char *kAiffFloatCompressionName = "32-bit float";
+
+// The decoding and encoding functions below work on contiguous interleaved
+// data and have no branches inside the loop, so that the compiler is free to
+// vectorize the byte swapping and conversion. Channel (de)interleaving is done
+// separately in _readBlockFromAiffFile and _writeBlockToAiffFile.
+
+static void _decodeBigEndian8Bit(const byte *restrict rawSamples,
+                                 Sample *restrict samples, size_t numSamples) {
+  const Sample scale = 1.0f / 127.0f;
+  size_t i;
+
+  for (i = 0; i < numSamples; i++) {
+    samples[i] = (Sample)((signed char)rawSamples[i]) * scale;
+  }
+}
+
+static void _decodeBigEndian16Bit(const byte *restrict rawSamples,
+                                  Sample *restrict samples, size_t numSamples) {
+  const Sample scale = 1.0f / 32767.0f;
+  size_t i;
+
+  for (i = 0; i < numSamples; i++) {
+    const byte *s = rawSamples + i * 2;
+    samples[i] = (Sample)((short)((s[0] << 8) | s[1])) * scale;
+  }
+}
+
+static void _decodeLittleEndian16Bit(const byte *restrict rawSamples,
+                                     Sample *restrict samples,
+                                     size_t numSamples) {
+  const Sample scale = 1.0f / 32767.0f;
+  size_t i;
+
+  for (i = 0; i < numSamples; i++) {
+    const byte *s = rawSamples + i * 2;
+    samples[i] = (Sample)((short)((s[1] << 8) | s[0])) * scale;
+  }
+}
+
+static void _decodeBigEndian24Bit(const byte *restrict rawSamples,
+                                  Sample *restrict samples, size_t numSamples) {
+  const Sample scale = 1.0f / 8388607.0f;
+  size_t i;
+
+  for (i = 0; i < numSamples; i++) {
+    const byte *s = rawSamples + i * 3;
+    // Place the sample in the top 24 bits, then shift it back down so that the
+    // sign bit is extended for us.
+    const int value = (int)(((unsigned int)s[0] << 24) |
+                            ((unsigned int)s[1] << 16) |
+                            ((unsigned int)s[2] << 8)) >>
+                      8;
+    samples[i] = (Sample)value * scale;
+  }
+}
+
+static void _decodeLittleEndian24Bit(const byte *restrict rawSamples,
+                                     Sample *restrict samples,
+                                     size_t numSamples) {
+  const Sample scale = 1.0f / 8388607.0f;
+  size_t i;
+
+  for (i = 0; i < numSamples; i++) {
+    const byte *s = rawSamples + i * 3;
+    const int value = (int)(((unsigned int)s[2] << 24) |
+                            ((unsigned int)s[1] << 16) |
+                            ((unsigned int)s[0] << 8)) >>
+                      8;
+    samples[i] = (Sample)value * scale;
+  }
+}
+
+static void _decodeBigEndian32Bit(const byte *restrict rawSamples,
+                                  Sample *restrict samples, size_t numSamples) {
+  const double scale = 1.0 / 2147483647.0;
+  size_t i;
+
+  for (i = 0; i < numSamples; i++) {
+    const int value =
+        (int)convertBigEndianByteArrayToUnsignedInt(rawSamples + i * 4);
+    samples[i] = (Sample)((double)value * scale);
+  }
+}
+
+static void _decodeLittleEndian32Bit(const byte *restrict rawSamples,
+                                     Sample *restrict samples,
+                                     size_t numSamples) {
+  const double scale = 1.0 / 2147483647.0;
+  size_t i;
+
+  for (i = 0; i < numSamples; i++) {
+    const byte *s = rawSamples + i * 4;
+    const int value =
+        (int)(((unsigned int)s[3] << 24) | ((unsigned int)s[2] << 16) |
+              ((unsigned int)s[1] << 8) | (unsigned int)s[0]);
+    samples[i] = (Sample)((double)value * scale);
+  }
+}
+
+static void _decodeBigEndianFloat(const byte *restrict rawSamples,
+                                  Sample *restrict samples, size_t numSamples) {
+  size_t i;
+
+  for (i = 0; i < numSamples; i++) {
+    const unsigned int value =
+        convertBigEndianByteArrayToUnsignedInt(rawSamples + i * 4);
+    float floatValue;
+    memcpy(&floatValue, &value, sizeof(float));
+    samples[i] = floatValue;
+  }
+}
+
+static void _encodeBigEndian8Bit(const Sample *restrict samples,
+                                 byte *restrict rawSamples, size_t numSamples) {
+  size_t i;
+
+  for (i = 0; i < numSamples; i++) {
+    rawSamples[i] = (byte)(signed char)(samples[i] * 127.0f);
+  }
+}
+
+static void _encodeBigEndian16Bit(const Sample *restrict samples,
+                                  byte *restrict rawSamples,
+                                  size_t numSamples) {
+  size_t i;
+
+  for (i = 0; i < numSamples; i++) {
+    const short value = (short)(samples[i] * 32767.0f);
+    rawSamples[i * 2] = (byte)((value >> 8) & 0xff);
+    rawSamples[i * 2 + 1] = (byte)(value & 0xff);
+  }
+}
+
+static void _encodeBigEndian24Bit(const Sample *restrict samples,
+                                  byte *restrict rawSamples,
+                                  size_t numSamples) {
+  size_t i;
+
+  for (i = 0; i < numSamples; i++) {
+    const int value = (int)(samples[i] * 8388607.0f);
+    rawSamples[i * 3] = (byte)((value >> 16) & 0xff);
+    rawSamples[i * 3 + 1] = (byte)((value >> 8) & 0xff);
+    rawSamples[i * 3 + 2] = (byte)(value & 0xff);
+  }
+}
+
+static void _encodeBigEndianFloat(const Sample *restrict samples,
+                                  byte *restrict rawSamples,
+                                  size_t numSamples) {
+  size_t i;
+
+  for (i = 0; i < numSamples; i++) {
+    const float floatValue = samples[i];
+    unsigned int value;
+    memcpy(&value, &floatValue, sizeof(unsigned int));
+    rawSamples[i * 4] = (byte)(value >> 24);
+    rawSamples[i * 4 + 1] = (byte)((value >> 16) & 0xff);
+    rawSamples[i * 4 + 2] = (byte)((value >> 8) & 0xff);
+    rawSamples[i * 4 + 3] = (byte)(value & 0xff);
+  }
+}
+
+static boolByte _setAiffSampleFormatFunctions(SampleSourceAiffData extraData) {
+  extraData->decodeSamples = NULL;
+  extraData->encodeSamples = NULL;
+
+  switch (extraData->sampleFormat) {
+  case kAiffSampleFormatBigEndianInt:
+    switch (extraData->bitDepth) {
+    case kBitDepth8Bit:
+      extraData->decodeSamples = _decodeBigEndian8Bit;
+      extraData->encodeSamples = _encodeBigEndian8Bit;
+      break;
+
+    case kBitDepth16Bit:
+      extraData->decodeSamples = _decodeBigEndian16Bit;
+      extraData->encodeSamples = _encodeBigEndian16Bit;
+      break;
+
+    case kBitDepth24Bit:
+      extraData->decodeSamples = _decodeBigEndian24Bit;
+      extraData->encodeSamples = _encodeBigEndian24Bit;
+      break;
+
+    case kBitDepth32Bit:
+      extraData->decodeSamples = _decodeBigEndian32Bit;
+      break;
+
+    default:
+      break;
+    }
+
+    break;
+
+  case kAiffSampleFormatLittleEndianInt:
+    switch (extraData->bitDepth) {
+    case kBitDepth8Bit:
+      extraData->decodeSamples = _decodeBigEndian8Bit;
+      break;
+
+    case kBitDepth16Bit:
+      extraData->decodeSamples = _decodeLittleEndian16Bit;
+      break;
+
+    case kBitDepth24Bit:
+      extraData->decodeSamples = _decodeLittleEndian24Bit;
+      break;
+
+    case kBitDepth32Bit:
+      extraData->decodeSamples = _decodeLittleEndian32Bit;
+      break;
+
+    default:
+      break;
+    }
+
+    break;
+
+  case kAiffSampleFormatBigEndianFloat:
+    if (extraData->bitDepth == kBitDepth32Bit) {
+      extraData->decodeSamples = _decodeBigEndianFloat;
+      extraData->encodeSamples = _encodeBigEndianFloat;
+    }
+
+    break;
+
+  default:
+    break;
+  }
+
+  extraData->bytesPerSample = (size_t)extraData->bitDepth / 8;
+  return (boolByte)(extraData->decodeSamples != NULL);
+}
+
+// The sample rate in the COMM chunk is stored as an 80-bit IEEE 754 extended
+// precision number: 1 sign bit, 15 exponent bits, and a 64-bit mantissa with an
+// explicit leading one.
+static double _convertExtendedToDouble(const byte *extended) {
+  const int exponent = ((extended[0] & 0x7f) << 8) | extended[1];
+  const unsigned int mantissaHigh =
+      convertBigEndianByteArrayToUnsignedInt(extended + 2);
+  const unsigned int mantissaLow =
+      convertBigEndianByteArrayToUnsignedInt(extended + 6);
+  double result;
+
+  if (exponent == 0 && mantissaHigh == 0 && mantissaLow == 0) {
+    return 0.0;
+  }
+
+  result = ldexp((double)mantissaHigh, exponent - 16383 - 31) +
+           ldexp((double)mantissaLow, exponent - 16383 - 63);
+  return (extended[0] & 0x80) ? -result : result;
+}
+
+static void _convertDoubleToExtended(const double value, byte *extended) {
+  int exponent;
+  double mantissa;
+  unsigned int mantissaHigh;
+  unsigned int mantissaLow;
+
+  memset(extended, 0, AIFF_EXTENDED_SIZE);
+
+  if (value <= 0.0) {
+    return;
+  }
+
+  // frexp returns a mantissa in the range [0.5, 1.0), so the exponent is one
+  // larger than that of the normalized extended representation.
+  mantissa = frexp(value, &exponent);
+  exponent += 16382;
+  mantissa = ldexp(mantissa, 32);
+  mantissaHigh = (unsigned int)mantissa;
+  mantissaLow = (unsigned int)ldexp(mantissa - (double)mantissaHigh, 32);
+
+  extended[0] = (byte)((exponent >> 8) & 0x7f);
+  extended[1] = (byte)(exponent & 0xff);
+  extended[2] = (byte)(mantissaHigh >> 24);
+  extended[3] = (byte)((mantissaHigh >> 16) & 0xff);
+  extended[4] = (byte)((mantissaHigh >> 8) & 0xff);
+  extended[5] = (byte)(mantissaHigh & 0xff);
+  extended[6] = (byte)(mantissaLow >> 24);
+  extended[7] = (byte)((mantissaLow >> 16) & 0xff);
+  extended[8] = (byte)((mantissaLow >> 8) & 0xff);
+  extended[9] = (byte)(mantissaLow & 0xff);
+}
+
+static void _putBigEndianUnsignedShort(byte *buffer, unsigned short value) {
+  buffer[0] = (byte)(value >> 8);
+  buffer[1] = (byte)(value & 0xff);
+}
+
+static void _putBigEndianUnsignedInt(byte *buffer, unsigned int value) {
+  buffer[0] = (byte)(value >> 24);
+  buffer[1] = (byte)((value >> 16) & 0xff);
+  buffer[2] = (byte)((value >> 8) & 0xff);
+  buffer[3] = (byte)(value & 0xff);
+}
+
+static boolByte _readAiffCommonChunk(const char *filename,
+                                     SampleSourceAiffData extraData,
+                                     const RiffChunk chunk) {
+  const byte *data = chunk->data;
+  unsigned short sampleSize;
+  char compressionType[5];
+
+  if (chunk->size < AIFF_COMM_CHUNK_SIZE || data == NULL) {
+    logFileError(filename, "Invalid COMM chunk");
+    return false;
+  }
+
+  extraData->numChannels = convertBigEndianByteArrayToUnsignedShort(data);
+  // The number of sample frames is at data + 2, but we don't need it since the
+  // SSND chunk size gives us the same information.
+  sampleSize = convertBigEndianByteArrayToUnsignedShort(data + 6);
+  extraData->sampleRate = _convertExtendedToDouble(data + 8);
+  extraData->sampleFormat = kAiffSampleFormatBigEndianInt;
+
+  if (extraData->isAifc) {
+    if (chunk->size < AIFF_COMM_CHUNK_SIZE + 4) {
+      logFileError(filename, "AIFC COMM chunk has no compression type");
+      return false;
+    }
+
+    memcpy(compressionType, data + AIFF_COMM_CHUNK_SIZE, 4);
+    compressionType[4] = '\0';
+
+    if (!strncmp(compressionType, "NONE", 4) ||
+        !strncmp(compressionType, "twos", 4)) {
+      extraData->sampleFormat = kAiffSampleFormatBigEndianInt;
+    } else if (!strncmp(compressionType, "sowt", 4)) {
+      extraData->sampleFormat = kAiffSampleFormatLittleEndianInt;
+    } else if (!strncmp(compressionType, "fl32", 4) ||
+               !strncmp(compressionType, "FL32", 4)) {
+      extraData->sampleFormat = kAiffSampleFormatBigEndianFloat;
+      sampleSize = 32;
+    } else {
+      logUnsupportedFeature("AIFC compression types other than NONE, sowt, "
+                            "and fl32");
+      return false;
+    }
+  }
+
+  // Sample sizes which are not a multiple of 8 are stored left-justified in
+  // the next largest byte size, so rounding up here is enough to read them.
+  extraData->bitDepth = (BitDepth)(((sampleSize + 7) / 8) * 8);
+
+  if (!_setAiffSampleFormatFunctions(extraData)) {
+    logUnsupportedFeature("AIFF files with this sample size");
+    return false;
+  }
+
+  logDebug("AIFF file has %d channels, %d-bit samples, %gHz",
+           extraData->numChannels, extraData->bitDepth, extraData->sampleRate);
+  return true;
+}
+
+static boolByte _readAiffFileInfo(const char *filename,
+                                  SampleSourceAiffData extraData) {
+  RiffChunk chunk = newRiffChunk();
+  boolByte commChunkFound = false;
+  boolByte ssndChunkFound = false;
+  long ssndDataPosition = 0;
+  byte ssndHeader[8];
+  unsigned int ssndOffset;
+  char format[4];
+  size_t itemsRead;
+
+  if (riffChunkReadNextBigEndian(chunk, extraData->fileHandle, false)) {
+    if (!riffChunkIsIdEqualTo(chunk, "FORM")) {
+      logFileError(filename, "Invalid FORM chunk descriptor");
+      freeRiffChunk(chunk);
+      return false;
+    }
+
+    itemsRead = fread(format, sizeof(byte), 4, extraData->fileHandle);
+
+    if (itemsRead == 4 && !strncmp(format, "AIFF", 4)) {
+      extraData->isAifc = false;
+    } else if (itemsRead == 4 && !strncmp(format, "AIFC", 4)) {
+      extraData->isAifc = true;
+    } else {
+      logFileError(filename, "Invalid format description");
+      freeRiffChunk(chunk);
+      return false;
+    }
+  } else {
+    logFileError(filename, "No chunks following descriptor");
+    freeRiffChunk(chunk);
+    return false;
+  }
+
+  // Unlike WAVE files, the order of the chunks in an AIFF file is not fixed,
+  // and the SSND chunk may appear before COMM. Chunks with an odd size are
+  // followed by a single pad byte.
+  while (!commChunkFound || !ssndChunkFound) {
+    if (!riffChunkReadNextBigEndian(chunk, extraData->fileHandle, false)) {
+      break;
+    }
+
+    if (riffChunkIsIdEqualTo(chunk, "COMM")) {
+      chunk->data = (byte *)malloc(chunk->size);
+
+      if (fread(chunk->data, 1, chunk->size, extraData->fileHandle) !=
+          chunk->size) {
+        logFileError(filename, "Short read in COMM chunk");
+        freeRiffChunk(chunk);
+        return false;
+      }
+
+      if (!_readAiffCommonChunk(filename, extraData, chunk)) {
+        freeRiffChunk(chunk);
+        return false;
+      }
+
+      free(chunk->data);
+      chunk->data = NULL;
+      commChunkFound = true;
+
+      if (chunk->size & 1) {
+        fseek(extraData->fileHandle, 1, SEEK_CUR);
+      }
+    } else if (riffChunkIsIdEqualTo(chunk, "SSND")) {
+      if (chunk->size < 8 ||
+          fread(ssndHeader, 1, 8, extraData->fileHandle) != 8) {
+        logFileError(filename, "Invalid SSND chunk");
+        freeRiffChunk(chunk);
+        return false;
+      }
+
+      ssndOffset = convertBigEndianByteArrayToUnsignedInt(ssndHeader);
+
+      if (ssndOffset > chunk->size - 8) {
+        logFileError(filename, "SSND chunk offset is past the end of chunk");
+        freeRiffChunk(chunk);
+        return false;
+      }
+
+      extraData->dataSize = chunk->size - 8 - ssndOffset;
+      extraData->dataBytesRemaining = extraData->dataSize;
+      ssndDataPosition = ftell(extraData->fileHandle) + (long)ssndOffset;
+      ssndChunkFound = true;
+      logDebug("AIFF file has %lu bytes", extraData->dataBytesRemaining);
+
+      if (!commChunkFound) {
+        fseek(extraData->fileHandle,
+              (long)(chunk->size - 8 + (chunk->size & 1)), SEEK_CUR);
+      }
+    } else {
+      fseek(extraData->fileHandle, (long)(chunk->size + (chunk->size & 1)),
+            SEEK_CUR);
+    }
+  }
+
+  freeRiffChunk(chunk);
+
+  if (!commChunkFound) {
+    logFileError(filename,
+                 "Could not find a COMM chunk. Possibly malformed AIFF file.");
+    return false;
+  }
+
+  if (!ssndChunkFound) {
+    logFileError(filename,
+                 "Could not find a SSND chunk. Possibly malformed AIFF file.");
+    return false;
+  }
+
+  if (fseek(extraData->fileHandle, ssndDataPosition, SEEK_SET) != 0) {
+    logFileError(filename, "Could not seek to sample data");
+    return false;
+  }
+
+  extraData->dataOffset = ssndDataPosition;
+  return true;
+}
+
+static boolByte _writeAiffFileInfo(SampleSourceAiffData extraData) {
+  // Large enough for the biggest header that we write, which is AIFC
+  byte header[96];
+  size_t offset = 0;
+  size_t nameLength = strlen(kAiffFloatCompressionName);
+  // Pascal string length, including count byte and padding to an even length
+  size_t nameSize = (nameLength + 2) & ~(size_t)1;
+
+  memset(header, 0, sizeof(header));
+  memcpy(header, "FORM", 4);
+  // The FORM size will be set again when the file is finished writing
+  memcpy(header + 8, extraData->isAifc ? "AIFC" : "AIFF", 4);
+  offset = 12;
+
+  if (extraData->isAifc) {
+    memcpy(header + offset, "FVER", 4);
+    _putBigEndianUnsignedInt(header + offset + 4, 4);
+    _putBigEndianUnsignedInt(header + offset + 8, AIFC_VERSION_1);
+    offset += 12;
+  }
+
+  memcpy(header + offset, "COMM", 4);
+  _putBigEndianUnsignedInt(
+      header + offset + 4,
+      (unsigned int)(AIFF_COMM_CHUNK_SIZE +
+                     (extraData->isAifc ? 4 + nameSize : 0)));
+  offset += 8;
+  _putBigEndianUnsignedShort(header + offset,
+                             (unsigned short)extraData->numChannels);
+  offset += 2;
+  // Number of sample frames, also set when the file is finished writing
+  extraData->commNumFramesOffset = (long)offset;
+  offset += 4;
+  _putBigEndianUnsignedShort(header + offset,
+                             (unsigned short)extraData->bitDepth);
+  offset += 2;
+  _convertDoubleToExtended(extraData->sampleRate, header + offset);
+  offset += AIFF_EXTENDED_SIZE;
+
+  if (extraData->isAifc) {
+    memcpy(header + offset, "fl32", 4);
+    offset += 4;
+    header[offset] = (byte)nameLength;
+    memcpy(header + offset + 1, kAiffFloatCompressionName, nameLength);
+    offset += nameSize;
+  }
+
+  memcpy(header + offset, "SSND", 4);
+  extraData->ssndSizeOffset = (long)offset + 4;
+  // Followed by the size, offset, and block size fields, which are all zero
+  offset += 16;
+  extraData->dataOffset = (long)offset;
+
+  if (fwrite(header, sizeof(byte), offset, extraData->fileHandle) != offset) {
+    logError("Could not write AIFF header");
+    return false;
+  }
+
+  return true;
+}
+
+static boolByte _openSampleSourceAiff(void *sampleSourcePtr,
+                                      const SampleSourceOpenAs openAs) {
+  SampleSource sampleSource = (SampleSource)sampleSourcePtr;
+  SampleSourceAiffData extraData =
+      (SampleSourceAiffData)sampleSource->extraData;
+
+  if (openAs == SAMPLE_SOURCE_OPEN_READ) {
+    extraData->fileHandle = fopen(sampleSource->sourceName->data, "rb");
+
+    if (extraData->fileHandle != NULL) {
+      if (_readAiffFileInfo(sampleSource->sourceName->data, extraData)) {
+        setNumChannels(extraData->numChannels);
+        setSampleRate(extraData->sampleRate);
+      } else {
+        fclose(extraData->fileHandle);
+        extraData->fileHandle = NULL;
+      }
+    }
+  } else if (openAs == SAMPLE_SOURCE_OPEN_WRITE) {
+    extraData->fileHandle = fopen(sampleSource->sourceName->data, "wb");
+
+    if (extraData->fileHandle != NULL) {
+      extraData->numChannels = (ChannelCount)getNumChannels();
+      extraData->sampleRate = getSampleRate();
+      extraData->bitDepth = getBitDepth();
+      // Plain AIFF only supports integer samples, and since we treat 32-bit
+      // output as floating point everywhere else, write AIFC in that case.
+      extraData->isAifc = (boolByte)(extraData->bitDepth == kBitDepth32Bit);
+      extraData->sampleFormat = extraData->isAifc
+                                    ? kAiffSampleFormatBigEndianFloat
+                                    : kAiffSampleFormatBigEndianInt;
+
+      if (!_setAiffSampleFormatFunctions(extraData) ||
+          extraData->encodeSamples == NULL) {
+        logUnsupportedFeature("Writing AIFF files with this bit depth");
+        fclose(extraData->fileHandle);
+        extraData->fileHandle = NULL;
+      } else if (!_writeAiffFileInfo(extraData)) {
+        fclose(extraData->fileHandle);
+        extraData->fileHandle = NULL;
+      }
+    }
+  } else {
+    logInternalError("Invalid type for openAs in AIFF file");
+    return false;
+  }
+
+  if (extraData->fileHandle == NULL) {
+    logError("AIFF file '%s' could not be opened for %s",
+             sampleSource->sourceName->data,
+             openAs == SAMPLE_SOURCE_OPEN_READ ? "reading" : "writing");
+    return false;
+  }
+
+  sampleSource->openedAs = openAs;
+  return true;
+}
+
+static void _resizeAiffBuffers(SampleSourceAiffData extraData,
+                               size_t numSamples) {
+  if (numSamples > extraData->bufferNumSamples) {
+    free(extraData->rawBuffer);
+    free(extraData->interleavedBuffer);
+    // Allocate 4 bytes per raw sample regardless of the bit depth, so that the
+    // buffers don't need to be reallocated if the format changes.
+    extraData->rawBuffer = (byte *)malloc(numSamples * 4);
+    extraData->interleavedBuffer = (Sample *)malloc(numSamples * sizeof(Sample));
+    extraData->bufferNumSamples = numSamples;
+  }
+}
+
+static boolByte _readBlockFromAiffFile(void *sampleSourcePtr,
+                                       SampleBuffer sampleBuffer) {
+  SampleSource sampleSource = (SampleSource)sampleSourcePtr;
+  ChannelCount channel;
+  size_t frame;
+
+  SampleSourceAiffData extraData =
+      (SampleSourceAiffData)sampleSource->extraData;
+  const ChannelCount fileChannels = extraData->numChannels;
+  const size_t frameSize = fileChannels * extraData->bytesPerSample;
+  SampleCount originalBlocksize = sampleBuffer->blocksize;
+  size_t framesToRead = sampleBuffer->blocksize;
+  size_t framesRead;
+  size_t numSamples;
+
+  if (extraData->fileHandle == NULL || frameSize == 0) {
+    logCritical("Corrupt AIFF data structure");
+    return false;
+  }
+
+  if (framesToRead * frameSize > extraData->dataBytesRemaining) {
+    framesToRead = extraData->dataBytesRemaining / frameSize;
+  }
+
+  _resizeAiffBuffers(extraData, sampleBuffer->blocksize * fileChannels);
+  framesRead = fread(extraData->rawBuffer, frameSize, framesToRead,
+                     extraData->fileHandle);
+  extraData->dataBytesRemaining -= framesRead * frameSize;
+  numSamples = framesRead * fileChannels;
+  extraData->decodeSamples(extraData->rawBuffer, extraData->interleavedBuffer,
+                           numSamples);
+
+  // Deinterleave to the output buffer, mapping channels in the same manner as
+  // sampleBufferCopyAndMapChannels.
+  for (channel = 0; channel < sampleBuffer->numChannels; channel++) {
+    const Sample *source =
+        extraData->interleavedBuffer + (channel % fileChannels);
+    Sample *destination = sampleBuffer->samples[channel];
+
+    for (frame = 0; frame < framesRead; frame++) {
+      destination[frame] = source[frame * fileChannels];
+    }
+  }
+
+  if (framesRead < originalBlocksize) {
+    logDebug("End of AIFF file reached");
+    sampleBuffer->blocksize = framesRead;
+  }
+
+  sampleSource->numSamplesProcessed += numSamples;
+  return (boolByte)(originalBlocksize == sampleBuffer->blocksize);
+}
+
+static boolByte _writeBlockToAiffFile(void *sampleSourcePtr,
+                                      const SampleBuffer sampleBuffer) {
+  SampleSource sampleSource = (SampleSource)sampleSourcePtr;
+  ChannelCount channel;
+  SampleCount frame;
+
+  SampleSourceAiffData extraData =
+      (SampleSourceAiffData)sampleSource->extraData;
+  const ChannelCount fileChannels = extraData->numChannels;
+  const size_t numSamples = sampleBuffer->blocksize * fileChannels;
+  size_t samplesWritten;
+
+  if (extraData->fileHandle == NULL || sampleBuffer->numChannels == 0) {
+    logCritical("Corrupt AIFF data structure");
+    return false;
+  }
+
+  _resizeAiffBuffers(extraData, numSamples);
+
+  for (channel = 0; channel < fileChannels; channel++) {
+    const Sample *source =
+        sampleBuffer->samples[channel % sampleBuffer->numChannels];
+    Sample *destination = extraData->interleavedBuffer + channel;
+
+    for (frame = 0; frame < sampleBuffer->blocksize; frame++) {
+      destination[frame * fileChannels] = source[frame];
+    }
+  }
+
+  extraData->encodeSamples(extraData->interleavedBuffer, extraData->rawBuffer,
+                           numSamples);
+  samplesWritten = fwrite(extraData->rawBuffer, extraData->bytesPerSample,
+                          numSamples, extraData->fileHandle);
+
+  if (samplesWritten < numSamples) {
+    logWarn("Short write to AIFF file");
+  }
+
+  sampleSource->numSamplesProcessed += samplesWritten;
+  return (boolByte)(samplesWritten == numSamples);
+}
+
+static boolByte _seekSampleSourceAiff(void *sampleSourcePtr,
+                                      SampleCount frame) {
+  SampleSource sampleSource = (SampleSource)sampleSourcePtr;
+  SampleSourceAiffData extraData =
+      (SampleSourceAiffData)sampleSource->extraData;
+  const unsigned long frameSize =
+      extraData->numChannels * (unsigned long)extraData->bytesPerSample;
+
+  if (extraData->fileHandle == NULL || frameSize == 0 ||
+      frame > extraData->dataSize / frameSize) {
+    return false;
+  }
+
+  if (fseek(extraData->fileHandle,
+            extraData->dataOffset + (long)(frame * frameSize),
+            SEEK_SET) != 0) {
+    return false;
+  }
+
+  extraData->dataBytesRemaining = extraData->dataSize - frame * frameSize;
+  return true;
+}
+
+static boolByte _patchAiffUnsignedInt(FILE *fileHandle, long position,
+                                      unsigned int value) {
+  byte buffer[4];
+  _putBigEndianUnsignedInt(buffer, value);
+  return (boolByte)(fseek(fileHandle, position, SEEK_SET) == 0 &&
+                    fwrite(buffer, 1, 4, fileHandle) == 4);
+}
+
+static boolByte _writeAiffFileSizes(SampleSource sampleSource,
+                                    boolByte includePadding) {
+  SampleSourceAiffData extraData =
+      (SampleSourceAiffData)sampleSource->extraData;
+  const unsigned long numBytesWritten =
+      sampleSource->numSamplesProcessed * extraData->bytesPerSample;
+  const unsigned long padding = includePadding ? (numBytesWritten & 1) : 0;
+
+  if (!_patchAiffUnsignedInt(
+          extraData->fileHandle, extraData->commNumFramesOffset,
+          (unsigned int)(sampleSource->numSamplesProcessed /
+                         extraData->numChannels)) ||
+      !_patchAiffUnsignedInt(extraData->fileHandle, extraData->ssndSizeOffset,
+                             (unsigned int)(numBytesWritten + 8)) ||
+      !_patchAiffUnsignedInt(extraData->fileHandle, 4,
+                             (unsigned int)(extraData->dataOffset - 8 +
+                                            numBytesWritten + padding))) {
+    logError("Could not write AIFF file sizes");
+    return false;
+  }
+
+  return true;
+}
+
+static boolByte _syncSampleSourceAiff(void *sampleSourcePtr) {
+  SampleSource sampleSource = (SampleSource)sampleSourcePtr;
+  SampleSourceAiffData extraData =
+      (SampleSourceAiffData)sampleSource->extraData;
+
+  // The pad byte is only written when the file is closed, since more samples
+  // will follow. Readers tolerate a missing pad byte at the end of the file.
+  if (extraData->fileHandle == NULL ||
+      !_writeAiffFileSizes(sampleSource, false)) {
+    return false;
+  }
+
+  if (fseek(extraData->fileHandle, 0, SEEK_END) != 0) {
+    logError("Could not seek to end of AIFF file after sync");
+    return false;
+  }
+
+  return sampleSourceFlushFileHandle(extraData->fileHandle);
+}
+
+static void _closeSampleSourceAiff(void *sampleSourceDataPtr) {
+  SampleSource sampleSource = (SampleSource)sampleSourceDataPtr;
+  SampleSourceAiffData extraData =
+      (SampleSourceAiffData)sampleSource->extraData;
+  const byte padding = 0;
+
+  if (extraData->fileHandle == NULL) {
+    return;
+  }
+
+  if (sampleSource->openedAs == SAMPLE_SOURCE_OPEN_WRITE) {
+    // IFF chunks must have an even length
+    if ((sampleSource->numSamplesProcessed * extraData->bytesPerSample) & 1) {
+      if (fwrite(&padding, 1, 1, extraData->fileHandle) != 1) {
+        logError("Could not write AIFF pad byte during finalization");
+      }
+    }
+
+    if (!_writeAiffFileSizes(sampleSource, true)) {
+      logError("Could not finalize AIFF file");
+    }
+
+    fflush(extraData->fileHandle);
+  }
+
+  fclose(extraData->fileHandle);
+  extraData->fileHandle = NULL;
+}
+
+static void _freeSampleSourceDataAiff(void *sampleSourceDataPtr) {
+  SampleSourceAiffData extraData = (SampleSourceAiffData)sampleSourceDataPtr;
+  free(extraData->rawBuffer);
+  free(extraData->interleavedBuffer);
+  free(extraData);
+}
+
+SampleSource _newSampleSourceAiff(const CharString sampleSourceName) {
+  SampleSource sampleSource = (SampleSource)malloc(sizeof(SampleSourceMembers));
+  SampleSourceAiffData extraData =
+      (SampleSourceAiffData)malloc(sizeof(SampleSourceAiffDataMembers));
+
+  sampleSource->sampleSourceType = SAMPLE_SOURCE_TYPE_AIFF;
+  sampleSource->openedAs = SAMPLE_SOURCE_OPEN_NOT_OPENED;
+  sampleSource->sourceName = newCharString();
+  charStringCopy(sampleSource->sourceName, sampleSourceName);
+  sampleSource->numSamplesProcessed = 0;
+
+  sampleSource->openSampleSource = _openSampleSourceAiff;
+  sampleSource->readSampleBlock = _readBlockFromAiffFile;
+  sampleSource->writeSampleBlock = _writeBlockToAiffFile;
+  sampleSource->syncSampleSource = _syncSampleSourceAiff;
+  sampleSource->seekSampleSource = _seekSampleSourceAiff;
+  sampleSource->closeSampleSource = _closeSampleSourceAiff;
+  sampleSource->freeSampleSourceData = _freeSampleSourceDataAiff;
+
+  extraData->fileHandle = NULL;
+  extraData->isAifc = false;
+  extraData->sampleFormat = kAiffSampleFormatInvalid;
+  extraData->numChannels = (ChannelCount)getNumChannels();
+  extraData->sampleRate = getSampleRate();
+  extraData->bitDepth = kBitDepthDefault;
+  extraData->bytesPerSample = 0;
+  extraData->dataBytesRemaining = 0;
+  extraData->dataSize = 0;
+  extraData->dataOffset = 0;
+  extraData->commNumFramesOffset = 0;
+  extraData->ssndSizeOffset = 0;
+  extraData->decodeSamples = NULL;
+  extraData->encodeSamples = NULL;
+  extraData->rawBuffer = NULL;
+  extraData->interleavedBuffer = NULL;
+  extraData->bufferNumSamples = 0;
+
+  sampleSource->extraData = extraData;
+  return sampleSource;
+}
@@ -0,0 +1,82 @@
+//
+// SampleSourceAiff.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_SampleSourceAiff_h
+#define MrsWatson_SampleSourceAiff_h
+
+#include "audio/AudioSettings.h"
+#include "base/Types.h"
+
+#include <stdio.h>
+
+typedef enum {
+  kAiffSampleFormatInvalid,
+  // Signed integer samples stored big endian, used by AIFF and AIFC 'NONE'
+  kAiffSampleFormatBigEndianInt,
+  // Signed integer samples stored little endian, used by AIFC 'sowt'
+  kAiffSampleFormatLittleEndianInt,
+  // IEEE 32-bit floating point samples stored big endian, used by AIFC 'fl32'
+  kAiffSampleFormatBigEndianFloat
+} AiffSampleFormat;
+
+typedef void (*AiffDecodeSamplesFunc)(const byte *rawSamples, Sample *samples,
+                                      size_t numSamples);
+typedef void (*AiffEncodeSamplesFunc)(const Sample *samples, byte *rawSamples,
+                                      size_t numSamples);
+
+typedef struct {
+  FILE *fileHandle;
+  boolByte isAifc;
+  AiffSampleFormat sampleFormat;
+
+  ChannelCount numChannels;
+  SampleRate sampleRate;
+  BitDepth bitDepth;
+  size_t bytesPerSample;
+
+  // Number of bytes left to read in the SSND chunk, used to avoid reading any
+  // chunks which follow the sound data as samples.
+  unsigned long dataBytesRemaining;
+  // Size of the sound data in the SSND chunk, used for seeking
+  unsigned long dataSize;
+  // Position of the first frame in the file
+  long dataOffset;
+  // File offsets which must be patched with the final sizes when writing
+  long commNumFramesOffset;
+  long ssndSizeOffset;
+
+  AiffDecodeSamplesFunc decodeSamples;
+  AiffEncodeSamplesFunc encodeSamples;
+
+  // Scratch buffers for the raw file data and the interleaved samples, which
+  // are grown as needed and reused between blocks.
+  byte *rawBuffer;
+  Sample *interleavedBuffer;
+  size_t bufferNumSamples;
+} SampleSourceAiffDataMembers;
+typedef SampleSourceAiffDataMembers *SampleSourceAiffData;
+
+#endif
@@ -218,6 +218,25 @@ boolByte _writeBlockToAudiofile(void *selfPtr,
   }
 }
 
+static boolByte _seekSampleSourceAudiofile(void *selfPtr, SampleCount frame) {
+  SampleSource self = (SampleSource)selfPtr;
+  SampleSourceAudiofileData extraData = self->extraData;
+
+  return (boolByte)(extraData->fileHandle != NULL &&
+                    afSeekFrame(extraData->fileHandle, AF_DEFAULT_TRACK,
+                                (AFframecount)frame) == (AFframecount)frame);
+}
+
+static boolByte _syncSampleSourceAudiofile(void *selfPtr) {
+  SampleSource self = (SampleSource)selfPtr;
+  SampleSourceAudiofileData extraData =
+      (SampleSourceAudiofileData)self->extraData;
+
+  // afSyncFile rewrites the file header to match the frames written so far
+  return (boolByte)(extraData->fileHandle != NULL &&
+                    afSyncFile(extraData->fileHandle) == 0);
+}
+
 void _closeSampleSourceAudiofile(void *selfPtr) {
   SampleSource self = (SampleSource)selfPtr;
   SampleSourceAudiofileData extraData =
@@ -254,6 +273,8 @@ _newSampleSourceAudiofile(const CharString sampleSourceName,
   sampleSource->openSampleSource = _openSampleSourceAudiofile;
   sampleSource->readSampleBlock = _readBlockFromAudiofile;
   sampleSource->writeSampleBlock = _writeBlockToAudiofile;
+  sampleSource->syncSampleSource = _syncSampleSourceAudiofile;
+  sampleSource->seekSampleSource = _seekSampleSourceAudiofile;
   sampleSource->closeSampleSource = _closeSampleSourceAudiofile;
   sampleSource->freeSampleSourceData = _freeSampleSourceDataAudiofile;
 
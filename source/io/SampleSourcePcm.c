@@ -111,6 +111,24 @@ SampleCount sampleSourcePcmRead(SampleSourcePcmData extraData,
   return pcmSamplesRead;
 }
 
+boolByte sampleSourcePcmSeek(SampleSourcePcmData extraData, SampleCount frame) {
+  long frameSize = (long)extraData->pcmSampleBuffer->bytesPerSample *
+                   extraData->numChannels;
+
+  if (extraData->isStream || extraData->fileHandle == NULL) {
+    return false;
+  }
+
+  return (boolByte)(fseek(extraData->fileHandle,
+                          extraData->dataOffset + (long)frame * frameSize,
+                          SEEK_SET) == 0);
+}
+
+static boolByte _seekSampleSourcePcm(void *selfPtr, SampleCount frame) {
+  SampleSource self = (SampleSource)selfPtr;
+  return sampleSourcePcmSeek((SampleSourcePcmData)self->extraData, frame);
+}
+
 static boolByte readBlockFromPcmFile(void *selfPtr, SampleBuffer sampleBuffer) {
   SampleSource self = (SampleSource)selfPtr;
   SampleSourcePcmData extraData = (SampleSourcePcmData)(self->extraData);
@@ -131,6 +149,20 @@ SampleCount sampleSourcePcmWrite(SampleSourcePcmData extraData,
     return false;
   }
 
+  // As when reading, the PCM sample buffer must be large enough for the block,
+  // which may have more channels than when this source was created
+  const SampleBuffer internalSampleBuffer =
+      extraData->pcmSampleBuffer->getSampleBuffer(extraData->pcmSampleBuffer);
+
+  if (internalSampleBuffer->blocksize < sampleBuffer->blocksize ||
+      internalSampleBuffer->numChannels != sampleBuffer->numChannels) {
+    freePcmSampleBuffer(extraData->pcmSampleBuffer);
+    extraData->pcmSampleBuffer = newPcmSampleBuffer(
+        sampleBuffer->numChannels, sampleBuffer->blocksize, getBitDepth());
+    extraData->dataBufferNumItems =
+        sampleBuffer->numChannels * sampleBuffer->blocksize;
+  }
+
   extraData->pcmSampleBuffer->setSampleBuffer(extraData->pcmSampleBuffer,
                                               sampleBuffer);
   pcmSamplesWritten =
@@ -157,6 +189,19 @@ static boolByte writeBlockToPcmFile(void *selfPtr,
   return (boolByte)(samplesWritten == sampleBuffer->blocksize);
 }
 
+static boolByte _syncSampleSourcePcm(void *selfPtr) {
+  SampleSource self = (SampleSource)selfPtr;
+  SampleSourcePcmData extraData = (SampleSourcePcmData)self->extraData;
+
+  // Raw PCM has no header, so it is enough to flush the data. Streams such as
+  // stdout cannot be synced to disk.
+  if (extraData->isStream) {
+    return (boolByte)(fflush(extraData->fileHandle) == 0);
+  }
+
+  return sampleSourceFlushFileHandle(extraData->fileHandle);
+}
+
 static void _closeSampleSourcePcm(void *selfPtr) {
   SampleSource self = (SampleSource)selfPtr;
   SampleSourcePcmData extraData = (SampleSourcePcmData)self->extraData;
@@ -198,12 +243,15 @@ SampleSource _newSampleSourcePcm(const CharString sampleSourceName) {
   sampleSource->openSampleSource = openSampleSourcePcm;
   sampleSource->readSampleBlock = readBlockFromPcmFile;
   sampleSource->writeSampleBlock = writeBlockToPcmFile;
+  sampleSource->syncSampleSource = _syncSampleSourcePcm;
+  sampleSource->seekSampleSource = _seekSampleSourcePcm;
   sampleSource->closeSampleSource = _closeSampleSourcePcm;
   sampleSource->freeSampleSourceData = freeSampleSourceDataPcm;
 
   extraData->isStream = false;
   extraData->isLittleEndian = true;
   extraData->fileHandle = NULL;
+  extraData->dataOffset = 0;
   // Assume default values for these items. However, if an incoming SampleBuffer
   // has different values for the channel count or blocksize, then we will
   // reassign
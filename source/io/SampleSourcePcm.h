@@ -36,6 +36,8 @@ typedef struct {
   boolByte isStream;
   boolByte isLittleEndian;
   FILE *fileHandle;
+  // Position of the first frame in the file, used for seeking
+  long dataOffset;
   size_t dataBufferNumItems;
   PcmSampleBuffer pcmSampleBuffer;
 
@@ -63,6 +65,14 @@ SampleCount sampleSourcePcmRead(SampleSourcePcmData extraData,
 SampleCount sampleSourcePcmWrite(SampleSourcePcmData extraData,
                                  const SampleBuffer sampleBuffer);
 
+/**
+ * Move the read position of a PCM file to the given frame.
+ * @param extraData
+ * @param frame Frame to seek to, counted from dataOffset
+ * @return True on success, false if the file is a stream or could not seek
+ */
+boolByte sampleSourcePcmSeek(SampleSourcePcmData extraData, SampleCount frame);
+
 /**
  * Set the sample rate to be used for raw PCM file operations. This is most
  * relevant when writing a WAVE or a AIFF file, as the sample rate must be given
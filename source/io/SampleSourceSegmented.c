@@ -0,0 +1,323 @@
+//
+// SampleSourceSegmented.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "SampleSourceSegmented.h"
+
+#include "audio/AudioSettings.h"
+#include "base/File.h"
+#include "logging/EventLogger.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_SEGMENT_FORMAT "_%05d"
+
+// Count the integer conversions in a segment name pattern. Since the pattern is
+// passed to snprintf, only "%d" conversions (with optional flags and width)
+// and "%%" literals are accepted. Returns -1 if any other conversion is found.
+static int _countSegmentPatternConversions(const char *pattern) {
+  int numConversions = 0;
+  const char *c;
+
+  for (c = pattern; *c != '\0'; ++c) {
+    if (*c != '%') {
+      continue;
+    }
+
+    ++c;
+
+    if (*c == '%') {
+      continue;
+    }
+
+    while (*c == '0' || *c == '-' || (*c >= '1' && *c <= '9')) {
+      ++c;
+    }
+
+    if (*c != 'd') {
+      return -1;
+    }
+
+    ++numConversions;
+  }
+
+  return numConversions;
+}
+
+static CharString _newSegmentNamePattern(const CharString name) {
+  CharString result;
+  const char *extension;
+  const char *separator;
+  int numConversions = _countSegmentPatternConversions(name->data);
+
+  if (numConversions < 0 || numConversions > 1) {
+    logError("Invalid segment name pattern '%s', it must contain at most one "
+             "integer conversion such as %%05d",
+             name->data);
+    return NULL;
+  }
+
+  result = newCharStringWithCapacity(name->capacity +
+                                     strlen(DEFAULT_SEGMENT_FORMAT));
+
+  if (numConversions == 1) {
+    charStringCopy(result, name);
+    return result;
+  }
+
+  // Insert the segment number before the file extension, if there is one
+  extension = strrchr(name->data, '.');
+  separator = strrchr(name->data, PATH_DELIMITER);
+
+  if (extension == NULL || (separator != NULL && extension < separator)) {
+    charStringCopy(result, name);
+    charStringAppendCString(result, DEFAULT_SEGMENT_FORMAT);
+  } else {
+    strncpy(result->data, name->data, (size_t)(extension - name->data));
+    charStringAppendCString(result, DEFAULT_SEGMENT_FORMAT);
+    charStringAppendCString(result, extension);
+  }
+
+  return result;
+}
+
+static CharString _getSegmentName(SampleSourceSegmentedData extraData,
+                                  unsigned int segmentIndex) {
+  CharString result =
+      newCharStringWithCapacity(extraData->namePattern->capacity + 16);
+  snprintf(result->data, result->capacity, extraData->namePattern->data,
+           (int)segmentIndex);
+  return result;
+}
+
+static boolByte _openNextSegment(SampleSource sampleSource) {
+  SampleSourceSegmentedData extraData =
+      (SampleSourceSegmentedData)sampleSource->extraData;
+  CharString segmentName;
+
+  if (extraData->currentSegment != NULL) {
+    extraData->currentSegment->closeSampleSource(extraData->currentSegment);
+    freeSampleSource(extraData->currentSegment);
+    extraData->currentSegment = NULL;
+  }
+
+  segmentName = _getSegmentName(extraData, extraData->segmentIndex);
+  extraData->currentSegment = sampleSourceFactory(segmentName);
+
+  if (extraData->currentSegment == NULL) {
+    logError("Could not create segment '%s'", segmentName->data);
+    freeCharString(segmentName);
+    return false;
+  }
+
+  if (!extraData->currentSegment->openSampleSource(extraData->currentSegment,
+                                                   SAMPLE_SOURCE_OPEN_WRITE)) {
+    logError("Could not open segment '%s' for writing", segmentName->data);
+    freeSampleSource(extraData->currentSegment);
+    extraData->currentSegment = NULL;
+    freeCharString(segmentName);
+    return false;
+  }
+
+  logInfo("Writing output segment '%s'", segmentName->data);
+  extraData->framesInSegment = 0;
+  extraData->segmentIndex++;
+  freeCharString(segmentName);
+  return true;
+}
+
+static boolByte _openSampleSourceSegmented(void *sampleSourcePtr,
+                                           const SampleSourceOpenAs openAs) {
+  SampleSource sampleSource = (SampleSource)sampleSourcePtr;
+  SampleSourceSegmentedData extraData =
+      (SampleSourceSegmentedData)sampleSource->extraData;
+
+  if (openAs != SAMPLE_SOURCE_OPEN_WRITE) {
+    logUnsupportedFeature("Reading from segmented sample sources");
+    return false;
+  }
+
+  extraData->framesPerSegment = (SampleCount)(
+      (double)extraData->segmentLengthInMs * getSampleRate() / 1000.0);
+
+  if (extraData->framesPerSegment == 0) {
+    logError("Segment length of %lums is too short", extraData->segmentLengthInMs);
+    return false;
+  }
+
+  logDebug("Output segments will be %lu frames long",
+           extraData->framesPerSegment);
+
+  if (!_openNextSegment(sampleSource)) {
+    return false;
+  }
+
+  sampleSource->openedAs = openAs;
+  return true;
+}
+
+static boolByte _readBlockFromSegments(void *sampleSourcePtr,
+                                       SampleBuffer sampleBuffer) {
+  logUnsupportedFeature("Reading from segmented sample sources");
+  return false;
+}
+
+static boolByte _writeBlockToSegments(void *sampleSourcePtr,
+                                      const SampleBuffer sampleBuffer) {
+  SampleSource sampleSource = (SampleSource)sampleSourcePtr;
+  SampleSourceSegmentedData extraData =
+      (SampleSourceSegmentedData)sampleSource->extraData;
+  SampleCount framesWritten = 0;
+  SampleCount framesToWrite;
+  SampleBuffer splitBuffer;
+  boolByte result = true;
+
+  if (extraData->currentSegment == NULL) {
+    logCritical("Segmented sample source is not open");
+    return false;
+  }
+
+  while (framesWritten < sampleBuffer->blocksize) {
+    if (extraData->framesInSegment >= extraData->framesPerSegment) {
+      if (!_openNextSegment(sampleSource)) {
+        return false;
+      }
+    }
+
+    framesToWrite = sampleBuffer->blocksize - framesWritten;
+
+    if (framesToWrite > extraData->framesPerSegment - extraData->framesInSegment) {
+      framesToWrite = extraData->framesPerSegment - extraData->framesInSegment;
+    }
+
+    if (framesToWrite == sampleBuffer->blocksize) {
+      // Normal case: the whole block fits in the current segment
+      result &= extraData->currentSegment->writeSampleBlock(
+          extraData->currentSegment, sampleBuffer);
+    } else {
+      // The block straddles a segment boundary
+      splitBuffer = newSampleBuffer(sampleBuffer->numChannels, framesToWrite);
+      sampleBufferCopyAndMapChannelsWithOffset(splitBuffer, 0, sampleBuffer,
+                                               framesWritten, framesToWrite);
+      result &= extraData->currentSegment->writeSampleBlock(
+          extraData->currentSegment, splitBuffer);
+      freeSampleBuffer(splitBuffer);
+    }
+
+    extraData->framesInSegment += framesToWrite;
+    framesWritten += framesToWrite;
+  }
+
+  sampleSource->numSamplesProcessed +=
+      sampleBuffer->blocksize * sampleBuffer->numChannels;
+  return result;
+}
+
+static boolByte _syncSampleSourceSegmented(void *sampleSourcePtr) {
+  SampleSource sampleSource = (SampleSource)sampleSourcePtr;
+  SampleSourceSegmentedData extraData =
+      (SampleSourceSegmentedData)sampleSource->extraData;
+  return sampleSourceSync(extraData->currentSegment);
+}
+
+static void _closeSampleSourceSegmented(void *sampleSourcePtr) {
+  SampleSource sampleSource = (SampleSource)sampleSourcePtr;
+  SampleSourceSegmentedData extraData =
+      (SampleSourceSegmentedData)sampleSource->extraData;
+
+  if (extraData->currentSegment != NULL) {
+    extraData->currentSegment->closeSampleSource(extraData->currentSegment);
+    freeSampleSource(extraData->currentSegment);
+    extraData->currentSegment = NULL;
+  }
+}
+
+static void _freeSampleSourceDataSegmented(void *sampleSourceDataPtr) {
+  SampleSourceSegmentedData extraData =
+      (SampleSourceSegmentedData)sampleSourceDataPtr;
+  freeSampleSource(extraData->currentSegment);
+  freeCharString(extraData->namePattern);
+  free(extraData);
+}
+
+SampleSource newSampleSourceSegmented(const CharString namePattern,
+                                      unsigned long segmentLengthInMs) {
+  SampleSource sampleSource;
+  SampleSourceSegmentedData extraData;
+  SampleSource firstSegment;
+  CharString pattern;
+  CharString firstSegmentName;
+
+  if (namePattern == NULL || charStringIsEmpty(namePattern) ||
+      charStringIsEqualToCString(namePattern, "-", false)) {
+    logError("Segmented output requires a file name");
+    return NULL;
+  }
+
+  pattern = _newSegmentNamePattern(namePattern);
+
+  if (pattern == NULL) {
+    return NULL;
+  }
+
+  sampleSource = (SampleSource)malloc(sizeof(SampleSourceMembers));
+  extraData = (SampleSourceSegmentedData)malloc(
+      sizeof(SampleSourceSegmentedDataMembers));
+
+  extraData->namePattern = pattern;
+  extraData->segmentLengthInMs = segmentLengthInMs;
+  extraData->framesPerSegment = 0;
+  extraData->framesInSegment = 0;
+  extraData->segmentIndex = 0;
+  extraData->currentSegment = NULL;
+
+  // Report the type of the segment files, which is guessed from the name of
+  // the first segment.
+  firstSegmentName = _getSegmentName(extraData, 0);
+  firstSegment = sampleSourceFactory(firstSegmentName);
+  sampleSource->sampleSourceType = firstSegment != NULL
+                                       ? firstSegment->sampleSourceType
+                                       : SAMPLE_SOURCE_TYPE_INVALID;
+  freeSampleSource(firstSegment);
+  freeCharString(firstSegmentName);
+
+  sampleSource->openedAs = SAMPLE_SOURCE_OPEN_NOT_OPENED;
+  sampleSource->sourceName = newCharString();
+  charStringCopy(sampleSource->sourceName, pattern);
+  sampleSource->numSamplesProcessed = 0;
+
+  sampleSource->openSampleSource = _openSampleSourceSegmented;
+  sampleSource->readSampleBlock = _readBlockFromSegments;
+  sampleSource->writeSampleBlock = _writeBlockToSegments;
+  sampleSource->syncSampleSource = _syncSampleSourceSegmented;
+  sampleSource->seekSampleSource = NULL;
+  sampleSource->closeSampleSource = _closeSampleSourceSegmented;
+  sampleSource->freeSampleSourceData = _freeSampleSourceDataSegmented;
+
+  sampleSource->extraData = extraData;
+  return sampleSource;
+}
@@ -0,0 +1,63 @@
+//
+// SampleSourceSegmented.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_SampleSourceSegmented_h
+#define MrsWatson_SampleSourceSegmented_h
+
+#include "io/SampleSource.h"
+
+typedef struct {
+  CharString namePattern;
+  unsigned long segmentLengthInMs;
+  SampleCount framesPerSegment;
+  SampleCount framesInSegment;
+  unsigned int segmentIndex;
+  SampleSource currentSegment;
+} SampleSourceSegmentedDataMembers;
+typedef SampleSourceSegmentedDataMembers *SampleSourceSegmentedData;
+
+/**
+ * Create an output sample source which splits the written audio into several
+ * files of a fixed duration. Each segment file is finalized (ie, has a
+ * complete header) as soon as the next segment is started, so that other
+ * programs may process the segments while rendering continues.
+ *
+ * Segment file names are generated from a pattern containing a single printf
+ * style integer conversion, such as "out_%05d.wav". If the pattern does not
+ * contain a conversion, then "_%05d" is inserted before the file extension.
+ * The file type of each segment is guessed from this extension in the same
+ * manner as sampleSourceFactory().
+ *
+ * Segmented sources can only be opened for writing.
+ * @param namePattern Segment file name pattern
+ * @param segmentLengthInMs Segment length, in milliseconds. This is converted to
+ * frames when the source is opened, after the sample rate is known.
+ * @return Initialized sample source, or NULL if the pattern is invalid
+ */
+SampleSource newSampleSourceSegmented(const CharString namePattern,
+                                      unsigned long segmentLengthInMs);
+
+#endif
@@ -77,6 +77,8 @@ SampleSource _newSampleSourceSilence(void) {
   sampleSource->closeSampleSource = _closeSampleSourceSilence;
   sampleSource->readSampleBlock = _readBlockFromSilence;
   sampleSource->writeSampleBlock = _writeBlockToSilence;
+  sampleSource->syncSampleSource = NULL;
+  sampleSource->seekSampleSource = NULL;
   sampleSource->freeSampleSourceData = _freeInputSourceDataSilence;
 
   return sampleSource;
@@ -307,11 +307,13 @@ static boolByte _openSampleSourceWave(void *sampleSourcePtr,
 
     if (extraData->fileHandle != NULL) {
       if (_readWaveFileInfo(sampleSource->sourceName->data, extraData)) {
+        extraData->dataOffset = ftell(extraData->fileHandle);
         setNumChannels(extraData->numChannels);
         setSampleRate(extraData->sampleRate);
       } else {
         fclose(extraData->fileHandle);
         extraData->fileHandle = NULL;
+  extraData->dataOffset = 0;
       }
     }
   } else if (openAs == SAMPLE_SOURCE_OPEN_WRITE) {
@@ -353,6 +355,13 @@ static boolByte _readBlockFromWaveFile(void *sampleSourcePtr,
   return (boolByte)(originalBlocksize == sampleBuffer->blocksize);
 }
 
+static boolByte _seekSampleSourceWave(void *sampleSourcePtr,
+                                      SampleCount frame) {
+  SampleSource sampleSource = (SampleSource)sampleSourcePtr;
+  return sampleSourcePcmSeek((SampleSourcePcmData)sampleSource->extraData,
+                             frame);
+}
+
 static boolByte _writeBlockToWaveFile(void *sampleSourcePtr,
                                       const SampleBuffer sampleBuffer) {
   SampleSource sampleSource = (SampleSource)sampleSourcePtr;
@@ -363,89 +372,71 @@ static boolByte _writeBlockToWaveFile(void *sampleSourcePtr,
   return (boolByte)(samplesWritten == sampleBuffer->blocksize);
 }
 
-void _closeSampleSourceWave(void *sampleSourceDataPtr) {
-  SampleSource sampleSource = (SampleSource)sampleSourceDataPtr;
-  SampleSourcePcmData extraData = (SampleSourcePcmData)sampleSource->extraData;
-  size_t numBytesWritten;
-  RiffChunk chunk;
-
-  if (sampleSource->openedAs == SAMPLE_SOURCE_OPEN_WRITE) {
-    // Re-open the file for editing
-    fflush(extraData->fileHandle);
-
-    if (fclose(extraData->fileHandle) != 0) {
-      logError("Could not close WAVE file for finalization");
-      return;
-    }
-
-    extraData->fileHandle = fopen(sampleSource->sourceName->data, "rb+");
+// Offsets of the size fields in the header written by _writeWaveFileInfo
+#define WAVE_RIFF_SIZE_OFFSET 4
+#define WAVE_DATA_SIZE_OFFSET 44
+#define WAVE_HEADER_SIZE 48
 
-    if (extraData->fileHandle == NULL) {
-      logError("Could not reopen WAVE file for finalization");
-      return;
-    }
+static boolByte _writeWaveFileSizes(SampleSource sampleSource) {
+  SampleSourcePcmData extraData = (SampleSourcePcmData)sampleSource->extraData;
+  unsigned int numBytesWritten =
+      (unsigned int)(sampleSource->numSamplesProcessed * extraData->bitDepth /
+                     8);
+  // The RIFF chunk size includes everything in the file after its own header
+  unsigned int riffChunkSize = numBytesWritten + WAVE_HEADER_SIZE - 8;
+
+  if (fseek(extraData->fileHandle, WAVE_DATA_SIZE_OFFSET, SEEK_SET) != 0 ||
+      fwrite(&numBytesWritten, sizeof(unsigned int), 1,
+             extraData->fileHandle) != 1) {
+    logError("Could not write WAVE data chunk size");
+    return false;
+  }
 
-    // First go to the second chunk in the file and re-read the chunk length
-    if (fseek(extraData->fileHandle, 12, SEEK_SET) != 0) {
-      logError("Could not seek to second chunk during WAVE file finalization");
-      fclose(extraData->fileHandle);
-      return;
-    }
+  if (fseek(extraData->fileHandle, WAVE_RIFF_SIZE_OFFSET, SEEK_SET) != 0 ||
+      fwrite(&riffChunkSize, sizeof(unsigned int), 1, extraData->fileHandle) !=
+          1) {
+    logError("Could not write WAVE RIFF chunk size");
+    return false;
+  }
 
-    chunk = newRiffChunk();
+  return true;
+}
 
-    if (!riffChunkReadNext(chunk, extraData->fileHandle, false)) {
-      logError("Could not read RIFF chunk during WAVE file finalization");
-      fclose(extraData->fileHandle);
-      freeRiffChunk(chunk);
-      return;
-    }
+static boolByte _syncSampleSourceWave(void *sampleSourcePtr) {
+  SampleSource sampleSource = (SampleSource)sampleSourcePtr;
+  SampleSourcePcmData extraData = (SampleSourcePcmData)sampleSource->extraData;
 
-    // Go to the next chunk, and then skip the type and write the new length
-    if (fseek(extraData->fileHandle, (long)(chunk->size + 4), SEEK_CUR) != 0) {
-      logError("Could not seek to next chunk during WAVE file finalization");
-      fclose(extraData->fileHandle);
-      freeRiffChunk(chunk);
-      return;
-    }
+  if (extraData->fileHandle == NULL || !_writeWaveFileSizes(sampleSource)) {
+    return false;
+  }
 
-    numBytesWritten =
-        sampleSource->numSamplesProcessed * extraData->bitDepth / 8;
+  // Go back to the end of the file so that the next block is appended
+  if (fseek(extraData->fileHandle, 0, SEEK_END) != 0) {
+    logError("Could not seek to end of WAVE file after sync");
+    return false;
+  }
 
-    if (fwrite(&numBytesWritten, sizeof(unsigned int), 1,
-               extraData->fileHandle) != 1) {
-      logError("Could not write WAVE file size during finalization");
-      fclose(extraData->fileHandle);
-      freeRiffChunk(chunk);
-      return;
-    }
+  return sampleSourceFlushFileHandle(extraData->fileHandle);
+}
 
-    // Add 40 bytes for fmt chunk size and write the RIFF chunk size
-    numBytesWritten += ftell(extraData->fileHandle) - 8;
+void _closeSampleSourceWave(void *sampleSourceDataPtr) {
+  SampleSource sampleSource = (SampleSource)sampleSourceDataPtr;
+  SampleSourcePcmData extraData = (SampleSourcePcmData)sampleSource->extraData;
 
-    if (fseek(extraData->fileHandle, 4, SEEK_SET) != 0) {
-      logError("Could not seek to fmt chunk during WAVE file finalization");
-      fclose(extraData->fileHandle);
-      freeRiffChunk(chunk);
-      return;
-    }
+  if (extraData->fileHandle == NULL) {
+    return;
+  }
 
-    if (fwrite(&numBytesWritten, sizeof(unsigned int), 1,
-               extraData->fileHandle) != 1) {
-      logError(
-          "Could not write WAVE file size in fmt chunk during finalization");
-      fclose(extraData->fileHandle);
-      freeRiffChunk(chunk);
-      return;
+  if (sampleSource->openedAs == SAMPLE_SOURCE_OPEN_WRITE) {
+    if (!_writeWaveFileSizes(sampleSource)) {
+      logError("Could not finalize WAVE file");
     }
 
     fflush(extraData->fileHandle);
-    fclose(extraData->fileHandle);
-    freeRiffChunk(chunk);
-  } else if (sampleSource->openedAs == SAMPLE_SOURCE_OPEN_READ &&
-             extraData->fileHandle != NULL) {
-    fclose(extraData->fileHandle);
   }
+
+  fclose(extraData->fileHandle);
+  extraData->fileHandle = NULL;
 }
 
 SampleSource _newSampleSourceWave(const CharString sampleSourceName) {
@@ -462,6 +453,8 @@ SampleSource _newSampleSourceWave(const CharString sampleSourceName) {
   sampleSource->openSampleSource = _openSampleSourceWave;
   sampleSource->readSampleBlock = _readBlockFromWaveFile;
   sampleSource->writeSampleBlock = _writeBlockToWaveFile;
+  sampleSource->syncSampleSource = _syncSampleSourceWave;
+  sampleSource->seekSampleSource = _seekSampleSourceWave;
   sampleSource->closeSampleSource = _closeSampleSourceWave;
   sampleSource->freeSampleSourceData = freeSampleSourceDataPcm;
 
@@ -28,77 +28,296 @@
 
 #include "logging/EventLogger.h"
 
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+// Number of events which a new sequence has room for
+#define MIDI_SEQUENCE_DEFAULT_CAPACITY 256
+// Number of bytes of extra data which the arena has room for at first
+#define MIDI_SEQUENCE_DEFAULT_ARENA_SIZE 1024
 
 MidiSequence newMidiSequence(void) {
   MidiSequence midiSequence = malloc(sizeof(MidiSequenceMembers));
 
-  midiSequence->midiEvents = newLinkedList();
-  midiSequence->_lastEvent = midiSequence->midiEvents;
-  midiSequence->_lastTimestamp = 0;
+  midiSequence->midiEvents =
+      malloc(sizeof(MidiSequenceEventMembers) * MIDI_SEQUENCE_DEFAULT_CAPACITY);
+  midiSequence->numMidiEvents = 0;
   midiSequence->numMidiEventsProcessed = 0;
+  midiSequence->_capacity = MIDI_SEQUENCE_DEFAULT_CAPACITY;
+  midiSequence->_position = 0;
+  midiSequence->_sorted = true;
+  midiSequence->_arena = NULL;
+  midiSequence->_arenaSize = 0;
+  midiSequence->_arenaCapacity = 0;
+  midiSequence->_blockEvents = malloc(sizeof(MidiEventMembers) *
+                                      MIDI_SEQUENCE_DEFAULT_EVENTS_PER_BLOCK);
+  midiSequence->_blockCapacity = MIDI_SEQUENCE_DEFAULT_EVENTS_PER_BLOCK;
 
   return midiSequence;
 }
 
-void appendMidiEventToSequence(MidiSequence self, MidiEvent midiEvent) {
-  if (self != NULL && midiEvent != NULL) {
-    linkedListAppend(self->midiEvents, midiEvent);
-  }
+static boolByte _hasExtraData(const byte eventType) {
+  return (boolByte)(eventType == MIDI_TYPE_SYSEX ||
+                    eventType == MIDI_TYPE_META);
 }
 
-boolByte fillMidiEventsFromRange(MidiSequence self,
-                                 const unsigned long startTimestamp,
-                                 const unsigned long blocksize,
-                                 LinkedList outMidiEvents) {
-  MidiEvent midiEvent;
-  LinkedListIterator iterator = self->_lastEvent;
-  const unsigned long stopTimestamp = startTimestamp + blocksize;
+static unsigned int _copyToArena(MidiSequence self, const byte *data,
+                                 const unsigned int size) {
+  unsigned int offset = self->_arenaSize;
 
-  while (true) {
-    if ((iterator == NULL) || (iterator->item == NULL)) {
-      return false;
+  if (self->_arenaSize + size > self->_arenaCapacity) {
+    if (self->_arenaCapacity == 0) {
+      self->_arenaCapacity = MIDI_SEQUENCE_DEFAULT_ARENA_SIZE;
     }
 
-    midiEvent = iterator->item;
-
-    if (stopTimestamp < midiEvent->timestamp) {
-      // We have not yet reached this event, stop iterating
-      break;
-    } else if (startTimestamp <= midiEvent->timestamp &&
-               stopTimestamp > midiEvent->timestamp) {
-      midiEvent->deltaFrames = midiEvent->timestamp - startTimestamp;
-      logDebug("Scheduling MIDI event 0x%x (%x, %x) in %ld frames",
-               midiEvent->status, midiEvent->data1, midiEvent->data2,
-               midiEvent->deltaFrames);
-      linkedListAppend(outMidiEvents, midiEvent);
-      self->_lastEvent = iterator->nextItem;
-      self->numMidiEventsProcessed++;
-    } else if (startTimestamp > midiEvent->timestamp) {
-      logInternalError("Inconsistent MIDI sequence ordering");
+    while (self->_arenaSize + size > self->_arenaCapacity) {
+      self->_arenaCapacity *= 2;
+    }
+
+    self->_arena = realloc(self->_arena, self->_arenaCapacity);
+  }
+
+  memcpy(self->_arena + offset, data, size);
+  self->_arenaSize += size;
+  return offset;
+}
+
+void appendMidiEventToSequence(MidiSequence self, const MidiEvent midiEvent,
+                               const unsigned int extraDataSize) {
+  MidiSequenceEvent event;
+
+  if (self == NULL || midiEvent == NULL) {
+    return;
+  }
+
+  if (_hasExtraData((byte)midiEvent->eventType) && extraDataSize > USHRT_MAX) {
+    logError("MIDI event at %ld has too much data (%u bytes), ignoring",
+             midiEvent->timestamp, extraDataSize);
+    return;
+  }
+
+  if (self->numMidiEvents == self->_capacity) {
+    self->_capacity *= 2;
+    self->midiEvents = realloc(
+        self->midiEvents, sizeof(MidiSequenceEventMembers) * self->_capacity);
+  }
+
+  if (self->numMidiEvents > 0 &&
+      self->midiEvents[self->numMidiEvents - 1].timestamp >
+          midiEvent->timestamp) {
+    self->_sorted = false;
+  }
+
+  event = &self->midiEvents[self->numMidiEvents];
+  memset(event, 0, sizeof(MidiSequenceEventMembers));
+  event->timestamp = midiEvent->timestamp;
+  event->eventType = (byte)midiEvent->eventType;
+  event->status = midiEvent->status;
+
+  if (!_hasExtraData(event->eventType)) {
+    event->data.bytes[0] = midiEvent->data1;
+    event->data.bytes[1] = midiEvent->data2;
+  } else if (extraDataSize > 0 && midiEvent->extraData != NULL) {
+    event->data.extraDataSize = (unsigned short)extraDataSize;
+
+    if (extraDataSize <= MIDI_SEQUENCE_EVENT_INLINE_DATA_SIZE) {
+      memcpy(event->extraData.bytes, midiEvent->extraData, extraDataSize);
+    } else {
+      event->extraData.arenaOffset =
+          _copyToArena(self, midiEvent->extraData, extraDataSize);
     }
+  }
+
+  self->numMidiEvents++;
+}
 
-    // Last item in the list
-    if (iterator->nextItem == NULL) {
-      if (startTimestamp <= midiEvent->timestamp &&
-          stopTimestamp > midiEvent->timestamp) {
-        return false;
+/**
+ * Sort the events by timestamp with a merge sort, which unlike qsort() keeps
+ * events with the same timestamp in the order that they were appended. That
+ * matters for note on and off events at the same time.
+ */
+static void _sortMidiSequence(MidiSequence self) {
+  MidiSequenceEventMembers *source = self->midiEvents;
+  MidiSequenceEventMembers *destination;
+  MidiSequenceEventMembers *swap;
+  unsigned long width, left, middle, right, i, j, k;
+
+  if (self->_sorted) {
+    return;
+  }
+
+  destination = malloc(sizeof(MidiSequenceEventMembers) * self->_capacity);
+
+  for (width = 1; width < self->numMidiEvents; width *= 2) {
+    for (left = 0; left < self->numMidiEvents; left += 2 * width) {
+      middle = left + width < self->numMidiEvents ? left + width
+                                                   : self->numMidiEvents;
+      right = middle + width < self->numMidiEvents ? middle + width
+                                                    : self->numMidiEvents;
+
+      for (i = left, j = middle, k = left; k < right; k++) {
+        if (i < middle &&
+            (j >= right || source[i].timestamp <= source[j].timestamp)) {
+          destination[k] = source[i++];
+        } else {
+          destination[k] = source[j++];
+        }
       }
+    }
+
+    swap = source;
+    source = destination;
+    destination = swap;
+  }
+
+  free(destination);
+  self->midiEvents = source;
+  self->_sorted = true;
+}
+
+void midiSequenceSeek(MidiSequence self, const unsigned long timestamp) {
+  unsigned long low = 0;
+  unsigned long high = self->numMidiEvents;
+  unsigned long middle;
 
-      break;
+  _sortMidiSequence(self);
+
+  // Find the first event which is not before the timestamp
+  while (low < high) {
+    middle = low + (high - low) / 2;
+
+    if (self->midiEvents[middle].timestamp < timestamp) {
+      low = middle + 1;
+    } else {
+      high = middle;
     }
+  }
+
+  self->_position = low;
+}
+
+unsigned long midiSequenceGetPosition(MidiSequence self) {
+  return self->_position;
+}
+
+static void _expandMidiEvent(MidiSequence self, MidiSequenceEvent event,
+                             MidiEvent outMidiEvent) {
+  outMidiEvent->eventType = (MidiEventType)event->eventType;
+  outMidiEvent->timestamp = event->timestamp;
+  outMidiEvent->status = event->status;
+
+  if (!_hasExtraData(event->eventType)) {
+    outMidiEvent->data1 = event->data.bytes[0];
+    outMidiEvent->data2 = event->data.bytes[1];
+    outMidiEvent->extraData = NULL;
+  } else {
+    outMidiEvent->data1 = 0;
+    outMidiEvent->data2 = 0;
+
+    if (event->data.extraDataSize == 0) {
+      outMidiEvent->extraData = NULL;
+    } else if (event->data.extraDataSize <=
+               MIDI_SEQUENCE_EVENT_INLINE_DATA_SIZE) {
+      outMidiEvent->extraData = event->extraData.bytes;
+    } else {
+      outMidiEvent->extraData = self->_arena + event->extraData.arenaOffset;
+    }
+  }
+}
+
+boolByte midiSequenceGetRange(MidiSequence self,
+                              const unsigned long startTimestamp,
+                              const unsigned long blocksize,
+                              MidiSequenceRange *outRange) {
+  const unsigned long stopTimestamp = startTimestamp + blocksize;
+  unsigned long position;
+
+  _sortMidiSequence(self);
+  position = self->_position;
+
+  // Blocks are normally read one after another, in which case the sequence is
+  // already in the right place
+  if ((position > 0 &&
+       self->midiEvents[position - 1].timestamp >= startTimestamp) ||
+      (position < self->numMidiEvents &&
+       self->midiEvents[position].timestamp < startTimestamp)) {
+    midiSequenceSeek(self, startTimestamp);
+    position = self->_position;
+  }
+
+  outRange->midiEvents = self->_blockEvents;
+  outRange->numMidiEvents = 0;
+
+  while (position < self->numMidiEvents &&
+         self->midiEvents[position].timestamp < stopTimestamp) {
+    if (outRange->numMidiEvents == self->_blockCapacity) {
+      self->_blockCapacity *= 2;
+      self->_blockEvents = realloc(
+          self->_blockEvents, sizeof(MidiEventMembers) * self->_blockCapacity);
+      outRange->midiEvents = self->_blockEvents;
+    }
+
+    _expandMidiEvent(self, &self->midiEvents[position],
+                     &self->_blockEvents[outRange->numMidiEvents]);
+    self->_blockEvents[outRange->numMidiEvents].deltaFrames =
+        self->midiEvents[position].timestamp - startTimestamp;
+    outRange->numMidiEvents++;
+    position++;
+  }
+
+  self->_position = position;
+  self->numMidiEventsProcessed += (int)outRange->numMidiEvents;
+  return (boolByte)(position < self->numMidiEvents);
+}
+
+void midiSequenceDiscardPlayedEvents(MidiSequence self) {
+  if (self->_position == 0) {
+    return;
+  }
+
+  memmove(self->midiEvents, self->midiEvents + self->_position,
+          sizeof(MidiSequenceEventMembers) *
+              (self->numMidiEvents - self->_position));
+  self->numMidiEvents -= self->_position;
+  self->_position = 0;
+
+  // Extra data is not moved, but the arena can be reused once no events refer
+  // to it any more
+  if (self->numMidiEvents == 0) {
+    self->_arenaSize = 0;
+  }
+}
+
+boolByte fillMidiEventsFromRange(MidiSequence self,
+                                 const unsigned long startTimestamp,
+                                 const unsigned long blocksize,
+                                 LinkedListBuffer outMidiEvents) {
+  MidiSequenceRange range;
+  MidiEvent midiEvent;
+  boolByte result;
+  unsigned long i;
+
+  linkedListBufferClear(outMidiEvents);
+  result = midiSequenceGetRange(self, startTimestamp, blocksize, &range);
 
-    iterator = iterator->nextItem;
+  for (i = 0; i < range.numMidiEvents; i++) {
+    midiEvent = &range.midiEvents[i];
+    logDebug("Scheduling MIDI event 0x%x (%x, %x) in %ld frames",
+             midiEvent->status, midiEvent->data1, midiEvent->data2,
+             midiEvent->deltaFrames);
+    linkedListBufferAppend(outMidiEvents, midiEvent);
   }
 
-  return true;
+  return result;
 }
 
 void freeMidiSequence(MidiSequence self) {
   if (self != NULL) {
-    freeLinkedListAndItems(self->midiEvents,
-                           (LinkedListFreeItemFunc)freeMidiEvent);
+    free(self->midiEvents);
+    free(self->_arena);
+    free(self->_blockEvents);
     free(self);
   }
 }
@@ -30,11 +30,54 @@
 #include "base/LinkedList.h"
 #include "midi/MidiEvent.h"
 
+// Initial capacity of buffers which are filled with fillMidiEventsFromRange()
+#define MIDI_SEQUENCE_DEFAULT_EVENTS_PER_BLOCK 64
+// Extra data of at most this many bytes is stored in the event itself
+#define MIDI_SEQUENCE_EVENT_INLINE_DATA_SIZE 4
+
+/**
+ * Compact form of a MidiEvent, in which a sequence stores its events. The
+ * extra data of meta and sysex events is kept inline if it is small enough,
+ * which covers tempo and time signature events, and otherwise in the arena of
+ * the sequence.
+ */
 typedef struct {
-  LinkedList midiEvents;
-  LinkedListIterator _lastEvent;
-  int _lastTimestamp;
+  unsigned long timestamp;
+  byte eventType;
+  byte status;
+  union {
+    // Data bytes of regular events
+    byte bytes[2];
+    // Size of the extra data of meta and sysex events
+    unsigned short extraDataSize;
+  } data;
+  union {
+    byte bytes[MIDI_SEQUENCE_EVENT_INLINE_DATA_SIZE];
+    unsigned int arenaOffset;
+  } extraData;
+} MidiSequenceEventMembers;
+typedef MidiSequenceEventMembers *MidiSequenceEvent;
+
+typedef struct {
+  // Events of the sequence, sorted by timestamp
+  MidiSequenceEventMembers *midiEvents;
+  unsigned long numMidiEvents;
   int numMidiEventsProcessed;
+
+  // Private fields
+  unsigned long _capacity;
+  // Index of the next event to be played
+  unsigned long _position;
+  // False if events have been appended out of order since the array was last
+  // sorted
+  boolByte _sorted;
+  // Extra data of events which is too large to be stored inline
+  byte *_arena;
+  unsigned int _arenaSize;
+  unsigned int _arenaCapacity;
+  // Events of the current block, which are expanded from the compact form
+  MidiEventMembers *_blockEvents;
+  unsigned long _blockCapacity;
 } MidiSequenceMembers;
 
 /**
@@ -42,9 +85,25 @@ typedef struct {
  * order. After being read from a MidiSource, such as a file or perhaps an
  * actual device, the events are stored here where they can easily be read block
  * by block.
+ *
+ * Events are kept in a single array which is sorted by timestamp, so that the
+ * events of a block lie next to each other, and the sequence can be moved to
+ * any point in time with a binary search. The array and the arena are freed
+ * as a whole rather than event by event.
  */
 typedef MidiSequenceMembers *MidiSequence;
 
+/**
+ * The events of a block in a MidiSequence. The events are expanded to
+ * MidiEvents in a buffer which belongs to the sequence, and remain valid until
+ * the next block is read, an event is appended to the sequence, or it is
+ * freed. The extra data of the events belongs to the sequence as well.
+ */
+typedef struct {
+  MidiEventMembers *midiEvents;
+  unsigned long numMidiEvents;
+} MidiSequenceRange;
+
 /**
  * Creating a new MidiSequence object
  * @return MidiSequence instance
@@ -52,23 +111,74 @@ typedef MidiSequenceMembers *MidiSequence;
 MidiSequence newMidiSequence(void);
 
 /**
- * Add an event to the end of the sequence. The event's timestamp must be
- * properly set before making this call. Events added into the sequence in this
- * call are not sorted, it is the responsibility of the caller to add the events
- * sequentially in the order which they should be played back.
+ * Add an event to the sequence. The event's timestamp must be properly set
+ * before making this call. Events are normally appended in the order which
+ * they should be played back, but an event may also be appended with an
+ * earlier timestamp, in which case the sequence is sorted again before it is
+ * next read. Events with the same timestamp keep the order in which they were
+ * appended.
+ *
+ * The event and its extra data are copied to the sequence, so the caller keeps
+ * ownership of them.
  * @param self
  * @param midiEvent MidiEvent to add
+ * @param extraDataSize Number of bytes of extra data of a meta or sysex event,
+ * or 0 for other events
+ */
+void appendMidiEventToSequence(MidiSequence self, const MidiEvent midiEvent,
+                               const unsigned int extraDataSize);
+
+/**
+ * Move the sequence to a point in time, so that the next block which is read
+ * starts with the first event at or after the given timestamp.
+ * @param self
+ * @param timestamp Sample frame to move to
+ */
+void midiSequenceSeek(MidiSequence self, const unsigned long timestamp);
+
+/**
+ * Get the current position of the sequence
+ * @param self
+ * @return Index in the midiEvents array of the next event to be played, which
+ * is numMidiEvents once all events have been played
+ */
+unsigned long midiSequenceGetPosition(MidiSequence self);
+
+/**
+ * Get the events for a given block, and move the sequence past them. The
+ * deltaFrames of each event is set relative to the start of the block. If the
+ * block does not start where the previous one ended, then the sequence first
+ * seeks to the start of the block.
+ * @param self
+ * @param startTimestamp Sample frame that marks the starting point of the block
+ * @param blocksize Blocksize, which determines the range of events that will be
+ * returned
+ * @param outRange Range to set to the events of the block
+ * @return True if more events remain in the sequence after this block
+ */
+boolByte midiSequenceGetRange(MidiSequence self,
+                              const unsigned long startTimestamp,
+                              const unsigned long blocksize,
+                              MidiSequenceRange *outRange);
+
+/**
+ * Remove the events which have already been played from the sequence, so that
+ * a sequence which is filled a block at a time from a streaming source does
+ * not grow with the length of the stream. Events can no longer be played again
+ * by seeking back after this call.
+ * @param self
  */
-void appendMidiEventToSequence(MidiSequence self, MidiEvent midiEvent);
+void midiSequenceDiscardPlayedEvents(MidiSequence self);
 
 /**
- * Populate a linked list with MIDI events for a given block. This method does
- * not return a linked list in order to optimize for memory usage.
+ * Populate a list buffer with MIDI events for a given block. The buffer is
+ * cleared first, and is meant to be reused for every block so that no memory
+ * is allocated once it has grown to hold the largest block.
  * @param self
  * @param startTimestamp Sample frame that marks the starting point of the block
  * @param blocksize Blocksize, which determines the range of events that will be
  * added to the list
- * @param outMidiEvents Lists to upend events to
+ * @param outMidiEvents Buffer to fill with the events
  * @return True if more events remain in the list after this call is complete,
  * false otherwise. This is so that the caller can tell when the end of the MIDI
  * sequence has been reached.
@@ -76,7 +186,7 @@ void appendMidiEventToSequence(MidiSequence self, MidiEvent midiEvent);
 boolByte fillMidiEventsFromRange(MidiSequence self,
                                  const unsigned long startTimestamp,
                                  const unsigned long blocksize,
-                                 LinkedList outMidiEvents);
+                                 LinkedListBuffer outMidiEvents);
 
 /**
  * Free a MIDI sequence and its associated resources
@@ -29,12 +29,16 @@
 #include "base/File.h"
 #include "logging/EventLogger.h"
 #include "midi/MidiSourceFile.h"
+#include "midi/MidiSourceStream.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 
 MidiSourceType guessMidiSourceType(const CharString midiSourceTypeString) {
-  if (!charStringIsEmpty(midiSourceTypeString)) {
+  if (!charStringIsEmpty(midiSourceTypeString) &&
+      isMidiSourceStream(midiSourceTypeString)) {
+    return MIDI_SOURCE_TYPE_STREAM;
+  } else if (!charStringIsEmpty(midiSourceTypeString)) {
     File midiSourceFile = newFileWithPath(midiSourceTypeString);
     CharString fileExtension = fileGetExtension(midiSourceFile);
     freeFile(midiSourceFile);
@@ -46,7 +50,8 @@ MidiSourceType guessMidiSourceType(const CharString midiSourceTypeString) {
       freeCharString(fileExtension);
       return MIDI_SOURCE_TYPE_FILE;
     } else {
-      logCritical("MIDI source '%s' does not match any supported type");
+      logCritical("MIDI source '%s' does not match any supported type",
+                  midiSourceTypeString->data);
       freeCharString(fileExtension);
       return MIDI_SOURCE_TYPE_INVALID;
     }
@@ -62,6 +67,9 @@ MidiSource newMidiSource(MidiSourceType midiSourceType,
   case MIDI_SOURCE_TYPE_FILE:
     return newMidiSourceFile(midiSourceName);
 
+  case MIDI_SOURCE_TYPE_STREAM:
+    return newMidiSourceStream(midiSourceName);
+
   default:
     return NULL;
   }
@@ -34,11 +34,14 @@
 typedef enum {
   MIDI_SOURCE_TYPE_INVALID,
   MIDI_SOURCE_TYPE_FILE,
+  MIDI_SOURCE_TYPE_STREAM,
   NUM_MIDI_SOURCE_TYPES
 } MidiSourceType;
 
 typedef boolByte (*OpenMidiSourceFunc)(void *);
 typedef boolByte (*ReadMidiEventsFunc)(void *, MidiSequence);
+typedef boolByte (*ReadMidiEventsUntilFunc)(void *, MidiSequence,
+                                            unsigned long);
 typedef void (*FreeMidiSourceDataFunc)(void *);
 
 typedef struct {
@@ -47,6 +50,11 @@ typedef struct {
 
   OpenMidiSourceFunc openMidiSource;
   ReadMidiEventsFunc readMidiEvents;
+  // Append the events before the given timestamp which have not yet been read,
+  // and return false once the source has no more events. Sources which can be
+  // streamed set this, in which case it is used instead of readMidiEvents() to
+  // read the events a block at a time.
+  ReadMidiEventsUntilFunc readMidiEventsUntil;
   FreeMidiSourceDataFunc freeMidiSourceData;
 
   void *extraData;
@@ -68,7 +76,9 @@ MidiSource newMidiSource(MidiSourceType midiSourceType,
                          const CharString midiSourceName);
 
 /**
- * Determine an appropriate source type based on a file name.
+ * Determine an appropriate source type based on a file name. Stdin ("-"), named
+ * pipes and sockets are streamed, and other files are read according to their
+ * extension.
  * @param midiSourceTypeString Source name
  * @return Source type
  */
@@ -30,220 +30,489 @@
 #include "base/Endian.h"
 #include "logging/EventLogger.h"
 
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-static boolByte _openMidiSourceFile(void *midiSourcePtr) {
-  MidiSource midiSource = midiSourcePtr;
-  MidiSourceFileData extraData = midiSource->extraData;
+#if UNIX
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Size of the header and chunk headers of a MIDI file
+#define MIDI_FILE_CHUNK_HEADER_SIZE 8
+#define MIDI_FILE_HEADER_SIZE 6
+
+static boolByte _mapMidiFile(MidiSource midiSource) {
+  MidiSourceFileData extraData = (MidiSourceFileData)midiSource->extraData;
+#if UNIX
+  struct stat fileStat;
+  void *fileData;
+  int fd = open(midiSource->sourceName->data, O_RDONLY);
+
+  if (fd < 0) {
+    return false;
+  }
 
-  extraData->fileHandle = fopen(midiSource->sourceName->data, "rb");
+  if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0) {
+    close(fd);
+    return false;
+  }
 
-  if (extraData->fileHandle == NULL) {
-    logError("MIDI file '%s' could not be opened for reading",
-             midiSource->sourceName->data);
+  fileData =
+      mmap(NULL, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if (fileData == MAP_FAILED) {
+    logError("Could not map MIDI file, %s", stringForLastError(errno));
     return false;
   }
 
+  extraData->fileData = (const byte *)fileData;
+  extraData->fileSize = (size_t)fileStat.st_size;
   return true;
-}
+#elif WINDOWS
+  LARGE_INTEGER fileSize;
 
-static boolByte _readMidiFileChunkHeader(FILE *midiFile,
-                                         const char *expectedChunkId) {
-  byte chunkId[5];
-  size_t itemsRead;
+  extraData->fileHandle =
+      CreateFileA(midiSource->sourceName->data, GENERIC_READ, FILE_SHARE_READ,
+                  NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
 
-  memset(chunkId, 0, 5);
-  itemsRead = fread(chunkId, sizeof(byte), 4, midiFile);
+  if (extraData->fileHandle == INVALID_HANDLE_VALUE) {
+    extraData->fileHandle = NULL;
+    return false;
+  }
 
-  if (itemsRead < 4) {
-    logError("Short read of MIDI file (at chunk ID)");
+  if (!GetFileSizeEx(extraData->fileHandle, &fileSize) ||
+      fileSize.QuadPart == 0) {
     return false;
-  } else if (strncmp((char *)chunkId, expectedChunkId, 4)) {
-    logError("MIDI file does not have valid chunk ID");
+  }
+
+  extraData->fileMapping = CreateFileMappingA(extraData->fileHandle, NULL,
+                                              PAGE_READONLY, 0, 0, NULL);
+
+  if (extraData->fileMapping == NULL) {
     return false;
-  } else {
-    return true;
   }
+
+  extraData->fileData = (const byte *)MapViewOfFile(
+      extraData->fileMapping, FILE_MAP_READ, 0, 0, 0);
+  extraData->fileSize = (size_t)fileSize.QuadPart;
+  return (boolByte)(extraData->fileData != NULL);
+#else
+  return false;
+#endif
 }
 
-static boolByte _readMidiFileHeader(FILE *midiFile, unsigned short *formatType,
-                                    unsigned short *numTracks,
-                                    unsigned short *timeDivision) {
-  unsigned int numBytesBuffer;
-  size_t itemsRead;
-  unsigned int numBytes;
-  unsigned short wordBuffer;
+static void _unmapMidiFile(MidiSourceFileData extraData) {
+#if UNIX
+  if (extraData->fileData != NULL) {
+    munmap((void *)extraData->fileData, extraData->fileSize);
+  }
+#elif WINDOWS
+  if (extraData->fileData != NULL) {
+    UnmapViewOfFile(extraData->fileData);
+  }
 
-  if (!_readMidiFileChunkHeader(midiFile, "MThd")) {
-    return false;
+  if (extraData->fileMapping != NULL) {
+    CloseHandle(extraData->fileMapping);
+  }
+
+  if (extraData->fileHandle != NULL) {
+    CloseHandle(extraData->fileHandle);
   }
 
-  itemsRead = fread(&numBytesBuffer, sizeof(unsigned int), 1, midiFile);
+  extraData->fileMapping = NULL;
+  extraData->fileHandle = NULL;
+#endif
 
-  if (itemsRead < 1) {
-    logError("Short read of MIDI file (at header, num items)");
+  extraData->fileData = NULL;
+  extraData->fileSize = 0;
+}
+
+static boolByte _readMidiFileChunkHeader(const byte **position,
+                                         const byte *end, char *outChunkId,
+                                         size_t *outChunkSize) {
+  if (end - *position < MIDI_FILE_CHUNK_HEADER_SIZE) {
+    logError("Short read of MIDI file (at chunk header)");
     return false;
   }
 
-  numBytes = convertBigEndianIntToPlatform(numBytesBuffer);
+  memcpy(outChunkId, *position, 4);
+  outChunkId[4] = '\0';
+  *outChunkSize =
+      (size_t)convertBigEndianByteArrayToUnsignedInt(*position + 4);
+  *position += MIDI_FILE_CHUNK_HEADER_SIZE;
 
-  if (numBytes != 6) {
-    logError("MIDI file has %d bytes in header chunk, expected 6", numBytes);
+  if ((size_t)(end - *position) < *outChunkSize) {
+    logError("Short read of MIDI file (chunk '%s' is %lu bytes)", outChunkId,
+             (unsigned long)*outChunkSize);
     return false;
   }
 
-  itemsRead = fread(&wordBuffer, sizeof(unsigned short), 1, midiFile);
+  return true;
+}
 
-  if (itemsRead != 1) {
-    logError("Short read of MIDI file (at header, format type)");
+static boolByte _readMidiFileHeader(MidiSourceFileData extraData,
+                                    const byte **position) {
+  const byte *end = extraData->fileData + extraData->fileSize;
+  char chunkId[5];
+  size_t chunkSize;
+
+  if (!_readMidiFileChunkHeader(position, end, chunkId, &chunkSize)) {
+    return false;
+  } else if (strcmp(chunkId, "MThd")) {
+    logError("MIDI file does not have valid chunk ID");
+    return false;
+  } else if (chunkSize != MIDI_FILE_HEADER_SIZE) {
+    logError("MIDI file has %lu bytes in header chunk, expected %d",
+             (unsigned long)chunkSize, MIDI_FILE_HEADER_SIZE);
     return false;
   }
 
-  *formatType = convertBigEndianShortToPlatform(wordBuffer);
+  extraData->formatType = convertBigEndianByteArrayToUnsignedShort(*position);
+  extraData->numTracks =
+      convertBigEndianByteArrayToUnsignedShort(*position + 2);
+  extraData->timeDivision =
+      convertBigEndianByteArrayToUnsignedShort(*position + 4);
+  *position += MIDI_FILE_HEADER_SIZE;
+  logDebug("Time division is %d", extraData->timeDivision);
 
-  itemsRead = fread(&wordBuffer, sizeof(unsigned short), 1, midiFile);
+  return true;
+}
 
-  if (itemsRead != 1) {
-    logError("Short read of MIDI file (at header, num tracks)");
-    return false;
+static boolByte _readVariableLength(MidiFileTrack track,
+                                    unsigned long *outValue) {
+  unsigned long value = 0;
+  int i;
+
+  // Variable length quantities have at most 4 bytes
+  for (i = 0; i < 4 && track->position < track->end; i++) {
+    value = (value << 7) | (*track->position & 0x7f);
+
+    if (!(*(track->position++) & 0x80)) {
+      *outValue = value;
+      return true;
+    }
   }
 
-  *numTracks = convertBigEndianShortToPlatform(wordBuffer);
+  return false;
+}
 
-  itemsRead = fread(&wordBuffer, sizeof(unsigned short), 1, midiFile);
+/**
+ * Decode the delta time of the next event in a track, or mark the track as
+ * finished if there are no more events.
+ */
+static boolByte _advanceMidiFileTrack(MidiFileTrack track) {
+  unsigned long deltaTime;
 
-  if (itemsRead != 1) {
-    logError("Short read of MIDI file (at header, time division)");
-    return false;
+  if (track->position >= track->end) {
+    track->finished = true;
+    return true;
   }
 
-  *timeDivision = convertBigEndianShortToPlatform(wordBuffer);
-  logDebug("Time division is %d", *timeDivision);
+  if (!_readVariableLength(track, &deltaTime)) {
+    logError("MIDI file has an invalid delta time");
+    track->finished = true;
+    return false;
+  }
 
+  track->nextTick += deltaTime;
   return true;
 }
 
-static boolByte _readMidiFileTrack(FILE *midiFile, const int trackNumber,
-                                   const int timeDivision,
-                                   const MidiFileTimeDivisionType divisionType,
-                                   MidiSequence midiSequence) {
-  unsigned int numBytesBuffer;
-  byte *trackData, *currentByte, *endByte;
-  size_t itemsRead, numBytes;
-  unsigned long currentTimeInSampleFrames = 0;
-  unsigned long unpackedVariableLength;
-  MidiEvent midiEvent = NULL;
-  unsigned int i;
-
-  if (!_readMidiFileChunkHeader(midiFile, "MTrk")) {
+static boolByte _openMidiSourceFile(void *midiSourcePtr) {
+  MidiSource midiSource = midiSourcePtr;
+  MidiSourceFileData extraData = midiSource->extraData;
+  const byte *position;
+  const byte *end;
+  char chunkId[5];
+  size_t chunkSize;
+  unsigned short track = 0;
+
+  if (!_mapMidiFile(midiSource)) {
+    logError("MIDI file '%s' could not be opened for reading",
+             midiSource->sourceName->data);
+    _unmapMidiFile(extraData);
     return false;
   }
 
-  itemsRead = fread(&numBytesBuffer, sizeof(unsigned int), 1, midiFile);
+  position = extraData->fileData;
+  end = extraData->fileData + extraData->fileSize;
 
-  if (itemsRead < 1) {
-    logError("Short read of MIDI file (at track %d header, num items)",
-             trackNumber);
+  if (!_readMidiFileHeader(extraData, &position)) {
     return false;
   }
 
-  // Read in the entire track in one pass and parse the events from the buffer
-  // data. Much easier
-  // than having to call fread() for each event.
-  numBytes = (size_t)convertBigEndianIntToPlatform(numBytesBuffer);
-  trackData = (byte *)malloc(numBytes);
-  itemsRead = fread(trackData, 1, numBytes, midiFile);
+  if (extraData->formatType > 1) {
+    logUnsupportedFeature("MIDI file types other than 0 and 1");
+    return false;
+  } else if (extraData->formatType == 0 && extraData->numTracks != 1) {
+    logError("MIDI file '%s' is of type 0, but contains %d tracks",
+             midiSource->sourceName->data, extraData->numTracks);
+    return false;
+  }
 
-  if (itemsRead != numBytes) {
-    logError("Short read of MIDI file (at track %d)", trackNumber);
-    free(trackData);
+  // Determine time division type
+  if (extraData->timeDivision & 0x8000) {
+    extraData->divisionType = TIME_DIVISION_TYPE_FRAMES_PER_SECOND;
+    logUnsupportedFeature("MIDI file with time division in frames/second");
+    return false;
+  } else if (extraData->timeDivision == 0) {
+    logError("MIDI file '%s' has no time division",
+             midiSource->sourceName->data);
     return false;
   }
 
-  currentByte = trackData;
-  endByte = trackData + numBytes;
+  extraData->divisionType = TIME_DIVISION_TYPE_TICKS_PER_BEAT;
+  logDebug(
+      "MIDI file is type %d, has %d tracks, and time division %d (type %d)",
+      extraData->formatType, extraData->numTracks, extraData->timeDivision,
+      extraData->divisionType);
+
+  // Only the positions of the tracks are found here, their events are decoded
+  // when they are read
+  extraData->tracks = (MidiFileTrackMembers *)calloc(
+      extraData->numTracks, sizeof(MidiFileTrackMembers));
+  extraData->trackHeap =
+      (unsigned short *)malloc(sizeof(unsigned short) * extraData->numTracks);
+
+  while (track < extraData->numTracks) {
+    if (!_readMidiFileChunkHeader(&position, end, chunkId, &chunkSize)) {
+      return false;
+    }
 
-  while (currentByte < endByte) {
-    // Unpack variable length timestamp
-    unpackedVariableLength = *currentByte;
+    // Chunks of unknown types should be skipped
+    if (!strcmp(chunkId, "MTrk")) {
+      extraData->tracks[track].position = position;
+      extraData->tracks[track].end = position + chunkSize;
+      track++;
+    }
+
+    position += chunkSize;
+  }
 
-    if (unpackedVariableLength & 0x80) {
-      unpackedVariableLength &= 0x7f;
+  return true;
+}
 
-      do {
-        unpackedVariableLength =
-            (unpackedVariableLength << 7) + (*(++currentByte) & 0x7f);
-      } while (*currentByte & 0x80);
+/**
+ * Decode the event at the read position of a track
+ * @return True if the track could be decoded, false if it is invalid
+ */
+static boolByte _readMidiFileEvent(MidiFileTrack track,
+                                   const unsigned long timestamp,
+                                   MidiEvent outEvent,
+                                   unsigned long *outExtraDataSize) {
+  unsigned long length;
+  byte statusByte;
+
+  memset(outEvent, 0, sizeof(MidiEventMembers));
+  outEvent->timestamp = timestamp;
+  *outExtraDataSize = 0;
+
+  if (track->position >= track->end) {
+    return false;
+  }
+
+  statusByte = *track->position;
+
+  if (statusByte == 0xff) {
+    if (track->end - track->position < 2) {
+      return false;
     }
 
-    currentByte++;
-    freeMidiEvent(midiEvent);
-    midiEvent = newMidiEvent();
+    outEvent->eventType = MIDI_TYPE_META;
+    outEvent->status = track->position[1];
+    track->position += 2;
 
-    switch (*currentByte) {
-    case 0xff:
-      midiEvent->eventType = MIDI_TYPE_META;
-      currentByte++;
-      midiEvent->status = *(currentByte++);
-      numBytes = *(currentByte++);
-      midiEvent->extraData = (byte *)malloc(numBytes);
+    if (!_readVariableLength(track, &length) ||
+        (unsigned long)(track->end - track->position) < length) {
+      return false;
+    }
 
-      for (i = 0; i < numBytes; i++) {
-        midiEvent->extraData[i] = *(currentByte++);
-      }
+    // The data is read directly from the mapped file
+    outEvent->extraData = (byte *)track->position;
+    *outExtraDataSize = length;
+    track->position += length;
+  } else if (statusByte == 0xf0 || statusByte == 0xf7) {
+    outEvent->eventType = MIDI_TYPE_SYSEX;
+    track->position++;
 
-      break;
+    if (!_readVariableLength(track, &length) ||
+        (unsigned long)(track->end - track->position) < length) {
+      return false;
+    }
 
-    case 0x7f:
-      logUnsupportedFeature("MIDI files containing sysex events");
-      free(trackData);
-      freeMidiEvent(midiEvent);
+    track->position += length;
+  } else {
+    // Events without a status byte use the status of the previous event
+    if (statusByte & 0x80) {
+      track->runningStatus = statusByte;
+      track->position++;
+    } else if (track->runningStatus == 0) {
+      return false;
+    }
+
+    outEvent->eventType = MIDI_TYPE_REGULAR;
+    outEvent->status = track->runningStatus;
+
+    if (track->position >= track->end) {
       return false;
+    }
 
-    default:
-      midiEvent->eventType = MIDI_TYPE_REGULAR;
-      midiEvent->status = *currentByte++;
-      midiEvent->data1 = *currentByte++;
+    outEvent->data1 = *(track->position++);
 
-      // All regular MIDI events have 3 bytes except for program change and
-      // channel aftertouch
-      if (!((midiEvent->status & 0xf0) == 0xc0 ||
-            (midiEvent->status & 0xf0) == 0xd0)) {
-        midiEvent->data2 = *currentByte++;
+    // All regular MIDI events have 3 bytes except for program change and
+    // channel aftertouch
+    if (!((outEvent->status & 0xf0) == 0xc0 ||
+          (outEvent->status & 0xf0) == 0xd0)) {
+      if (track->position >= track->end) {
+        return false;
       }
 
+      outEvent->data2 = *(track->position++);
+    }
+  }
+
+  return true;
+}
+
+/**
+ * Check whether the next event of one track comes before that of another.
+ * Events at the same time are taken from the first track, which is where type
+ * 1 files keep their tempo changes.
+ */
+static boolByte _isMidiFileTrackBefore(MidiSourceFileData extraData,
+                                       const unsigned short first,
+                                       const unsigned short second) {
+  const unsigned long firstTick = extraData->tracks[first].nextTick;
+  const unsigned long secondTick = extraData->tracks[second].nextTick;
+  return (boolByte)(firstTick < secondTick ||
+                    (firstTick == secondTick && first < second));
+}
+
+static void _swapMidiFileTracks(MidiSourceFileData extraData,
+                                const unsigned short first,
+                                const unsigned short second) {
+  unsigned short track = extraData->trackHeap[first];
+  extraData->trackHeap[first] = extraData->trackHeap[second];
+  extraData->trackHeap[second] = track;
+}
+
+static void _pushMidiFileTrack(MidiSourceFileData extraData,
+                               const unsigned short track) {
+  unsigned short index = extraData->trackHeapSize++;
+  unsigned short parent;
+
+  extraData->trackHeap[index] = track;
+
+  while (index > 0) {
+    parent = (unsigned short)((index - 1) / 2);
+
+    if (!_isMidiFileTrackBefore(extraData, extraData->trackHeap[index],
+                                extraData->trackHeap[parent])) {
       break;
     }
 
-    switch (divisionType) {
-    case TIME_DIVISION_TYPE_TICKS_PER_BEAT: {
-      double ticksPerSecond = (double)timeDivision * getTempo() / 60.0;
-      double sampleFramesPerTick = getSampleRate() / ticksPerSecond;
-      currentTimeInSampleFrames +=
-          (long)(unpackedVariableLength * sampleFramesPerTick);
-    } break;
-
-    case TIME_DIVISION_TYPE_FRAMES_PER_SECOND:
-      // Actually, this should be caught when parsing the file type
-      logUnsupportedFeature("Time division frames/sec");
-      free(trackData);
-      freeMidiEvent(midiEvent);
-      return false;
+    _swapMidiFileTracks(extraData, index, parent);
+    index = parent;
+  }
+}
+
+/**
+ * Restore the heap order after the time of the first track has changed, or
+ * remove the first track from the heap if it has finished.
+ */
+static void _updateFirstMidiFileTrack(MidiSourceFileData extraData) {
+  unsigned short index = 0;
+  unsigned short child;
+
+  if (extraData->tracks[extraData->trackHeap[0]].finished) {
+    extraData->trackHeap[0] =
+        extraData->trackHeap[--extraData->trackHeapSize];
+  }
+
+  while ((child = (unsigned short)(2 * index + 1)) <
+         extraData->trackHeapSize) {
+    if (child + 1 < extraData->trackHeapSize &&
+        _isMidiFileTrackBefore(extraData, extraData->trackHeap[child + 1],
+                               extraData->trackHeap[child])) {
+      child++;
+    }
 
-    case TIME_DIVISION_TYPE_INVALID:
-    default:
-      logInternalError("Invalid time division type");
-      free(trackData);
-      freeMidiEvent(midiEvent);
+    if (!_isMidiFileTrackBefore(extraData, extraData->trackHeap[child],
+                                extraData->trackHeap[index])) {
+      break;
+    }
+
+    _swapMidiFileTracks(extraData, index, child);
+    index = child;
+  }
+}
+
+static boolByte _startMidiFile(MidiSourceFileData extraData) {
+  unsigned short i;
+
+  // Events before the first tempo change in the file use the current tempo
+  extraData->tempoMap =
+      newMidiTempoMap(extraData->timeDivision, getTempo(), getSampleRate());
+  extraData->started = true;
+
+  for (i = 0; i < extraData->numTracks; i++) {
+    if (!_advanceMidiFileTrack(&extraData->tracks[i])) {
       return false;
     }
 
-    midiEvent->timestamp = currentTimeInSampleFrames;
+    if (!extraData->tracks[i].finished) {
+      _pushMidiFileTrack(extraData, i);
+    }
+  }
+
+  return true;
+}
+
+static boolByte _readMidiEventsUntilFile(void *midiSourcePtr,
+                                         MidiSequence midiSequence,
+                                         unsigned long untilTimestamp) {
+  MidiSource midiSource = (MidiSource)midiSourcePtr;
+  MidiSourceFileData extraData = (MidiSourceFileData)(midiSource->extraData);
+  MidiFileTrack track;
+  MidiEventMembers midiEvent;
+  unsigned long extraDataSize;
+  unsigned long timestamp;
+  unsigned long microsecondsPerBeat;
+
+  if (extraData->tracks == NULL) {
+    return false;
+  } else if (!extraData->started && !_startMidiFile(extraData)) {
+    return false;
+  }
+
+  // Tracks are merged by always taking the earliest event of any track. Since
+  // this is in order of ticks, all tempo changes before an event are already
+  // in the tempo map when the event is converted to frames.
+  while (extraData->trackHeapSize > 0) {
+    track = &extraData->tracks[extraData->trackHeap[0]];
+    timestamp = midiTempoMapGetFrame(extraData->tempoMap, track->nextTick);
+
+    if (timestamp >= untilTimestamp) {
+      break;
+    }
+
+    if (!_readMidiFileEvent(track, timestamp, &midiEvent, &extraDataSize)) {
+      logError("MIDI file '%s' has an invalid event at %ld",
+               midiSource->sourceName->data, timestamp);
+      track->finished = true;
+      _updateFirstMidiFileTrack(extraData);
+      return false;
+    }
 
-    if (midiEvent->eventType == MIDI_TYPE_META) {
-      switch (midiEvent->status) {
+    if (midiEvent.eventType == MIDI_TYPE_META) {
+      switch (midiEvent.status) {
       case MIDI_META_TYPE_TEXT:
       case MIDI_META_TYPE_COPYRIGHT:
       case MIDI_META_TYPE_SEQUENCE_NAME:
@@ -259,87 +528,76 @@ static boolByte _readMidiFileTrack(FILE *midiFile, const int trackNumber,
       case MIDI_META_TYPE_KEY_SIGNATURE:
       case MIDI_META_TYPE_PROPRIETARY:
         logDebug("Ignoring MIDI meta event of type 0x%x at %ld",
-                 midiEvent->status, midiEvent->timestamp);
+                 midiEvent.status, midiEvent.timestamp);
         break;
 
+      case MIDI_META_TYPE_TRACK_END:
+        track->finished = true;
+
+        // Processing stops at the end of a track, so only the end of the last
+        // track is passed on
+        if (extraData->trackHeapSize > 1) {
+          break;
+        }
+
+      // Fall through
       case MIDI_META_TYPE_TEMPO:
       case MIDI_META_TYPE_TIME_SIGNATURE:
-      case MIDI_META_TYPE_TRACK_END:
+        if (midiEvent.status == MIDI_META_TYPE_TEMPO && extraDataSize == 3) {
+          microsecondsPerBeat = ((unsigned long)midiEvent.extraData[0] << 16) |
+                                ((unsigned long)midiEvent.extraData[1] << 8) |
+                                midiEvent.extraData[2];
+          midiTempoMapAddTempo(extraData->tempoMap, track->nextTick,
+                               microsecondsPerBeat);
+        }
+
         logDebug("Parsed MIDI meta event of type 0x%02x at %ld",
-                 midiEvent->status, midiEvent->timestamp);
-        appendMidiEventToSequence(midiSequence, midiEvent);
-        midiEvent = NULL;
+                 midiEvent.status, midiEvent.timestamp);
+        appendMidiEventToSequence(midiSequence, &midiEvent,
+                                  (unsigned int)extraDataSize);
         break;
 
       default:
         logWarn("Ignoring MIDI meta event of type 0x%x at %ld",
-                midiEvent->status, midiEvent->timestamp);
+                midiEvent.status, midiEvent.timestamp);
         break;
       }
+    } else if (midiEvent.eventType == MIDI_TYPE_SYSEX) {
+      logUnsupportedFeature("MIDI files containing sysex events");
     } else {
-      logDebug("MIDI event of type 0x%02x parsed at %ld", midiEvent->status,
-               midiEvent->timestamp);
-      appendMidiEventToSequence(midiSequence, midiEvent);
-      midiEvent = NULL;
+      logDebug("MIDI event of type 0x%02x parsed at %ld", midiEvent.status,
+               midiEvent.timestamp);
+      appendMidiEventToSequence(midiSequence, &midiEvent, 0);
+    }
+
+    if (!track->finished && !_advanceMidiFileTrack(track)) {
+      _updateFirstMidiFileTrack(extraData);
+      return false;
     }
+
+    _updateFirstMidiFileTrack(extraData);
   }
 
-  free(trackData);
-  freeMidiEvent(midiEvent);
-  return true;
+  return (boolByte)(extraData->trackHeapSize > 0);
 }
 
 static boolByte _readMidiEventsFile(void *midiSourcePtr,
                                     MidiSequence midiSequence) {
   MidiSource midiSource = (MidiSource)midiSourcePtr;
   MidiSourceFileData extraData = (MidiSourceFileData)(midiSource->extraData);
-  unsigned short formatType, numTracks, timeDivision = 0;
-  int track;
 
-  if (!_readMidiFileHeader(extraData->fileHandle, &formatType, &numTracks,
-                           &timeDivision)) {
-    return false;
-  }
-
-  if (formatType != 0) {
-    logUnsupportedFeature("MIDI file types other than 0");
-    return false;
-  } else if (formatType == 0 && numTracks != 1) {
-    logError("MIDI file '%s' is of type 0, but contains %d tracks",
-             midiSource->sourceName->data, numTracks);
-    return false;
-  }
-
-  // Determine time division type
-  if (timeDivision & 0x7fff) {
-    extraData->divisionType = TIME_DIVISION_TYPE_TICKS_PER_BEAT;
-  } else {
-    extraData->divisionType = TIME_DIVISION_TYPE_FRAMES_PER_SECOND;
-    logUnsupportedFeature("MIDI file with time division in frames/second");
-    return false;
-  }
-
-  logDebug(
-      "MIDI file is type %d, has %d tracks, and time division %d (type %d)",
-      formatType, numTracks, timeDivision, extraData->divisionType);
-
-  for (track = 0; track < numTracks; track++) {
-    if (!_readMidiFileTrack(extraData->fileHandle, track, timeDivision,
-                            extraData->divisionType, midiSequence)) {
-      return false;
-    }
-  }
-
-  return true;
+  _readMidiEventsUntilFile(midiSourcePtr, midiSequence, ULONG_MAX);
+  // All tracks should have been read to the end
+  return (boolByte)(extraData->started && extraData->trackHeapSize == 0);
 }
 
 static void _freeMidiEventsFile(void *midiSourceDataPtr) {
   MidiSourceFileData extraData = midiSourceDataPtr;
 
-  if (extraData->fileHandle != NULL) {
-    fclose(extraData->fileHandle);
-  }
-
+  _unmapMidiFile(extraData);
+  free(extraData->tracks);
+  free(extraData->trackHeap);
+  freeMidiTempoMap(extraData->tempoMap);
   free(extraData);
 }
 
@@ -354,10 +612,24 @@ MidiSource newMidiSourceFile(const CharString midiSourceName) {
 
   midiSource->openMidiSource = _openMidiSourceFile;
   midiSource->readMidiEvents = _readMidiEventsFile;
+  midiSource->readMidiEventsUntil = _readMidiEventsUntilFile;
   midiSource->freeMidiSourceData = _freeMidiEventsFile;
 
   extraData->divisionType = TIME_DIVISION_TYPE_INVALID;
+  extraData->formatType = 0;
+  extraData->timeDivision = 0;
+  extraData->tempoMap = NULL;
+  extraData->fileData = NULL;
+  extraData->fileSize = 0;
+#if WINDOWS
   extraData->fileHandle = NULL;
+  extraData->fileMapping = NULL;
+#endif
+  extraData->tracks = NULL;
+  extraData->numTracks = 0;
+  extraData->trackHeap = NULL;
+  extraData->trackHeapSize = 0;
+  extraData->started = false;
   midiSource->extraData = extraData;
 
   return midiSource;
@@ -28,8 +28,13 @@
 #define MrsWatson_MidiSourceFile_h
 
 #include "midi/MidiSource.h"
+#include "midi/MidiTempoMap.h"
 
-#include <stdio.h>
+#include <stddef.h>
+
+#if WINDOWS
+#include <Windows.h>
+#endif
 
 typedef enum {
   TIME_DIVISION_TYPE_INVALID,
@@ -38,12 +43,58 @@ typedef enum {
   NUM_TIME_DIVISION_TYPES
 } MidiFileTimeDivisionType;
 
+/**
+ * Read position in one track of a MIDI file. The delta time of the next event
+ * is always decoded ahead, so that the tracks can be merged by time.
+ */
+typedef struct {
+  const byte *position;
+  const byte *end;
+  // Time in ticks of the event at the read position
+  unsigned long nextTick;
+  byte runningStatus;
+  boolByte finished;
+} MidiFileTrackMembers;
+typedef MidiFileTrackMembers *MidiFileTrack;
+
 typedef struct {
-  FILE *fileHandle;
   MidiFileTimeDivisionType divisionType;
+  unsigned short formatType;
+  unsigned short timeDivision;
+  MidiTempoMap tempoMap;
+
+  // The file is mapped into memory rather than read, so that only the parts
+  // which are being decoded need to be resident
+  const byte *fileData;
+  size_t fileSize;
+#if WINDOWS
+  HANDLE fileHandle;
+  HANDLE fileMapping;
+#endif
+
+  MidiFileTrackMembers *tracks;
+  unsigned short numTracks;
+  // Min-heap of the indexes of the tracks which have events left, ordered by
+  // the time of their next event
+  unsigned short *trackHeap;
+  unsigned short trackHeapSize;
+  boolByte started;
 } MidiSourceFileDataMembers;
 typedef MidiSourceFileDataMembers *MidiSourceFileData;
 
+/**
+ * Create a MIDI source which streams events from a standard MIDI file of type
+ * 0 or 1. Events are decoded as they are needed by readMidiEventsUntil(), and
+ * the tracks of the file are merged as they are read, so memory use does not
+ * depend on the length of the file.
+ *
+ * Tracks are merged in order of their time in ticks, so that every tempo
+ * change has been added to the tempo map before any event after it is
+ * converted to sample frames. Events therefore have the right timestamps even
+ * when the tempo changes in a different track.
+ * @param midiSourceName Path to the MIDI file
+ * @return MidiSource object
+ */
 MidiSource newMidiSourceFile(const CharString midiSourceName);
 
 #endif
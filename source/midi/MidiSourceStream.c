@@ -0,0 +1,840 @@
+//
+// MidiSourceStream.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "MidiSourceStream.h"
+
+#include "audio/AudioSettings.h"
+#include "logging/EventLogger.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if UNIX
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#define MIDI_FILE_HEADER_ID "MThd"
+#define MIDI_FILE_HEADER_SIZE 14
+#define MIDI_FILE_CHUNK_HEADER_SIZE 8
+
+boolByte isMidiSourceStream(const CharString midiSourceName) {
+#if UNIX
+  struct stat pathStatus;
+
+  if (charStringIsEqualToCString(midiSourceName, MIDI_SOURCE_STREAM_STDIN,
+                                 false)) {
+    return true;
+  }
+
+  return (boolByte)(stat(midiSourceName->data, &pathStatus) == 0 &&
+                    (S_ISFIFO(pathStatus.st_mode) ||
+                     S_ISSOCK(pathStatus.st_mode)));
+#else
+  return false;
+#endif
+}
+
+#if UNIX
+static unsigned long _readBigEndian(const byte *data, int numBytes) {
+  unsigned long result = 0;
+  int i;
+
+  for (i = 0; i < numBytes; i++) {
+    result = (result << 8) | data[i];
+  }
+
+  return result;
+}
+
+/**
+ * Decode a variable-length quantity, if all of its bytes have been received.
+ * @return False if more bytes are needed
+ */
+static boolByte _readStreamVlq(const byte *data, unsigned long length,
+                               unsigned long *position,
+                               unsigned long *outValue) {
+  unsigned long value = 0;
+  unsigned long i;
+
+  for (i = *position; i < length && i < *position + 4; i++) {
+    value = (value << 7) | (data[i] & 0x7f);
+
+    if (!(data[i] & 0x80)) {
+      *position = i + 1;
+      *outValue = value;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * Read the bytes which were written to the wake-up pipe, so that it does not
+ * wake the reader thread up again.
+ */
+static void _clearWakeUp(MidiSourceStreamData self) {
+  char wakeUpBytes[16];
+
+  if (read(self->wakeUpPipe[0], wakeUpBytes, sizeof(wakeUpBytes)) < 0 &&
+      errno != EINTR) {
+    logWarn("Could not read from MIDI stream wake-up pipe, %s",
+            stringForLastError(errno));
+  }
+}
+
+/**
+ * Take a free message, waiting until the processing thread returns one if all
+ * of them are waiting to be played. The processing thread wakes this thread up
+ * through the wake-up pipe rather than the queue, so that returning a message
+ * never takes a lock.
+ * @return Free message, or NULL if the source is being stopped
+ */
+static MidiStreamMessage _popFreeMessage(MidiSourceStreamData self) {
+  MidiStreamMessage message;
+  struct pollfd pollDescriptor;
+
+  pollDescriptor.fd = self->wakeUpPipe[0];
+  pollDescriptor.events = POLLIN;
+
+  while (!atomicLoad(&self->stopRequested)) {
+    message = (MidiStreamMessage)spscQueuePop(self->freeMessages);
+
+    if (message != NULL) {
+      return message;
+    }
+
+    // A message may have been returned before the processing thread could see
+    // the flag, so the queue must be checked once more after setting it
+    atomicStore(&self->readerWaiting, true);
+    message = (MidiStreamMessage)spscQueuePop(self->freeMessages);
+
+    if (message != NULL) {
+      atomicStore(&self->readerWaiting, false);
+      return message;
+    }
+
+    if (poll(&pollDescriptor, 1, -1) > 0) {
+      _clearWakeUp(self);
+    } else if (errno != EINTR) {
+      logError("Could not wait for a free MIDI stream message, %s",
+               stringForLastError(errno));
+      return NULL;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * Pass an event to the processing thread, waiting for a free message if the
+ * queue is full.
+ * @return False if the source is being stopped
+ */
+static boolByte _queueStreamEvent(MidiSourceStreamData self,
+                                  const MidiEvent midiEvent,
+                                  const byte *extraData,
+                                  unsigned long extraDataSize) {
+  MidiStreamMessage message;
+
+  if (midiEvent->eventType == MIDI_TYPE_META &&
+      midiEvent->status == MIDI_META_TYPE_TRACK_END) {
+    message = &self->endMessage;
+  } else {
+    message = _popFreeMessage(self);
+  }
+
+  if (message == NULL || atomicLoad(&self->stopRequested)) {
+    return false;
+  }
+
+  memcpy(&message->midiEvent, midiEvent, sizeof(MidiEventMembers));
+
+  if (extraDataSize > 0) {
+    memcpy(message->extraData, extraData, extraDataSize);
+  }
+
+  message->extraDataSize = (unsigned int)extraDataSize;
+  message->midiEvent.extraData = message->extraData;
+  spscQueuePush(self->pendingMessages, message);
+  return true;
+}
+
+static unsigned long _getNumDataBytes(const byte status) {
+  switch (status & 0xf0) {
+  case 0xc0:
+  case 0xd0:
+    return 1;
+
+  default:
+    return 2;
+  }
+}
+
+/**
+ * Parse one message of a raw MIDI stream. Only channel messages are played.
+ * System messages are skipped along with their data bytes, which includes
+ * system exclusive messages since they run until the next status byte.
+ * @return Number of bytes which were used, or 0 if more bytes are needed
+ */
+static unsigned long _parseRawMidi(MidiSourceStreamData self,
+                                   const byte *data, unsigned long length,
+                                   boolByte *outContinue) {
+  MidiEventMembers midiEvent;
+  byte dataBytes[2] = {0, 0};
+  unsigned long position = 0;
+  unsigned long numDataBytes;
+  unsigned long i = 0;
+
+  if (data[0] >= 0xf8) {
+    // Realtime messages do not affect running status
+    return 1;
+  } else if (data[0] >= 0xf0) {
+    self->runningStatus = 0;
+    return 1;
+  } else if (data[0] >= 0x80) {
+    self->runningStatus = data[0];
+    position = 1;
+  } else if (self->runningStatus == 0) {
+    return 1;
+  }
+
+  midiEvent.status = self->runningStatus;
+  numDataBytes = _getNumDataBytes(midiEvent.status);
+
+  while (i < numDataBytes) {
+    if (position >= length) {
+      return 0;
+    } else if (data[position] >= 0xf8) {
+      // Realtime messages are skipped, even in the middle of another message
+      position++;
+    } else if (data[position] >= 0x80) {
+      // The message was interrupted by another one, so it is dropped
+      return position;
+    } else {
+      dataBytes[i++] = data[position++];
+    }
+  }
+
+  midiEvent.eventType = MIDI_TYPE_REGULAR;
+  midiEvent.deltaFrames = 0;
+  // Raw events are given a time when the processing thread receives them
+  midiEvent.timestamp = 0;
+  midiEvent.data1 = dataBytes[0];
+  midiEvent.data2 = dataBytes[1];
+  midiEvent.extraData = NULL;
+
+  if (!_queueStreamEvent(self, &midiEvent, NULL, 0)) {
+    *outContinue = false;
+  }
+
+  return position;
+}
+
+static unsigned long _parseMidiFileHeader(MidiSource midiSource,
+                                          const byte *data,
+                                          unsigned long length,
+                                          boolByte *outContinue) {
+  MidiSourceStreamData self = (MidiSourceStreamData)midiSource->extraData;
+  unsigned long headerSize;
+  unsigned short formatType;
+  unsigned short numTracks;
+
+  if (length < MIDI_FILE_HEADER_SIZE) {
+    return 0;
+  }
+
+  headerSize = _readBigEndian(data + 4, 4);
+  formatType = (unsigned short)_readBigEndian(data + 8, 2);
+  numTracks = (unsigned short)_readBigEndian(data + 10, 2);
+  self->timeDivision = (unsigned short)_readBigEndian(data + 12, 2);
+
+  if (headerSize < 6 || self->timeDivision == 0) {
+    logError("MIDI stream '%s' has an invalid header",
+             midiSource->sourceName->data);
+    *outContinue = false;
+    return 0;
+  } else if (formatType > 1 || numTracks != 1) {
+    // Tracks would need to be merged, which is not possible without reading
+    // all of them first
+    logError("MIDI stream '%s' has %d tracks, but only files with one track "
+             "can be streamed",
+             midiSource->sourceName->data, numTracks);
+    *outContinue = false;
+    return 0;
+  } else if (self->timeDivision & 0x8000) {
+    logError("MIDI stream '%s' has a time division in frames/second, which is "
+             "not supported",
+             midiSource->sourceName->data);
+    *outContinue = false;
+    return 0;
+  }
+
+  self->headerRead = true;
+  self->bytesToSkip = headerSize - 6;
+  self->tempoMap =
+      newMidiTempoMap(self->timeDivision, getTempo(), getSampleRate());
+  return MIDI_FILE_HEADER_SIZE;
+}
+
+/**
+ * Parse one event of a MIDI file track, along with its delta time.
+ * @return Number of bytes which were used, or 0 if more bytes are needed
+ */
+static unsigned long _parseMidiFileEvent(MidiSource midiSource,
+                                         const byte *data,
+                                         unsigned long length,
+                                         boolByte *outContinue) {
+  MidiSourceStreamData self = (MidiSourceStreamData)midiSource->extraData;
+  MidiEventMembers midiEvent;
+  unsigned long position = 0;
+  unsigned long deltaTime;
+  unsigned long eventLength = 0;
+  unsigned long numDataBytes;
+  byte metaType = 0;
+  boolByte passedOn = true;
+
+  if (!_readStreamVlq(data, length, &position, &deltaTime) ||
+      position >= length) {
+    return 0;
+  }
+
+  memset(&midiEvent, 0, sizeof(MidiEventMembers));
+
+  if (data[position] >= 0x80) {
+    midiEvent.status = data[position++];
+  } else if (self->runningStatus != 0) {
+    midiEvent.status = self->runningStatus;
+  } else {
+    logError("MIDI stream '%s' has an event without a status byte",
+             midiSource->sourceName->data);
+    *outContinue = false;
+    return 0;
+  }
+
+  if (midiEvent.status == 0xff) {
+    if (position >= length) {
+      return 0;
+    }
+
+    metaType = data[position++];
+
+    if (!_readStreamVlq(data, length, &position, &eventLength)) {
+      return 0;
+    }
+
+    midiEvent.eventType = MIDI_TYPE_META;
+    midiEvent.status = metaType;
+    passedOn = (boolByte)(eventLength <= MIDI_SOURCE_STREAM_MAX_EXTRA_DATA &&
+                          (metaType == MIDI_META_TYPE_TEMPO ||
+                           metaType == MIDI_META_TYPE_TIME_SIGNATURE ||
+                           metaType == MIDI_META_TYPE_TRACK_END));
+  } else if (midiEvent.status == 0xf0 || midiEvent.status == 0xf7) {
+    if (!_readStreamVlq(data, length, &position, &eventLength)) {
+      return 0;
+    }
+
+    passedOn = false;
+  } else {
+    numDataBytes = _getNumDataBytes(midiEvent.status);
+
+    if (position + numDataBytes > length) {
+      return 0;
+    }
+
+    self->runningStatus = midiEvent.status;
+    midiEvent.eventType = MIDI_TYPE_REGULAR;
+    midiEvent.data1 = data[position];
+    midiEvent.data2 = (byte)((numDataBytes > 1) ? data[position + 1] : 0);
+    position += numDataBytes;
+  }
+
+  if (passedOn && position + eventLength > length) {
+    return 0;
+  }
+
+  // The event has been received completely, so the stream can move past it
+  self->currentTick += deltaTime;
+  midiEvent.timestamp =
+      midiTempoMapGetFrame(self->tempoMap, self->currentTick);
+
+  if (!passedOn) {
+    self->bytesToSkip = eventLength;
+    return position;
+  }
+
+  if (midiEvent.eventType == MIDI_TYPE_META) {
+    if (metaType == MIDI_META_TYPE_TEMPO && eventLength == 3) {
+      midiTempoMapAddTempo(self->tempoMap, self->currentTick,
+                           _readBigEndian(data + position, 3));
+    } else if (metaType == MIDI_META_TYPE_TRACK_END) {
+      *outContinue = false;
+    }
+  }
+
+  if (!_queueStreamEvent(self, &midiEvent, data + position, eventLength)) {
+    *outContinue = false;
+  }
+
+  return position + eventLength;
+}
+
+static unsigned long _parseMidiStream(MidiSource midiSource, const byte *data,
+                                      unsigned long length,
+                                      boolByte *outContinue) {
+  MidiSourceStreamData self = (MidiSourceStreamData)midiSource->extraData;
+  unsigned long chunkSize;
+
+  if (self->bytesToSkip > 0) {
+    chunkSize = (length < self->bytesToSkip) ? length : self->bytesToSkip;
+    self->bytesToSkip -= chunkSize;
+    return chunkSize;
+  } else if (!self->timestamped) {
+    return _parseRawMidi(self, data, length, outContinue);
+  } else if (!self->headerRead) {
+    return _parseMidiFileHeader(midiSource, data, length, outContinue);
+  } else if (self->inTrack) {
+    return _parseMidiFileEvent(midiSource, data, length, outContinue);
+  } else if (length < MIDI_FILE_CHUNK_HEADER_SIZE) {
+    return 0;
+  }
+
+  // The length of the track is ignored, since a program which writes the file
+  // as it goes can not know it in advance
+  if (!memcmp(data, "MTrk", 4)) {
+    self->inTrack = true;
+  } else {
+    self->bytesToSkip = _readBigEndian(data + 4, 4);
+  }
+
+  return MIDI_FILE_CHUNK_HEADER_SIZE;
+}
+
+/**
+ * Parse all complete messages in the buffer, and keep the rest of the bytes
+ * until more of the stream has been read.
+ * @return False if the stream has ended or is invalid
+ */
+static boolByte _parseMidiStreamBuffer(MidiSource midiSource) {
+  MidiSourceStreamData self = (MidiSourceStreamData)midiSource->extraData;
+  unsigned long position = 0;
+  unsigned long bytesUsed;
+  boolByte shouldContinue = true;
+
+  while (shouldContinue && position < self->bufferLength) {
+    bytesUsed = _parseMidiStream(midiSource, self->buffer + position,
+                                 self->bufferLength - position,
+                                 &shouldContinue);
+
+    if (bytesUsed == 0) {
+      break;
+    }
+
+    position += bytesUsed;
+  }
+
+  self->bufferLength -= position;
+  memmove(self->buffer, self->buffer + position, self->bufferLength);
+  return shouldContinue;
+}
+
+static void _runMidiSourceStream(void *userData) {
+  MidiSource midiSource = (MidiSource)userData;
+  MidiSourceStreamData self = (MidiSourceStreamData)midiSource->extraData;
+  MidiEventMembers endEvent;
+  struct pollfd pollDescriptors[2];
+  ssize_t bytesRead;
+
+  pollDescriptors[0].fd = self->wakeUpPipe[0];
+  pollDescriptors[0].events = POLLIN;
+  pollDescriptors[1].fd = self->descriptor;
+  pollDescriptors[1].events = POLLIN;
+
+  // The start of the stream was already read when it was opened
+  while (_parseMidiStreamBuffer(midiSource) &&
+         !atomicLoad(&self->stopRequested)) {
+    if (poll(pollDescriptors, 2, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      logError("Could not wait for MIDI stream, %s",
+               stringForLastError(errno));
+      break;
+    }
+
+    // The pipe is also written when a free message is returned after the
+    // thread stopped waiting for it, so only stopRequested ends the thread
+    if (pollDescriptors[0].revents != 0) {
+      _clearWakeUp(self);
+      continue;
+    }
+
+    bytesRead = read(self->descriptor, self->buffer + self->bufferLength,
+                     MIDI_SOURCE_STREAM_BUFFER_SIZE - self->bufferLength);
+
+    if (bytesRead < 0 && (errno == EINTR || errno == EAGAIN)) {
+      continue;
+    } else if (bytesRead < 0) {
+      logError("Could not read from MIDI stream '%s', %s",
+               midiSource->sourceName->data, stringForLastError(errno));
+      break;
+    } else if (bytesRead == 0) {
+      logDebug("MIDI stream '%s' was closed", midiSource->sourceName->data);
+      break;
+    }
+
+    self->bufferLength += (unsigned long)bytesRead;
+  }
+
+  // Streams which are closed or invalid are ended as if they had a track end,
+  // unless the end message was already sent for the track end of a MIDI file
+  if (!atomicLoad(&self->stopRequested) &&
+      self->endMessage.midiEvent.eventType != MIDI_TYPE_META) {
+    memset(&endEvent, 0, sizeof(MidiEventMembers));
+    endEvent.eventType = MIDI_TYPE_META;
+    endEvent.status = MIDI_META_TYPE_TRACK_END;
+
+    if (self->tempoMap != NULL) {
+      endEvent.timestamp =
+          midiTempoMapGetFrame(self->tempoMap, self->currentTick);
+    }
+
+    _queueStreamEvent(self, &endEvent, NULL, 0);
+  }
+}
+
+static boolByte _connectToSocket(MidiSource midiSource) {
+  MidiSourceStreamData self = (MidiSourceStreamData)midiSource->extraData;
+  struct sockaddr_un address;
+
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+
+  if (strlen(midiSource->sourceName->data) >= sizeof(address.sun_path)) {
+    logError("Socket path '%s' is too long", midiSource->sourceName->data);
+    return false;
+  }
+
+  strncpy(address.sun_path, midiSource->sourceName->data,
+          sizeof(address.sun_path) - 1);
+  self->descriptor = socket(AF_UNIX, SOCK_STREAM, 0);
+
+  if (self->descriptor < 0 ||
+      connect(self->descriptor, (struct sockaddr *)&address,
+              sizeof(address)) != 0) {
+    logError("Could not connect to '%s', %s", midiSource->sourceName->data,
+             stringForLastError(errno));
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * Read the start of the stream, which tells whether it is a MIDI file. This
+ * blocks until the first bytes of the stream have arrived.
+ */
+static boolByte _readMidiStreamFormat(MidiSource midiSource) {
+  MidiSourceStreamData self = (MidiSourceStreamData)midiSource->extraData;
+  const unsigned long idLength = strlen(MIDI_FILE_HEADER_ID);
+  ssize_t bytesRead;
+
+  while (self->bufferLength < idLength &&
+         !memcmp(self->buffer, MIDI_FILE_HEADER_ID, self->bufferLength)) {
+    bytesRead = read(self->descriptor, self->buffer + self->bufferLength,
+                     idLength - self->bufferLength);
+
+    if (bytesRead < 0 && errno == EINTR) {
+      continue;
+    } else if (bytesRead < 0) {
+      logError("Could not read from MIDI stream '%s', %s",
+               midiSource->sourceName->data, stringForLastError(errno));
+      return false;
+    } else if (bytesRead == 0) {
+      break;
+    }
+
+    self->bufferLength += (unsigned long)bytesRead;
+  }
+
+  self->timestamped =
+      (boolByte)(self->bufferLength == idLength &&
+                 !memcmp(self->buffer, MIDI_FILE_HEADER_ID, idLength));
+  logInfo("Reading %s from '%s'",
+          self->timestamped ? "MIDI file" : "raw MIDI events",
+          midiSource->sourceName->data);
+  return true;
+}
+#endif
+
+static boolByte _openMidiSourceStream(void *midiSourcePtr) {
+#if UNIX
+  MidiSource midiSource = (MidiSource)midiSourcePtr;
+  MidiSourceStreamData self = (MidiSourceStreamData)midiSource->extraData;
+  struct stat pathStatus;
+
+  if (charStringIsEqualToCString(midiSource->sourceName,
+                                 MIDI_SOURCE_STREAM_STDIN, false)) {
+    self->descriptor = STDIN_FILENO;
+  } else if (stat(midiSource->sourceName->data, &pathStatus) == 0 &&
+             S_ISSOCK(pathStatus.st_mode)) {
+    if (!_connectToSocket(midiSource)) {
+      return false;
+    }
+  } else {
+    logInfo("Waiting for a program to write to '%s'",
+            midiSource->sourceName->data);
+    self->descriptor = open(midiSource->sourceName->data, O_RDONLY);
+
+    if (self->descriptor < 0) {
+      logError("Could not open MIDI stream '%s', %s",
+               midiSource->sourceName->data, stringForLastError(errno));
+      return false;
+    }
+  }
+
+  if (!_readMidiStreamFormat(midiSource)) {
+    return false;
+  }
+
+  if (pipe(self->wakeUpPipe) != 0) {
+    logError("Could not create pipe, %s", stringForLastError(errno));
+    return false;
+  }
+
+  self->thread = newThread(_runMidiSourceStream, midiSource);
+
+  if (self->thread == NULL) {
+    logError("Could not start MIDI stream thread");
+    return false;
+  }
+
+  return true;
+#else
+  logUnsupportedFeature("Streaming MIDI sources on this platform");
+  return false;
+#endif
+}
+
+/**
+ * Return a played message to the reader thread, and wake it up if it ran out
+ * of free messages.
+ */
+static void _returnFreeMessage(MidiSourceStreamData self,
+                               MidiStreamMessage message) {
+  spscQueuePush(self->freeMessages, message);
+
+#if UNIX
+  if (atomicLoad(&self->readerWaiting) &&
+      atomicCompareAndSwap(&self->readerWaiting, true, false) &&
+      write(self->wakeUpPipe[1], "", 1) != 1) {
+    logWarn("Could not wake up MIDI stream thread");
+  }
+#endif
+}
+
+static boolByte _readMidiStreamMessages(MidiSourceStreamData self,
+                                        MidiSequence midiSequence,
+                                        unsigned long untilTimestamp,
+                                        boolByte waitForEvents) {
+  MidiStreamMessage message;
+
+  if (self->thread == NULL || self->finished) {
+    return false;
+  }
+
+  // The reader thread always ends the stream with a track end, so waiting for
+  // events can not block forever
+  while (true) {
+    message = self->nextMessage;
+    self->nextMessage = NULL;
+
+    if (message == NULL && waitForEvents) {
+      message = (MidiStreamMessage)spscQueuePopWait(self->pendingMessages);
+    } else if (message == NULL) {
+      message = (MidiStreamMessage)spscQueuePop(self->pendingMessages);
+    }
+
+    if (message == NULL) {
+      break;
+    } else if (message->midiEvent.timestamp >= untilTimestamp) {
+      self->nextMessage = message;
+      break;
+    }
+
+    // Raw events, and events which arrived too late for their block, are
+    // played as soon as possible
+    if (message->midiEvent.timestamp < self->readUntil) {
+      message->midiEvent.timestamp = self->readUntil;
+    }
+
+    appendMidiEventToSequence(midiSequence, &message->midiEvent,
+                              message->extraDataSize);
+
+    if (message == &self->endMessage) {
+      self->finished = true;
+      break;
+    }
+
+    _returnFreeMessage(self, message);
+  }
+
+  if (untilTimestamp > self->readUntil) {
+    self->readUntil = untilTimestamp;
+  }
+
+  return (boolByte)!self->finished;
+}
+
+static boolByte _readMidiEventsUntilStream(void *midiSourcePtr,
+                                           MidiSequence midiSequence,
+                                           unsigned long untilTimestamp) {
+  MidiSource midiSource = (MidiSource)midiSourcePtr;
+  MidiSourceStreamData self = (MidiSourceStreamData)midiSource->extraData;
+  // Processing waits for the events of MIDI files, so that it never gets
+  // ahead of the program which writes them
+  return _readMidiStreamMessages(self, midiSequence, untilTimestamp,
+                                 self->timestamped);
+}
+
+static boolByte _readMidiEventsStream(void *midiSourcePtr,
+                                      MidiSequence midiSequence) {
+  MidiSource midiSource = (MidiSource)midiSourcePtr;
+  MidiSourceStreamData self = (MidiSourceStreamData)midiSource->extraData;
+
+  if (self->thread == NULL) {
+    return false;
+  }
+
+  _readMidiStreamMessages(self, midiSequence, ULONG_MAX, true);
+  return self->finished;
+}
+
+static void _freeMidiSourceStreamData(void *midiSourceDataPtr) {
+  MidiSourceStreamData self = (MidiSourceStreamData)midiSourceDataPtr;
+  MidiStreamMessage message;
+
+#if UNIX
+  if (self->thread != NULL) {
+    atomicStore(&self->stopRequested, true);
+
+    if (write(self->wakeUpPipe[1], "", 1) != 1) {
+      logWarn("Could not stop MIDI stream thread");
+    }
+
+    // The reader thread may be waiting for a free message, in which case all
+    // of them are waiting to be played
+    while ((message = (MidiStreamMessage)spscQueuePop(
+                self->pendingMessages)) != NULL) {
+      if (message != &self->endMessage) {
+        spscQueuePush(self->freeMessages, message);
+      }
+    }
+
+    if (self->nextMessage != NULL && self->nextMessage != &self->endMessage) {
+      spscQueuePush(self->freeMessages, self->nextMessage);
+    }
+
+    freeThread(self->thread);
+  }
+
+  if (self->descriptor >= 0 && self->descriptor != STDIN_FILENO) {
+    close(self->descriptor);
+  }
+
+  if (self->wakeUpPipe[0] >= 0) {
+    close(self->wakeUpPipe[0]);
+    close(self->wakeUpPipe[1]);
+  }
+#endif
+
+  freeMidiTempoMap(self->tempoMap);
+  freeSpscQueue(self->freeMessages);
+  freeSpscQueue(self->pendingMessages);
+  free(self->messages);
+  free(self);
+}
+
+MidiSource newMidiSourceStream(const CharString midiSourceName) {
+  MidiSource midiSource = (MidiSource)malloc(sizeof(MidiSourceMembers));
+  MidiSourceStreamData extraData =
+      (MidiSourceStreamData)malloc(sizeof(MidiSourceStreamDataMembers));
+  unsigned int i;
+
+  midiSource->midiSourceType = MIDI_SOURCE_TYPE_STREAM;
+  midiSource->sourceName = newCharString();
+  charStringCopy(midiSource->sourceName, midiSourceName);
+
+  midiSource->openMidiSource = _openMidiSourceStream;
+  midiSource->readMidiEvents = _readMidiEventsStream;
+  midiSource->readMidiEventsUntil = _readMidiEventsUntilStream;
+  midiSource->freeMidiSourceData = _freeMidiSourceStreamData;
+
+  extraData->descriptor = -1;
+  extraData->timestamped = false;
+  extraData->bufferLength = 0;
+  extraData->headerRead = false;
+  extraData->inTrack = false;
+  extraData->bytesToSkip = 0;
+  extraData->inSysex = false;
+  extraData->runningStatus = 0;
+  extraData->timeDivision = 0;
+  extraData->currentTick = 0;
+  extraData->tempoMap = NULL;
+
+  extraData->messages = (MidiStreamMessageMembers *)malloc(
+      sizeof(MidiStreamMessageMembers) * MIDI_SOURCE_STREAM_QUEUE_CAPACITY);
+  extraData->freeMessages = newSpscQueue(MIDI_SOURCE_STREAM_QUEUE_CAPACITY);
+  // There is also room for the end message
+  extraData->pendingMessages =
+      newSpscQueue(MIDI_SOURCE_STREAM_QUEUE_CAPACITY + 1);
+
+  for (i = 0; i < MIDI_SOURCE_STREAM_QUEUE_CAPACITY; i++) {
+    spscQueuePush(extraData->freeMessages, &extraData->messages[i]);
+  }
+
+  memset(&extraData->endMessage, 0, sizeof(MidiStreamMessageMembers));
+  extraData->nextMessage = NULL;
+  extraData->readUntil = 0;
+  extraData->finished = false;
+
+  extraData->wakeUpPipe[0] = -1;
+  extraData->wakeUpPipe[1] = -1;
+  extraData->thread = NULL;
+  extraData->readerWaiting = false;
+  extraData->stopRequested = false;
+  midiSource->extraData = extraData;
+
+  return midiSource;
+}
@@ -0,0 +1,123 @@
+//
+// MidiSourceStream.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_MidiSourceStream_h
+#define MrsWatson_MidiSourceStream_h
+
+#include "base/Queue.h"
+#include "base/Thread.h"
+#include "midi/MidiSource.h"
+#include "midi/MidiTempoMap.h"
+
+#define MIDI_SOURCE_STREAM_STDIN "-"
+// Number of events which may have been received but not yet played. When the
+// queue is full, the reader thread waits for the processing thread.
+#define MIDI_SOURCE_STREAM_QUEUE_CAPACITY 1024
+#define MIDI_SOURCE_STREAM_BUFFER_SIZE 4096
+// Longest meta event which is passed on, which fits a time signature
+#define MIDI_SOURCE_STREAM_MAX_EXTRA_DATA 4
+
+typedef struct {
+  MidiEventMembers midiEvent;
+  byte extraData[MIDI_SOURCE_STREAM_MAX_EXTRA_DATA];
+  unsigned int extraDataSize;
+} MidiStreamMessageMembers;
+typedef MidiStreamMessageMembers *MidiStreamMessage;
+
+typedef struct {
+  int descriptor;
+  // True if the stream started with a MIDI file header, in which case the
+  // events have delta times
+  boolByte timestamped;
+
+  // State of the reader thread
+  byte buffer[MIDI_SOURCE_STREAM_BUFFER_SIZE];
+  unsigned long bufferLength;
+  boolByte headerRead;
+  boolByte inTrack;
+  // Number of bytes of an ignored chunk, sysex or meta event which are still
+  // to be skipped
+  unsigned long bytesToSkip;
+  boolByte inSysex;
+  byte runningStatus;
+  unsigned short timeDivision;
+  unsigned long currentTick;
+  MidiTempoMap tempoMap;
+
+  // Events are passed from the reader thread to the processing thread through
+  // a lock-free queue of preallocated messages
+  MidiStreamMessageMembers *messages;
+  SpscQueue freeMessages;
+  SpscQueue pendingMessages;
+  // Message which always ends the stream, so that the reader thread never
+  // needs to wait for a free one when it stops
+  MidiStreamMessageMembers endMessage;
+  // Message which has been received but belongs to a later block
+  MidiStreamMessage nextMessage;
+  // Timestamp up to which events have been read by the processing thread
+  unsigned long readUntil;
+  boolByte finished;
+
+  // The reader thread waits on wakeUpPipe, which is written when it is stopped
+  // or when it is waiting for a free message and the processing thread returns
+  // one
+  int wakeUpPipe[2];
+  volatile unsigned long readerWaiting;
+  Thread thread;
+  volatile unsigned long stopRequested;
+} MidiSourceStreamDataMembers;
+typedef MidiSourceStreamDataMembers *MidiSourceStreamData;
+
+/**
+ * Create a MIDI source which receives events while processing, so that another
+ * program can play an instrument without first writing a MIDI file. Events are
+ * read from stdin if the source name is "-", or otherwise from the named pipe
+ * or Unix domain socket at the given path.
+ *
+ * The stream either consists of raw MIDI bytes, as they would be sent over a
+ * MIDI cable, or of a type 0 MIDI file. Raw events have no timing, and are
+ * played at the start of the next block which is processed after they arrive.
+ * Events from a MIDI file are played at the time given by their delta times,
+ * and processing waits for the stream whenever it reaches an event which has
+ * not yet been received, so the result is the same as if the file had been
+ * read from disk. In both cases the source ends when the stream is closed.
+ *
+ * The stream is read and parsed on a separate thread, which passes the events
+ * to the processing thread through a lock-free queue.
+ * @param midiSourceName Path to read from, or "-" for stdin
+ * @return MidiSource object
+ */
+MidiSource newMidiSourceStream(const CharString midiSourceName);
+
+/**
+ * Check whether a MIDI source should be streamed, which is the case for stdin
+ * and for existing named pipes and sockets.
+ * @param midiSourceName MIDI source name
+ * @return True if the source can be read by a stream source
+ */
+boolByte isMidiSourceStream(const CharString midiSourceName);
+
+#endif
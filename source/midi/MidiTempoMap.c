@@ -0,0 +1,122 @@
+//
+// MidiTempoMap.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "MidiTempoMap.h"
+
+#include "logging/EventLogger.h"
+
+#include <stdlib.h>
+
+// Number of tempo changes which a new map has room for
+#define MIDI_TEMPO_MAP_DEFAULT_CAPACITY 16
+
+static double _getFramesPerTick(MidiTempoMap self,
+                                const double microsecondsPerBeat) {
+  return (microsecondsPerBeat / 1000000.0) * self->sampleRate /
+         (double)self->ticksPerBeat;
+}
+
+MidiTempoMap newMidiTempoMap(const unsigned short ticksPerBeat,
+                             const Tempo tempo, const SampleRate sampleRate) {
+  MidiTempoMap tempoMap = (MidiTempoMap)malloc(sizeof(MidiTempoMapMembers));
+
+  tempoMap->ticksPerBeat = ticksPerBeat;
+  tempoMap->sampleRate = sampleRate;
+  tempoMap->_segments = (MidiTempoSegmentMembers *)malloc(
+      sizeof(MidiTempoSegmentMembers) * MIDI_TEMPO_MAP_DEFAULT_CAPACITY);
+  tempoMap->_capacity = MIDI_TEMPO_MAP_DEFAULT_CAPACITY;
+  tempoMap->_numSegments = 1;
+  tempoMap->_segments[0].startTick = 0;
+  tempoMap->_segments[0].startFrame = 0.0;
+  tempoMap->_segments[0].framesPerTick =
+      _getFramesPerTick(tempoMap, 60000000.0 / tempo);
+
+  return tempoMap;
+}
+
+boolByte midiTempoMapAddTempo(MidiTempoMap self, const unsigned long tick,
+                              const unsigned long microsecondsPerBeat) {
+  MidiTempoSegmentMembers *last = &self->_segments[self->_numSegments - 1];
+  MidiTempoSegmentMembers *segment;
+
+  if (microsecondsPerBeat == 0) {
+    logWarn("Ignoring MIDI tempo change to 0 microseconds per beat");
+    return false;
+  } else if (tick < last->startTick) {
+    logInternalError("MIDI tempo changes must be added in order");
+    return false;
+  }
+
+  if (tick == last->startTick) {
+    segment = last;
+  } else {
+    if (self->_numSegments == self->_capacity) {
+      self->_capacity *= 2;
+      self->_segments = (MidiTempoSegmentMembers *)realloc(
+          self->_segments, sizeof(MidiTempoSegmentMembers) * self->_capacity);
+      last = &self->_segments[self->_numSegments - 1];
+    }
+
+    segment = &self->_segments[self->_numSegments++];
+    segment->startTick = tick;
+    segment->startFrame =
+        last->startFrame + (tick - last->startTick) * last->framesPerTick;
+  }
+
+  segment->framesPerTick =
+      _getFramesPerTick(self, (double)microsecondsPerBeat);
+  return true;
+}
+
+unsigned long midiTempoMapGetFrame(MidiTempoMap self,
+                                   const unsigned long tick) {
+  unsigned long low = 0;
+  unsigned long high = self->_numSegments;
+  unsigned long middle;
+  MidiTempoSegmentMembers *segment;
+
+  // Find the last segment which starts at or before the tick
+  while (high - low > 1) {
+    middle = low + (high - low) / 2;
+
+    if (self->_segments[middle].startTick <= tick) {
+      low = middle;
+    } else {
+      high = middle;
+    }
+  }
+
+  segment = &self->_segments[low];
+  return (unsigned long)(segment->startFrame +
+                         (tick - segment->startTick) * segment->framesPerTick);
+}
+
+void freeMidiTempoMap(MidiTempoMap self) {
+  if (self != NULL) {
+    free(self->_segments);
+    free(self);
+  }
+}
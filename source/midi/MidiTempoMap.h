@@ -0,0 +1,92 @@
+//
+// MidiTempoMap.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_MidiTempoMap_h
+#define MrsWatson_MidiTempoMap_h
+
+#include "base/Types.h"
+
+typedef struct {
+  unsigned long startTick;
+  // Frame at which the segment starts, which is the sum of the lengths of all
+  // segments before it
+  double startFrame;
+  double framesPerTick;
+} MidiTempoSegmentMembers;
+
+/**
+ * Converts times in MIDI ticks to sample frames. The map is made of segments
+ * of constant tempo, each of which knows the frame that it starts at, so that
+ * converting a tick only needs a binary search for its segment rather than a
+ * walk through every tempo change before it.
+ */
+typedef struct {
+  unsigned short ticksPerBeat;
+  SampleRate sampleRate;
+
+  // Private fields
+  MidiTempoSegmentMembers *_segments;
+  unsigned long _numSegments;
+  unsigned long _capacity;
+} MidiTempoMapMembers;
+typedef MidiTempoMapMembers *MidiTempoMap;
+
+/**
+ * Create a new tempo map
+ * @param ticksPerBeat Time division of the MIDI file
+ * @param tempo Tempo until the first tempo change, in beats per minute
+ * @param sampleRate Sample rate which frames are given in
+ * @return Initialized object
+ */
+MidiTempoMap newMidiTempoMap(const unsigned short ticksPerBeat,
+                             const Tempo tempo, const SampleRate sampleRate);
+
+/**
+ * Change the tempo from a given tick onwards. Tempo changes must be added in
+ * order, and a change at the same tick as the previous one replaces it.
+ * @param self
+ * @param tick Tick where the new tempo starts
+ * @param microsecondsPerBeat Tempo as it is given in MIDI tempo events
+ * @return False if the tempo change is before the previous one or invalid
+ */
+boolByte midiTempoMapAddTempo(MidiTempoMap self, const unsigned long tick,
+                              const unsigned long microsecondsPerBeat);
+
+/**
+ * Convert a time in ticks to sample frames
+ * @param self
+ * @param tick Time in ticks
+ * @return Time in sample frames
+ */
+unsigned long midiTempoMapGetFrame(MidiTempoMap self, const unsigned long tick);
+
+/**
+ * Free a tempo map
+ * @param self
+ */
+void freeMidiTempoMap(MidiTempoMap self);
+
+#endif
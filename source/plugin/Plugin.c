@@ -192,6 +192,27 @@ boolByte closePlugin(Plugin self) {
   return true;
 }
 
+boolByte pluginSetNumChannels(Plugin self, ChannelCount numInputs,
+                              ChannelCount numOutputs) {
+  if (self == NULL || !self->isOpen) {
+    return false;
+  } else if (self->inputBuffer->numChannels == numInputs &&
+             self->outputBuffer->numChannels == numOutputs) {
+    return true;
+  } else if (self->setNumChannels == NULL ||
+             !self->setNumChannels(self, numInputs, numOutputs)) {
+    return false;
+  }
+
+  logDebug("Plugin '%s' now has %d inputs and %d outputs",
+           self->pluginName->data, numInputs, numOutputs);
+  freeSampleBuffer(self->inputBuffer);
+  self->inputBuffer = newSampleBuffer(numInputs, getBlocksize());
+  freeSampleBuffer(self->outputBuffer);
+  self->outputBuffer = newSampleBuffer(numOutputs, getBlocksize());
+  return true;
+}
+
 Plugin _newPlugin(PluginInterfaceType interfaceType, PluginType pluginType) {
   Plugin plugin = (Plugin)malloc(sizeof(PluginMembers));
 
@@ -201,6 +222,7 @@ Plugin _newPlugin(PluginInterfaceType interfaceType, PluginType pluginType) {
   plugin->pluginLocation = newCharString();
   plugin->pluginAbsolutePath = newCharString();
 
+  plugin->setNumChannels = NULL;
   plugin->inputBuffer = NULL;
   plugin->outputBuffer = NULL;
   plugin->isOpen = false;
@@ -208,6 +230,11 @@ Plugin _newPlugin(PluginInterfaceType interfaceType, PluginType pluginType) {
   return plugin;
 }
 
+boolByte _pluginAcceptAnyNumChannels(void *pluginPtr, ChannelCount numInputs,
+                                     ChannelCount numOutputs) {
+  return true;
+}
+
 void freePlugin(Plugin self) {
   if (self != NULL) {
     if (self->extraData != NULL) {
@@ -38,11 +38,17 @@ extern "C" {
 // All internal plugins should start with this string
 #define INTERNAL_PLUGIN_PREFIX "mrs_"
 
+// Longest tail time which is rendered after the input. Longer tails, and the
+// "infinite" tails which some plugins report, are cut to this length.
+#define MAX_PLUGIN_TAIL_TIME_IN_MS 30000
+
 typedef enum {
   PLUGIN_TYPE_INVALID,
   PLUGIN_TYPE_VST_2X,  // Deprecated - use VST3 instead
   PLUGIN_TYPE_VST_3,
   PLUGIN_TYPE_INTERNAL,
+  PLUGIN_TYPE_ISOLATED, // Hosted in a separate process, see PluginIsolated.h
+  PLUGIN_TYPE_GROUP,    // Parallel plugin chains, see PluginGroup.h
   NUM_PLUGIN_INTERFACE_TYPES
 } PluginInterfaceType;
 
@@ -128,6 +134,30 @@ typedef boolByte (*PluginSetParameterFunc)(void *pluginPtr, unsigned int index,
  */
 typedef void (*PluginPrepareForProcessingFunc)(void *pluginPtr);
 
+/**
+ * Called between two unrelated streams of audio, such as separate input files.
+ * The plugin should clear any internal processing state (delay lines, filter
+ * history, sounding voices, etc.) but keep its parameters and loaded program,
+ * so that the next stream is processed as if the plugin had just been opened.
+ * @param pluginPtr self
+ */
+typedef void (*PluginResetFunc)(void *pluginPtr);
+
+/**
+ * Called when the host would like the plugin to use a different number of
+ * channels, for example to process a mono stream without expanding it to
+ * stereo. This is only called while the plugin is open. The plugin should
+ * reconfigure itself and return true if it supports the requested layout, or
+ * else keep its current layout and return false. Plugins which do not support
+ * changing their layout may leave this function NULL.
+ * @param pluginPtr self
+ * @param numInputs Requested number of input channels
+ * @param numOutputs Requested number of output channels
+ */
+typedef boolByte (*PluginSetNumChannelsFunc)(void *pluginPtr,
+                                             ChannelCount numInputs,
+                                             ChannelCount numOutputs);
+
 /**
  * Called when the plugin should show its GUI editor.
  * @param pluginPtr self
@@ -160,6 +190,8 @@ typedef struct {
   PluginProcessMidiEventsFunc processMidiEvents;
   PluginSetParameterFunc setParameter;
   PluginPrepareForProcessingFunc prepareForProcessing;
+  PluginResetFunc resetPlugin;
+  PluginSetNumChannelsFunc setNumChannels;
   PluginShowEditorFunc showEditor;
   PluginCloseFunc closePlugin;
   FreePluginDataFunc freePluginData;
@@ -204,6 +236,17 @@ boolByte openPlugin(Plugin self);
  */
 boolByte closePlugin(Plugin self);
 
+/**
+ * Ask an open plugin to change its number of channels. If the plugin accepts
+ * the new layout, then its input and output buffers are resized to match.
+ * @param self
+ * @param numInputs Requested number of input channels
+ * @param numOutputs Requested number of output channels
+ * @return True if the plugin now uses the requested number of channels
+ */
+boolByte pluginSetNumChannels(Plugin self, ChannelCount numInputs,
+                              ChannelCount numOutputs);
+
 /**
 * Create a new plugin. Considered "protected", only subclasses of Plugin should
 * directly call this.
@@ -213,6 +256,18 @@ boolByte closePlugin(Plugin self);
 */
 Plugin _newPlugin(PluginInterfaceType interfaceType, PluginType pluginType);
 
+/**
+ * Channel setter for plugins which process each channel independently, and can
+ * therefore use any number of channels. Considered "protected", only
+ * subclasses of Plugin should directly use this.
+ * @param pluginPtr self
+ * @param numInputs Requested number of input channels
+ * @param numOutputs Requested number of output channels
+ * @return Always true
+ */
+boolByte _pluginAcceptAnyNumChannels(void *pluginPtr, ChannelCount numInputs,
+                                     ChannelCount numOutputs);
+
 /**
  * Release a plugin and all of its associated resources. Note that the plugin
  * must be closed before this is called, or else resources will be leaked.
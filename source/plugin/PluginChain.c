@@ -28,6 +28,9 @@
 
 #include "audio/AudioSettings.h"
 #include "logging/EventLogger.h"
+#include "plugin/PluginGroup.h"
+#include "plugin/PluginIsolated.h"
+#include "plugin/ProcessingContext.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -35,24 +38,38 @@
 
 PluginChain pluginChainInstance = NULL;
 
-PluginChain getPluginChain(void) { return pluginChainInstance; }
+PluginChain getPluginChain(void) {
+  ProcessingContext context = getProcessingContext();
 
-void initPluginChain(void) {
-  pluginChainInstance = (PluginChain)malloc(sizeof(PluginChainMembers));
+  if (context != NULL && context->pluginChain != NULL) {
+    return (PluginChain)context->pluginChain;
+  }
+
+  return pluginChainInstance;
+}
 
-  pluginChainInstance->numPlugins = 0;
-  pluginChainInstance->plugins = (Plugin *)malloc(sizeof(Plugin) * MAX_PLUGINS);
-  pluginChainInstance->presets =
+PluginChain newPluginChain(void) {
+  PluginChain pluginChain = (PluginChain)malloc(sizeof(PluginChainMembers));
+
+  pluginChain->numPlugins = 0;
+  pluginChain->plugins = (Plugin *)malloc(sizeof(Plugin) * MAX_PLUGINS);
+  pluginChain->presets =
       (PluginPreset *)malloc(sizeof(PluginPreset) * MAX_PLUGINS);
-  pluginChainInstance->audioTimers =
+  pluginChain->audioTimers =
       (TaskTimer *)malloc(sizeof(TaskTimer) * MAX_PLUGINS);
-  pluginChainInstance->midiTimers =
+  pluginChain->midiTimers =
       (TaskTimer *)malloc(sizeof(TaskTimer) * MAX_PLUGINS);
 
-  pluginChainInstance->_realtime = false;
-  pluginChainInstance->_realtimeTimer = NULL;
+  pluginChain->_realtime = false;
+  pluginChain->_realtimeScheduler = NULL;
+  pluginChain->_numPipelineStages = 0;
+  pluginChain->_pipeline = NULL;
+  pluginChain->_numChannels = 0;
+  return pluginChain;
 }
 
+void initPluginChain(void) { pluginChainInstance = newPluginChain(); }
+
 boolByte pluginChainAppend(PluginChain self, Plugin plugin,
                            PluginPreset preset) {
   if (plugin == NULL) {
@@ -75,59 +92,121 @@ boolByte pluginChainAppend(PluginChain self, Plugin plugin,
   }
 }
 
-boolByte pluginChainAddFromArgumentString(PluginChain pluginChain,
-                                          const CharString argumentString,
-                                          const CharString userSearchPath) {
-  // Expect a semicolon-separated string of plugins with comma separators for
-  // preset names
-  // Example: plugin1,preset1name;plugin2,preset2name
-  char *substringStart;
-  char *pluginSeparator;
-  char *endChar;
-  CharString pluginNameBuffer = NULL;
-  CharString presetNameBuffer = NULL;
-  char *presetSeparator;
-  PluginPreset preset;
-  Plugin plugin;
+LinkedList pluginChainSplitArgumentString(const CharString argumentString,
+                                          const char separator) {
+  LinkedList result = newLinkedList();
+  CharString item;
+  const char *substringStart = argumentString->data;
+  const char *currentChar;
   size_t substringLength;
+  int depth = 0;
 
-  if (charStringIsEmpty(argumentString)) {
-    logWarn("Plugin chain string is empty");
-    return false;
-  }
+  for (currentChar = argumentString->data;; currentChar++) {
+    if (*currentChar == CHAIN_STRING_GROUP_START) {
+      depth++;
+    } else if (*currentChar == CHAIN_STRING_GROUP_END) {
+      depth--;
+    }
+
+    if (depth < 0) {
+      break;
+    } else if (*currentChar == '\0' ||
+               (*currentChar == separator && depth == 0)) {
+      substringLength = currentChar - substringStart;
+
+      if (substringLength > 0) {
+        item = newCharStringWithCapacity(substringLength + 1);
+        strncpy(item->data, substringStart, substringLength);
+        linkedListAppend(result, item);
+      }
 
-  substringStart = argumentString->data;
-  pluginSeparator = strchr(argumentString->data, CHAIN_STRING_PLUGIN_SEPARATOR);
-  endChar = argumentString->data + strlen(argumentString->data);
+      if (*currentChar == '\0') {
+        break;
+      }
 
-  do {
-    if (pluginSeparator == NULL) {
-      substringLength = strlen(argumentString->data);
-    } else {
-      substringLength = pluginSeparator - substringStart;
+      substringStart = currentChar + 1;
     }
+  }
+
+  if (depth != 0) {
+    logError("Unbalanced brackets in plugin chain string '%s'",
+             argumentString->data);
+    freeLinkedListAndItems(result, (LinkedListFreeItemFunc)freeCharString);
+    return NULL;
+  }
+
+  return result;
+}
+
+static Plugin _newPluginGroupFromString(const CharString pluginString,
+                                        const CharString userSearchPath) {
+  CharString groupString;
+  size_t length = strlen(pluginString->data);
+  Plugin plugin;
+
+  if (pluginString->data[length - 1] != CHAIN_STRING_GROUP_END) {
+    logError("Plugin group '%s' must end with '%c'", pluginString->data,
+             CHAIN_STRING_GROUP_END);
+    return NULL;
+  }
+
+  groupString = newCharStringWithCapacity(length);
+  strncpy(groupString->data, pluginString->data + 1, length - 2);
+  plugin = newPluginGroup(groupString, userSearchPath);
+  freeCharString(groupString);
+  return plugin;
+}
+
+static boolByte _addFromPluginString(PluginChain pluginChain,
+                                     const CharString pluginString,
+                                     const CharString userSearchPath) {
+  CharString pluginNameBuffer;
+  CharString presetNameBuffer;
+  CharString isolatedNameBuffer;
+  char *presetSeparator;
+  PluginPreset preset = NULL;
+  Plugin plugin;
+  boolByte result = true;
 
-    freeCharString(pluginNameBuffer);
-    pluginNameBuffer = newCharString();
-    strncpy(pluginNameBuffer->data, substringStart, substringLength);
-
-    // Look for the separator for presets to load into these plugins
-    freeCharString(presetNameBuffer);
-    presetNameBuffer = newCharString();
-    presetSeparator =
-        strchr(pluginNameBuffer->data, CHAIN_STRING_PROGRAM_SEPARATOR);
-
-    if (presetSeparator != NULL) {
-      // Null-terminate this string to force it to end, then extract preset name
-      // from next char
-      *presetSeparator = '\0';
-      strncpy(presetNameBuffer->data, presetSeparator + 1,
-              strlen(presetSeparator + 1));
+  // Groups may contain preset separators of their own, so they are not split
+  if (pluginString->data[0] == CHAIN_STRING_GROUP_START) {
+    plugin = _newPluginGroupFromString(pluginString, userSearchPath);
+
+    if (plugin == NULL) {
+      return false;
+    } else if (!pluginChainAppend(pluginChain, plugin, NULL)) {
+      logError("Plugin group '%s' could not be added to the chain",
+               pluginString->data);
+      freePlugin(plugin);
+      return false;
     }
 
-    // Find preset for this plugin (if given)
-    preset = NULL;
+    return true;
+  }
+
+  pluginNameBuffer = newCharStringWithCString(pluginString->data);
+  presetNameBuffer = newCharStringWithCapacity(pluginNameBuffer->capacity);
+
+  // Look for the separator for presets to load into these plugins
+  presetSeparator =
+      strchr(pluginNameBuffer->data, CHAIN_STRING_PROGRAM_SEPARATOR);
+
+  if (presetSeparator != NULL) {
+    // Null-terminate this string to force it to end, then extract preset name
+    // from next char
+    *presetSeparator = '\0';
+    strncpy(presetNameBuffer->data, presetSeparator + 1,
+            strlen(presetSeparator + 1));
+  }
 
+  if (pluginNameBuffer->data[0] == CHAIN_STRING_ISOLATED_PLUGIN_PREFIX) {
+    // Both the plugin and its preset are loaded by the worker process
+    isolatedNameBuffer = newCharStringWithCString(pluginNameBuffer->data + 1);
+    plugin = newPluginIsolated(isolatedNameBuffer, userSearchPath,
+                               presetNameBuffer);
+    freeCharString(isolatedNameBuffer);
+  } else {
+    // Find preset for this plugin (if given)
     if (strlen(presetNameBuffer->data) > 0) {
       logInfo("Opening preset '%s' for plugin", presetNameBuffer->data);
       preset = pluginPresetFactory(presetNameBuffer);
@@ -135,29 +214,56 @@ boolByte pluginChainAddFromArgumentString(PluginChain pluginChain,
 
     // Guess the plugin type from the file extension, search root, etc.
     plugin = pluginFactory(pluginNameBuffer, userSearchPath);
+  }
 
-    if (plugin != NULL) {
-      if (!pluginChainAppend(pluginChain, plugin, preset)) {
-        logError("Plugin '%s' could not be added to the chain",
-                 pluginNameBuffer->data);
-        freeCharString(pluginNameBuffer);
-        freeCharString(presetNameBuffer);
-        return false;
-      }
+  if (plugin != NULL) {
+    if (!pluginChainAppend(pluginChain, plugin, preset)) {
+      logError("Plugin '%s' could not be added to the chain",
+               pluginNameBuffer->data);
+      result = false;
     }
+  }
 
-    if (pluginSeparator == NULL) {
+  freeCharString(pluginNameBuffer);
+  freeCharString(presetNameBuffer);
+  return result;
+}
+
+boolByte pluginChainAddFromArgumentString(PluginChain pluginChain,
+                                          const CharString argumentString,
+                                          const CharString userSearchPath) {
+  // Expect a semicolon-separated string of plugins with comma separators for
+  // preset names, where a group of parallel branches in brackets counts as a
+  // single plugin
+  // Example: plugin1,preset1name;[plugin2|plugin3;plugin4];plugin5
+  LinkedList pluginStrings;
+  LinkedListIterator iterator;
+  boolByte result = true;
+
+  if (charStringIsEmpty(argumentString)) {
+    logWarn("Plugin chain string is empty");
+    return false;
+  }
+
+  pluginStrings = pluginChainSplitArgumentString(
+      argumentString, CHAIN_STRING_PLUGIN_SEPARATOR);
+
+  if (pluginStrings == NULL) {
+    return false;
+  }
+
+  for (iterator = pluginStrings; iterator != NULL && iterator->item != NULL;
+       iterator = iterator->nextItem) {
+    if (!_addFromPluginString(pluginChain, (CharString)iterator->item,
+                              userSearchPath)) {
+      result = false;
       break;
-    } else {
-      substringStart = pluginSeparator + 1;
-      pluginSeparator =
-          strchr(pluginSeparator + 1, CHAIN_STRING_PLUGIN_SEPARATOR);
     }
-  } while (substringStart < endChar);
+  }
 
-  freeCharString(pluginNameBuffer);
-  freeCharString(presetNameBuffer);
-  return true;
+  freeLinkedListAndItems(pluginStrings,
+                         (LinkedListFreeItemFunc)freeCharString);
+  return result;
 }
 
 static boolByte _loadPresetForPlugin(Plugin plugin, PluginPreset preset) {
@@ -232,14 +338,102 @@ void pluginChainInspect(PluginChain pluginChain) {
   }
 }
 
+static void _startPipeline(PluginChain self) {
+  if (self->_numPipelineStages > 0 && self->numPlugins > 0) {
+    self->_pipeline =
+        newPluginChainPipeline(self->plugins, self->audioTimers,
+                               self->midiTimers, self->numPlugins,
+                               self->_numPipelineStages);
+    logDebug("Processing plugin chain in %d pipeline stages",
+             self->_pipeline->numStages);
+  }
+}
+
+static void _stopPipeline(PluginChain self) {
+  freePluginChainPipeline(self->_pipeline);
+  self->_pipeline = NULL;
+}
+
+void pluginChainSetNumChannels(PluginChain self, ChannelCount numChannels) {
+  self->_numChannels = numChannels;
+}
+
+static void _negotiateNumChannels(PluginChain self) {
+  ChannelCount numChannels =
+      self->_numChannels > 0 ? self->_numChannels : getNumChannels();
+  ChannelCount numInputs;
+  Plugin plugin;
+  unsigned int i;
+
+  for (i = 0; i < self->numPlugins; i++) {
+    plugin = self->plugins[i];
+    numInputs = plugin->inputBuffer->numChannels;
+
+    if (numInputs > numChannels ||
+        plugin->outputBuffer->numChannels > numChannels) {
+      // Instruments without inputs keep them that way
+      pluginSetNumChannels(plugin, numInputs > 0 ? numChannels : 0,
+                           numChannels);
+    }
+
+    // If the plugin was not narrowed, then the following plugins receive its
+    // wider output
+    numChannels = plugin->outputBuffer->numChannels;
+  }
+}
+
+// Plugins allocate their buffers when they are opened, which happens on the
+// main thread. They are allocated again by the thread which prepares the chain,
+// so that on NUMA systems they are local to the thread which processes it.
+static void _reallocatePluginBuffers(PluginChain self) {
+  Plugin plugin;
+  ChannelCount numInputs;
+  ChannelCount numOutputs;
+  unsigned int i;
+
+  for (i = 0; i < self->numPlugins; i++) {
+    plugin = self->plugins[i];
+    numInputs = plugin->inputBuffer->numChannels;
+    numOutputs = plugin->outputBuffer->numChannels;
+    freeSampleBuffer(plugin->inputBuffer);
+    plugin->inputBuffer = newSampleBuffer(numInputs, getBlocksize());
+    freeSampleBuffer(plugin->outputBuffer);
+    plugin->outputBuffer = newSampleBuffer(numOutputs, getBlocksize());
+  }
+}
+
 void pluginChainPrepareForProcessing(PluginChain self) {
   Plugin plugin;
   unsigned int i;
 
+  // The pipeline stages hold the plugin buffers, which may be resized here
+  _stopPipeline(self);
+  _negotiateNumChannels(self);
+  _reallocatePluginBuffers(self);
+
   for (i = 0; i < self->numPlugins; i++) {
     plugin = self->plugins[i];
     plugin->prepareForProcessing(plugin);
   }
+
+  _startPipeline(self);
+}
+
+void pluginChainReset(PluginChain self) {
+  Plugin plugin;
+  unsigned int i;
+
+  // The pipeline is restarted so that the stages are rebalanced with the time
+  // measured while rendering the previous stream
+  _stopPipeline(self);
+
+  for (i = 0; i < self->numPlugins; i++) {
+    plugin = self->plugins[i];
+    logDebug("Resetting plugin '%s'", plugin->pluginName->data);
+    plugin->resetPlugin(plugin);
+  }
+
+  _startPipeline(self);
 }
 
 int pluginChainGetMaximumTailTimeInMs(PluginChain pluginChain) {
@@ -252,6 +446,12 @@ int pluginChainGetMaximumTailTimeInMs(PluginChain pluginChain) {
     plugin = pluginChain->plugins[i];
     tailTime = plugin->getSetting(plugin, PLUGIN_SETTING_TAIL_TIME_IN_MS);
 
+    if (tailTime < 0 || tailTime > MAX_PLUGIN_TAIL_TIME_IN_MS) {
+      logWarn("Plugin '%s' has a tail time of %d ms, using %d ms instead",
+              plugin->pluginName->data, tailTime, MAX_PLUGIN_TAIL_TIME_IN_MS);
+      tailTime = MAX_PLUGIN_TAIL_TIME_IN_MS;
+    }
+
     if (tailTime > maxTailTime) {
       maxTailTime = tailTime;
     }
@@ -260,6 +460,11 @@ int pluginChainGetMaximumTailTimeInMs(PluginChain pluginChain) {
   return maxTailTime;
 }
 
+unsigned long pluginChainGetTailFrames(PluginChain self) {
+  return (unsigned long)(pluginChainGetMaximumTailTimeInMs(self) *
+                         getSampleRate() / 1000.0);
+}
+
 unsigned long pluginChainGetProcessingDelay(PluginChain self) {
   unsigned long processingDelay = 0;
   unsigned int i;
@@ -269,6 +474,12 @@ unsigned long pluginChainGetProcessingDelay(PluginChain self) {
     processingDelay += plugin->getSetting(plugin, PLUGIN_INITIAL_DELAY);
   }
 
+  if (self->_numPipelineStages > 0) {
+    processingDelay += pluginChainPipelineGetNumStages(
+                           self->numPlugins, self->_numPipelineStages) *
+                       getBlocksize();
+  }
+
   return processingDelay;
 }
 
@@ -303,7 +514,8 @@ void _pluginChainSetParameter(void *item, void *userData) {
     return;
   }
 
-  *comma = '\0';
+  // The parameter string is left intact, since the same list may be applied to
+  // several chains
   index = (int)strtod(parameterValue, NULL);
   value = (float)strtod(comma + 1, NULL);
   logDebug("Set parameter %d to %f", index, value);
@@ -323,24 +535,33 @@ boolByte pluginChainSetParameters(PluginChain self,
 void pluginChainSetRealtime(PluginChain self, boolByte realtime) {
   self->_realtime = realtime;
 
-  if (realtime) {
-    self->_realtimeTimer = newTaskTimerWithCString("PluginChain", "Realtime");
-  } else if (self->_realtimeTimer) {
-    freeTaskTimer(self->_realtimeTimer);
+  if (realtime && self->_realtimeScheduler == NULL) {
+    self->_realtimeScheduler = newRealtimeScheduler();
+  } else if (!realtime) {
+    freeRealtimeScheduler(self->_realtimeScheduler);
+    self->_realtimeScheduler = NULL;
   }
 }
 
+void pluginChainSetPipelineStages(PluginChain self, unsigned int numStages) {
+  self->_numPipelineStages = numStages;
+}
+
 void pluginChainProcessAudio(PluginChain pluginChain, SampleBuffer inBuffer,
                              SampleBuffer outBuffer) {
   Plugin plugin;
   unsigned int i;
   double processingTimeInMs;
-  double totalProcessingTimeInMs;
   const double maxProcessingTimeInMs =
       inBuffer->blocksize * 1000.0 / getSampleRate();
 
+  if (pluginChain->_pipeline != NULL) {
+    pluginChainPipelineProcess(pluginChain->_pipeline, inBuffer, outBuffer);
+    return;
+  }
+
   if (pluginChain->_realtime) {
-    taskTimerStart(pluginChain->_realtimeTimer);
+    realtimeSchedulerBeginBlock(pluginChain->_realtimeScheduler);
   }
 
   SampleBuffer formerOutputBuffer = inBuffer;
@@ -376,32 +597,57 @@ void pluginChainProcessAudio(PluginChain pluginChain, SampleBuffer inBuffer,
   sampleBufferCopyAndMapChannels(nextInputBuffer, formerOutputBuffer);
 
   if (pluginChain->_realtime) {
-    totalProcessingTimeInMs = taskTimerStop(pluginChain->_realtimeTimer);
-
-    if (totalProcessingTimeInMs < maxProcessingTimeInMs) {
-      taskTimerSleep(maxProcessingTimeInMs - totalProcessingTimeInMs);
-    }
+    realtimeSchedulerEndBlock(pluginChain->_realtimeScheduler,
+                              outBuffer->blocksize);
   }
 }
 
 void pluginChainProcessMidi(PluginChain pluginChain, LinkedList midiEvents) {
-  Plugin plugin;
+  // Right now, we only process MIDI in the first plugin in the chain
+  // TODO: Is this really the correct behavior? How do other sequencers do it?
+  pluginChainProcessPluginMidi(pluginChain, 0, midiEvents);
+}
+
+void pluginChainProcessPluginMidi(PluginChain self, unsigned int pluginIndex,
+                                  LinkedList midiEvents) {
+  Plugin plugin = self->plugins[pluginIndex];
 
-  if (midiEvents->item != NULL) {
-    logDebug("Processing plugin chain MIDI events");
-    // Right now, we only process MIDI in the first plugin in the chain
-    // TODO: Is this really the correct behavior? How do other sequencers do it?
-    plugin = pluginChain->plugins[0];
-    taskTimerStart(pluginChain->midiTimers[0]);
+  if (self->_pipeline != NULL) {
+    pluginChainPipelineProcessMidi(self->_pipeline, pluginIndex, midiEvents);
+  } else if (midiEvents->item != NULL) {
+    logDebug("Processing MIDI events with plugin '%s'",
+             plugin->pluginName->data);
+    taskTimerStart(self->midiTimers[pluginIndex]);
     plugin->processMidiEvents(plugin, midiEvents);
-    taskTimerStop(pluginChain->midiTimers[0]);
+    taskTimerStop(self->midiTimers[pluginIndex]);
   }
 }
 
+boolByte pluginChainSetPluginParameter(PluginChain self,
+                                       unsigned int pluginIndex,
+                                       unsigned int parameterIndex,
+                                       float value) {
+  Plugin plugin = self->plugins[pluginIndex];
+
+  if (self->_pipeline != NULL) {
+    pluginChainPipelineSetParameter(self->_pipeline, pluginIndex,
+                                    parameterIndex, value);
+    return true;
+  }
+
+  return plugin->setParameter(plugin, parameterIndex, value);
+}
+
 void pluginChainShutdown(PluginChain pluginChain) {
   Plugin plugin;
   unsigned int i;
 
+  _stopPipeline(pluginChain);
+
+  if (pluginChain->_realtime) {
+    realtimeSchedulerLogStatistics(pluginChain->_realtimeScheduler);
+  }
+
   for (i = 0; i < pluginChain->numPlugins; i++) {
     plugin = pluginChain->plugins[i];
     logInfo("Closing plugin '%s'", plugin->pluginName->data);
@@ -413,6 +659,8 @@ void freePluginChain(PluginChain pluginChain) {
   if (pluginChain != NULL) {
     unsigned int i;
 
+    _stopPipeline(pluginChain);
+
     for (i = 0; i < pluginChain->numPlugins; i++) {
       freePluginPreset(pluginChain->presets[i]);
       freePlugin(pluginChain->plugins[i]);
@@ -425,10 +673,7 @@ void freePluginChain(PluginChain pluginChain) {
     free(pluginChain->audioTimers);
     free(pluginChain->midiTimers);
 
-    if (pluginChain->_realtime) {
-      freeTaskTimer(pluginChain->_realtimeTimer);
-    }
-
+    freeRealtimeScheduler(pluginChain->_realtimeScheduler);
     free(pluginChain);
   }
 }
@@ -30,12 +30,20 @@
 #include "app/ReturnCodes.h"
 #include "base/LinkedList.h"
 #include "plugin/Plugin.h"
+#include "plugin/PluginChainPipeline.h"
 #include "plugin/PluginPreset.h"
+#include "time/RealtimeScheduler.h"
 #include "time/TaskTimer.h"
 
 #define MAX_PLUGINS 8
 #define CHAIN_STRING_PLUGIN_SEPARATOR ';'
 #define CHAIN_STRING_PROGRAM_SEPARATOR ','
+// Plugins starting with this character are hosted in a separate process
+#define CHAIN_STRING_ISOLATED_PLUGIN_PREFIX '@'
+// Parallel branches are enclosed in brackets and separated with this character
+#define CHAIN_STRING_GROUP_START '['
+#define CHAIN_STRING_GROUP_END ']'
+#define CHAIN_STRING_BRANCH_SEPARATOR '|'
 
 typedef struct {
   unsigned int numPlugins;
@@ -46,7 +54,11 @@ typedef struct {
 
   // Private fields
   boolByte _realtime;
-  TaskTimer _realtimeTimer;
+  RealtimeScheduler _realtimeScheduler;
+  unsigned int _numPipelineStages;
+  PluginChainPipeline _pipeline;
+  // Number of channels which enter the chain, or 0 to use the audio settings
+  ChannelCount _numChannels;
 } PluginChainMembers;
 
 /**
@@ -56,9 +68,11 @@ typedef struct {
 typedef PluginChainMembers *PluginChain;
 
 /**
- * Get a reference to the global plugin chain instance.
- * @return Reference to global plugin chain, or NULL if the global instance has
- * not yet been initialized.
+ * Get a reference to the plugin chain which is processed by the calling
+ * thread, which is the global plugin chain instance unless the thread has a
+ * processing context with its own chain.
+ * @return Reference to plugin chain, or NULL if the global instance has not yet
+ * been initialized.
  */
 PluginChain getPluginChain(void);
 
@@ -68,6 +82,14 @@ PluginChain getPluginChain(void);
  */
 void initPluginChain(void);
 
+/**
+ * Create a plugin chain which is independent of the global instance, for
+ * example to render several chain variants at the same time.
+ * @return Empty plugin chain, which the caller must free with
+ * freePluginChain()
+ */
+PluginChain newPluginChain(void);
+
 /**
  * Append a plugin to the end of the chain
  * @param self
@@ -79,6 +101,18 @@ void initPluginChain(void);
 boolByte pluginChainAppend(PluginChain self, Plugin plugin,
                            PluginPreset preset);
 
+/**
+ * Split a plugin chain string, ignoring any separators which are inside of a
+ * group of parallel branches.
+ * @param argumentString String to split
+ * @param separator Separator character, normally CHAIN_STRING_PLUGIN_SEPARATOR
+ * or CHAIN_STRING_BRANCH_SEPARATOR
+ * @return List of CharStrings, which does not include empty strings, or NULL if
+ * the group brackets in the string are unbalanced
+ */
+LinkedList pluginChainSplitArgumentString(const CharString argumentString,
+                                          const char separator);
+
 // TODO: Deprecate and remove this function
 boolByte pluginChainAddFromArgumentString(PluginChain self,
                                           const CharString argumentString,
@@ -100,12 +134,19 @@ void pluginChainInspect(PluginChain self);
 /**
  * Get the maximum amount of tail time (post*processing time with empty input)
  * needed for the chain. This is essentially the largest tail time value for any
- * plug-in in the chain.
+ * plug-in in the chain. Tail times are limited to MAX_PLUGIN_TAIL_TIME_IN_MS.
  * @param self
  * @return Maximum tail time, in milliseconds
  */
 int pluginChainGetMaximumTailTimeInMs(PluginChain self);
 
+/**
+ * Get the maximum tail time of the chain in frames at the current sample rate.
+ * @param self
+ * @return Number of frames which the chain needs to render its tail
+ */
+unsigned long pluginChainGetTailFrames(PluginChain self);
+
 /**
  * Get the total processing delay in frames.
  * @param self
@@ -124,20 +165,70 @@ boolByte pluginChainSetParameters(PluginChain self,
 
 /**
  * Set realtime mode for the plugin chain. When set, calls to
- * pluginChainProcessAudio()
- * will sleep for the additional time required to process the block in realtime.
+ * pluginChainProcessAudio() are paced by a RealtimeScheduler, which sleeps
+ * until the time at which an audio device would need the block and counts the
+ * blocks which miss that deadline. The statistics are logged when the chain is
+ * shut down.
  * @param realtime True to enable realtime mode, false to disable (default)
  * @param self
  */
 void pluginChainSetRealtime(PluginChain self, boolByte realtime);
 
+/**
+ * Process the plugins of the chain in a pipeline, where each stage of the
+ * pipeline runs on its own thread. This can speed up offline rendering of
+ * chains with several expensive plugins by up to the number of stages, but it
+ * delays the output by one block per stage. That delay is included in
+ * pluginChainGetProcessingDelay(). Pipelining should not be combined with
+ * realtime mode.
+ *
+ * Consecutive plugins are grouped into stages based on how much processing
+ * time they have needed so far, so the stages are rebalanced each time that
+ * pluginChainReset() is called.
+ *
+ * This must be called after all plugins have been added, and before
+ * pluginChainPrepareForProcessing().
+ * @param self
+ * @param numStages Number of stages, which is limited to the number of plugins
+ * in the chain, or 0 to process the plugins serially (default)
+ */
+void pluginChainSetPipelineStages(PluginChain self, unsigned int numStages);
+
+/**
+ * Set the number of channels which are sent to the chain. By default this is
+ * the number of channels in the audio settings. This must be called before
+ * pluginChainPrepareForProcessing().
+ * @param self
+ * @param numChannels Number of channels, or 0 to use the audio settings
+ */
+void pluginChainSetNumChannels(PluginChain self, ChannelCount numChannels);
+
 /**
  * Prepare each plugin in the chain for processing. This should be called before
  * the first block of audio is sent to the chain.
+ *
+ * Before the plugins are prepared, each one is asked to use the number of
+ * channels which reach it, if it is wider than that. For example, a mono input
+ * is processed in mono throughout the chain as long as each plugin supports
+ * it, and it is only expanded to more channels by the first plugin which does
+ * not, or when it is copied to the output. Plugins are never asked to become
+ * wider than they are.
+ *
+ * The plugin buffers, and the pipeline's blocks if the chain is pipelined, are
+ * allocated by the calling thread. To keep them local to one NUMA node, this
+ * should be called from the thread which will process the chain.
  * @param self
  */
 void pluginChainPrepareForProcessing(PluginChain self);
 
+/**
+ * Reset the processing state of each plugin in the chain, so that it can be
+ * reused to process another, unrelated stream of audio without reloading the
+ * plugins. Parameters and programs are not changed.
+ * @param self
+ */
+void pluginChainReset(PluginChain self);
+
 /**
  * Process a single block of samples through each plugin in the chain.
  * @param self
@@ -155,6 +246,38 @@ void pluginChainProcessAudio(PluginChain self, SampleBuffer inBuffer,
  */
 void pluginChainProcessMidi(PluginChain self, LinkedList midiEvents);
 
+/**
+ * Send a list of MIDI events to one plugin in the chain. Like
+ * pluginChainProcessMidi(), this must be called by the thread which processes
+ * the chain, before the audio for the block. Some plugins, such as VST 2.x
+ * ones, only keep the events of the last call, so each plugin should receive
+ * all of its events for a block at once. If the chain is pipelined, the events
+ * are copied and sent along with the next block, so that they are processed by
+ * the same thread as the plugin's audio.
+ * @param self
+ * @param pluginIndex Index of the plugin, which must be in the chain
+ * @param midiEvents List of events to process
+ */
+void pluginChainProcessPluginMidi(PluginChain self, unsigned int pluginIndex,
+                                  LinkedList midiEvents);
+
+/**
+ * Set a parameter of one plugin in the chain while it is processing. This
+ * must be called by the thread which processes the chain, between blocks. If
+ * the chain is pipelined, the change is sent along with the next block, and
+ * applied by the thread which processes the plugin right before that block.
+ * @param self
+ * @param pluginIndex Index of the plugin, which must be in the chain
+ * @param parameterIndex Index of the parameter
+ * @param value New value of the parameter
+ * @return True if the parameter was set. Changes to a pipelined chain are
+ * always accepted, since they are only applied later.
+ */
+boolByte pluginChainSetPluginParameter(PluginChain self,
+                                       unsigned int pluginIndex,
+                                       unsigned int parameterIndex,
+                                       float value);
+
 /**
  * Close all plugins in the chain
  * @param self
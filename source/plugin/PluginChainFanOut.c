@@ -0,0 +1,297 @@
+//
+// PluginChainFanOut.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "PluginChainFanOut.h"
+
+#include "audio/AudioSettings.h"
+#include "logging/EventLogger.h"
+
+#include <stdlib.h>
+
+PluginChainFanOut newPluginChainFanOut(void) {
+  PluginChainFanOut fanOut =
+      (PluginChainFanOut)malloc(sizeof(PluginChainFanOutMembers));
+
+  fanOut->variants = NULL;
+  fanOut->numVariants = 0;
+  fanOut->threads = NULL;
+  fanOut->numThreads = 0;
+
+  fanOut->_mutex = newMutex();
+  fanOut->_blockReady = newCondition();
+  fanOut->_blockDone = newCondition();
+  fanOut->_blockNumber = 0;
+  fanOut->_nextVariant = 0;
+  fanOut->_variantsPending = 0;
+  fanOut->_numWorkersStarted = 0;
+  fanOut->_pinned = false;
+  fanOut->_shutdown = false;
+  fanOut->_inputBuffer = NULL;
+  fanOut->_midiEvents = NULL;
+
+  return fanOut;
+}
+
+boolByte pluginChainFanOutAddVariant(PluginChainFanOut self,
+                                     PluginChain pluginChain,
+                                     SampleSource outputSource) {
+  PluginChainVariant variant;
+  PluginChainVariant *variants;
+
+  if (pluginChain == NULL || outputSource == NULL) {
+    return false;
+  } else if (self->threads != NULL) {
+    logInternalError("Variants cannot be added after processing has started");
+    return false;
+  }
+
+  variants = (PluginChainVariant *)realloc(
+      self->variants, sizeof(PluginChainVariant) * (self->numVariants + 1));
+
+  if (variants == NULL) {
+    return false;
+  }
+
+  variant = (PluginChainVariant)malloc(sizeof(PluginChainVariantMembers));
+  variant->pluginChain = pluginChain;
+  variant->outputSource = outputSource;
+  variant->renderer = NULL;
+
+  self->variants = variants;
+  self->variants[self->numVariants] = variant;
+  self->numVariants++;
+  return true;
+}
+
+static void _prepareVariant(PluginChainVariant variant) {
+  variant->renderer =
+      newPluginChainRenderer(variant->pluginChain, variant->outputSource);
+  pluginChainPrepareForProcessing(variant->pluginChain);
+}
+
+static void _processVariant(PluginChainVariant variant,
+                            SampleBuffer inputBuffer, unsigned long numFrames,
+                            LinkedList midiEvents) {
+  // Variants of pinned workers are prepared by the worker on the first block
+  if (variant->renderer == NULL) {
+    _prepareVariant(variant);
+  }
+
+  // Without an input buffer, the variant is being flushed
+  if (inputBuffer == NULL) {
+    pluginChainRendererFlush(variant->renderer);
+    return;
+  }
+
+  if (midiEvents != NULL) {
+    pluginChainProcessMidi(variant->pluginChain, midiEvents);
+  }
+
+  pluginChainRendererProcess(variant->renderer, inputBuffer, numFrames);
+}
+
+// Must be called with the mutex held, which is released while processing
+static void _processVariantOnWorker(PluginChainFanOut self,
+                                    unsigned int variantIndex) {
+  mutexUnlock(self->_mutex);
+  _processVariant(self->variants[variantIndex], self->_inputBuffer,
+                  self->_numFrames, self->_midiEvents);
+  mutexLock(self->_mutex);
+
+  if (--self->_variantsPending == 0) {
+    conditionSignalAll(self->_blockDone);
+  }
+}
+
+static void _pluginChainFanOutWorker(void *userData) {
+  PluginChainFanOut self = (PluginChainFanOut)userData;
+  unsigned long lastBlockNumber = 0;
+  unsigned int workerIndex;
+  unsigned int variantIndex;
+
+  mutexLock(self->_mutex);
+  workerIndex = self->_numWorkersStarted++;
+
+  while (true) {
+    while (!self->_shutdown && self->_blockNumber == lastBlockNumber) {
+      conditionWait(self->_blockReady, self->_mutex);
+    }
+
+    if (self->_shutdown) {
+      break;
+    }
+
+    lastBlockNumber = self->_blockNumber;
+
+    if (self->_pinned) {
+      for (variantIndex = workerIndex; variantIndex < self->numVariants;
+           variantIndex += self->numThreads) {
+        _processVariantOnWorker(self, variantIndex);
+      }
+    } else {
+      // Claim variants one at a time, so that cheap chains don't leave threads
+      // idle while an expensive one is still running.
+      while (self->_nextVariant < self->numVariants) {
+        _processVariantOnWorker(self, self->_nextVariant++);
+      }
+    }
+  }
+
+  mutexUnlock(self->_mutex);
+}
+
+void pluginChainFanOutStart(PluginChainFanOut self, unsigned int numThreads) {
+  Thread thread;
+  unsigned int i;
+
+  if (numThreads == 0 || numThreads > self->numVariants) {
+    numThreads = self->numVariants;
+  }
+
+  self->threads = (Thread *)malloc(sizeof(Thread) * numThreads);
+
+  for (i = 0; i < numThreads; i++) {
+    thread = newThread(_pluginChainFanOutWorker, self);
+
+    if (thread == NULL) {
+      logWarn("Could only start %d of %d worker threads", i, numThreads);
+      break;
+    }
+
+    if (threadPin(thread, THREAD_PLACEMENT_SPREAD, i + 1)) {
+      self->_pinned = true;
+    }
+
+    self->threads[self->numThreads++] = thread;
+  }
+
+  if (!self->_pinned) {
+    for (i = 0; i < self->numVariants; i++) {
+      _prepareVariant(self->variants[i]);
+    }
+  }
+
+  logDebug("Rendering %d variants with %d worker threads", self->numVariants,
+           self->numThreads);
+}
+
+static void _startFanOutBlock(PluginChainFanOut self, SampleBuffer inputBuffer,
+                              unsigned long numFrames, LinkedList midiEvents) {
+  unsigned int i;
+
+  if (self->numVariants == 0) {
+    return;
+  }
+
+  if (self->numThreads == 0) {
+    for (i = 0; i < self->numVariants; i++) {
+      _processVariant(self->variants[i], inputBuffer, numFrames, midiEvents);
+    }
+
+    return;
+  }
+
+  mutexLock(self->_mutex);
+  self->_inputBuffer = inputBuffer;
+  self->_numFrames = numFrames;
+  self->_midiEvents = midiEvents;
+  self->_nextVariant = 0;
+  self->_variantsPending = self->numVariants;
+  self->_blockNumber++;
+  conditionSignalAll(self->_blockReady);
+  mutexUnlock(self->_mutex);
+}
+
+void pluginChainFanOutProcess(PluginChainFanOut self, SampleBuffer inputBuffer,
+                              unsigned long numFrames, LinkedList midiEvents) {
+  _startFanOutBlock(self, inputBuffer, numFrames, midiEvents);
+}
+
+void pluginChainFanOutFlush(PluginChainFanOut self) {
+  _startFanOutBlock(self, NULL, 0, NULL);
+}
+
+boolByte pluginChainFanOutIsFinished(PluginChainFanOut self) {
+  unsigned int i;
+
+  for (i = 0; i < self->numVariants; i++) {
+    if (self->variants[i]->renderer == NULL ||
+        !pluginChainRendererIsFinished(self->variants[i]->renderer)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void pluginChainFanOutWait(PluginChainFanOut self) {
+  if (self->numThreads == 0) {
+    return;
+  }
+
+  mutexLock(self->_mutex);
+
+  while (self->_variantsPending > 0) {
+    conditionWait(self->_blockDone, self->_mutex);
+  }
+
+  mutexUnlock(self->_mutex);
+}
+
+void freePluginChainFanOut(PluginChainFanOut self) {
+  PluginChainVariant variant;
+  unsigned int i;
+
+  if (self == NULL) {
+    return;
+  }
+
+  mutexLock(self->_mutex);
+  self->_shutdown = true;
+  conditionSignalAll(self->_blockReady);
+  mutexUnlock(self->_mutex);
+
+  for (i = 0; i < self->numThreads; i++) {
+    freeThread(self->threads[i]);
+  }
+
+  for (i = 0; i < self->numVariants; i++) {
+    variant = self->variants[i];
+    pluginChainShutdown(variant->pluginChain);
+    freePluginChain(variant->pluginChain);
+    variant->outputSource->closeSampleSource(variant->outputSource);
+    freeSampleSource(variant->outputSource);
+    freePluginChainRenderer(variant->renderer);
+    free(variant);
+  }
+
+  free(self->variants);
+  free(self->threads);
+  freeMutex(self->_mutex);
+  freeCondition(self->_blockReady);
+  freeCondition(self->_blockDone);
+  free(self);
+}
@@ -0,0 +1,160 @@
+//
+// PluginChainFanOut.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_PluginChainFanOut_h
+#define MrsWatson_PluginChainFanOut_h
+
+#include "base/LinkedList.h"
+#include "base/Thread.h"
+#include "io/SampleSource.h"
+#include "plugin/PluginChain.h"
+#include "plugin/PluginChainRenderer.h"
+
+/**
+ * A single chain variant which renders the shared input to its own output.
+ */
+typedef struct {
+  PluginChain pluginChain;
+  SampleSource outputSource;
+  // Compensates for the chain's processing delay, which differs per variant
+  PluginChainRenderer renderer;
+} PluginChainVariantMembers;
+typedef PluginChainVariantMembers *PluginChainVariant;
+
+/**
+ * Renders one input through several independent plugin chains at once. The
+ * input is decoded only once per block, and the same (read-only) buffer is
+ * handed to all variants, which are processed in parallel on a pool of worker
+ * threads.
+ *
+ * Variants are processed in lock-step with the caller, one block at a time.
+ * This is needed since the audio clock and audio settings are global, so all
+ * chains must see the same transport position while processing a block.
+ *
+ * Normally each worker claims the next variant which has not been processed
+ * yet. When the workers are pinned with threadPin(), each one instead prepares
+ * and processes a fixed set of variants, so that their buffers are allocated
+ * on the NUMA node where they are processed.
+ */
+typedef struct {
+  PluginChainVariant *variants;
+  unsigned int numVariants;
+  Thread *threads;
+  unsigned int numThreads;
+
+  // Private fields, protected by _mutex
+  Mutex _mutex;
+  Condition _blockReady;
+  Condition _blockDone;
+  unsigned long _blockNumber;
+  unsigned int _nextVariant;
+  unsigned int _variantsPending;
+  unsigned int _numWorkersStarted;
+  boolByte _pinned;
+  boolByte _shutdown;
+  SampleBuffer _inputBuffer;
+  unsigned long _numFrames;
+  LinkedList _midiEvents;
+} PluginChainFanOutMembers;
+typedef PluginChainFanOutMembers *PluginChainFanOut;
+
+/**
+ * Create a new fan-out renderer with no variants.
+ * @return Initialized object
+ */
+PluginChainFanOut newPluginChainFanOut(void);
+
+/**
+ * Add a variant to the renderer. This must be called before
+ * pluginChainFanOutStart().
+ * @param self
+ * @param pluginChain Initialized plugin chain. The renderer takes ownership of
+ * this chain and will shut it down and free it.
+ * @param outputSource Output source, which must already be opened for writing.
+ * The renderer takes ownership of this source and will close and free it.
+ * @return True if the variant was added
+ */
+boolByte pluginChainFanOutAddVariant(PluginChainFanOut self,
+                                     PluginChain pluginChain,
+                                     SampleSource outputSource);
+
+/**
+ * Start the worker threads and prepare all chains for processing. If the
+ * workers are pinned, each one prepares its own chains when the first block is
+ * processed. If any threads cannot be started, the remaining work is done by
+ * the threads which could be started, or by the calling thread if none could.
+ * @param self
+ * @param numThreads Number of worker threads. This is limited to the number of
+ * variants, and if 0 then one thread per variant is used.
+ */
+void pluginChainFanOutStart(PluginChainFanOut self, unsigned int numThreads);
+
+/**
+ * Start processing a block of audio with all variants. This function returns
+ * immediately so that the caller can do other work while the variants are
+ * processed, and pluginChainFanOutWait() must be called before the next block
+ * is started.
+ * @param self
+ * @param inputBuffer Input block. This buffer must not be modified until
+ * pluginChainFanOutWait() returns.
+ * @param numFrames Number of frames at the start of the block which belong to
+ * the input, see pluginChainRendererProcess()
+ * @param midiEvents MIDI events for this block, or NULL if there are none. This
+ * list must not be modified until pluginChainFanOutWait() returns.
+ */
+void pluginChainFanOutProcess(PluginChainFanOut self, SampleBuffer inputBuffer,
+                              unsigned long numFrames, LinkedList midiEvents);
+
+/**
+ * Start processing a block of silence with the variants whose output is not
+ * yet complete, which should be done after the input has ended until
+ * pluginChainFanOutIsFinished() returns true. Like pluginChainFanOutProcess(),
+ * this must be followed by pluginChainFanOutWait().
+ * @param self
+ */
+void pluginChainFanOutFlush(PluginChainFanOut self);
+
+/**
+ * Check whether all variants have written as many frames as they have read.
+ * @param self
+ * @return True if no more blocks need to be flushed
+ */
+boolByte pluginChainFanOutIsFinished(PluginChainFanOut self);
+
+/**
+ * Wait for all variants to finish processing the current block.
+ * @param self
+ */
+void pluginChainFanOutWait(PluginChainFanOut self);
+
+/**
+ * Stop the worker threads, shut down all plugin chains, and close the variant
+ * output sources.
+ * @param self
+ */
+void freePluginChainFanOut(PluginChainFanOut self);
+
+#endif
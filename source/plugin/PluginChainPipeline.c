@@ -0,0 +1,711 @@
+//
+// PluginChainPipeline.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "PluginChainPipeline.h"
+
+#include "logging/EventLogger.h"
+#include "midi/MidiEvent.h"
+#include "plugin/PluginChain.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Blocks which may be in use at once: one in each stage, one which the caller
+// is filling, one which it is copying to the output, and one more which has
+// finished processing while the caller was still busy with the previous one.
+#define PIPELINE_EXTRA_BLOCKS 3
+
+unsigned int pluginChainPipelineGetNumStages(unsigned int numPlugins,
+                                             unsigned int numStages) {
+  if (numStages == 0 || numStages > numPlugins) {
+    return numPlugins;
+  }
+
+  return numStages;
+}
+
+/**
+ * Split the plugins into consecutive groups so that the most expensive group
+ * is as cheap as possible. Chains have at most MAX_PLUGINS plugins, so this
+ * simply tries every possible split.
+ */
+static void _balanceStages(PluginChainPipeline self) {
+  double costs[MAX_PLUGINS + 1];
+  double best[MAX_PLUGINS + 1][MAX_PLUGINS + 1];
+  unsigned int splits[MAX_PLUGINS + 1][MAX_PLUGINS + 1];
+  double totalCost = 0.0;
+  double stageCost;
+  unsigned int end;
+  unsigned int i;
+  unsigned int j;
+  unsigned int s;
+
+  // costs[i] is the total time of the first i plugins
+  costs[0] = 0.0;
+
+  for (i = 0; i < self->numPlugins; i++) {
+    totalCost += self->audioTimers[i]->totalTaskTime;
+    costs[i + 1] = totalCost;
+  }
+
+  if (totalCost <= 0.0) {
+    logDebug("No plugin timing available yet, splitting pipeline evenly");
+
+    for (i = 0; i <= self->numPlugins; i++) {
+      costs[i] = (double)i;
+    }
+  }
+
+  // best[s][i] is the cost of the most expensive stage when the first i
+  // plugins are split into s stages, and splits[s][i] is where the last of
+  // those stages starts
+  for (i = 1; i <= self->numPlugins; i++) {
+    best[1][i] = costs[i];
+    splits[1][i] = 0;
+  }
+
+  for (s = 2; s <= self->numStages; s++) {
+    for (i = s; i <= self->numPlugins; i++) {
+      best[s][i] = -1.0;
+
+      for (j = s - 1; j < i; j++) {
+        stageCost = costs[i] - costs[j];
+
+        if (best[s - 1][j] > stageCost) {
+          stageCost = best[s - 1][j];
+        }
+
+        if (best[s][i] < 0.0 || stageCost < best[s][i]) {
+          best[s][i] = stageCost;
+          splits[s][i] = j;
+        }
+      }
+    }
+  }
+
+  end = self->numPlugins;
+
+  for (s = self->numStages; s > 0; s--) {
+    self->stages[s - 1]->firstPlugin = splits[s][end];
+    self->stages[s - 1]->numPlugins = end - splits[s][end];
+    end = splits[s][end];
+  }
+}
+
+static PluginChainPipelineStage _newStage(PluginChainPipeline self,
+                                          unsigned int index) {
+  PluginChainPipelineStage stage = (PluginChainPipelineStage)malloc(
+      sizeof(PluginChainPipelineStageMembers));
+
+  stage->index = index;
+  stage->firstPlugin = 0;
+  stage->numPlugins = 0;
+  stage->inputQueue = NULL;
+  stage->outputQueue = NULL;
+  stage->thread = NULL;
+
+  stage->_plugins = self->plugins;
+  stage->_audioTimers = self->audioTimers;
+  stage->_midiTimers = self->midiTimers;
+  // Each stage thread processes the same stream as the thread which started
+  // the pipeline
+  stage->_context = newProcessingContext();
+
+  return stage;
+}
+
+static PluginChainPipelineBlock _newBlock(PluginChainPipeline self) {
+  PluginChainPipelineBlock block = (PluginChainPipelineBlock)malloc(
+      sizeof(PluginChainPipelineBlockMembers));
+  PluginChainPipelineStage stage;
+  Plugin lastPlugin;
+  unsigned int i;
+
+  // Each stage writes into a buffer which has as many channels as the output
+  // of its last plugin, so that the channels are mapped exactly as if the
+  // plugins were processed one after another.
+  block->buffers =
+      (SampleBuffer *)malloc(sizeof(SampleBuffer) * (self->numStages + 1));
+  block->buffers[0] = newSampleBuffer(getNumChannels(), getBlocksize());
+
+  for (i = 0; i < self->numStages; i++) {
+    stage = self->stages[i];
+    lastPlugin = self->plugins[stage->firstPlugin + stage->numPlugins - 1];
+    block->buffers[i + 1] = newSampleBuffer(
+        lastPlugin->outputBuffer->numChannels, getBlocksize());
+  }
+
+  memset(&block->clock, 0, sizeof(AudioClockMembers));
+  block->tempo = getTempo();
+  block->timeSignatureBeatsPerMeasure = getTimeSignatureBeatsPerMeasure();
+  block->timeSignatureNoteValue = getTimeSignatureNoteValue();
+  block->midiEvents =
+      (LinkedList *)malloc(sizeof(LinkedList) * self->numPlugins);
+
+  for (i = 0; i < self->numPlugins; i++) {
+    block->midiEvents[i] = NULL;
+  }
+
+  block->parameters = NULL;
+
+  return block;
+}
+
+static void _syncTransport(PluginChainPipelineStage stage,
+                           PluginChainPipelineBlock block) {
+  memcpy(stage->_context->audioClock, &block->clock, sizeof(AudioClockMembers));
+
+  // The setters log each change, so only call them when something changed
+  if (getTempo() != block->tempo) {
+    setTempo(block->tempo);
+  }
+
+  if (getTimeSignatureBeatsPerMeasure() !=
+      block->timeSignatureBeatsPerMeasure) {
+    setTimeSignatureBeatsPerMeasure(block->timeSignatureBeatsPerMeasure);
+  }
+
+  if (getTimeSignatureNoteValue() != block->timeSignatureNoteValue) {
+    setTimeSignatureNoteValue(block->timeSignatureNoteValue);
+  }
+}
+
+static void _applyParameters(PluginChainPipelineBlock block, Plugin plugin,
+                             unsigned int pluginIndex) {
+  LinkedListIterator iterator = block->parameters;
+  PluginChainPipelineParameter parameter;
+
+  while (iterator != NULL) {
+    parameter = (PluginChainPipelineParameter)iterator->item;
+
+    if (parameter != NULL && parameter->pluginIndex == pluginIndex) {
+      plugin->setParameter(plugin, parameter->parameterIndex,
+                           parameter->value);
+    }
+
+    iterator = (LinkedListIterator)iterator->nextItem;
+  }
+}
+
+static void _processStage(PluginChainPipelineStage stage,
+                          PluginChainPipelineBlock block) {
+  SampleBuffer formerOutputBuffer = block->buffers[stage->index];
+  SampleBuffer stageOutputBuffer = block->buffers[stage->index + 1];
+  Plugin plugin;
+  unsigned int i;
+
+  for (i = stage->firstPlugin; i < stage->firstPlugin + stage->numPlugins;
+       i++) {
+    plugin = stage->_plugins[i];
+
+    if (block->parameters != NULL) {
+      _applyParameters(block, plugin, i);
+    }
+
+    if (block->midiEvents[i] != NULL) {
+      if (block->midiEvents[i]->item != NULL) {
+        taskTimerStart(stage->_midiTimers[i]);
+        plugin->processMidiEvents(plugin, block->midiEvents[i]);
+        taskTimerStop(stage->_midiTimers[i]);
+      }
+
+      freeLinkedListAndItems(block->midiEvents[i], free);
+      block->midiEvents[i] = NULL;
+    }
+
+    plugin->inputBuffer->blocksize = formerOutputBuffer->blocksize;
+    sampleBufferCopyAndMapChannels(plugin->inputBuffer, formerOutputBuffer);
+    plugin->outputBuffer->blocksize = plugin->inputBuffer->blocksize;
+    taskTimerStart(stage->_audioTimers[i]);
+    plugin->processAudio(plugin, plugin->inputBuffer, plugin->outputBuffer);
+    taskTimerStop(stage->_audioTimers[i]);
+    formerOutputBuffer = plugin->outputBuffer;
+  }
+
+  sampleBufferCopyAndMapChannels(stageOutputBuffer, formerOutputBuffer);
+}
+
+static void _runStage(void *userData) {
+  PluginChainPipelineStage stage = (PluginChainPipelineStage)userData;
+  PluginChainPipelineBlock block;
+
+  processingContextMakeCurrent(stage->_context);
+
+  while (true) {
+    block = (PluginChainPipelineBlock)spscQueuePopWait(stage->inputQueue);
+
+    // The stop block has no buffers, and is passed on to the next stage
+    if (block->buffers != NULL) {
+      _syncTransport(stage, block);
+      _processStage(stage, block);
+    }
+
+    spscQueuePushWait(stage->outputQueue, block);
+
+    if (block->buffers == NULL) {
+      break;
+    }
+  }
+
+  processingContextMakeCurrent(NULL);
+}
+
+static void _stopThreads(PluginChainPipeline self) {
+  PluginChainPipelineStage lastStage = self->stages[self->numStages - 1];
+  unsigned int i;
+
+  if (self->numThreads == self->numStages) {
+    spscQueuePushWait(self->stages[0]->inputQueue, &self->_stopBlock);
+
+    // Discard the blocks which are still in the pipeline
+    while (spscQueuePopWait(lastStage->outputQueue) != &self->_stopBlock) {
+    }
+  } else {
+    // Only some of the threads were started, so stop each of them directly
+    for (i = 0; i < self->numThreads; i++) {
+      spscQueuePushWait(self->stages[i]->inputQueue, &self->_stopBlock);
+    }
+  }
+
+  for (i = 0; i < self->numThreads; i++) {
+    freeThread(self->stages[i]->thread);
+    self->stages[i]->thread = NULL;
+  }
+
+  self->numThreads = 0;
+}
+
+static void _startThreads(PluginChainPipeline self) {
+  PluginChainPipelineStage stage;
+  unsigned int i;
+
+  for (i = 0; i < self->numStages; i++) {
+    stage = self->stages[i];
+    stage->thread = newThread(_runStage, stage);
+
+    if (stage->thread == NULL) {
+      logWarn("Could not start pipeline thread, processing serially instead");
+      _stopThreads(self);
+      return;
+    }
+
+    // Stages hand their buffers to each other every block, so keep them on
+    // processors which share a cache with the thread that feeds them
+    threadPin(stage->thread, THREAD_PLACEMENT_COMPACT, i + 1);
+    self->numThreads++;
+  }
+}
+
+PluginChainPipeline newPluginChainPipeline(Plugin *plugins,
+                                           TaskTimer *audioTimers,
+                                           TaskTimer *midiTimers,
+                                           unsigned int numPlugins,
+                                           unsigned int numStages) {
+  PluginChainPipeline pipeline =
+      (PluginChainPipeline)malloc(sizeof(PluginChainPipelineMembers));
+  SpscQueue queue;
+  unsigned int i;
+
+  pipeline->plugins = plugins;
+  pipeline->audioTimers = audioTimers;
+  pipeline->midiTimers = midiTimers;
+  pipeline->numPlugins = numPlugins;
+  pipeline->_midiEvents =
+      (LinkedList *)malloc(sizeof(LinkedList) * numPlugins);
+
+  for (i = 0; i < numPlugins; i++) {
+    pipeline->_midiEvents[i] = NULL;
+  }
+
+  pipeline->_parameters = NULL;
+  pipeline->numStages = pluginChainPipelineGetNumStages(numPlugins, numStages);
+  pipeline->stages = (PluginChainPipelineStage *)malloc(
+      sizeof(PluginChainPipelineStage) * pipeline->numStages);
+  pipeline->numThreads = 0;
+
+  for (i = 0; i < pipeline->numStages; i++) {
+    pipeline->stages[i] = _newStage(pipeline, i);
+  }
+
+  _balanceStages(pipeline);
+
+  // Every block could end up in the same queue, plus the stop block
+  pipeline->_numBlocks = pipeline->numStages + PIPELINE_EXTRA_BLOCKS;
+  queue = newSpscQueue(pipeline->_numBlocks + 1);
+
+  for (i = 0; i < pipeline->numStages; i++) {
+    pipeline->stages[i]->inputQueue = queue;
+    queue = newSpscQueue(pipeline->_numBlocks + 1);
+    pipeline->stages[i]->outputQueue = queue;
+  }
+
+  pipeline->_blocks = (PluginChainPipelineBlock *)malloc(
+      sizeof(PluginChainPipelineBlock) * pipeline->_numBlocks);
+  pipeline->_freeBlocks = (PluginChainPipelineBlock *)malloc(
+      sizeof(PluginChainPipelineBlock) * pipeline->_numBlocks);
+
+  for (i = 0; i < pipeline->_numBlocks; i++) {
+    pipeline->_blocks[i] = _newBlock(pipeline);
+    pipeline->_freeBlocks[i] = pipeline->_blocks[i];
+  }
+
+  pipeline->_numFreeBlocks = pipeline->_numBlocks;
+  memset(&pipeline->_stopBlock, 0, sizeof(PluginChainPipelineBlockMembers));
+  pipeline->_inputBlock = NULL;
+  pipeline->_inputFrames = 0;
+  pipeline->_outputBlock = NULL;
+  pipeline->_outputFrames = 0;
+  pipeline->_silentFrames = pipeline->numStages * getBlocksize();
+
+  for (i = 0; i < pipeline->numStages; i++) {
+    logDebug("Pipeline stage %d processes plugins %d-%d", i,
+             pipeline->stages[i]->firstPlugin,
+             pipeline->stages[i]->firstPlugin +
+                 pipeline->stages[i]->numPlugins - 1);
+  }
+
+  _startThreads(pipeline);
+  return pipeline;
+}
+
+void pluginChainPipelineProcessMidi(PluginChainPipeline self,
+                                    unsigned int pluginIndex,
+                                    LinkedList midiEvents) {
+  LinkedListIterator iterator = midiEvents;
+  MidiEvent midiEvent;
+
+  if (self->_midiEvents[pluginIndex] == NULL) {
+    self->_midiEvents[pluginIndex] = newLinkedList();
+  }
+
+  while (iterator != NULL) {
+    if (iterator->item != NULL) {
+      // Extra data is shared, so the copy must be freed with free() rather
+      // than freeMidiEvent()
+      midiEvent = newMidiEvent();
+      memcpy(midiEvent, iterator->item, sizeof(MidiEventMembers));
+      linkedListAppend(self->_midiEvents[pluginIndex], midiEvent);
+    }
+
+    iterator = (LinkedListIterator)iterator->nextItem;
+  }
+}
+
+void pluginChainPipelineSetParameter(PluginChainPipeline self,
+                                     unsigned int pluginIndex,
+                                     unsigned int parameterIndex, float value) {
+  PluginChainPipelineParameter parameter =
+      (PluginChainPipelineParameter)malloc(
+          sizeof(PluginChainPipelineParameterMembers));
+
+  parameter->pluginIndex = pluginIndex;
+  parameter->parameterIndex = parameterIndex;
+  parameter->value = value;
+
+  if (self->_parameters == NULL) {
+    self->_parameters = newLinkedList();
+  }
+
+  linkedListAppend(self->_parameters, parameter);
+}
+
+static void _beginInputBlock(PluginChainPipeline self,
+                             SampleCount inputOffset) {
+  PluginChainPipelineBlock block;
+  AudioClock audioClock = getAudioClock();
+
+  block = self->_freeBlocks[--self->_numFreeBlocks];
+  block->clock.currentFrame = audioClock->currentFrame + inputOffset;
+  block->clock.isPlaying = audioClock->isPlaying;
+  block->clock.transportChanged = audioClock->transportChanged;
+  block->tempo = getTempo();
+  block->timeSignatureBeatsPerMeasure = getTimeSignatureBeatsPerMeasure();
+  block->timeSignatureNoteValue = getTimeSignatureNoteValue();
+
+  self->_inputBlock = block;
+  self->_inputFrames = 0;
+}
+
+/**
+ * Move the pending MIDI events which fall within the given range of the input
+ * to the block which is being filled.
+ */
+static void _addMidiEventsToInputBlock(PluginChainPipeline self,
+                                       SampleCount inputOffset,
+                                       SampleCount numFrames) {
+  LinkedList *blockEvents = self->_inputBlock->midiEvents;
+  LinkedListIterator iterator;
+  LinkedList remainingEvents;
+  MidiEvent midiEvent;
+  unsigned int i;
+
+  for (i = 0; i < self->numPlugins; i++) {
+    if (self->_midiEvents[i] == NULL) {
+      continue;
+    }
+
+    iterator = self->_midiEvents[i];
+    remainingEvents = newLinkedList();
+
+    while (iterator != NULL) {
+      midiEvent = (MidiEvent)iterator->item;
+
+      if (midiEvent == NULL) {
+        // Empty list
+      } else if (midiEvent->deltaFrames >= inputOffset &&
+                 midiEvent->deltaFrames < inputOffset + numFrames) {
+        midiEvent->deltaFrames += self->_inputFrames - inputOffset;
+
+        if (blockEvents[i] == NULL) {
+          blockEvents[i] = newLinkedList();
+        }
+
+        linkedListAppend(blockEvents[i], midiEvent);
+      } else {
+        linkedListAppend(remainingEvents, midiEvent);
+      }
+
+      iterator = (LinkedListIterator)iterator->nextItem;
+    }
+
+    freeLinkedList(self->_midiEvents[i]);
+    self->_midiEvents[i] = remainingEvents;
+  }
+}
+
+/**
+ * Move the pending parameter changes to the block which is being filled, so
+ * that they take effect at the start of that block.
+ */
+static void _addParametersToInputBlock(PluginChainPipeline self) {
+  PluginChainPipelineBlock block = self->_inputBlock;
+  LinkedListIterator iterator = self->_parameters;
+
+  if (block->parameters == NULL) {
+    block->parameters = self->_parameters;
+  } else {
+    while (iterator != NULL) {
+      if (iterator->item != NULL) {
+        linkedListAppend(block->parameters, iterator->item);
+      }
+
+      iterator = (LinkedListIterator)iterator->nextItem;
+    }
+
+    freeLinkedList(self->_parameters);
+  }
+
+  self->_parameters = NULL;
+}
+
+static void _pushInputBlock(PluginChainPipeline self) {
+  PluginChainPipelineBlock block = self->_inputBlock;
+  unsigned int i;
+
+  if (self->numThreads > 0) {
+    spscQueuePushWait(self->stages[0]->inputQueue, block);
+  } else {
+    for (i = 0; i < self->numStages; i++) {
+      _processStage(self->stages[i], block);
+    }
+
+    spscQueuePush(self->stages[self->numStages - 1]->outputQueue, block);
+  }
+
+  self->_inputBlock = NULL;
+  self->_inputFrames = 0;
+}
+
+static void _clearFrames(SampleBuffer buffer, SampleCount offset,
+                         SampleCount numFrames) {
+  ChannelCount i;
+
+  for (i = 0; i < buffer->numChannels; i++) {
+    memset(buffer->samples[i] + offset, 0, sizeof(Sample) * numFrames);
+  }
+}
+
+void pluginChainPipelineProcess(PluginChainPipeline self,
+                                SampleBuffer inBuffer, SampleBuffer outBuffer) {
+  PluginChainPipelineStage lastStage = self->stages[self->numStages - 1];
+  const SampleCount blocksize = getBlocksize();
+  SampleCount offset = 0;
+  SampleCount numFrames;
+  unsigned int i;
+
+  // Input is collected into full blocks, so that plugins only process short
+  // blocks if the caller does so for the whole stream
+  while (offset < inBuffer->blocksize) {
+    if (self->_inputBlock == NULL) {
+      if (self->_numFreeBlocks == 0) {
+        logInternalError("No free blocks left in pipeline");
+        return;
+      }
+
+      _beginInputBlock(self, offset);
+    }
+
+    if (self->_parameters != NULL) {
+      _addParametersToInputBlock(self);
+    }
+
+    numFrames = blocksize - self->_inputFrames;
+
+    if (numFrames > inBuffer->blocksize - offset) {
+      numFrames = inBuffer->blocksize - offset;
+    }
+
+    sampleBufferCopyAndMapChannelsWithOffset(self->_inputBlock->buffers[0],
+                                             self->_inputFrames, inBuffer,
+                                             offset, numFrames);
+    _addMidiEventsToInputBlock(self, offset, numFrames);
+    self->_inputFrames += numFrames;
+    offset += numFrames;
+
+    if (self->_inputFrames == blocksize) {
+      _pushInputBlock(self);
+    }
+  }
+
+  // Events which are past the end of the input are dropped, just like when
+  // the plugins are processed serially
+  for (i = 0; i < self->numPlugins; i++) {
+    if (self->_midiEvents[i] != NULL) {
+      freeLinkedListAndItems(self->_midiEvents[i], free);
+      self->_midiEvents[i] = NULL;
+    }
+  }
+
+  offset = 0;
+  outBuffer->blocksize = inBuffer->blocksize;
+
+  while (offset < outBuffer->blocksize) {
+    numFrames = outBuffer->blocksize - offset;
+
+    if (self->_silentFrames > 0) {
+      if (numFrames > self->_silentFrames) {
+        numFrames = self->_silentFrames;
+      }
+
+      _clearFrames(outBuffer, offset, numFrames);
+      self->_silentFrames -= numFrames;
+    } else {
+      if (self->_outputBlock == NULL) {
+        self->_outputBlock = (PluginChainPipelineBlock)spscQueuePopWait(
+            lastStage->outputQueue);
+        self->_outputFrames = 0;
+      }
+
+      if (numFrames > blocksize - self->_outputFrames) {
+        numFrames = blocksize - self->_outputFrames;
+      }
+
+      sampleBufferCopyAndMapChannelsWithOffset(
+          outBuffer, offset, self->_outputBlock->buffers[self->numStages],
+          self->_outputFrames, numFrames);
+      self->_outputFrames += numFrames;
+
+      if (self->_outputFrames == blocksize) {
+        if (self->_outputBlock->parameters != NULL) {
+          freeLinkedListAndItems(self->_outputBlock->parameters, free);
+          self->_outputBlock->parameters = NULL;
+        }
+
+        self->_freeBlocks[self->_numFreeBlocks++] = self->_outputBlock;
+        self->_outputBlock = NULL;
+      }
+    }
+
+    offset += numFrames;
+  }
+}
+
+static void _freeBlock(PluginChainPipeline self,
+                       PluginChainPipelineBlock block) {
+  unsigned int i;
+
+  for (i = 0; i <= self->numStages; i++) {
+    freeSampleBuffer(block->buffers[i]);
+  }
+
+  for (i = 0; i < self->numPlugins; i++) {
+    if (block->midiEvents[i] != NULL) {
+      freeLinkedListAndItems(block->midiEvents[i], free);
+    }
+  }
+
+  if (block->parameters != NULL) {
+    freeLinkedListAndItems(block->parameters, free);
+  }
+
+  free(block->midiEvents);
+  free(block->buffers);
+  free(block);
+}
+
+static void _freeStage(PluginChainPipelineStage stage) {
+  freeSpscQueue(stage->outputQueue);
+  freeProcessingContext(stage->_context);
+  free(stage);
+}
+
+void freePluginChainPipeline(PluginChainPipeline self) {
+  unsigned int i;
+
+  if (self == NULL) {
+    return;
+  }
+
+  if (self->numThreads > 0) {
+    _stopThreads(self);
+  }
+
+  freeSpscQueue(self->stages[0]->inputQueue);
+
+  for (i = 0; i < self->numStages; i++) {
+    _freeStage(self->stages[i]);
+  }
+
+  for (i = 0; i < self->_numBlocks; i++) {
+    _freeBlock(self, self->_blocks[i]);
+  }
+
+  for (i = 0; i < self->numPlugins; i++) {
+    if (self->_midiEvents[i] != NULL) {
+      freeLinkedListAndItems(self->_midiEvents[i], free);
+    }
+  }
+
+  if (self->_parameters != NULL) {
+    freeLinkedListAndItems(self->_parameters, free);
+  }
+
+  free(self->_midiEvents);
+  free(self->stages);
+  free(self->_blocks);
+  free(self->_freeBlocks);
+  free(self);
+}
@@ -0,0 +1,210 @@
+//
+// PluginChainPipeline.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_PluginChainPipeline_h
+#define MrsWatson_PluginChainPipeline_h
+
+#include "audio/AudioSettings.h"
+#include "base/LinkedList.h"
+#include "base/Queue.h"
+#include "base/Thread.h"
+#include "plugin/Plugin.h"
+#include "plugin/ProcessingContext.h"
+#include "time/AudioClock.h"
+#include "time/TaskTimer.h"
+
+/**
+ * Parameter change which travels through the pipeline with a block, so that
+ * it is applied by the stage which processes the plugin.
+ */
+typedef struct {
+  unsigned int pluginIndex;
+  unsigned int parameterIndex;
+  float value;
+} PluginChainPipelineParameterMembers;
+typedef PluginChainPipelineParameterMembers *PluginChainPipelineParameter;
+
+/**
+ * A block of audio travelling through the pipeline, along with the transport
+ * state that the caller had at its first frame.
+ */
+typedef struct {
+  // Audio entering each stage, plus the output of the last one
+  SampleBuffer *buffers;
+  AudioClockMembers clock;
+  Tempo tempo;
+  unsigned short timeSignatureBeatsPerMeasure;
+  unsigned short timeSignatureNoteValue;
+  // Copies of the MIDI events for each plugin, or NULL for plugins which have
+  // none. Each list is freed by the stage which processes its plugin.
+  LinkedList *midiEvents;
+  // Parameter changes which are applied before the block is processed, or
+  // NULL if there are none. These are freed once the block leaves the
+  // pipeline.
+  LinkedList parameters;
+} PluginChainPipelineBlockMembers;
+typedef PluginChainPipelineBlockMembers *PluginChainPipelineBlock;
+
+/**
+ * A group of consecutive plugins which are processed by one thread.
+ */
+typedef struct {
+  unsigned int index;
+  unsigned int firstPlugin;
+  unsigned int numPlugins;
+  SpscQueue inputQueue;
+  SpscQueue outputQueue;
+  Thread thread;
+
+  // Private fields
+  Plugin *_plugins;
+  TaskTimer *_audioTimers;
+  TaskTimer *_midiTimers;
+  ProcessingContext _context;
+} PluginChainPipelineStageMembers;
+typedef PluginChainPipelineStageMembers *PluginChainPipelineStage;
+
+/**
+ * Runs the plugins of a serial chain on several threads at once, like an
+ * assembly line. The plugins are split into stages, and while the last stage
+ * processes one block, the stage before it is already processing the next
+ * block, and so on. Blocks are handed from one stage to the next through
+ * lock-free queues.
+ *
+ * The output of the pipeline is delayed by one block per stage, but otherwise
+ * identical to processing the plugins one after another. Blocks may have any
+ * size up to the blocksize, and the delay stays the same.
+ */
+typedef struct {
+  Plugin *plugins;
+  TaskTimer *audioTimers;
+  TaskTimer *midiTimers;
+  unsigned int numPlugins;
+  PluginChainPipelineStage *stages;
+  unsigned int numStages;
+  // Number of stages which run on their own thread. Normally this is all of
+  // them, but if no threads could be started, then the caller processes each
+  // block instead.
+  unsigned int numThreads;
+
+  // Private fields
+  PluginChainPipelineBlock *_blocks;
+  unsigned int _numBlocks;
+  PluginChainPipelineBlock *_freeBlocks;
+  unsigned int _numFreeBlocks;
+  PluginChainPipelineBlockMembers _stopBlock;
+  // Block which is being filled with input, and number of frames in it
+  PluginChainPipelineBlock _inputBlock;
+  SampleCount _inputFrames;
+  // Block which is being copied to the output, and number of frames copied
+  PluginChainPipelineBlock _outputBlock;
+  SampleCount _outputFrames;
+  // Silent frames which are output before the first processed block
+  SampleCount _silentFrames;
+  // Copies of the MIDI events for the next call to the pipeline, for each
+  // plugin
+  LinkedList *_midiEvents;
+  // Parameter changes for the next call to the pipeline
+  LinkedList _parameters;
+} PluginChainPipelineMembers;
+typedef PluginChainPipelineMembers *PluginChainPipeline;
+
+/**
+ * Split the plugins of a chain into stages and start a thread for each stage.
+ * Plugins are grouped so that the total processing time of each stage is as
+ * even as possible, based on the time measured by the audio timers so far. If
+ * no time has been measured yet, each stage gets the same number of plugins.
+ * The audio settings of the calling thread are used by all stages.
+ * @param plugins Plugins to process, which must already be opened and
+ * prepared for processing
+ * @param audioTimers Timer for the audio processing of each plugin
+ * @param midiTimers Timer for the MIDI processing of each plugin
+ * @param numPlugins Number of plugins
+ * @param numStages Number of stages. This is limited to the number of plugins,
+ * and if 0 then each plugin gets its own stage.
+ * @return Running pipeline
+ */
+PluginChainPipeline newPluginChainPipeline(Plugin *plugins,
+                                           TaskTimer *audioTimers,
+                                           TaskTimer *midiTimers,
+                                           unsigned int numPlugins,
+                                           unsigned int numStages);
+
+/**
+ * Get the number of stages which would be used by newPluginChainPipeline().
+ * @param numPlugins Number of plugins
+ * @param numStages Requested number of stages
+ * @return Number of stages
+ */
+unsigned int pluginChainPipelineGetNumStages(unsigned int numPlugins,
+                                             unsigned int numStages);
+
+/**
+ * Queue MIDI events for a plugin. They are sent along with the audio passed to
+ * the next call to pluginChainPipelineProcess(), and are processed by the
+ * stage which the plugin belongs to. The events are copied, but any extra
+ * data is shared with the original events and must not be freed until the
+ * pipeline has been freed.
+ * @param self
+ * @param pluginIndex Index of the plugin
+ * @param midiEvents List of events
+ */
+void pluginChainPipelineProcessMidi(PluginChainPipeline self,
+                                    unsigned int pluginIndex,
+                                    LinkedList midiEvents);
+
+/**
+ * Queue a parameter change for a plugin. The change is sent along with the
+ * first block which receives audio from the next call to
+ * pluginChainPipelineProcess(), and is applied by the stage which the plugin
+ * belongs to right before it processes that block.
+ * @param self
+ * @param pluginIndex Index of the plugin
+ * @param parameterIndex Index of the parameter
+ * @param value New value of the parameter
+ */
+void pluginChainPipelineSetParameter(PluginChainPipeline self,
+                                     unsigned int pluginIndex,
+                                     unsigned int parameterIndex, float value);
+
+/**
+ * Send a block of audio into the pipeline, and get the block which comes out
+ * of the other end.
+ * @param self
+ * @param inBuffer Input block, which may not be larger than the blocksize
+ * @param outBuffer Output block, which must have the same size as the input
+ */
+void pluginChainPipelineProcess(PluginChainPipeline self,
+                                SampleBuffer inBuffer, SampleBuffer outBuffer);
+
+/**
+ * Stop all threads and free the pipeline. Any audio which is still in the
+ * pipeline is discarded.
+ * @param self
+ */
+void freePluginChainPipeline(PluginChainPipeline self);
+
+#endif
@@ -0,0 +1,164 @@
+//
+// PluginChainRenderer.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "PluginChainRenderer.h"
+
+#include "audio/AudioSettings.h"
+#include "time/AudioClock.h"
+
+#include <stdlib.h>
+
+PluginChainRenderer newPluginChainRenderer(PluginChain pluginChain,
+                                           SampleSource outputSource) {
+  PluginChainRenderer renderer =
+      (PluginChainRenderer)malloc(sizeof(PluginChainRendererMembers));
+
+  renderer->pluginChain = pluginChain;
+  renderer->outputSource = outputSource;
+  renderer->numFramesRead = 0;
+  renderer->numFramesWritten = 0;
+  renderer->outputTimer = NULL;
+
+  renderer->_processingDelay = pluginChainGetProcessingDelay(pluginChain);
+  renderer->_tailFrames = pluginChainGetTailFrames(pluginChain);
+  renderer->_framesProcessed = 0;
+  renderer->_outputBuffer = newSampleBuffer(getNumChannels(), getBlocksize());
+  renderer->_silenceBuffer = newSampleBuffer(getNumChannels(), getBlocksize());
+  renderer->_trimmedBuffer = newSampleBuffer(getNumChannels(), getBlocksize());
+
+  return renderer;
+}
+
+static void _writeRendererOutput(PluginChainRenderer self) {
+  SampleBuffer buffer = self->_outputBuffer;
+  const unsigned long blockStart = self->_framesProcessed;
+  const unsigned long blockEnd = blockStart + buffer->blocksize;
+  const unsigned long outputEnd =
+      self->_processingDelay + self->numFramesRead + self->_tailFrames;
+  unsigned long firstFrame = blockStart;
+  unsigned long lastFrame = blockEnd;
+
+  self->_framesProcessed = blockEnd;
+
+  // Cut the delay at the start, and anything which comes after the tail when
+  // the chain is flushed
+  if (firstFrame < self->_processingDelay) {
+    firstFrame = self->_processingDelay;
+  }
+
+  if (lastFrame > outputEnd) {
+    lastFrame = outputEnd;
+  }
+
+  if (lastFrame <= firstFrame) {
+    return;
+  }
+
+  if (self->outputTimer != NULL) {
+    taskTimerStart(self->outputTimer);
+  }
+
+  if (firstFrame == blockStart && lastFrame == blockEnd) {
+    self->outputSource->writeSampleBlock(self->outputSource, buffer);
+  } else {
+    self->_trimmedBuffer->blocksize = lastFrame - firstFrame;
+    sampleBufferCopyAndMapChannelsWithOffset(self->_trimmedBuffer, 0, buffer,
+                                             firstFrame - blockStart,
+                                             self->_trimmedBuffer->blocksize);
+    self->outputSource->writeSampleBlock(self->outputSource,
+                                         self->_trimmedBuffer);
+  }
+
+  if (self->outputTimer != NULL) {
+    taskTimerStop(self->outputTimer);
+  }
+
+  self->numFramesWritten += lastFrame - firstFrame;
+}
+
+void pluginChainRendererProcess(PluginChainRenderer self,
+                                SampleBuffer inputBuffer,
+                                unsigned long numFrames) {
+  self->numFramesRead += numFrames;
+  self->_outputBuffer->blocksize = inputBuffer->blocksize;
+  pluginChainProcessAudio(self->pluginChain, inputBuffer, self->_outputBuffer);
+  _writeRendererOutput(self);
+}
+
+void pluginChainRendererFlush(PluginChainRenderer self) {
+  if (pluginChainRendererIsFinished(self)) {
+    return;
+  }
+
+  // Plugins always receive full blocks, and the excess is cut when writing
+  self->_outputBuffer->blocksize = self->_silenceBuffer->blocksize;
+  pluginChainProcessAudio(self->pluginChain, self->_silenceBuffer,
+                          self->_outputBuffer);
+  _writeRendererOutput(self);
+}
+
+boolByte pluginChainRendererIsFinished(PluginChainRenderer self) {
+  return (boolByte)(self->_framesProcessed >= self->_processingDelay +
+                                                  self->numFramesRead +
+                                                  self->_tailFrames);
+}
+
+void pluginChainRendererRender(PluginChainRenderer self,
+                               SampleSource inputSource) {
+  SampleBuffer inputBuffer = newSampleBuffer(getNumChannels(), getBlocksize());
+  AudioClock audioClock = getAudioClock();
+  unsigned long framesRead;
+  boolByte finishedReading = false;
+
+  while (!finishedReading) {
+    inputBuffer->blocksize = getBlocksize();
+    sampleBufferClear(inputBuffer);
+    inputSource->readSampleBlock(inputSource, inputBuffer);
+    framesRead = inputBuffer->blocksize;
+    finishedReading = (boolByte)(framesRead < (unsigned long)getBlocksize());
+
+    // The last block is padded with silence, which is not counted as input
+    inputBuffer->blocksize = getBlocksize();
+    pluginChainRendererProcess(self, inputBuffer, framesRead);
+    advanceAudioClock(audioClock, inputBuffer->blocksize);
+  }
+
+  while (!pluginChainRendererIsFinished(self)) {
+    pluginChainRendererFlush(self);
+    advanceAudioClock(audioClock, getBlocksize());
+  }
+
+  freeSampleBuffer(inputBuffer);
+}
+
+void freePluginChainRenderer(PluginChainRenderer self) {
+  if (self != NULL) {
+    freeSampleBuffer(self->_outputBuffer);
+    freeSampleBuffer(self->_silenceBuffer);
+    freeSampleBuffer(self->_trimmedBuffer);
+    free(self);
+  }
+}
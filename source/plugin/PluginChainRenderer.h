@@ -0,0 +1,124 @@
+//
+// PluginChainRenderer.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_PluginChainRenderer_h
+#define MrsWatson_PluginChainRenderer_h
+
+#include "io/SampleSource.h"
+#include "plugin/PluginChain.h"
+#include "time/TaskTimer.h"
+
+/**
+ * Renders a stream of audio through a plugin chain to an output source, so
+ * that the output lines up with the input. The chain's processing delay is cut
+ * from the start of the output, and once the input has ended the chain is fed
+ * with silence until the delayed audio and the chain's tail have been written
+ * as well.
+ *
+ * Either the whole stream is rendered with pluginChainRendererRender(), or the
+ * caller drives the renderer one block at a time, so that it can send MIDI
+ * events or do other work between blocks. In that case the caller must advance
+ * the audio clock after each block.
+ */
+typedef struct {
+  PluginChain pluginChain;
+  SampleSource outputSource;
+  // Number of input frames which have been processed
+  unsigned long numFramesRead;
+  // Number of frames which have been written to the output source
+  unsigned long numFramesWritten;
+  // Timer which measures the time spent writing to the output, may be NULL
+  TaskTimer outputTimer;
+
+  // Private fields
+  unsigned long _processingDelay;
+  unsigned long _tailFrames;
+  // Number of frames which have come out of the chain, including the delay
+  unsigned long _framesProcessed;
+  SampleBuffer _outputBuffer;
+  SampleBuffer _silenceBuffer;
+  SampleBuffer _trimmedBuffer;
+} PluginChainRendererMembers;
+typedef PluginChainRendererMembers *PluginChainRenderer;
+
+/**
+ * Create a new renderer. The chain must have been initialized so that its
+ * processing delay is known, and the buffers are allocated with the current
+ * blocksize and channel count.
+ * @param pluginChain Plugin chain to process, which is not owned by the
+ * renderer
+ * @param outputSource Opened output source, which is not owned by the renderer
+ * @return Initialized object
+ */
+PluginChainRenderer newPluginChainRenderer(PluginChain pluginChain,
+                                           SampleSource outputSource);
+
+/**
+ * Process a block of input and write the part of the output which is not
+ * delayed by the chain.
+ * @param self
+ * @param inputBuffer Input block, which should be a full block. The final block
+ * of a stream may be padded with silence.
+ * @param numFrames Number of frames at the start of the block which belong to
+ * the input, and should therefore appear in the output
+ */
+void pluginChainRendererProcess(PluginChainRenderer self,
+                                SampleBuffer inputBuffer,
+                                unsigned long numFrames);
+
+/**
+ * Process a block of silence after the input has ended, and write the part of
+ * the output which is still owed. Nothing is done if the renderer is already
+ * finished.
+ * @param self
+ */
+void pluginChainRendererFlush(PluginChainRenderer self);
+
+/**
+ * Check whether the output is complete, which is the case once the output is
+ * as long as the input plus the tail time of the chain. This is only
+ * meaningful after the input has ended.
+ * @param self
+ * @return True if no more blocks need to be flushed
+ */
+boolByte pluginChainRendererIsFinished(PluginChainRenderer self);
+
+/**
+ * Render an entire input source, including the flush at the end, and advance
+ * the audio clock of the calling thread for each block.
+ * @param self
+ * @param inputSource Opened input source
+ */
+void pluginChainRendererRender(PluginChainRenderer self,
+                               SampleSource inputSource);
+
+/**
+ * Free the renderer. The plugin chain and output source are not freed.
+ * @param self
+ */
+void freePluginChainRenderer(PluginChainRenderer self);
+
+#endif
@@ -44,15 +44,19 @@ static void _pluginGainDisplayInfo(void *pluginPtr) {
 }
 
 static int _pluginGainGetSetting(void *pluginPtr, PluginSetting pluginSetting) {
+  Plugin plugin = (Plugin)pluginPtr;
+
   switch (pluginSetting) {
   case PLUGIN_SETTING_TAIL_TIME_IN_MS:
     return 0;
 
   case PLUGIN_NUM_INPUTS:
-    return 2;
+    // Channels are processed independently, so any number can be used
+    return plugin->inputBuffer != NULL ? plugin->inputBuffer->numChannels : 2;
 
   case PLUGIN_NUM_OUTPUTS:
-    return 2;
+    return plugin->outputBuffer != NULL ? plugin->outputBuffer->numChannels
+                                        : 2;
 
   default:
     return 0;
@@ -107,6 +111,8 @@ Plugin newPluginGain(const CharString pluginName) {
   plugin->displayInfo = _pluginGainDisplayInfo;
   plugin->getSetting = _pluginGainGetSetting;
   plugin->prepareForProcessing = _pluginGainEmpty;
+  plugin->resetPlugin = _pluginGainEmpty;
+  plugin->setNumChannels = _pluginAcceptAnyNumChannels;
   plugin->showEditor = _pluginGainEmpty;
   plugin->processAudio = _pluginGainProcessAudio;
   plugin->processMidiEvents = _pluginGainProcessMidiEvents;
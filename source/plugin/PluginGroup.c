@@ -0,0 +1,767 @@
+//
+// PluginGroup.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "PluginGroup.h"
+
+#include "logging/EventLogger.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static PluginGroupBranch _newBranch(PluginChain pluginChain) {
+  PluginGroupBranch branch =
+      (PluginGroupBranch)malloc(sizeof(PluginGroupBranchMembers));
+
+  branch->pluginChain = pluginChain;
+  branch->outputBuffer = NULL;
+  branch->firstChannel = 0;
+  branch->numChannels = 0;
+  branch->delayFrames = 0;
+  branch->_inputBuffer = NULL;
+  branch->_delayLine = NULL;
+  branch->_delayPosition = 0;
+
+  return branch;
+}
+
+static void _freeBranch(PluginGroupBranch branch) {
+  pluginChainShutdown(branch->pluginChain);
+  freePluginChain(branch->pluginChain);
+  freeSampleBuffer(branch->outputBuffer);
+  freeSampleBuffer(branch->_inputBuffer);
+  freeSampleBuffer(branch->_delayLine);
+  free(branch);
+}
+
+static void _freeBranches(PluginGroupData data) {
+  unsigned int i;
+
+  for (i = 0; i < data->numBranches; i++) {
+    _freeBranch(data->branches[i]);
+  }
+
+  free(data->branches);
+  data->branches = NULL;
+  data->numBranches = 0;
+}
+
+static Plugin _getFirstPlugin(PluginGroupBranch branch) {
+  return branch->pluginChain->plugins[0];
+}
+
+static Plugin _getLastPlugin(PluginGroupBranch branch) {
+  return branch->pluginChain->plugins[branch->pluginChain->numPlugins - 1];
+}
+
+static unsigned long _getMaxProcessingDelay(PluginGroupData data) {
+  unsigned long maxDelay = 0;
+  unsigned long delay;
+  unsigned int i;
+
+  for (i = 0; i < data->numBranches; i++) {
+    delay = pluginChainGetProcessingDelay(data->branches[i]->pluginChain);
+
+    if (delay > maxDelay) {
+      maxDelay = delay;
+    }
+  }
+
+  return maxDelay;
+}
+
+static void _delayBranch(PluginGroupBranch branch, SampleBuffer buffer) {
+  unsigned long position = 0;
+  unsigned long frame;
+  ChannelCount channel;
+  Sample sample;
+
+  if (branch->delayFrames == 0) {
+    return;
+  }
+
+  // Each sample is swapped with the one which entered the delay line
+  // delayFrames ago
+  for (channel = 0; channel < buffer->numChannels; channel++) {
+    position = branch->_delayPosition;
+
+    for (frame = 0; frame < buffer->blocksize; frame++) {
+      sample = branch->_delayLine->samples[channel][position];
+      branch->_delayLine->samples[channel][position] =
+          buffer->samples[channel][frame];
+      buffer->samples[channel][frame] = sample;
+
+      if (++position == branch->delayFrames) {
+        position = 0;
+      }
+    }
+  }
+
+  branch->_delayPosition = position;
+}
+
+static void _processBranch(PluginGroupBranch branch, SampleBuffer inputBuffer) {
+  ChannelCount channel;
+
+  // Branches of a channel group only receive their own channels
+  if (branch->_inputBuffer != NULL) {
+    branch->_inputBuffer->blocksize = inputBuffer->blocksize;
+
+    for (channel = 0; channel < branch->numChannels; channel++) {
+      memcpy(branch->_inputBuffer->samples[channel],
+             inputBuffer->samples[branch->firstChannel + channel],
+             sizeof(Sample) * inputBuffer->blocksize);
+    }
+
+    inputBuffer = branch->_inputBuffer;
+  }
+
+  branch->outputBuffer->blocksize = inputBuffer->blocksize;
+  pluginChainProcessAudio(branch->pluginChain, inputBuffer,
+                          branch->outputBuffer);
+  _delayBranch(branch, branch->outputBuffer);
+}
+
+// Must be called with the mutex locked
+static void _processPendingBranches(PluginGroupData data) {
+  unsigned int branchIndex;
+
+  // Branches are claimed one at a time, so that cheap branches don't leave
+  // threads idle while an expensive one is still running
+  while (data->_nextBranch < data->numBranches) {
+    branchIndex = data->_nextBranch++;
+    mutexUnlock(data->_mutex);
+    _processBranch(data->branches[branchIndex], data->_inputBuffer);
+    mutexLock(data->_mutex);
+
+    if (--data->_branchesPending == 0) {
+      conditionSignalAll(data->_blockDone);
+    }
+  }
+}
+
+static void _syncTransport(PluginGroupWorker worker, PluginGroupData data) {
+  memcpy(worker->_context->audioClock, &data->_clock,
+         sizeof(AudioClockMembers));
+
+  // The setters log each change, so only call them when something changed
+  if (getTempo() != data->_tempo) {
+    setTempo(data->_tempo);
+  }
+
+  if (getTimeSignatureBeatsPerMeasure() !=
+      data->_timeSignatureBeatsPerMeasure) {
+    setTimeSignatureBeatsPerMeasure(data->_timeSignatureBeatsPerMeasure);
+  }
+
+  if (getTimeSignatureNoteValue() != data->_timeSignatureNoteValue) {
+    setTimeSignatureNoteValue(data->_timeSignatureNoteValue);
+  }
+}
+
+static void _runWorker(void *userData) {
+  PluginGroupWorker worker = (PluginGroupWorker)userData;
+  PluginGroupData data = (PluginGroupData)worker->_plugin->extraData;
+
+  processingContextMakeCurrent(worker->_context);
+  mutexLock(data->_mutex);
+
+  while (true) {
+    while (!data->_shutdown && data->_blockNumber == worker->_lastBlockNumber) {
+      conditionWait(data->_blockReady, data->_mutex);
+    }
+
+    if (data->_shutdown) {
+      break;
+    }
+
+    worker->_lastBlockNumber = data->_blockNumber;
+    _syncTransport(worker, data);
+    _processPendingBranches(data);
+  }
+
+  mutexUnlock(data->_mutex);
+  processingContextMakeCurrent(NULL);
+}
+
+static void _stopWorkers(PluginGroupData data) {
+  PluginGroupWorker worker;
+  unsigned int i;
+
+  if (data->numWorkers == 0) {
+    return;
+  }
+
+  mutexLock(data->_mutex);
+  data->_shutdown = true;
+  conditionSignalAll(data->_blockReady);
+  mutexUnlock(data->_mutex);
+
+  for (i = 0; i < data->numWorkers; i++) {
+    worker = data->workers[i];
+    freeThread(worker->thread);
+    freeProcessingContext(worker->_context);
+    free(worker);
+  }
+
+  free(data->workers);
+  data->workers = NULL;
+  data->numWorkers = 0;
+  data->_shutdown = false;
+}
+
+static void _startWorkers(Plugin plugin) {
+  PluginGroupData data = (PluginGroupData)plugin->extraData;
+  PluginGroupWorker worker;
+  unsigned int numWorkers;
+  unsigned int i;
+
+  // The calling thread also processes branches, so one less worker is needed
+  numWorkers = data->numBranches - 1;
+
+  if (numWorkers == 0) {
+    return;
+  }
+
+  data->workers =
+      (PluginGroupWorker *)malloc(sizeof(PluginGroupWorker) * numWorkers);
+
+  for (i = 0; i < numWorkers; i++) {
+    worker = (PluginGroupWorker)malloc(sizeof(PluginGroupWorkerMembers));
+    worker->_plugin = plugin;
+    worker->_context = newProcessingContext();
+    worker->_lastBlockNumber = data->_blockNumber;
+    worker->thread = newThread(_runWorker, worker);
+
+    if (worker->thread == NULL) {
+      logWarn("Could only start %d of %d worker threads for plugin group", i,
+              numWorkers);
+      freeProcessingContext(worker->_context);
+      free(worker);
+      break;
+    }
+
+    threadPin(worker->thread, THREAD_PLACEMENT_COMPACT, i + 1);
+    data->workers[data->numWorkers++] = worker;
+  }
+}
+
+static boolByte _addBranch(PluginGroupData data, const CharString chainString) {
+  PluginChain pluginChain = newPluginChain();
+
+  data->branches[data->numBranches++] = _newBranch(pluginChain);
+
+  if (!pluginChainAddFromArgumentString(pluginChain, chainString,
+                                        data->pluginRoot)) {
+    return false;
+  } else if (pluginChain->numPlugins == 0) {
+    logError("Branch '%s' of plugin group has no plugins", chainString->data);
+    return false;
+  }
+
+  return (boolByte)(pluginChainInitialize(pluginChain) == RETURN_CODE_SUCCESS);
+}
+
+static boolByte _openBranches(PluginGroupData data) {
+  LinkedList branchStrings;
+  LinkedListIterator iterator;
+  boolByte result = true;
+
+  branchStrings = pluginChainSplitArgumentString(
+      data->groupString, CHAIN_STRING_BRANCH_SEPARATOR);
+
+  if (branchStrings == NULL) {
+    return false;
+  }
+
+  data->branches = (PluginGroupBranch *)malloc(
+      sizeof(PluginGroupBranch) * (linkedListLength(branchStrings) + 1));
+
+  for (iterator = branchStrings;
+       result && iterator != NULL && iterator->item != NULL;
+       iterator = iterator->nextItem) {
+    result = _addBranch(data, (CharString)iterator->item);
+  }
+
+  freeLinkedListAndItems(branchStrings, (LinkedListFreeItemFunc)freeCharString);
+  return result;
+}
+
+/**
+ * Get the width of each channel group for a layout, or NULL if the layout is
+ * invalid for the given number of channels.
+ */
+static ChannelCount *_parseChannelLayout(const CharString channelLayout,
+                                         ChannelCount numChannels,
+                                         unsigned int *numGroups) {
+  ChannelCount *groupWidths =
+      (ChannelCount *)malloc(sizeof(ChannelCount) * (numChannels + 1));
+  LinkedList widthStrings;
+  LinkedListIterator iterator;
+  ChannelCount totalWidth = 0;
+  long width;
+  char *end;
+
+  *numGroups = 0;
+
+  if (charStringIsEqualToCString(channelLayout, CHANNEL_LAYOUT_MONO, true) ||
+      charStringIsEqualToCString(channelLayout, CHANNEL_LAYOUT_STEREO, true)) {
+    width = charStringIsEqualToCString(channelLayout, CHANNEL_LAYOUT_MONO, true)
+                ? 1
+                : 2;
+
+    while (totalWidth < numChannels) {
+      groupWidths[*numGroups] = (ChannelCount)(
+          numChannels - totalWidth < width ? numChannels - totalWidth : width);
+      totalWidth += groupWidths[(*numGroups)++];
+    }
+
+    return groupWidths;
+  }
+
+  widthStrings = charStringSplit(channelLayout, CHANNEL_LAYOUT_SEPARATOR);
+
+  for (iterator = widthStrings; iterator != NULL && iterator->item != NULL;
+       iterator = iterator->nextItem) {
+    width = strtol(((CharString)iterator->item)->data, &end, 10);
+
+    if (*end != '\0' || width <= 0 || totalWidth + width > numChannels) {
+      totalWidth = 0;
+      break;
+    }
+
+    groupWidths[(*numGroups)++] = (ChannelCount)width;
+    totalWidth += (ChannelCount)width;
+  }
+
+  freeLinkedListAndItems(widthStrings, (LinkedListFreeItemFunc)freeCharString);
+
+  if (totalWidth != numChannels) {
+    logError("Channel layout '%s' does not match the %d input channels",
+             channelLayout->data, numChannels);
+    free(groupWidths);
+    return NULL;
+  }
+
+  return groupWidths;
+}
+
+static boolByte _openChannelGroups(PluginGroupData data) {
+  PluginGroupBranch branch;
+  ChannelCount *groupWidths;
+  ChannelCount firstChannel = 0;
+  unsigned int numGroups;
+  unsigned int i;
+  boolByte result = true;
+
+  groupWidths =
+      _parseChannelLayout(data->channelLayout, getNumChannels(), &numGroups);
+
+  if (groupWidths == NULL) {
+    return false;
+  }
+
+  data->branches =
+      (PluginGroupBranch *)malloc(sizeof(PluginGroupBranch) * (numGroups + 1));
+
+  for (i = 0; result && i < numGroups; i++) {
+    result = _addBranch(data, data->groupString);
+    branch = data->branches[data->numBranches - 1];
+    branch->firstChannel = firstChannel;
+    branch->numChannels = groupWidths[i];
+    branch->_inputBuffer = newSampleBuffer(branch->numChannels, getBlocksize());
+    pluginChainSetNumChannels(branch->pluginChain, branch->numChannels);
+    firstChannel += groupWidths[i];
+  }
+
+  free(groupWidths);
+  return result;
+}
+
+static boolByte _openPluginGroup(void *pluginPtr) {
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginGroupData data = (PluginGroupData)plugin->extraData;
+  PluginGroupBranch branch;
+  boolByte result;
+  unsigned int i;
+
+  if (charStringIsEmpty(data->channelLayout)) {
+    result = _openBranches(data);
+  } else {
+    result = _openChannelGroups(data);
+  }
+
+  if (result && data->numBranches == 0) {
+    logError("Plugin group '%s' has no branches", data->groupString->data);
+    result = false;
+  }
+
+  if (!result) {
+    _freeBranches(data);
+    return false;
+  }
+
+  plugin->pluginType = PLUGIN_TYPE_EFFECT;
+
+  for (i = 0; i < data->numBranches; i++) {
+    branch = data->branches[i];
+
+    if (_getFirstPlugin(branch)->pluginType == PLUGIN_TYPE_INSTRUMENT) {
+      plugin->pluginType = PLUGIN_TYPE_INSTRUMENT;
+    }
+
+    branch->outputBuffer = newSampleBuffer(
+        branch->numChannels > 0
+            ? branch->numChannels
+            : (ChannelCount)plugin->getSetting(plugin, PLUGIN_NUM_OUTPUTS),
+        getBlocksize());
+  }
+
+  return true;
+}
+
+static void _displayInfoPluginGroup(void *pluginPtr) {
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginGroupData data = (PluginGroupData)plugin->extraData;
+  unsigned int i;
+
+  logInfo("Information for plugin group '%s'", plugin->pluginName->data);
+  logInfo("Branches: %d, processing delay: %lu frames", data->numBranches,
+          _getMaxProcessingDelay(data));
+
+  for (i = 0; i < data->numBranches; i++) {
+    logInfo("Branch %d:", i + 1);
+    pluginChainInspect(data->branches[i]->pluginChain);
+  }
+}
+
+static int _getSettingPluginGroup(void *pluginPtr,
+                                  PluginSetting pluginSetting) {
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginGroupData data = (PluginGroupData)plugin->extraData;
+  int result = 0;
+  int value;
+  unsigned int i;
+
+  if (pluginSetting == PLUGIN_INITIAL_DELAY) {
+    return (int)_getMaxProcessingDelay(data);
+  } else if (!charStringIsEmpty(data->channelLayout) &&
+             (pluginSetting == PLUGIN_NUM_INPUTS ||
+              pluginSetting == PLUGIN_NUM_OUTPUTS)) {
+    // Channel groups are placed side by side rather than summed
+    for (i = 0; i < data->numBranches; i++) {
+      result += data->branches[i]->numChannels;
+    }
+
+    return result;
+  }
+
+  for (i = 0; i < data->numBranches; i++) {
+    switch (pluginSetting) {
+    case PLUGIN_SETTING_TAIL_TIME_IN_MS:
+      value =
+          pluginChainGetMaximumTailTimeInMs(data->branches[i]->pluginChain);
+      break;
+
+    case PLUGIN_NUM_INPUTS:
+      value = _getFirstPlugin(data->branches[i])->inputBuffer->numChannels;
+      break;
+
+    case PLUGIN_NUM_OUTPUTS:
+      value = _getLastPlugin(data->branches[i])->outputBuffer->numChannels;
+      break;
+
+    default:
+      value = 0;
+      break;
+    }
+
+    if (value > result) {
+      result = value;
+    }
+  }
+
+  return result;
+}
+
+static void _processAudioPluginGroup(void *pluginPtr, SampleBuffer inputs,
+                                     SampleBuffer outputs) {
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginGroupData data = (PluginGroupData)plugin->extraData;
+  AudioClock audioClock = getAudioClock();
+  PluginGroupBranch branch;
+  SampleBuffer branchOutput;
+  Samples outputChannel;
+  ChannelCount channel;
+  unsigned long frame;
+  unsigned int i;
+
+  if (data->numWorkers == 0) {
+    for (i = 0; i < data->numBranches; i++) {
+      _processBranch(data->branches[i], inputs);
+    }
+  } else {
+    mutexLock(data->_mutex);
+    data->_inputBuffer = inputs;
+    memcpy(&data->_clock, audioClock, sizeof(AudioClockMembers));
+    data->_tempo = getTempo();
+    data->_timeSignatureBeatsPerMeasure = getTimeSignatureBeatsPerMeasure();
+    data->_timeSignatureNoteValue = getTimeSignatureNoteValue();
+    data->_nextBranch = 0;
+    data->_branchesPending = data->numBranches;
+    data->_blockNumber++;
+    conditionSignalAll(data->_blockReady);
+    _processPendingBranches(data);
+
+    while (data->_branchesPending > 0) {
+      conditionWait(data->_blockDone, data->_mutex);
+    }
+
+    data->_inputBuffer = NULL;
+    mutexUnlock(data->_mutex);
+  }
+
+  sampleBufferClear(outputs);
+
+  for (i = 0; i < data->numBranches; i++) {
+    branch = data->branches[i];
+    branchOutput = branch->outputBuffer;
+
+    for (channel = 0;
+         branch->firstChannel + channel < outputs->numChannels &&
+         channel < branchOutput->numChannels;
+         channel++) {
+      outputChannel = outputs->samples[branch->firstChannel + channel];
+
+      for (frame = 0; frame < outputs->blocksize; frame++) {
+        outputChannel[frame] += branchOutput->samples[channel][frame];
+      }
+    }
+  }
+}
+
+static void _processMidiEventsPluginGroup(void *pluginPtr,
+                                          LinkedList midiEvents) {
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginGroupData data = (PluginGroupData)plugin->extraData;
+  unsigned int i;
+
+  for (i = 0; i < data->numBranches; i++) {
+    pluginChainProcessMidi(data->branches[i]->pluginChain, midiEvents);
+  }
+}
+
+static boolByte _setParameterPluginGroup(void *pluginPtr, unsigned int index,
+                                         float value) {
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginGroupData data = (PluginGroupData)plugin->extraData;
+  Plugin firstPlugin;
+  unsigned int i;
+
+  if (charStringIsEmpty(data->channelLayout)) {
+    logError("Attempt to set parameter %d on plugin group, which has none",
+             index);
+    return false;
+  }
+
+  // Each channel group runs the same chain, so they all get the parameter
+  for (i = 0; i < data->numBranches; i++) {
+    firstPlugin = _getFirstPlugin(data->branches[i]);
+
+    if (!firstPlugin->setParameter(firstPlugin, index, value)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static void _prepareForProcessingPluginGroup(void *pluginPtr) {
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginGroupData data = (PluginGroupData)plugin->extraData;
+  PluginGroupBranch branch;
+  unsigned long maxDelay;
+  unsigned int i;
+
+  _stopWorkers(data);
+
+  for (i = 0; i < data->numBranches; i++) {
+    pluginChainPrepareForProcessing(data->branches[i]->pluginChain);
+  }
+
+  // Plugins may only know their delay once they are prepared
+  maxDelay = _getMaxProcessingDelay(data);
+
+  for (i = 0; i < data->numBranches; i++) {
+    branch = data->branches[i];
+    branch->delayFrames =
+        maxDelay - pluginChainGetProcessingDelay(branch->pluginChain);
+    freeSampleBuffer(branch->_delayLine);
+    branch->_delayLine = NULL;
+    branch->_delayPosition = 0;
+
+    if (branch->delayFrames > 0) {
+      logDebug("Delaying branch %d of plugin group by %lu frames", i + 1,
+               branch->delayFrames);
+      branch->_delayLine = newSampleBuffer(branch->outputBuffer->numChannels,
+                                           branch->delayFrames);
+    }
+  }
+
+  _startWorkers(plugin);
+}
+
+static void _resetPluginGroup(void *pluginPtr) {
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginGroupData data = (PluginGroupData)plugin->extraData;
+  PluginGroupBranch branch;
+  unsigned int i;
+
+  for (i = 0; i < data->numBranches; i++) {
+    branch = data->branches[i];
+    pluginChainReset(branch->pluginChain);
+
+    if (branch->_delayLine != NULL) {
+      sampleBufferClear(branch->_delayLine);
+    }
+
+    branch->_delayPosition = 0;
+  }
+}
+
+static boolByte _setNumChannelsPluginGroup(void *pluginPtr,
+                                           ChannelCount numInputs,
+                                           ChannelCount numOutputs) {
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginGroupData data = (PluginGroupData)plugin->extraData;
+  PluginGroupBranch branch;
+  unsigned int i;
+
+  // The width of a group which is split by channel is fixed by its layout
+  if (!charStringIsEmpty(data->channelLayout)) {
+    return false;
+  }
+
+  // The branches negotiate with their own plugins when they are prepared
+  for (i = 0; i < data->numBranches; i++) {
+    branch = data->branches[i];
+    pluginChainSetNumChannels(branch->pluginChain, numOutputs);
+    freeSampleBuffer(branch->outputBuffer);
+    branch->outputBuffer = newSampleBuffer(numOutputs, getBlocksize());
+  }
+
+  return true;
+}
+
+static void _showEditorPluginGroup(void *pluginPtr) {
+  logUnsupportedFeature("Showing the editor of a plugin group");
+}
+
+static void _closePluginGroup(void *pluginPtr) {
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginGroupData data = (PluginGroupData)plugin->extraData;
+
+  _stopWorkers(data);
+  _freeBranches(data);
+}
+
+static void _freePluginGroupData(void *pluginDataPtr) {
+  PluginGroupData data = (PluginGroupData)pluginDataPtr;
+
+  _stopWorkers(data);
+  _freeBranches(data);
+  freeCharString(data->groupString);
+  freeCharString(data->channelLayout);
+  freeCharString(data->pluginRoot);
+  freeMutex(data->_mutex);
+  freeCondition(data->_blockReady);
+  freeCondition(data->_blockDone);
+}
+
+Plugin newPluginGroup(const CharString groupString,
+                      const CharString pluginRoot) {
+  Plugin plugin = _newPlugin(PLUGIN_TYPE_GROUP, PLUGIN_TYPE_UNKNOWN);
+  PluginGroupData data =
+      (PluginGroupData)malloc(sizeof(PluginGroupDataMembers));
+
+  charStringCopyCString(plugin->pluginName, "[");
+  charStringAppend(plugin->pluginName, groupString);
+  charStringAppendCString(plugin->pluginName, "]");
+  charStringCopyCString(plugin->pluginLocation, "Plugin group");
+
+  plugin->openPlugin = _openPluginGroup;
+  plugin->displayInfo = _displayInfoPluginGroup;
+  plugin->getSetting = _getSettingPluginGroup;
+  plugin->processAudio = _processAudioPluginGroup;
+  plugin->processMidiEvents = _processMidiEventsPluginGroup;
+  plugin->setParameter = _setParameterPluginGroup;
+  plugin->prepareForProcessing = _prepareForProcessingPluginGroup;
+  plugin->resetPlugin = _resetPluginGroup;
+  plugin->setNumChannels = _setNumChannelsPluginGroup;
+  plugin->showEditor = _showEditorPluginGroup;
+  plugin->closePlugin = _closePluginGroup;
+  plugin->freePluginData = _freePluginGroupData;
+
+  data->groupString = newCharStringWithCString(groupString->data);
+  data->channelLayout = newCharString();
+  data->pluginRoot = newCharStringWithCString(
+      pluginRoot != NULL ? pluginRoot->data : NULL);
+  data->branches = NULL;
+  data->numBranches = 0;
+  data->workers = NULL;
+  data->numWorkers = 0;
+
+  data->_mutex = newMutex();
+  data->_blockReady = newCondition();
+  data->_blockDone = newCondition();
+  data->_blockNumber = 0;
+  data->_nextBranch = 0;
+  data->_branchesPending = 0;
+  data->_shutdown = false;
+  data->_inputBuffer = NULL;
+  memset(&data->_clock, 0, sizeof(AudioClockMembers));
+  data->_tempo = 0;
+  data->_timeSignatureBeatsPerMeasure = 0;
+  data->_timeSignatureNoteValue = 0;
+  plugin->extraData = data;
+
+  return plugin;
+}
+
+Plugin newPluginGroupWithChannelLayout(const CharString chainString,
+                                       const CharString channelLayout,
+                                       const CharString pluginRoot) {
+  Plugin plugin = newPluginGroup(chainString, pluginRoot);
+  PluginGroupData data = (PluginGroupData)plugin->extraData;
+
+  charStringCopyCString(plugin->pluginName, "[");
+  charStringAppend(plugin->pluginName, chainString);
+  charStringAppendCString(plugin->pluginName, "] per ");
+  charStringAppend(plugin->pluginName, channelLayout);
+  charStringAppendCString(plugin->pluginName, " channel group");
+  charStringCopy(data->channelLayout, channelLayout);
+
+  return plugin;
+}
@@ -0,0 +1,157 @@
+//
+// PluginGroup.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_PluginGroup_h
+#define MrsWatson_PluginGroup_h
+
+#include "audio/AudioSettings.h"
+#include "base/Thread.h"
+#include "plugin/Plugin.h"
+#include "plugin/PluginChain.h"
+#include "plugin/ProcessingContext.h"
+#include "time/AudioClock.h"
+
+#define CHANNEL_LAYOUT_MONO "mono"
+#define CHANNEL_LAYOUT_STEREO "stereo"
+#define CHANNEL_LAYOUT_SEPARATOR ','
+
+/**
+ * One of the parallel chains in a plugin group, along with the delay line
+ * which lines its output up with the slowest branch.
+ */
+typedef struct {
+  PluginChain pluginChain;
+  SampleBuffer outputBuffer;
+  // Channels of the group which this branch processes, if the group is split
+  // by channel. Otherwise numChannels is 0 and the branch gets all channels.
+  ChannelCount firstChannel;
+  ChannelCount numChannels;
+  // Frames by which the output of this branch is delayed. This is the
+  // difference between its processing delay and that of the slowest branch.
+  unsigned long delayFrames;
+
+  // Private fields
+  SampleBuffer _inputBuffer;
+  SampleBuffer _delayLine;
+  unsigned long _delayPosition;
+} PluginGroupBranchMembers;
+typedef PluginGroupBranchMembers *PluginGroupBranch;
+
+/**
+ * Worker thread which processes branches of a group, along with its own copy
+ * of the transport state.
+ */
+typedef struct {
+  Thread thread;
+
+  // Private fields
+  Plugin _plugin;
+  ProcessingContext _context;
+  unsigned long _lastBlockNumber;
+} PluginGroupWorkerMembers;
+typedef PluginGroupWorkerMembers *PluginGroupWorker;
+
+typedef struct {
+  CharString groupString;
+  // Empty unless the group is split by channel
+  CharString channelLayout;
+  CharString pluginRoot;
+  PluginGroupBranch *branches;
+  unsigned int numBranches;
+  PluginGroupWorker *workers;
+  unsigned int numWorkers;
+
+  // Private fields, protected by _mutex
+  Mutex _mutex;
+  Condition _blockReady;
+  Condition _blockDone;
+  unsigned long _blockNumber;
+  unsigned int _nextBranch;
+  unsigned int _branchesPending;
+  boolByte _shutdown;
+  SampleBuffer _inputBuffer;
+  AudioClockMembers _clock;
+  Tempo _tempo;
+  unsigned short _timeSignatureBeatsPerMeasure;
+  unsigned short _timeSignatureNoteValue;
+} PluginGroupDataMembers;
+typedef PluginGroupDataMembers *PluginGroupData;
+
+/**
+ * Create a plugin which processes several plugin chains in parallel and sums
+ * their output. This allows for splits and parallel processing, such as
+ * multiband or parallel compression, within a single plugin chain.
+ *
+ * The group string contains one chain string per branch, separated by
+ * CHAIN_STRING_BRANCH_SEPARATOR. Each branch may itself contain groups, for
+ * example: "mrs_limiter|mrs_gain;[mrs_passthru|mrs_gain]". When the group is
+ * opened, the branches are created and opened, and when it is prepared for
+ * processing, one worker thread is started for each branch except the first,
+ * which is processed by the calling thread.
+ *
+ * Each branch receives the same input and MIDI events. The branch outputs are
+ * delayed so that they all have the processing delay of the slowest branch
+ * before they are summed, and the group reports that delay as its own.
+ *
+ * The group is an instrument if the first plugin of any branch is one, and
+ * otherwise an effect. It has as many inputs and outputs as the widest branch.
+ * The group itself has no parameters.
+ *
+ * @param groupString Chain strings of each branch, without the surrounding
+ * CHAIN_STRING_GROUP_START and CHAIN_STRING_GROUP_END characters
+ * @param pluginRoot User-provided search root path, may be NULL or empty
+ * @return Initialized object
+ */
+Plugin newPluginGroup(const CharString groupString,
+                      const CharString pluginRoot);
+
+/**
+ * Create a plugin group which splits its input into groups of channels and
+ * processes each one with its own copy of a plugin chain. The groups are
+ * processed in parallel like the branches of newPluginGroup(), and their
+ * output channels are put back in the same place rather than being summed.
+ * This allows files with many channels, such as multitrack stems, to be
+ * processed by stereo or mono plugins without their channels being folded
+ * together.
+ *
+ * The channel layout is either CHANNEL_LAYOUT_MONO, CHANNEL_LAYOUT_STEREO
+ * (where the last group is mono if there are an odd number of channels), or a
+ * list of group widths separated by CHANNEL_LAYOUT_SEPARATOR, such as "2,2,1"
+ * for two stereo pairs followed by a mono channel. The layout is applied to
+ * the channel count of the audio settings when the group is opened, and the
+ * widths of an explicit layout must add up to that count. Parameters which are
+ * set on the group are passed on to the first plugin of each channel group.
+ *
+ * @param chainString Chain string used for each channel group
+ * @param channelLayout Channel layout, as described above
+ * @param pluginRoot User-provided search root path, may be NULL or empty
+ * @return Initialized object
+ */
+Plugin newPluginGroupWithChannelLayout(const CharString chainString,
+                                       const CharString channelLayout,
+                                       const CharString pluginRoot);
+
+#endif
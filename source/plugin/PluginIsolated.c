@@ -0,0 +1,793 @@
+//
+// PluginIsolated.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "PluginIsolated.h"
+
+#include "audio/AudioSettings.h"
+#include "logging/EventLogger.h"
+#include "midi/MidiEvent.h"
+#include "plugin/PluginPreset.h"
+#include "time/AudioClock.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if UNIX
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+typedef enum {
+  PLUGIN_ISOLATED_COMMAND_DISPLAY_INFO,
+  PLUGIN_ISOLATED_COMMAND_GET_SETTING,
+  PLUGIN_ISOLATED_COMMAND_PROCESS,
+  PLUGIN_ISOLATED_COMMAND_SET_PARAMETER,
+  PLUGIN_ISOLATED_COMMAND_PREPARE,
+  PLUGIN_ISOLATED_COMMAND_RESET,
+  PLUGIN_ISOLATED_COMMAND_CLOSE
+} PluginIsolatedCommand;
+
+// MIDI events are copied into shared memory without their extra data, so only
+// regular events (ie, not sysex) can be sent to the worker
+typedef struct {
+  MidiEventType eventType;
+  unsigned long deltaFrames;
+  unsigned long timestamp;
+  byte status;
+  byte data1;
+  byte data2;
+} PluginIsolatedMidiEvent;
+
+// Header of the shared memory region, which is followed by the planar input
+// and output samples. Requests are written here by the host before the worker
+// is signaled, and results are written by the worker before it replies.
+typedef struct {
+  PluginIsolatedCommand command;
+  boolByte result;
+
+  // Settings of the hosted plugin, set when it is opened
+  PluginType pluginType;
+  int numInputs;
+  int numOutputs;
+
+  // Request arguments and results
+  PluginSetting setting;
+  int settingValue;
+  unsigned int parameterIndex;
+  float parameterValue;
+
+  // Audio block and transport state for PLUGIN_ISOLATED_COMMAND_PROCESS
+  SampleCount blocksize;
+  ChannelCount numInputChannels;
+  ChannelCount numOutputChannels;
+  AudioClockMembers audioClock;
+  Tempo tempo;
+  unsigned short timeSignatureBeatsPerMeasure;
+  unsigned short timeSignatureNoteValue;
+  unsigned int numMidiEvents;
+  PluginIsolatedMidiEvent midiEvents[PLUGIN_ISOLATED_MAX_MIDI_EVENTS];
+} PluginIsolatedSharedMembers;
+typedef PluginIsolatedSharedMembers *PluginIsolatedShared;
+#endif
+
+typedef struct {
+  CharString pluginName;
+  CharString pluginRoot;
+  CharString presetName;
+
+#if UNIX
+  PluginIsolatedShared shared;
+  size_t sharedSize;
+  SampleCount maxBlocksize;
+  pid_t workerPid;
+  pid_t ownerPid;
+  int requestPipe;
+  int responsePipe;
+  boolByte failed;
+#endif
+} PluginIsolatedDataMembers;
+typedef PluginIsolatedDataMembers *PluginIsolatedData;
+
+#if UNIX
+static unsigned int _numSharedRegions = 0;
+
+static Samples _getSharedInput(PluginIsolatedData data, ChannelCount channel) {
+  return (Samples)(data->shared + 1) + channel * data->maxBlocksize;
+}
+
+static Samples _getSharedOutput(PluginIsolatedData data,
+                                ChannelCount channel) {
+  return _getSharedInput(data, PLUGIN_ISOLATED_MAX_CHANNELS) +
+         channel * data->maxBlocksize;
+}
+
+static void _stopWorker(PluginIsolatedData data, boolByte force) {
+  int status;
+
+  if (data->workerPid <= 0) {
+    return;
+  }
+
+  close(data->requestPipe);
+  close(data->responsePipe);
+
+  if (force) {
+    kill(data->workerPid, SIGKILL);
+  }
+
+  while (waitpid(data->workerPid, &status, 0) < 0 && errno == EINTR) {
+  }
+
+  data->workerPid = 0;
+}
+
+static void _workerFailed(Plugin plugin, const char *reason) {
+  PluginIsolatedData data = (PluginIsolatedData)plugin->extraData;
+
+  if (!data->failed) {
+    logError("Worker process for plugin '%s' %s, the plugin will output "
+             "silence",
+             plugin->pluginName->data, reason);
+    data->failed = true;
+  }
+
+  _stopWorker(data, true);
+}
+
+/**
+ * Send a request to the worker and wait for it to finish.
+ * @return True if the worker answered, false if it has crashed or hung
+ */
+static boolByte _sendCommand(Plugin plugin, PluginIsolatedCommand command,
+                             int timeoutMs) {
+  PluginIsolatedData data = (PluginIsolatedData)plugin->extraData;
+  struct pollfd responsePoll;
+  char wakeup = 0;
+  ssize_t result;
+  int pollResult;
+
+  if (data->failed) {
+    return false;
+  } else if (data->ownerPid != getpid()) {
+    // After a fork, the worker still belongs to the parent process, and using
+    // it from both processes would corrupt the shared buffers
+    logError("Isolated plugin '%s' cannot be used from a forked process",
+             plugin->pluginName->data);
+    data->failed = true;
+    return false;
+  }
+
+  data->shared->command = command;
+
+  do {
+    result = write(data->requestPipe, &wakeup, 1);
+  } while (result < 0 && errno == EINTR);
+
+  if (result != 1) {
+    _workerFailed(plugin, "has exited");
+    return false;
+  }
+
+  responsePoll.fd = data->responsePipe;
+  responsePoll.events = POLLIN;
+
+  do {
+    pollResult = poll(&responsePoll, 1, timeoutMs);
+  } while (pollResult < 0 && errno == EINTR);
+
+  if (pollResult == 0) {
+    _workerFailed(plugin, "stopped responding");
+    return false;
+  }
+
+  do {
+    result = read(data->responsePipe, &wakeup, 1);
+  } while (result < 0 && errno == EINTR);
+
+  if (result != 1) {
+    _workerFailed(plugin, "has crashed");
+    return false;
+  }
+
+  return true;
+}
+
+static boolByte _workerLoadPreset(Plugin plugin, const CharString presetName) {
+  PluginPreset preset = pluginPresetFactory(presetName);
+  boolByte result = false;
+
+  if (preset == NULL) {
+    logError("Could not find preset '%s'", presetName->data);
+  } else if (!pluginPresetIsCompatibleWith(preset, plugin)) {
+    logError("Preset '%s' is not a compatible format for plugin",
+             presetName->data);
+  } else if (!preset->openPreset(preset)) {
+    logError("Could not open preset '%s'", presetName->data);
+  } else if (!preset->loadPreset(preset, plugin)) {
+    logError("Could not load preset '%s' in plugin '%s'", presetName->data,
+             plugin->pluginName->data);
+  } else {
+    logInfo("Loaded preset '%s' in plugin '%s'", presetName->data,
+            plugin->pluginName->data);
+    result = true;
+  }
+
+  freePluginPreset(preset);
+  return result;
+}
+
+static Plugin _workerOpenPlugin(PluginIsolatedData data) {
+  PluginIsolatedShared shared = data->shared;
+  Plugin plugin = pluginFactory(data->pluginName, data->pluginRoot);
+
+  // If the plugin can't be opened, it is not freed since some plugin types
+  // can only be freed once open, and the worker exits right away anyways
+  if (plugin == NULL || !openPlugin(plugin)) {
+    return NULL;
+  }
+
+  shared->pluginType = plugin->pluginType;
+  shared->numInputs = plugin->getSetting(plugin, PLUGIN_NUM_INPUTS);
+  shared->numOutputs = plugin->getSetting(plugin, PLUGIN_NUM_OUTPUTS);
+
+  if (shared->numInputs > PLUGIN_ISOLATED_MAX_CHANNELS ||
+      shared->numOutputs > PLUGIN_ISOLATED_MAX_CHANNELS) {
+    logError("Plugin '%s' has more than %d channels and cannot be isolated",
+             plugin->pluginName->data, PLUGIN_ISOLATED_MAX_CHANNELS);
+  } else if (charStringIsEmpty(data->presetName) ||
+             _workerLoadPreset(plugin, data->presetName)) {
+    return plugin;
+  }
+
+  closePlugin(plugin);
+  freePlugin(plugin);
+  return NULL;
+}
+
+static void _workerProcess(PluginIsolatedData data, Plugin plugin,
+                           MidiEventMembers *midiEvents,
+                           LinkedListBuffer midiEventList) {
+  PluginIsolatedShared shared = data->shared;
+  Samples inputSamples[PLUGIN_ISOLATED_MAX_CHANNELS];
+  Samples outputSamples[PLUGIN_ISOLATED_MAX_CHANNELS];
+  SampleBufferMembers inputs;
+  SampleBufferMembers outputs;
+  AudioClock audioClock = getAudioClock();
+  unsigned int i;
+
+  // The host's transport state is copied for plugins which ask for the time
+  // info, since the worker has no clock of its own
+  audioClock->currentFrame = shared->audioClock.currentFrame;
+  audioClock->isPlaying = shared->audioClock.isPlaying;
+  audioClock->transportChanged = shared->audioClock.transportChanged;
+
+  if (shared->tempo != getTempo()) {
+    setTempo(shared->tempo);
+  }
+
+  if (shared->timeSignatureBeatsPerMeasure !=
+      getTimeSignatureBeatsPerMeasure()) {
+    setTimeSignatureBeatsPerMeasure(shared->timeSignatureBeatsPerMeasure);
+  }
+
+  if (shared->timeSignatureNoteValue != getTimeSignatureNoteValue()) {
+    setTimeSignatureNoteValue(shared->timeSignatureNoteValue);
+  }
+
+  if (shared->numMidiEvents > 0) {
+    linkedListBufferClear(midiEventList);
+
+    for (i = 0; i < shared->numMidiEvents; i++) {
+      midiEvents[i].eventType = shared->midiEvents[i].eventType;
+      midiEvents[i].deltaFrames = shared->midiEvents[i].deltaFrames;
+      midiEvents[i].timestamp = shared->midiEvents[i].timestamp;
+      midiEvents[i].status = shared->midiEvents[i].status;
+      midiEvents[i].data1 = shared->midiEvents[i].data1;
+      midiEvents[i].data2 = shared->midiEvents[i].data2;
+      midiEvents[i].extraData = NULL;
+      linkedListBufferAppend(midiEventList, &midiEvents[i]);
+    }
+
+    plugin->processMidiEvents(plugin, linkedListBufferGetList(midiEventList));
+  }
+
+  // The plugin reads and writes the shared memory directly
+  for (i = 0; i < shared->numInputChannels; i++) {
+    inputSamples[i] = _getSharedInput(data, i);
+  }
+
+  for (i = 0; i < shared->numOutputChannels; i++) {
+    outputSamples[i] = _getSharedOutput(data, i);
+  }
+
+  inputs.numChannels = shared->numInputChannels;
+  inputs.blocksize = shared->blocksize;
+  inputs.samples = inputSamples;
+  outputs.numChannels = shared->numOutputChannels;
+  outputs.blocksize = shared->blocksize;
+  outputs.samples = outputSamples;
+  plugin->processAudio(plugin, &inputs, &outputs);
+}
+
+static void _runWorker(PluginIsolatedData data, int requestPipe,
+                       int responsePipe) {
+  PluginIsolatedShared shared = data->shared;
+  MidiEventMembers midiEvents[PLUGIN_ISOLATED_MAX_MIDI_EVENTS];
+  LinkedListBuffer midiEventList =
+      newLinkedListBuffer(PLUGIN_ISOLATED_MAX_MIDI_EVENTS);
+  Plugin plugin = _workerOpenPlugin(data);
+  boolByte running = true;
+  char wakeup = 0;
+  ssize_t result;
+
+  shared->result = (boolByte)(plugin != NULL);
+  running = (boolByte)(write(responsePipe, &wakeup, 1) == 1 && plugin != NULL);
+
+  while (running) {
+    do {
+      result = read(requestPipe, &wakeup, 1);
+    } while (result < 0 && errno == EINTR);
+
+    // If the host has exited, then there is nothing left to do
+    if (result != 1) {
+      break;
+    }
+
+    shared->result = true;
+
+    switch (shared->command) {
+    case PLUGIN_ISOLATED_COMMAND_DISPLAY_INFO:
+      plugin->displayInfo(plugin);
+      break;
+
+    case PLUGIN_ISOLATED_COMMAND_GET_SETTING:
+      shared->settingValue = plugin->getSetting(plugin, shared->setting);
+      break;
+
+    case PLUGIN_ISOLATED_COMMAND_PROCESS:
+      _workerProcess(data, plugin, midiEvents, midiEventList);
+      break;
+
+    case PLUGIN_ISOLATED_COMMAND_SET_PARAMETER:
+      shared->result = plugin->setParameter(plugin, shared->parameterIndex,
+                                            shared->parameterValue);
+      break;
+
+    case PLUGIN_ISOLATED_COMMAND_PREPARE:
+      plugin->prepareForProcessing(plugin);
+      break;
+
+    case PLUGIN_ISOLATED_COMMAND_RESET:
+      plugin->resetPlugin(plugin);
+      break;
+
+    case PLUGIN_ISOLATED_COMMAND_CLOSE:
+      running = false;
+      break;
+
+    default:
+      logInternalError("Unknown isolated plugin command %d", shared->command);
+      shared->result = false;
+      break;
+    }
+
+    if (shared->command == PLUGIN_ISOLATED_COMMAND_CLOSE) {
+      // The plugin is closed before replying, so that the host knows that any
+      // files written by the plugin are complete
+      closePlugin(plugin);
+      freePlugin(plugin);
+      plugin = NULL;
+    }
+
+    if (write(responsePipe, &wakeup, 1) != 1) {
+      break;
+    }
+  }
+
+  if (plugin != NULL) {
+    closePlugin(plugin);
+    freePlugin(plugin);
+  }
+
+  freeLinkedListBuffer(midiEventList);
+
+  fflush(NULL);
+  _exit(0);
+}
+
+static boolByte _createSharedMemory(PluginIsolatedData data) {
+  char name[64];
+  int fd;
+
+  data->maxBlocksize = getBlocksize();
+  data->sharedSize = sizeof(PluginIsolatedSharedMembers) +
+                     sizeof(Sample) * 2 * PLUGIN_ISOLATED_MAX_CHANNELS *
+                         data->maxBlocksize;
+
+  // The name is removed again as soon as the region is mapped, after which
+  // it is only reachable by this process and the worker forked from it
+  snprintf(name, 64, "/mrswatson-%ld-%u", (long)getpid(), _numSharedRegions++);
+  fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+
+  if (fd < 0) {
+    logError("Could not create shared memory, %s", stringForLastError(errno));
+    return false;
+  }
+
+  shm_unlink(name);
+
+  if (ftruncate(fd, (off_t)data->sharedSize) != 0) {
+    logError("Could not allocate shared memory, %s",
+             stringForLastError(errno));
+    close(fd);
+    return false;
+  }
+
+  data->shared = (PluginIsolatedShared)mmap(
+      NULL, data->sharedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+
+  if (data->shared == MAP_FAILED) {
+    logError("Could not map shared memory, %s", stringForLastError(errno));
+    data->shared = NULL;
+    return false;
+  }
+
+  memset(data->shared, 0, sizeof(PluginIsolatedSharedMembers));
+  return true;
+}
+
+static boolByte _startWorker(Plugin plugin) {
+  PluginIsolatedData data = (PluginIsolatedData)plugin->extraData;
+  struct sigaction pipeAction;
+  int requestPipe[2];
+  int responsePipe[2];
+
+  // A write to a crashed worker should fail with EPIPE rather than killing
+  // the host, unless the application has already set its own handler
+  if (sigaction(SIGPIPE, NULL, &pipeAction) == 0 &&
+      pipeAction.sa_handler == SIG_DFL) {
+    pipeAction.sa_handler = SIG_IGN;
+    sigaction(SIGPIPE, &pipeAction, NULL);
+  }
+
+  if (pipe(requestPipe) != 0) {
+    logError("Could not create pipe, %s", stringForLastError(errno));
+    return false;
+  } else if (pipe(responsePipe) != 0) {
+    logError("Could not create pipe, %s", stringForLastError(errno));
+    close(requestPipe[0]);
+    close(requestPipe[1]);
+    return false;
+  }
+
+  // Anything still buffered would otherwise be written by both processes
+  fflush(NULL);
+  data->workerPid = fork();
+
+  if (data->workerPid == 0) {
+    close(requestPipe[1]);
+    close(responsePipe[0]);
+    _runWorker(data, requestPipe[0], responsePipe[1]);
+  }
+
+  close(requestPipe[0]);
+  close(responsePipe[1]);
+  data->requestPipe = requestPipe[1];
+  data->responsePipe = responsePipe[0];
+
+  if (data->workerPid < 0) {
+    logError("Could not start worker process, %s", stringForLastError(errno));
+    close(data->requestPipe);
+    close(data->responsePipe);
+    data->workerPid = 0;
+    return false;
+  }
+
+  data->ownerPid = getpid();
+  logDebug("Started worker process %ld for plugin '%s'", (long)data->workerPid,
+           plugin->pluginName->data);
+  return true;
+}
+#endif
+
+static boolByte _openPluginIsolated(void *pluginPtr) {
+#if UNIX
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginIsolatedData data = (PluginIsolatedData)plugin->extraData;
+  struct pollfd responsePoll;
+  char wakeup;
+
+  if (!_createSharedMemory(data) || !_startWorker(plugin)) {
+    return false;
+  }
+
+  // Opening a plugin may take a long time, so there is no timeout here
+  responsePoll.fd = data->responsePipe;
+  responsePoll.events = POLLIN;
+
+  while (poll(&responsePoll, 1, -1) < 0 && errno == EINTR) {
+  }
+
+  if (read(data->responsePipe, &wakeup, 1) != 1 || !data->shared->result) {
+    logError("Worker process could not open plugin '%s'",
+             plugin->pluginName->data);
+    _stopWorker(data, false);
+    return false;
+  }
+
+  plugin->pluginType = data->shared->pluginType;
+  data->failed = false;
+  return true;
+#else
+  return false;
+#endif
+}
+
+static void _displayInfoPluginIsolated(void *pluginPtr) {
+#if UNIX
+  Plugin plugin = (Plugin)pluginPtr;
+  logInfo("Plugin '%s' is hosted in a separate process",
+          plugin->pluginName->data);
+  _sendCommand(plugin, PLUGIN_ISOLATED_COMMAND_DISPLAY_INFO,
+               PLUGIN_ISOLATED_TIMEOUT_MS);
+#endif
+}
+
+static int _getSettingPluginIsolated(void *pluginPtr,
+                                     PluginSetting pluginSetting) {
+#if UNIX
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginIsolatedData data = (PluginIsolatedData)plugin->extraData;
+
+  // The channel counts are also needed after the worker has failed, since the
+  // host keeps processing audio with buffers of this size
+  switch (pluginSetting) {
+  case PLUGIN_NUM_INPUTS:
+    return data->shared->numInputs;
+
+  case PLUGIN_NUM_OUTPUTS:
+    return data->shared->numOutputs;
+
+  default:
+    data->shared->setting = pluginSetting;
+
+    if (!_sendCommand(plugin, PLUGIN_ISOLATED_COMMAND_GET_SETTING,
+                      PLUGIN_ISOLATED_TIMEOUT_MS)) {
+      return 0;
+    }
+
+    return data->shared->settingValue;
+  }
+#else
+  return 0;
+#endif
+}
+
+static void _processAudioPluginIsolated(void *pluginPtr, SampleBuffer inputs,
+                                        SampleBuffer outputs) {
+#if UNIX
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginIsolatedData data = (PluginIsolatedData)plugin->extraData;
+  PluginIsolatedShared shared = data->shared;
+  AudioClock audioClock = getAudioClock();
+  ChannelCount i;
+
+  if (inputs->blocksize > data->maxBlocksize ||
+      inputs->numChannels > PLUGIN_ISOLATED_MAX_CHANNELS ||
+      outputs->numChannels > PLUGIN_ISOLATED_MAX_CHANNELS) {
+    logError("Block is too large for isolated plugin '%s'",
+             plugin->pluginName->data);
+    sampleBufferClear(outputs);
+    return;
+  }
+
+  shared->blocksize = inputs->blocksize;
+  shared->numInputChannels = inputs->numChannels;
+  shared->numOutputChannels = outputs->numChannels;
+  shared->audioClock.currentFrame = audioClock->currentFrame;
+  shared->audioClock.isPlaying = audioClock->isPlaying;
+  shared->audioClock.transportChanged = audioClock->transportChanged;
+  shared->tempo = getTempo();
+  shared->timeSignatureBeatsPerMeasure = getTimeSignatureBeatsPerMeasure();
+  shared->timeSignatureNoteValue = getTimeSignatureNoteValue();
+
+  for (i = 0; i < inputs->numChannels; i++) {
+    memcpy(_getSharedInput(data, i), inputs->samples[i],
+           sizeof(Sample) * inputs->blocksize);
+  }
+
+  // Any MIDI events were queued by _processMidiEventsPluginIsolated(), and
+  // are sent together with the audio to save a round trip to the worker
+  if (!_sendCommand(plugin, PLUGIN_ISOLATED_COMMAND_PROCESS,
+                    PLUGIN_ISOLATED_TIMEOUT_MS)) {
+    shared->numMidiEvents = 0;
+    sampleBufferClear(outputs);
+    return;
+  }
+
+  shared->numMidiEvents = 0;
+
+  for (i = 0; i < outputs->numChannels; i++) {
+    memcpy(outputs->samples[i], _getSharedOutput(data, i),
+           sizeof(Sample) * outputs->blocksize);
+  }
+#endif
+}
+
+static void _processMidiEventsPluginIsolated(void *pluginPtr,
+                                             LinkedList midiEvents) {
+#if UNIX
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginIsolatedData data = (PluginIsolatedData)plugin->extraData;
+  PluginIsolatedShared shared = data->shared;
+  LinkedListIterator iterator;
+  MidiEvent midiEvent;
+
+  for (iterator = midiEvents; iterator != NULL && iterator->item != NULL;
+       iterator = iterator->nextItem) {
+    midiEvent = (MidiEvent)iterator->item;
+
+    if (midiEvent->eventType == MIDI_TYPE_SYSEX) {
+      logUnsupportedFeature("Sysex events for isolated plugins");
+    } else if (shared->numMidiEvents == PLUGIN_ISOLATED_MAX_MIDI_EVENTS) {
+      logWarn("Too many MIDI events for isolated plugin '%s' in one block",
+              plugin->pluginName->data);
+      break;
+    } else {
+      shared->midiEvents[shared->numMidiEvents].eventType =
+          midiEvent->eventType;
+      shared->midiEvents[shared->numMidiEvents].deltaFrames =
+          midiEvent->deltaFrames;
+      shared->midiEvents[shared->numMidiEvents].timestamp =
+          midiEvent->timestamp;
+      shared->midiEvents[shared->numMidiEvents].status = midiEvent->status;
+      shared->midiEvents[shared->numMidiEvents].data1 = midiEvent->data1;
+      shared->midiEvents[shared->numMidiEvents].data2 = midiEvent->data2;
+      shared->numMidiEvents++;
+    }
+  }
+#endif
+}
+
+static boolByte _setParameterPluginIsolated(void *pluginPtr, unsigned int index,
+                                            float value) {
+#if UNIX
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginIsolatedData data = (PluginIsolatedData)plugin->extraData;
+
+  data->shared->parameterIndex = index;
+  data->shared->parameterValue = value;
+  return (boolByte)(_sendCommand(plugin, PLUGIN_ISOLATED_COMMAND_SET_PARAMETER,
+                                 PLUGIN_ISOLATED_TIMEOUT_MS) &&
+                    data->shared->result);
+#else
+  return false;
+#endif
+}
+
+static void _prepareForProcessingPluginIsolated(void *pluginPtr) {
+#if UNIX
+  _sendCommand((Plugin)pluginPtr, PLUGIN_ISOLATED_COMMAND_PREPARE,
+               PLUGIN_ISOLATED_TIMEOUT_MS);
+#endif
+}
+
+static void _resetPluginIsolated(void *pluginPtr) {
+#if UNIX
+  _sendCommand((Plugin)pluginPtr, PLUGIN_ISOLATED_COMMAND_RESET,
+               PLUGIN_ISOLATED_TIMEOUT_MS);
+#endif
+}
+
+static void _showEditorPluginIsolated(void *pluginPtr) {
+  logUnsupportedFeature("Showing the editor of an isolated plugin");
+}
+
+static void _closePluginIsolated(void *pluginPtr) {
+#if UNIX
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginIsolatedData data = (PluginIsolatedData)plugin->extraData;
+
+  if (data->workerPid > 0 && data->ownerPid == getpid()) {
+    _sendCommand(plugin, PLUGIN_ISOLATED_COMMAND_CLOSE,
+                 PLUGIN_ISOLATED_TIMEOUT_MS);
+    _stopWorker(data, false);
+  }
+#endif
+}
+
+static void _freePluginIsolatedData(void *pluginDataPtr) {
+  PluginIsolatedData data = (PluginIsolatedData)pluginDataPtr;
+
+#if UNIX
+  // A worker which was never closed is only stopped by the process which
+  // started it, a forked copy of the host must leave it alone
+  if (data->workerPid > 0 && data->ownerPid == getpid()) {
+    _stopWorker(data, true);
+  }
+
+  if (data->shared != NULL) {
+    munmap(data->shared, data->sharedSize);
+  }
+#endif
+
+  freeCharString(data->pluginName);
+  freeCharString(data->pluginRoot);
+  freeCharString(data->presetName);
+}
+
+Plugin newPluginIsolated(const CharString pluginName,
+                         const CharString pluginRoot,
+                         const CharString presetName) {
+#if UNIX
+  Plugin plugin = _newPlugin(PLUGIN_TYPE_ISOLATED, PLUGIN_TYPE_UNKNOWN);
+  PluginIsolatedData data =
+      (PluginIsolatedData)malloc(sizeof(PluginIsolatedDataMembers));
+
+  charStringCopy(plugin->pluginName, pluginName);
+  charStringCopyCString(plugin->pluginLocation, "Worker process");
+
+  plugin->openPlugin = _openPluginIsolated;
+  plugin->displayInfo = _displayInfoPluginIsolated;
+  plugin->getSetting = _getSettingPluginIsolated;
+  plugin->processAudio = _processAudioPluginIsolated;
+  plugin->processMidiEvents = _processMidiEventsPluginIsolated;
+  plugin->setParameter = _setParameterPluginIsolated;
+  plugin->prepareForProcessing = _prepareForProcessingPluginIsolated;
+  plugin->resetPlugin = _resetPluginIsolated;
+  plugin->showEditor = _showEditorPluginIsolated;
+  plugin->closePlugin = _closePluginIsolated;
+  plugin->freePluginData = _freePluginIsolatedData;
+
+  data->pluginName = newCharStringWithCString(pluginName->data);
+  data->pluginRoot = newCharStringWithCString(
+      pluginRoot != NULL ? pluginRoot->data : NULL);
+  data->presetName = newCharStringWithCString(
+      presetName != NULL ? presetName->data : NULL);
+  data->shared = NULL;
+  data->sharedSize = 0;
+  data->maxBlocksize = 0;
+  data->workerPid = 0;
+  data->ownerPid = 0;
+  data->requestPipe = -1;
+  data->responsePipe = -1;
+  data->failed = false;
+  plugin->extraData = data;
+
+  return plugin;
+#else
+  logUnsupportedFeature("Isolated plugins on this platform");
+  return NULL;
+#endif
+}
@@ -0,0 +1,65 @@
+//
+// PluginIsolated.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_PluginIsolated_h
+#define MrsWatson_PluginIsolated_h
+
+#include "plugin/Plugin.h"
+
+// Largest number of inputs or outputs supported for an isolated plugin
+#define PLUGIN_ISOLATED_MAX_CHANNELS 64
+// Largest number of MIDI events which can be sent to the plugin in one block
+#define PLUGIN_ISOLATED_MAX_MIDI_EVENTS 512
+// Time to wait for the worker to answer a request, other than opening the
+// plugin, before it is considered to be hung and is killed
+#define PLUGIN_ISOLATED_TIMEOUT_MS 30000
+
+/**
+ * Create a plugin which is hosted in a separate worker process. The real
+ * plugin (and its preset, if given) is found and opened by the worker when
+ * this plugin is opened, and is closed when this plugin is closed. Otherwise,
+ * this plugin behaves exactly like the plugin that it hosts.
+ *
+ * Audio, MIDI events and the transport position are exchanged through a shared
+ * memory region, and each request to the worker is signaled with a pipe. Since
+ * each worker is a separate process, plugins which are not thread-safe or not
+ * safe to instantiate more than once may be used by several chains at the same
+ * time. If the worker crashes or stops responding, an error is logged and the
+ * plugin outputs silence instead of taking down the host.
+ *
+ * An isolated plugin may only be used by the process which opened it. Not
+ * supported on Windows.
+ *
+ * @param pluginName Name of the plugin to host, as given to pluginFactory()
+ * @param pluginRoot User-provided search root path, may be NULL or empty
+ * @param presetName Preset to load in the plugin, may be NULL or empty
+ * @return Initialized object, or NULL if not supported on this platform
+ */
+Plugin newPluginIsolated(const CharString pluginName,
+                         const CharString pluginRoot,
+                         const CharString presetName);
+
+#endif
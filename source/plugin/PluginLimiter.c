@@ -45,15 +45,19 @@ static void _pluginLimiterDisplayInfo(void *pluginPtr) {
 
 static int _pluginLimiterGetSetting(void *pluginPtr,
                                     PluginSetting pluginSetting) {
+  Plugin plugin = (Plugin)pluginPtr;
+
   switch (pluginSetting) {
   case PLUGIN_SETTING_TAIL_TIME_IN_MS:
     return 0;
 
   case PLUGIN_NUM_INPUTS:
-    return 2;
+    // Channels are processed independently, so any number can be used
+    return plugin->inputBuffer != NULL ? plugin->inputBuffer->numChannels : 2;
 
   case PLUGIN_NUM_OUTPUTS:
-    return 2;
+    return plugin->outputBuffer != NULL ? plugin->outputBuffer->numChannels
+                                        : 2;
 
   default:
     return 0;
@@ -96,6 +100,8 @@ Plugin newPluginLimiter(const CharString pluginName) {
   plugin->displayInfo = _pluginLimiterDisplayInfo;
   plugin->getSetting = _pluginLimiterGetSetting;
   plugin->prepareForProcessing = _pluginLimiterEmpty;
+  plugin->resetPlugin = _pluginLimiterEmpty;
+  plugin->setNumChannels = _pluginAcceptAnyNumChannels;
   plugin->showEditor = _pluginLimiterEmpty;
   plugin->processAudio = _pluginLimiterProcessAudio;
   plugin->processMidiEvents = _pluginLimiterProcessMidiEvents;
@@ -47,15 +47,19 @@ static void _pluginPassthruDisplayInfo(void *pluginPtr) {
 
 static int _pluginPassthruGetSetting(void *pluginPtr,
                                      PluginSetting pluginSetting) {
+  Plugin plugin = (Plugin)pluginPtr;
+
   switch (pluginSetting) {
   case PLUGIN_SETTING_TAIL_TIME_IN_MS:
     return 0;
 
   case PLUGIN_NUM_INPUTS:
-    return 2;
+    // Channels are processed independently, so any number can be used
+    return plugin->inputBuffer != NULL ? plugin->inputBuffer->numChannels : 2;
 
   case PLUGIN_NUM_OUTPUTS:
-    return 2;
+    return plugin->outputBuffer != NULL ? plugin->outputBuffer->numChannels
+                                        : 2;
 
   case PLUGIN_INITIAL_DELAY:
     return 0;
@@ -89,6 +93,8 @@ Plugin newPluginPassthru(const CharString pluginName) {
   plugin->displayInfo = _pluginPassthruDisplayInfo;
   plugin->getSetting = _pluginPassthruGetSetting;
   plugin->prepareForProcessing = _pluginPassthruEmpty;
+  plugin->resetPlugin = _pluginPassthruEmpty;
+  plugin->setNumChannels = _pluginAcceptAnyNumChannels;
   plugin->showEditor = _pluginPassthruEmpty;
   plugin->processAudio = _pluginPassthruProcessAudio;
   plugin->processMidiEvents = _pluginPassthruProcessMidiEvents;
@@ -46,6 +46,8 @@ static void _pluginSilenceDisplayInfo(void *pluginPtr) {
 
 static int _pluginSilenceGetSetting(void *pluginPtr,
                                     PluginSetting pluginSetting) {
+  Plugin plugin = (Plugin)pluginPtr;
+
   switch (pluginSetting) {
   case PLUGIN_SETTING_TAIL_TIME_IN_MS:
     return 0;
@@ -54,7 +56,8 @@ static int _pluginSilenceGetSetting(void *pluginPtr,
     return 0;
 
   case PLUGIN_NUM_OUTPUTS:
-    return 2;
+    return plugin->outputBuffer != NULL ? plugin->outputBuffer->numChannels
+                                        : 2;
 
   case PLUGIN_INITIAL_DELAY:
     return 0;
@@ -88,6 +91,8 @@ Plugin newPluginSilence(const CharString pluginName) {
   plugin->displayInfo = _pluginSilenceDisplayInfo;
   plugin->getSetting = _pluginSilenceGetSetting;
   plugin->prepareForProcessing = _pluginSilenceEmpty;
+  plugin->resetPlugin = _pluginSilenceEmpty;
+  plugin->setNumChannels = _pluginAcceptAnyNumChannels;
   plugin->showEditor = _pluginSilenceEmpty;
   plugin->processAudio = _pluginSilenceProcessAudio;
   plugin->processMidiEvents = _pluginSilenceProcessMidiEvents;
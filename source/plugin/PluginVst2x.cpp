@@ -62,11 +62,17 @@ typedef struct {
   boolByte isPluginShell;
   VstInt32 shellPluginId;
   // Must be retained until processReplacing() is called, so best to keep a
-  // reference in the plugin's data storage.
+  // reference in the plugin's data storage. The events are reused for every
+  // block, and are only reallocated when a block has more events than will fit.
   struct VstEvents *vstEvents;
+  VstMidiEvent *vstMidiEvents;
+  int vstEventsCapacity;
 } PluginVst2xDataMembers;
 typedef PluginVst2xDataMembers *PluginVst2xData;
 
+// Number of events which the VstEvents struct has room for at first
+static const int kVst2xDefaultNumEvents = 64;
+
 // Implementation body starts here
 extern "C" {
 
@@ -714,15 +720,22 @@ static int _getVst2xPluginSetting(void *pluginPtr,
   case PLUGIN_SETTING_TAIL_TIME_IN_MS: {
     VstInt32 tailSize = (VstInt32)data->dispatcher(
         data->pluginHandle, effGetTailSize, 0, 0, NULL, 0.0f);
+    double tailTimeInMs;
 
     // For some reason, the VST SDK says that plugins return a 1 here for no
     // tail.
     if (tailSize == 1 || tailSize == 0) {
       return 0;
-    } else {
-      // If tailSize is not 0 or 1, then it is assumed to be in samples
-      return (int)((double)tailSize * getSampleRate() / 1000.0f);
+    } else if (tailSize < 0) {
+      // Some plugins use a negative size to say that the tail never ends
+      return MAX_PLUGIN_TAIL_TIME_IN_MS;
     }
+
+    // If tailSize is not 0 or 1, then it is assumed to be in samples
+    tailTimeInMs = (double)tailSize * 1000.0 / getSampleRate();
+    return tailTimeInMs > MAX_PLUGIN_TAIL_TIME_IN_MS
+               ? MAX_PLUGIN_TAIL_TIME_IN_MS
+               : (int)tailTimeInMs;
   }
 
   case PLUGIN_NUM_INPUTS:
@@ -770,14 +783,6 @@ static void _fillVstMidiEvent(const MidiEvent midiEvent,
     vstMidiEvent->reserved2 = 0;
     break;
 
-  case MIDI_TYPE_SYSEX:
-    logUnsupportedFeature("VST2.x plugin sysex messages");
-    break;
-
-  case MIDI_TYPE_META:
-    // Ignore, don't care
-    break;
-
   default:
     logInternalError("Cannot convert MIDI event type '%d' to VstMidiEvent",
                      midiEvent->eventType);
@@ -785,36 +790,53 @@ static void _fillVstMidiEvent(const MidiEvent midiEvent,
   }
 }
 
+static void _reserveVst2xEvents(PluginVst2xData data, int numEvents) {
+  int capacity = data->vstEventsCapacity;
+
+  if (data->vstEvents != NULL && numEvents <= capacity) {
+    return;
+  }
+
+  if (capacity == 0) {
+    capacity = kVst2xDefaultNumEvents;
+  }
+
+  while (capacity < numEvents) {
+    capacity *= 2;
+  }
+
+  free(data->vstEvents);
+  free(data->vstMidiEvents);
+  data->vstEvents = (struct VstEvents *)malloc(
+      sizeof(struct VstEvents) + (capacity * sizeof(struct VstEvent *)));
+  data->vstEvents->numEvents = 0;
+  data->vstEvents->reserved = 0;
+  data->vstMidiEvents = (VstMidiEvent *)calloc((size_t)capacity,
+                                               sizeof(VstMidiEvent));
+  data->vstEventsCapacity = capacity;
+}
+
 static void _processMidiEventsVst2xPlugin(void *pluginPtr,
                                           LinkedList midiEvents) {
   Plugin plugin = (Plugin)pluginPtr;
   PluginVst2xData data = (PluginVst2xData)(plugin->extraData);
   int numEvents = linkedListLength(midiEvents);
 
-  // Free events from the previous call
-  if (data->vstEvents != NULL) {
-    for (int i = 0; i < data->vstEvents->numEvents; i++) {
-      free(data->vstEvents->events[i]);
-    }
-
-    free(data->vstEvents);
-  }
-
-  data->vstEvents = (struct VstEvents *)malloc(
-      sizeof(struct VstEvent) + (numEvents * sizeof(struct VstEvent *)));
-  data->vstEvents->numEvents = numEvents;
+  _reserveVst2xEvents(data, numEvents);
 
   // Some monophonic instruments have problems dealing with the order of MIDI
   // events, so send them all note off events *first* followed by any other
-  // event types.
+  // event types. Only regular events are sent, since the slots are reused for
+  // each block and must all be filled.
   LinkedListIterator iterator = midiEvents;
   int outIndex = 0;
 
   while (iterator != NULL && outIndex < numEvents) {
     MidiEvent midiEvent = (MidiEvent)(iterator->item);
 
-    if (midiEvent != NULL && (midiEvent->status >> 4) == 0x08) {
-      VstMidiEvent *vstMidiEvent = (VstMidiEvent *)malloc(sizeof(VstMidiEvent));
+    if (midiEvent != NULL && midiEvent->eventType == MIDI_TYPE_REGULAR &&
+        (midiEvent->status >> 4) == 0x08) {
+      VstMidiEvent *vstMidiEvent = &data->vstMidiEvents[outIndex];
       _fillVstMidiEvent(midiEvent, vstMidiEvent);
       data->vstEvents->events[outIndex] = (VstEvent *)vstMidiEvent;
       outIndex++;
@@ -828,8 +850,11 @@ static void _processMidiEventsVst2xPlugin(void *pluginPtr,
   while (iterator != NULL && outIndex < numEvents) {
     MidiEvent midiEvent = (MidiEvent)(iterator->item);
 
-    if (midiEvent != NULL && (midiEvent->status >> 4) != 0x08) {
-      VstMidiEvent *vstMidiEvent = (VstMidiEvent *)malloc(sizeof(VstMidiEvent));
+    if (midiEvent != NULL && midiEvent->eventType == MIDI_TYPE_SYSEX) {
+      logUnsupportedFeature("VST2.x plugin sysex messages");
+    } else if (midiEvent != NULL && midiEvent->eventType == MIDI_TYPE_REGULAR &&
+               (midiEvent->status >> 4) != 0x08) {
+      VstMidiEvent *vstMidiEvent = &data->vstMidiEvents[outIndex];
       _fillVstMidiEvent(midiEvent, vstMidiEvent);
       data->vstEvents->events[outIndex] = (VstEvent *)vstMidiEvent;
       outIndex++;
@@ -838,6 +863,8 @@ static void _processMidiEventsVst2xPlugin(void *pluginPtr,
     iterator = (LinkedListIterator)(iterator->nextItem);
   }
 
+  // Meta events are handled by the host, so there may be fewer events to send
+  data->vstEvents->numEvents = outIndex;
   data->dispatcher(data->pluginHandle, effProcessEvents, 0, 0, data->vstEvents,
                    0.0f);
 }
@@ -906,6 +933,57 @@ static void _prepareForProcessingVst2xPlugin(void *pluginPtr) {
   _resumePlugin(plugin);
 }
 
+static void _setVst2xSpeakerArrangement(PluginVst2xData data,
+                                        int numInputs, int numOutputs,
+                                        boolByte *accepted) {
+  struct VstSpeakerArrangement inSpeakers;
+  _setSpeakers(&inSpeakers, numInputs);
+  struct VstSpeakerArrangement outSpeakers;
+  _setSpeakers(&outSpeakers, numOutputs);
+  VstIntPtr result =
+      data->dispatcher(data->pluginHandle, effSetSpeakerArrangement, 0,
+                       (VstIntPtr)&inSpeakers, &outSpeakers, 0.0f);
+
+  if (accepted != NULL) {
+    *accepted = (boolByte)(result != 0);
+  }
+}
+
+static boolByte _setNumChannelsVst2xPlugin(void *pluginPtr,
+                                           ChannelCount numInputs,
+                                           ChannelCount numOutputs) {
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginVst2xData data = (PluginVst2xData)(plugin->extraData);
+  int oldNumInputs = data->pluginHandle->numInputs;
+  int oldNumOutputs = data->pluginHandle->numOutputs;
+  boolByte accepted = false;
+
+  // The speaker arrangement may only be changed while the plugin is suspended,
+  // and it is resumed again when it is prepared for processing
+  _suspendPlugin(plugin);
+  _setVst2xSpeakerArrangement(data, (int)numInputs, (int)numOutputs, &accepted);
+
+  // Some plugins accept any arrangement but still expect their original number
+  // of buffers, so the new layout is only used if they also report it
+  if (accepted && data->pluginHandle->numInputs == (int)numInputs &&
+      data->pluginHandle->numOutputs == (int)numOutputs) {
+    return true;
+  }
+
+  logDebug("Plugin '%s' does not support %d inputs and %d outputs",
+           plugin->pluginName->data, numInputs, numOutputs);
+  _setVst2xSpeakerArrangement(data, oldNumInputs, oldNumOutputs, NULL);
+  return false;
+}
+
+static void _resetVst2xPlugin(void *pluginPtr) {
+  Plugin plugin = (Plugin)pluginPtr;
+  // A suspend/resume cycle is the standard way to ask a VST2 plugin to flush
+  // its buffers, and is much cheaper than closing and reopening it.
+  _suspendPlugin(plugin);
+  _resumePlugin(plugin);
+}
+
 static boolByte _pluginVst2xGetWindowRect(Plugin self,
                                           PluginWindowSize *outRect) {
   PluginVst2xData data = (PluginVst2xData)(self->extraData);
@@ -959,13 +1037,8 @@ static void _freeVst2xPluginData(void *pluginDataPtr) {
   freePluginVst2xId(data->pluginId);
   closeLibraryHandle(data->libraryHandle);
 
-  if (data->vstEvents != NULL) {
-    for (int i = 0; i < data->vstEvents->numEvents; i++) {
-      free(data->vstEvents->events[i]);
-    }
-
-    free(data->vstEvents);
-  }
+  free(data->vstEvents);
+  free(data->vstMidiEvents);
 }
 
 Plugin newPluginVst2x(const CharString pluginName,
@@ -982,6 +1055,8 @@ Plugin newPluginVst2x(const CharString pluginName,
   plugin->processMidiEvents = _processMidiEventsVst2xPlugin;
   plugin->setParameter = _setParameterVst2xPlugin;
   plugin->prepareForProcessing = _prepareForProcessingVst2xPlugin;
+  plugin->resetPlugin = _resetVst2xPlugin;
+  plugin->setNumChannels = _setNumChannelsVst2xPlugin;
   plugin->showEditor = _showVst2xEditor;
   plugin->closePlugin = _closeVst2xPlugin;
   plugin->freePluginData = _freeVst2xPluginData;
@@ -997,6 +1072,8 @@ Plugin newPluginVst2x(const CharString pluginName,
   extraData->isPluginShell = (boolByte)(shellPluginDelimiter != NULL);
   extraData->shellPluginId = 0;
   extraData->vstEvents = NULL;
+  extraData->vstMidiEvents = NULL;
+  extraData->vstEventsCapacity = 0;
   plugin->extraData = extraData;
 
   return plugin;
@@ -41,7 +41,6 @@ extern "C" {
 #include "plugin/PluginVst2xId.h"
 #include "time/AudioClock.h"
 
-#include <math.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -168,10 +167,11 @@ VstIntPtr VSTCALLBACK pluginVst2xHostCallback(AEffect *effect, VstInt32 opcode,
 
   case audioMasterGetTime: {
     AudioClock audioClock = getAudioClock();
+    const AudioClockTimeInfo *timeInfo = audioClockGetTimeInfo(audioClock);
 
     // These values are always valid
-    vstTimeInfo.samplePos = audioClock->currentFrame;
-    vstTimeInfo.sampleRate = getSampleRate();
+    vstTimeInfo.samplePos = timeInfo->samplePosition;
+    vstTimeInfo.sampleRate = timeInfo->sampleRate;
 
     // Set flags for transport state
     vstTimeInfo.flags = 0;
@@ -179,42 +179,26 @@ VstIntPtr VSTCALLBACK pluginVst2xHostCallback(AEffect *effect, VstInt32 opcode,
         audioClock->transportChanged ? kVstTransportChanged : 0;
     vstTimeInfo.flags |= audioClock->isPlaying ? kVstTransportPlaying : 0;
 
-    // Fill values based on other flags which may have been requested
+    // Fill values based on other flags which may have been requested. All of
+    // them come from the clock, which only computes them once per block.
     if (value & kVstNanosValid) {
-      // It doesn't make sense to return this value, as the plugin may try to
-      // calculate something based on the current system time. As we are running
-      // offline, anything the plugin calculates here will probably be wrong
-      // given the way we are running.  However, for real-time mode, this flag
-      // should be implemented in that case.
-      logWarn("Plugin '%s' asked for time in nanoseconds (unsupported)",
-              pluginIdString);
+      vstTimeInfo.nanoSeconds = (double)timeInfo->systemTimeInNanoseconds;
+      vstTimeInfo.flags |= kVstNanosValid;
     }
 
     if (value & kVstPpqPosValid) {
-      // TODO: Move calculations to AudioClock
-      double samplesPerBeat = (60.0 / getTempo()) * getSampleRate();
       // Musical time starts with 1, not 0
-      vstTimeInfo.ppqPos = (vstTimeInfo.samplePos / samplesPerBeat) + 1.0;
-      logDebug("Current PPQ position is %g", vstTimeInfo.ppqPos);
+      vstTimeInfo.ppqPos = timeInfo->ppqPosition + 1.0;
       vstTimeInfo.flags |= kVstPpqPosValid;
     }
 
     if (value & kVstTempoValid) {
-      vstTimeInfo.tempo = getTempo();
+      vstTimeInfo.tempo = timeInfo->tempo;
       vstTimeInfo.flags |= kVstTempoValid;
     }
 
     if (value & kVstBarsValid) {
-      if (!(value & kVstPpqPosValid)) {
-        logError("Plugin requested position in bars, but not PPQ");
-      }
-
-      // TODO: Move calculations to AudioClock
-      double currentBarPos =
-          floor(vstTimeInfo.ppqPos / (double)getTimeSignatureBeatsPerMeasure());
-      vstTimeInfo.barStartPos =
-          currentBarPos * (double)getTimeSignatureBeatsPerMeasure() + 1.0;
-      logDebug("Current bar is %g", vstTimeInfo.barStartPos);
+      vstTimeInfo.barStartPos = timeInfo->barStartPosition + 1.0;
       vstTimeInfo.flags |= kVstBarsValid;
     }
 
@@ -223,8 +207,8 @@ VstIntPtr VSTCALLBACK pluginVst2xHostCallback(AEffect *effect, VstInt32 opcode,
     }
 
     if (value & kVstTimeSigValid) {
-      vstTimeInfo.timeSigNumerator = getTimeSignatureBeatsPerMeasure();
-      vstTimeInfo.timeSigDenominator = getTimeSignatureNoteValue();
+      vstTimeInfo.timeSigNumerator = timeInfo->timeSignatureBeatsPerMeasure;
+      vstTimeInfo.timeSigDenominator = timeInfo->timeSignatureNoteValue;
       vstTimeInfo.flags |= kVstTimeSigValid;
     }
 
@@ -16,6 +16,7 @@
 #include "pluginterfaces/vst/ivstcomponent.h"
 #include "pluginterfaces/vst/ivsteditcontroller.h"
 #include "pluginterfaces/vst/ivsthostapplication.h"
+#include "pluginterfaces/vst/vstspeaker.h"
 #include "pluginterfaces/base/ipluginbase.h"
 #include "pluginterfaces/base/funknown.h"
 using namespace Steinberg;
@@ -34,6 +35,7 @@ extern "C" {
 #include "logging/EventLogger.h"
 #include "midi/MidiEvent.h"
 #include "plugin/Plugin.h"
+#include "time/AudioClock.h"
 }
 
 // C linkage for functions called from C code
@@ -453,6 +455,36 @@ static void _closeVst3Plugin(void *pluginPtr) {
   }
 }
 
+#ifdef WITH_VST3_SDK
+// Fill the process context from the time info of the audio clock, which is
+// shared with other plugins so that it is only computed once per block
+static void _fillVst3ProcessContext(ProcessContext* context) {
+  AudioClock audioClock = getAudioClock();
+  const AudioClockTimeInfo* timeInfo = audioClockGetTimeInfo(audioClock);
+
+  memset(context, 0, sizeof(ProcessContext));
+  context->state = ProcessContext::kSystemTimeValid |
+                   ProcessContext::kContTimeValid |
+                   ProcessContext::kProjectTimeMusicValid |
+                   ProcessContext::kBarPositionValid |
+                   ProcessContext::kTempoValid |
+                   ProcessContext::kTimeSigValid;
+  if (audioClock->isPlaying) {
+    context->state |= ProcessContext::kPlaying;
+  }
+
+  context->sampleRate = timeInfo->sampleRate;
+  context->projectTimeSamples = (TSamples)timeInfo->samplePosition;
+  context->systemTime = (int64)timeInfo->systemTimeInNanoseconds;
+  context->continousTimeSamples = (TSamples)timeInfo->samplePosition;
+  context->projectTimeMusic = timeInfo->ppqPosition;
+  context->barPositionMusic = timeInfo->barStartPosition;
+  context->tempo = timeInfo->tempo;
+  context->timeSigNumerator = timeInfo->timeSignatureBeatsPerMeasure;
+  context->timeSigDenominator = timeInfo->timeSignatureNoteValue;
+}
+#endif
+
 static void _processVst3Audio(void *pluginPtr, SampleBuffer inputs,
                               SampleBuffer outputs) {
   Plugin plugin = (Plugin)pluginPtr;
@@ -487,7 +519,9 @@ static void _processVst3Audio(void *pluginPtr, SampleBuffer inputs,
   processData.outputParameterChanges = NULL;
   processData.inputEvents = NULL;
   processData.outputEvents = NULL;
-  processData.processContext = NULL;
+  ProcessContext processContext;
+  _fillVst3ProcessContext(&processContext);
+  processData.processContext = &processContext;
   
   // Set up input/output buffers based on actual bus structure
   // VST3 uses buses - we need to match the plugin's bus structure
@@ -720,6 +754,77 @@ static void _prepareVst3ForProcessing(void *pluginPtr) {
   // TODO: Implement VST3 prepare
 }
 
+static void _resetVst3Plugin(void *pluginPtr) {
+#ifdef WITH_VST3_SDK
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginVst3Data data = (PluginVst3Data)plugin->extraData;
+
+  // Deactivating and reactivating the component resets its processing state
+  if (data != NULL && data->pluginInstance != NULL) {
+    IComponent *component = (IComponent *)data->pluginInstance;
+    component->setActive(false);
+    component->setActive(true);
+  }
+#else
+  (void)pluginPtr;
+#endif
+}
+
+#ifdef WITH_VST3_SDK
+static SpeakerArrangement _getVst3SpeakerArrangement(ChannelCount numChannels) {
+  switch (numChannels) {
+    case 0:
+      return SpeakerArr::kEmpty;
+    case 1:
+      return SpeakerArr::kMono;
+    case 2:
+      return SpeakerArr::kStereo;
+    default:
+      return SpeakerArr::kEmpty;
+  }
+}
+#endif
+
+static boolByte _setVst3NumChannels(void *pluginPtr, ChannelCount numInputs,
+                                    ChannelCount numOutputs) {
+#ifdef WITH_VST3_SDK
+  Plugin plugin = (Plugin)pluginPtr;
+  PluginVst3Data data = (PluginVst3Data)plugin->extraData;
+
+  // Only plugins with a single main bus in each direction are renegotiated,
+  // since it is not clear how channels should be spread over several buses
+  if (data == NULL || data->pluginInstance == NULL ||
+      data->audioProcessor == NULL || data->inputBusCount > 1 ||
+      data->outputBusCount != 1 || numInputs > 2 || numOutputs > 2) {
+    return false;
+  }
+
+  IComponent *component = (IComponent *)data->pluginInstance;
+  IAudioProcessor *processor = (IAudioProcessor *)data->audioProcessor;
+  SpeakerArrangement inputArrangement = _getVst3SpeakerArrangement(numInputs);
+  SpeakerArrangement outputArrangement =
+      _getVst3SpeakerArrangement(numOutputs);
+  tresult result;
+
+  // Bus arrangements may only be changed while the component is inactive
+  component->setActive(false);
+  result = processor->setBusArrangements(
+      &inputArrangement, data->inputBusCount, &outputArrangement, 1);
+  component->setActive(true);
+
+  if (result != kResultTrue) {
+    logDebug("Plugin '%s' does not support %d inputs and %d outputs",
+             plugin->pluginName->data, numInputs, numOutputs);
+    return false;
+  }
+
+  return true;
+#else
+  (void)pluginPtr; (void)numInputs; (void)numOutputs;
+  return false;
+#endif
+}
+
 static void _showVst3Editor(void *pluginPtr) {
   (void)pluginPtr;
   logUnsupportedFeature("VST3 editor display");
@@ -779,6 +884,8 @@ Plugin newPluginVst3(const CharString pluginName, const CharString pluginRoot) {
   plugin->getSetting = _getVst3Setting;
   plugin->displayInfo = _displayVst3Info;
   plugin->prepareForProcessing = _prepareVst3ForProcessing;
+  plugin->resetPlugin = _resetVst3Plugin;
+  plugin->setNumChannels = _setVst3NumChannels;
   plugin->showEditor = _showVst3Editor;
   plugin->freePluginData = _freeVst3Data;
 
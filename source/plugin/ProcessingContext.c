@@ -0,0 +1,63 @@
+//
+// ProcessingContext.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "ProcessingContext.h"
+
+#include "base/Thread.h"
+#include "plugin/PluginChain.h"
+
+#include <stdlib.h>
+
+static THREAD_LOCAL ProcessingContext threadProcessingContext = NULL;
+
+ProcessingContext newProcessingContext(void) {
+  ProcessingContext context =
+      (ProcessingContext)malloc(sizeof(ProcessingContextMembers));
+
+  context->settings = newAudioSettingsCopy();
+  context->audioClock = newAudioClock();
+  context->pluginChain = getPluginChain();
+
+  return context;
+}
+
+ProcessingContext getProcessingContext(void) {
+  return threadProcessingContext;
+}
+
+void processingContextMakeCurrent(ProcessingContext self) {
+  threadProcessingContext = self;
+  setThreadAudioSettings(self != NULL ? self->settings : NULL);
+  setThreadAudioClock(self != NULL ? self->audioClock : NULL);
+}
+
+void freeProcessingContext(ProcessingContext self) {
+  if (self != NULL) {
+    freeAudioSettingsCopy(self->settings);
+    freeAudioClock(self->audioClock);
+    free(self);
+  }
+}
@@ -0,0 +1,84 @@
+//
+// ProcessingContext.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_ProcessingContext_h
+#define MrsWatson_ProcessingContext_h
+
+#include "audio/AudioSettings.h"
+#include "time/AudioClock.h"
+
+/**
+ * Everything which describes a single render: the audio settings, the
+ * transport position, and the plugin chain which is being processed. The
+ * program starts out with the global instances of each of these, and each
+ * thread which renders a different stream at the same time (such as a batch
+ * worker or a segment of a long input) uses its own context instead.
+ *
+ * Code which is handed a context should use its fields directly. Code which
+ * cannot be, such as the getters in AudioSettings.h or the VST host callback,
+ * finds the context of the calling thread through getProcessingContext(). The
+ * getters of the global instances, such as getSampleRate(), getAudioClock()
+ * and getPluginChain(), all resolve to the current context of the calling
+ * thread when it has one.
+ */
+typedef struct {
+  AudioSettings settings;
+  AudioClock audioClock;
+  // PluginChain which is processed in this context. This is not owned by the
+  // context and is not freed along with it. It is not declared as a PluginChain
+  // since the plugin chain itself uses contexts for its pipeline threads.
+  void *pluginChain;
+} ProcessingContextMembers;
+typedef ProcessingContextMembers *ProcessingContext;
+
+/**
+ * Create a context which starts out with a copy of the settings of the calling
+ * thread, and processes the same plugin chain. Its audio clock is positioned
+ * at the start, rather than being copied.
+ * @return Initialized object, which must be freed with freeProcessingContext()
+ */
+ProcessingContext newProcessingContext(void);
+
+/**
+ * Get the processing context of the calling thread.
+ * @return Current context, or NULL if the thread uses the global instances
+ */
+ProcessingContext getProcessingContext(void);
+
+/**
+ * Use a context for everything which is processed on the calling thread, until
+ * this is called again.
+ * @param self Context to use, or NULL to go back to using the global instances
+ */
+void processingContextMakeCurrent(ProcessingContext self);
+
+/**
+ * Release a context. It must not be current on any thread.
+ * @param self
+ */
+void freeProcessingContext(ProcessingContext self);
+
+#endif
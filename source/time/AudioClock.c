@@ -26,19 +26,34 @@
 
 #include "AudioClock.h"
 
+#include "audio/AudioSettings.h"
+#include "base/Thread.h"
+#include "time/TaskTimer.h"
+
+#include <math.h>
+
 #include <stdio.h>
 #include <stdlib.h>
 
 AudioClock audioClockInstance = NULL;
+static THREAD_LOCAL AudioClock threadAudioClock = NULL;
 
-void initAudioClock(void) {
-  audioClockInstance = (AudioClock)malloc(sizeof(AudioClockMembers));
-  audioClockInstance->currentFrame = 0;
-  audioClockInstance->transportChanged = false;
-  audioClockInstance->isPlaying = false;
+AudioClock newAudioClock(void) {
+  AudioClock clock = (AudioClock)malloc(sizeof(AudioClockMembers));
+  clock->currentFrame = 0;
+  clock->transportChanged = false;
+  clock->isPlaying = false;
+  clock->_timeInfoValid = false;
+  return clock;
 }
 
-AudioClock getAudioClock(void) { return audioClockInstance; }
+void initAudioClock(void) { audioClockInstance = newAudioClock(); }
+
+AudioClock getAudioClock(void) {
+  return threadAudioClock != NULL ? threadAudioClock : audioClockInstance;
+}
+
+void setThreadAudioClock(AudioClock clock) { threadAudioClock = clock; }
 
 void advanceAudioClock(AudioClock self, const unsigned long blocksize) {
   if (self->currentFrame == 0 || !self->isPlaying) {
@@ -56,9 +71,51 @@ void audioClockStop(AudioClock self) {
   self->transportChanged = true;
 }
 
+const AudioClockTimeInfo *audioClockGetTimeInfo(AudioClock self) {
+  AudioClockTimeInfo *timeInfo = &self->_timeInfo;
+  double samplesPerBeat;
+  double beatsPerBar;
+
+  // The settings may be changed during a block by MIDI meta events, so they
+  // are compared as well as the position
+  if (self->_timeInfoValid && timeInfo->samplePosition == self->currentFrame &&
+      timeInfo->sampleRate == getSampleRate() &&
+      timeInfo->tempo == getTempo() &&
+      timeInfo->timeSignatureBeatsPerMeasure ==
+          getTimeSignatureBeatsPerMeasure() &&
+      timeInfo->timeSignatureNoteValue == getTimeSignatureNoteValue()) {
+    return timeInfo;
+  }
+
+  timeInfo->samplePosition = self->currentFrame;
+  timeInfo->sampleRate = getSampleRate();
+  timeInfo->tempo = getTempo();
+  timeInfo->timeSignatureBeatsPerMeasure = getTimeSignatureBeatsPerMeasure();
+  timeInfo->timeSignatureNoteValue = getTimeSignatureNoteValue();
+  timeInfo->systemTimeInNanoseconds = taskTimerGetMonotonicTime();
+
+  samplesPerBeat = (60.0 / timeInfo->tempo) * timeInfo->sampleRate;
+  timeInfo->ppqPosition = (double)timeInfo->samplePosition / samplesPerBeat;
+  // The length of a bar in quarter notes, so a bar of 6/8 is 3 quarter notes
+  beatsPerBar = timeInfo->timeSignatureBeatsPerMeasure * 4.0 /
+                timeInfo->timeSignatureNoteValue;
+  timeInfo->barStartPosition =
+      floor(timeInfo->ppqPosition / beatsPerBar) * beatsPerBar;
+
+  self->_timeInfoValid = true;
+  return timeInfo;
+}
+
 void freeAudioClock(AudioClock self) {
   if (self != NULL) {
+    if (self == audioClockInstance) {
+      audioClockInstance = NULL;
+    }
+
+    if (self == threadAudioClock) {
+      threadAudioClock = NULL;
+    }
+
     free(self);
-    audioClockInstance = NULL;
   }
 }
@@ -36,10 +36,33 @@
  * callbacks where it is difficult to pass a void* pointer.
  */
 
+/**
+ * Position of an audio clock in the formats which plugins ask for. Since some
+ * plugins ask for this several times per block, it is only computed for the
+ * first request of each block and then returned from the cache.
+ */
+typedef struct {
+  unsigned long samplePosition;
+  SampleRate sampleRate;
+  Tempo tempo;
+  // Position in quarter notes since the start of processing, and that of the
+  // start of the current bar. Both start at 0.
+  double ppqPosition;
+  double barStartPosition;
+  unsigned short timeSignatureBeatsPerMeasure;
+  unsigned short timeSignatureNoteValue;
+  // Monotonic system time when the position was computed
+  unsigned long long systemTimeInNanoseconds;
+} AudioClockTimeInfo;
+
 typedef struct {
   boolByte transportChanged;
   boolByte isPlaying;
   unsigned long currentFrame;
+
+  // Private fields
+  AudioClockTimeInfo _timeInfo;
+  boolByte _timeInfoValid;
 } AudioClockMembers;
 typedef AudioClockMembers *AudioClock;
 extern AudioClock audioClockInstance;
@@ -52,12 +75,29 @@ extern AudioClock audioClockInstance;
 void initAudioClock(void);
 
 /**
- * Get a reference to the global audio clock instance.
- * @return Reference to global audio clock, or NULL if the global instance has
- * not yet been initialized.
+ * Create an audio clock which is independent of the global instance. Such a
+ * clock is normally installed with setThreadAudioClock().
+ * @return Audio clock positioned at the start, which must be freed with
+ * freeAudioClock()
+ */
+AudioClock newAudioClock(void);
+
+/**
+ * Get a reference to the audio clock for the calling thread, which is the
+ * global audio clock instance unless setThreadAudioClock() was called.
+ * @return Reference to audio clock, or NULL if the global instance has not yet
+ * been initialized.
  */
 AudioClock getAudioClock(void);
 
+/**
+ * Use a separate audio clock for the calling thread, so that it may process a
+ * different stream than the rest of the program.
+ * @param clock Audio clock for this thread, or NULL to go back to using the
+ * global instance. The caller retains ownership of this object.
+ */
+void setThreadAudioClock(AudioClock clock);
+
 /**
  * Advanced the global audio clock by a given number of samples. This should be
  * called after processing each block.
@@ -72,6 +112,15 @@ void advanceAudioClock(AudioClock self, const unsigned long blocksize);
  */
 void audioClockStop(AudioClock self);
 
+/**
+ * Get the current position in musical time. The result is cached until the
+ * clock is advanced or the tempo, time signature or sample rate are changed.
+ * @param self
+ * @return Time info, which is owned by the clock and only valid until it is
+ * next advanced
+ */
+const AudioClockTimeInfo *audioClockGetTimeInfo(AudioClock self);
+
 /**
  * Free an audio clock instance and its associated resources.
  * @param self
@@ -0,0 +1,181 @@
+//
+// RealtimeScheduler.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "RealtimeScheduler.h"
+
+#include "audio/AudioSettings.h"
+#include "logging/EventLogger.h"
+#include "time/TaskTimer.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if UNIX
+#include <sys/mman.h>
+#include <time.h>
+#endif
+
+static void _sleepUntil(unsigned long long deadline) {
+#if LINUX
+  struct timespec time;
+
+  time.tv_sec = (time_t)(deadline / NANOSECONDS_PER_SECOND);
+  time.tv_nsec = (long)(deadline % NANOSECONDS_PER_SECOND);
+
+  // Sleeping is restarted after signals with the same absolute deadline
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &time, NULL) ==
+         EINTR) {
+  }
+#else
+  unsigned long long now = taskTimerGetMonotonicTime();
+
+  // Other platforms don't have absolute sleeps, but the deadline is still
+  // computed from the timeline so errors don't add up over several blocks
+  if (deadline > now) {
+#if WINDOWS
+    Sleep((DWORD)((deadline - now) / 1000000ull));
+#elif UNIX
+    struct timespec time;
+    time.tv_sec = (time_t)((deadline - now) / NANOSECONDS_PER_SECOND);
+    time.tv_nsec = (long)((deadline - now) % NANOSECONDS_PER_SECOND);
+    nanosleep(&time, NULL);
+#endif
+  }
+#endif
+}
+
+RealtimeScheduler newRealtimeScheduler(void) {
+  RealtimeScheduler scheduler =
+      (RealtimeScheduler)malloc(sizeof(RealtimeSchedulerMembers));
+
+  scheduler->numBlocks = 0;
+  scheduler->numDeadlineMisses = 0;
+  scheduler->worstLatenessInMs = 0.0;
+  memset(scheduler->slackHistogram, 0, sizeof(scheduler->slackHistogram));
+  scheduler->_running = false;
+  scheduler->_startTime = 0;
+  scheduler->_numFrames = 0;
+
+  return scheduler;
+}
+
+void realtimeSchedulerBeginBlock(RealtimeScheduler self) {
+  if (!self->_running) {
+    self->_startTime = taskTimerGetMonotonicTime();
+    self->_running = true;
+  }
+}
+
+double realtimeSchedulerEndBlock(RealtimeScheduler self,
+                                 SampleCount blocksize) {
+  unsigned long long now = taskTimerGetMonotonicTime();
+  unsigned long long deadline;
+  double blockTimeInMs = blocksize * 1000.0 / getSampleRate();
+  double slackInMs;
+  double latenessInMs;
+  int bin;
+
+  // The deadline is computed from the total number of frames rather than
+  // from the previous deadline, so that rounding errors don't add up
+  self->_numFrames += blocksize;
+  deadline = self->_startTime +
+             (unsigned long long)((double)self->_numFrames *
+                                  NANOSECONDS_PER_SECOND / getSampleRate());
+  slackInMs = now <= deadline ? (double)(deadline - now) / 1000000.0
+                              : -(double)(now - deadline) / 1000000.0;
+  latenessInMs = -slackInMs;
+
+  if (self->numBlocks == 0 || latenessInMs > self->worstLatenessInMs) {
+    self->worstLatenessInMs = latenessInMs;
+  }
+
+  self->numBlocks++;
+
+  if (slackInMs < 0.0) {
+    logWarn("Block %ld missed its deadline by %.2fms (%.2fms block)",
+            self->numBlocks, latenessInMs, blockTimeInMs);
+    self->numDeadlineMisses++;
+    self->slackHistogram[0]++;
+    self->_startTime += now - deadline;
+    return slackInMs;
+  }
+
+  bin = blockTimeInMs > 0.0 ? 1 + (int)(slackInMs * 10.0 / blockTimeInMs) : 1;
+  self->slackHistogram[bin < REALTIME_SCHEDULER_NUM_SLACK_BINS
+                           ? bin
+                           : REALTIME_SCHEDULER_NUM_SLACK_BINS - 1]++;
+  _sleepUntil(deadline);
+  return slackInMs;
+}
+
+void realtimeSchedulerLogStatistics(RealtimeScheduler self) {
+  int i;
+
+  if (self->numBlocks == 0) {
+    return;
+  }
+
+  if (self->numDeadlineMisses > 0) {
+    logInfo("Realtime: %ld of %ld blocks missed their deadline, worst "
+            "lateness was %.2fms",
+            self->numDeadlineMisses, self->numBlocks, self->worstLatenessInMs);
+  } else {
+    logInfo("Realtime: all %ld blocks met their deadline, least slack was "
+            "%.2fms",
+            self->numBlocks, -self->worstLatenessInMs);
+  }
+
+  logInfo("Slack before deadline, relative to the block duration:");
+
+  if (self->slackHistogram[0] > 0) {
+    logInfo("  Missed: %ld blocks", self->slackHistogram[0]);
+  }
+
+  for (i = 1; i < REALTIME_SCHEDULER_NUM_SLACK_BINS; i++) {
+    if (self->slackHistogram[i] > 0) {
+      logInfo("  %3d-%3d%%: %ld blocks", (i - 1) * 10, i * 10,
+              self->slackHistogram[i]);
+    }
+  }
+}
+
+boolByte realtimeSchedulerLockMemory(void) {
+#if UNIX
+  if (mlockall(MCL_CURRENT) != 0) {
+    logWarn("Could not lock memory for realtime processing: %s",
+            strerror(errno));
+    return false;
+  }
+
+  return true;
+#else
+  logUnsupportedFeature("Locking memory");
+  return false;
+#endif
+}
+
+void freeRealtimeScheduler(RealtimeScheduler self) { free(self); }
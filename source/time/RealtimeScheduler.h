@@ -0,0 +1,112 @@
+//
+// RealtimeScheduler.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatson_RealtimeScheduler_h
+#define MrsWatson_RealtimeScheduler_h
+
+#include "base/Types.h"
+
+// One bin for missed deadlines, and ten bins of a tenth of a block each
+#define REALTIME_SCHEDULER_NUM_SLACK_BINS 11
+
+/**
+ * Paces block processing to the rate at which an audio device would consume
+ * the blocks, and keeps statistics about how well each block met its deadline.
+ *
+ * Deadlines are taken from an ideal timeline which starts when the first block
+ * begins, where each block is due once the time it represents has passed.
+ * After a block is processed, the scheduler sleeps until its absolute deadline
+ * rather than for the remaining time, so that errors in the sleep time don't
+ * accumulate over many blocks. When a block misses its deadline, the timeline
+ * is moved back by the amount it was late, just like an audio device restarts
+ * after an xrun, so that later blocks aren't rushed to catch up.
+ */
+typedef struct {
+  unsigned long numBlocks;
+  unsigned long numDeadlineMisses;
+  // Largest amount by which a block finished after its deadline. If no
+  // deadlines were missed, this is negative and is the smallest slack.
+  double worstLatenessInMs;
+  // Number of blocks by the time left before their deadline, relative to the
+  // block duration. The first bin counts missed deadlines, and the others
+  // each count a tenth of the block duration, from the least to most slack.
+  unsigned long slackHistogram[REALTIME_SCHEDULER_NUM_SLACK_BINS];
+
+  // Private fields
+  boolByte _running;
+  // Monotonic time at the start of the timeline, in nanoseconds
+  unsigned long long _startTime;
+  unsigned long long _numFrames;
+} RealtimeSchedulerMembers;
+typedef RealtimeSchedulerMembers *RealtimeScheduler;
+
+/**
+ * Create a scheduler. The timeline starts with the first call to
+ * realtimeSchedulerBeginBlock().
+ * @return Initialized object
+ */
+RealtimeScheduler newRealtimeScheduler(void);
+
+/**
+ * Mark the start of processing a block. This starts the timeline on the first
+ * block, and does nothing afterwards.
+ * @param self
+ */
+void realtimeSchedulerBeginBlock(RealtimeScheduler self);
+
+/**
+ * Mark the end of processing a block, record whether it met its deadline, and
+ * sleep until the deadline.
+ * @param self
+ * @param blocksize Number of frames in the block, at the current sample rate
+ * @return Time left before the deadline when the block was done, in
+ * milliseconds. This is negative if the deadline was missed.
+ */
+double realtimeSchedulerEndBlock(RealtimeScheduler self, SampleCount blocksize);
+
+/**
+ * Log the deadline statistics and slack histogram.
+ * @param self
+ */
+void realtimeSchedulerLogStatistics(RealtimeScheduler self);
+
+/**
+ * Lock all memory which is currently mapped by the process into RAM, so that
+ * processing does not stall on page faults. This should be called once all
+ * buffers for processing have been allocated. Memory which is allocated later
+ * is not locked, since that could make allocations fail once the limit for
+ * locked memory is reached.
+ * @return True if the memory was locked
+ */
+boolByte realtimeSchedulerLockMemory(void);
+
+/**
+ * Free a scheduler and its associated resources
+ * @param self
+ */
+void freeRealtimeScheduler(RealtimeScheduler self);
+
+#endif
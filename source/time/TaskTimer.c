@@ -144,6 +144,26 @@ CharString taskTimerHumanReadbleString(TaskTimer self) {
   return outString;
 }
 
+unsigned long long taskTimerGetMonotonicTime(void) {
+#if WINDOWS
+  LARGE_INTEGER counter;
+  LARGE_INTEGER frequency;
+
+  QueryPerformanceCounter(&counter);
+  QueryPerformanceFrequency(&frequency);
+  return (unsigned long long)((double)counter.QuadPart *
+                              NANOSECONDS_PER_SECOND / frequency.QuadPart);
+#elif UNIX
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long long)now.tv_sec * NANOSECONDS_PER_SECOND +
+         (unsigned long long)now.tv_nsec;
+#else
+  return 0;
+#endif
+}
+
 void taskTimerSleep(const double milliseconds) {
 #if UNIX
   struct timespec sleepTime;
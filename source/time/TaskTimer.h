@@ -33,6 +33,8 @@
 #include <sys/time.h>
 #endif
 
+#define NANOSECONDS_PER_SECOND 1000000000ull
+
 typedef struct {
   CharString component;
   CharString subcomponent;
@@ -90,6 +92,13 @@ double taskTimerStop(TaskTimer self);
  */
 CharString taskTimerHumanReadbleString(TaskTimer self);
 
+/**
+ * Get the current time of a monotonic clock, which is not affected by changes
+ * to the system time.
+ * @return Time in nanoseconds since an unspecified point in the past
+ */
+unsigned long long taskTimerGetMonotonicTime(void);
+
 /**
  * Suspend execution for a given amount of milliseconds. Depending on the host
  * operating system, the amount of time actually slept may differ slightly from
@@ -44,9 +44,6 @@
 #define REQUIRES_FLAC(x) NULL
 #endif
 
-// These tests are currently broken :(
-#define TEST_AIFF_BIT_DEPTHS 0
-
 // The tests for the silence plugin work, but they fail the analysis check for
 // silence (obviously). These tests will remain disabled until there is a
 // smarter way to specify which analysis functions should be run for each
@@ -461,7 +458,6 @@ static int _testProcessAiffFile16BitStereo(const char *testName,
   return result;
 }
 
-#if TEST_AIFF_BIT_DEPTHS
 static int _testProcessAiffFile8BitMono(const char *testName,
                                         const CharString applicationPath,
                                         const CharString resourcesPath) {
@@ -539,7 +535,6 @@ static int _testProcessAiffFile32BitStereo(const char *testName,
   freeCharString(inputPath);
   return result;
 }
-#endif
 
 #if USE_FLAC
 static int _testProcessFlacFile16BitMono(const char *testName,
@@ -901,25 +896,21 @@ TestSuite addIntegrationTests(File mrsWatsonExePath, File resourcesPath) {
 
   // AIFF files
   addTestWithPaths(testSuite, "Process 16-bit AIFF file (mono)",
-                   REQUIRES_AUDIOFILE(_testProcessAiffFile16BitMono));
+                   _testProcessAiffFile16BitMono);
   addTestWithPaths(testSuite, "Process 16-bit AIFF file (stereo)",
-                   REQUIRES_AUDIOFILE(_testProcessAiffFile16BitStereo));
-#if TEST_AIFF_BIT_DEPTHS
-  // 8-bit AIFF will require some extra work in SampleSourceAudiofile
+                   _testProcessAiffFile16BitStereo);
   addTestWithPaths(testSuite, "Process 8-bit AIFF file (mono)",
-                   REQUIRES_AUDIOFILE(_testProcessAiffFile8BitMono));
+                   _testProcessAiffFile8BitMono);
   addTestWithPaths(testSuite, "Process 8-bit AIFF file (stereo)",
-                   REQUIRES_AUDIOFILE(_testProcessAiffFile8BitStereo));
+                   _testProcessAiffFile8BitStereo);
   addTestWithPaths(testSuite, "Process 24-bit AIFF file (mono)",
-                   REQUIRES_AUDIOFILE(_testProcessAiffFile24BitMono));
+                   _testProcessAiffFile24BitMono);
   addTestWithPaths(testSuite, "Process 24-bit AIFF file (stereo)",
-                   REQUIRES_AUDIOFILE(_testProcessAiffFile24BitStereo));
-  // 32-bit AIFF will require some extra work in SampleSourceAudiofile
+                   _testProcessAiffFile24BitStereo);
   addTestWithPaths(testSuite, "Process 32-bit AIFF file (mono)",
-                   REQUIRES_AUDIOFILE(_testProcessAiffFile32BitMono));
+                   _testProcessAiffFile32BitMono);
   addTestWithPaths(testSuite, "Process 32-bit AIFF file (stereo)",
-                   REQUIRES_AUDIOFILE(_testProcessAiffFile32BitStereo));
-#endif
+                   _testProcessAiffFile32BitStereo);
 
   // FLAC files
   addTestWithPaths(testSuite, "Process 8-bit FLAC file (mono)",
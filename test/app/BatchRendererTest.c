@@ -0,0 +1,276 @@
+//
+// BatchRendererTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "app/BatchRenderer.h"
+
+#include "audio/AudioSettings.h"
+#include "base/File.h"
+#include "unit/TestFiles.h"
+#include "unit/TestRunner.h"
+
+#include <stdio.h>
+
+#define TEST_BATCH_INPUT "mrswatsontest-batch-input.pcm"
+#define TEST_BATCH_OUTPUT_PATTERN "mrswatsontest-batch-output-%d.pcm"
+#define TEST_BATCH_NUM_JOBS 4
+// Deliberately not a multiple of the blocksize
+#define TEST_BATCH_NUM_FRAMES (DEFAULT_BLOCKSIZE * 3 + 100)
+
+static void _batchRendererTestSetup(void) { initAudioSettings(); }
+
+static void _batchRendererTestTeardown(void) {
+  char outputName[64];
+  int i;
+
+  removeTestFile(TEST_BATCH_INPUT);
+
+  for (i = 0; i < TEST_BATCH_NUM_JOBS; i++) {
+    snprintf(outputName, 64, TEST_BATCH_OUTPUT_PATTERN, i);
+    removeTestFile(outputName);
+  }
+
+  freeAudioSettings();
+}
+
+static int _testNewBatchRenderer(void) {
+  BatchRenderer b = newBatchRenderer();
+  assertNotNull(b);
+  assertIntEquals(0, b->numJobs);
+  assertIntEquals(0, b->numJobsFailed);
+  freeBatchRenderer(b);
+  return 0;
+}
+
+static int _testAddJobWithoutOutput(void) {
+  BatchRenderer b = newBatchRenderer();
+  assertFalse(batchRendererAddJob(b, "in.wav", NULL, NULL, NULL));
+  assertFalse(batchRendererAddJob(b, "in.wav", "", NULL, NULL));
+  assertIntEquals(0, b->numJobs);
+  freeBatchRenderer(b);
+  return 0;
+}
+
+static int _testParseCsv(void) {
+  BatchRenderer b = newBatchRenderer();
+  assert(batchRendererParseCsv(
+      b, "input,output,plugins,parameters\r\n"
+         "# Comment\r\n"
+         "a.wav,b.wav\r\n"
+         "\r\n"
+         "c.wav,d.wav,mrs_gain;mrs_limiter,\"0,0.5;1,1\"\r\n"));
+  assertIntEquals(2, b->numJobs);
+  assertCharStringEquals("a.wav", b->jobs[0]->inputName);
+  assertCharStringEquals("b.wav", b->jobs[0]->outputName);
+  assert(charStringIsEmpty(b->jobs[0]->plugins));
+  assert(charStringIsEmpty(b->jobs[0]->parameters));
+  assertCharStringEquals("c.wav", b->jobs[1]->inputName);
+  assertCharStringEquals("d.wav", b->jobs[1]->outputName);
+  assertCharStringEquals("mrs_gain;mrs_limiter", b->jobs[1]->plugins);
+  assertCharStringEquals("0,0.5;1,1", b->jobs[1]->parameters);
+  freeBatchRenderer(b);
+  return 0;
+}
+
+static int _testParseCsvQuotedFields(void) {
+  BatchRenderer b = newBatchRenderer();
+  assert(batchRendererParseCsv(b, "\"my, \"\"file\"\".wav\",out.wav"));
+  assertIntEquals(1, b->numJobs);
+  assertCharStringEquals("my, \"file\".wav", b->jobs[0]->inputName);
+  assertCharStringEquals("out.wav", b->jobs[0]->outputName);
+  freeBatchRenderer(b);
+  return 0;
+}
+
+static int _testParseCsvInvalidFieldCount(void) {
+  BatchRenderer b = newBatchRenderer();
+  assertFalse(batchRendererParseCsv(b, "a.wav,b.wav\nc.wav\n"));
+  freeBatchRenderer(b);
+  return 0;
+}
+
+static int _testParseCsvUnterminatedQuote(void) {
+  BatchRenderer b = newBatchRenderer();
+  assertFalse(batchRendererParseCsv(b, "\"a.wav,b.wav\n"));
+  freeBatchRenderer(b);
+  return 0;
+}
+
+static int _testParseJson(void) {
+  BatchRenderer b = newBatchRenderer();
+  assert(batchRendererParseJson(
+      b, "[\n"
+         "  {\"input\": \"a.wav\", \"output\": \"b.wav\"},\n"
+         "  {\"input\": \"c\\\\d.wav\", \"output\": \"e.wav\",\n"
+         "   \"plugins\": \"mrs_gain\", \"parameters\": [\"0,0.5\", \"1,1\"],\n"
+         "   \"comment\": {\"ignored\": [1, 2.5e3, true, null]}}\n"
+         "]\n"));
+  assertIntEquals(2, b->numJobs);
+  assertCharStringEquals("a.wav", b->jobs[0]->inputName);
+  assertCharStringEquals("b.wav", b->jobs[0]->outputName);
+  assert(charStringIsEmpty(b->jobs[0]->plugins));
+  assertCharStringEquals("c\\d.wav", b->jobs[1]->inputName);
+  assertCharStringEquals("mrs_gain", b->jobs[1]->plugins);
+  assertCharStringEquals("0,0.5;1,1", b->jobs[1]->parameters);
+  freeBatchRenderer(b);
+  return 0;
+}
+
+static int _testParseJsonParameterString(void) {
+  BatchRenderer b = newBatchRenderer();
+  assert(batchRendererParseJson(b, "[{\"input\":\"a.wav\",\"output\":\"b.wav\","
+                                   "\"parameters\":\"0,1\"}]"));
+  assertIntEquals(1, b->numJobs);
+  assertCharStringEquals("0,1", b->jobs[0]->parameters);
+  freeBatchRenderer(b);
+  return 0;
+}
+
+static int _testParseJsonInvalid(void) {
+  BatchRenderer b = newBatchRenderer();
+  assertFalse(batchRendererParseJson(b, "{\"input\": \"a.wav\"}"));
+  assertFalse(batchRendererParseJson(b, "[{\"input\": \"a.wav\"}]"));
+  assertFalse(batchRendererParseJson(b, "[{\"input\": \"a.wav"));
+  freeBatchRenderer(b);
+  return 0;
+}
+
+static int _testRenderJobs(void) {
+  BatchRenderer b = newBatchRenderer();
+  CharString plugins = newCharStringWithCString("mrs_passthru");
+  CharString searchRoot = newCharString();
+  char outputName[64];
+  File outputFile;
+  int i;
+
+  writeTestInput(TEST_BATCH_INPUT, TEST_BATCH_NUM_FRAMES, NULL);
+
+  for (i = 0; i < TEST_BATCH_NUM_JOBS; i++) {
+    snprintf(outputName, 64, TEST_BATCH_OUTPUT_PATTERN, i);
+    assert(batchRendererAddJob(b, TEST_BATCH_INPUT, outputName, NULL, NULL));
+  }
+
+  assertIntEquals(RETURN_CODE_SUCCESS,
+                  batchRendererRun(b, plugins, NULL, searchRoot, 2));
+  assertIntEquals(0, b->numJobsFailed);
+
+  for (i = 0; i < TEST_BATCH_NUM_JOBS; i++) {
+    snprintf(outputName, 64, TEST_BATCH_OUTPUT_PATTERN, i);
+    outputFile = newFileWithPathCString(outputName);
+    assert(fileExists(outputFile));
+    assertUnsignedLongEquals(
+        (unsigned long)(TEST_BATCH_NUM_FRAMES * getNumChannels() *
+                        sizeof(short)),
+        (unsigned long)fileGetSize(outputFile));
+    freeFile(outputFile);
+  }
+
+  freeCharString(plugins);
+  freeCharString(searchRoot);
+  freeBatchRenderer(b);
+  return 0;
+}
+
+static int _testRenderJobWithMissingInput(void) {
+  BatchRenderer b = newBatchRenderer();
+  CharString plugins = newCharStringWithCString("mrs_passthru");
+  CharString searchRoot = newCharString();
+  char outputName[64];
+
+  writeTestInput(TEST_BATCH_INPUT, TEST_BATCH_NUM_FRAMES, NULL);
+  snprintf(outputName, 64, TEST_BATCH_OUTPUT_PATTERN, 0);
+  assert(batchRendererAddJob(b, "mrswatsontest-batch-missing.pcm", outputName,
+                             NULL, NULL));
+  snprintf(outputName, 64, TEST_BATCH_OUTPUT_PATTERN, 1);
+  assert(batchRendererAddJob(b, TEST_BATCH_INPUT, outputName, NULL, NULL));
+
+  assertIntEquals(RETURN_CODE_IO_ERROR,
+                  batchRendererRun(b, plugins, NULL, searchRoot, 1));
+  assertIntEquals(1, b->numJobsFailed);
+
+  freeCharString(plugins);
+  freeCharString(searchRoot);
+  freeBatchRenderer(b);
+  return 0;
+}
+
+static int _testRenderJobsForked(void) {
+#if UNIX
+  BatchRenderer b = newBatchRenderer();
+  CharString plugins = newCharStringWithCString("mrs_passthru");
+  CharString searchRoot = newCharString();
+  char outputName[64];
+  int i;
+
+  writeTestInput(TEST_BATCH_INPUT, TEST_BATCH_NUM_FRAMES, NULL);
+
+  for (i = 0; i < TEST_BATCH_NUM_JOBS - 1; i++) {
+    snprintf(outputName, 64, TEST_BATCH_OUTPUT_PATTERN, i);
+    assert(batchRendererAddJob(b, TEST_BATCH_INPUT, outputName,
+                               i % 2 ? "mrs_gain" : NULL, NULL));
+  }
+
+  snprintf(outputName, 64, TEST_BATCH_OUTPUT_PATTERN, TEST_BATCH_NUM_JOBS - 1);
+  assert(batchRendererAddJob(b, "mrswatsontest-batch-missing.pcm", outputName,
+                             NULL, NULL));
+
+  assertIntEquals(RETURN_CODE_IO_ERROR,
+                  batchRendererRunForked(b, plugins, NULL, searchRoot, 2));
+  assertIntEquals(1, b->numJobsFailed);
+
+  for (i = 0; i < TEST_BATCH_NUM_JOBS - 1; i++) {
+    assertUnsignedLongEquals((unsigned long)TEST_BATCH_NUM_FRAMES,
+                             b->jobs[i]->numFramesWritten);
+  }
+
+  freeCharString(plugins);
+  freeCharString(searchRoot);
+  freeBatchRenderer(b);
+#endif
+  return 0;
+}
+
+TestSuite addBatchRendererTests(void);
+TestSuite addBatchRendererTests(void) {
+  TestSuite testSuite = newTestSuite("BatchRenderer", _batchRendererTestSetup,
+                                     _batchRendererTestTeardown);
+  addTest(testSuite, "NewBatchRenderer", _testNewBatchRenderer);
+  addTest(testSuite, "AddJobWithoutOutput", _testAddJobWithoutOutput);
+  addTest(testSuite, "ParseCsv", _testParseCsv);
+  addTest(testSuite, "ParseCsvQuotedFields", _testParseCsvQuotedFields);
+  addTest(testSuite, "ParseCsvInvalidFieldCount",
+          _testParseCsvInvalidFieldCount);
+  addTest(testSuite, "ParseCsvUnterminatedQuote",
+          _testParseCsvUnterminatedQuote);
+  addTest(testSuite, "ParseJson", _testParseJson);
+  addTest(testSuite, "ParseJsonParameterString",
+          _testParseJsonParameterString);
+  addTest(testSuite, "ParseJsonInvalid", _testParseJsonInvalid);
+  addTest(testSuite, "RenderJobs", _testRenderJobs);
+  addTest(testSuite, "RenderJobWithMissingInput",
+          _testRenderJobWithMissingInput);
+  addTest(testSuite, "RenderJobsForked", _testRenderJobsForked);
+  return testSuite;
+}
@@ -0,0 +1,338 @@
+//
+// ControlChannelTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "app/ControlChannel.h"
+
+#include "audio/AudioSettings.h"
+#include "base/File.h"
+#include "plugin/PluginGain.h"
+#include "time/TaskTimer.h"
+#include "unit/TestFiles.h"
+#include "unit/TestRunner.h"
+
+#include "plugin/PluginMock.h"
+
+#include <string.h>
+
+#if UNIX
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#define TEST_CONTROL_PATH "mrswatsontest-control"
+// Number of times that the tests check whether a command has arrived
+#define TEST_CONTROL_NUM_TRIES 200
+
+static void _controlChannelTestSetup(void) { initAudioSettings(); }
+
+static void _controlChannelTestTeardown(void) {
+  removeTestFile(TEST_CONTROL_PATH);
+  freeAudioSettings();
+}
+
+static ControlChannel _newTestControlChannel(void) {
+  CharString path = newCharStringWithCString(TEST_CONTROL_PATH);
+  ControlChannel c = newControlChannel(path);
+  freeCharString(path);
+  return c;
+}
+
+static PluginChain _newTestPluginChain(void) {
+  PluginChain p = newPluginChain();
+  CharString gainName = newCharStringWithCString(kInternalPluginGainName);
+  pluginChainAppend(p, newPluginGain(gainName), NULL);
+  pluginChainAppend(p, newPluginMock(), NULL);
+  freeCharString(gainName);
+  return p;
+}
+
+static float _getTestGain(PluginChain p) {
+  return ((PluginGainSettings)p->plugins[0]->extraData)->gain;
+}
+
+static int _testNewControlChannel(void) {
+  ControlChannel c = _newTestControlChannel();
+  assertNotNull(c);
+  assertCharStringEquals(TEST_CONTROL_PATH, c->path);
+  assertUnsignedLongEquals(0ul, c->numMessages);
+  assertUnsignedLongEquals(0ul, c->numMessagesRejected);
+  assertUnsignedLongEquals(0ul, c->numMessagesDropped);
+  freeControlChannel(c);
+  return 0;
+}
+
+static int _testHandleInvalidCommands(void) {
+  ControlChannel c = _newTestControlChannel();
+  assertFalse(controlChannelHandleCommand(c, ""));
+  assertFalse(controlChannelHandleCommand(c, "invalid 0 0 1"));
+  assertFalse(controlChannelHandleCommand(c, "param 0 0"));
+  assertFalse(controlChannelHandleCommand(c, "param 0 0 1 2"));
+  assertFalse(controlChannelHandleCommand(c, "params 0 0 1"));
+  assertFalse(controlChannelHandleCommand(c, "midi 0 0x90"));
+  assertFalse(controlChannelHandleCommand(c, "midi 0 0xf0 1 2"));
+  assertFalse(controlChannelHandleCommand(c, "midi 0 60 100 0"));
+  assertFalse(controlChannelHandleCommand(c, "midi 0 0x90 128 0"));
+  assertFalse(controlChannelHandleCommand(c, "midi 0 0x90 60 100 1"));
+  freeControlChannel(c);
+  return 0;
+}
+
+static int _testProcessParameterCommand(void) {
+  ControlChannel c = _newTestControlChannel();
+  PluginChain p = _newTestPluginChain();
+  AudioClock clock = newAudioClock();
+
+  assert(controlChannelHandleCommand(c, "param 0 0 0.25"));
+  assertDoubleEquals(1.0, _getTestGain(p), TEST_DEFAULT_TOLERANCE);
+  controlChannelProcess(c, p, clock, NULL);
+  assertDoubleEquals(0.25, _getTestGain(p), TEST_DEFAULT_TOLERANCE);
+  assertUnsignedLongEquals(1ul, c->numMessages);
+  assertUnsignedLongEquals(0ul, c->numMessagesRejected);
+
+  // Messages are only applied once
+  ((PluginGainSettings)p->plugins[0]->extraData)->gain = 1.0f;
+  controlChannelProcess(c, p, clock, NULL);
+  assertDoubleEquals(1.0, _getTestGain(p), TEST_DEFAULT_TOLERANCE);
+
+  freeAudioClock(clock);
+  freePluginChain(p);
+  freeControlChannel(c);
+  return 0;
+}
+
+static int _testProcessRejectedCommands(void) {
+  ControlChannel c = _newTestControlChannel();
+  PluginChain p = _newTestPluginChain();
+  AudioClock clock = newAudioClock();
+
+  assert(controlChannelHandleCommand(c, "param 2 0 0.5"));
+  assert(controlChannelHandleCommand(c, "midi 2 0x90 60 100"));
+  // The mock plugin does not have any parameters
+  assert(controlChannelHandleCommand(c, "param 1 0 0.5"));
+  controlChannelProcess(c, p, clock, NULL);
+  assertUnsignedLongEquals(0ul, c->numMessages);
+  assertUnsignedLongEquals(3ul, c->numMessagesRejected);
+
+  freeAudioClock(clock);
+  freePluginChain(p);
+  freeControlChannel(c);
+  return 0;
+}
+
+static int _testProcessMidiCommand(void) {
+  ControlChannel c = _newTestControlChannel();
+  PluginChain p = _newTestPluginChain();
+  PluginMockData mockData = (PluginMockData)p->plugins[1]->extraData;
+  AudioClock clock = newAudioClock();
+
+  assert(controlChannelHandleCommand(c, "midi 1 0x90 60 100"));
+  assert(controlChannelHandleCommand(c, "midi 1 128 60"));
+  assertFalse(mockData->processMidiCalled);
+  controlChannelProcess(c, p, clock, NULL);
+  assert(mockData->processMidiCalled);
+  assertUnsignedLongEquals(2ul, c->numMessages);
+
+  freeAudioClock(clock);
+  freePluginChain(p);
+  freeControlChannel(c);
+  return 0;
+}
+
+static int _testProcessMidiOncePerPlugin(void) {
+  ControlChannel c = _newTestControlChannel();
+  PluginChain p = newPluginChain();
+  Plugin head = newPluginMock();
+  Plugin tail = newPluginMock();
+  PluginMockData headData = (PluginMockData)head->extraData;
+  PluginMockData tailData = (PluginMockData)tail->extraData;
+  AudioClock clock = newAudioClock();
+  LinkedList midiEvents = newLinkedList();
+  MidiEventMembers blockEvents[2];
+
+  memset(blockEvents, 0, sizeof(blockEvents));
+  linkedListAppend(midiEvents, &blockEvents[0]);
+  linkedListAppend(midiEvents, &blockEvents[1]);
+  pluginChainAppend(p, head, NULL);
+  pluginChainAppend(p, tail, NULL);
+
+  assert(controlChannelHandleCommand(c, "midi 1 0x90 60 100"));
+  assert(controlChannelHandleCommand(c, "midi 0 0x90 64 100"));
+  assert(controlChannelHandleCommand(c, "param 0 0 0.5"));
+  assert(controlChannelHandleCommand(c, "midi 1 0x80 60 0"));
+  controlChannelProcess(c, p, clock, midiEvents);
+
+  // The head plugin gets its own event along with those of the block
+  assertIntEquals(1, headData->numMidiCalls);
+  assertIntEquals(3, headData->numMidiEvents);
+  assertIntEquals(1, tailData->numMidiCalls);
+  assertIntEquals(2, tailData->numMidiEvents);
+  assertUnsignedLongEquals(3ul, c->numMessages);
+
+  // Without any messages, the events of the block are still sent
+  controlChannelProcess(c, p, clock, midiEvents);
+  assertIntEquals(2, headData->numMidiCalls);
+  assertIntEquals(2, headData->numMidiEvents);
+  assertIntEquals(1, tailData->numMidiCalls);
+
+  freeLinkedList(midiEvents);
+  freeAudioClock(clock);
+  freePluginChain(p);
+  freeControlChannel(c);
+  return 0;
+}
+
+static int _testDropCommandsWhenFull(void) {
+  ControlChannel c = _newTestControlChannel();
+  PluginChain p = _newTestPluginChain();
+  AudioClock clock = newAudioClock();
+  int i;
+
+  for (i = 0; i < CONTROL_CHANNEL_QUEUE_CAPACITY; i++) {
+    assert(controlChannelHandleCommand(c, "param 0 0 0.5"));
+  }
+
+  assertFalse(controlChannelHandleCommand(c, "param 0 0 0.5"));
+  assertUnsignedLongEquals(1ul, c->numMessagesDropped);
+
+  // Once the messages have been applied, they can be used again
+  controlChannelProcess(c, p, clock, NULL);
+  assertUnsignedLongEquals((unsigned long)CONTROL_CHANNEL_QUEUE_CAPACITY,
+                           c->numMessages);
+  assert(controlChannelHandleCommand(c, "param 0 0 0.5"));
+
+  freeAudioClock(clock);
+  freePluginChain(p);
+  freeControlChannel(c);
+  return 0;
+}
+
+#if UNIX
+static boolByte _waitForTestGain(ControlChannel c, PluginChain p,
+                                 AudioClock clock, float gain) {
+  int i;
+
+  for (i = 0; i < TEST_CONTROL_NUM_TRIES; i++) {
+    controlChannelProcess(c, p, clock, NULL);
+
+    if (_getTestGain(p) == gain) {
+      return true;
+    }
+
+    taskTimerSleep(5);
+  }
+
+  return false;
+}
+#endif
+
+static int _testReceiveFromSocket(void) {
+#if UNIX
+  ControlChannel c = _newTestControlChannel();
+  PluginChain p = _newTestPluginChain();
+  AudioClock clock = newAudioClock();
+  File socketFile = newFileWithPathCString(TEST_CONTROL_PATH);
+  struct sockaddr_un address;
+  const char *commands = "param 0 0 0.5\ninvalid\r\nparam 0 0 0.75\n";
+  int clientSocket;
+
+  assert(controlChannelOpen(c));
+  assert(fileExists(socketFile));
+
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strncpy(address.sun_path, TEST_CONTROL_PATH, sizeof(address.sun_path) - 1);
+  clientSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+  assertIntEquals(0, connect(clientSocket, (struct sockaddr *)&address,
+                             sizeof(address)));
+  assertIntEquals((int)strlen(commands),
+                  (int)write(clientSocket, commands, strlen(commands)));
+  assert(_waitForTestGain(c, p, clock, 0.75f));
+  assertUnsignedLongEquals(2ul, c->numMessages);
+  close(clientSocket);
+
+  freeControlChannel(c);
+  assertFalse(fileExists(socketFile));
+
+  freeFile(socketFile);
+  freeAudioClock(clock);
+  freePluginChain(p);
+#endif
+  return 0;
+}
+
+static int _testReceiveFromNamedPipe(void) {
+#if UNIX
+  ControlChannel c = _newTestControlChannel();
+  PluginChain p = _newTestPluginChain();
+  AudioClock clock = newAudioClock();
+  const char *command = "param 0 0 0.5\n";
+  int writer;
+
+  assertIntEquals(0, mkfifo(TEST_CONTROL_PATH, 0600));
+  assert(controlChannelOpen(c));
+
+  // The channel keeps reading after a writer has closed the pipe
+  writer = open(TEST_CONTROL_PATH, O_WRONLY);
+  assert(writer >= 0);
+  assertIntEquals((int)strlen(command),
+                  (int)write(writer, command, strlen(command)));
+  close(writer);
+  assert(_waitForTestGain(c, p, clock, 0.5f));
+
+  command = "param 0 0 0.25\n";
+  writer = open(TEST_CONTROL_PATH, O_WRONLY);
+  assert(writer >= 0);
+  assertIntEquals((int)strlen(command),
+                  (int)write(writer, command, strlen(command)));
+  close(writer);
+  assert(_waitForTestGain(c, p, clock, 0.25f));
+
+  freeControlChannel(c);
+  freeAudioClock(clock);
+  freePluginChain(p);
+#endif
+  return 0;
+}
+
+TestSuite addControlChannelTests(void);
+TestSuite addControlChannelTests(void) {
+  TestSuite testSuite = newTestSuite("ControlChannel", _controlChannelTestSetup,
+                                     _controlChannelTestTeardown);
+  addTest(testSuite, "NewControlChannel", _testNewControlChannel);
+  addTest(testSuite, "HandleInvalidCommands", _testHandleInvalidCommands);
+  addTest(testSuite, "ProcessParameterCommand", _testProcessParameterCommand);
+  addTest(testSuite, "ProcessRejectedCommands", _testProcessRejectedCommands);
+  addTest(testSuite, "ProcessMidiCommand", _testProcessMidiCommand);
+  addTest(testSuite, "ProcessMidiOncePerPlugin",
+          _testProcessMidiOncePerPlugin);
+  addTest(testSuite, "DropCommandsWhenFull", _testDropCommandsWhenFull);
+  addTest(testSuite, "ReceiveFromSocket", _testReceiveFromSocket);
+  addTest(testSuite, "ReceiveFromNamedPipe", _testReceiveFromNamedPipe);
+  return testSuite;
+}
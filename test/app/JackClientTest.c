@@ -0,0 +1,195 @@
+//
+// JackClientTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "app/JackClient.h"
+
+#include "audio/AudioSettings.h"
+#include "io/SampleSource.h"
+#include "time/TaskTimer.h"
+#include "unit/TestFiles.h"
+#include "unit/TestRunner.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// The test runs its own server, so that it does not disturb any server which
+// is already running
+#define TEST_JACK_SERVER_NAME "mrswatsontest"
+#define TEST_JACK_INPUT "mrswatsontest-jack-input.pcm"
+#define TEST_JACK_OUTPUT "mrswatsontest-jack-output.pcm"
+// Time to wait for the server to accept clients after it was started
+#define TEST_JACK_SERVER_START_TIME_IN_MS 5000
+#define TEST_JACK_POLL_TIME_IN_MS 100.0
+// Time after which the client is stopped if it has not reached the end of
+// the input file
+#define TEST_JACK_MAX_TIME_IN_MS 10000
+
+static void _jackClientTestSetup(void) { initAudioSettings(); }
+
+static void _jackClientTestTeardown(void) {
+  removeTestFile(TEST_JACK_INPUT);
+  removeTestFile(TEST_JACK_OUTPUT);
+  freeAudioSettings();
+}
+
+/**
+ * Start jackd with the dummy driver, which runs the process cycle from a timer
+ * rather than a sound card.
+ * @return Process ID of the server, or -1 if it could not be started
+ */
+static pid_t _startDummyJackServer(void) {
+  pid_t server;
+  int devNull;
+
+  // Clients connect to the server which is named by this variable
+  setenv("JACK_DEFAULT_SERVER", TEST_JACK_SERVER_NAME, 1);
+  server = fork();
+
+  if (server == 0) {
+    devNull = open("/dev/null", O_WRONLY);
+
+    if (devNull >= 0) {
+      dup2(devNull, STDOUT_FILENO);
+      dup2(devNull, STDERR_FILENO);
+    }
+
+    execlp("jackd", "jackd", "-n", TEST_JACK_SERVER_NAME, "--no-realtime",
+           "-d", "dummy", "-r", "44100", "-p", "256", (char *)NULL);
+    _exit(127);
+  }
+
+  return server;
+}
+
+static void _stopDummyJackServer(pid_t server) {
+  kill(server, SIGTERM);
+  waitpid(server, NULL, 0);
+  unsetenv("JACK_DEFAULT_SERVER");
+}
+
+/**
+ * Connect the client to a server which was just started, retrying until the
+ * server is ready.
+ * @return False if the server exited, which means that jackd is not installed
+ * or can not run here
+ */
+static boolByte _openJackClientWhenReady(JackClient client, pid_t server) {
+  double elapsedTimeInMs = 0.0;
+
+  while (elapsedTimeInMs < TEST_JACK_SERVER_START_TIME_IN_MS) {
+    if (waitpid(server, NULL, WNOHANG) == server) {
+      return false;
+    }
+
+    taskTimerSleep(TEST_JACK_POLL_TIME_IN_MS);
+    elapsedTimeInMs += TEST_JACK_POLL_TIME_IN_MS;
+
+    if (jackClientOpen(client)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static int _testRunPassthruWithDummyServer(void) {
+  pid_t server = _startDummyJackServer();
+  JackClient client = newJackClient(NULL);
+  CharString plugins;
+  CharString searchRoot;
+  CharString inputName;
+  CharString outputName;
+  PluginChain pluginChain;
+  SampleSource inputSource;
+  SampleSource outputSource;
+  unsigned long framesWritten = 0;
+  ReturnCode result = RETURN_CODE_NOT_RUN;
+
+  if (server < 0 || !_openJackClientWhenReady(client, server)) {
+    // A server which didn't accept the client may still be running
+    if (server >= 0) {
+      _stopDummyJackServer(server);
+    }
+
+    freeJackClient(client);
+    return -1;
+  }
+
+  // The input doesn't end on a block boundary, so the last block is padded
+  writeTestInput(TEST_JACK_INPUT, getBlocksize() * 8 + 100, NULL);
+  plugins = newCharStringWithCString("mrs_passthru");
+  searchRoot = newCharString();
+  inputName = newCharStringWithCString(TEST_JACK_INPUT);
+  outputName = newCharStringWithCString(TEST_JACK_OUTPUT);
+  pluginChain = newPluginChain();
+  inputSource = sampleSourceFactory(inputName);
+  outputSource = sampleSourceFactory(outputName);
+
+  if (pluginChainAddFromArgumentString(pluginChain, plugins, searchRoot) &&
+      pluginChainInitialize(pluginChain) == RETURN_CODE_SUCCESS &&
+      inputSource->openSampleSource(inputSource, SAMPLE_SOURCE_OPEN_READ) &&
+      outputSource->openSampleSource(outputSource, SAMPLE_SOURCE_OPEN_WRITE)) {
+    pluginChainPrepareForProcessing(pluginChain);
+    result = jackClientRun(client, pluginChain, inputSource, outputSource, NULL,
+                           TEST_JACK_MAX_TIME_IN_MS);
+    framesWritten = outputSource->numSamplesProcessed / getNumChannels();
+    inputSource->closeSampleSource(inputSource);
+    outputSource->closeSampleSource(outputSource);
+    pluginChainShutdown(pluginChain);
+  }
+
+  // Everything is cleaned up before checking the results, so that a failure
+  // doesn't leave the server running
+  freeSampleSource(inputSource);
+  freeSampleSource(outputSource);
+  freePluginChain(pluginChain);
+  freeCharString(plugins);
+  freeCharString(searchRoot);
+  freeCharString(inputName);
+  freeCharString(outputName);
+  _stopDummyJackServer(server);
+
+  assertIntEquals(RETURN_CODE_SUCCESS, result);
+  assertUnsignedLongEquals((unsigned long)getBlocksize() * 9, framesWritten);
+  assertUnsignedLongEquals(0ul, client->numXruns);
+  assertUnsignedLongEquals(0ul, client->numUnderruns);
+  assertUnsignedLongEquals(0ul, client->numOverruns);
+
+  freeJackClient(client);
+  return 0;
+}
+
+TestSuite addJackClientTests(void);
+TestSuite addJackClientTests(void) {
+  TestSuite testSuite = newTestSuite("JackClient", _jackClientTestSetup,
+                                     _jackClientTestTeardown);
+  addTest(testSuite, "RunPassthruWithDummyServer",
+          _testRunPassthruWithDummyServer);
+  return testSuite;
+}
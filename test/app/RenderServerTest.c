@@ -0,0 +1,212 @@
+//
+// RenderServerTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "app/RenderServer.h"
+
+#include "audio/AudioSettings.h"
+#include "base/File.h"
+#include "unit/TestFiles.h"
+#include "unit/TestRunner.h"
+
+#if UNIX
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#define TEST_SERVER_SOCKET "mrswatsontest-server.sock"
+#define TEST_SERVER_INPUT "mrswatsontest-server-input.pcm"
+#define TEST_SERVER_OUTPUT "mrswatsontest-server-output.pcm"
+
+static void _renderServerTestSetup(void) { initAudioSettings(); }
+
+static void _renderServerTestTeardown(void) {
+  removeTestFile(TEST_SERVER_SOCKET);
+  removeTestFile(TEST_SERVER_INPUT);
+  removeTestFile(TEST_SERVER_OUTPUT);
+  freeAudioSettings();
+}
+
+static RenderServer _newTestRenderServer(void) {
+  CharString socketPath = newCharStringWithCString(TEST_SERVER_SOCKET);
+  CharString plugins = newCharStringWithCString("mrs_passthru");
+  CharString searchRoot = newCharString();
+  RenderServer s = newRenderServer(socketPath, plugins, NULL, searchRoot);
+  freeCharString(socketPath);
+  freeCharString(plugins);
+  freeCharString(searchRoot);
+  return s;
+}
+
+static int _testNewRenderServer(void) {
+  RenderServer s = _newTestRenderServer();
+  assertNotNull(s);
+  assertCharStringEquals(TEST_SERVER_SOCKET, s->socketPath);
+  assertUnsignedLongEquals(0ul, s->numRequests);
+  assertUnsignedLongEquals(0ul, s->numRequestsFailed);
+  freeRenderServer(s);
+  return 0;
+}
+
+#if UNIX
+static void _runTestServer(void *userData) {
+  RenderServer s = (RenderServer)userData;
+  renderServerRun(s);
+}
+
+static int _connectToTestServer(void) {
+  struct sockaddr_un address;
+  int clientSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strncpy(address.sun_path, TEST_SERVER_SOCKET, sizeof(address.sun_path) - 1);
+
+  if (connect(clientSocket, (struct sockaddr *)&address, sizeof(address))) {
+    close(clientSocket);
+    return -1;
+  }
+
+  return clientSocket;
+}
+
+// Send a request and read the single line response
+static boolByte _sendTestRequest(int clientSocket, const char *request,
+                                 CharString response) {
+  size_t length = 0;
+  char c;
+
+  if (write(clientSocket, request, strlen(request)) < 0) {
+    return false;
+  }
+
+  charStringClear(response);
+
+  while (length < response->capacity - 1 && read(clientSocket, &c, 1) == 1) {
+    if (c == '\n') {
+      return true;
+    }
+
+    response->data[length++] = c;
+  }
+
+  return false;
+}
+#endif
+
+static int _testOpenWithStaleSocket(void) {
+#if UNIX
+  RenderServer s = _newTestRenderServer();
+  File staleSocket = newFileWithPathCString(TEST_SERVER_SOCKET);
+
+  assert(fileCreate(staleSocket, kFileTypeFile));
+  assert(renderServerOpen(s));
+
+  freeFile(staleSocket);
+  freeRenderServer(s);
+#endif
+  return 0;
+}
+
+static int _testOpenWhileAnotherServerIsListening(void) {
+#if UNIX
+  RenderServer s1 = _newTestRenderServer();
+  RenderServer s2 = _newTestRenderServer();
+
+  assert(renderServerOpen(s1));
+  assertFalse(renderServerOpen(s2));
+
+  freeRenderServer(s2);
+  freeRenderServer(s1);
+#endif
+  return 0;
+}
+
+static int _testServeRequests(void) {
+#if UNIX
+  RenderServer s = _newTestRenderServer();
+  CharString response = newCharStringWithCapacity(64);
+  File socketFile = newFileWithPathCString(TEST_SERVER_SOCKET);
+  Thread serverThread;
+  int clientSocket;
+  int idleClientSocket;
+  char expected[64];
+
+  writeTestInput(TEST_SERVER_INPUT, DEFAULT_BLOCKSIZE, NULL);
+  snprintf(expected, 64, "OK %ld", getBlocksize());
+  assert(renderServerOpen(s));
+  serverThread = newThread(_runTestServer, s);
+  assertNotNull(serverThread);
+
+  clientSocket = _connectToTestServer();
+  assert(clientSocket >= 0);
+  assert(_sendTestRequest(
+      clientSocket, TEST_SERVER_INPUT "," TEST_SERVER_OUTPUT "\n", response));
+  assertCharStringEquals(expected, response);
+  assert(_sendTestRequest(clientSocket,
+                          TEST_SERVER_INPUT "," TEST_SERVER_OUTPUT "\r\n",
+                          response));
+  assertCharStringEquals(expected, response);
+  assert(_sendTestRequest(clientSocket, "mrswatsontest-missing.pcm,out.pcm\n",
+                          response));
+  assertCharStringEquals("ERROR Render failed", response);
+  assert(_sendTestRequest(clientSocket, "invalid\n", response));
+  assertCharStringEquals("ERROR Invalid request", response);
+
+  // A client which is still connected must not block other clients
+  idleClientSocket = clientSocket;
+  clientSocket = _connectToTestServer();
+  assert(clientSocket >= 0);
+  assert(_sendTestRequest(clientSocket, "shutdown\n", response));
+  assertCharStringEquals("OK", response);
+  close(clientSocket);
+  close(idleClientSocket);
+  freeThread(serverThread);
+
+  assertUnsignedLongEquals(4ul, s->numRequests);
+  assertUnsignedLongEquals(2ul, s->numRequestsFailed);
+  assertUnsignedLongEquals(1ul, s->_worker->numChainsLoaded);
+  assertFalse(fileExists(socketFile));
+
+  freeFile(socketFile);
+  freeCharString(response);
+  freeRenderServer(s);
+#endif
+  return 0;
+}
+
+TestSuite addRenderServerTests(void);
+TestSuite addRenderServerTests(void) {
+  TestSuite testSuite = newTestSuite("RenderServer", _renderServerTestSetup,
+                                     _renderServerTestTeardown);
+  addTest(testSuite, "NewRenderServer", _testNewRenderServer);
+  addTest(testSuite, "OpenWithStaleSocket", _testOpenWithStaleSocket);
+  addTest(testSuite, "OpenWhileAnotherServerIsListening",
+          _testOpenWhileAnotherServerIsListening);
+  addTest(testSuite, "ServeRequests", _testServeRequests);
+  return testSuite;
+}
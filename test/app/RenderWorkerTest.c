@@ -0,0 +1,157 @@
+//
+// RenderWorkerTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "app/RenderWorker.h"
+
+#include "audio/AudioSettings.h"
+#include "unit/TestFiles.h"
+#include "unit/TestRunner.h"
+
+#define TEST_WORKER_INPUT "mrswatsontest-worker-input.pcm"
+#define TEST_WORKER_OUTPUT "mrswatsontest-worker-output.pcm"
+#define TEST_WORKER_NUM_FRAMES (DEFAULT_BLOCKSIZE * 2)
+
+static void _renderWorkerTestSetup(void) { initAudioSettings(); }
+
+static void _renderWorkerTestTeardown(void) {
+  removeTestFile(TEST_WORKER_INPUT);
+  removeTestFile(TEST_WORKER_OUTPUT);
+  freeAudioSettings();
+}
+
+static RenderWorker _newTestRenderWorker(unsigned int maxChains) {
+  CharString plugins = newCharStringWithCString("mrs_passthru");
+  CharString searchRoot = newCharString();
+  RenderWorker w = newRenderWorker(plugins, NULL, searchRoot, maxChains, NULL);
+  freeCharString(plugins);
+  freeCharString(searchRoot);
+  return w;
+}
+
+static int _testNewRenderJob(void) {
+  RenderJob j = newRenderJob("a.wav", "b.wav", NULL, NULL);
+  assertCharStringEquals("a.wav", j->inputName);
+  assertCharStringEquals("b.wav", j->outputName);
+  assert(charStringIsEmpty(j->plugins));
+  assert(charStringIsEmpty(j->parameters));
+  assertUnsignedLongEquals(0ul, j->numFramesWritten);
+  freeRenderJob(j);
+  return 0;
+}
+
+static int _testRenderReusesChain(void) {
+  RenderWorker w = _newTestRenderWorker(2);
+  RenderJob j = newRenderJob(TEST_WORKER_INPUT, TEST_WORKER_OUTPUT, NULL, NULL);
+
+  writeTestInput(TEST_WORKER_INPUT, TEST_WORKER_NUM_FRAMES, NULL);
+  assert(renderWorkerRender(w, j));
+  assertUnsignedLongEquals((unsigned long)TEST_WORKER_NUM_FRAMES,
+                           j->numFramesWritten);
+  assert(renderWorkerRender(w, j));
+  assertUnsignedLongEquals((unsigned long)TEST_WORKER_NUM_FRAMES,
+                           j->numFramesWritten);
+  assertUnsignedLongEquals(2ul, w->numJobsRendered);
+  assertUnsignedLongEquals(1ul, w->numChainsLoaded);
+
+  freeRenderJob(j);
+  freeRenderWorker(w);
+  return 0;
+}
+
+static int _testRenderEvictsLeastRecentlyUsedChain(void) {
+  RenderWorker w = _newTestRenderWorker(2);
+  RenderJob passthru =
+      newRenderJob(TEST_WORKER_INPUT, TEST_WORKER_OUTPUT, NULL, NULL);
+  RenderJob gain =
+      newRenderJob(TEST_WORKER_INPUT, TEST_WORKER_OUTPUT, "mrs_gain", NULL);
+  RenderJob limiter =
+      newRenderJob(TEST_WORKER_INPUT, TEST_WORKER_OUTPUT, "mrs_limiter", NULL);
+
+  writeTestInput(TEST_WORKER_INPUT, TEST_WORKER_NUM_FRAMES, NULL);
+  assert(renderWorkerRender(w, passthru));
+  assert(renderWorkerRender(w, gain));
+  assert(renderWorkerRender(w, passthru));
+  assertUnsignedLongEquals(2ul, w->numChainsLoaded);
+
+  // The gain chain is the least recently used, so it should be replaced
+  assert(renderWorkerRender(w, limiter));
+  assert(renderWorkerRender(w, passthru));
+  assertUnsignedLongEquals(3ul, w->numChainsLoaded);
+  assert(renderWorkerRender(w, gain));
+  assertUnsignedLongEquals(4ul, w->numChainsLoaded);
+
+  freeRenderJob(passthru);
+  freeRenderJob(gain);
+  freeRenderJob(limiter);
+  freeRenderWorker(w);
+  return 0;
+}
+
+static int _testRenderWithDifferentParametersLoadsNewChain(void) {
+  RenderWorker w = _newTestRenderWorker(2);
+  RenderJob j1 =
+      newRenderJob(TEST_WORKER_INPUT, TEST_WORKER_OUTPUT, "mrs_gain", "0,0.5");
+  RenderJob j2 =
+      newRenderJob(TEST_WORKER_INPUT, TEST_WORKER_OUTPUT, "mrs_gain", "0,0.25");
+
+  writeTestInput(TEST_WORKER_INPUT, TEST_WORKER_NUM_FRAMES, NULL);
+  assert(renderWorkerRender(w, j1));
+  assert(renderWorkerRender(w, j2));
+  assertUnsignedLongEquals(2ul, w->numChainsLoaded);
+
+  freeRenderJob(j1);
+  freeRenderJob(j2);
+  freeRenderWorker(w);
+  return 0;
+}
+
+static int _testRenderWithInvalidChain(void) {
+  RenderWorker w = _newTestRenderWorker(2);
+  RenderJob j = newRenderJob(TEST_WORKER_INPUT, TEST_WORKER_OUTPUT,
+                             "mrswatsontest-invalid", NULL);
+
+  writeTestInput(TEST_WORKER_INPUT, TEST_WORKER_NUM_FRAMES, NULL);
+  assertFalse(renderWorkerRender(w, j));
+  assertUnsignedLongEquals(0ul, w->numChainsLoaded);
+
+  freeRenderJob(j);
+  freeRenderWorker(w);
+  return 0;
+}
+
+TestSuite addRenderWorkerTests(void);
+TestSuite addRenderWorkerTests(void) {
+  TestSuite testSuite = newTestSuite("RenderWorker", _renderWorkerTestSetup,
+                                     _renderWorkerTestTeardown);
+  addTest(testSuite, "NewRenderJob", _testNewRenderJob);
+  addTest(testSuite, "RenderReusesChain", _testRenderReusesChain);
+  addTest(testSuite, "RenderEvictsLeastRecentlyUsedChain",
+          _testRenderEvictsLeastRecentlyUsedChain);
+  addTest(testSuite, "RenderWithDifferentParametersLoadsNewChain",
+          _testRenderWithDifferentParametersLoadsNewChain);
+  addTest(testSuite, "RenderWithInvalidChain", _testRenderWithInvalidChain);
+  return testSuite;
+}
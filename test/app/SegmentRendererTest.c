@@ -0,0 +1,174 @@
+//
+// SegmentRendererTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "app/SegmentRenderer.h"
+
+#include "audio/AudioSettings.h"
+#include "io/SampleSource.h"
+#include "unit/TestFiles.h"
+#include "unit/TestRunner.h"
+
+#define TEST_SEGMENT_INPUT "mrswatsontest-segment-input.pcm"
+#define TEST_SEGMENT_OUTPUT "mrswatsontest-segment-output.pcm"
+#define TEST_SEGMENT_NUM_BLOCKS 20
+#define TEST_SEGMENT_NUM_FRAMES (DEFAULT_BLOCKSIZE * TEST_SEGMENT_NUM_BLOCKS)
+
+static void _segmentRendererTestSetup(void) { initAudioSettings(); }
+
+static void _segmentRendererTestTeardown(void) {
+  removeTestFile(TEST_SEGMENT_INPUT);
+  removeTestFile(TEST_SEGMENT_OUTPUT);
+  freeAudioSettings();
+}
+
+// Samples lie halfway between hundredths, so that they still compare as equal
+// after being converted to 16-bit PCM and back
+static Sample _testSample(unsigned long frame, ChannelCount channel) {
+  Sample sample = (Sample)(frame % 90) / 100.0f + 0.005f;
+  return channel == 0 ? sample : -sample;
+}
+
+static SampleSource _openTestSource(const char *name,
+                                    SampleSourceOpenAs openAs) {
+  CharString sourceName = newCharStringWithCString(name);
+  SampleSource s = sampleSourceFactory(sourceName);
+
+  if (openAs != SAMPLE_SOURCE_OPEN_NOT_OPENED) {
+    s->openSampleSource(s, openAs);
+  }
+
+  freeCharString(sourceName);
+  return s;
+}
+
+static SegmentRenderer _newTestSegmentRenderer(const char *plugins) {
+  CharString pluginString = newCharStringWithCString(plugins);
+  CharString searchRoot = newCharString();
+  SegmentRenderer r = newSegmentRenderer(pluginString, NULL, searchRoot);
+  freeCharString(pluginString);
+  freeCharString(searchRoot);
+  return r;
+}
+
+static int _testSplitSegments(void) {
+  SegmentRenderer r = _newTestSegmentRenderer("mrs_passthru");
+
+  assertIntEquals(4, segmentRendererSplit(r, 4000, 4, 100, 50));
+  assertUnsignedLongEquals(0ul, r->segments[0]->preRollFrame);
+  assertUnsignedLongEquals(0ul, r->segments[0]->startFrame);
+  assertUnsignedLongEquals(1100ul, r->segments[0]->endFrame);
+  assertUnsignedLongEquals(850ul, r->segments[1]->preRollFrame);
+  assertUnsignedLongEquals(1000ul, r->segments[1]->startFrame);
+  assertUnsignedLongEquals(2100ul, r->segments[1]->endFrame);
+  assertUnsignedLongEquals(3000ul, r->segments[3]->startFrame);
+  assertUnsignedLongEquals(4000ul, r->segments[3]->endFrame);
+
+  freeSegmentRenderer(r);
+  return 0;
+}
+
+static int _testSplitShortInput(void) {
+  SegmentRenderer r = _newTestSegmentRenderer("mrs_passthru");
+
+  // Segments are never shorter than the blocksize
+  assertIntEquals(2, segmentRendererSplit(r, DEFAULT_BLOCKSIZE * 2, 8, 0, 0));
+  assertIntEquals(1, segmentRendererSplit(r, 10, 8, 0, 0));
+  assertUnsignedLongEquals(10ul, r->segments[0]->endFrame);
+
+  freeSegmentRenderer(r);
+  return 0;
+}
+
+static int _testRenderSegments(void) {
+  SegmentRenderer r = _newTestSegmentRenderer("mrs_passthru");
+  SampleSource input;
+  SampleSource output;
+  SampleBuffer b = newSampleBuffer(getNumChannels(), TEST_SEGMENT_NUM_FRAMES);
+  SampleCount i;
+
+  writeTestInput(TEST_SEGMENT_INPUT, TEST_SEGMENT_NUM_FRAMES, _testSample);
+  input = _openTestSource(TEST_SEGMENT_INPUT, SAMPLE_SOURCE_OPEN_READ);
+  output = _openTestSource(TEST_SEGMENT_OUTPUT, SAMPLE_SOURCE_OPEN_NOT_OPENED);
+  assertIntEquals(RETURN_CODE_SUCCESS,
+                  segmentRendererRun(r, input, output, 4, 10));
+  assertIntEquals(4, r->numSegments);
+  assertUnsignedLongEquals((unsigned long)TEST_SEGMENT_NUM_FRAMES,
+                           r->numFrames);
+  assertUnsignedLongEquals((unsigned long)TEST_SEGMENT_NUM_FRAMES,
+                           output->numSamplesProcessed / getNumChannels());
+  freeSampleSource(output);
+
+  // The segments of a stateless chain should join up without any seams
+  output = _openTestSource(TEST_SEGMENT_OUTPUT, SAMPLE_SOURCE_OPEN_READ);
+  output->readSampleBlock(output, b);
+  assertUnsignedLongEquals((unsigned long)TEST_SEGMENT_NUM_FRAMES,
+                           (unsigned long)b->blocksize);
+
+  for (i = 0; i < b->blocksize; i++) {
+    assertDoubleEquals(_testSample(i, 0), b->samples[0][i],
+                       TEST_DEFAULT_TOLERANCE);
+    assertDoubleEquals(_testSample(i, 1), b->samples[1][i],
+                       TEST_DEFAULT_TOLERANCE);
+  }
+
+  output->closeSampleSource(output);
+  freeSampleSource(input);
+  freeSampleSource(output);
+  freeSampleBuffer(b);
+  freeSegmentRenderer(r);
+  return 0;
+}
+
+static int _testRenderSegmentsWithInvalidChain(void) {
+  SegmentRenderer r = _newTestSegmentRenderer("invalid");
+  SampleSource input;
+  SampleSource output;
+
+  writeTestInput(TEST_SEGMENT_INPUT, TEST_SEGMENT_NUM_FRAMES, _testSample);
+  input = _openTestSource(TEST_SEGMENT_INPUT, SAMPLE_SOURCE_OPEN_READ);
+  output = _openTestSource(TEST_SEGMENT_OUTPUT, SAMPLE_SOURCE_OPEN_NOT_OPENED);
+  assertIntEquals(RETURN_CODE_INVALID_PLUGIN_CHAIN,
+                  segmentRendererRun(r, input, output, 4, 0));
+  assertIntEquals(0, r->numSegments);
+
+  freeSampleSource(input);
+  freeSampleSource(output);
+  freeSegmentRenderer(r);
+  return 0;
+}
+
+TestSuite addSegmentRendererTests(void);
+TestSuite addSegmentRendererTests(void) {
+  TestSuite testSuite =
+      newTestSuite("SegmentRenderer", _segmentRendererTestSetup,
+                   _segmentRendererTestTeardown);
+  addTest(testSuite, "SplitSegments", _testSplitSegments);
+  addTest(testSuite, "SplitShortInput", _testSplitShortInput);
+  addTest(testSuite, "RenderSegments", _testRenderSegments);
+  addTest(testSuite, "RenderSegmentsWithInvalidChain",
+          _testRenderSegmentsWithInvalidChain);
+  return testSuite;
+}
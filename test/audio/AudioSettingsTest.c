@@ -51,6 +51,21 @@ static int _testSetSampleRate(void) {
   return 0;
 }
 
+static int _testThreadAudioSettings(void) {
+  AudioSettings threadSettings;
+
+  setSampleRate(22050.0);
+  threadSettings = newAudioSettingsCopy();
+  setThreadAudioSettings(threadSettings);
+  assertDoubleEquals(22050.0, getSampleRate(), TEST_DEFAULT_TOLERANCE);
+  setSampleRate(48000.0);
+  assertDoubleEquals(48000.0, getSampleRate(), TEST_DEFAULT_TOLERANCE);
+  setThreadAudioSettings(NULL);
+  assertDoubleEquals(22050.0, getSampleRate(), TEST_DEFAULT_TOLERANCE);
+  freeAudioSettingsCopy(threadSettings);
+  return 0;
+}
+
 static int _testSetInvalidSampleRate(void) {
   setSampleRate(22050.0);
   assertDoubleEquals(22050.0, getSampleRate(), TEST_DEFAULT_TOLERANCE);
@@ -237,6 +252,7 @@ TestSuite addAudioSettingsTests(void) {
           _testSetTimeSignatureFromNullString);
 
   addTest(testSuite, "SetBitDepth", _testSetBitDepth);
+  addTest(testSuite, "ThreadAudioSettings", _testThreadAudioSettings);
 
   return testSuite;
 }
@@ -167,6 +167,20 @@ static int _testConvertByteArrayToUnsignedInt(void) {
   return 0;
 }
 
+static int _testConvertBigEndianByteArrayToUnsignedShort(void) {
+  const byte b[2] = {0xaa, 0xab};
+  assertUnsignedLongEquals(0xaaabul,
+                           convertBigEndianByteArrayToUnsignedShort(b));
+  return 0;
+}
+
+static int _testConvertBigEndianByteArrayToUnsignedInt(void) {
+  const byte b[4] = {0xaa, 0xab, 0xac, 0xad};
+  assertUnsignedLongEquals(0xaaabacadul,
+                           convertBigEndianByteArrayToUnsignedInt(b));
+  return 0;
+}
+
 TestSuite addEndianTests(void);
 TestSuite addEndianTests(void) {
   TestSuite testSuite = newTestSuite("Endian", NULL, NULL);
@@ -187,6 +201,10 @@ TestSuite addEndianTests(void) {
           _testConvertByteArrayToUnsignedShort);
   addTest(testSuite, "ConvertByteArrayToUnsignedInt",
           _testConvertByteArrayToUnsignedInt);
+  addTest(testSuite, "ConvertBigEndianByteArrayToUnsignedShort",
+          _testConvertBigEndianByteArrayToUnsignedShort);
+  addTest(testSuite, "ConvertBigEndianByteArrayToUnsignedInt",
+          _testConvertBigEndianByteArrayToUnsignedInt);
 
   return testSuite;
 }
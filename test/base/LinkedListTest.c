@@ -227,6 +227,65 @@ static int _testFreeNullLinkedList(void) {
   return 0;
 }
 
+static int _testNewLinkedListBuffer(void) {
+  LinkedListBuffer b = newLinkedListBuffer(4);
+  LinkedList l = linkedListBufferGetList(b);
+  assertNotNull(l);
+  assertIsNull(l->item);
+  assertIsNull(l->nextItem);
+  assertIntEquals(0, linkedListLength(l));
+  freeLinkedListBuffer(b);
+  return 0;
+}
+
+static int _testAppendItemsToLinkedListBuffer(void) {
+  LinkedListBuffer b = newLinkedListBuffer(1);
+  LinkedList l;
+  void **array;
+
+  linkedListBufferAppend(b, TEST_ITEM_STRING);
+  linkedListBufferAppend(b, NULL);
+  linkedListBufferAppend(b, OTHER_TEST_ITEM_STRING);
+  linkedListBufferAppend(b, TEST_ITEM_STRING);
+  l = linkedListBufferGetList(b);
+  assertIntEquals(3, linkedListLength(l));
+
+  array = linkedListToArray(l);
+  assertNotNull(array);
+  assert(array[0] == TEST_ITEM_STRING);
+  assert(array[1] == OTHER_TEST_ITEM_STRING);
+  assert(array[2] == TEST_ITEM_STRING);
+  assertIsNull(array[3]);
+
+  free(array);
+  freeLinkedListBuffer(b);
+  return 0;
+}
+
+static int _testClearLinkedListBuffer(void) {
+  LinkedListBuffer b = newLinkedListBuffer(2);
+  LinkedList l;
+
+  linkedListBufferAppend(b, OTHER_TEST_ITEM_STRING);
+  linkedListBufferAppend(b, OTHER_TEST_ITEM_STRING);
+  linkedListBufferClear(b);
+  assertIntEquals(0, linkedListLength(linkedListBufferGetList(b)));
+
+  linkedListBufferAppend(b, TEST_ITEM_STRING);
+  l = linkedListBufferGetList(b);
+  assertIntEquals(1, linkedListLength(l));
+  assert(l->item == TEST_ITEM_STRING);
+  assertIsNull(l->nextItem);
+
+  freeLinkedListBuffer(b);
+  return 0;
+}
+
+static int _testFreeNullLinkedListBuffer(void) {
+  freeLinkedListBuffer(NULL);
+  return 0;
+}
+
 TestSuite addLinkedListTests(void);
 TestSuite addLinkedListTests(void) {
   TestSuite testSuite = newTestSuite("LinkedList", _linkedListTestSetup, NULL);
@@ -252,5 +311,12 @@ TestSuite addLinkedListTests(void) {
 
   addTest(testSuite, "FreeNullLinkedList", _testFreeNullLinkedList);
 
+  addTest(testSuite, "NewLinkedListBuffer", _testNewLinkedListBuffer);
+  addTest(testSuite, "AppendItemsToLinkedListBuffer",
+          _testAppendItemsToLinkedListBuffer);
+  addTest(testSuite, "ClearLinkedListBuffer", _testClearLinkedListBuffer);
+  addTest(testSuite, "FreeNullLinkedListBuffer",
+          _testFreeNullLinkedListBuffer);
+
   return testSuite;
 }
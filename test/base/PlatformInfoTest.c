@@ -26,8 +26,11 @@
 
 #include "base/PlatformInfo.h"
 
+#include "base/File.h"
 #include "unit/TestRunner.h"
 
+#define TEST_SYS_PATH "mrswatsontest-sys"
+
 static int _testGetPlatformType(void) {
   PlatformInfo platform = newPlatformInfo();
 #if LINUX
@@ -82,9 +85,165 @@ static int _testIsHostLittleEndian(void) {
   return 0;
 }
 
+static void _platformInfoTestTeardown(void) {
+  File sysDir = newFileWithPathCString(TEST_SYS_PATH);
+
+  if (fileExists(sysDir)) {
+    fileRemove(sysDir);
+  }
+
+  freeFile(sysDir);
+}
+
+static void _writeSysFile(const char *name, const char *contents) {
+  CharString path = newCharStringWithCString(TEST_SYS_PATH "/");
+  CharString data = newCharStringWithCString(contents);
+  File file;
+
+  charStringAppendCString(path, name);
+
+  // Create each of the parent directories
+  for (char *c = path->data; *c != '\0'; c++) {
+    if (*c == '/') {
+      *c = '\0';
+      file = newFileWithPathCString(path->data);
+
+      if (!fileExists(file)) {
+        fileCreate(file, kFileTypeDirectory);
+      }
+
+      freeFile(file);
+      *c = '/';
+    }
+  }
+
+  file = newFileWithPathCString(path->data);
+  fileCreate(file, kFileTypeFile);
+  fileWrite(file, data);
+  freeFile(file);
+  freeCharString(data);
+  freeCharString(path);
+}
+
+// Two packages on their own NUMA nodes, each with two cores of two hardware
+// threads which share an L3 cache. Processors 0 and 2 are siblings, as are 1
+// and 3, and likewise on the second package.
+static void _writeTestSysTree(void) {
+  char name[128];
+  char contents[32];
+  int i;
+
+  _writeSysFile("cpu/online", "0-7\n");
+  _writeSysFile("node/online", "0-1\n");
+  _writeSysFile("node/node0/cpulist", "0-3\n");
+  _writeSysFile("node/node1/cpulist", "4-7\n");
+
+  for (i = 0; i < 8; i++) {
+    int package = i / 4;
+    int core = i % 2;
+
+    snprintf(name, sizeof(name), "cpu/cpu%d/topology/physical_package_id", i);
+    snprintf(contents, sizeof(contents), "%d\n", package);
+    _writeSysFile(name, contents);
+    snprintf(name, sizeof(name), "cpu/cpu%d/topology/thread_siblings_list", i);
+    snprintf(contents, sizeof(contents), "%d,%d\n", package * 4 + core,
+             package * 4 + core + 2);
+    _writeSysFile(name, contents);
+    snprintf(name, sizeof(name), "cpu/cpu%d/cache/index0/level", i);
+    _writeSysFile(name, "1\n");
+    snprintf(name, sizeof(name), "cpu/cpu%d/cache/index0/shared_cpu_list", i);
+    snprintf(contents, sizeof(contents), "%d,%d\n", package * 4 + core,
+             package * 4 + core + 2);
+    _writeSysFile(name, contents);
+    snprintf(name, sizeof(name), "cpu/cpu%d/cache/index1/level", i);
+    _writeSysFile(name, "3\n");
+    snprintf(name, sizeof(name), "cpu/cpu%d/cache/index1/shared_cpu_list", i);
+    snprintf(contents, sizeof(contents), "%d-%d\n", package * 4,
+             package * 4 + 3);
+    _writeSysFile(name, contents);
+  }
+}
+
+static int _testNewCpuTopology(void) {
+  CpuTopology topology = newCpuTopology();
+  assertNotNull(topology);
+  assertIntEquals((int)platformInfoGetNumProcessors(), topology->numProcessors);
+  assert(topology->numCores > 0);
+  assert(topology->numNumaNodes > 0);
+  freeCpuTopology(topology);
+  return 0;
+}
+
+static int _testReadCpuTopology(void) {
+  CpuTopology topology;
+
+  _writeTestSysTree();
+  topology = newCpuTopologyWithSysPath(TEST_SYS_PATH);
+  assertIntEquals(8, topology->numProcessors);
+  assertIntEquals(4, topology->numCores);
+  assertIntEquals(2, topology->numNumaNodes);
+  assertIntEquals(1, topology->processors[5].package);
+  assertIntEquals(1, topology->processors[5].numaNode);
+  assertIntEquals(4, topology->processors[5].cacheGroup);
+  assertFalse(topology->processors[1].isSmtSibling);
+  assert(topology->processors[3].isSmtSibling);
+  freeCpuTopology(topology);
+  return 0;
+}
+
+static int _testReadFlatCpuTopology(void) {
+  CpuTopology topology = newCpuTopologyWithSysPath(TEST_SYS_PATH);
+  assertIntEquals((int)platformInfoGetNumProcessors(), topology->numProcessors);
+  assertIntEquals(1, topology->numNumaNodes);
+  assertIntEquals(0, cpuTopologyGetProcessor(topology,
+                                             THREAD_PLACEMENT_SPREAD, 0));
+  freeCpuTopology(topology);
+  return 0;
+}
+
+static int _testGetProcessorCompact(void) {
+  const unsigned int expected[] = {0, 1, 2, 3, 4, 5, 6, 7};
+  CpuTopology topology;
+  unsigned int i;
+
+  _writeTestSysTree();
+  topology = newCpuTopologyWithSysPath(TEST_SYS_PATH);
+
+  for (i = 0; i < 8; i++) {
+    assertUnsignedLongEquals((unsigned long)expected[i],
+                             (unsigned long)cpuTopologyGetProcessor(
+                                 topology, THREAD_PLACEMENT_COMPACT, i));
+  }
+
+  // Placement wraps around when there are more threads than processors
+  assertIntEquals(1, cpuTopologyGetProcessor(topology,
+                                             THREAD_PLACEMENT_COMPACT, 9));
+  freeCpuTopology(topology);
+  return 0;
+}
+
+static int _testGetProcessorSpread(void) {
+  const unsigned int expected[] = {0, 4, 1, 5, 2, 6, 3, 7};
+  CpuTopology topology;
+  unsigned int i;
+
+  _writeTestSysTree();
+  topology = newCpuTopologyWithSysPath(TEST_SYS_PATH);
+
+  for (i = 0; i < 8; i++) {
+    assertUnsignedLongEquals((unsigned long)expected[i],
+                             (unsigned long)cpuTopologyGetProcessor(
+                                 topology, THREAD_PLACEMENT_SPREAD, i));
+  }
+
+  freeCpuTopology(topology);
+  return 0;
+}
+
 TestSuite addPlatformInfoTests(void);
 TestSuite addPlatformInfoTests(void) {
-  TestSuite testSuite = newTestSuite("PlatformInfo", NULL, NULL);
+  TestSuite testSuite =
+      newTestSuite("PlatformInfo", NULL, _platformInfoTestTeardown);
 
   addTest(testSuite, "GetPlatformType", _testGetPlatformType);
   addTest(testSuite, "GetPlatformName", _testGetPlatformName);
@@ -92,5 +251,11 @@ TestSuite addPlatformInfoTests(void) {
 
   addTest(testSuite, "IsHostLittleEndian", _testIsHostLittleEndian);
 
+  addTest(testSuite, "NewCpuTopology", _testNewCpuTopology);
+  addTest(testSuite, "ReadCpuTopology", _testReadCpuTopology);
+  addTest(testSuite, "ReadFlatCpuTopology", _testReadFlatCpuTopology);
+  addTest(testSuite, "GetProcessorCompact", _testGetProcessorCompact);
+  addTest(testSuite, "GetProcessorSpread", _testGetProcessorSpread);
+
   return testSuite;
 }
@@ -0,0 +1,272 @@
+//
+// QueueTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "base/Queue.h"
+
+#include "unit/TestRunner.h"
+
+#define TEST_QUEUE_CAPACITY 4
+#define TEST_NUM_ITEMS 100000
+#define TEST_NUM_THREADS 4
+// Items pushed by each producer when there are several of them
+#define TEST_NUM_MPMC_ITEMS 20000
+
+typedef struct {
+  MpmcQueue queue;
+  size_t firstItem;
+  size_t sum;
+} _QueueTestThreadData;
+
+static int _testNewSpscQueue(void) {
+  SpscQueue q = newSpscQueue(TEST_QUEUE_CAPACITY);
+  assertNotNull(q);
+  assertUnsignedLongEquals((unsigned long)TEST_QUEUE_CAPACITY,
+                           q->capacity);
+  assertUnsignedLongEquals(0ul, spscQueueGetSize(q));
+  freeSpscQueue(q);
+  return 0;
+}
+
+static int _testNewSpscQueueRoundsUpCapacity(void) {
+  SpscQueue q = newSpscQueue(5);
+  assertUnsignedLongEquals(8ul, q->capacity);
+  freeSpscQueue(q);
+  return 0;
+}
+
+static int _testPushAndPopInOrder(void) {
+  SpscQueue q = newSpscQueue(TEST_QUEUE_CAPACITY);
+  int items[TEST_QUEUE_CAPACITY];
+  int i;
+
+  for (i = 0; i < TEST_QUEUE_CAPACITY; i++) {
+    assert(spscQueuePush(q, &items[i]));
+  }
+
+  assertUnsignedLongEquals((unsigned long)TEST_QUEUE_CAPACITY,
+                           spscQueueGetSize(q));
+
+  for (i = 0; i < TEST_QUEUE_CAPACITY; i++) {
+    assert(spscQueuePop(q) == &items[i]);
+  }
+
+  assertUnsignedLongEquals(0ul, spscQueueGetSize(q));
+  freeSpscQueue(q);
+  return 0;
+}
+
+static int _testPushToFullQueue(void) {
+  SpscQueue q = newSpscQueue(1);
+  int item;
+
+  assert(spscQueuePush(q, &item));
+  assertFalse(spscQueuePush(q, &item));
+  assertUnsignedLongEquals(1ul, spscQueueGetSize(q));
+  freeSpscQueue(q);
+  return 0;
+}
+
+static int _testPopFromEmptyQueue(void) {
+  SpscQueue q = newSpscQueue(TEST_QUEUE_CAPACITY);
+  assertIsNull(spscQueuePop(q));
+  freeSpscQueue(q);
+  return 0;
+}
+
+static int _testPushAndPopWrapAround(void) {
+  SpscQueue q = newSpscQueue(TEST_QUEUE_CAPACITY);
+  int items[TEST_QUEUE_CAPACITY * 3];
+  int i;
+
+  for (i = 0; i < TEST_QUEUE_CAPACITY * 3; i++) {
+    assert(spscQueuePush(q, &items[i]));
+    assert(spscQueuePop(q) == &items[i]);
+  }
+
+  freeSpscQueue(q);
+  return 0;
+}
+
+static void _produceItems(void *userData) {
+  SpscQueue q = (SpscQueue)userData;
+  size_t i;
+
+  // Items start at 1, since NULL can't be pushed
+  for (i = 1; i <= TEST_NUM_ITEMS; i++) {
+    spscQueuePushWait(q, (void *)i);
+  }
+}
+
+static int _testPushAndPopWaitFromOtherThread(void) {
+  SpscQueue q = newSpscQueue(TEST_QUEUE_CAPACITY);
+  Thread t = newThread(_produceItems, q);
+  size_t i;
+
+  assertNotNull(t);
+
+  for (i = 1; i <= TEST_NUM_ITEMS; i++) {
+    size_t item = (size_t)spscQueuePopWait(q);
+    assertSizeEquals(i, item);
+  }
+
+  freeThread(t);
+  assertUnsignedLongEquals(0ul, spscQueueGetSize(q));
+  freeSpscQueue(q);
+  return 0;
+}
+
+static int _testNewMpmcQueue(void) {
+  MpmcQueue q = newMpmcQueue(5);
+  assertNotNull(q);
+  assertUnsignedLongEquals(8ul, q->capacity);
+  assertUnsignedLongEquals(0ul, mpmcQueueGetSize(q));
+  freeMpmcQueue(q);
+  return 0;
+}
+
+static int _testMpmcPushAndPopInOrder(void) {
+  MpmcQueue q = newMpmcQueue(TEST_QUEUE_CAPACITY);
+  int items[TEST_QUEUE_CAPACITY];
+  int i;
+
+  for (i = 0; i < TEST_QUEUE_CAPACITY; i++) {
+    assert(mpmcQueuePush(q, &items[i]));
+  }
+
+  assertUnsignedLongEquals((unsigned long)TEST_QUEUE_CAPACITY,
+                           mpmcQueueGetSize(q));
+
+  for (i = 0; i < TEST_QUEUE_CAPACITY; i++) {
+    assert(mpmcQueuePop(q) == &items[i]);
+  }
+
+  assertIsNull(mpmcQueuePop(q));
+  freeMpmcQueue(q);
+  return 0;
+}
+
+static int _testMpmcPushToFullQueue(void) {
+  MpmcQueue q = newMpmcQueue(1);
+  int item;
+
+  assertUnsignedLongEquals(2ul, q->capacity);
+  assert(mpmcQueuePush(q, &item));
+  assert(mpmcQueuePush(q, &item));
+  assertFalse(mpmcQueuePush(q, &item));
+  assertUnsignedLongEquals(2ul, mpmcQueueGetSize(q));
+  freeMpmcQueue(q);
+  return 0;
+}
+
+static int _testMpmcPushAndPopWrapAround(void) {
+  MpmcQueue q = newMpmcQueue(TEST_QUEUE_CAPACITY);
+  int items[TEST_QUEUE_CAPACITY * 3];
+  int i;
+
+  for (i = 0; i < TEST_QUEUE_CAPACITY * 3; i++) {
+    assert(mpmcQueuePush(q, &items[i]));
+    assert(mpmcQueuePop(q) == &items[i]);
+  }
+
+  freeMpmcQueue(q);
+  return 0;
+}
+
+static void _produceMpmcItems(void *userData) {
+  _QueueTestThreadData *data = (_QueueTestThreadData *)userData;
+  size_t i;
+
+  for (i = 0; i < TEST_NUM_MPMC_ITEMS; i++) {
+    mpmcQueuePushWait(data->queue, (void *)(data->firstItem + i));
+  }
+}
+
+static void _consumeMpmcItems(void *userData) {
+  _QueueTestThreadData *data = (_QueueTestThreadData *)userData;
+  size_t i;
+
+  for (i = 0; i < TEST_NUM_MPMC_ITEMS; i++) {
+    data->sum += (size_t)mpmcQueuePopWait(data->queue);
+  }
+}
+
+static int _testMpmcMultipleProducersAndConsumers(void) {
+  MpmcQueue q = newMpmcQueue(TEST_QUEUE_CAPACITY);
+  _QueueTestThreadData producers[TEST_NUM_THREADS];
+  _QueueTestThreadData consumers[TEST_NUM_THREADS];
+  Thread threads[TEST_NUM_THREADS * 2];
+  size_t numItems = TEST_NUM_MPMC_ITEMS * TEST_NUM_THREADS;
+  size_t sum = 0;
+  int i;
+
+  for (i = 0; i < TEST_NUM_THREADS; i++) {
+    // Items start at 1, since NULL can't be pushed
+    producers[i].queue = q;
+    producers[i].firstItem = 1 + (size_t)i * TEST_NUM_MPMC_ITEMS;
+    consumers[i].queue = q;
+    consumers[i].sum = 0;
+    threads[i * 2] = newThread(_produceMpmcItems, &producers[i]);
+    threads[i * 2 + 1] = newThread(_consumeMpmcItems, &consumers[i]);
+    assertNotNull(threads[i * 2]);
+    assertNotNull(threads[i * 2 + 1]);
+  }
+
+  for (i = 0; i < TEST_NUM_THREADS * 2; i++) {
+    freeThread(threads[i]);
+  }
+
+  // Each item was popped exactly once if the sums match
+  for (i = 0; i < TEST_NUM_THREADS; i++) {
+    sum += consumers[i].sum;
+  }
+
+  assertSizeEquals(numItems * (numItems + 1) / 2, sum);
+  assertUnsignedLongEquals(0ul, mpmcQueueGetSize(q));
+  freeMpmcQueue(q);
+  return 0;
+}
+
+TestSuite addQueueTests(void);
+TestSuite addQueueTests(void) {
+  TestSuite testSuite = newTestSuite("Queue", NULL, NULL);
+  addTest(testSuite, "NewSpscQueue", _testNewSpscQueue);
+  addTest(testSuite, "NewSpscQueueRoundsUpCapacity",
+          _testNewSpscQueueRoundsUpCapacity);
+  addTest(testSuite, "PushAndPopInOrder", _testPushAndPopInOrder);
+  addTest(testSuite, "PushToFullQueue", _testPushToFullQueue);
+  addTest(testSuite, "PopFromEmptyQueue", _testPopFromEmptyQueue);
+  addTest(testSuite, "PushAndPopWrapAround", _testPushAndPopWrapAround);
+  addTest(testSuite, "PushAndPopWaitFromOtherThread",
+          _testPushAndPopWaitFromOtherThread);
+  addTest(testSuite, "NewMpmcQueue", _testNewMpmcQueue);
+  addTest(testSuite, "MpmcPushAndPopInOrder", _testMpmcPushAndPopInOrder);
+  addTest(testSuite, "MpmcPushToFullQueue", _testMpmcPushToFullQueue);
+  addTest(testSuite, "MpmcPushAndPopWrapAround",
+          _testMpmcPushAndPopWrapAround);
+  addTest(testSuite, "MpmcMultipleProducersAndConsumers",
+          _testMpmcMultipleProducersAndConsumers);
+  return testSuite;
+}
@@ -0,0 +1,199 @@
+//
+// TaskSchedulerTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "base/TaskScheduler.h"
+
+#include "unit/TestRunner.h"
+
+#define TEST_NUM_WORKERS 4
+#define TEST_NUM_TASKS 1000
+#define TEST_NUM_SUBTASKS 10
+
+typedef struct {
+  TaskScheduler scheduler;
+  volatile unsigned long *total;
+  unsigned long amount;
+} _TaskSchedulerTestData;
+
+static void _addToTotal(void *userData) {
+  _TaskSchedulerTestData *data = (_TaskSchedulerTestData *)userData;
+  atomicAdd(data->total, data->amount);
+}
+
+// Only adds to the total when the task runs on a thread with a valid index
+static void _addToTotalOnValidThread(void *userData) {
+  _TaskSchedulerTestData *data = (_TaskSchedulerTestData *)userData;
+
+  if (taskSchedulerGetThreadIndex(data->scheduler) <= TEST_NUM_WORKERS) {
+    atomicAdd(data->total, data->amount);
+  }
+}
+
+static void _addToTotalInSubtasks(void *userData) {
+  _TaskSchedulerTestData *data = (_TaskSchedulerTestData *)userData;
+  _TaskSchedulerTestData subtasks[TEST_NUM_SUBTASKS];
+  TaskGroup group = newTaskGroup(data->scheduler);
+  int i;
+
+  for (i = 0; i < TEST_NUM_SUBTASKS; i++) {
+    subtasks[i].scheduler = data->scheduler;
+    subtasks[i].total = data->total;
+    subtasks[i].amount = data->amount;
+    taskGroupRun(group, _addToTotal, &subtasks[i]);
+  }
+
+  // The subtasks live on this stack, so they must be done before returning
+  freeTaskGroup(group);
+}
+
+// Runs TEST_NUM_TASKS tasks, where task i adds i + 1 to the total
+static unsigned long _runTestTasks(TaskScheduler scheduler, TaskFunc function) {
+  _TaskSchedulerTestData data[TEST_NUM_TASKS];
+  volatile unsigned long total = 0;
+  TaskGroup group = newTaskGroup(scheduler);
+  int i;
+
+  for (i = 0; i < TEST_NUM_TASKS; i++) {
+    data[i].scheduler = scheduler;
+    data[i].total = &total;
+    data[i].amount = (unsigned long)i + 1;
+    taskGroupRun(group, function, &data[i]);
+  }
+
+  taskGroupWait(group);
+  freeTaskGroup(group);
+  return total;
+}
+
+static int _testNewTaskScheduler(void) {
+  TaskScheduler s = newTaskScheduler(TEST_NUM_WORKERS, THREAD_PLACEMENT_NONE);
+  assertNotNull(s);
+  assertIntEquals(TEST_NUM_WORKERS, s->numWorkers);
+  assertNotNull(s->workers[0]->thread);
+  freeTaskScheduler(s);
+  return 0;
+}
+
+static int _testWaitForEmptyGroup(void) {
+  TaskScheduler s = newTaskScheduler(TEST_NUM_WORKERS, THREAD_PLACEMENT_NONE);
+  TaskGroup g = newTaskGroup(s);
+  taskGroupWait(g);
+  freeTaskGroup(g);
+  freeTaskScheduler(s);
+  return 0;
+}
+
+static int _testRunTasks(void) {
+  TaskScheduler s = newTaskScheduler(TEST_NUM_WORKERS, THREAD_PLACEMENT_NONE);
+  assertUnsignedLongEquals(TEST_NUM_TASKS * (TEST_NUM_TASKS + 1ul) / 2,
+                           _runTestTasks(s, _addToTotal));
+  freeTaskScheduler(s);
+  return 0;
+}
+
+static int _testRunTasksWithoutWorkers(void) {
+  // More tasks than fit in the queue, so some are run as they are started
+  TaskScheduler s = newTaskScheduler(0, THREAD_PLACEMENT_NONE);
+  assertIntEquals(0, s->numWorkers);
+  assertUnsignedLongEquals(TEST_NUM_TASKS * (TEST_NUM_TASKS + 1ul) / 2,
+                           _runTestTasks(s, _addToTotal));
+  freeTaskScheduler(s);
+  return 0;
+}
+
+static int _testRunNestedTasks(void) {
+  TaskScheduler s = newTaskScheduler(TEST_NUM_WORKERS, THREAD_PLACEMENT_NONE);
+  assertUnsignedLongEquals(TEST_NUM_SUBTASKS * TEST_NUM_TASKS *
+                               (TEST_NUM_TASKS + 1ul) / 2,
+                           _runTestTasks(s, _addToTotalInSubtasks));
+  freeTaskScheduler(s);
+  return 0;
+}
+
+static int _testRunNestedTasksWithoutWorkers(void) {
+  TaskScheduler s = newTaskScheduler(0, THREAD_PLACEMENT_NONE);
+  assertUnsignedLongEquals(TEST_NUM_SUBTASKS * TEST_NUM_TASKS *
+                               (TEST_NUM_TASKS + 1ul) / 2,
+                           _runTestTasks(s, _addToTotalInSubtasks));
+  freeTaskScheduler(s);
+  return 0;
+}
+
+static int _testReuseTaskGroup(void) {
+  TaskScheduler s = newTaskScheduler(TEST_NUM_WORKERS, THREAD_PLACEMENT_NONE);
+  TaskGroup g = newTaskGroup(s);
+  volatile unsigned long total = 0;
+  _TaskSchedulerTestData data = {s, &total, 1};
+  int i;
+
+  for (i = 0; i < 3; i++) {
+    taskGroupRun(g, _addToTotal, &data);
+    taskGroupWait(g);
+    assertUnsignedLongEquals((unsigned long)i + 1, total);
+  }
+
+  freeTaskGroup(g);
+  freeTaskScheduler(s);
+  return 0;
+}
+
+static int _testRunTasksOnPinnedWorkers(void) {
+  TaskScheduler s;
+
+  setThreadPinning(true);
+  s = newTaskScheduler(TEST_NUM_WORKERS, THREAD_PLACEMENT_COMPACT);
+  assertUnsignedLongEquals(TEST_NUM_TASKS * (TEST_NUM_TASKS + 1ul) / 2,
+                           _runTestTasks(s, _addToTotal));
+  freeTaskScheduler(s);
+  setThreadPinning(false);
+  return 0;
+}
+
+static int _testGetThreadIndex(void) {
+  TaskScheduler s = newTaskScheduler(TEST_NUM_WORKERS, THREAD_PLACEMENT_NONE);
+
+  assertIntEquals(0, taskSchedulerGetThreadIndex(s));
+  assertUnsignedLongEquals(TEST_NUM_TASKS * (TEST_NUM_TASKS + 1ul) / 2,
+                           _runTestTasks(s, _addToTotalOnValidThread));
+  freeTaskScheduler(s);
+  return 0;
+}
+
+TestSuite addTaskSchedulerTests(void);
+TestSuite addTaskSchedulerTests(void) {
+  TestSuite testSuite = newTestSuite("TaskScheduler", NULL, NULL);
+  addTest(testSuite, "NewTaskScheduler", _testNewTaskScheduler);
+  addTest(testSuite, "WaitForEmptyGroup", _testWaitForEmptyGroup);
+  addTest(testSuite, "RunTasks", _testRunTasks);
+  addTest(testSuite, "RunTasksWithoutWorkers", _testRunTasksWithoutWorkers);
+  addTest(testSuite, "RunNestedTasks", _testRunNestedTasks);
+  addTest(testSuite, "RunNestedTasksWithoutWorkers",
+          _testRunNestedTasksWithoutWorkers);
+  addTest(testSuite, "ReuseTaskGroup", _testReuseTaskGroup);
+  addTest(testSuite, "RunTasksOnPinnedWorkers", _testRunTasksOnPinnedWorkers);
+  addTest(testSuite, "GetThreadIndex", _testGetThreadIndex);
+  return testSuite;
+}
@@ -0,0 +1,116 @@
+//
+// ThreadTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "base/Thread.h"
+
+#include "unit/TestRunner.h"
+
+#define TEST_NUM_THREADS 4
+#define TEST_NUM_INCREMENTS 10000
+
+typedef struct {
+  Mutex mutex;
+  int counter;
+} _ThreadTestCounter;
+
+static void _setFlag(void *userData) {
+  boolByte *flag = (boolByte *)userData;
+  *flag = true;
+}
+
+static void _incrementCounter(void *userData) {
+  _ThreadTestCounter *counter = (_ThreadTestCounter *)userData;
+  int i;
+
+  for (i = 0; i < TEST_NUM_INCREMENTS; i++) {
+    mutexLock(counter->mutex);
+    counter->counter++;
+    mutexUnlock(counter->mutex);
+  }
+}
+
+static int _testNewThread(void) {
+  boolByte flag = false;
+  Thread t = newThread(_setFlag, &flag);
+  assertNotNull(t);
+  threadJoin(t);
+  assert(flag);
+  freeThread(t);
+  return 0;
+}
+
+static int _testJoinThreadTwice(void) {
+  boolByte flag = false;
+  Thread t = newThread(_setFlag, &flag);
+  assertNotNull(t);
+  threadJoin(t);
+  threadJoin(t);
+  assert(flag);
+  freeThread(t);
+  return 0;
+}
+
+static int _testFreeThreadWithoutJoin(void) {
+  boolByte flag = false;
+  Thread t = newThread(_setFlag, &flag);
+  assertNotNull(t);
+  freeThread(t);
+  assert(flag);
+  return 0;
+}
+
+static int _testMutexFromMultipleThreads(void) {
+  Thread threads[TEST_NUM_THREADS];
+  _ThreadTestCounter counter;
+  int i;
+
+  counter.mutex = newMutex();
+  counter.counter = 0;
+
+  for (i = 0; i < TEST_NUM_THREADS; i++) {
+    threads[i] = newThread(_incrementCounter, &counter);
+    assertNotNull(threads[i]);
+  }
+
+  for (i = 0; i < TEST_NUM_THREADS; i++) {
+    freeThread(threads[i]);
+  }
+
+  assertIntEquals(TEST_NUM_THREADS * TEST_NUM_INCREMENTS, counter.counter);
+  freeMutex(counter.mutex);
+  return 0;
+}
+
+TestSuite addThreadTests(void);
+TestSuite addThreadTests(void) {
+  TestSuite testSuite = newTestSuite("Thread", NULL, NULL);
+  addTest(testSuite, "NewThread", _testNewThread);
+  addTest(testSuite, "JoinThreadTwice", _testJoinThreadTwice);
+  addTest(testSuite, "FreeThreadWithoutJoin", _testFreeThreadWithoutJoin);
+  addTest(testSuite, "MutexFromMultipleThreads",
+          _testMutexFromMultipleThreads);
+  return testSuite;
+}
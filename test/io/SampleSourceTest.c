@@ -27,13 +27,37 @@
 #include "io/SampleSource.h"
 
 #include "audio/AudioSettings.h"
+#include "base/File.h"
+#include "io/SampleSourceSegmented.h"
+#include "unit/TestFiles.h"
 #include "unit/TestRunner.h"
 
+#include <stdio.h>
+
 const char *TEST_SAMPLESOURCE_FILENAME = "test.pcm";
+#define TEST_AIFF_FILENAME "mrswatsontest-samplesource.aiff"
+#define TEST_WAVE_FILENAME "mrswatsontest-samplesource.wav"
+#define TEST_SEGMENT_PATTERN "mrswatsontest-segment-%d.pcm"
+#define TEST_SEGMENT_DEFAULT_NAME "mrswatsontest-segment_00000.pcm"
+#define TEST_NUM_SEGMENTS 3
 
 static void _sampleSourceSetup(void) { initAudioSettings(); }
 
-static void _sampleSourceTeardown(void) { freeAudioSettings(); }
+static void _sampleSourceTeardown(void) {
+  char segmentName[64];
+  int i;
+
+  removeTestFile(TEST_AIFF_FILENAME);
+  removeTestFile(TEST_WAVE_FILENAME);
+  removeTestFile(TEST_SEGMENT_DEFAULT_NAME);
+
+  for (i = 0; i < TEST_NUM_SEGMENTS + 1; i++) {
+    snprintf(segmentName, 64, TEST_SEGMENT_PATTERN, i);
+    removeTestFile(segmentName);
+  }
+
+  freeAudioSettings();
+}
 
 static int _testGuessSampleSourceTypePcm(void) {
   CharString c = newCharStringWithCString(TEST_SAMPLESOURCE_FILENAME);
@@ -62,6 +86,241 @@ static int _testGuessSampleSourceTypeWrongCase(void) {
   return 0;
 }
 
+static int _testGuessSampleSourceTypeAiff(void) {
+  CharString c = newCharStringWithCString("test.aif");
+  SampleSource s = sampleSourceFactory(c);
+  assertIntEquals(SAMPLE_SOURCE_TYPE_AIFF, s->sampleSourceType);
+  freeSampleSource(s);
+  freeCharString(c);
+
+  c = newCharStringWithCString("test.AIFC");
+  s = sampleSourceFactory(c);
+  assertIntEquals(SAMPLE_SOURCE_TYPE_AIFF, s->sampleSourceType);
+  freeSampleSource(s);
+  freeCharString(c);
+  return 0;
+}
+
+static int _testAiffRoundTrip(BitDepth bitDepth, double tolerance) {
+  CharString c = newCharStringWithCString(TEST_AIFF_FILENAME);
+  SampleBuffer b = newSampleBuffer(2, 64);
+  SampleSource s;
+  SampleCount i;
+
+  assert(setBitDepth(bitDepth));
+  assert(setSampleRate(48000.0));
+
+  for (i = 0; i < b->blocksize; i++) {
+    b->samples[0][i] = (Sample)i / (Sample)b->blocksize;
+    b->samples[1][i] = -(Sample)i / (Sample)b->blocksize;
+  }
+
+  s = sampleSourceFactory(c);
+  assert(s->openSampleSource(s, SAMPLE_SOURCE_OPEN_WRITE));
+  assert(s->writeSampleBlock(s, b));
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+
+  // Reset the settings to make sure that the file header is actually parsed
+  assert(setSampleRate(44100.0));
+  sampleBufferClear(b);
+  s = sampleSourceFactory(c);
+  assert(s->openSampleSource(s, SAMPLE_SOURCE_OPEN_READ));
+  assertDoubleEquals(48000.0, getSampleRate(), TEST_EXACT_TOLERANCE);
+  assertIntEquals(2, getNumChannels());
+  assert(s->readSampleBlock(s, b));
+
+  for (i = 0; i < b->blocksize; i++) {
+    // assertDoubleEquals rounds to two decimal places, which is too coarse
+    // to catch conversion errors here.
+    assert(fabs((Sample)i / (Sample)b->blocksize - b->samples[0][i]) <=
+           tolerance);
+    assert(fabs(-(Sample)i / (Sample)b->blocksize - b->samples[1][i]) <=
+           tolerance);
+  }
+
+  // The file should contain exactly one block, so the next read is short
+  assertFalse(s->readSampleBlock(s, b));
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, b->blocksize);
+
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+  freeSampleBuffer(b);
+  freeCharString(c);
+  return 0;
+}
+
+static int _testAiffRoundTrip16Bit(void) {
+  return _testAiffRoundTrip(kBitDepth16Bit, 1.0 / 16384.0);
+}
+
+static int _testAiffRoundTrip24Bit(void) {
+  return _testAiffRoundTrip(kBitDepth24Bit, 1.0 / 4194304.0);
+}
+
+static int _testAiffRoundTrip32Bit(void) {
+  return _testAiffRoundTrip(kBitDepth32Bit, TEST_EXACT_TOLERANCE);
+}
+
+static int _testWaveSyncWritesHeader(void) {
+  CharString c = newCharStringWithCString(TEST_WAVE_FILENAME);
+  SampleBuffer b = newSampleBuffer(2, 64);
+  SampleSource s = sampleSourceFactory(c);
+  FILE *fp;
+  unsigned int dataSize = 0;
+
+  assert(setBitDepth(kBitDepth16Bit));
+  assert(s->openSampleSource(s, SAMPLE_SOURCE_OPEN_WRITE));
+  s->writeSampleBlock(s, b);
+  assert(sampleSourceSync(s));
+
+  // Header is checked while the source is still open for writing
+  fp = fopen(TEST_WAVE_FILENAME, "rb");
+  assertNotNull(fp);
+  assertIntEquals(0, fseek(fp, 44, SEEK_SET));
+  assertIntEquals(1, (int)fread(&dataSize, sizeof(unsigned int), 1, fp));
+  assertIntEquals(64 * 2 * 2, (int)dataSize);
+  fclose(fp);
+
+  // Writing after a sync must append to the data, not overwrite the header
+  s->writeSampleBlock(s, b);
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+
+  fp = fopen(TEST_WAVE_FILENAME, "rb");
+  assertNotNull(fp);
+  assertIntEquals(0, fseek(fp, 44, SEEK_SET));
+  assertIntEquals(1, (int)fread(&dataSize, sizeof(unsigned int), 1, fp));
+  assertIntEquals(64 * 2 * 2 * 2, (int)dataSize);
+  fclose(fp);
+
+  freeSampleBuffer(b);
+  freeCharString(c);
+  return 0;
+}
+
+static int _testSyncSilenceSource(void) {
+  SampleSource s = sampleSourceFactory(NULL);
+  assert(s->openSampleSource(s, SAMPLE_SOURCE_OPEN_WRITE));
+  assertFalse(sampleSourceSync(s));
+  freeSampleSource(s);
+  return 0;
+}
+
+static int _testSeek(const char *filename) {
+  CharString c = newCharStringWithCString(filename);
+  SampleBuffer b = newSampleBuffer(2, 64);
+  SampleSource s = sampleSourceFactory(c);
+  SampleCount i;
+
+  for (i = 0; i < b->blocksize; i++) {
+    b->samples[0][i] = (Sample)i / 128.0f;
+    b->samples[1][i] = -b->samples[0][i];
+  }
+
+  assert(s->openSampleSource(s, SAMPLE_SOURCE_OPEN_WRITE));
+  s->writeSampleBlock(s, b);
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+
+  s = sampleSourceFactory(c);
+  assert(s->openSampleSource(s, SAMPLE_SOURCE_OPEN_READ));
+  assert(sampleSourceSeek(s, 40));
+  assertUnsignedLongEquals(80ul, s->numSamplesProcessed);
+  b->blocksize = 4;
+  assert(s->readSampleBlock(s, b));
+  assertDoubleEquals(40.0 / 128.0, b->samples[0][0], 0.0001);
+  assertDoubleEquals(-43.0 / 128.0, b->samples[1][3], 0.0001);
+  // Reading forward can't go back, so this needs the source to seek itself
+  assert(sampleSourceSeek(s, 8));
+  assertUnsignedLongEquals(16ul, s->numSamplesProcessed);
+  assert(s->readSampleBlock(s, b));
+  assertDoubleEquals(8.0 / 128.0, b->samples[0][0], 0.0001);
+  assertDoubleEquals(-11.0 / 128.0, b->samples[1][3], 0.0001);
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+
+  freeSampleBuffer(b);
+  freeCharString(c);
+  return 0;
+}
+
+static int _testSeekWave(void) { return _testSeek(TEST_WAVE_FILENAME); }
+
+static int _testSeekAiff(void) { return _testSeek(TEST_AIFF_FILENAME); }
+
+static int _testSegmentedOutputSplitsBlocks(void) {
+  CharString c = newCharStringWithCString(TEST_SEGMENT_PATTERN);
+  SampleBuffer b = newSampleBuffer(2, 25);
+  SampleSource s;
+  char segmentName[64];
+  // 10ms segments at 1kHz are 10 frames long, so 25 frames is 2.5 segments
+  const size_t expectedSizes[TEST_NUM_SEGMENTS] = {40, 40, 20};
+  int i;
+
+  assert(setSampleRate(1000.0));
+  s = newSampleSourceSegmented(c, 10);
+  assertNotNull(s);
+  assertIntEquals(SAMPLE_SOURCE_TYPE_PCM, s->sampleSourceType);
+  assert(s->openSampleSource(s, SAMPLE_SOURCE_OPEN_WRITE));
+  s->writeSampleBlock(s, b);
+  assertUnsignedLongEquals(50ul, s->numSamplesProcessed);
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+
+  for (i = 0; i < TEST_NUM_SEGMENTS; i++) {
+    File f;
+    snprintf(segmentName, 64, TEST_SEGMENT_PATTERN, i);
+    f = newFileWithPathCString(segmentName);
+    assert(fileExists(f));
+    assertUnsignedLongEquals((unsigned long)expectedSizes[i],
+                             (unsigned long)fileGetSize(f));
+    freeFile(f);
+  }
+
+  // No empty trailing segment should be created
+  snprintf(segmentName, 64, TEST_SEGMENT_PATTERN, TEST_NUM_SEGMENTS);
+  File f = newFileWithPathCString(segmentName);
+  assertFalse(fileExists(f));
+  freeFile(f);
+
+  freeSampleBuffer(b);
+  freeCharString(c);
+  return 0;
+}
+
+static int _testSegmentedOutputDefaultPattern(void) {
+  CharString c = newCharStringWithCString("mrswatsontest-segment.pcm");
+  SampleSource s = newSampleSourceSegmented(c, 1000);
+  File f;
+
+  assertNotNull(s);
+  assert(s->openSampleSource(s, SAMPLE_SOURCE_OPEN_WRITE));
+  s->closeSampleSource(s);
+  freeSampleSource(s);
+
+  f = newFileWithPathCString(TEST_SEGMENT_DEFAULT_NAME);
+  assert(fileExists(f));
+  freeFile(f);
+  freeCharString(c);
+  return 0;
+}
+
+static int _testSegmentedOutputInvalidPattern(void) {
+  CharString c = newCharStringWithCString("mrswatsontest-%s.pcm");
+  assertIsNull(newSampleSourceSegmented(c, 1000));
+  freeCharString(c);
+
+  c = newCharStringWithCString("mrswatsontest-%d-%d.pcm");
+  assertIsNull(newSampleSourceSegmented(c, 1000));
+  freeCharString(c);
+
+  c = newCharStringWithCString("-");
+  assertIsNull(newSampleSourceSegmented(c, 1000));
+  freeCharString(c);
+  return 0;
+}
+
 TestSuite addSampleSourceTests(void);
 TestSuite addSampleSourceTests(void) {
   TestSuite testSuite =
@@ -71,5 +330,20 @@ TestSuite addSampleSourceTests(void) {
           _testGuessSampleSourceTypeEmpty);
   addTest(testSuite, "GuessSampleSourceTypeWrongCase",
           _testGuessSampleSourceTypeWrongCase);
+  addTest(testSuite, "GuessSampleSourceTypeAiff",
+          _testGuessSampleSourceTypeAiff);
+  addTest(testSuite, "AiffRoundTrip16Bit", _testAiffRoundTrip16Bit);
+  addTest(testSuite, "AiffRoundTrip24Bit", _testAiffRoundTrip24Bit);
+  addTest(testSuite, "AiffRoundTrip32Bit", _testAiffRoundTrip32Bit);
+  addTest(testSuite, "WaveSyncWritesHeader", _testWaveSyncWritesHeader);
+  addTest(testSuite, "SyncSilenceSource", _testSyncSilenceSource);
+  addTest(testSuite, "SeekWave", _testSeekWave);
+  addTest(testSuite, "SeekAiff", _testSeekAiff);
+  addTest(testSuite, "SegmentedOutputSplitsBlocks",
+          _testSegmentedOutputSplitsBlocks);
+  addTest(testSuite, "SegmentedOutputDefaultPattern",
+          _testSegmentedOutputDefaultPattern);
+  addTest(testSuite, "SegmentedOutputInvalidPattern",
+          _testSegmentedOutputInvalidPattern);
   return testSuite;
 }
@@ -28,10 +28,12 @@
 
 #include "unit/TestRunner.h"
 
+#include <string.h>
+
 static int _testNewMidiSequence(void) {
   MidiSequence m = newMidiSequence();
   assertNotNull(m);
-  assertIntEquals(0, linkedListLength(m->midiEvents));
+  assertUnsignedLongEquals(0ul, m->numMidiEvents);
   freeMidiSequence(m);
   return 0;
 }
@@ -39,16 +41,17 @@ static int _testNewMidiSequence(void) {
 static int _testAppendMidiEventToSequence(void) {
   MidiSequence m = newMidiSequence();
   MidiEvent e = newMidiEvent();
-  appendMidiEventToSequence(m, e);
-  assertIntEquals(1, linkedListLength(m->midiEvents));
+  appendMidiEventToSequence(m, e, 0);
+  assertUnsignedLongEquals(1ul, m->numMidiEvents);
   freeMidiSequence(m);
+  freeMidiEvent(e);
   return 0;
 }
 
 static int _testAppendNullMidiEventToSequence(void) {
   MidiSequence m = newMidiSequence();
-  appendMidiEventToSequence(m, NULL);
-  assertIntEquals(0, linkedListLength(m->midiEvents));
+  appendMidiEventToSequence(m, NULL, 0);
+  assertUnsignedLongEquals(0ul, m->numMidiEvents);
   freeMidiSequence(m);
   return 0;
 }
@@ -56,7 +59,7 @@ static int _testAppendNullMidiEventToSequence(void) {
 static int _testAppendEventToNullSequence(void) {
   // Test is not crashing
   MidiEvent e = newMidiEvent();
-  appendMidiEventToSequence(NULL, e);
+  appendMidiEventToSequence(NULL, e, 0);
   freeMidiEvent(e);
   return 0;
 }
@@ -64,33 +67,35 @@ static int _testAppendEventToNullSequence(void) {
 static int _testFillMidiEventsFromRangeStart(void) {
   MidiSequence m = newMidiSequence();
   MidiEvent e = newMidiEvent();
-  LinkedList l = newLinkedList();
+  LinkedListBuffer b = newLinkedListBuffer(1);
 
   e->status = 0xf7;
   e->timestamp = 100;
-  appendMidiEventToSequence(m, e);
-  assertFalse(fillMidiEventsFromRange(m, 0, 256, l));
-  assertIntEquals(1, linkedListLength(l));
-  assertIntEquals(0xf7, ((MidiEvent)l->item)->status);
+  appendMidiEventToSequence(m, e, 0);
+  assertFalse(fillMidiEventsFromRange(m, 0, 256, b));
+  assertIntEquals(1, linkedListLength(linkedListBufferGetList(b)));
+  assertIntEquals(0xf7, ((MidiEvent)linkedListBufferGetList(b)->item)->status);
 
   freeMidiSequence(m);
-  freeLinkedList(l);
+  freeMidiEvent(e);
+  freeLinkedListBuffer(b);
   return 0;
 }
 
 static int _testFillEventsFromEmptyRange(void) {
   MidiSequence m = newMidiSequence();
   MidiEvent e = newMidiEvent();
-  LinkedList l = newLinkedList();
+  LinkedListBuffer b = newLinkedListBuffer(1);
 
   e->status = 0xf7;
   e->timestamp = 100;
-  appendMidiEventToSequence(m, e);
-  assert(fillMidiEventsFromRange(m, 0, 0, l));
-  assertIntEquals(0, linkedListLength(l));
+  appendMidiEventToSequence(m, e, 0);
+  assert(fillMidiEventsFromRange(m, 0, 0, b));
+  assertIntEquals(0, linkedListLength(linkedListBufferGetList(b)));
 
   freeMidiSequence(m);
-  freeLinkedList(l);
+  freeMidiEvent(e);
+  freeLinkedListBuffer(b);
   return 0;
 }
 
@@ -98,44 +103,181 @@ static int _testFillEventsSequentially(void) {
   MidiSequence m = newMidiSequence();
   MidiEvent e = newMidiEvent();
   MidiEvent e2 = newMidiEvent();
-  LinkedList l = newLinkedList();
+  LinkedListBuffer b = newLinkedListBuffer(1);
 
   e->status = 0xf7;
   e->timestamp = 100;
   e2->status = 0xf7;
   e2->timestamp = 300;
-  appendMidiEventToSequence(m, e);
-  appendMidiEventToSequence(m, e2);
-  assert(fillMidiEventsFromRange(m, 0, 256, l));
-  assertIntEquals(1, linkedListLength(l));
-  freeLinkedList(l);
-  l = newLinkedList();
-  assertFalse(fillMidiEventsFromRange(m, 256, 256, l));
-  assertIntEquals(1, linkedListLength(l));
+  appendMidiEventToSequence(m, e, 0);
+  appendMidiEventToSequence(m, e2, 0);
+  assert(fillMidiEventsFromRange(m, 0, 256, b));
+  assertIntEquals(1, linkedListLength(linkedListBufferGetList(b)));
+  assertFalse(fillMidiEventsFromRange(m, 256, 256, b));
+  assertIntEquals(1, linkedListLength(linkedListBufferGetList(b)));
 
   freeMidiSequence(m);
-  freeLinkedList(l);
+  freeMidiEvent(e);
+  freeMidiEvent(e2);
+  freeLinkedListBuffer(b);
   return 0;
 }
 
 static int _testFillEventsFromRangePastSequence(void) {
   MidiSequence m = newMidiSequence();
   MidiEvent e = newMidiEvent();
-  LinkedList l = newLinkedList();
+  LinkedListBuffer b = newLinkedListBuffer(1);
 
   e->status = 0xf7;
   e->timestamp = 100;
-  appendMidiEventToSequence(m, e);
+  appendMidiEventToSequence(m, e, 0);
   // Should return false since this is the last event in the sequence
-  assertFalse(fillMidiEventsFromRange(m, 0, 200, l));
-  assertIntEquals(1, linkedListLength(l));
-  freeLinkedList(l);
-  l = newLinkedList();
-  assertFalse(fillMidiEventsFromRange(m, 200, 256, l));
-  assertIntEquals(0, linkedListLength(l));
+  assertFalse(fillMidiEventsFromRange(m, 0, 200, b));
+  assertIntEquals(1, linkedListLength(linkedListBufferGetList(b)));
+  assertFalse(fillMidiEventsFromRange(m, 200, 256, b));
+  assertIntEquals(0, linkedListLength(linkedListBufferGetList(b)));
+
+  freeMidiSequence(m);
+  freeMidiEvent(e);
+  freeLinkedListBuffer(b);
+  return 0;
+}
+
+static MidiSequence _newTestMidiSequence(const unsigned long *timestamps,
+                                         const int numEvents) {
+  MidiSequence m = newMidiSequence();
+  MidiEvent e;
+  int i;
+
+  for (i = 0; i < numEvents; i++) {
+    e = newMidiEvent();
+    e->eventType = MIDI_TYPE_REGULAR;
+    e->status = 0x90;
+    e->data1 = (byte)i;
+    e->timestamp = timestamps[i];
+    appendMidiEventToSequence(m, e, 0);
+    freeMidiEvent(e);
+  }
+
+  return m;
+}
+
+static int _testAppendEventsOutOfOrder(void) {
+  const unsigned long timestamps[] = {300, 100, 200, 100, 0};
+  MidiSequence m = _newTestMidiSequence(timestamps, 5);
+  MidiSequenceRange r;
+
+  assertFalse(midiSequenceGetRange(m, 0, 400, &r));
+  assertUnsignedLongEquals(5ul, r.numMidiEvents);
+  assertUnsignedLongEquals(0ul, r.midiEvents[0].timestamp);
+  assertIntEquals(4, r.midiEvents[0].data1);
+  // Events with the same timestamp keep the order they were appended in
+  assertIntEquals(1, r.midiEvents[1].data1);
+  assertIntEquals(3, r.midiEvents[2].data1);
+  assertUnsignedLongEquals(200ul, r.midiEvents[3].timestamp);
+  assertUnsignedLongEquals(300ul, r.midiEvents[4].timestamp);
+
+  freeMidiSequence(m);
+  return 0;
+}
+
+static int _testAppendManyEvents(void) {
+  MidiSequence m = newMidiSequence();
+  MidiEvent e;
+  MidiSequenceRange r;
+  unsigned long i;
+
+  for (i = 0; i < 1000; i++) {
+    e = newMidiEvent();
+    e->timestamp = 1000 - i;
+    appendMidiEventToSequence(m, e, 0);
+    freeMidiEvent(e);
+  }
+
+  assertUnsignedLongEquals(1000ul, m->numMidiEvents);
+  assert(midiSequenceGetRange(m, 500, 10, &r));
+  assertUnsignedLongEquals(10ul, r.numMidiEvents);
+  assertUnsignedLongEquals(500ul, r.midiEvents[0].timestamp);
+  assertUnsignedLongEquals(0ul, r.midiEvents[0].deltaFrames);
+  assertUnsignedLongEquals(509ul, r.midiEvents[9].timestamp);
+  assertUnsignedLongEquals(9ul, r.midiEvents[9].deltaFrames);
 
   freeMidiSequence(m);
-  freeLinkedList(l);
+  return 0;
+}
+
+static int _testSeek(void) {
+  const unsigned long timestamps[] = {0, 100, 200, 200, 300};
+  MidiSequence m = _newTestMidiSequence(timestamps, 5);
+
+  assertUnsignedLongEquals(0ul, midiSequenceGetPosition(m));
+  midiSequenceSeek(m, 200);
+  assertUnsignedLongEquals(2ul, midiSequenceGetPosition(m));
+  midiSequenceSeek(m, 101);
+  assertUnsignedLongEquals(2ul, midiSequenceGetPosition(m));
+  midiSequenceSeek(m, 0);
+  assertUnsignedLongEquals(0ul, midiSequenceGetPosition(m));
+  midiSequenceSeek(m, 301);
+  assertUnsignedLongEquals(5ul, midiSequenceGetPosition(m));
+
+  freeMidiSequence(m);
+  return 0;
+}
+
+static int _testGetRangeAfterJump(void) {
+  const unsigned long timestamps[] = {0, 100, 200, 300};
+  MidiSequence m = _newTestMidiSequence(timestamps, 4);
+  MidiSequenceRange r;
+
+  assert(midiSequenceGetRange(m, 0, 150, &r));
+  assertUnsignedLongEquals(2ul, r.numMidiEvents);
+  assertUnsignedLongEquals(2ul, midiSequenceGetPosition(m));
+
+  // Forwards, skipping the event at 200
+  assertFalse(midiSequenceGetRange(m, 250, 100, &r));
+  assertUnsignedLongEquals(1ul, r.numMidiEvents);
+  assertUnsignedLongEquals(300ul, r.midiEvents[0].timestamp);
+  assertUnsignedLongEquals(50ul, r.midiEvents[0].deltaFrames);
+
+  // And backwards again
+  assert(midiSequenceGetRange(m, 100, 100, &r));
+  assertUnsignedLongEquals(1ul, r.numMidiEvents);
+  assertUnsignedLongEquals(100ul, r.midiEvents[0].timestamp);
+  assertUnsignedLongEquals(2ul, midiSequenceGetPosition(m));
+
+  freeMidiSequence(m);
+  return 0;
+}
+
+static int _testAppendMetaEvents(void) {
+  MidiSequence m = newMidiSequence();
+  MidiEvent e = newMidiEvent();
+  byte tempo[3] = {0x07, 0xa1, 0x20};
+  byte text[10] = {'m', 'r', 's', 'w', 'a', 't', 's', 'o', 'n', 0};
+  MidiSequenceRange r;
+
+  e->eventType = MIDI_TYPE_META;
+  e->status = MIDI_META_TYPE_TEMPO;
+  e->extraData = tempo;
+  appendMidiEventToSequence(m, e, sizeof(tempo));
+  e->status = MIDI_META_TYPE_TEXT;
+  e->extraData = text;
+  appendMidiEventToSequence(m, e, sizeof(text));
+  // The sequence keeps its own copy of the data
+  memset(tempo, 0, sizeof(tempo));
+  memset(text, 0, sizeof(text));
+
+  assertFalse(midiSequenceGetRange(m, 0, 1, &r));
+  assertUnsignedLongEquals(2ul, r.numMidiEvents);
+  assertIntEquals(MIDI_TYPE_META, r.midiEvents[0].eventType);
+  assertIntEquals(MIDI_META_TYPE_TEMPO, r.midiEvents[0].status);
+  assertIntEquals(0xa1, r.midiEvents[0].extraData[1]);
+  assertIntEquals(MIDI_META_TYPE_TEXT, r.midiEvents[1].status);
+  assertIntEquals(0, strcmp("mrswatson", (char *)r.midiEvents[1].extraData));
+
+  e->extraData = NULL;
+  freeMidiEvent(e);
+  freeMidiSequence(m);
   return 0;
 }
 
@@ -154,6 +296,11 @@ TestSuite addMidiSequenceTests(void) {
   addTest(testSuite, "FillEventsSequentially", _testFillEventsSequentially);
   addTest(testSuite, "FillEventsFromRangePastSequenceEnd",
           _testFillEventsFromRangePastSequence);
+  addTest(testSuite, "AppendEventsOutOfOrder", _testAppendEventsOutOfOrder);
+  addTest(testSuite, "AppendManyEvents", _testAppendManyEvents);
+  addTest(testSuite, "AppendMetaEvents", _testAppendMetaEvents);
+  addTest(testSuite, "Seek", _testSeek);
+  addTest(testSuite, "GetRangeAfterJump", _testGetRangeAfterJump);
 
   return testSuite;
 }
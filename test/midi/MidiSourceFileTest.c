@@ -0,0 +1,295 @@
+//
+// MidiSourceFileTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "midi/MidiSourceFile.h"
+
+#include "audio/AudioSettings.h"
+#include "base/File.h"
+#include "unit/TestRunner.h"
+
+#include <stdio.h>
+
+#define TEST_MIDI_FILENAME "mrswatsontest-stream.mid"
+// With the default tempo and sample rate, a beat is 22050 frames
+#define TEST_TICKS_PER_BEAT 96
+#define TEST_FRAMES_PER_BEAT 22050
+
+// Track with a tempo event, followed by notes on each beat which use running
+// status, and which ends after the fourth beat
+static const byte kTestTrackNotes[] = {
+    0x00, 0xff, 0x51, 0x03, 0x07, 0xa1, 0x20, // Tempo, 120 BPM
+    0x00, 0x90, 0x3c, 0x64,                   // Note on at 0
+    0x60, 0x3c, 0x00,                         // Note off at beat 1
+    0x00, 0x3e, 0x64,                         // Note on at beat 1
+    0x60, 0x3e, 0x00,                         // Note off at beat 2
+    0x81, 0x40, 0xff, 0x2f, 0x00,             // Track end at beat 4
+};
+
+// Track with a program change and a marker, which ends on the second beat
+static const byte kTestTrackProgram[] = {
+    0x30, 0xc0, 0x05,                         // Program change at beat 0.5
+    0x00, 0xff, 0x06, 0x06, 'm', 'a', 'r', 'k', 'e', 'r', // Marker
+    0x30, 0xff, 0x2f, 0x00,                   // Track end at beat 1
+};
+
+// Track which slows down to 60 BPM after the first beat
+static const byte kTestTrackTempoChange[] = {
+    0x00, 0xff, 0x51, 0x03, 0x07, 0xa1, 0x20, // Tempo, 120 BPM
+    0x60, 0xff, 0x51, 0x03, 0x0f, 0x42, 0x40, // Tempo at beat 1, 60 BPM
+    0x60, 0xff, 0x2f, 0x00,                   // Track end at beat 2
+};
+
+// Track with a note from beat 0.5 to beat 2, which depends on the tempo
+// changes in another track
+static const byte kTestTrackLongNote[] = {
+    0x30, 0x90, 0x3c, 0x64,                   // Note on at beat 0.5
+    0x81, 0x10, 0x3c, 0x00,                   // Note off at beat 2
+    0x00, 0xff, 0x2f, 0x00,                   // Track end at beat 2
+};
+
+static void _midiSourceFileTestSetup(void) { initAudioSettings(); }
+
+static void _midiSourceFileTestTeardown(void) {
+  File file = newFileWithPathCString(TEST_MIDI_FILENAME);
+
+  if (fileExists(file)) {
+    fileRemove(file);
+  }
+
+  freeFile(file);
+  freeAudioSettings();
+}
+
+static void _writeBigEndian(FILE *file, unsigned int value, int numBytes) {
+  int i;
+
+  for (i = numBytes - 1; i >= 0; i--) {
+    fputc((int)((value >> (i * 8)) & 0xff), file);
+  }
+}
+
+static FILE *_newTestMidiFile(unsigned short formatType,
+                              unsigned short numTracks) {
+  FILE *file = fopen(TEST_MIDI_FILENAME, "wb");
+
+  fwrite("MThd", 1, 4, file);
+  _writeBigEndian(file, 6, 4);
+  _writeBigEndian(file, formatType, 2);
+  _writeBigEndian(file, numTracks, 2);
+  _writeBigEndian(file, TEST_TICKS_PER_BEAT, 2);
+  return file;
+}
+
+static void _writeTestMidiTrack(FILE *file, const byte *track,
+                                unsigned int trackSize) {
+  fwrite("MTrk", 1, 4, file);
+  _writeBigEndian(file, trackSize, 4);
+  fwrite(track, 1, trackSize, file);
+}
+
+static void _writeTestMidiFile(unsigned short formatType,
+                               unsigned short numTracks) {
+  FILE *file = _newTestMidiFile(formatType, numTracks);
+
+  _writeTestMidiTrack(file, kTestTrackNotes, sizeof(kTestTrackNotes));
+
+  if (numTracks > 1) {
+    // Unknown chunks are skipped
+    fwrite("XFIH", 1, 4, file);
+    _writeBigEndian(file, 2, 4);
+    fwrite("xx", 1, 2, file);
+
+    _writeTestMidiTrack(file, kTestTrackProgram, sizeof(kTestTrackProgram));
+  }
+
+  fclose(file);
+}
+
+static MidiSource _openTestMidiSource(void) {
+  CharString filename = newCharStringWithCString(TEST_MIDI_FILENAME);
+  MidiSource m = newMidiSourceFile(filename);
+  freeCharString(filename);
+
+  if (!m->openMidiSource(m)) {
+    freeMidiSource(m);
+    return NULL;
+  }
+
+  return m;
+}
+
+static int _testReadAllEvents(void) {
+  MidiSource m;
+  MidiSequence s = newMidiSequence();
+  MidiSequenceRange r;
+
+  _writeTestMidiFile(0, 1);
+  m = _openTestMidiSource();
+  assertNotNull(m);
+  assert(m->readMidiEvents(m, s));
+  assertUnsignedLongEquals(6ul, s->numMidiEvents);
+
+  assertFalse(midiSequenceGetRange(s, 0, 4 * TEST_FRAMES_PER_BEAT + 1, &r));
+  assertIntEquals(MIDI_TYPE_META, r.midiEvents[0].eventType);
+  assertIntEquals(MIDI_META_TYPE_TEMPO, r.midiEvents[0].status);
+  assertIntEquals(0xa1, r.midiEvents[0].extraData[1]);
+  assertIntEquals(0x90, r.midiEvents[1].status);
+  assertIntEquals(0x3c, r.midiEvents[1].data1);
+  assertIntEquals(0x64, r.midiEvents[1].data2);
+  // Running status
+  assertIntEquals(0x90, r.midiEvents[3].status);
+  assertIntEquals(0x3e, r.midiEvents[3].data1);
+  assertUnsignedLongEquals((unsigned long)TEST_FRAMES_PER_BEAT,
+                           r.midiEvents[3].timestamp);
+  assertIntEquals(MIDI_META_TYPE_TRACK_END, r.midiEvents[5].status);
+  assertUnsignedLongEquals((unsigned long)(4 * TEST_FRAMES_PER_BEAT),
+                           r.midiEvents[5].timestamp);
+
+  freeMidiSequence(s);
+  freeMidiSource(m);
+  return 0;
+}
+
+static int _testReadEventsUntil(void) {
+  MidiSource m;
+  MidiSequence s = newMidiSequence();
+
+  _writeTestMidiFile(0, 1);
+  m = _openTestMidiSource();
+  assertNotNull(m);
+
+  assert(m->readMidiEventsUntil(m, s, 1));
+  assertUnsignedLongEquals(2ul, s->numMidiEvents);
+  assert(m->readMidiEventsUntil(m, s, TEST_FRAMES_PER_BEAT));
+  assertUnsignedLongEquals(2ul, s->numMidiEvents);
+  assert(m->readMidiEventsUntil(m, s, TEST_FRAMES_PER_BEAT + 1));
+  assertUnsignedLongEquals(4ul, s->numMidiEvents);
+  assertFalse(m->readMidiEventsUntil(m, s, 4 * TEST_FRAMES_PER_BEAT + 1));
+  assertUnsignedLongEquals(6ul, s->numMidiEvents);
+  assertFalse(m->readMidiEventsUntil(m, s, 8 * TEST_FRAMES_PER_BEAT));
+
+  freeMidiSequence(s);
+  freeMidiSource(m);
+  return 0;
+}
+
+static int _testMergeTracks(void) {
+  MidiSource m;
+  MidiSequence s = newMidiSequence();
+  MidiSequenceRange r;
+  unsigned long i;
+
+  _writeTestMidiFile(1, 2);
+  m = _openTestMidiSource();
+  assertNotNull(m);
+  assert(m->readMidiEvents(m, s));
+  // The end of the shorter track and the marker are left out
+  assertUnsignedLongEquals(7ul, s->numMidiEvents);
+
+  assertFalse(midiSequenceGetRange(s, 0, 4 * TEST_FRAMES_PER_BEAT + 1, &r));
+  assertIntEquals(0xc0, r.midiEvents[2].status);
+  assertIntEquals(0x05, r.midiEvents[2].data1);
+  assertUnsignedLongEquals((unsigned long)(TEST_FRAMES_PER_BEAT / 2),
+                           r.midiEvents[2].timestamp);
+
+  for (i = 1; i < r.numMidiEvents; i++) {
+    assert(r.midiEvents[i - 1].timestamp <= r.midiEvents[i].timestamp);
+  }
+
+  freeMidiSequence(s);
+  freeMidiSource(m);
+  return 0;
+}
+
+static int _testTempoChangeInOtherTrack(void) {
+  FILE *file = _newTestMidiFile(1, 2);
+  MidiSource m;
+  MidiSequence s = newMidiSequence();
+  MidiSequenceRange r;
+
+  _writeTestMidiTrack(file, kTestTrackTempoChange,
+                      sizeof(kTestTrackTempoChange));
+  _writeTestMidiTrack(file, kTestTrackLongNote, sizeof(kTestTrackLongNote));
+  fclose(file);
+
+  m = _openTestMidiSource();
+  assertNotNull(m);
+  assert(m->readMidiEvents(m, s));
+  assertUnsignedLongEquals(5ul, s->numMidiEvents);
+
+  assertFalse(midiSequenceGetRange(s, 0, 4 * TEST_FRAMES_PER_BEAT, &r));
+  assertIntEquals(0x90, r.midiEvents[1].status);
+  assertUnsignedLongEquals((unsigned long)(TEST_FRAMES_PER_BEAT / 2),
+                           r.midiEvents[1].timestamp);
+  assertIntEquals(MIDI_META_TYPE_TEMPO, r.midiEvents[2].status);
+  assertUnsignedLongEquals((unsigned long)TEST_FRAMES_PER_BEAT,
+                           r.midiEvents[2].timestamp);
+  // The second beat is twice as long as the first one
+  assertIntEquals(0x3c, r.midiEvents[3].data1);
+  assertUnsignedLongEquals((unsigned long)(3 * TEST_FRAMES_PER_BEAT),
+                           r.midiEvents[3].timestamp);
+  assertIntEquals(MIDI_META_TYPE_TRACK_END, r.midiEvents[4].status);
+
+  freeMidiSequence(s);
+  freeMidiSource(m);
+  return 0;
+}
+
+static int _testOpenInvalidFiles(void) {
+  CharString filename = newCharStringWithCString("invalid.mid");
+  MidiSource m = newMidiSourceFile(filename);
+  FILE *file;
+
+  assertFalse(m->openMidiSource(m));
+  freeMidiSource(m);
+
+  // Type 0 files may only have one track
+  _writeTestMidiFile(0, 2);
+  assertIsNull(_openTestMidiSource());
+
+  // Track which is longer than the file
+  _writeTestMidiFile(0, 1);
+  file = fopen(TEST_MIDI_FILENAME, "r+b");
+  fseek(file, 18, SEEK_SET);
+  _writeBigEndian(file, 1000, 4);
+  fclose(file);
+  assertIsNull(_openTestMidiSource());
+
+  freeCharString(filename);
+  return 0;
+}
+
+TestSuite addMidiSourceFileTests(void);
+TestSuite addMidiSourceFileTests(void) {
+  TestSuite testSuite = newTestSuite("MidiSourceFile", _midiSourceFileTestSetup,
+                                     _midiSourceFileTestTeardown);
+  addTest(testSuite, "ReadAllEvents", _testReadAllEvents);
+  addTest(testSuite, "ReadEventsUntil", _testReadEventsUntil);
+  addTest(testSuite, "MergeTracks", _testMergeTracks);
+  addTest(testSuite, "TempoChangeInOtherTrack", _testTempoChangeInOtherTrack);
+  addTest(testSuite, "OpenInvalidFiles", _testOpenInvalidFiles);
+  return testSuite;
+}
@@ -0,0 +1,282 @@
+//
+// MidiSourceStreamTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "midi/MidiSourceStream.h"
+
+#include "audio/AudioSettings.h"
+#include "base/File.h"
+#include "unit/TestRunner.h"
+
+#if UNIX
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define TEST_MIDI_STREAM_PATH "mrswatsontest-midi-stream"
+// With the default tempo and sample rate, a beat is 22050 frames
+#define TEST_FRAMES_PER_BEAT 22050
+
+// Raw MIDI bytes, with running status, realtime and system exclusive messages
+static const byte kTestRawMidi[] = {
+    0x90, 0x3c, 0x64,       // Note on
+    0x3e, 0xf8, 0x64,       // Running status, with a timing clock in between
+    0xf0, 0x7d, 0x01, 0xf7, // System exclusive
+    0x40, 0x00,             // Data bytes without running status
+    0xc0, 0x05,             // Program change
+};
+
+// Type 0 MIDI file with 96 ticks per beat, whose tempo halves after a beat
+static const byte kTestMidiFile[] = {
+    'M', 'T', 'h', 'd', 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00, 0x01, 0x00,
+    0x60, 'M', 'T', 'r', 'k', 0xff, 0xff, 0xff, 0xff, // Unknown track length
+    0x00, 0x90, 0x3c, 0x64,                           // Note on at 0
+    0x60, 0xff, 0x51, 0x03, 0x0f, 0x42, 0x40,         // Tempo at beat 1, 60 BPM
+    0x00, 0xff, 0x06, 0x02, 'h', 'i',                 // Marker
+    0x60, 0x3c, 0x00,                                 // Note off at beat 2
+    0x00, 0xff, 0x2f, 0x00,                           // Track end
+};
+
+static void _midiSourceStreamTestSetup(void) { initAudioSettings(); }
+
+static void _midiSourceStreamTestTeardown(void) {
+  File file = newFileWithPathCString(TEST_MIDI_STREAM_PATH);
+
+  if (fileExists(file)) {
+    fileRemove(file);
+  }
+
+  freeFile(file);
+  freeAudioSettings();
+}
+
+#if UNIX
+/**
+ * Open a stream source on a named pipe which already contains the given data,
+ * and which is closed afterwards.
+ */
+static MidiSource _openTestMidiStream(const byte *data, size_t dataSize) {
+  CharString path = newCharStringWithCString(TEST_MIDI_STREAM_PATH);
+  MidiSource m = NULL;
+  int writer;
+
+  if (mkfifo(TEST_MIDI_STREAM_PATH, 0600) == 0) {
+    m = newMidiSource(guessMidiSourceType(path), path);
+  }
+
+  freeCharString(path);
+
+  if (m == NULL) {
+    return NULL;
+  }
+
+  // The pipe is also opened for reading, so that neither side blocks when
+  // opening it
+  writer = open(TEST_MIDI_STREAM_PATH, O_RDWR);
+
+  if (writer < 0 || write(writer, data, dataSize) != (ssize_t)dataSize ||
+      !m->openMidiSource(m)) {
+    freeMidiSource(m);
+    m = NULL;
+  }
+
+  if (writer >= 0) {
+    close(writer);
+  }
+
+  return m;
+}
+#endif
+
+static int _testGuessMidiSourceType(void) {
+  CharString name = newCharString();
+
+#if UNIX
+  charStringCopyCString(name, MIDI_SOURCE_STREAM_STDIN);
+  assertIntEquals(MIDI_SOURCE_TYPE_STREAM, guessMidiSourceType(name));
+  charStringCopyCString(name, TEST_MIDI_STREAM_PATH);
+  assertFalse(isMidiSourceStream(name));
+  assertIntEquals(0, mkfifo(TEST_MIDI_STREAM_PATH, 0600));
+  assert(isMidiSourceStream(name));
+  assertIntEquals(MIDI_SOURCE_TYPE_STREAM, guessMidiSourceType(name));
+#endif
+
+  charStringCopyCString(name, "test.mid");
+  assertFalse(isMidiSourceStream(name));
+  assertIntEquals(MIDI_SOURCE_TYPE_FILE, guessMidiSourceType(name));
+
+  freeCharString(name);
+  return 0;
+}
+
+static int _testReadRawEvents(void) {
+#if UNIX
+  MidiSource m = _openTestMidiStream(kTestRawMidi, sizeof(kTestRawMidi));
+  MidiSequence s = newMidiSequence();
+  MidiSequenceRange r;
+
+  assertNotNull(m);
+  assertFalse(((MidiSourceStreamData)m->extraData)->timestamped);
+  assert(m->readMidiEvents(m, s));
+  // The end of the stream is passed on as the end of a track
+  assertUnsignedLongEquals(4ul, s->numMidiEvents);
+
+  assertFalse(midiSequenceGetRange(s, 0, 1, &r));
+  assertIntEquals(0x90, r.midiEvents[0].status);
+  assertIntEquals(0x3c, r.midiEvents[0].data1);
+  assertIntEquals(0x90, r.midiEvents[1].status);
+  assertIntEquals(0x3e, r.midiEvents[1].data1);
+  assertIntEquals(0x64, r.midiEvents[1].data2);
+  assertIntEquals(0xc0, r.midiEvents[2].status);
+  assertIntEquals(0x05, r.midiEvents[2].data1);
+  assertIntEquals(MIDI_TYPE_META, r.midiEvents[3].eventType);
+  assertIntEquals(MIDI_META_TYPE_TRACK_END, r.midiEvents[3].status);
+
+  freeMidiSequence(s);
+  freeMidiSource(m);
+#endif
+  return 0;
+}
+
+static int _testReadTimestampedEvents(void) {
+#if UNIX
+  MidiSource m = _openTestMidiStream(kTestMidiFile, sizeof(kTestMidiFile));
+  MidiSequence s = newMidiSequence();
+  MidiSequenceRange r;
+
+  assertNotNull(m);
+  assert(((MidiSourceStreamData)m->extraData)->timestamped);
+
+  // Reading waits for the events of each block
+  assert(m->readMidiEventsUntil(m, s, TEST_FRAMES_PER_BEAT));
+  assertUnsignedLongEquals(1ul, s->numMidiEvents);
+  assert(m->readMidiEventsUntil(m, s, 3 * TEST_FRAMES_PER_BEAT));
+  assertUnsignedLongEquals(2ul, s->numMidiEvents);
+  assertFalse(m->readMidiEventsUntil(m, s, 3 * TEST_FRAMES_PER_BEAT + 1));
+  assertUnsignedLongEquals(4ul, s->numMidiEvents);
+
+  assertFalse(midiSequenceGetRange(s, 0, 4 * TEST_FRAMES_PER_BEAT, &r));
+  assertIntEquals(MIDI_META_TYPE_TEMPO, r.midiEvents[1].status);
+  assertUnsignedLongEquals((unsigned long)TEST_FRAMES_PER_BEAT,
+                           r.midiEvents[1].timestamp);
+  assertIntEquals(0x0f, r.midiEvents[1].extraData[0]);
+  // The second beat is twice as long as the first one
+  assertIntEquals(0x90, r.midiEvents[2].status);
+  assertIntEquals(0x00, r.midiEvents[2].data2);
+  assertUnsignedLongEquals((unsigned long)(3 * TEST_FRAMES_PER_BEAT),
+                           r.midiEvents[2].timestamp);
+  assertIntEquals(MIDI_META_TYPE_TRACK_END, r.midiEvents[3].status);
+
+  freeMidiSequence(s);
+  freeMidiSource(m);
+#endif
+  return 0;
+}
+
+static int _testReadInvalidMidiFile(void) {
+#if UNIX
+  // Type 1 files with several tracks can't be merged while streaming
+  byte data[sizeof(kTestMidiFile)];
+  MidiSource m;
+  MidiSequence s = newMidiSequence();
+
+  memcpy(data, kTestMidiFile, sizeof(kTestMidiFile));
+  data[9] = 1;
+  data[11] = 2;
+  m = _openTestMidiStream(data, sizeof(data));
+  assertNotNull(m);
+  assertFalse(m->readMidiEventsUntil(m, s, TEST_FRAMES_PER_BEAT));
+  assertUnsignedLongEquals(1ul, s->numMidiEvents);
+
+  freeMidiSequence(s);
+  freeMidiSource(m);
+#endif
+  return 0;
+}
+
+static int _testReadMoreEventsThanQueueCapacity(void) {
+#if UNIX
+  // The reader thread must wait for the played messages to be returned
+  const unsigned long numEvents = 2 * MIDI_SOURCE_STREAM_QUEUE_CAPACITY;
+  byte data[1 + 2 * 2 * MIDI_SOURCE_STREAM_QUEUE_CAPACITY];
+  MidiSource m;
+  MidiSequence s = newMidiSequence();
+  unsigned long i;
+
+  data[0] = 0x90;
+
+  for (i = 0; i < numEvents; i++) {
+    data[1 + 2 * i] = (byte)(i & 0x7f);
+    data[2 + 2 * i] = 0x64;
+  }
+
+  m = _openTestMidiStream(data, sizeof(data));
+  assertNotNull(m);
+  assert(m->readMidiEvents(m, s));
+  assertUnsignedLongEquals(numEvents + 1, s->numMidiEvents);
+
+  freeMidiSequence(s);
+  freeMidiSource(m);
+#endif
+  return 0;
+}
+
+static int _testFreeWhileStreaming(void) {
+#if UNIX
+  CharString path = newCharStringWithCString(TEST_MIDI_STREAM_PATH);
+  MidiSource m;
+  int writer;
+
+  assertIntEquals(0, mkfifo(TEST_MIDI_STREAM_PATH, 0600));
+  m = newMidiSourceStream(path);
+  writer = open(TEST_MIDI_STREAM_PATH, O_RDWR);
+  assert(writer >= 0);
+  assertIntEquals(3, (int)write(writer, kTestRawMidi, 3));
+  assert(m->openMidiSource(m));
+
+  // Test is not hanging while the stream is still open
+  freeMidiSource(m);
+  close(writer);
+  freeCharString(path);
+#endif
+  return 0;
+}
+
+TestSuite addMidiSourceStreamTests(void);
+TestSuite addMidiSourceStreamTests(void) {
+  TestSuite testSuite =
+      newTestSuite("MidiSourceStream", _midiSourceStreamTestSetup,
+                   _midiSourceStreamTestTeardown);
+  addTest(testSuite, "GuessMidiSourceType", _testGuessMidiSourceType);
+  addTest(testSuite, "ReadRawEvents", _testReadRawEvents);
+  addTest(testSuite, "ReadTimestampedEvents", _testReadTimestampedEvents);
+  addTest(testSuite, "ReadInvalidMidiFile", _testReadInvalidMidiFile);
+  addTest(testSuite, "ReadMoreEventsThanQueueCapacity",
+          _testReadMoreEventsThanQueueCapacity);
+  addTest(testSuite, "FreeWhileStreaming", _testFreeWhileStreaming);
+  return testSuite;
+}
@@ -0,0 +1,136 @@
+//
+// MidiTempoMapTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "midi/MidiTempoMap.h"
+
+#include "unit/TestRunner.h"
+
+#define TEST_TICKS_PER_BEAT 96
+#define TEST_SAMPLE_RATE 44100.0
+// At 120 BPM, a beat is half a second
+#define TEST_FRAMES_PER_BEAT 22050ul
+
+static MidiTempoMap _newTestMidiTempoMap(void) {
+  return newMidiTempoMap(TEST_TICKS_PER_BEAT, 120.0, TEST_SAMPLE_RATE);
+}
+
+static int _testNewMidiTempoMap(void) {
+  MidiTempoMap m = _newTestMidiTempoMap();
+  assertNotNull(m);
+  assertIntEquals(TEST_TICKS_PER_BEAT, m->ticksPerBeat);
+  assertDoubleEquals(TEST_SAMPLE_RATE, m->sampleRate, TEST_DEFAULT_TOLERANCE);
+  freeMidiTempoMap(m);
+  return 0;
+}
+
+static int _testGetFrameWithoutTempoChanges(void) {
+  MidiTempoMap m = _newTestMidiTempoMap();
+  assertUnsignedLongEquals(0ul, midiTempoMapGetFrame(m, 0));
+  assertUnsignedLongEquals(TEST_FRAMES_PER_BEAT / 2,
+                           midiTempoMapGetFrame(m, TEST_TICKS_PER_BEAT / 2));
+  assertUnsignedLongEquals(10 * TEST_FRAMES_PER_BEAT,
+                           midiTempoMapGetFrame(m, 10 * TEST_TICKS_PER_BEAT));
+  freeMidiTempoMap(m);
+  return 0;
+}
+
+static int _testGetFrameWithTempoChanges(void) {
+  MidiTempoMap m = _newTestMidiTempoMap();
+
+  // 60 BPM from the second beat, and 240 BPM from the fourth
+  assert(midiTempoMapAddTempo(m, TEST_TICKS_PER_BEAT, 1000000));
+  assert(midiTempoMapAddTempo(m, 3 * TEST_TICKS_PER_BEAT, 250000));
+
+  assertUnsignedLongEquals(TEST_FRAMES_PER_BEAT,
+                           midiTempoMapGetFrame(m, TEST_TICKS_PER_BEAT));
+  assertUnsignedLongEquals(
+      2 * TEST_FRAMES_PER_BEAT,
+      midiTempoMapGetFrame(m, 3 * TEST_TICKS_PER_BEAT / 2));
+  assertUnsignedLongEquals(5 * TEST_FRAMES_PER_BEAT,
+                           midiTempoMapGetFrame(m, 3 * TEST_TICKS_PER_BEAT));
+  assertUnsignedLongEquals(5 * TEST_FRAMES_PER_BEAT + TEST_FRAMES_PER_BEAT / 2,
+                           midiTempoMapGetFrame(m, 4 * TEST_TICKS_PER_BEAT));
+
+  freeMidiTempoMap(m);
+  return 0;
+}
+
+static int _testAddTempoAtSameTick(void) {
+  MidiTempoMap m = _newTestMidiTempoMap();
+
+  // The last tempo change at a tick wins, also for the initial tempo
+  assert(midiTempoMapAddTempo(m, 0, 1000000));
+  assert(midiTempoMapAddTempo(m, 0, 250000));
+  assertUnsignedLongEquals(TEST_FRAMES_PER_BEAT / 2,
+                           midiTempoMapGetFrame(m, TEST_TICKS_PER_BEAT));
+
+  freeMidiTempoMap(m);
+  return 0;
+}
+
+static int _testAddInvalidTempo(void) {
+  MidiTempoMap m = _newTestMidiTempoMap();
+
+  assert(midiTempoMapAddTempo(m, TEST_TICKS_PER_BEAT, 1000000));
+  assertFalse(midiTempoMapAddTempo(m, 2 * TEST_TICKS_PER_BEAT, 0));
+  assertUnsignedLongEquals(3 * TEST_FRAMES_PER_BEAT,
+                           midiTempoMapGetFrame(m, 2 * TEST_TICKS_PER_BEAT));
+
+  freeMidiTempoMap(m);
+  return 0;
+}
+
+static int _testAddManyTempoChanges(void) {
+  MidiTempoMap m = _newTestMidiTempoMap();
+  unsigned long i;
+
+  // Alternate between 60 and 240 BPM on every beat, so that each pair of beats
+  // lasts two and a half beats at 120 BPM
+  for (i = 1; i <= 1000; i++) {
+    assert(midiTempoMapAddTempo(m, i * TEST_TICKS_PER_BEAT,
+                                (i % 2) ? 1000000 : 250000));
+  }
+
+  assertUnsignedLongEquals(
+      TEST_FRAMES_PER_BEAT + 500 * 5 * TEST_FRAMES_PER_BEAT / 2,
+      midiTempoMapGetFrame(m, 1001 * TEST_TICKS_PER_BEAT));
+
+  freeMidiTempoMap(m);
+  return 0;
+}
+
+TestSuite addMidiTempoMapTests(void);
+TestSuite addMidiTempoMapTests(void) {
+  TestSuite testSuite = newTestSuite("MidiTempoMap", NULL, NULL);
+  addTest(testSuite, "NewMidiTempoMap", _testNewMidiTempoMap);
+  addTest(testSuite, "GetFrameWithoutTempoChanges",
+          _testGetFrameWithoutTempoChanges);
+  addTest(testSuite, "GetFrameWithTempoChanges", _testGetFrameWithTempoChanges);
+  addTest(testSuite, "AddTempoAtSameTick", _testAddTempoAtSameTick);
+  addTest(testSuite, "AddInvalidTempo", _testAddInvalidTempo);
+  addTest(testSuite, "AddManyTempoChanges", _testAddManyTempoChanges);
+  return testSuite;
+}
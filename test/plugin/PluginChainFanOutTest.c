@@ -0,0 +1,191 @@
+//
+// PluginChainFanOutTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "plugin/PluginChainFanOut.h"
+
+#include "audio/AudioSettings.h"
+#include "unit/TestRunner.h"
+
+#include "PluginMock.h"
+
+#define TEST_NUM_VARIANTS 3
+#define TEST_NUM_BLOCKS 4
+
+static void _pluginChainFanOutTestSetup(void) { initAudioSettings(); }
+
+static void _pluginChainFanOutTestTeardown(void) {
+  setThreadPinning(false);
+  freeAudioSettings();
+}
+
+static PluginChainFanOut _newFanOutWithMockVariants(Plugin *outPlugins,
+                                                    SampleSource *outSources) {
+  PluginChainFanOut f = newPluginChainFanOut();
+  int i;
+
+  for (i = 0; i < TEST_NUM_VARIANTS; i++) {
+    PluginChain p = newPluginChain();
+    SampleSource s = sampleSourceFactory(NULL);
+
+    outPlugins[i] = newPluginMock();
+    pluginChainAppend(p, outPlugins[i], NULL);
+    s->openSampleSource(s, SAMPLE_SOURCE_OPEN_WRITE);
+    outSources[i] = s;
+    pluginChainFanOutAddVariant(f, p, s);
+  }
+
+  return f;
+}
+
+static int _testNewPluginChainFanOut(void) {
+  PluginChainFanOut f = newPluginChainFanOut();
+  assertNotNull(f);
+  assertIntEquals(0, f->numVariants);
+  assertIntEquals(0, f->numThreads);
+  freePluginChainFanOut(f);
+  return 0;
+}
+
+static int _testAddNullVariant(void) {
+  PluginChainFanOut f = newPluginChainFanOut();
+  assertFalse(pluginChainFanOutAddVariant(f, NULL, NULL));
+  assertIntEquals(0, f->numVariants);
+  freePluginChainFanOut(f);
+  return 0;
+}
+
+static int _testProcessVariants(unsigned int numThreads) {
+  Plugin plugins[TEST_NUM_VARIANTS];
+  SampleSource sources[TEST_NUM_VARIANTS];
+  PluginChainFanOut f = _newFanOutWithMockVariants(plugins, sources);
+  SampleBuffer input = newSampleBuffer(getNumChannels(), getBlocksize());
+  int i;
+
+  assertIntEquals(TEST_NUM_VARIANTS, f->numVariants);
+  pluginChainFanOutStart(f, numThreads);
+
+  for (i = 0; i < TEST_NUM_BLOCKS; i++) {
+    pluginChainFanOutProcess(f, input, input->blocksize, NULL);
+    pluginChainFanOutWait(f);
+  }
+
+  for (i = 0; i < TEST_NUM_VARIANTS; i++) {
+    PluginMockData mockData = (PluginMockData)plugins[i]->extraData;
+    assert(mockData->isPrepared);
+    assert(mockData->processAudioCalled);
+    assertFalse(mockData->processMidiCalled);
+    assertUnsignedLongEquals(
+        (unsigned long)(TEST_NUM_BLOCKS * getBlocksize() * getNumChannels()),
+        sources[i]->numSamplesProcessed);
+  }
+
+  freePluginChainFanOut(f);
+  freeSampleBuffer(input);
+  return 0;
+}
+
+static int _testProcessVariantsWithThreadPerVariant(void) {
+  return _testProcessVariants(0);
+}
+
+static int _testProcessVariantsWithSingleThread(void) {
+  return _testProcessVariants(1);
+}
+
+static int _testProcessVariantsWithMoreThreadsThanVariants(void) {
+  return _testProcessVariants(TEST_NUM_VARIANTS * 2);
+}
+
+static int _testProcessVariantsWithPinnedThreads(void) {
+  // Fewer threads than variants, so that a worker has more than one variant
+  setThreadPinning(true);
+  return _testProcessVariants(TEST_NUM_VARIANTS - 1);
+}
+
+static int _testFlushVariantsWithDifferentDelays(void) {
+  Plugin plugins[TEST_NUM_VARIANTS];
+  SampleSource sources[TEST_NUM_VARIANTS];
+  PluginChainFanOut f = _newFanOutWithMockVariants(plugins, sources);
+  SampleBuffer input = newSampleBuffer(getNumChannels(), getBlocksize());
+  int numBlocksFlushed = 0;
+  unsigned long numFrames;
+  int i;
+
+  // The last variant is delayed by more than a block
+  for (i = 0; i < TEST_NUM_VARIANTS; i++) {
+    PluginMockData mockData = (PluginMockData)plugins[i]->extraData;
+    mockData->initialDelay = i * (getBlocksize() * 3 / 4);
+    mockData->tailTimeInMs = 0;
+  }
+
+  pluginChainFanOutStart(f, 0);
+
+  // The input ends 10 frames before the end of the last block
+  for (i = 0; i < TEST_NUM_BLOCKS; i++) {
+    numFrames = input->blocksize - (i == TEST_NUM_BLOCKS - 1 ? 10 : 0);
+    pluginChainFanOutProcess(f, input, numFrames, NULL);
+    pluginChainFanOutWait(f);
+  }
+
+  while (!pluginChainFanOutIsFinished(f)) {
+    pluginChainFanOutFlush(f);
+    pluginChainFanOutWait(f);
+    numBlocksFlushed++;
+  }
+
+  assertIntEquals(2, numBlocksFlushed);
+
+  for (i = 0; i < TEST_NUM_VARIANTS; i++) {
+    assertUnsignedLongEquals(
+        (unsigned long)((TEST_NUM_BLOCKS * getBlocksize() - 10) *
+                        getNumChannels()),
+        sources[i]->numSamplesProcessed);
+  }
+
+  freePluginChainFanOut(f);
+  freeSampleBuffer(input);
+  return 0;
+}
+
+TestSuite addPluginChainFanOutTests(void);
+TestSuite addPluginChainFanOutTests(void) {
+  TestSuite testSuite =
+      newTestSuite("PluginChainFanOut", _pluginChainFanOutTestSetup,
+                   _pluginChainFanOutTestTeardown);
+  addTest(testSuite, "NewPluginChainFanOut", _testNewPluginChainFanOut);
+  addTest(testSuite, "AddNullVariant", _testAddNullVariant);
+  addTest(testSuite, "ProcessVariantsWithThreadPerVariant",
+          _testProcessVariantsWithThreadPerVariant);
+  addTest(testSuite, "ProcessVariantsWithSingleThread",
+          _testProcessVariantsWithSingleThread);
+  addTest(testSuite, "ProcessVariantsWithMoreThreadsThanVariants",
+          _testProcessVariantsWithMoreThreadsThanVariants);
+  addTest(testSuite, "ProcessVariantsWithPinnedThreads",
+          _testProcessVariantsWithPinnedThreads);
+  addTest(testSuite, "FlushVariantsWithDifferentDelays",
+          _testFlushVariantsWithDifferentDelays);
+  return testSuite;
+}
@@ -0,0 +1,334 @@
+//
+// PluginChainPipelineTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "plugin/PluginChainPipeline.h"
+
+#include "audio/AudioSettings.h"
+#include "midi/MidiEvent.h"
+#include "plugin/PluginChain.h"
+#include "unit/TestRunner.h"
+
+#include "PluginMock.h"
+
+#define TEST_NUM_BLOCKS 8
+#define TEST_SHORT_BLOCKSIZE 100
+
+static void _pluginChainPipelineTestSetup(void) { initAudioSettings(); }
+
+static void _pluginChainPipelineTestTeardown(void) { freeAudioSettings(); }
+
+static PluginChain _newTestPluginChain(const char *plugins) {
+  PluginChain p = newPluginChain();
+  CharString chainString = newCharStringWithCString(plugins);
+  CharString pluginRoot = newCharString();
+
+  pluginChainAddFromArgumentString(p, chainString, pluginRoot);
+  pluginChainInitialize(p);
+
+  freeCharString(chainString);
+  freeCharString(pluginRoot);
+  return p;
+}
+
+static int _testGetNumStages(void) {
+  assertIntEquals(4, pluginChainPipelineGetNumStages(4, 0));
+  assertIntEquals(2, pluginChainPipelineGetNumStages(4, 2));
+  assertIntEquals(2, pluginChainPipelineGetNumStages(2, 5));
+  return 0;
+}
+
+static int _testBalanceStagesEvenly(void) {
+  PluginChain p = _newTestPluginChain(
+      "mrs_passthru;mrs_passthru;mrs_passthru;mrs_passthru");
+  PluginChainPipeline pipeline = newPluginChainPipeline(
+      p->plugins, p->audioTimers, p->midiTimers, p->numPlugins, 2);
+
+  assertIntEquals(2, pipeline->numStages);
+  assertIntEquals(2, pipeline->numThreads);
+  assertIntEquals(0, pipeline->stages[0]->firstPlugin);
+  assertIntEquals(2, pipeline->stages[0]->numPlugins);
+  assertIntEquals(2, pipeline->stages[1]->firstPlugin);
+  assertIntEquals(2, pipeline->stages[1]->numPlugins);
+
+  freePluginChainPipeline(pipeline);
+  freePluginChain(p);
+  return 0;
+}
+
+static int _testBalanceStagesByCost(void) {
+  PluginChain p = _newTestPluginChain(
+      "mrs_passthru;mrs_passthru;mrs_passthru;mrs_passthru");
+  PluginChainPipeline pipeline;
+
+  p->audioTimers[0]->totalTaskTime = 30.0;
+  p->audioTimers[1]->totalTaskTime = 10.0;
+  p->audioTimers[2]->totalTaskTime = 10.0;
+  p->audioTimers[3]->totalTaskTime = 10.0;
+  pipeline = newPluginChainPipeline(p->plugins, p->audioTimers, p->midiTimers,
+                                    p->numPlugins, 2);
+
+  assertIntEquals(0, pipeline->stages[0]->firstPlugin);
+  assertIntEquals(1, pipeline->stages[0]->numPlugins);
+  assertIntEquals(1, pipeline->stages[1]->firstPlugin);
+  assertIntEquals(3, pipeline->stages[1]->numPlugins);
+
+  freePluginChainPipeline(pipeline);
+  freePluginChain(p);
+  return 0;
+}
+
+static int _testGetProcessingDelay(void) {
+  PluginChain p = _newTestPluginChain("mrs_passthru;mrs_passthru");
+
+  assertUnsignedLongEquals(0ul, pluginChainGetProcessingDelay(p));
+  pluginChainSetPipelineStages(p, 4);
+  assertUnsignedLongEquals(2 * getBlocksize(),
+                           pluginChainGetProcessingDelay(p));
+
+  freePluginChain(p);
+  return 0;
+}
+
+static int _testProcessAudio(SampleCount blocksize) {
+  PluginChain p = _newTestPluginChain("mrs_gain;mrs_passthru;mrs_gain");
+  SampleBuffer inBuffer = newSampleBuffer(getNumChannels(), blocksize);
+  SampleBuffer outBuffer = newSampleBuffer(getNumChannels(), blocksize);
+  LinkedList parameters = newLinkedList();
+  unsigned long delay;
+  unsigned long frame = 0;
+  Sample expected;
+  int block;
+  SampleCount i;
+
+  linkedListAppend(parameters, "0,0.5");
+  assert(pluginChainSetParameters(p, parameters));
+  pluginChainSetPipelineStages(p, 3);
+  delay = pluginChainGetProcessingDelay(p);
+  assertUnsignedLongEquals(3 * getBlocksize(), delay);
+  pluginChainPrepareForProcessing(p);
+  assertNotNull(p->_pipeline);
+
+  for (block = 0; block < TEST_NUM_BLOCKS * 4; block++) {
+    for (i = 0; i < blocksize; i++) {
+      inBuffer->samples[0][i] = (Sample)((frame + i) % 1000) / 1000.0f;
+      inBuffer->samples[1][i] = -inBuffer->samples[0][i];
+    }
+
+    pluginChainProcessAudio(p, inBuffer, outBuffer);
+    assertUnsignedLongEquals(blocksize, outBuffer->blocksize);
+
+    for (i = 0; i < blocksize; i++) {
+      if (frame + i < delay) {
+        expected = 0.0f;
+      } else {
+        expected = (Sample)((frame + i - delay) % 1000) / 1000.0f * 0.5f;
+      }
+
+      assertDoubleEquals(expected, outBuffer->samples[0][i],
+                         TEST_DEFAULT_TOLERANCE);
+      assertDoubleEquals(-expected, outBuffer->samples[1][i],
+                         TEST_DEFAULT_TOLERANCE);
+    }
+
+    frame += blocksize;
+  }
+
+  pluginChainShutdown(p);
+  freePluginChain(p);
+  freeLinkedList(parameters);
+  freeSampleBuffer(inBuffer);
+  freeSampleBuffer(outBuffer);
+  return 0;
+}
+
+static int _testProcessAudioWithFullBlocks(void) {
+  return _testProcessAudio(getBlocksize());
+}
+
+static int _testProcessAudioWithShortBlocks(void) {
+  return _testProcessAudio(TEST_SHORT_BLOCKSIZE);
+}
+
+static int _testProcessMidi(void) {
+  Plugin mock = newPluginMock();
+  PluginChain p = newPluginChain();
+  SampleBuffer inBuffer = newSampleBuffer(getNumChannels(), getBlocksize());
+  SampleBuffer outBuffer = newSampleBuffer(getNumChannels(), getBlocksize());
+  LinkedList midiEvents = newLinkedList();
+  MidiEvent midiEvent = newMidiEvent();
+  int i;
+
+  midiEvent->eventType = MIDI_TYPE_REGULAR;
+  midiEvent->status = 0x90;
+  linkedListAppend(midiEvents, midiEvent);
+  assert(pluginChainAppend(p, mock, NULL));
+  pluginChainSetPipelineStages(p, 1);
+  pluginChainPrepareForProcessing(p);
+
+  pluginChainProcessMidi(p, midiEvents);
+  // The events are copied, so the caller may free them right away
+  freeLinkedListAndItems(midiEvents, (LinkedListFreeItemFunc)freeMidiEvent);
+
+  for (i = 0; i < TEST_NUM_BLOCKS; i++) {
+    pluginChainProcessAudio(p, inBuffer, outBuffer);
+  }
+
+  assert(((PluginMockData)mock->extraData)->processMidiCalled);
+  assert(((PluginMockData)mock->extraData)->processAudioCalled);
+
+  pluginChainShutdown(p);
+  freePluginChain(p);
+  freeSampleBuffer(inBuffer);
+  freeSampleBuffer(outBuffer);
+  return 0;
+}
+
+static int _testProcessMidiForLaterPlugin(void) {
+  Plugin head = newPluginMock();
+  Plugin tail = newPluginMock();
+  PluginChain p = newPluginChain();
+  SampleBuffer inBuffer = newSampleBuffer(getNumChannels(), getBlocksize());
+  SampleBuffer outBuffer = newSampleBuffer(getNumChannels(), getBlocksize());
+  LinkedList midiEvents = newLinkedList();
+  MidiEvent midiEvent = newMidiEvent();
+  int i;
+
+  linkedListAppend(midiEvents, midiEvent);
+  assert(pluginChainAppend(p, head, NULL));
+  assert(pluginChainAppend(p, tail, NULL));
+  pluginChainSetPipelineStages(p, 2);
+  pluginChainPrepareForProcessing(p);
+
+  pluginChainProcessPluginMidi(p, 1, midiEvents);
+  freeLinkedListAndItems(midiEvents, (LinkedListFreeItemFunc)freeMidiEvent);
+
+  for (i = 0; i < TEST_NUM_BLOCKS; i++) {
+    pluginChainProcessAudio(p, inBuffer, outBuffer);
+  }
+
+  assertFalse(((PluginMockData)head->extraData)->processMidiCalled);
+  assertIntEquals(1, ((PluginMockData)tail->extraData)->numMidiCalls);
+  assertIntEquals(1, ((PluginMockData)tail->extraData)->numMidiEvents);
+
+  pluginChainShutdown(p);
+  freePluginChain(p);
+  freeSampleBuffer(inBuffer);
+  freeSampleBuffer(outBuffer);
+  return 0;
+}
+
+static int _testSetParameterOnLaterStage(void) {
+  PluginChain p = _newTestPluginChain("mrs_passthru;mrs_gain");
+  SampleBuffer inBuffer = newSampleBuffer(getNumChannels(), getBlocksize());
+  SampleBuffer outBuffer = newSampleBuffer(getNumChannels(), getBlocksize());
+  const int delayInBlocks = 2;
+  const int changedBlock = 3;
+  Sample expected;
+  SampleCount frame;
+  int block;
+
+  pluginChainSetPipelineStages(p, 2);
+  pluginChainPrepareForProcessing(p);
+
+  for (frame = 0; frame < getBlocksize(); frame++) {
+    inBuffer->samples[0][frame] = 1.0f;
+    inBuffer->samples[1][frame] = 1.0f;
+  }
+
+  for (block = 0; block < TEST_NUM_BLOCKS; block++) {
+    // The change must only affect the block which is sent after it, even
+    // though the plugin is still processing earlier blocks at this point
+    if (block == changedBlock) {
+      assert(pluginChainSetPluginParameter(p, 1, 0, 0.5f));
+    }
+
+    pluginChainProcessAudio(p, inBuffer, outBuffer);
+
+    if (block < delayInBlocks) {
+      expected = 0.0f;
+    } else if (block < changedBlock + delayInBlocks) {
+      expected = 1.0f;
+    } else {
+      expected = 0.5f;
+    }
+
+    assertDoubleEquals(expected, outBuffer->samples[0][0],
+                       TEST_DEFAULT_TOLERANCE);
+    assertDoubleEquals(expected, outBuffer->samples[1][getBlocksize() - 1],
+                       TEST_DEFAULT_TOLERANCE);
+  }
+
+  pluginChainShutdown(p);
+  freePluginChain(p);
+  freeSampleBuffer(inBuffer);
+  freeSampleBuffer(outBuffer);
+  return 0;
+}
+
+static int _testResetPipelinedChain(void) {
+  Plugin mock = newPluginMock();
+  PluginChain p = newPluginChain();
+  SampleBuffer inBuffer = newSampleBuffer(getNumChannels(), getBlocksize());
+  SampleBuffer outBuffer = newSampleBuffer(getNumChannels(), getBlocksize());
+
+  assert(pluginChainAppend(p, mock, NULL));
+  pluginChainSetPipelineStages(p, 1);
+  pluginChainPrepareForProcessing(p);
+  pluginChainProcessAudio(p, inBuffer, outBuffer);
+  pluginChainReset(p);
+  assert(((PluginMockData)mock->extraData)->isReset);
+  assertNotNull(p->_pipeline);
+  pluginChainProcessAudio(p, inBuffer, outBuffer);
+
+  pluginChainShutdown(p);
+  assertIsNull(p->_pipeline);
+  freePluginChain(p);
+  freeSampleBuffer(inBuffer);
+  freeSampleBuffer(outBuffer);
+  return 0;
+}
+
+TestSuite addPluginChainPipelineTests(void);
+TestSuite addPluginChainPipelineTests(void) {
+  TestSuite testSuite =
+      newTestSuite("PluginChainPipeline", _pluginChainPipelineTestSetup,
+                   _pluginChainPipelineTestTeardown);
+  addTest(testSuite, "GetNumStages", _testGetNumStages);
+  addTest(testSuite, "BalanceStagesEvenly", _testBalanceStagesEvenly);
+  addTest(testSuite, "BalanceStagesByCost", _testBalanceStagesByCost);
+  addTest(testSuite, "GetProcessingDelay", _testGetProcessingDelay);
+  addTest(testSuite, "ProcessAudioWithFullBlocks",
+          _testProcessAudioWithFullBlocks);
+  addTest(testSuite, "ProcessAudioWithShortBlocks",
+          _testProcessAudioWithShortBlocks);
+  addTest(testSuite, "ProcessMidi", _testProcessMidi);
+  addTest(testSuite, "ProcessMidiForLaterPlugin",
+          _testProcessMidiForLaterPlugin);
+  addTest(testSuite, "SetParameterOnLaterStage",
+          _testSetParameterOnLaterStage);
+  addTest(testSuite, "ResetPipelinedChain", _testResetPipelinedChain);
+  return testSuite;
+}
@@ -0,0 +1,251 @@
+//
+// PluginChainRendererTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "plugin/PluginChainRenderer.h"
+
+#include "audio/AudioSettings.h"
+#include "time/AudioClock.h"
+#include "unit/TestRunner.h"
+
+#include "PluginMock.h"
+
+#define TEST_NUM_BLOCKS 4
+
+static void _pluginChainRendererTestSetup(void) { initAudioSettings(); }
+
+static void _pluginChainRendererTestTeardown(void) { freeAudioSettings(); }
+
+static PluginChain _newTestPluginChain(int initialDelay, int tailTimeInMs) {
+  PluginChain p = newPluginChain();
+  Plugin mock = newPluginMock();
+
+  ((PluginMockData)mock->extraData)->initialDelay = initialDelay;
+  ((PluginMockData)mock->extraData)->tailTimeInMs = tailTimeInMs;
+  pluginChainAppend(p, mock, NULL);
+  pluginChainPrepareForProcessing(p);
+  return p;
+}
+
+static SampleSource _newTestOutput(void) {
+  SampleSource s = sampleSourceFactory(NULL);
+  s->openSampleSource(s, SAMPLE_SOURCE_OPEN_WRITE);
+  return s;
+}
+
+static unsigned long _getFramesWritten(SampleSource s) {
+  return s->numSamplesProcessed / getNumChannels();
+}
+
+static unsigned long _renderTestBlocks(PluginChainRenderer r,
+                                       unsigned long numFramesInLastBlock) {
+  SampleBuffer input = newSampleBuffer(getNumChannels(), getBlocksize());
+  unsigned long numBlocksFlushed = 0;
+  int i;
+
+  for (i = 0; i < TEST_NUM_BLOCKS - 1; i++) {
+    pluginChainRendererProcess(r, input, input->blocksize);
+  }
+
+  pluginChainRendererProcess(r, input, numFramesInLastBlock);
+
+  while (!pluginChainRendererIsFinished(r)) {
+    pluginChainRendererFlush(r);
+    numBlocksFlushed++;
+  }
+
+  freeSampleBuffer(input);
+  return numBlocksFlushed;
+}
+
+static int _testRenderWithoutDelay(void) {
+  PluginChain p = _newTestPluginChain(0, 0);
+  SampleSource s = _newTestOutput();
+  PluginChainRenderer r = newPluginChainRenderer(p, s);
+  const unsigned long numFrames = TEST_NUM_BLOCKS * getBlocksize();
+
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG,
+                           _renderTestBlocks(r, getBlocksize()));
+  assertUnsignedLongEquals(numFrames, r->numFramesRead);
+  assertUnsignedLongEquals(numFrames, r->numFramesWritten);
+  assertUnsignedLongEquals(numFrames, _getFramesWritten(s));
+
+  freePluginChainRenderer(r);
+  freeSampleSource(s);
+  freePluginChain(p);
+  return 0;
+}
+
+static int _testRenderCutsProcessingDelay(void) {
+  PluginChain p = _newTestPluginChain(100, 0);
+  SampleSource s = _newTestOutput();
+  PluginChainRenderer r = newPluginChainRenderer(p, s);
+  const unsigned long numFrames = TEST_NUM_BLOCKS * getBlocksize();
+
+  // The delayed frames are written by a single extra block
+  assertUnsignedLongEquals(1ul, _renderTestBlocks(r, getBlocksize()));
+  assertUnsignedLongEquals(numFrames, r->numFramesWritten);
+  assertUnsignedLongEquals(numFrames, _getFramesWritten(s));
+
+  // Flushing a finished renderer does nothing
+  pluginChainRendererFlush(r);
+  assertUnsignedLongEquals(numFrames, _getFramesWritten(s));
+
+  freePluginChainRenderer(r);
+  freeSampleSource(s);
+  freePluginChain(p);
+  return 0;
+}
+
+static int _testRenderDelayLongerThanBlock(void) {
+  PluginChain p = _newTestPluginChain(getBlocksize() * 2 + 10, 0);
+  SampleSource s = _newTestOutput();
+  PluginChainRenderer r = newPluginChainRenderer(p, s);
+  const unsigned long numFrames = TEST_NUM_BLOCKS * getBlocksize();
+
+  assertUnsignedLongEquals(3ul, _renderTestBlocks(r, getBlocksize()));
+  assertUnsignedLongEquals(numFrames, _getFramesWritten(s));
+
+  freePluginChainRenderer(r);
+  freeSampleSource(s);
+  freePluginChain(p);
+  return 0;
+}
+
+static int _testRenderPartialLastBlock(void) {
+  PluginChain p = _newTestPluginChain(100, 0);
+  SampleSource s = _newTestOutput();
+  PluginChainRenderer r = newPluginChainRenderer(p, s);
+  const unsigned long numFrames = (TEST_NUM_BLOCKS - 1) * getBlocksize() + 50;
+
+  // The padding after the end of the input covers the delay
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, _renderTestBlocks(r, 50));
+  assertUnsignedLongEquals(numFrames, r->numFramesRead);
+  assertUnsignedLongEquals(numFrames, _getFramesWritten(s));
+
+  freePluginChainRenderer(r);
+  freeSampleSource(s);
+  freePluginChain(p);
+  return 0;
+}
+
+static int _testRenderTail(void) {
+  PluginChain p = _newTestPluginChain(100, 20);
+  SampleSource s = _newTestOutput();
+  PluginChainRenderer r = newPluginChainRenderer(p, s);
+  // At 44.1kHz, 20ms is 882 frames
+  const unsigned long numFrames = TEST_NUM_BLOCKS * getBlocksize() + 882;
+
+  assertUnsignedLongEquals(2ul, _renderTestBlocks(r, getBlocksize()));
+  assertUnsignedLongEquals(numFrames, r->numFramesWritten);
+  assertUnsignedLongEquals(numFrames, _getFramesWritten(s));
+
+  freePluginChainRenderer(r);
+  freeSampleSource(s);
+  freePluginChain(p);
+  return 0;
+}
+
+static int _testRenderLimitsTail(void) {
+  PluginChain p = newPluginChain();
+  Plugin mock = newPluginMock();
+  SampleSource s = _newTestOutput();
+  PluginChainRenderer r;
+  const unsigned long numFrames =
+      TEST_NUM_BLOCKS * getBlocksize() +
+      (unsigned long)(MAX_PLUGIN_TAIL_TIME_IN_MS * getSampleRate() / 1000.0);
+
+  // A plugin whose tail never ends must not keep the render going forever
+  ((PluginMockData)mock->extraData)->tailTimeInMs = -1;
+  pluginChainAppend(p, mock, NULL);
+  pluginChainPrepareForProcessing(p);
+  r = newPluginChainRenderer(p, s);
+
+  _renderTestBlocks(r, getBlocksize());
+  assertUnsignedLongEquals(numFrames, r->numFramesWritten);
+  assertUnsignedLongEquals(numFrames, _getFramesWritten(s));
+
+  freePluginChainRenderer(r);
+  freeSampleSource(s);
+  freePluginChain(p);
+  return 0;
+}
+
+// Input which ends 10 frames before the end of the last block
+static boolByte _readTestBlocks(void *sampleSourcePtr,
+                                SampleBuffer sampleBuffer) {
+  SampleSource self = (SampleSource)sampleSourcePtr;
+  const unsigned long numFrames = TEST_NUM_BLOCKS * getBlocksize() - 10;
+  unsigned long framesLeft =
+      numFrames - self->numSamplesProcessed / getNumChannels();
+
+  if (sampleBuffer->blocksize > framesLeft) {
+    sampleBuffer->blocksize = framesLeft;
+  }
+
+  self->numSamplesProcessed += sampleBuffer->blocksize * getNumChannels();
+  return (boolByte)(sampleBuffer->blocksize > 0);
+}
+
+static int _testRenderInputSource(void) {
+  PluginChain p = _newTestPluginChain(100, 0);
+  SampleSource input = sampleSourceFactory(NULL);
+  SampleSource s = _newTestOutput();
+  PluginChainRenderer r = newPluginChainRenderer(p, s);
+  const unsigned long startFrame = getAudioClock()->currentFrame;
+
+  input->openSampleSource(input, SAMPLE_SOURCE_OPEN_READ);
+  input->readSampleBlock = _readTestBlocks;
+  pluginChainRendererRender(r, input);
+  assertUnsignedLongEquals(TEST_NUM_BLOCKS * getBlocksize() - 10,
+                           _getFramesWritten(s));
+  // The clock also advances for the block which flushes the delay
+  assertUnsignedLongEquals(
+      startFrame + (TEST_NUM_BLOCKS + 1) * getBlocksize(),
+      getAudioClock()->currentFrame);
+
+  freePluginChainRenderer(r);
+  freeSampleSource(s);
+  freeSampleSource(input);
+  freePluginChain(p);
+  return 0;
+}
+
+TestSuite addPluginChainRendererTests(void);
+TestSuite addPluginChainRendererTests(void) {
+  TestSuite testSuite =
+      newTestSuite("PluginChainRenderer", _pluginChainRendererTestSetup,
+                   _pluginChainRendererTestTeardown);
+  addTest(testSuite, "RenderWithoutDelay", _testRenderWithoutDelay);
+  addTest(testSuite, "RenderCutsProcessingDelay",
+          _testRenderCutsProcessingDelay);
+  addTest(testSuite, "RenderDelayLongerThanBlock",
+          _testRenderDelayLongerThanBlock);
+  addTest(testSuite, "RenderPartialLastBlock", _testRenderPartialLastBlock);
+  addTest(testSuite, "RenderTail", _testRenderTail);
+  addTest(testSuite, "RenderLimitsTail", _testRenderLimitsTail);
+  addTest(testSuite, "RenderInputSource", _testRenderInputSource);
+  return testSuite;
+}
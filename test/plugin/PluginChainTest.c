@@ -28,6 +28,7 @@
 
 #include "audio/AudioSettings.h"
 #include "midi/MidiEvent.h"
+#include "plugin/PluginGain.h"
 #include "plugin/PluginPassthru.h"
 #include "unit/TestRunner.h"
 
@@ -211,6 +212,34 @@ static int _testGetMaximumTailTime(void) {
   return 0;
 }
 
+static int _testGetMaximumTailTimeIsLimited(void) {
+  Plugin mock = newPluginMock();
+  Plugin endlessMock = newPluginMock();
+  PluginChain p = getPluginChain();
+
+  ((PluginMockData)mock->extraData)->tailTimeInMs =
+      MAX_PLUGIN_TAIL_TIME_IN_MS * 100;
+  ((PluginMockData)endlessMock->extraData)->tailTimeInMs = -1;
+  assert(pluginChainAppend(p, mock, NULL));
+  assert(pluginChainAppend(p, endlessMock, NULL));
+  assertIntEquals(MAX_PLUGIN_TAIL_TIME_IN_MS,
+                  pluginChainGetMaximumTailTimeInMs(p));
+
+  return 0;
+}
+
+static int _testGetTailFrames(void) {
+  Plugin mock = newPluginMock();
+  PluginChain p = getPluginChain();
+
+  ((PluginMockData)mock->extraData)->tailTimeInMs = 2000;
+  assert(pluginChainAppend(p, mock, NULL));
+  assert(setSampleRate(48000.0));
+  assertUnsignedLongEquals(96000ul, pluginChainGetTailFrames(p));
+
+  return 0;
+}
+
 static int _testPrepareForProcessing(void) {
   Plugin mock = newPluginMock();
   PluginChain p = getPluginChain();
@@ -223,6 +252,83 @@ static int _testPrepareForProcessing(void) {
   return 0;
 }
 
+static Plugin _newTestPluginGain(float gain) {
+  CharString pluginName = newCharStringWithCString(kInternalPluginGainName);
+  Plugin plugin = newPluginGain(pluginName);
+
+  ((PluginGainSettings)plugin->extraData)->gain = gain;
+  freeCharString(pluginName);
+  return plugin;
+}
+
+static int _testPrepareForProcessingMono(void) {
+  Plugin gain = _newTestPluginGain(0.5f);
+  CharString passthruName =
+      newCharStringWithCString(kInternalPluginPassthruName);
+  Plugin passthru = newPluginPassthru(passthruName);
+  PluginChain p = getPluginChain();
+  SampleBuffer inBuffer = newSampleBuffer(1, DEFAULT_BLOCKSIZE);
+  SampleBuffer outBuffer = newSampleBuffer(2, DEFAULT_BLOCKSIZE);
+
+  assert(pluginChainAppend(p, gain, NULL));
+  assert(pluginChainAppend(p, passthru, NULL));
+  assertIntEquals(RETURN_CODE_SUCCESS, pluginChainInitialize(p));
+  assertIntEquals(2, gain->inputBuffer->numChannels);
+  pluginChainSetNumChannels(p, 1);
+  pluginChainPrepareForProcessing(p);
+
+  assertIntEquals(1, gain->inputBuffer->numChannels);
+  assertIntEquals(1, gain->outputBuffer->numChannels);
+  assertIntEquals(1, gain->getSetting(gain, PLUGIN_NUM_OUTPUTS));
+  assertIntEquals(1, passthru->inputBuffer->numChannels);
+  assertIntEquals(1, passthru->outputBuffer->numChannels);
+
+  // The mono signal is only duplicated when it is copied to the output
+  inBuffer->samples[0][0] = 0.505f;
+  pluginChainProcessAudio(p, inBuffer, outBuffer);
+  assertDoubleEquals(0.2525, outBuffer->samples[0][0], TEST_DEFAULT_TOLERANCE);
+  assertDoubleEquals(0.2525, outBuffer->samples[1][0], TEST_DEFAULT_TOLERANCE);
+
+  freeCharString(passthruName);
+  freeSampleBuffer(inBuffer);
+  freeSampleBuffer(outBuffer);
+  return 0;
+}
+
+static int _testPrepareForProcessingAfterWidePlugin(void) {
+  Plugin mock = newPluginMock();
+  Plugin gain = _newTestPluginGain(1.0f);
+  PluginChain p = getPluginChain();
+
+  assert(pluginChainAppend(p, mock, NULL));
+  assert(pluginChainAppend(p, gain, NULL));
+  assertIntEquals(RETURN_CODE_SUCCESS, pluginChainInitialize(p));
+  pluginChainSetNumChannels(p, 1);
+  pluginChainPrepareForProcessing(p);
+
+  // The mock cannot change its layout and always outputs stereo, so the gain
+  // must stay stereo as well
+  assertIntEquals(2, mock->outputBuffer->numChannels);
+  assertIntEquals(2, gain->inputBuffer->numChannels);
+  assertIntEquals(2, gain->outputBuffer->numChannels);
+
+  return 0;
+}
+
+static int _testResetPluginChain(void) {
+  Plugin mock = newPluginMock();
+  PluginChain p = getPluginChain();
+
+  assert(pluginChainAppend(p, mock, NULL));
+  assertIntEquals(RETURN_CODE_SUCCESS, pluginChainInitialize(p));
+  pluginChainPrepareForProcessing(p);
+  assertFalse(((PluginMockData)mock->extraData)->isReset);
+  pluginChainReset(p);
+  assert(((PluginMockData)mock->extraData)->isReset);
+
+  return 0;
+}
+
 static int _testProcessPluginChainAudio(void) {
   Plugin mock = newPluginMock();
   PluginChain p = getPluginChain();
@@ -322,8 +428,16 @@ TestSuite addPluginChainTests(void) {
   addTest(testSuite, "InitializePluginChain", _testInitializePluginChain);
 
   addTest(testSuite, "GetMaximumTailTime", _testGetMaximumTailTime);
+  addTest(testSuite, "GetMaximumTailTimeIsLimited",
+          _testGetMaximumTailTimeIsLimited);
+  addTest(testSuite, "GetTailFrames", _testGetTailFrames);
 
   addTest(testSuite, "PrepareForProcessing", _testPrepareForProcessing);
+  addTest(testSuite, "PrepareForProcessingMono",
+          _testPrepareForProcessingMono);
+  addTest(testSuite, "PrepareForProcessingAfterWidePlugin",
+          _testPrepareForProcessingAfterWidePlugin);
+  addTest(testSuite, "ResetPluginChain", _testResetPluginChain);
   addTest(testSuite, "ProcessPluginChainAudio", _testProcessPluginChainAudio);
   addTest(testSuite, "ProcessPluginChainAudioRealtime",
           _testProcessPluginChainAudioRealtime);
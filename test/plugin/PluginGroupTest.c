@@ -0,0 +1,363 @@
+//
+// PluginGroupTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "plugin/PluginGroup.h"
+
+#include "audio/AudioSettings.h"
+#include "plugin/PluginChain.h"
+#include "unit/TestRunner.h"
+
+#include <stdlib.h>
+
+#define TEST_NUM_BLOCKS 8
+
+static void _pluginGroupTestSetup(void) { initAudioSettings(); }
+
+static void _pluginGroupTestTeardown(void) { freeAudioSettings(); }
+
+static Plugin _newTestPluginGroup(const char *branches) {
+  CharString groupString = newCharStringWithCString(branches);
+  CharString pluginRoot = newCharString();
+  Plugin p = newPluginGroup(groupString, pluginRoot);
+  freeCharString(groupString);
+  freeCharString(pluginRoot);
+  return p;
+}
+
+static Plugin _newTestChannelGroup(const char *chain, const char *layout) {
+  CharString chainString = newCharStringWithCString(chain);
+  CharString layoutString = newCharStringWithCString(layout);
+  Plugin p = newPluginGroupWithChannelLayout(chainString, layoutString, NULL);
+  freeCharString(chainString);
+  freeCharString(layoutString);
+  return p;
+}
+
+static boolByte _addTestPlugins(PluginChain p, const char *plugins) {
+  CharString chainString = newCharStringWithCString(plugins);
+  CharString pluginRoot = newCharString();
+  boolByte result =
+      pluginChainAddFromArgumentString(p, chainString, pluginRoot);
+  freeCharString(chainString);
+  freeCharString(pluginRoot);
+  return result;
+}
+
+static void _fillTestBuffer(SampleBuffer buffer, unsigned long frame) {
+  SampleCount i;
+
+  for (i = 0; i < buffer->blocksize; i++) {
+    buffer->samples[0][i] = (Sample)((frame + i) % 1000) / 1000.0f;
+    buffer->samples[1][i] = -buffer->samples[0][i];
+  }
+}
+
+static int _testNewPluginGroup(void) {
+  Plugin p = _newTestPluginGroup("mrs_gain|mrs_passthru");
+
+  assertNotNull(p);
+  assertIntEquals(PLUGIN_TYPE_GROUP, p->interfaceType);
+  assertCharStringEquals("[mrs_gain|mrs_passthru]", p->pluginName);
+  assertFalse(p->isOpen);
+
+  freePlugin(p);
+  return 0;
+}
+
+static int _testOpenPluginGroup(void) {
+  Plugin p = _newTestPluginGroup("mrs_gain|mrs_passthru;mrs_gain");
+  PluginGroupData data = (PluginGroupData)p->extraData;
+
+  assert(openPlugin(p));
+  assertIntEquals(PLUGIN_TYPE_EFFECT, p->pluginType);
+  assertIntEquals(2, data->numBranches);
+  assertIntEquals(1, data->branches[0]->pluginChain->numPlugins);
+  assertIntEquals(2, data->branches[1]->pluginChain->numPlugins);
+  assertIntEquals(2, p->getSetting(p, PLUGIN_NUM_INPUTS));
+  assertIntEquals(2, p->getSetting(p, PLUGIN_NUM_OUTPUTS));
+  assertIntEquals(0, p->getSetting(p, PLUGIN_INITIAL_DELAY));
+
+  closePlugin(p);
+  assertIntEquals(0, data->numBranches);
+  freePlugin(p);
+  return 0;
+}
+
+static int _testOpenInvalidPluginGroup(void) {
+  Plugin p = _newTestPluginGroup("mrs_gain|invalid");
+
+  assertFalse(openPlugin(p));
+  assertIntEquals(0, ((PluginGroupData)p->extraData)->numBranches);
+
+  freePlugin(p);
+  return 0;
+}
+
+static int _testProcessAudioSumsBranches(void) {
+  Plugin p = _newTestPluginGroup("mrs_gain|mrs_passthru");
+  PluginGroupData data = (PluginGroupData)p->extraData;
+  SampleBuffer inBuffer = newSampleBuffer(getNumChannels(), getBlocksize());
+  SampleBuffer outBuffer = newSampleBuffer(getNumChannels(), getBlocksize());
+  LinkedList parameters = newLinkedList();
+  unsigned long frame = 0;
+  Sample expected;
+  int block;
+  SampleCount i;
+
+  linkedListAppend(parameters, "0,0.5");
+  assert(openPlugin(p));
+  assert(pluginChainSetParameters(data->branches[0]->pluginChain, parameters));
+  p->prepareForProcessing(p);
+  assertIntEquals(1, data->numWorkers);
+
+  for (block = 0; block < TEST_NUM_BLOCKS; block++) {
+    _fillTestBuffer(inBuffer, frame);
+    p->processAudio(p, inBuffer, outBuffer);
+
+    for (i = 0; i < getBlocksize(); i++) {
+      expected = (Sample)((frame + i) % 1000) / 1000.0f * 1.5f;
+      assertDoubleEquals(expected, outBuffer->samples[0][i],
+                         TEST_DEFAULT_TOLERANCE);
+      assertDoubleEquals(-expected, outBuffer->samples[1][i],
+                         TEST_DEFAULT_TOLERANCE);
+    }
+
+    frame += getBlocksize();
+  }
+
+  closePlugin(p);
+  assertIntEquals(0, data->numWorkers);
+  freePlugin(p);
+  freeLinkedList(parameters);
+  freeSampleBuffer(inBuffer);
+  freeSampleBuffer(outBuffer);
+  return 0;
+}
+
+static int _testCompensateBranchDelay(void) {
+  Plugin p = _newTestPluginGroup("mrs_passthru|mrs_passthru");
+  PluginGroupData data = (PluginGroupData)p->extraData;
+  SampleBuffer inBuffer = newSampleBuffer(getNumChannels(), getBlocksize());
+  SampleBuffer outBuffer = newSampleBuffer(getNumChannels(), getBlocksize());
+  unsigned long frame = 0;
+  unsigned long delay;
+  Sample expected;
+  int block;
+  SampleCount i;
+
+  assert(openPlugin(p));
+  // Pipelining the second branch delays it by one block
+  pluginChainSetPipelineStages(data->branches[1]->pluginChain, 1);
+  p->prepareForProcessing(p);
+  delay = (unsigned long)p->getSetting(p, PLUGIN_INITIAL_DELAY);
+  assertUnsignedLongEquals(getBlocksize(), delay);
+  assertUnsignedLongEquals(getBlocksize(), data->branches[0]->delayFrames);
+  assertUnsignedLongEquals(0ul, data->branches[1]->delayFrames);
+
+  for (block = 0; block < TEST_NUM_BLOCKS; block++) {
+    _fillTestBuffer(inBuffer, frame);
+    p->processAudio(p, inBuffer, outBuffer);
+
+    for (i = 0; i < getBlocksize(); i++) {
+      if (frame + i < delay) {
+        expected = 0.0f;
+      } else {
+        expected = (Sample)((frame + i - delay) % 1000) / 1000.0f * 2.0f;
+      }
+
+      assertDoubleEquals(expected, outBuffer->samples[0][i],
+                         TEST_DEFAULT_TOLERANCE);
+      assertDoubleEquals(-expected, outBuffer->samples[1][i],
+                         TEST_DEFAULT_TOLERANCE);
+    }
+
+    frame += getBlocksize();
+  }
+
+  closePlugin(p);
+  freePlugin(p);
+  freeSampleBuffer(inBuffer);
+  freeSampleBuffer(outBuffer);
+  return 0;
+}
+
+static int _testOpenChannelGroups(void) {
+  Plugin p = _newTestChannelGroup("mrs_gain;mrs_passthru", "stereo");
+  PluginGroupData data = (PluginGroupData)p->extraData;
+
+  assert(setNumChannels(5));
+  assert(openPlugin(p));
+  assertIntEquals(3, data->numBranches);
+  assertIntEquals(2, data->branches[0]->pluginChain->numPlugins);
+  assertIntEquals(0, data->branches[0]->firstChannel);
+  assertIntEquals(2, data->branches[1]->firstChannel);
+  assertIntEquals(2, data->branches[1]->numChannels);
+  assertIntEquals(4, data->branches[2]->firstChannel);
+  assertIntEquals(1, data->branches[2]->numChannels);
+  assertIntEquals(5, p->getSetting(p, PLUGIN_NUM_INPUTS));
+  assertIntEquals(5, p->getSetting(p, PLUGIN_NUM_OUTPUTS));
+
+  freePlugin(p);
+  return 0;
+}
+
+static int _testOpenInvalidChannelGroups(void) {
+  Plugin p = _newTestChannelGroup("mrs_gain", "2,2");
+  Plugin q = _newTestChannelGroup("mrs_gain", "1,x");
+
+  assert(setNumChannels(5));
+  assertFalse(openPlugin(p));
+  assertFalse(openPlugin(q));
+  assertIntEquals(0, ((PluginGroupData)p->extraData)->numBranches);
+
+  freePlugin(p);
+  freePlugin(q);
+  return 0;
+}
+
+static int _testProcessChannelGroups(void) {
+  Plugin p = _newTestChannelGroup("mrs_gain", "mono");
+  Plugin branchPlugin;
+  SampleBuffer inBuffer;
+  SampleBuffer outBuffer;
+  ChannelCount channel;
+  SampleCount i;
+
+  assert(setNumChannels(4));
+  inBuffer = newSampleBuffer(getNumChannels(), getBlocksize());
+  outBuffer = newSampleBuffer(getNumChannels(), getBlocksize());
+
+  for (channel = 0; channel < inBuffer->numChannels; channel++) {
+    for (i = 0; i < inBuffer->blocksize; i++) {
+      inBuffer->samples[channel][i] = (Sample)(channel + 1) / 10.0f;
+    }
+  }
+
+  assert(openPlugin(p));
+  assert(p->setParameter(p, 0, 0.5f));
+  p->prepareForProcessing(p);
+  assertIntEquals(3, ((PluginGroupData)p->extraData)->numWorkers);
+  // Each channel is processed on its own by a mono instance of the plugin,
+  // rather than being mapped onto its stereo inputs
+  branchPlugin =
+      ((PluginGroupData)p->extraData)->branches[0]->pluginChain->plugins[0];
+  assertIntEquals(1, branchPlugin->inputBuffer->numChannels);
+  p->processAudio(p, inBuffer, outBuffer);
+
+  for (channel = 0; channel < outBuffer->numChannels; channel++) {
+    for (i = 0; i < outBuffer->blocksize; i++) {
+      assertDoubleEquals((channel + 1) / 20.0, outBuffer->samples[channel][i],
+                         TEST_DEFAULT_TOLERANCE);
+    }
+  }
+
+  freePlugin(p);
+  freeSampleBuffer(inBuffer);
+  freeSampleBuffer(outBuffer);
+  return 0;
+}
+
+static int _testSplitArgumentString(void) {
+  CharString s = newCharStringWithCString("a,1;[b|c;[d|e]];;f");
+  LinkedList l = pluginChainSplitArgumentString(s, ';');
+  CharString *items;
+
+  assertNotNull(l);
+  assertIntEquals(3, linkedListLength(l));
+  items = (CharString *)linkedListToArray(l);
+  assertCharStringEquals("a,1", items[0]);
+  assertCharStringEquals("[b|c;[d|e]]", items[1]);
+  assertCharStringEquals("f", items[2]);
+  free(items);
+
+  freeLinkedListAndItems(l, (LinkedListFreeItemFunc)freeCharString);
+  freeCharString(s);
+  return 0;
+}
+
+static int _testSplitUnbalancedArgumentString(void) {
+  CharString s = newCharStringWithCString("a;[b|c");
+
+  assertIsNull(pluginChainSplitArgumentString(s, ';'));
+  charStringCopyCString(s, "a];[b");
+  assertIsNull(pluginChainSplitArgumentString(s, ';'));
+
+  freeCharString(s);
+  return 0;
+}
+
+static int _testAddFromArgumentString(void) {
+  PluginChain p = newPluginChain();
+  PluginGroupData data;
+
+  assert(_addTestPlugins(
+      p, "mrs_gain;[mrs_passthru|mrs_gain;[mrs_passthru|mrs_gain]];mrs_gain"));
+  assertIntEquals(3, p->numPlugins);
+  assertIntEquals(PLUGIN_TYPE_GROUP, p->plugins[1]->interfaceType);
+  data = (PluginGroupData)p->plugins[1]->extraData;
+  assertIntEquals(2, data->numBranches);
+  assertIntEquals(2, data->branches[1]->pluginChain->numPlugins);
+  assertIntEquals(PLUGIN_TYPE_GROUP,
+                  data->branches[1]->pluginChain->plugins[1]->interfaceType);
+  assertIntEquals(RETURN_CODE_SUCCESS, pluginChainInitialize(p));
+
+  freePluginChain(p);
+  return 0;
+}
+
+static int _testAddInvalidFromArgumentString(void) {
+  PluginChain p = newPluginChain();
+
+  assertFalse(_addTestPlugins(p, "mrs_gain;[mrs_passthru|mrs_gain"));
+  assertFalse(_addTestPlugins(p, "[mrs_passthru|mrs_gain],preset"));
+  assertIntEquals(0, p->numPlugins);
+
+  freePluginChain(p);
+  return 0;
+}
+
+TestSuite addPluginGroupTests(void);
+TestSuite addPluginGroupTests(void) {
+  TestSuite testSuite = newTestSuite("PluginGroup", _pluginGroupTestSetup,
+                                     _pluginGroupTestTeardown);
+  addTest(testSuite, "NewPluginGroup", _testNewPluginGroup);
+  addTest(testSuite, "OpenPluginGroup", _testOpenPluginGroup);
+  addTest(testSuite, "OpenInvalidPluginGroup", _testOpenInvalidPluginGroup);
+  addTest(testSuite, "ProcessAudioSumsBranches",
+          _testProcessAudioSumsBranches);
+  addTest(testSuite, "CompensateBranchDelay", _testCompensateBranchDelay);
+  addTest(testSuite, "OpenChannelGroups", _testOpenChannelGroups);
+  addTest(testSuite, "OpenInvalidChannelGroups",
+          _testOpenInvalidChannelGroups);
+  addTest(testSuite, "ProcessChannelGroups", _testProcessChannelGroups);
+  addTest(testSuite, "SplitArgumentString", _testSplitArgumentString);
+  addTest(testSuite, "SplitUnbalancedArgumentString",
+          _testSplitUnbalancedArgumentString);
+  addTest(testSuite, "AddFromArgumentString", _testAddFromArgumentString);
+  addTest(testSuite, "AddInvalidFromArgumentString",
+          _testAddInvalidFromArgumentString);
+  return testSuite;
+}
@@ -0,0 +1,169 @@
+//
+// PluginIsolatedTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "plugin/PluginIsolated.h"
+
+#include "audio/AudioSettings.h"
+#include "plugin/PluginChain.h"
+#include "unit/TestRunner.h"
+
+static void _pluginIsolatedTestSetup(void) { initAudioSettings(); }
+
+static void _pluginIsolatedTestTeardown(void) { freeAudioSettings(); }
+
+#if UNIX
+static Plugin _newTestPluginIsolated(const char *name) {
+  CharString pluginName = newCharStringWithCString(name);
+  CharString pluginRoot = newCharString();
+  Plugin p = newPluginIsolated(pluginName, pluginRoot, NULL);
+  freeCharString(pluginName);
+  freeCharString(pluginRoot);
+  return p;
+}
+#endif
+
+static int _testNewPluginIsolated(void) {
+#if UNIX
+  Plugin p = _newTestPluginIsolated("mrs_gain");
+
+  assertNotNull(p);
+  assertIntEquals(PLUGIN_TYPE_ISOLATED, p->interfaceType);
+  assertCharStringEquals("mrs_gain", p->pluginName);
+  assertFalse(p->isOpen);
+
+  freePlugin(p);
+#endif
+  return 0;
+}
+
+static int _testOpenInvalidPlugin(void) {
+#if UNIX
+  Plugin p = _newTestPluginIsolated("invalid");
+
+  assertFalse(openPlugin(p));
+  freePlugin(p);
+#endif
+  return 0;
+}
+
+static int _testOpenPlugin(void) {
+#if UNIX
+  Plugin p = _newTestPluginIsolated("mrs_gain");
+
+  assert(openPlugin(p));
+  assertIntEquals(PLUGIN_TYPE_EFFECT, p->pluginType);
+  assertIntEquals(2, p->getSetting(p, PLUGIN_NUM_INPUTS));
+  assertIntEquals(2, p->getSetting(p, PLUGIN_NUM_OUTPUTS));
+  assertIntEquals(0, p->getSetting(p, PLUGIN_INITIAL_DELAY));
+  assert(closePlugin(p));
+
+  freePlugin(p);
+#endif
+  return 0;
+}
+
+static int _testProcessAudio(void) {
+#if UNIX
+  Plugin p = _newTestPluginIsolated("mrs_gain");
+  SampleBuffer inputs;
+  SampleBuffer outputs;
+  SampleCount i;
+
+  assert(openPlugin(p));
+  assert(p->setParameter(p, 0, 0.5f));
+  p->prepareForProcessing(p);
+  inputs = newSampleBuffer(2, getBlocksize());
+  outputs = newSampleBuffer(2, getBlocksize());
+
+  for (i = 0; i < getBlocksize(); i++) {
+    inputs->samples[0][i] = 1.0f;
+    inputs->samples[1][i] = -1.0f;
+  }
+
+  p->processAudio(p, inputs, outputs);
+  assertDoubleEquals(0.5, outputs->samples[0][0], TEST_DEFAULT_TOLERANCE);
+  assertDoubleEquals(-0.5, outputs->samples[1][getBlocksize() - 1],
+                     TEST_DEFAULT_TOLERANCE);
+
+  // The parameter must survive a reset
+  p->resetPlugin(p);
+  sampleBufferClear(outputs);
+  p->processAudio(p, inputs, outputs);
+  assertDoubleEquals(0.5, outputs->samples[0][0], TEST_DEFAULT_TOLERANCE);
+
+  assert(closePlugin(p));
+  freeSampleBuffer(inputs);
+  freeSampleBuffer(outputs);
+  freePlugin(p);
+#endif
+  return 0;
+}
+
+static int _testSetInvalidParameter(void) {
+#if UNIX
+  Plugin p = _newTestPluginIsolated("mrs_passthru");
+
+  assert(openPlugin(p));
+  assertFalse(p->setParameter(p, 0, 0.5f));
+  assert(closePlugin(p));
+  freePlugin(p);
+#endif
+  return 0;
+}
+
+static int _testAddFromArgumentString(void) {
+#if UNIX
+  PluginChain c = newPluginChain();
+  CharString chain = newCharStringWithCString("@mrs_passthru;mrs_gain");
+  CharString pluginRoot = newCharString();
+
+  assert(pluginChainAddFromArgumentString(c, chain, pluginRoot));
+  assertIntEquals(2, c->numPlugins);
+  assertIntEquals(PLUGIN_TYPE_ISOLATED, c->plugins[0]->interfaceType);
+  assertCharStringEquals("mrs_passthru", c->plugins[0]->pluginName);
+  assertIntEquals(PLUGIN_TYPE_INTERNAL, c->plugins[1]->interfaceType);
+  assertIntEquals(RETURN_CODE_SUCCESS, pluginChainInitialize(c));
+
+  pluginChainShutdown(c);
+  freePluginChain(c);
+  freeCharString(chain);
+  freeCharString(pluginRoot);
+#endif
+  return 0;
+}
+
+TestSuite addPluginIsolatedTests(void);
+TestSuite addPluginIsolatedTests(void) {
+  TestSuite testSuite = newTestSuite("PluginIsolated", _pluginIsolatedTestSetup,
+                                     _pluginIsolatedTestTeardown);
+  addTest(testSuite, "NewPluginIsolated", _testNewPluginIsolated);
+  addTest(testSuite, "OpenInvalidPlugin", _testOpenInvalidPlugin);
+  addTest(testSuite, "OpenPlugin", _testOpenPlugin);
+  addTest(testSuite, "ProcessAudio", _testProcessAudio);
+  addTest(testSuite, "SetInvalidParameter", _testSetInvalidParameter);
+  addTest(testSuite, "AddFromArgumentString", _testAddFromArgumentString);
+  return testSuite;
+}
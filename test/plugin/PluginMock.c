@@ -38,9 +38,12 @@ static boolByte _pluginMockOpen(void *pluginPtr) {
 }
 
 static int _pluginMockGetSetting(void *pluginPtr, PluginSetting pluginSetting) {
+  Plugin self = (Plugin)pluginPtr;
+  PluginMockData extraData = (PluginMockData)self->extraData;
+
   switch (pluginSetting) {
   case PLUGIN_SETTING_TAIL_TIME_IN_MS:
-    return kPluginMockTailTime;
+    return extraData->tailTimeInMs;
 
   case PLUGIN_NUM_INPUTS:
     return 2;
@@ -49,7 +52,7 @@ static int _pluginMockGetSetting(void *pluginPtr, PluginSetting pluginSetting) {
     return 2;
 
   case PLUGIN_INITIAL_DELAY:
-    return 0;
+    return extraData->initialDelay;
 
   default:
     return 0;
@@ -62,6 +65,12 @@ static void _pluginMockPrepareForProcessing(void *pluginPtr) {
   extraData->isPrepared = true;
 }
 
+static void _pluginMockReset(void *pluginPtr) {
+  Plugin self = (Plugin)pluginPtr;
+  PluginMockData extraData = (PluginMockData)self->extraData;
+  extraData->isReset = true;
+}
+
 static void _pluginMockProcessAudio(void *pluginPtr, SampleBuffer inputs,
                                     SampleBuffer outputs) {
   Plugin self = (Plugin)pluginPtr;
@@ -75,6 +84,8 @@ static void _pluginMockProcessMidiEvents(void *pluginPtr,
   Plugin self = (Plugin)pluginPtr;
   PluginMockData extraData = (PluginMockData)self->extraData;
   extraData->processMidiCalled = true;
+  extraData->numMidiCalls++;
+  extraData->numMidiEvents = linkedListLength(midiEvents);
 }
 
 static boolByte _pluginMockSetParameter(void *pluginPtr, unsigned int i,
@@ -97,6 +108,7 @@ Plugin newPluginMock(void) {
   plugin->displayInfo = _pluginMockEmpty;
   plugin->getSetting = _pluginMockGetSetting;
   plugin->prepareForProcessing = _pluginMockPrepareForProcessing;
+  plugin->resetPlugin = _pluginMockReset;
   plugin->processAudio = _pluginMockProcessAudio;
   plugin->processMidiEvents = _pluginMockProcessMidiEvents;
   plugin->setParameter = _pluginMockSetParameter;
@@ -107,8 +119,13 @@ Plugin newPluginMock(void) {
       (PluginMockData)malloc(sizeof(PluginMockDataMembers));
   extraData->isOpen = false;
   extraData->isPrepared = false;
+  extraData->isReset = false;
   extraData->processAudioCalled = false;
   extraData->processMidiCalled = false;
+  extraData->numMidiCalls = 0;
+  extraData->numMidiEvents = 0;
+  extraData->initialDelay = 0;
+  extraData->tailTimeInMs = kPluginMockTailTime;
   plugin->extraData = extraData;
 
   return plugin;
@@ -35,8 +35,15 @@ static const int kPluginMockTailTime = 123;
 typedef struct {
   boolByte isOpen;
   boolByte isPrepared;
+  boolByte isReset;
   boolByte processAudioCalled;
   boolByte processMidiCalled;
+  // Number of calls to processMidiEvents(), and of events in the last call
+  int numMidiCalls;
+  int numMidiEvents;
+  // Processing delay which is reported by the plugin, in frames
+  int initialDelay;
+  int tailTimeInMs;
 } PluginMockDataMembers;
 typedef PluginMockDataMembers *PluginMockData;
 
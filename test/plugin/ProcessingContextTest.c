@@ -0,0 +1,155 @@
+//
+// ProcessingContextTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "plugin/ProcessingContext.h"
+
+#include "base/Thread.h"
+#include "plugin/PluginChain.h"
+#include "unit/TestRunner.h"
+
+#define TEST_NUM_CONTEXTS 2
+#define TEST_NUM_ITERATIONS 10000
+
+typedef struct {
+  ProcessingContext context;
+  SampleRate sampleRate;
+  boolByte succeeded;
+} _ProcessingContextTestRender;
+
+static void _processingContextTestSetup(void) {
+  initAudioSettings();
+  initPluginChain();
+}
+
+static void _processingContextTestTeardown(void) {
+  processingContextMakeCurrent(NULL);
+  freePluginChain(getPluginChain());
+  freeAudioSettings();
+}
+
+static int _testNewProcessingContext(void) {
+  ProcessingContext c;
+
+  assert(setSampleRate(48000.0));
+  c = newProcessingContext();
+  assertNotNull(c);
+  assertDoubleEquals(48000.0, c->settings->sampleRate, TEST_DEFAULT_TOLERANCE);
+  assertNotNull(c->audioClock);
+  assert(c->audioClock != getAudioClock());
+  assert(c->pluginChain == getPluginChain());
+  assertIsNull(getProcessingContext());
+
+  freeProcessingContext(c);
+  return 0;
+}
+
+static int _testMakeProcessingContextCurrent(void) {
+  ProcessingContext c = newProcessingContext();
+  PluginChain pluginChain = newPluginChain();
+  PluginChain globalChain = getPluginChain();
+  AudioClock globalClock = getAudioClock();
+
+  c->pluginChain = pluginChain;
+  processingContextMakeCurrent(c);
+  assert(getProcessingContext() == c);
+  assert(getAudioClock() == c->audioClock);
+  assert(getPluginChain() == pluginChain);
+  assert(setSampleRate(96000.0));
+  assertDoubleEquals(96000.0, c->settings->sampleRate, TEST_DEFAULT_TOLERANCE);
+
+  // Changes made in the context do not leak into the global instances
+  processingContextMakeCurrent(NULL);
+  assertIsNull(getProcessingContext());
+  assert(getAudioClock() == globalClock);
+  assert(getPluginChain() == globalChain);
+  assertDoubleEquals(DEFAULT_SAMPLE_RATE, getSampleRate(),
+                     TEST_DEFAULT_TOLERANCE);
+
+  freePluginChain(pluginChain);
+  freeProcessingContext(c);
+  return 0;
+}
+
+static void _renderWithContext(void *userData) {
+  _ProcessingContextTestRender *render =
+      (_ProcessingContextTestRender *)userData;
+  int i;
+
+  processingContextMakeCurrent(render->context);
+  setSampleRate(render->sampleRate);
+  render->succeeded = true;
+
+  for (i = 0; i < TEST_NUM_ITERATIONS; i++) {
+    advanceAudioClock(getAudioClock(), 1);
+
+    if (getSampleRate() != render->sampleRate) {
+      render->succeeded = false;
+    }
+  }
+
+  processingContextMakeCurrent(NULL);
+}
+
+static int _testConcurrentProcessingContexts(void) {
+  _ProcessingContextTestRender renders[TEST_NUM_CONTEXTS];
+  Thread threads[TEST_NUM_CONTEXTS];
+  int i;
+
+  for (i = 0; i < TEST_NUM_CONTEXTS; i++) {
+    renders[i].context = newProcessingContext();
+    renders[i].sampleRate = 44100.0 * (i + 1);
+    renders[i].succeeded = false;
+    threads[i] = newThread(_renderWithContext, &renders[i]);
+    assertNotNull(threads[i]);
+  }
+
+  for (i = 0; i < TEST_NUM_CONTEXTS; i++) {
+    freeThread(threads[i]);
+    assert(renders[i].succeeded);
+    assertUnsignedLongEquals((unsigned long)TEST_NUM_ITERATIONS,
+                             renders[i].context->audioClock->currentFrame);
+    freeProcessingContext(renders[i].context);
+  }
+
+  // Neither render changed the settings or clock of the calling thread
+  assertDoubleEquals(DEFAULT_SAMPLE_RATE, getSampleRate(),
+                     TEST_DEFAULT_TOLERANCE);
+  assertUnsignedLongEquals(0ul, getAudioClock()->currentFrame);
+  return 0;
+}
+
+TestSuite addProcessingContextTests(void);
+TestSuite addProcessingContextTests(void) {
+  TestSuite testSuite =
+      newTestSuite("ProcessingContext", _processingContextTestSetup,
+                   _processingContextTestTeardown);
+  addTest(testSuite, "NewProcessingContext", _testNewProcessingContext);
+  addTest(testSuite, "MakeProcessingContextCurrent",
+          _testMakeProcessingContextCurrent);
+  addTest(testSuite, "ConcurrentProcessingContexts",
+          _testConcurrentProcessingContexts);
+  return testSuite;
+}
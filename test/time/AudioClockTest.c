@@ -26,13 +26,20 @@
 
 #include "time/AudioClock.h"
 
+#include "audio/AudioSettings.h"
 #include "unit/TestRunner.h"
 
 static const unsigned long kAudioClockTestBlocksize = 256;
 
-static void _audioClockTestSetup(void) { initAudioClock(); }
+static void _audioClockTestSetup(void) {
+  initAudioClock();
+  initAudioSettings();
+}
 
-static void _audioClockTestTeardown(void) { freeAudioClock(getAudioClock()); }
+static void _audioClockTestTeardown(void) {
+  freeAudioClock(getAudioClock());
+  freeAudioSettings();
+}
 
 static int _testInitAudioClock(void) {
   AudioClock audioClock = getAudioClock();
@@ -86,6 +93,95 @@ static int _testAdvanceClockMulitpleTimes(void) {
   return 0;
 }
 
+static int _testThreadAudioClock(void) {
+  AudioClock globalClock = getAudioClock();
+  AudioClock threadClock = newAudioClock();
+
+  setThreadAudioClock(threadClock);
+  assert(getAudioClock() == threadClock);
+  advanceAudioClock(getAudioClock(), kAudioClockTestBlocksize);
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, globalClock->currentFrame);
+
+  // Freeing the thread's clock should restore the global one
+  freeAudioClock(threadClock);
+  assert(getAudioClock() == globalClock);
+  return 0;
+}
+
+static int _testTimeInfoAtStart(void) {
+  const AudioClockTimeInfo *timeInfo = audioClockGetTimeInfo(getAudioClock());
+  assertUnsignedLongEquals(ZERO_UNSIGNED_LONG, timeInfo->samplePosition);
+  assertDoubleEquals(0.0, timeInfo->ppqPosition, TEST_DEFAULT_TOLERANCE);
+  assertDoubleEquals(0.0, timeInfo->barStartPosition, TEST_DEFAULT_TOLERANCE);
+  assertIntEquals(4, timeInfo->timeSignatureBeatsPerMeasure);
+  assertIntEquals(4, timeInfo->timeSignatureNoteValue);
+  return 0;
+}
+
+static int _testTimeInfoAfterAdvance(void) {
+  AudioClock audioClock = getAudioClock();
+  const AudioClockTimeInfo *timeInfo;
+
+  // At 44.1kHz and 120 BPM, a quarter note is 22050 frames long
+  advanceAudioClock(audioClock, 22050 * 5 + 100);
+  timeInfo = audioClockGetTimeInfo(audioClock);
+  assertUnsignedLongEquals(22050ul * 5 + 100, timeInfo->samplePosition);
+  assertDoubleEquals((5.0 + 100.0 / 22050.0), timeInfo->ppqPosition,
+                     TEST_DEFAULT_TOLERANCE);
+  assertDoubleEquals(4.0, timeInfo->barStartPosition, TEST_DEFAULT_TOLERANCE);
+  return 0;
+}
+
+static int _testTimeInfoCachedWithinBlock(void) {
+  AudioClock audioClock = getAudioClock();
+  const AudioClockTimeInfo *timeInfo;
+  unsigned long long systemTime;
+
+  advanceAudioClock(audioClock, kAudioClockTestBlocksize);
+  timeInfo = audioClockGetTimeInfo(audioClock);
+  systemTime = timeInfo->systemTimeInNanoseconds;
+  assert(audioClockGetTimeInfo(audioClock) == timeInfo);
+  assert(timeInfo->systemTimeInNanoseconds == systemTime);
+
+  advanceAudioClock(audioClock, kAudioClockTestBlocksize);
+  timeInfo = audioClockGetTimeInfo(audioClock);
+  assertUnsignedLongEquals(kAudioClockTestBlocksize * 2,
+                           timeInfo->samplePosition);
+  return 0;
+}
+
+static int _testTimeInfoAfterTempoChange(void) {
+  AudioClock audioClock = getAudioClock();
+  const AudioClockTimeInfo *timeInfo;
+
+  advanceAudioClock(audioClock, 22050 * 2);
+  timeInfo = audioClockGetTimeInfo(audioClock);
+  assertDoubleEquals(2.0, timeInfo->ppqPosition, TEST_DEFAULT_TOLERANCE);
+
+  // Changing the tempo during a block must not return the cached position
+  assert(setTempo(60.0f));
+  timeInfo = audioClockGetTimeInfo(audioClock);
+  assertDoubleEquals(60.0, timeInfo->tempo, TEST_DEFAULT_TOLERANCE);
+  assertDoubleEquals(1.0, timeInfo->ppqPosition, TEST_DEFAULT_TOLERANCE);
+  return 0;
+}
+
+static int _testTimeInfoWithCompoundMeter(void) {
+  AudioClock audioClock = getAudioClock();
+  const AudioClockTimeInfo *timeInfo;
+
+  // A bar of 6/8 is 3 quarter notes long
+  assert(setTimeSignatureBeatsPerMeasure(6));
+  assert(setTimeSignatureNoteValue(8));
+  advanceAudioClock(audioClock, 22050 * 7);
+  timeInfo = audioClockGetTimeInfo(audioClock);
+  assertDoubleEquals(7.0, timeInfo->ppqPosition, TEST_DEFAULT_TOLERANCE);
+  assertDoubleEquals(6.0, timeInfo->barStartPosition, TEST_DEFAULT_TOLERANCE);
+  assertIntEquals(6, timeInfo->timeSignatureBeatsPerMeasure);
+  assertIntEquals(8, timeInfo->timeSignatureNoteValue);
+  return 0;
+}
+
 TestSuite addAudioClockTests(void);
 TestSuite addAudioClockTests(void) {
   TestSuite testSuite =
@@ -95,5 +191,13 @@ TestSuite addAudioClockTests(void) {
   addTest(testSuite, "StopClock", _testStopAudioClock);
   addTest(testSuite, "RestartClock", _testRestartAudioClock);
   addTest(testSuite, "MultipleAdvance", _testAdvanceClockMulitpleTimes);
+  addTest(testSuite, "ThreadAudioClock", _testThreadAudioClock);
+  addTest(testSuite, "TimeInfoAtStart", _testTimeInfoAtStart);
+  addTest(testSuite, "TimeInfoAfterAdvance", _testTimeInfoAfterAdvance);
+  addTest(testSuite, "TimeInfoCachedWithinBlock",
+          _testTimeInfoCachedWithinBlock);
+  addTest(testSuite, "TimeInfoAfterTempoChange", _testTimeInfoAfterTempoChange);
+  addTest(testSuite, "TimeInfoWithCompoundMeter",
+          _testTimeInfoWithCompoundMeter);
   return testSuite;
 }
@@ -0,0 +1,135 @@
+//
+// RealtimeSchedulerTest.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "time/RealtimeScheduler.h"
+
+#include "audio/AudioSettings.h"
+#include "time/TaskTimer.h"
+#include "unit/TestRunner.h"
+
+#define TEST_NUM_BLOCKS 5
+
+static RealtimeScheduler _testScheduler = NULL;
+
+static void _realtimeSchedulerTestSetup(void) {
+  initAudioSettings();
+  _testScheduler = newRealtimeScheduler();
+}
+
+static void _realtimeSchedulerTestTeardown(void) {
+  freeRealtimeScheduler(_testScheduler);
+  freeAudioSettings();
+}
+
+static double _getBlockTimeInMs(void) {
+  return getBlocksize() * 1000.0 / getSampleRate();
+}
+
+static int _testNewRealtimeScheduler(void) {
+  int i;
+
+  assertUnsignedLongEquals(0ul, _testScheduler->numBlocks);
+  assertUnsignedLongEquals(0ul, _testScheduler->numDeadlineMisses);
+
+  for (i = 0; i < REALTIME_SCHEDULER_NUM_SLACK_BINS; i++) {
+    assertUnsignedLongEquals(0ul, _testScheduler->slackHistogram[i]);
+  }
+
+  return 0;
+}
+
+static int _testKeepPace(void) {
+  TaskTimer timer = newTaskTimerWithCString(NULL, NULL);
+  double elapsedTimeInMs;
+  int i;
+
+  taskTimerStart(timer);
+
+  for (i = 0; i < TEST_NUM_BLOCKS; i++) {
+    realtimeSchedulerBeginBlock(_testScheduler);
+    realtimeSchedulerEndBlock(_testScheduler, getBlocksize());
+  }
+
+  elapsedTimeInMs = taskTimerStop(timer);
+
+  // Blocks which do no work have nearly the whole block left over, so they
+  // all end up in the last bin
+  assertUnsignedLongEquals((unsigned long)TEST_NUM_BLOCKS,
+                           _testScheduler->numBlocks);
+  assertUnsignedLongEquals(0ul, _testScheduler->numDeadlineMisses);
+  assertUnsignedLongEquals(
+      (unsigned long)TEST_NUM_BLOCKS,
+      _testScheduler->slackHistogram[REALTIME_SCHEDULER_NUM_SLACK_BINS - 1]);
+  assert(_testScheduler->worstLatenessInMs < 0.0);
+  assert(elapsedTimeInMs >= _getBlockTimeInMs() * (TEST_NUM_BLOCKS - 1));
+
+  freeTaskTimer(timer);
+  return 0;
+}
+
+static int _testCountDeadlineMiss(void) {
+  realtimeSchedulerBeginBlock(_testScheduler);
+  taskTimerSleep(_getBlockTimeInMs() * 2.0);
+  assert(realtimeSchedulerEndBlock(_testScheduler, getBlocksize()) < 0.0);
+  assertUnsignedLongEquals(1ul, _testScheduler->numDeadlineMisses);
+  assertUnsignedLongEquals(1ul, _testScheduler->slackHistogram[0]);
+  assert(_testScheduler->worstLatenessInMs > _getBlockTimeInMs() * 0.5);
+
+  // The timeline starts over after a missed deadline, so the next block
+  // isn't late as well
+  realtimeSchedulerBeginBlock(_testScheduler);
+  assert(realtimeSchedulerEndBlock(_testScheduler, getBlocksize()) > 0.0);
+  assertUnsignedLongEquals(2ul, _testScheduler->numBlocks);
+  assertUnsignedLongEquals(1ul, _testScheduler->numDeadlineMisses);
+
+  return 0;
+}
+
+static int _testTimelineDoesNotDrift(void) {
+  int i;
+
+  // Blocks which use part of their time should not push later deadlines back
+  for (i = 0; i < TEST_NUM_BLOCKS; i++) {
+    realtimeSchedulerBeginBlock(_testScheduler);
+    taskTimerSleep(_getBlockTimeInMs() * 0.5);
+    realtimeSchedulerEndBlock(_testScheduler, getBlocksize());
+  }
+
+  assertUnsignedLongEquals(0ul, _testScheduler->numDeadlineMisses);
+  return 0;
+}
+
+TestSuite addRealtimeSchedulerTests(void);
+TestSuite addRealtimeSchedulerTests(void) {
+  TestSuite testSuite =
+      newTestSuite("RealtimeScheduler", _realtimeSchedulerTestSetup,
+                   _realtimeSchedulerTestTeardown);
+  addTest(testSuite, "NewRealtimeScheduler", _testNewRealtimeScheduler);
+  addTest(testSuite, "KeepPace", _testKeepPace);
+  addTest(testSuite, "CountDeadlineMiss", _testCountDeadlineMiss);
+  addTest(testSuite, "TimelineDoesNotDrift", _testTimelineDoesNotDrift);
+  return testSuite;
+}
@@ -0,0 +1,78 @@
+//
+// TestFiles.c - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "TestFiles.h"
+
+#include "audio/AudioSettings.h"
+#include "base/File.h"
+#include "io/SampleSource.h"
+
+void removeTestFile(const char *filename) {
+  File file = newFileWithPathCString(filename);
+
+  if (fileExists(file)) {
+    fileRemove(file);
+  }
+
+  freeFile(file);
+}
+
+boolByte writeTestInput(const char *filename, unsigned long numFrames,
+                        TestSampleFunc sampleFunc) {
+  CharString inputName = newCharStringWithCString(filename);
+  SampleSource s = sampleSourceFactory(inputName);
+  SampleBuffer b = newSampleBuffer(getNumChannels(), getBlocksize());
+  unsigned long frame = 0;
+  boolByte result = s->openSampleSource(s, SAMPLE_SOURCE_OPEN_WRITE);
+  ChannelCount channel;
+  SampleCount i;
+
+  while (result && frame < numFrames) {
+    if (numFrames - frame < b->blocksize) {
+      b->blocksize = numFrames - frame;
+    }
+
+    if (sampleFunc != NULL) {
+      for (channel = 0; channel < b->numChannels; channel++) {
+        for (i = 0; i < b->blocksize; i++) {
+          b->samples[channel][i] = sampleFunc(frame + i, channel);
+        }
+      }
+    }
+
+    s->writeSampleBlock(s, b);
+    frame += b->blocksize;
+  }
+
+  if (s->openedAs == SAMPLE_SOURCE_OPEN_WRITE) {
+    s->closeSampleSource(s);
+  }
+
+  freeSampleSource(s);
+  freeSampleBuffer(b);
+  freeCharString(inputName);
+  return result;
+}
@@ -0,0 +1,58 @@
+//
+// TestFiles.h - MrsWatson
+// Copyright (c) 2016 Teragon Audio. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef MrsWatsonTest_TestFiles_h
+#define MrsWatsonTest_TestFiles_h
+
+#include "audio/SampleBuffer.h"
+
+/**
+ * Gives the value of a sample in a test input file
+ * @param frame Frame number, counted from the start of the file
+ * @param channel Channel number
+ * @return Sample value
+ */
+typedef Sample (*TestSampleFunc)(unsigned long frame, ChannelCount channel);
+
+/**
+ * Remove a file which was created by a test, if it exists
+ * @param filename File to remove
+ */
+void removeTestFile(const char *filename);
+
+/**
+ * Write an input file for a test, with the current channel count and
+ * blocksize. The file type is chosen by the file's extension.
+ * @param filename File to write
+ * @param numFrames Number of frames to write, which does not need to be a
+ * multiple of the blocksize
+ * @param sampleFunc Function which gives each sample, or NULL for silence
+ * @return True if the file could be opened for writing
+ */
+boolByte writeTestInput(const char *filename, unsigned long numFrames,
+                        TestSampleFunc sampleFunc);
+
+#endif
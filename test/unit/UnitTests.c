@@ -32,22 +32,43 @@
 
 extern TestSuite addAudioClockTests(void);
 extern TestSuite addAudioSettingsTests(void);
+extern TestSuite addBatchRendererTests(void);
 extern TestSuite addCharStringTests(void);
+extern TestSuite addControlChannelTests(void);
 extern TestSuite addEndianTests(void);
 extern TestSuite addFileTests(void);
+#if WITH_JACK
+extern TestSuite addJackClientTests(void);
+#endif
 extern TestSuite addLinkedListTests(void);
 extern TestSuite addMidiSequenceTests(void);
+extern TestSuite addMidiSourceFileTests(void);
+extern TestSuite addMidiSourceStreamTests(void);
+extern TestSuite addMidiTempoMapTests(void);
 extern TestSuite addMidiSourceTests(void);
 extern TestSuite addPcmSampleBufferTests(void);
 extern TestSuite addPlatformInfoTests(void);
 extern TestSuite addPluginTests(void);
 extern TestSuite addPluginChainTests(void);
+extern TestSuite addPluginChainFanOutTests(void);
+extern TestSuite addPluginChainPipelineTests(void);
+extern TestSuite addPluginChainRendererTests(void);
+extern TestSuite addPluginGroupTests(void);
+extern TestSuite addPluginIsolatedTests(void);
 extern TestSuite addPluginPresetTests(void);
 extern TestSuite addPluginVst2xIdTests(void);
+extern TestSuite addProcessingContextTests(void);
 extern TestSuite addProgramOptionTests(void);
+extern TestSuite addQueueTests(void);
+extern TestSuite addRealtimeSchedulerTests(void);
+extern TestSuite addRenderServerTests(void);
+extern TestSuite addRenderWorkerTests(void);
 extern TestSuite addSampleBufferTests(void);
 extern TestSuite addSampleSourceTests(void);
+extern TestSuite addSegmentRendererTests(void);
+extern TestSuite addTaskSchedulerTests(void);
 extern TestSuite addTaskTimerTests(void);
+extern TestSuite addThreadTests(void);
 
 extern TestSuite addAnalysisClippingTests(void);
 extern TestSuite addAnalysisDistortionTests(void);
@@ -71,22 +92,43 @@ LinkedList getTestSuites(File mrsWatsonExePath, File resourcesPath) {
 
   linkedListAppend(unitTestSuites, addAudioClockTests());
   linkedListAppend(unitTestSuites, addAudioSettingsTests());
+  linkedListAppend(unitTestSuites, addBatchRendererTests());
   linkedListAppend(unitTestSuites, addCharStringTests());
+  linkedListAppend(unitTestSuites, addControlChannelTests());
   linkedListAppend(unitTestSuites, addEndianTests());
   linkedListAppend(unitTestSuites, addFileTests());
+#if WITH_JACK
+  linkedListAppend(unitTestSuites, addJackClientTests());
+#endif
   linkedListAppend(unitTestSuites, addLinkedListTests());
   linkedListAppend(unitTestSuites, addMidiSequenceTests());
+  linkedListAppend(unitTestSuites, addMidiSourceFileTests());
+  linkedListAppend(unitTestSuites, addMidiSourceStreamTests());
+  linkedListAppend(unitTestSuites, addMidiTempoMapTests());
   linkedListAppend(unitTestSuites, addMidiSourceTests());
   linkedListAppend(unitTestSuites, addPcmSampleBufferTests());
   linkedListAppend(unitTestSuites, addPlatformInfoTests());
   linkedListAppend(unitTestSuites, addPluginTests());
   linkedListAppend(unitTestSuites, addPluginChainTests());
+  linkedListAppend(unitTestSuites, addPluginChainFanOutTests());
+  linkedListAppend(unitTestSuites, addPluginChainPipelineTests());
+  linkedListAppend(unitTestSuites, addPluginChainRendererTests());
+  linkedListAppend(unitTestSuites, addPluginGroupTests());
+  linkedListAppend(unitTestSuites, addPluginIsolatedTests());
   linkedListAppend(unitTestSuites, addPluginPresetTests());
   linkedListAppend(unitTestSuites, addPluginVst2xIdTests());
+  linkedListAppend(unitTestSuites, addProcessingContextTests());
   linkedListAppend(unitTestSuites, addProgramOptionTests());
+  linkedListAppend(unitTestSuites, addQueueTests());
+  linkedListAppend(unitTestSuites, addRealtimeSchedulerTests());
+  linkedListAppend(unitTestSuites, addRenderServerTests());
+  linkedListAppend(unitTestSuites, addRenderWorkerTests());
   linkedListAppend(unitTestSuites, addSampleBufferTests());
   linkedListAppend(unitTestSuites, addSampleSourceTests());
+  linkedListAppend(unitTestSuites, addSegmentRendererTests());
+  linkedListAppend(unitTestSuites, addTaskSchedulerTests());
   linkedListAppend(unitTestSuites, addTaskTimerTests());
+  linkedListAppend(unitTestSuites, addThreadTests());
 
   linkedListAppend(unitTestSuites, addAnalysisClippingTests());
   linkedListAppend(unitTestSuites, addAnalysisDistortionTests());